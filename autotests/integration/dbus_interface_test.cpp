@@ -51,6 +51,7 @@ private Q_SLOTS:
     void testGetWindowInfoInvalidUuid();
     void testGetWindowInfoXdgShellClient();
     void testGetWindowInfoX11Client();
+    void testWindowInfoChanges();
 };
 
 void TestDbusInterface::initTestCase()
@@ -87,6 +88,18 @@ QDBusPendingCall getWindowInfo(const QUuid &uuid)
     msg.setArguments({uuid.toString()});
     return QDBusConnection::sessionBus().asyncCall(msg);
 }
+
+QDBusPendingCall getWindowInfoChanges(qulonglong generation)
+{
+    auto msg = QDBusMessage::createMethodCall(s_destination, s_path, s_interface, QStringLiteral("getWindowInfoChanges"));
+    msg.setArguments({generation});
+    return QDBusConnection::sessionBus().asyncCall(msg);
+}
+
+QVariantMap demarshalMap(const QVariant &value)
+{
+    return qdbus_cast<QVariantMap>(value.value<QDBusArgument>());
+}
 }
 
 void TestDbusInterface::testGetWindowInfoInvalidUuid()
@@ -387,5 +400,60 @@ void TestDbusInterface::testGetWindowInfoX11Client()
     QVERIFY(reply.value().empty());
 }
 
+void TestDbusInterface::testWindowInfoChanges()
+{
+    auto msg = QDBusMessage::createMethodCall(s_destination, s_path, s_interface, QStringLiteral("getAllWindowInfo"));
+    QDBusPendingReply<QVariantMap> allReply{QDBusConnection::sessionBus().asyncCall(msg)};
+    allReply.waitForFinished();
+    QVERIFY(allReply.isValid());
+    const qulonglong initialGeneration = allReply.value().value(QStringLiteral("generation")).toULongLong();
+
+    // nothing happened since
+    QDBusPendingReply<QVariantMap> reply{getWindowInfoChanges(initialGeneration)};
+    reply.waitForFinished();
+    QVERIFY(reply.isValid());
+    QCOMPARE(reply.value().value(QStringLiteral("generation")).toULongLong(), initialGeneration);
+    QVERIFY(demarshalMap(reply.value().value(QStringLiteral("windows"))).isEmpty());
+
+    QScopedPointer<KWayland::Client::Surface> surface(Test::createSurface());
+    QScopedPointer<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.data()));
+    auto window = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(window);
+    const QString id = window->internalId().toString();
+
+    // the new window is reported as changed
+    reply = getWindowInfoChanges(initialGeneration);
+    reply.waitForFinished();
+    const qulonglong addedGeneration = reply.value().value(QStringLiteral("generation")).toULongLong();
+    QVERIFY(addedGeneration > initialGeneration);
+    QVERIFY(demarshalMap(reply.value().value(QStringLiteral("windows"))).contains(id));
+    QVERIFY(!reply.value().value(QStringLiteral("reset")).toBool());
+
+    // and only reported again once it changes
+    reply = getWindowInfoChanges(addedGeneration);
+    reply.waitForFinished();
+    QVERIFY(demarshalMap(reply.value().value(QStringLiteral("windows"))).isEmpty());
+
+    window->setMinimized(true);
+    reply = getWindowInfoChanges(addedGeneration);
+    reply.waitForFinished();
+    const qulonglong minimizedGeneration = reply.value().value(QStringLiteral("generation")).toULongLong();
+    const QVariantMap windows = demarshalMap(reply.value().value(QStringLiteral("windows")));
+    QCOMPARE(windows.count(), 1);
+    QCOMPARE(demarshalMap(windows.value(id)).value(QStringLiteral("minimized")).toBool(), true);
+
+    // closing the window reports it as removed
+    QSignalSpy windowClosedSpy(window, &Window::windowClosed);
+    QVERIFY(windowClosedSpy.isValid());
+    shellSurface.reset();
+    surface.reset();
+    QVERIFY(windowClosedSpy.wait());
+
+    reply = getWindowInfoChanges(minimizedGeneration);
+    reply.waitForFinished();
+    QVERIFY(demarshalMap(reply.value().value(QStringLiteral("windows"))).isEmpty());
+    QCOMPARE(reply.value().value(QStringLiteral("removed")).toStringList(), QStringList{id});
+}
+
 WAYLANDTEST_MAIN(TestDbusInterface)
 #include "dbus_interface_test.moc"
@@ -144,6 +144,11 @@ void DebugConsoleTest::testX11Window()
     QVERIFY(windowIndex.isValid());
     QCOMPARE(model.parent(windowIndex), x11TopLevelIndex);
     QVERIFY(model.hasChildren(windowIndex));
+    // properties are fetched lazily
+    QCOMPARE(model.rowCount(windowIndex), 0);
+    QVERIFY(model.canFetchMore(windowIndex));
+    model.fetchMore(windowIndex);
+    QVERIFY(!model.canFetchMore(windowIndex));
     QVERIFY(model.rowCount(windowIndex) != 0);
     QCOMPARE(model.columnCount(windowIndex), 2);
     // other indexes are still invalid
@@ -232,6 +237,11 @@ void DebugConsoleTest::testX11Unmanaged()
     QVERIFY(windowIndex.isValid());
     QCOMPARE(model.parent(windowIndex), unmanagedTopLevelIndex);
     QVERIFY(model.hasChildren(windowIndex));
+    // properties are fetched lazily
+    QCOMPARE(model.rowCount(windowIndex), 0);
+    QVERIFY(model.canFetchMore(windowIndex));
+    model.fetchMore(windowIndex);
+    QVERIFY(!model.canFetchMore(windowIndex));
     QVERIFY(model.rowCount(windowIndex) != 0);
     QCOMPARE(model.columnCount(windowIndex), 2);
     // other indexes are still invalid
@@ -330,6 +340,11 @@ void DebugConsoleTest::testWaylandClient()
     QVERIFY(windowIndex.isValid());
     QCOMPARE(model.parent(windowIndex), waylandTopLevelIndex);
     QVERIFY(model.hasChildren(windowIndex));
+    // properties are fetched lazily
+    QCOMPARE(model.rowCount(windowIndex), 0);
+    QVERIFY(model.canFetchMore(windowIndex));
+    model.fetchMore(windowIndex);
+    QVERIFY(!model.canFetchMore(windowIndex));
     QVERIFY(model.rowCount(windowIndex) != 0);
     QCOMPARE(model.columnCount(windowIndex), 2);
     // other indexes are still invalid
@@ -435,6 +450,11 @@ void DebugConsoleTest::testInternalWindow()
     QVERIFY(windowIndex.isValid());
     QCOMPARE(model.parent(windowIndex), internalTopLevelIndex);
     QVERIFY(model.hasChildren(windowIndex));
+    // properties are fetched lazily
+    QCOMPARE(model.rowCount(windowIndex), 0);
+    QVERIFY(model.canFetchMore(windowIndex));
+    model.fetchMore(windowIndex);
+    QVERIFY(!model.canFetchMore(windowIndex));
     QVERIFY(model.rowCount(windowIndex) != 0);
     QCOMPARE(model.columnCount(windowIndex), 2);
     // other indexes are still invalid
@@ -10,6 +10,7 @@
 #include "composite.h"
 #include "cursor.h"
 #include "effectloader.h"
+#include "options.h"
 #include "platform.h"
 #include "renderbackend.h"
 #include "scene.h"
@@ -17,6 +18,8 @@
 #include "window.h"
 
 #include <KConfigGroup>
+#include <KWayland/Client/subsurface.h>
+#include <KWayland/Client/surface.h>
 
 using namespace KWin;
 static const QString s_socketName = QStringLiteral("wayland_test_kwin_scene_opengl-0");
@@ -86,3 +89,38 @@ void GenericSceneOpenGLTest::testRestart()
     // TODO: introduce frameRendered signal in SceneOpenGL
     QTest::qWait(100);
 }
+
+void GenericSceneOpenGLTest::testOpaqueSubSurfaceFrameCallback()
+{
+    // This test verifies that a window whose main surface is covered by its own opaque
+    // subsurface, e.g. a video player, is not throttled like a window hidden by other windows
+    QVERIFY(Test::setupWaylandConnection());
+
+    QScopedPointer<KWayland::Client::Surface> parentSurface(Test::createSurface());
+    QVERIFY(!parentSurface.isNull());
+    QScopedPointer<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(parentSurface.data()));
+    QVERIFY(!shellSurface.isNull());
+
+    QScopedPointer<KWayland::Client::Surface> surface(Test::createSurface());
+    QVERIFY(!surface.isNull());
+    QScopedPointer<KWayland::Client::SubSurface> subSurface(Test::createSubSurface(surface.data(), parentSurface.data()));
+    QVERIFY(!subSurface.isNull());
+
+    // the subsurface is opaque and covers the whole main surface
+    Test::render(surface.data(), QSize(100, 50), Qt::red, QImage::Format_RGB32);
+    Window *window = Test::renderAndWaitForShown(parentSurface.data(), QSize(100, 50), Qt::blue, QImage::Format_RGB32);
+    QVERIFY(window);
+
+    QSignalSpy frameRenderedSpy(Compositor::self()->scene(), &Scene::frameRendered);
+    QVERIFY(frameRenderedSpy.isValid());
+    Compositor::self()->scene()->addRepaintFull();
+    QVERIFY(frameRenderedSpy.wait());
+
+    // the frame callback must arrive with the next frame, not after the occluded window interval
+    QVERIFY(options->occludedFrameCallbackInterval() > 500);
+    QSignalSpy frameCallbackSpy(parentSurface.data(), &KWayland::Client::Surface::frameRendered);
+    QVERIFY(frameCallbackSpy.isValid());
+    parentSurface->commit(KWayland::Client::Surface::CommitFlag::FrameCallback);
+    Compositor::self()->scene()->addRepaintFull();
+    QVERIFY(frameCallbackSpy.wait(500));
+}
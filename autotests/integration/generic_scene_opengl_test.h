@@ -23,6 +23,7 @@ private Q_SLOTS:
     void initTestCase();
     void cleanup();
     void testRestart();
+    void testOpaqueSubSurfaceFrameCallback();
 
 private:
     QByteArray m_envVariable;
@@ -0,0 +1,105 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+
+#include "platform.h"
+#include "surfaceitem.h"
+#include "wayland_server.h"
+#include "window.h"
+#include "windowitem.h"
+#include "workspace.h"
+
+#include <KWayland/Client/surface.h>
+
+using namespace KWin;
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_item-0");
+
+class ItemTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void testMapToGlobal();
+    void benchmarkMapToGlobal_data();
+    void benchmarkMapToGlobal();
+};
+
+void ItemTest::initTestCase()
+{
+    qRegisterMetaType<KWin::Window *>();
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    Test::initWaylandWorkspace();
+}
+
+void ItemTest::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+}
+
+void ItemTest::cleanup()
+{
+    Test::destroyWaylandConnection();
+}
+
+void ItemTest::testMapToGlobal()
+{
+    QScopedPointer<KWayland::Client::Surface> surface(Test::createSurface());
+    QScopedPointer<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.data()));
+    Window *window = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(window);
+    window->move(QPoint(42, 24));
+
+    SurfaceItem *item = window->surfaceItem();
+    QVERIFY(item);
+    const QPoint origin = window->bufferGeometry().topLeft();
+    QCOMPARE(item->mapToGlobal(QRect(0, 0, 10, 10)), QRect(origin, QSize(10, 10)));
+    QCOMPARE(item->mapToGlobal(QRegion(0, 0, 10, 10) + QRegion(20, 20, 5, 5)),
+             QRegion(QRect(origin, QSize(10, 10))) + QRegion(QRect(origin + QPoint(20, 20), QSize(5, 5))));
+    QCOMPARE(item->mapToGlobal(QRegion()), QRegion());
+}
+
+void ItemTest::benchmarkMapToGlobal_data()
+{
+    QTest::addColumn<QRegion>("region");
+
+    QTest::newRow("rect") << QRegion(0, 0, 100, 50);
+
+    QRegion fragmented;
+    for (int i = 0; i < 50; ++i) {
+        fragmented += QRect((i * 7) % 90, i, 10, 1);
+    }
+    QTest::newRow("fragmented") << fragmented;
+}
+
+void ItemTest::benchmarkMapToGlobal()
+{
+    QFETCH(QRegion, region);
+
+    QScopedPointer<KWayland::Client::Surface> surface(Test::createSurface());
+    QScopedPointer<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.data()));
+    Window *window = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(window);
+
+    SurfaceItem *item = window->surfaceItem();
+    QVERIFY(item);
+    QBENCHMARK {
+        item->mapToGlobal(region);
+    }
+}
+
+WAYLANDTEST_MAIN(ItemTest)
+#include "item_test.moc"
@@ -0,0 +1,383 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+
+#include "composite.h"
+#include "effectloader.h"
+#include "effects.h"
+#include "output.h"
+#include "platform.h"
+#include "renderbackend.h"
+#include "renderloop.h"
+#include "renderloop_p.h"
+#include "scene.h"
+#include "wayland_server.h"
+#include "window.h"
+#include "workspace.h"
+
+#include <KWayland/Client/shm_pool.h>
+#include <KWayland/Client/surface.h>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QRasterWindow>
+#include <QTimer>
+#include <QtMath>
+
+#include <functional>
+
+using namespace KWin;
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_bench-0");
+
+/**
+ * Records the CPU and GPU render time of every frame presented on an output while a scenario
+ * runs. The per frame action of the scenario is invoked after every presented frame.
+ */
+class FrameRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FrameRecorder(RenderLoop *loop)
+        : m_loop(loop)
+    {
+    }
+
+    bool run(int frameCount, const std::function<void(int frame)> &action)
+    {
+        QEventLoop eventLoop;
+        connect(m_loop, &RenderLoop::framePresented, this, [this, frameCount, &eventLoop]() {
+            const RenderLoopPrivate *d = RenderLoopPrivate::get(m_loop);
+            m_cpuRenderTimes.append(d->cpuRenderTime);
+            m_gpuRenderTimes.append(d->gpuRenderTime);
+            if (m_cpuRenderTimes.count() == frameCount) {
+                eventLoop.quit();
+            }
+        });
+        // The action may need to wait for the client, so it must not run within the frame.
+        connect(m_loop, &RenderLoop::framePresented, this, [this, &action]() {
+            action(m_cpuRenderTimes.count());
+        }, Qt::QueuedConnection);
+
+        // Frames are at most 1/60 s apart, give slow software rendering plenty of slack.
+        QTimer::singleShot(std::chrono::seconds(10) + frameCount * std::chrono::milliseconds(100), &eventLoop, &QEventLoop::quit);
+        action(0);
+        eventLoop.exec();
+        disconnect(m_loop, nullptr, this, nullptr);
+        return m_cpuRenderTimes.count() >= frameCount;
+    }
+
+    QJsonObject report() const
+    {
+        return QJsonObject{
+            {QStringLiteral("frames"), m_cpuRenderTimes.count()},
+            {QStringLiteral("cpuRenderTime"), statistics(m_cpuRenderTimes)},
+            {QStringLiteral("gpuRenderTime"), statistics(m_gpuRenderTimes)},
+        };
+    }
+
+private:
+    static QJsonObject statistics(QVector<std::chrono::nanoseconds> samples)
+    {
+        if (samples.isEmpty()) {
+            return QJsonObject();
+        }
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](int percentile) {
+            const int rank = std::max(1, qCeil(samples.count() * percentile / 100.0));
+            return qint64(std::chrono::duration_cast<std::chrono::microseconds>(samples[rank - 1]).count());
+        };
+        return QJsonObject{
+            {QStringLiteral("p50"), percentile(50)},
+            {QStringLiteral("p90"), percentile(90)},
+            {QStringLiteral("p99"), percentile(99)},
+            {QStringLiteral("max"), percentile(100)},
+        };
+    }
+
+    RenderLoop *m_loop;
+    QVector<std::chrono::nanoseconds> m_cpuRenderTimes;
+    QVector<std::chrono::nanoseconds> m_gpuRenderTimes;
+};
+
+class BlurredWindow : public QRasterWindow
+{
+    Q_OBJECT
+
+public:
+    BlurredWindow()
+    {
+        setFlags(Qt::FramelessWindowHint);
+        // An empty region blurs behind the whole window.
+        setProperty("kwin_blur", QVariant::fromValue(QRegion()));
+    }
+
+protected:
+    void paintEvent(QPaintEvent *event) override
+    {
+        Q_UNUSED(event)
+        QPainter p(this);
+        p.setCompositionMode(QPainter::CompositionMode_Source);
+        p.fillRect(0, 0, width(), height(), QColor(255, 255, 255, 64));
+    }
+};
+
+class KWinBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void cleanupTestCase();
+
+    void benchmarkIdle();
+    void benchmarkClientDamage_data();
+    void benchmarkClientDamage();
+    void benchmarkWindowStorm();
+    void benchmarkMove();
+    void benchmarkOverview();
+    void benchmarkBlur_data();
+    void benchmarkBlur();
+
+private:
+    struct TestWindow
+    {
+        std::unique_ptr<KWayland::Client::Surface> surface;
+        std::unique_ptr<Test::XdgToplevel> shellSurface;
+    };
+
+    bool record(const std::function<void(int frame)> &action);
+    std::unique_ptr<TestWindow> createWindow(const QSize &size, const QColor &color);
+
+    RenderLoop *m_renderLoop = nullptr;
+    int m_frameCount = 300;
+    QJsonArray m_results;
+};
+
+void KWinBenchmark::initTestCase()
+{
+    qputenv("XDG_DATA_DIRS", QCoreApplication::applicationDirPath().toUtf8());
+
+    qRegisterMetaType<KWin::Window *>();
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1920, 1080));
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    // Only the scenarios load the effects that they need.
+    auto config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    KConfigGroup plugins(config, QStringLiteral("Plugins"));
+    const auto builtinNames = EffectLoader().listOfKnownEffects();
+    for (const QString &name : builtinNames) {
+        plugins.writeEntry(name + QStringLiteral("Enabled"), false);
+    }
+    config->sync();
+    kwinApp()->setConfig(config);
+
+    qputenv("KWIN_COMPOSE", QByteArrayLiteral("O2"));
+    qputenv("KWIN_EFFECTS_FORCE_ANIMATIONS", QByteArrayLiteral("1"));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    Test::initWaylandWorkspace();
+
+    QCOMPARE(Compositor::self()->backend()->compositingType(), KWin::OpenGLCompositing);
+    m_renderLoop = kwinApp()->platform()->enabledOutputs().constFirst()->renderLoop();
+
+    if (const int frameCount = qEnvironmentVariableIntValue("KWIN_BENCH_FRAMES"); frameCount > 0) {
+        m_frameCount = frameCount;
+    }
+}
+
+void KWinBenchmark::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+}
+
+void KWinBenchmark::cleanup()
+{
+    auto effectsImpl = qobject_cast<EffectsHandlerImpl *>(effects);
+    QVERIFY(effectsImpl);
+    effectsImpl->unloadAllEffects();
+
+    Test::destroyWaylandConnection();
+}
+
+void KWinBenchmark::cleanupTestCase()
+{
+    const QByteArray report = QJsonDocument(QJsonObject{{QStringLiteral("results"), m_results}}).toJson();
+
+    // The report is written to stdout unless a file is requested.
+    const QString fileName = qEnvironmentVariable("KWIN_BENCH_OUTPUT");
+    QFile file;
+    if (fileName.isEmpty()) {
+        QVERIFY(file.open(stdout, QIODevice::WriteOnly));
+    } else {
+        file.setFileName(fileName);
+        QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    }
+    file.write(report);
+}
+
+bool KWinBenchmark::record(const std::function<void(int frame)> &action)
+{
+    FrameRecorder recorder(m_renderLoop);
+    const bool finished = recorder.run(m_frameCount, action);
+
+    QJsonObject result = recorder.report();
+    QString scenario = QString::fromLatin1(QTest::currentTestFunction());
+    if (const char *tag = QTest::currentDataTag()) {
+        scenario += QLatin1Char('/') + QString::fromLatin1(tag);
+    }
+    result.insert(QStringLiteral("scenario"), scenario);
+    m_results.append(result);
+    return finished;
+}
+
+std::unique_ptr<KWinBenchmark::TestWindow> KWinBenchmark::createWindow(const QSize &size, const QColor &color)
+{
+    auto window = std::make_unique<TestWindow>();
+    window->surface.reset(Test::createSurface());
+    window->shellSurface.reset(Test::createXdgToplevelSurface(window->surface.get()));
+    Test::render(window->surface.get(), size, color);
+    return window;
+}
+
+void KWinBenchmark::benchmarkIdle()
+{
+    // Repaints the empty workspace, this is the baseline of every other scenario.
+    QVERIFY(record([](int) {
+        Compositor::self()->scene()->addRepaintFull();
+    }));
+}
+
+void KWinBenchmark::benchmarkClientDamage_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<QRect>("damage");
+
+    QTest::newRow("small-full") << QSize(256, 256) << QRect(0, 0, 256, 256);
+    QTest::newRow("small-partial") << QSize(256, 256) << QRect(96, 96, 64, 64);
+    QTest::newRow("fullscreen-full") << QSize(1920, 1080) << QRect(0, 0, 1920, 1080);
+    QTest::newRow("fullscreen-partial") << QSize(1920, 1080) << QRect(928, 508, 64, 64);
+}
+
+void KWinBenchmark::benchmarkClientDamage()
+{
+    // A shm client that repaints the given area of its window every frame, like a video
+    // player or a blinking text cursor.
+    QFETCH(QSize, size);
+    QFETCH(QRect, damage);
+
+    std::unique_ptr<TestWindow> window = createWindow(size, Qt::blue);
+    QVERIFY(Test::waitForWaylandWindowShown());
+
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::blue);
+    QVERIFY(record([&](int frame) {
+        image.fill(QColor::fromHsv(frame % 360, 255, 255));
+        window->surface->attachBuffer(Test::waylandShmPool()->createBuffer(image));
+        window->surface->damage(damage);
+        window->surface->commit(KWayland::Client::Surface::CommitFlag::None);
+    }));
+}
+
+void KWinBenchmark::benchmarkWindowStorm()
+{
+    // Maps a new window every frame and unmaps the oldest one once ten windows are shown.
+    std::vector<std::unique_ptr<TestWindow>> windows;
+    QVERIFY(record([&](int frame) {
+        windows.push_back(createWindow(QSize(400 + frame % 7 * 50, 300 + frame % 5 * 50), Qt::red));
+        if (windows.size() > 10) {
+            windows.erase(windows.begin());
+        }
+    }));
+}
+
+void KWinBenchmark::benchmarkMove()
+{
+    // Moves a window along a circle, as if it were dragged around with the pointer.
+    std::unique_ptr<TestWindow> testWindow = createWindow(QSize(800, 600), Qt::blue);
+    Window *window = Test::waitForWaylandWindowShown();
+    QVERIFY(window);
+
+    QVERIFY(record([window](int frame) {
+        const qreal angle = qDegreesToRadians(qreal(frame * 4));
+        window->move(QPoint(560 + 300 * qCos(angle), 240 + 200 * qSin(angle)));
+    }));
+}
+
+void KWinBenchmark::benchmarkOverview()
+{
+    // Opens and closes the overview over ten windows, half a second each.
+    auto effectsImpl = qobject_cast<EffectsHandlerImpl *>(effects);
+    if (!effectsImpl->loadEffect(QStringLiteral("overview"))) {
+        QSKIP("The overview effect is not available");
+    }
+    Effect *overview = effectsImpl->findEffect(QStringLiteral("overview"));
+    QVERIFY(overview);
+
+    std::vector<std::unique_ptr<TestWindow>> windows;
+    for (int i = 0; i < 10; ++i) {
+        windows.push_back(createWindow(QSize(640, 480), QColor::fromHsv(i * 36, 255, 255)));
+        QVERIFY(Test::waitForWaylandWindowShown());
+    }
+
+    QVERIFY(record([overview](int frame) {
+        if (frame % 30 == 0) {
+            QMetaObject::invokeMethod(overview, "toggle");
+        }
+        Compositor::self()->scene()->addRepaintFull();
+    }));
+}
+
+void KWinBenchmark::benchmarkBlur_data()
+{
+    QTest::addColumn<int>("blurredWindowCount");
+
+    QTest::newRow("1") << 1;
+    QTest::newRow("4") << 4;
+    QTest::newRow("8") << 8;
+}
+
+void KWinBenchmark::benchmarkBlur()
+{
+    // Stacks translucent blurred windows over a client that repaints every frame, so the
+    // blur has to be computed from scratch every frame.
+    auto effectsImpl = qobject_cast<EffectsHandlerImpl *>(effects);
+    if (!effectsImpl->loadEffect(QStringLiteral("blur"))) {
+        QSKIP("The blur effect is not supported");
+    }
+
+    std::unique_ptr<TestWindow> window = createWindow(QSize(1920, 1080), Qt::blue);
+    QVERIFY(Test::waitForWaylandWindowShown());
+
+    QFETCH(int, blurredWindowCount);
+    std::vector<std::unique_ptr<BlurredWindow>> blurredWindows;
+    for (int i = 0; i < blurredWindowCount; ++i) {
+        auto blurredWindow = std::make_unique<BlurredWindow>();
+        blurredWindow->setGeometry(100 + i * 80, 100 + i * 60, 800, 600);
+        blurredWindow->show();
+        blurredWindows.push_back(std::move(blurredWindow));
+    }
+    QTRY_COMPARE(workspace()->internalWindows().count(), blurredWindowCount);
+
+    QImage image(QSize(1920, 1080), QImage::Format_ARGB32_Premultiplied);
+    QVERIFY(record([&](int frame) {
+        image.fill(QColor::fromHsv(frame % 360, 255, 255));
+        Test::render(window->surface.get(), image);
+    }));
+}
+
+WAYLANDTEST_MAIN(KWinBenchmark)
+#include "kwin_bench.moc"
@@ -11,6 +11,7 @@
 #include "composite.h"
 #include "effects.h"
 #include "inputmethod.h"
+#include "performance_recorder.h"
 #include "platform.h"
 #include "pluginmanager.h"
 #include "utils/xcbutils.h"
@@ -80,6 +81,7 @@ WaylandTestApplication::WaylandTestApplication(OperationMode mode, int &argc, ch
 WaylandTestApplication::~WaylandTestApplication()
 {
     setTerminating();
+    m_performanceRecorder.reset();
     // need to unload all effects prior to destroying X connection as they might do X calls
     // also before destroy Workspace, as effects might call into Workspace
     if (effects) {
@@ -173,6 +175,11 @@ void WaylandTestApplication::continueStartupWithScene()
 
     createWorkspace();
 
+    // opt-in timing of key operations, to spot performance regressions in the test runs
+    if (qEnvironmentVariableIsSet("KWIN_TEST_PERFORMANCE_LOG")) {
+        m_performanceRecorder.reset(new Test::PerformanceRecorder(qEnvironmentVariable("KWIN_TEST_PERFORMANCE_LOG")));
+    }
+
     if (!waylandServer()->start()) {
         qFatal("Failed to initialize the Wayland server, exiting now");
     }
@@ -65,6 +65,7 @@ class Xwayland;
 
 namespace Test
 {
+class PerformanceRecorder;
 class VirtualInputDevice;
 }
 
@@ -101,6 +102,7 @@ private:
     QScopedPointer<Test::VirtualInputDevice> m_virtualPointer;
     QScopedPointer<Test::VirtualInputDevice> m_virtualKeyboard;
     QScopedPointer<Test::VirtualInputDevice> m_virtualTouch;
+    QScopedPointer<Test::PerformanceRecorder> m_performanceRecorder;
 };
 
 namespace Test
@@ -48,6 +48,7 @@ private Q_SLOTS:
     void cleanup();
     void testMove();
     void testResize();
+    void testResizePacing();
     void testPackTo_data();
     void testPackTo();
     void testPackAgainstClient_data();
@@ -316,6 +317,64 @@ void MoveResizeWindowTest::testResize()
     QVERIFY(Test::waitForWindowDestroyed(window));
 }
 
+void MoveResizeWindowTest::testResizePacing()
+{
+    // this test verifies that only one resize configure event is in flight during interactive
+    // resize and that the intermediate sizes are skipped if the client is lagging behind
+
+    QScopedPointer<KWayland::Client::Surface> surface(Test::createSurface());
+    QScopedPointer<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.data()));
+    Window *window = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(window);
+    QCOMPARE(workspace()->activeWindow(), window);
+    QCOMPARE(window->frameGeometry(), QRect(0, 0, 100, 50));
+
+    QSignalSpy toplevelConfigureRequestedSpy(shellSurface.data(), &Test::XdgToplevel::configureRequested);
+    QVERIFY(toplevelConfigureRequestedSpy.isValid());
+    QSignalSpy surfaceConfigureRequestedSpy(shellSurface->xdgSurface(), &Test::XdgSurface::configureRequested);
+    QVERIFY(surfaceConfigureRequestedSpy.isValid());
+    QSignalSpy frameGeometryChangedSpy(window, &Window::frameGeometryChanged);
+    QVERIFY(frameGeometryChangedSpy.isValid());
+
+    // begin resize
+    workspace()->slotWindowResize();
+    QCOMPARE(workspace()->moveResizeWindow(), window);
+    QVERIFY(surfaceConfigureRequestedSpy.wait());
+    const int initialConfigureCount = surfaceConfigureRequestedSpy.count();
+
+    // the first step is sent to the client right away
+    window->keyPressEvent(Qt::Key_Right);
+    window->updateInteractiveMoveResize(Cursors::self()->mouse()->pos());
+    QVERIFY(surfaceConfigureRequestedSpy.wait());
+    QCOMPARE(surfaceConfigureRequestedSpy.count(), initialConfigureCount + 1);
+    QCOMPARE(toplevelConfigureRequestedSpy.last().at(0).toSize(), QSize(108, 50));
+    const quint32 serial = surfaceConfigureRequestedSpy.last().at(0).value<quint32>();
+
+    // the next steps have to wait until the client has caught up with the first one
+    window->keyPressEvent(Qt::Key_Right);
+    window->updateInteractiveMoveResize(Cursors::self()->mouse()->pos());
+    window->keyPressEvent(Qt::Key_Right);
+    window->updateInteractiveMoveResize(Cursors::self()->mouse()->pos());
+    QVERIFY(!surfaceConfigureRequestedSpy.wait(100));
+    QCOMPARE(surfaceConfigureRequestedSpy.count(), initialConfigureCount + 1);
+
+    // once the client renders the first size, only the latest size is requested
+    shellSurface->xdgSurface()->ack_configure(serial);
+    Test::render(surface.data(), QSize(108, 50), Qt::blue);
+    QVERIFY(frameGeometryChangedSpy.wait());
+    QCOMPARE(window->frameGeometry(), QRect(0, 0, 108, 50));
+    QVERIFY(surfaceConfigureRequestedSpy.wait());
+    QCOMPARE(surfaceConfigureRequestedSpy.count(), initialConfigureCount + 2);
+    QCOMPARE(toplevelConfigureRequestedSpy.last().at(0).toSize(), QSize(124, 50));
+
+    // finish the resize operation
+    window->keyPressEvent(Qt::Key_Enter);
+    QCOMPARE(workspace()->moveResizeWindow(), nullptr);
+
+    shellSurface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(window));
+}
+
 void MoveResizeWindowTest::testPackTo_data()
 {
     QTest::addColumn<QString>("methodCall");
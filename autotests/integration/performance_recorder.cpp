@@ -0,0 +1,159 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "performance_recorder.h"
+
+#include "main.h"
+#include "output.h"
+#include "platform.h"
+#include "renderloop.h"
+#include "window.h"
+#include "workspace.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTest>
+
+#include <algorithm>
+#include <numeric>
+
+namespace KWin
+{
+namespace Test
+{
+
+PerformanceRecorder::PerformanceRecorder(const QString &fileName, QObject *parent)
+    : QObject(parent)
+    , m_fileName(fileName)
+{
+    FTraceLogger::self()->setBufferEnabled(true);
+    connect(FTraceLogger::self(), &FTraceLogger::spanFinished, this, &PerformanceRecorder::handleSpanFinished);
+    connect(FTraceLogger::self(), &FTraceLogger::flowRecorded, this, &PerformanceRecorder::handleFlowRecorded);
+
+    connect(workspace(), &Workspace::windowAdded, this, &PerformanceRecorder::handleWindowAdded);
+
+    const QVector<Output *> outputs = kwinApp()->platform()->outputs();
+    for (Output *output : outputs) {
+        addOutput(output);
+    }
+    connect(kwinApp()->platform(), &Platform::outputAdded, this, &PerformanceRecorder::addOutput);
+}
+
+PerformanceRecorder::~PerformanceRecorder()
+{
+    writeSamples();
+}
+
+void PerformanceRecorder::addSample(const QByteArray &operation, std::chrono::nanoseconds duration)
+{
+    const QByteArray testFunction = QTest::currentTestFunction() ? QByteArray(QTest::currentTestFunction()) : QByteArray();
+    m_samples[testFunction][operation].append(duration.count());
+}
+
+void PerformanceRecorder::addOutput(Output *output)
+{
+    connect(output->renderLoop(), &RenderLoop::framePresented, this, &PerformanceRecorder::handleFramePresented);
+}
+
+void PerformanceRecorder::handleSpanFinished(const QByteArray &name, std::chrono::nanoseconds duration)
+{
+    if (name == QByteArrayLiteral("Update stacking order")) {
+        addSample(QByteArrayLiteral("update_stacking_order"), duration);
+    } else if (name.startsWith(QByteArrayLiteral("Paint ("))) {
+        addSample(QByteArrayLiteral("composite"), duration);
+    }
+}
+
+void PerformanceRecorder::handleFlowRecorded(const QByteArray &name, quint64 id, FTraceLogger::FlowPhase phase)
+{
+    if (name != QByteArrayLiteral("Configure")) {
+        return;
+    }
+    switch (phase) {
+    case FTraceLogger::FlowPhase::Begin:
+        m_pendingConfigures.insert(id, std::chrono::steady_clock::now());
+        break;
+    case FTraceLogger::FlowPhase::End: {
+        // an ack also confirms the configure events sent before, only the acked one is timed
+        const auto it = m_pendingConfigures.find(id);
+        if (it != m_pendingConfigures.end()) {
+            addSample(QByteArrayLiteral("configure_round_trip"), std::chrono::steady_clock::now() - it.value());
+            m_pendingConfigures.erase(it);
+        }
+        break;
+    }
+    case FTraceLogger::FlowPhase::Step:
+        break;
+    }
+}
+
+void PerformanceRecorder::handleWindowAdded(Window *window)
+{
+    m_pendingMaps.insert(window, std::chrono::steady_clock::now());
+    connect(window, &QObject::destroyed, this, [this, window]() {
+        m_pendingMaps.remove(window);
+    });
+}
+
+void PerformanceRecorder::handleFramePresented(RenderLoop *loop)
+{
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = m_pendingMaps.begin(); it != m_pendingMaps.end();) {
+        Output *output = it.key()->output();
+        if (output && output->renderLoop() == loop) {
+            addSample(QByteArrayLiteral("map_to_first_frame"), now - it.value());
+            it = m_pendingMaps.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void PerformanceRecorder::writeSamples()
+{
+    if (m_samples.isEmpty()) {
+        return;
+    }
+
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qWarning() << "Failed to open" << m_fileName << "to write the performance samples:" << file.errorString();
+        return;
+    }
+
+    const QString testName = QFileInfo(QCoreApplication::applicationFilePath()).baseName();
+    const auto toMicroseconds = [](qint64 nanoseconds) {
+        return double(nanoseconds) / 1000;
+    };
+
+    for (auto testFunction = m_samples.constBegin(); testFunction != m_samples.constEnd(); ++testFunction) {
+        for (auto operation = testFunction->constBegin(); operation != testFunction->constEnd(); ++operation) {
+            QVector<qint64> durations = operation.value();
+            std::sort(durations.begin(), durations.end());
+            const qint64 total = std::accumulate(durations.constBegin(), durations.constEnd(), qint64(0));
+
+            const QJsonObject object{
+                {QStringLiteral("test"), testName},
+                {QStringLiteral("function"), QString::fromUtf8(testFunction.key())},
+                {QStringLiteral("operation"), QString::fromUtf8(operation.key())},
+                {QStringLiteral("count"), durations.count()},
+                {QStringLiteral("min_us"), toMicroseconds(durations.constFirst())},
+                {QStringLiteral("median_us"), toMicroseconds(durations[durations.count() / 2])},
+                {QStringLiteral("p95_us"), toMicroseconds(durations[std::min(durations.count() - 1, durations.count() * 95 / 100)])},
+                {QStringLiteral("max_us"), toMicroseconds(durations.constLast())},
+                {QStringLiteral("total_us"), toMicroseconds(total)},
+            };
+            file.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+            file.write("\n");
+        }
+    }
+}
+
+} // namespace Test
+} // namespace KWin
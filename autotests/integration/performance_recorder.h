@@ -0,0 +1,67 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include "ftrace.h"
+
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QVector>
+
+#include <chrono>
+
+namespace KWin
+{
+class Output;
+class RenderLoop;
+class Window;
+
+namespace Test
+{
+
+/**
+ * The PerformanceRecorder collects the timings of key operations while the integration
+ * tests run, so performance regressions show up in the regular test runs:
+ *
+ * @li map_to_first_frame: a window got added until its output presented the next frame
+ * @li configure_round_trip: an xdg-shell configure event got sent until the client acked it
+ * @li update_stacking_order: Workspace::updateStackingOrder()
+ * @li composite: painting one frame of an output in Compositor::composite()
+ *
+ * The samples are grouped by the test function that was running. When the test finishes,
+ * one JSON object per test function and operation with the sample statistics is appended
+ * as a line to the file named by the KWIN_TEST_PERFORMANCE_LOG environment variable.
+ *
+ * The spans and flows are taken from the FTraceLogger, whose ring buffer is enabled.
+ */
+class PerformanceRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PerformanceRecorder(const QString &fileName, QObject *parent = nullptr);
+    ~PerformanceRecorder() override;
+
+private:
+    void addSample(const QByteArray &operation, std::chrono::nanoseconds duration);
+    void addOutput(Output *output);
+    void handleSpanFinished(const QByteArray &name, std::chrono::nanoseconds duration);
+    void handleFlowRecorded(const QByteArray &name, quint64 id, FTraceLogger::FlowPhase phase);
+    void handleWindowAdded(Window *window);
+    void handleFramePresented(RenderLoop *loop);
+    void writeSamples();
+
+    QString m_fileName;
+    // test function -> operation -> durations in nanoseconds
+    QMap<QByteArray, QMap<QByteArray, QVector<qint64>>> m_samples;
+    QHash<quint64, std::chrono::steady_clock::time_point> m_pendingConfigures;
+    QHash<Window *, std::chrono::steady_clock::time_point> m_pendingMaps;
+};
+
+} // namespace Test
+} // namespace KWin
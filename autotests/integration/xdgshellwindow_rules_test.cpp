@@ -16,6 +16,7 @@
 #include "outputconfiguration.h"
 #include "platform.h"
 #include "rules.h"
+#include "rulesettings.h"
 #include "virtualdesktops.h"
 #include "wayland_server.h"
 #include "window.h"
@@ -155,6 +156,8 @@ private Q_SLOTS:
 
     void testMatchAfterNameChange();
 
+    void benchmarkMatch();
+
 private:
     void createTestWindow(ClientFlags flags = None);
     void mapClientToSurface(QSize clientSize, ClientFlags flags = None);
@@ -3001,5 +3004,41 @@ void TestXdgShellWindowRules::testMatchAfterNameChange()
     QCOMPARE(window->keepAbove(), true);
 }
 
+void TestXdgShellWindowRules::benchmarkMatch()
+{
+    QScopedPointer<KWayland::Client::Surface> surface(Test::createSurface());
+    QScopedPointer<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.data()));
+    shellSurface->set_app_id(QStringLiteral("org.kde.foo"));
+    shellSurface->set_title(QStringLiteral("Untitled - Editor"));
+    auto window = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(window);
+
+    // A rule set of a heavily customized desktop, only the last rule matches the window.
+    static const Rules::StringMatch matchTypes[] = {Rules::ExactMatch, Rules::SubstringMatch, Rules::RegExpMatch};
+    const int ruleCount = 50;
+    std::vector<std::unique_ptr<Rules>> rules;
+    for (int i = 0; i < ruleCount; ++i) {
+        const bool last = i == ruleCount - 1;
+        KConfigGroup group = m_config->group(QStringLiteral("benchmark%1").arg(i));
+        group.writeEntry("wmclass", last ? QStringLiteral("org.kde.foo") : QStringLiteral("org.kde.app%1").arg(i));
+        group.writeEntry("wmclassmatch", int(last ? Rules::ExactMatch : matchTypes[i % 3]));
+        group.writeEntry("title", last ? QStringLiteral("Editor$") : QStringLiteral("Document %1").arg(i));
+        group.writeEntry("titlematch", int(last ? Rules::RegExpMatch : matchTypes[(i + 1) % 3]));
+        group.writeEntry("types", int(NET::NormalMask));
+
+        RuleSettings settings(m_config, group.name());
+        rules.push_back(std::make_unique<Rules>(&settings));
+    }
+
+    int matched = 0;
+    QBENCHMARK {
+        matched = 0;
+        for (const auto &rule : rules) {
+            matched += rule->match(window);
+        }
+    }
+    QCOMPARE(matched, 1);
+}
+
 WAYLANDTEST_MAIN(TestXdgShellWindowRules)
 #include "xdgshellwindow_rules_test.moc"
@@ -0,0 +1,113 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <kwingltexture.h>
+
+#include <QSignalSpy>
+#include <QtTest>
+
+using namespace KWin;
+
+class GLMemoryTrackerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void cleanup();
+    void testEstimateSize_data();
+    void testEstimateSize();
+    void testAllocateRelease();
+    void testBudget();
+};
+
+void GLMemoryTrackerTest::cleanup()
+{
+    GLMemoryTracker::self()->setBudget(0);
+}
+
+void GLMemoryTrackerTest::testEstimateSize_data()
+{
+    QTest::addColumn<GLenum>("internalFormat");
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("levels");
+    QTest::addColumn<qint64>("expected");
+
+    QTest::newRow("rgba8") << GLenum(GL_RGBA8) << QSize(100, 50) << 1 << qint64(20000);
+    QTest::newRow("rgb8") << GLenum(GL_RGB8) << QSize(100, 50) << 1 << qint64(20000);
+    QTest::newRow("r8") << GLenum(GL_R8) << QSize(100, 50) << 1 << qint64(5000);
+    QTest::newRow("rgba16f") << GLenum(GL_RGBA16F) << QSize(100, 50) << 1 << qint64(40000);
+    QTest::newRow("mipmapped") << GLenum(GL_RGBA8) << QSize(30, 10) << 4 << qint64(1600);
+    QTest::newRow("empty") << GLenum(GL_RGBA8) << QSize() << 1 << qint64(0);
+}
+
+void GLMemoryTrackerTest::testEstimateSize()
+{
+    QFETCH(GLenum, internalFormat);
+    QFETCH(QSize, size);
+    QFETCH(int, levels);
+
+    QTEST(GLMemoryTracker::estimateSize(internalFormat, size, levels), "expected");
+}
+
+void GLMemoryTrackerTest::testAllocateRelease()
+{
+    GLMemoryTracker *tracker = GLMemoryTracker::self();
+    const qint64 total = tracker->totalUsage();
+
+    tracker->allocate(GLMemoryTracker::Thumbnail, 1000);
+    tracker->allocate(GLMemoryTracker::Thumbnail, 500);
+    tracker->allocate(GLMemoryTracker::Swapchain, 200);
+    QCOMPARE(tracker->usage(GLMemoryTracker::Thumbnail), qint64(1500));
+    QCOMPARE(tracker->allocationCount(GLMemoryTracker::Thumbnail), 2);
+    QCOMPARE(tracker->usage(GLMemoryTracker::Swapchain), qint64(200));
+    QCOMPARE(tracker->totalUsage(), total + 1700);
+
+    const QVariantMap thumbnails = tracker->memoryUsage().value(QStringLiteral("Thumbnail")).toMap();
+    QCOMPARE(thumbnails.value(QStringLiteral("count")).toInt(), 2);
+    QCOMPARE(thumbnails.value(QStringLiteral("bytes")).toLongLong(), qint64(1500));
+
+    tracker->release(GLMemoryTracker::Thumbnail, 1000);
+    tracker->release(GLMemoryTracker::Thumbnail, 500);
+    tracker->release(GLMemoryTracker::Swapchain, 200);
+    QCOMPARE(tracker->usage(GLMemoryTracker::Thumbnail), qint64(0));
+    QCOMPARE(tracker->allocationCount(GLMemoryTracker::Thumbnail), 0);
+    QCOMPARE(tracker->totalUsage(), total);
+}
+
+void GLMemoryTrackerTest::testBudget()
+{
+    GLMemoryTracker *tracker = GLMemoryTracker::self();
+    QSignalSpy evictionSpy(tracker, &GLMemoryTracker::evictionRequested);
+    tracker->setBudget(tracker->totalUsage() + 1000);
+
+    // staying within the budget doesn't evict anything
+    tracker->allocate(GLMemoryTracker::Blur, 1000);
+    QVERIFY(!evictionSpy.wait(50));
+
+    // the eviction is requested from the event loop, once for several allocations
+    connect(tracker, &GLMemoryTracker::evictionRequested, this, [tracker]() {
+        tracker->release(GLMemoryTracker::Blur, 300);
+    });
+    tracker->allocate(GLMemoryTracker::Blur, 300);
+    tracker->allocate(GLMemoryTracker::Blur, 300);
+    QCOMPARE(evictionSpy.count(), 0);
+    QVERIFY(evictionSpy.wait());
+    QCOMPARE(evictionSpy.count(), 1);
+    QCOMPARE(tracker->usage(GLMemoryTracker::Blur), qint64(1300));
+
+    // an explicit eviction is not subject to the budget
+    tracker->evict();
+    QCOMPARE(evictionSpy.count(), 2);
+    QCOMPARE(tracker->usage(GLMemoryTracker::Blur), qint64(1000));
+
+    disconnect(tracker, &GLMemoryTracker::evictionRequested, this, nullptr);
+    tracker->release(GLMemoryTracker::Blur, 1000);
+}
+
+QTEST_MAIN(GLMemoryTrackerTest)
+
+#include "glmemorytrackertest.moc"
@@ -6,6 +6,7 @@
 
     SPDX-License-Identifier: GPL-2.0-or-later
 */
+#include <QMatrix4x4>
 #include <QTest>
 #include <kwineffects.h>
 
@@ -19,6 +20,10 @@ private Q_SLOTS:
     void testMakeGrid();
     void testMakeRegularGrid_data();
     void testMakeRegularGrid();
+    void testRenderGeometry_data();
+    void testRenderGeometry();
+    void benchmarkMakeInterleavedArrays_data();
+    void benchmarkMakeInterleavedArrays();
 
 private:
     KWin::WindowQuad makeQuad(const QRectF &rect);
@@ -207,6 +212,89 @@ void WindowQuadListTest::testMakeRegularGrid()
     }
 }
 
+void WindowQuadListTest::testRenderGeometry_data()
+{
+    QTest::addColumn<uint>("primitiveType");
+    QTest::addColumn<int>("verticesPerQuad");
+
+    QTest::newRow("quads") << uint(0x0007) << 4; // GL_QUADS
+    QTest::newRow("triangles") << uint(0x0004) << 6; // GL_TRIANGLES
+}
+
+void WindowQuadListTest::testRenderGeometry()
+{
+    QFETCH(uint, primitiveType);
+    QFETCH(int, verticesPerQuad);
+
+    KWin::WindowQuadList quads;
+    quads.append(makeQuad(QRectF(0, 0, 10, 10)));
+    quads.append(makeQuad(QRectF(10, 0, 5.5, 10)));
+    quads = quads.makeGrid(4);
+
+    const KWin::RenderGeometry geometry = KWin::RenderGeometry::fromWindowQuadList(quads);
+    QCOMPARE(geometry.count(), quads.count());
+
+    QMatrix4x4 textureMatrix;
+    textureMatrix.scale(0.5, 0.25);
+    textureMatrix.translate(2, 1);
+
+    QVector<KWin::GLVertex2D> expected(quads.count() * verticesPerQuad);
+    QVector<KWin::GLVertex2D> actual(quads.count() * verticesPerQuad);
+    quads.makeInterleavedArrays(primitiveType, expected.data(), textureMatrix);
+    geometry.makeInterleavedArrays(primitiveType, actual.data(), textureMatrix);
+    for (int i = 0; i < expected.count(); ++i) {
+        QCOMPARE(actual[i].position, expected[i].position);
+        QCOMPARE(actual[i].texcoord, expected[i].texcoord);
+    }
+
+    KWin::RenderGeometry subQuads;
+    subQuads.appendSubQuad(quads.first(), 1, 1, 3, 2);
+    const KWin::WindowQuad expectedSubQuad = quads.first().makeSubQuad(1, 1, 3, 2);
+    const KWin::WindowQuad actualSubQuad = subQuads.toWindowQuadList().first();
+    for (int i = 0; i < 4; ++i) {
+        QCOMPARE(actualSubQuad[i].x(), expectedSubQuad[i].x());
+        QCOMPARE(actualSubQuad[i].y(), expectedSubQuad[i].y());
+        QCOMPARE(actualSubQuad[i].u(), expectedSubQuad[i].u());
+        QCOMPARE(actualSubQuad[i].v(), expectedSubQuad[i].v());
+    }
+}
+
+void WindowQuadListTest::benchmarkMakeInterleavedArrays_data()
+{
+    QTest::addColumn<KWin::WindowQuadList>("quads");
+
+    // The contents, the decoration and the shadow of a maximized window
+    KWin::WindowQuadList decorated;
+    decorated.append(makeQuad(QRectF(0, 30, 1920, 1050)));
+    decorated.append(makeQuad(QRectF(0, 0, 1920, 30)));
+    for (const QRectF &shadow : {QRectF(-40, -40, 40, 40), QRectF(0, -40, 1920, 40), QRectF(1920, -40, 40, 40),
+                                 QRectF(1920, 0, 40, 1080), QRectF(1920, 1080, 40, 40), QRectF(0, 1080, 1920, 40),
+                                 QRectF(-40, 1080, 40, 40), QRectF(-40, 0, 40, 1080)}) {
+        decorated.append(makeQuad(shadow));
+    }
+    QTest::newRow("decorated") << decorated;
+
+    // A window that is being deformed by an effect such as wobbly windows
+    KWin::WindowQuadList grid;
+    grid.append(makeQuad(QRectF(0, 0, 1280, 800)));
+    QTest::newRow("grid") << grid.makeRegularGrid(20, 20);
+}
+
+void WindowQuadListTest::benchmarkMakeInterleavedArrays()
+{
+    QFETCH(KWin::WindowQuadList, quads);
+
+    // GL_TRIANGLES, which is what the scene uses
+    const unsigned int primitiveType = 0x0004;
+    QMatrix4x4 textureMatrix;
+    textureMatrix.scale(1.0 / 1920, 1.0 / 1080);
+
+    QVector<KWin::GLVertex2D> vertices(quads.count() * 6);
+    QBENCHMARK {
+        quads.makeInterleavedArrays(primitiveType, vertices.data(), textureMatrix);
+    }
+}
+
 QTEST_MAIN(WindowQuadListTest)
 
 #include "windowquadlisttest.moc"
@@ -0,0 +1,186 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "colors/colorlut.h"
+#include "colors/colorlut3d.h"
+#include "colors/colorpipelinestage.h"
+#include "colors/colortransformation.h"
+
+#include <QTest>
+
+#include <lcms2.h>
+
+using namespace KWin;
+
+class ColorTransformationTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testIdentity();
+    void testPerChannel();
+    void testLut3D();
+    void testBatchedTransform();
+    void benchmarkTransform_data();
+    void benchmarkTransform();
+    void benchmarkBatchedTransform();
+    void benchmarkLut();
+};
+
+static std::unique_ptr<ColorPipelineStage> createToneCurveStage(double gamma, double factor)
+{
+    const double params[] = {gamma, factor, 0.0};
+    cmsToneCurve *curve = cmsBuildParametricToneCurve(nullptr, 2, params);
+    cmsToneCurve *toneCurves[] = {curve, curve, curve};
+    auto stage = std::make_unique<ColorPipelineStage>(cmsStageAllocToneCurves(nullptr, 3, toneCurves));
+    cmsFreeToneCurve(curve);
+    return stage;
+}
+
+// The stages of a typical output: night color, brightness and an ICC calibration curve
+static QSharedPointer<ColorTransformation> createTransformation(int stageCount)
+{
+    std::vector<std::unique_ptr<ColorPipelineStage>> stages;
+    for (int i = 0; i < stageCount; ++i) {
+        stages.push_back(createToneCurveStage(i == stageCount - 1 ? 2.2 : 1.0, 0.9));
+    }
+    return QSharedPointer<ColorTransformation>::create(std::move(stages));
+}
+
+void ColorTransformationTest::testIdentity()
+{
+    std::vector<std::unique_ptr<ColorPipelineStage>> stages;
+    stages.push_back(createToneCurveStage(1.0, 1.0));
+    ColorTransformation transformation(std::move(stages));
+    QVERIFY(transformation.valid());
+
+    for (uint32_t value = 0; value <= 0xffff; value += 0x1111) {
+        const auto [r, g, b] = transformation.transform(value, value, value);
+        QVERIFY(std::abs(int(r) - int(value)) <= 1);
+        QVERIFY(std::abs(int(g) - int(value)) <= 1);
+        QVERIFY(std::abs(int(b) - int(value)) <= 1);
+    }
+}
+
+void ColorTransformationTest::testPerChannel()
+{
+    QVERIFY(createTransformation(3)->isPerChannel());
+
+    // A matrix stage that swaps the red and the blue channel
+    const double matrix[] = {
+        0, 0, 1,
+        0, 1, 0,
+        1, 0, 0,
+    };
+    std::vector<std::unique_ptr<ColorPipelineStage>> stages;
+    stages.push_back(std::make_unique<ColorPipelineStage>(cmsStageAllocMatrix(nullptr, 3, 3, matrix, nullptr)));
+    ColorTransformation transformation(std::move(stages));
+    QVERIFY(transformation.valid());
+    QVERIFY(!transformation.isPerChannel());
+
+    const auto [r, g, b] = transformation.transform(0xffff, 0x8000, 0);
+    QVERIFY(r <= 1);
+    QVERIFY(std::abs(int(g) - 0x8000) <= 1);
+    QVERIFY(b >= 0xfffe);
+}
+
+void ColorTransformationTest::testLut3D()
+{
+    std::vector<std::unique_ptr<ColorPipelineStage>> stages;
+    stages.push_back(createToneCurveStage(1.0, 1.0));
+    const auto transformation = QSharedPointer<ColorTransformation>::create(std::move(stages));
+
+    const size_t size = 5;
+    ColorLUT3D lut(transformation, size);
+    QCOMPARE(lut.size(), size);
+    QCOMPARE(lut.transformation(), transformation);
+
+    // The red coordinate varies fastest, then green, then blue
+    for (size_t b = 0; b < size; ++b) {
+        for (size_t g = 0; g < size; ++g) {
+            for (size_t r = 0; r < size; ++r) {
+                const uint16_t *entry = lut.data() + 3 * ((b * size + g) * size + r);
+                QVERIFY(std::abs(int(entry[0]) - int(r * 0xffff / (size - 1))) <= 1);
+                QVERIFY(std::abs(int(entry[1]) - int(g * 0xffff / (size - 1))) <= 1);
+                QVERIFY(std::abs(int(entry[2]) - int(b * 0xffff / (size - 1))) <= 1);
+            }
+        }
+    }
+}
+
+void ColorTransformationTest::testBatchedTransform()
+{
+    const QSharedPointer<ColorTransformation> transformation = createTransformation(3);
+    QVERIFY(transformation->valid());
+
+    QVector<uint16_t> in;
+    for (uint32_t r = 0; r <= 0xffff; r += 0x3333) {
+        for (uint32_t g = 0; g <= 0xffff; g += 0x3333) {
+            for (uint32_t b = 0; b <= 0xffff; b += 0x3333) {
+                in << r << g << b;
+            }
+        }
+    }
+    QVector<uint16_t> out(in.size());
+    transformation->transform(in.constData(), out.data(), in.size() / 3);
+
+    for (int i = 0; i < in.size(); i += 3) {
+        const auto [r, g, b] = transformation->transform(in[i], in[i + 1], in[i + 2]);
+        QVERIFY(std::abs(int(out[i]) - int(r)) <= 1);
+        QVERIFY(std::abs(int(out[i + 1]) - int(g)) <= 1);
+        QVERIFY(std::abs(int(out[i + 2]) - int(b)) <= 1);
+    }
+}
+
+void ColorTransformationTest::benchmarkTransform_data()
+{
+    QTest::addColumn<int>("stageCount");
+
+    QTest::newRow("1 stage") << 1;
+    QTest::newRow("3 stages") << 3;
+}
+
+void ColorTransformationTest::benchmarkTransform()
+{
+    QFETCH(int, stageCount);
+    const QSharedPointer<ColorTransformation> transformation = createTransformation(stageCount);
+    QVERIFY(transformation->valid());
+
+    uint16_t value = 0;
+    QBENCHMARK {
+        transformation->transform(value, value, value);
+        value += 0x0101;
+    }
+}
+
+void ColorTransformationTest::benchmarkBatchedTransform()
+{
+    const QSharedPointer<ColorTransformation> transformation = createTransformation(3);
+    QVERIFY(transformation->valid());
+
+    QVector<uint16_t> in(3 * 4096);
+    for (int i = 0; i < in.size(); ++i) {
+        in[i] = i * 0x10;
+    }
+    QVector<uint16_t> out(in.size());
+    QBENCHMARK {
+        transformation->transform(in.constData(), out.data(), 4096);
+    }
+}
+
+void ColorTransformationTest::benchmarkLut()
+{
+    const QSharedPointer<ColorTransformation> transformation = createTransformation(3);
+    QVERIFY(transformation->valid());
+
+    // The gamma lut size of most drivers
+    QBENCHMARK {
+        ColorLUT lut(transformation, 4096);
+    }
+}
+
+QTEST_GUILESS_MAIN(ColorTransformationTest)
+#include "test_colortransformation.moc"
@@ -0,0 +1,123 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "utils/compactregion.h"
+
+#include <QTest>
+
+using namespace KWin;
+
+class CompactRegionTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEmpty();
+    void testRects();
+    void testContainedRects();
+    void testTileFallback();
+    void testUniteTiled();
+};
+
+void CompactRegionTest::testEmpty()
+{
+    CompactRegion region;
+    QVERIFY(region.isEmpty());
+    QVERIFY(region.toRegion().isEmpty());
+
+    region += QRect();
+    region += QRegion();
+    QVERIFY(region.isEmpty());
+}
+
+void CompactRegionTest::testRects()
+{
+    CompactRegion region;
+    region += QRect(0, 0, 10, 10);
+    region += QRect(20, 20, 5, 5);
+    QVERIFY(!region.isTiled());
+    QCOMPARE(region.boundingRect(), QRect(0, 0, 25, 25));
+    QCOMPARE(region.toRegion(), QRegion(0, 0, 10, 10) + QRegion(20, 20, 5, 5));
+
+    region.clear();
+    QVERIFY(region.isEmpty());
+    QVERIFY(region.toRegion().isEmpty());
+}
+
+void CompactRegionTest::testContainedRects()
+{
+    CompactRegion region;
+    for (int i = 0; i < CompactRegion::rectCapacity * 2; ++i) {
+        region += QRect(i, i, 1, 1);
+    }
+    // One rect covering all the others must not overflow the rect array
+    region += QRect(0, 0, 100, 100);
+    for (int i = 0; i < CompactRegion::rectCapacity * 2; ++i) {
+        region += QRect(i, 0, 10, 10);
+    }
+    QVERIFY(region.isTiled());
+
+    CompactRegion contained;
+    contained += QRect(0, 0, 100, 100);
+    for (int i = 0; i < CompactRegion::rectCapacity * 2; ++i) {
+        contained += QRect(i, 0, 10, 10);
+    }
+    QVERIFY(!contained.isTiled());
+    QCOMPARE(contained.toRegion(), QRegion(0, 0, 100, 100));
+}
+
+void CompactRegionTest::testTileFallback()
+{
+    QRegion expected;
+    CompactRegion region;
+    for (int i = 0; i < CompactRegion::rectCapacity + 4; ++i) {
+        const QRect rect(i * 100 - 500, i * 50 - 200, 30, 30);
+        region += rect;
+        expected += rect;
+    }
+    QVERIFY(region.isTiled());
+    QCOMPARE(region.boundingRect(), expected.boundingRect());
+
+    // The tiled region covers everything that has been added, rounded up to the tile grid
+    const QRegion actual = region.toRegion();
+    QVERIFY((expected - actual).isEmpty());
+    for (const QRect &rect : actual) {
+        QCOMPARE(rect.x() % CompactRegion::tileSize, 0);
+        QCOMPARE(rect.y() % CompactRegion::tileSize, 0);
+        QCOMPARE(rect.width() % CompactRegion::tileSize, 0);
+        QCOMPARE(rect.height() % CompactRegion::tileSize, 0);
+        QVERIFY(expected.intersects(rect));
+    }
+}
+
+void CompactRegionTest::testUniteTiled()
+{
+    CompactRegion first;
+    CompactRegion second;
+    QRegion expected;
+    for (int i = 0; i < CompactRegion::rectCapacity + 1; ++i) {
+        const QRect a(i * 64, 0, 64, 64);
+        const QRect b(0, 128 + i * 64, 64 * 70, 64);
+        first += a;
+        second += b;
+        expected += a;
+        expected += b;
+    }
+    QVERIFY(first.isTiled());
+    QVERIFY(second.isTiled());
+
+    CompactRegion united = first;
+    united += second;
+    QCOMPARE(united.toRegion(), expected);
+
+    CompactRegion rects;
+    rects += QRect(5000, 5000, 10, 10);
+    rects += first;
+    QCOMPARE(rects.toRegion(), first.toRegion() + QRegion(4992, 4992, 64, 64));
+}
+
+QTEST_GUILESS_MAIN(CompactRegionTest)
+#include "test_compactregion.moc"
@@ -0,0 +1,98 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "utils/damagejournal.h"
+
+#include <QTest>
+
+using namespace KWin;
+
+class DamageJournalTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testAccumulate();
+    void testCapacity();
+    void benchmarkAccumulate_data();
+    void benchmarkAccumulate();
+};
+
+void DamageJournalTest::testAccumulate()
+{
+    DamageJournal journal;
+    journal.add(QRegion(0, 0, 10, 10));
+    journal.add(QRegion(20, 0, 10, 10));
+    journal.add(QRegion(40, 0, 10, 10));
+
+    const QRegion fallback(0, 0, 100, 100);
+    QCOMPARE(journal.accumulate(0, fallback), fallback);
+    QCOMPARE(journal.accumulate(1, fallback), QRegion());
+    QCOMPARE(journal.accumulate(2, fallback), QRegion(40, 0, 10, 10));
+    QCOMPARE(journal.accumulate(3, fallback), QRegion(40, 0, 10, 10) + QRegion(20, 0, 10, 10));
+    QCOMPARE(journal.accumulate(4, fallback), fallback);
+}
+
+void DamageJournalTest::testCapacity()
+{
+    DamageJournal journal;
+    journal.setCapacity(2);
+    journal.add(QRegion(0, 0, 10, 10));
+    journal.add(QRegion(20, 0, 10, 10));
+    journal.add(QRegion(40, 0, 10, 10));
+
+    const QRegion fallback(0, 0, 100, 100);
+    QCOMPARE(journal.accumulate(2, fallback), QRegion(40, 0, 10, 10));
+    QCOMPARE(journal.accumulate(3, fallback), fallback);
+}
+
+void DamageJournalTest::benchmarkAccumulate_data()
+{
+    QTest::addColumn<QVector<QRegion>>("damage");
+
+    // A blinking text cursor and a ticking clock
+    QVector<QRegion> idle;
+    for (int i = 0; i < 10; ++i) {
+        idle.append(i % 2 ? QRegion(612, 344, 2, 18) : QRegion(1820, 1052, 60, 20));
+    }
+    QTest::newRow("idle") << idle;
+
+    // A browser that is being scrolled, with a video playing on the side
+    QVector<QRegion> scrolling;
+    for (int i = 0; i < 10; ++i) {
+        scrolling.append(QRegion(0, 80, 1400, 1000) + QRegion(1440, 200 + i * 2, 480, 270) + QRegion(1600 + i * 20, 40, 16, 16));
+    }
+    QTest::newRow("scrolling") << scrolling;
+
+    // Many small updates spread over the screen, such as a terminal with build output
+    QVector<QRegion> fragmented;
+    for (int i = 0; i < 10; ++i) {
+        QRegion region;
+        for (int line = 0; line < 50; ++line) {
+            region += QRect((line * 37 + i * 11) % 1800, line * 20, 120, 16);
+        }
+        fragmented.append(region);
+    }
+    QTest::newRow("fragmented") << fragmented;
+}
+
+void DamageJournalTest::benchmarkAccumulate()
+{
+    QFETCH(QVector<QRegion>, damage);
+
+    DamageJournal journal;
+    for (const QRegion &region : std::as_const(damage)) {
+        journal.add(region);
+    }
+
+    // The buffer age of triple buffering
+    QBENCHMARK {
+        journal.accumulate(3);
+    }
+}
+
+QTEST_GUILESS_MAIN(DamageJournalTest)
+#include "test_damagejournal.moc"
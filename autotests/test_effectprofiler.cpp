@@ -0,0 +1,76 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "effectprofiler.h"
+
+#include <QTest>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class EffectProfilerTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEmptyHistogram();
+    void testHistogramPercentile();
+    void testHistogramWindow();
+    void testHookIndex();
+};
+
+void EffectProfilerTest::testEmptyHistogram()
+{
+    RollingHistogram histogram;
+    QCOMPARE(histogram.count(), 0);
+    QCOMPARE(histogram.average(), 0ns);
+    QCOMPARE(histogram.percentile(95), 0ns);
+}
+
+void EffectProfilerTest::testHistogramPercentile()
+{
+    RollingHistogram histogram;
+    for (int i = 0; i < 90; ++i) {
+        histogram.add(100us);
+    }
+    for (int i = 0; i < 10; ++i) {
+        histogram.add(2ms);
+    }
+
+    QCOMPARE(histogram.count(), 100);
+    QCOMPARE(histogram.average(), 290us);
+    QVERIFY(histogram.percentile(50) >= 100us);
+    QVERIFY(histogram.percentile(50) <= 150us);
+    QVERIFY(histogram.percentile(95) >= 2ms);
+}
+
+void EffectProfilerTest::testHistogramWindow()
+{
+    RollingHistogram histogram;
+    for (int i = 0; i < 100; ++i) {
+        histogram.add(5ms);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        histogram.add(200us);
+    }
+
+    // The old samples must have been evicted completely.
+    QCOMPARE(histogram.average(), 200us);
+    QVERIFY(histogram.percentile(100) <= 250us);
+
+    histogram.clear();
+    QCOMPARE(histogram.count(), 0);
+}
+
+void EffectProfilerTest::testHookIndex()
+{
+    QCOMPARE(EffectProfiler::hookIndex(Effect::PrePaintScreenHook), 0);
+    QCOMPARE(EffectProfiler::hookIndex(Effect::DrawWindowHook), EffectProfiler::hookCount - 1);
+    QCOMPARE(EffectProfiler::hookName(EffectProfiler::hookIndex(Effect::PaintWindowHook)), QStringLiteral("paintWindow"));
+}
+
+QTEST_GUILESS_MAIN(EffectProfilerTest)
+#include "test_effectprofiler.moc"
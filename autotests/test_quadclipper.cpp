@@ -0,0 +1,142 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "scenes/opengl/quadclipper.h"
+
+#include <QTest>
+
+using namespace KWin;
+
+Q_DECLARE_METATYPE(QRegion)
+
+class QuadClipperTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testClip_data();
+    void testClip();
+    void benchmarkFragmentedRegion();
+    void benchmarkDesktopDamage();
+};
+
+static WindowQuad makeQuad(const QRectF &rect)
+{
+    WindowQuad quad;
+    quad[0] = WindowVertex(rect.topLeft(), QPointF(0, 0));
+    quad[1] = WindowVertex(rect.topRight(), QPointF(1, 0));
+    quad[2] = WindowVertex(rect.bottomRight(), QPointF(1, 1));
+    quad[3] = WindowVertex(rect.bottomLeft(), QPointF(0, 1));
+    return quad;
+}
+
+static WindowQuadList referenceClip(const WindowQuadList &quads, const QRegion &region, const QPoint &offset)
+{
+    WindowQuadList ret;
+    for (const WindowQuad &quad : quads) {
+        for (const QRect &r : region) {
+            const QRectF rf(r.translated(-offset));
+            const QRectF quadRect(QPointF(quad.left(), quad.top()), QPointF(quad.right(), quad.bottom()));
+            const QRectF &intersected = rf.intersected(quadRect);
+            if (intersected.isValid()) {
+                if (quadRect == intersected) {
+                    ret << quad;
+                    break;
+                }
+                ret << quad.makeSubQuad(intersected.left(), intersected.top(), intersected.right(), intersected.bottom());
+            }
+        }
+    }
+    return ret;
+}
+
+static bool compareQuads(const WindowQuadList &a, const WindowQuadList &b)
+{
+    if (a.count() != b.count()) {
+        return false;
+    }
+    for (int i = 0; i < a.count(); ++i) {
+        for (int j = 0; j < 4; ++j) {
+            if (!qFuzzyCompare(a[i][j].x(), b[i][j].x()) || !qFuzzyCompare(a[i][j].y(), b[i][j].y())
+                || !qFuzzyCompare(1 + a[i][j].u(), 1 + b[i][j].u()) || !qFuzzyCompare(1 + a[i][j].v(), 1 + b[i][j].v())) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void QuadClipperTest::testClip_data()
+{
+    QTest::addColumn<QRegion>("region");
+    QTest::addColumn<QPoint>("offset");
+
+    QTest::addRow("inside") << QRegion(0, 0, 1000, 1000) << QPoint(0, 0);
+    QTest::addRow("outside") << QRegion(500, 500, 100, 100) << QPoint(0, 0);
+    QTest::addRow("partial") << QRegion(50, 50, 100, 100) << QPoint(0, 0);
+    QTest::addRow("offset") << QRegion(50, 50, 100, 100) << QPoint(30, 40);
+
+    QRegion bands;
+    bands += QRect(10, 10, 20, 20);
+    bands += QRect(60, 10, 20, 20);
+    bands += QRect(0, 45, 300, 5);
+    bands += QRect(90, 70, 10, 100);
+    QTest::addRow("bands") << bands << QPoint(-5, 7);
+}
+
+void QuadClipperTest::testClip()
+{
+    QFETCH(QRegion, region);
+    QFETCH(QPoint, offset);
+
+    WindowQuadList quads;
+    quads << makeQuad(QRectF(0, 0, 100, 100));
+    quads << makeQuad(QRectF(100, 0, 50.5, 100));
+    quads << makeQuad(QRectF(0, 100, 200, 30));
+
+    const QuadClipper clipper(region);
+    QVERIFY(compareQuads(clipper.clip(quads, offset), referenceClip(quads, region, offset)));
+}
+
+void QuadClipperTest::benchmarkFragmentedRegion()
+{
+    QRegion region;
+    for (int y = 0; y < 1080; y += 20) {
+        for (int x = (y / 20) % 2 * 10; x < 1920; x += 40) {
+            region += QRect(x, y, 15, 15);
+        }
+    }
+
+    WindowQuadList quads;
+    for (int i = 0; i < 16; ++i) {
+        quads << makeQuad(QRectF(i * 100, i * 50, 400, 300));
+    }
+
+    QBENCHMARK {
+        const QuadClipper clipper(region);
+        clipper.clip(quads);
+    }
+}
+
+void QuadClipperTest::benchmarkDesktopDamage()
+{
+    // A blinking text cursor, a ticking clock and a progress bar
+    const QRegion region = QRegion(612, 344, 2, 18) + QRegion(1820, 1052, 60, 20) + QRegion(200, 700, 400, 8);
+
+    // A maximized decorated window and its shadow
+    WindowQuadList quads;
+    quads << makeQuad(QRectF(0, 30, 1920, 1014)) << makeQuad(QRectF(0, 0, 1920, 30));
+    quads << makeQuad(QRectF(-40, -40, 2000, 40)) << makeQuad(QRectF(-40, 1044, 2000, 40));
+    quads << makeQuad(QRectF(-40, 0, 40, 1044)) << makeQuad(QRectF(1920, 0, 40, 1044));
+
+    QBENCHMARK {
+        const QuadClipper clipper(region);
+        clipper.clip(quads);
+    }
+}
+
+QTEST_GUILESS_MAIN(QuadClipperTest)
+#include "test_quadclipper.moc"
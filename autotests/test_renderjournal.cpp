@@ -0,0 +1,81 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "renderjournal.h"
+
+#include <QTest>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class RenderJournalTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEmpty();
+    void testPercentile();
+    void testDecay();
+    void testStandardDeviation();
+};
+
+void RenderJournalTest::testEmpty()
+{
+    RenderJournal journal;
+    QCOMPARE(journal.sampleCount(), 0);
+    QCOMPARE(journal.percentile(95), 0ns);
+    QCOMPARE(journal.standardDeviation(), 0ns);
+}
+
+void RenderJournalTest::testPercentile()
+{
+    RenderJournal journal;
+    for (int i = 0; i < 95; ++i) {
+        journal.add(2ms);
+    }
+    for (int i = 0; i < 5; ++i) {
+        journal.add(10ms);
+    }
+
+    // The slow frames are the most recent ones, so they carry more weight than 5%.
+    QVERIFY(journal.percentile(50) <= 2250us);
+    QVERIFY(journal.percentile(50) >= 2ms);
+    QVERIFY(journal.percentile(99) >= 10ms);
+    QCOMPARE(journal.sampleCount(), 100);
+}
+
+void RenderJournalTest::testDecay()
+{
+    RenderJournal journal;
+    for (int i = 0; i < 10; ++i) {
+        journal.add(20ms);
+    }
+    for (int i = 0; i < 300; ++i) {
+        journal.add(1ms);
+    }
+
+    // Old spikes must fade out of the histogram eventually.
+    QVERIFY(journal.percentile(99) <= 1250us);
+}
+
+void RenderJournalTest::testStandardDeviation()
+{
+    RenderJournal steady;
+    for (int i = 0; i < 100; ++i) {
+        steady.add(4ms);
+    }
+    QCOMPARE(steady.standardDeviation(), 0ns);
+
+    RenderJournal jittery;
+    for (int i = 0; i < 100; ++i) {
+        jittery.add(i % 2 ? 2ms : 6ms);
+    }
+    QVERIFY(jittery.standardDeviation() > 1ms);
+    QVERIFY(jittery.standardDeviation() < 3ms);
+}
+
+QTEST_GUILESS_MAIN(RenderJournalTest)
+#include "test_renderjournal.moc"
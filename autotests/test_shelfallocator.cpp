@@ -0,0 +1,102 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "scenes/opengl/textureatlas.h"
+
+#include <QTest>
+
+using namespace KWin;
+
+class ShelfAllocatorTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testNoOverlap();
+    void testTooBig();
+    void testFull();
+    void testReuse();
+    void testMergeFreeSpans();
+};
+
+void ShelfAllocatorTest::testNoOverlap()
+{
+    ShelfAllocator allocator(QSize(256, 256));
+
+    QVector<QRect> rects;
+    const QSize sizes[] = {QSize(100, 30), QSize(60, 10), QSize(200, 31), QSize(20, 20), QSize(56, 28), QSize(1, 1)};
+    for (const QSize &size : sizes) {
+        const auto rect = allocator.allocate(size);
+        QVERIFY(rect.has_value());
+        QCOMPARE(rect->size(), size);
+        QVERIFY(QRect(QPoint(0, 0), allocator.size()).contains(*rect));
+        for (const QRect &other : qAsConst(rects)) {
+            QVERIFY(!other.intersects(*rect));
+        }
+        rects.append(*rect);
+    }
+}
+
+void ShelfAllocatorTest::testTooBig()
+{
+    ShelfAllocator allocator(QSize(128, 64));
+    QVERIFY(!allocator.allocate(QSize(129, 10)));
+    QVERIFY(!allocator.allocate(QSize(10, 65)));
+    QVERIFY(!allocator.allocate(QSize(0, 10)));
+    QVERIFY(allocator.isEmpty());
+}
+
+void ShelfAllocatorTest::testFull()
+{
+    ShelfAllocator allocator(QSize(64, 64));
+    for (int i = 0; i < 16; ++i) {
+        QVERIFY(allocator.allocate(QSize(16, 16)));
+    }
+    QVERIFY(!allocator.allocate(QSize(16, 16)));
+}
+
+void ShelfAllocatorTest::testReuse()
+{
+    ShelfAllocator allocator(QSize(64, 64));
+    QVector<QRect> rects;
+    for (int i = 0; i < 4; ++i) {
+        rects.append(*allocator.allocate(QSize(64, 16)));
+    }
+    QVERIFY(!allocator.allocate(QSize(64, 16)));
+
+    // Freeing a whole shelf makes its space available for a shelf of a different height
+    allocator.deallocate(rects[1]);
+    const auto rect = allocator.allocate(QSize(32, 12));
+    QVERIFY(rect);
+    QCOMPARE(rect->topLeft(), rects[1].topLeft());
+
+    allocator.deallocate(*rect);
+    allocator.deallocate(rects[0]);
+    allocator.deallocate(rects[2]);
+    allocator.deallocate(rects[3]);
+    QVERIFY(allocator.isEmpty());
+}
+
+void ShelfAllocatorTest::testMergeFreeSpans()
+{
+    ShelfAllocator allocator(QSize(64, 16));
+    const QRect a = *allocator.allocate(QSize(16, 16));
+    const QRect b = *allocator.allocate(QSize(16, 16));
+    const QRect c = *allocator.allocate(QSize(16, 16));
+    const QRect d = *allocator.allocate(QSize(16, 16));
+    Q_UNUSED(a)
+    Q_UNUSED(d)
+
+    allocator.deallocate(c);
+    allocator.deallocate(b);
+
+    const auto merged = allocator.allocate(QSize(32, 16));
+    QVERIFY(merged);
+    QCOMPARE(*merged, QRect(16, 0, 32, 16));
+}
+
+QTEST_GUILESS_MAIN(ShelfAllocatorTest)
+#include "test_shelfallocator.moc"
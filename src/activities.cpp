@@ -13,8 +13,10 @@
 // KDE
 #include <KConfigGroup>
 // Qt
-#include <QDBusInterface>
-#include <QDBusPendingCall>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QFutureWatcher>
 #include <QtConcurrentRun>
 
@@ -23,6 +25,29 @@ namespace KWin
 
 KWIN_SINGLETON_FACTORY(Activities)
 
+/**
+ * Calls @p method on ksmserver without waiting for the reply. A QDBusInterface
+ * would introspect ksmserver synchronously on construction, which stalls the
+ * compositor for as long as ksmserver is busy.
+ */
+static void callKsmserver(QObject *context, const QString &method, const QVariantList &arguments)
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(QStringLiteral("org.kde.ksmserver"),
+                                                          QStringLiteral("/KSMServer"),
+                                                          QStringLiteral("org.kde.KSMServerInterface"),
+                                                          method);
+    message.setArguments(arguments);
+
+    auto watcher = new QDBusPendingCallWatcher(QDBusConnection::sessionBus().asyncCall(message), context);
+    QObject::connect(watcher, &QDBusPendingCallWatcher::finished, context, [method](QDBusPendingCallWatcher *self) {
+        const QDBusPendingReply<> reply = *self;
+        if (reply.isError()) {
+            qCDebug(KWIN_CORE) << "ksmserver call" << method << "failed:" << reply.error().message();
+        }
+        self->deleteLater();
+    });
+}
+
 Activities::Activities(QObject *parent)
     : QObject(parent)
     , m_controller(new KActivities::Controller(this))
@@ -122,13 +147,7 @@ bool Activities::start(const QString &id)
 
     ws->sessionManager()->loadSubSessionInfo(id);
 
-    QDBusInterface ksmserver("org.kde.ksmserver", "/KSMServer", "org.kde.KSMServerInterface");
-    if (ksmserver.isValid()) {
-        ksmserver.asyncCall("restoreSubSession", id);
-    } else {
-        qCDebug(KWIN_CORE) << "couldn't get ksmserver interface";
-        return false;
-    }
+    callKsmserver(this, QStringLiteral("restoreSubSession"), {id});
     return true;
 }
 
@@ -201,12 +220,7 @@ void Activities::reallyStop(const QString &id)
     qCDebug(KWIN_CORE) << "saveActivity" << id << saveAndClose << saveOnly;
 
     // pass off to ksmserver
-    QDBusInterface ksmserver("org.kde.ksmserver", "/KSMServer", "org.kde.KSMServerInterface");
-    if (ksmserver.isValid()) {
-        ksmserver.asyncCall("saveSubSession", id, saveAndClose, saveOnly);
-    } else {
-        qCDebug(KWIN_CORE) << "couldn't get ksmserver interface";
-    }
+    callKsmserver(this, QStringLiteral("saveSubSession"), {id, saveAndClose, saveOnly});
 }
 
 } // namespace
@@ -48,6 +48,9 @@ Atoms::Atoms()
     , kde_net_wm_frame_strut(QByteArrayLiteral("_KDE_NET_WM_FRAME_STRUT"))
     , net_wm_sync_request_counter(QByteArrayLiteral("_NET_WM_SYNC_REQUEST_COUNTER"))
     , net_wm_sync_request(QByteArrayLiteral("_NET_WM_SYNC_REQUEST"))
+    , net_supported(QByteArrayLiteral("_NET_SUPPORTED"))
+    , net_wm_frame_drawn(QByteArrayLiteral("_NET_WM_FRAME_DRAWN"))
+    , net_wm_frame_timings(QByteArrayLiteral("_NET_WM_FRAME_TIMINGS"))
     , kde_net_wm_shadow(QByteArrayLiteral("_KDE_NET_WM_SHADOW"))
     , kde_first_in_window_list(QByteArrayLiteral("_KDE_FIRST_IN_WINDOWLIST"))
     , kde_color_sheme(QByteArrayLiteral("_KDE_NET_WM_COLOR_SCHEME"))
@@ -60,6 +63,7 @@ Atoms::Atoms()
     , netscape_url(QByteArrayLiteral("_NETSCAPE_URL"))
     , moz_url(QByteArrayLiteral("text/x-moz-url"))
     , wl_surface_id(QByteArrayLiteral("WL_SURFACE_ID"))
+    , wl_surface_serial(QByteArrayLiteral("WL_SURFACE_SERIAL"))
     , kde_net_wm_appmenu_service_name(QByteArrayLiteral("_KDE_NET_WM_APPMENU_SERVICE_NAME"))
     , kde_net_wm_appmenu_object_path(QByteArrayLiteral("_KDE_NET_WM_APPMENU_OBJECT_PATH"))
     , clipboard(QByteArrayLiteral("CLIPBOARD"))
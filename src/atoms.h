@@ -57,6 +57,9 @@ public:
     Xcb::Atom kde_net_wm_frame_strut;
     Xcb::Atom net_wm_sync_request_counter;
     Xcb::Atom net_wm_sync_request;
+    Xcb::Atom net_supported;
+    Xcb::Atom net_wm_frame_drawn;
+    Xcb::Atom net_wm_frame_timings;
     Xcb::Atom kde_net_wm_shadow;
     Xcb::Atom kde_first_in_window_list;
     Xcb::Atom kde_color_sheme;
@@ -69,6 +72,7 @@ public:
     Xcb::Atom netscape_url;
     Xcb::Atom moz_url;
     Xcb::Atom wl_surface_id;
+    Xcb::Atom wl_surface_serial;
     Xcb::Atom kde_net_wm_appmenu_service_name;
     Xcb::Atom kde_net_wm_appmenu_object_path;
     Xcb::Atom clipboard;
@@ -17,71 +17,141 @@
 namespace KWin
 {
 
+// A surface can be a scanout candidate of several pipelines, for example while it's moved between
+// outputs. Only the pipeline that claimed the surface first sends feedback for it, otherwise the
+// client would get contradicting feedback every frame.
+static QHash<KWaylandServer::SurfaceInterface *, DmabufFeedback *> s_owners;
+
 DmabufFeedback::DmabufFeedback(DrmGpu *gpu, EglGbmBackend *eglBackend)
     : m_gpu(gpu)
     , m_eglBackend(eglBackend)
 {
 }
 
-void DmabufFeedback::renderingSurface()
+DmabufFeedback::~DmabufFeedback()
+{
+    for (auto it = m_surfaces.begin(); it != m_surfaces.end(); it++) {
+        s_owners.remove(it.key());
+        release(*it);
+    }
+}
+
+DmabufFeedback::SurfaceState *DmabufFeedback::findState(KWaylandServer::SurfaceInterface *surface)
 {
-    if (m_surface && !m_attemptedThisFrame) {
-        if (const auto &feedback = m_surface->dmabufFeedbackV1()) {
-            feedback->setTranches({});
+    auto it = m_surfaces.find(surface);
+    if (it != m_surfaces.end() && !it->surface) {
+        // the surface got destroyed and another one got the same address
+        s_owners.remove(surface);
+        m_surfaces.erase(it);
+        it = m_surfaces.end();
+    }
+    if (it == m_surfaces.end()) {
+        DmabufFeedback *&owner = s_owners[surface];
+        if (owner && owner != this) {
+            return nullptr;
         }
-        m_surface = nullptr;
+        owner = this;
+        it = m_surfaces.insert(surface, SurfaceState{.surface = surface});
     }
-    m_attemptedThisFrame = false;
+    return &it.value();
 }
 
 void DmabufFeedback::scanoutSuccessful(KWaylandServer::SurfaceInterface *surface)
 {
-    if (surface != m_surface) {
-        if (m_surface && m_surface->dmabufFeedbackV1()) {
-            m_surface->dmabufFeedbackV1()->setTranches({});
-        }
-        m_surface = surface;
-        m_attemptedFormats = {};
+    if (SurfaceState *state = findState(surface)) {
+        state->attemptedThisFrame = true;
     }
 }
 
 void DmabufFeedback::scanoutFailed(KWaylandServer::SurfaceInterface *surface, const QMap<uint32_t, QVector<uint64_t>> &formats)
 {
-    m_attemptedThisFrame = true;
-    if (surface != m_surface) {
-        m_attemptedFormats = {};
-        if (m_surface && m_surface->dmabufFeedbackV1()) {
-            m_surface->dmabufFeedbackV1()->setTranches({});
-        }
-        m_surface = surface;
+    SurfaceState *state = findState(surface);
+    if (!state) {
+        return;
     }
-    if (const auto &feedback = m_surface->dmabufFeedbackV1()) {
-        const auto buffer = qobject_cast<KWaylandServer::LinuxDmaBufV1ClientBuffer *>(surface->buffer());
-        Q_ASSERT(buffer);
-        if (!m_attemptedFormats[buffer->format()].contains(buffer->planes().first().modifier)) {
-            m_attemptedFormats[buffer->format()] << buffer->planes().first().modifier;
-            QVector<KWaylandServer::LinuxDmaBufV1Feedback::Tranche> scanoutTranches;
-            const auto tranches = m_eglBackend->dmabuf()->tranches();
-            for (const auto &tranche : tranches) {
-                KWaylandServer::LinuxDmaBufV1Feedback::Tranche scanoutTranche;
-                for (auto it = tranche.formatTable.constBegin(); it != tranche.formatTable.constEnd(); it++) {
-                    const uint32_t format = it.key();
-                    const auto trancheModifiers = it.value();
-                    const auto drmModifiers = formats[format];
-                    for (const auto &mod : trancheModifiers) {
-                        if (drmModifiers.contains(mod) && !m_attemptedFormats[format].contains(mod)) {
-                            scanoutTranche.formatTable[format] << mod;
-                        }
-                    }
+    if (!state->failedThisFrame) {
+        state->dirty |= state->planeFormats != formats;
+        state->planeFormats = formats;
+    } else {
+        for (auto it = formats.constBegin(); it != formats.constEnd(); it++) {
+            QVector<uint64_t> &modifiers = state->planeFormats[it.key()];
+            for (const uint64_t modifier : it.value()) {
+                if (!modifiers.contains(modifier)) {
+                    modifiers << modifier;
+                    state->dirty = true;
                 }
-                if (!scanoutTranche.formatTable.isEmpty()) {
-                    scanoutTranche.device = m_gpu->deviceId();
-                    scanoutTranche.flags = KWaylandServer::LinuxDmaBufV1Feedback::TrancheFlag::Scanout;
-                    scanoutTranches << scanoutTranche;
+            }
+        }
+    }
+    state->attemptedThisFrame = true;
+    state->failedThisFrame = true;
+
+    const auto buffer = qobject_cast<KWaylandServer::LinuxDmaBufV1ClientBuffer *>(surface->buffer());
+    Q_ASSERT(buffer);
+    if (!state->attemptedFormats[buffer->format()].contains(buffer->planes().first().modifier)) {
+        state->attemptedFormats[buffer->format()] << buffer->planes().first().modifier;
+        state->dirty = true;
+    }
+}
+
+void DmabufFeedback::endFrame()
+{
+    for (auto it = m_surfaces.begin(); it != m_surfaces.end();) {
+        if (!it->surface) {
+            s_owners.remove(it.key());
+            it = m_surfaces.erase(it);
+        } else if (!it->attemptedThisFrame) {
+            s_owners.remove(it.key());
+            release(*it);
+            it = m_surfaces.erase(it);
+        } else {
+            if (it->dirty) {
+                sendTranches(*it);
+            }
+            it->attemptedThisFrame = false;
+            it->failedThisFrame = false;
+            it++;
+        }
+    }
+}
+
+void DmabufFeedback::sendTranches(SurfaceState &state)
+{
+    state.dirty = false;
+    const auto &feedback = state.surface->dmabufFeedbackV1();
+    if (!feedback) {
+        return;
+    }
+    QVector<KWaylandServer::LinuxDmaBufV1Feedback::Tranche> scanoutTranches;
+    const auto tranches = m_eglBackend->dmabuf()->tranches();
+    for (const auto &tranche : tranches) {
+        KWaylandServer::LinuxDmaBufV1Feedback::Tranche scanoutTranche;
+        for (auto it = tranche.formatTable.constBegin(); it != tranche.formatTable.constEnd(); it++) {
+            const uint32_t format = it.key();
+            const auto trancheModifiers = it.value();
+            const auto drmModifiers = state.planeFormats[format];
+            for (const auto &mod : trancheModifiers) {
+                if (drmModifiers.contains(mod) && !state.attemptedFormats[format].contains(mod)) {
+                    scanoutTranche.formatTable[format] << mod;
                 }
             }
-            feedback->setTranches(scanoutTranches);
         }
+        if (!scanoutTranche.formatTable.isEmpty()) {
+            scanoutTranche.device = m_gpu->deviceId();
+            scanoutTranche.flags = KWaylandServer::LinuxDmaBufV1Feedback::TrancheFlag::Scanout;
+            scanoutTranches << scanoutTranche;
+        }
+    }
+    feedback->setTranches(scanoutTranches);
+}
+
+void DmabufFeedback::release(const SurfaceState &state)
+{
+    if (!state.surface) {
+        return;
+    }
+    if (const auto &feedback = state.surface->dmabufFeedbackV1()) {
+        feedback->setTranches({});
     }
 }
 
@@ -8,6 +8,7 @@
 */
 #pragma once
 
+#include <QHash>
 #include <QMap>
 #include <QPointer>
 #include <QVector>
@@ -24,19 +25,48 @@ namespace KWin
 class EglGbmBackend;
 class DrmGpu;
 
+/**
+ * The DmabufFeedback class tells clients which buffer formats and modifiers their surfaces
+ * should use to be put on a hardware plane of one pipeline, the primary plane or one of the
+ * overlay planes. The feedback is tracked per surface. A surface gets scanout tranches once
+ * its current buffer couldn't be scanned out, and loses them as soon as it isn't a scanout
+ * candidate of the pipeline anymore.
+ */
 class DmabufFeedback
 {
 public:
     DmabufFeedback(DrmGpu *gpu, EglGbmBackend *eglBackend);
+    ~DmabufFeedback();
 
-    void renderingSurface();
     void scanoutSuccessful(KWaylandServer::SurfaceInterface *surface);
+    /**
+     * Records that the current buffer of the @p surface couldn't be put on a plane that supports
+     * the given @p formats. Several failures in one frame, e.g. on the primary and on overlay
+     * planes, accumulate the plane formats.
+     */
     void scanoutFailed(KWaylandServer::SurfaceInterface *surface, const QMap<uint32_t, QVector<uint64_t>> &formats);
+    /**
+     * Sends the feedback of the surfaces that were attempted to be scanned out since the last
+     * call, and resets the feedback of all other surfaces. This must be called once per frame.
+     */
+    void endFrame();
 
 private:
-    QPointer<KWaylandServer::SurfaceInterface> m_surface;
-    QMap<uint32_t, QVector<uint64_t>> m_attemptedFormats;
-    bool m_attemptedThisFrame = false;
+    struct SurfaceState
+    {
+        QPointer<KWaylandServer::SurfaceInterface> surface;
+        QMap<uint32_t, QVector<uint64_t>> attemptedFormats;
+        QMap<uint32_t, QVector<uint64_t>> planeFormats;
+        bool attemptedThisFrame = false;
+        bool failedThisFrame = false;
+        bool dirty = false;
+    };
+
+    SurfaceState *findState(KWaylandServer::SurfaceInterface *surface);
+    void sendTranches(SurfaceState &state);
+    void release(const SurfaceState &state);
+
+    QHash<KWaylandServer::SurfaceInterface *, SurfaceState> m_surfaces;
 
     DrmGpu *const m_gpu;
     EglGbmBackend *const m_eglBackend;
@@ -9,6 +9,7 @@
 #include "drm_abstract_output.h"
 #include "drm_backend.h"
 #include "drm_gpu.h"
+#include "drm_layer.h"
 #include "renderloop_p.h"
 
 namespace KWin
@@ -31,9 +32,22 @@ void DrmAbstractOutput::frameFailed() const
     RenderLoopPrivate::get(m_renderLoop)->notifyFrameFailed();
 }
 
-void DrmAbstractOutput::pageFlipped(std::chrono::nanoseconds timestamp) const
+void DrmAbstractOutput::pageFlipped(std::chrono::nanoseconds timestamp, std::optional<uint32_t> sequence) const
 {
-    RenderLoopPrivate::get(m_renderLoop)->notifyFrameCompleted(timestamp);
+    DrmOutputLayer *layer = outputLayer();
+    const std::chrono::nanoseconds renderTime = layer ? layer->queryRenderTime() : std::chrono::nanoseconds::zero();
+
+    KWaylandServer::PresentationFeedback::Kinds kinds;
+    if (sequence) {
+        kinds |= KWaylandServer::PresentationFeedback::Kind::Vsync | KWaylandServer::PresentationFeedback::Kind::HwCompletion;
+        if (m_gpu->presentationClock() == CLOCK_MONOTONIC) {
+            kinds |= KWaylandServer::PresentationFeedback::Kind::HwClock;
+        }
+    }
+    if (layer && layer->hasDirectScanoutBuffer()) {
+        kinds |= KWaylandServer::PresentationFeedback::Kind::ZeroCopy;
+    }
+    RenderLoopPrivate::get(m_renderLoop)->notifyFrameCompleted(timestamp, renderTime, sequence.value_or(0), kinds);
 }
 
 QVector<int32_t> DrmAbstractOutput::regionToRects(const QRegion &region) const
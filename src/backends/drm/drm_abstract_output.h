@@ -10,6 +10,8 @@
 
 #include "output.h"
 
+#include <optional>
+
 namespace KWin
 {
 
@@ -25,7 +27,11 @@ public:
 
     RenderLoop *renderLoop() const override;
     void frameFailed() const;
-    void pageFlipped(std::chrono::nanoseconds timestamp) const;
+    /**
+     * The @a sequence is the vblank counter reported by the kernel, if the timestamp
+     * comes from a page flip event.
+     */
+    void pageFlipped(std::chrono::nanoseconds timestamp, std::optional<uint32_t> sequence = std::nullopt) const;
     QVector<int32_t> regionToRects(const QRegion &region) const;
     DrmGpu *gpu() const;
 
@@ -78,6 +78,35 @@ static QStringList splitPathList(const QString &input, const QChar delimiter)
     return ret;
 }
 
+// the number of pixels per second that the connected displays of the gpu show with their preferred modes
+static uint64_t connectedPixelRate(DrmGpu *gpu)
+{
+    drmModeRes *resources = drmModeGetResources(gpu->fd());
+    if (!resources) {
+        return 0;
+    }
+    uint64_t ret = 0;
+    for (int i = 0; i < resources->count_connectors; i++) {
+        drmModeConnector *connector = drmModeGetConnector(gpu->fd(), resources->connectors[i]);
+        if (!connector) {
+            continue;
+        }
+        if (connector->connection == DRM_MODE_CONNECTED && connector->count_modes > 0) {
+            auto mode = connector->modes[0];
+            for (int m = 0; m < connector->count_modes; m++) {
+                if (connector->modes[m].type & DRM_MODE_TYPE_PREFERRED) {
+                    mode = connector->modes[m];
+                    break;
+                }
+            }
+            ret += uint64_t(mode.hdisplay) * mode.vdisplay * std::max(mode.vrefresh, 1u);
+        }
+        drmModeFreeConnector(connector);
+    }
+    drmModeFreeResources(resources);
+    return ret;
+}
+
 DrmBackend::DrmBackend(QObject *parent)
     : Platform(parent)
     , m_udev(new Udev)
@@ -227,6 +256,28 @@ bool DrmBackend::initialize()
         return false;
     }
 
+    // Render on the gpu that the most demanding displays are attached to, so that their
+    // frames don't need to be copied between gpus. This costs power on hybrid graphics
+    // laptops, so it has to be requested explicitly
+    static bool preferOutputGpuSet = false;
+    static const bool preferOutputGpu = qEnvironmentVariableIntValue("KWIN_DRM_PREFER_OUTPUT_GPU", &preferOutputGpuSet) == 1 && preferOutputGpuSet;
+    if (preferOutputGpu && m_explicitGpus.isEmpty() && m_gpus.size() > 1) {
+        DrmGpu *renderGpu = m_gpus.first();
+        uint64_t maxPixelRate = connectedPixelRate(renderGpu);
+        for (DrmGpu *gpu : qAsConst(m_gpus)) {
+            const uint64_t pixelRate = connectedPixelRate(gpu);
+            if (gpu->gbmDevice() && pixelRate > maxPixelRate) {
+                renderGpu = gpu;
+                maxPixelRate = pixelRate;
+            }
+        }
+        if (renderGpu != m_gpus.first()) {
+            qCDebug(KWIN_DRM) << "Using" << renderGpu->devNode() << "as the rendering gpu";
+            m_gpus.removeOne(renderGpu);
+            m_gpus.prepend(renderGpu);
+        }
+    }
+
     // setup udevMonitor
     if (m_udevMonitor) {
         m_udevMonitor->filterSubsystemDevType("drm");
@@ -278,6 +329,14 @@ void DrmBackend::handleUdevEvent()
             }
             if (gpu) {
                 qCDebug(KWIN_DRM) << "Received change event for monitored drm device" << gpu->devNode();
+                // Recent kernels name the connector that has changed, or the property for changes
+                // that don't need a probe at all, so the other connectors don't need to be probed
+                if (const char *connector = device->property("CONNECTOR")) {
+                    const uint32_t connectorId = device->property("PROPERTY") ? 0 : QByteArray(connector).toUInt();
+                    for (DrmGpu *other : qAsConst(m_gpus)) {
+                        other->setProbedConnector(other == gpu ? connectorId : 0);
+                    }
+                }
                 updateOutputs();
             }
         }
@@ -704,7 +763,12 @@ bool DrmBackend::applyOutputChanges(const OutputConfiguration &config)
                 toBeDisabled << output;
             }
         }
-        if (!gpu->testPendingConfiguration()) {
+        // Changes of the scale or position only don't involve KMS at all
+        const auto pipelines = gpu->pipelines();
+        const bool needsTest = std::any_of(pipelines.begin(), pipelines.end(), [](DrmPipeline *pipeline) {
+            return pipeline->hasPendingChanges();
+        });
+        if (needsTest && !gpu->testPendingConfiguration()) {
             for (const auto &output : qAsConst(toBeEnabled)) {
                 output->revertQueuedChanges();
             }
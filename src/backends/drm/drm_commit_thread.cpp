@@ -0,0 +1,130 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "drm_commit_thread.h"
+#include "drm_gpu.h"
+#include "logging.h"
+#include "utils/realtime.h"
+
+#include <QDeadlineTimer>
+#include <QThread>
+
+#include <errno.h>
+#include <utility>
+
+namespace KWin
+{
+
+DrmCommitThread::DrmCommitThread(DrmGpu *gpu)
+    : m_gpu(gpu)
+{
+    loadRealTimePolicy();
+    m_thread.reset(QThread::create([this]() {
+        gainRealTime(RealTimeTier::Commit);
+        run();
+    }));
+    m_thread->setObjectName(QStringLiteral("kwin_drm_commit"));
+    m_thread->start(QThread::TimeCriticalPriority);
+}
+
+DrmCommitThread::~DrmCommitThread()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        m_commitAdded.wakeAll();
+    }
+    // the remaining commits are still passed to the kernel before the thread quits
+    m_thread->wait();
+}
+
+void DrmCommitThread::addCommit(drmModeAtomicReq *req, uint32_t flags, const QVector<uint32_t> &crtcs, std::chrono::nanoseconds deadline)
+{
+    QMutexLocker locker(&m_mutex);
+    m_commits.push_back(Commit{req, flags, crtcs, deadline});
+    m_commitAdded.wakeAll();
+}
+
+bool DrmCommitThread::amendCommit(uint32_t crtcId, drmModeAtomicReq *req, const std::function<void()> &amended)
+{
+    QMutexLocker locker(&m_mutex);
+    for (Commit &commit : m_commits) {
+        if (commit.crtcs.contains(crtcId)) {
+            if (drmModeAtomicMerge(commit.req, req) != 0) {
+                return false;
+            }
+            amended();
+            return true;
+        }
+    }
+    return false;
+}
+
+void DrmCommitThread::waitIdle()
+{
+    QMutexLocker locker(&m_mutex);
+    // nothing waits for the deadlines anymore, don't block for up to a frame
+    for (Commit &commit : m_commits) {
+        commit.deadline = std::chrono::nanoseconds::zero();
+    }
+    m_commitAdded.wakeAll();
+    while (m_committing || !m_commits.empty()) {
+        m_idle.wait(&m_mutex);
+    }
+}
+
+QVector<uint32_t> DrmCommitThread::takeFailedCrtcs()
+{
+    QMutexLocker locker(&m_mutex);
+    return std::exchange(m_failedCrtcs, {});
+}
+
+void DrmCommitThread::run()
+{
+    QMutexLocker locker(&m_mutex);
+    while (true) {
+        while (m_commits.empty() && !m_quit) {
+            m_commitAdded.wait(&m_mutex);
+        }
+        if (m_commits.empty()) {
+            return;
+        }
+        while (!m_quit) {
+            const auto now = std::chrono::steady_clock::now().time_since_epoch();
+            const auto deadline = m_commits.front().deadline;
+            if (deadline <= now) {
+                break;
+            }
+            QDeadlineTimer timer(Qt::PreciseTimer);
+            timer.setPreciseRemainingTime(0, (deadline - now).count(), Qt::PreciseTimer);
+            m_commitAdded.wait(&m_mutex, timer);
+        }
+        const Commit commit = m_commits.front();
+        m_commits.pop_front();
+        m_committing = true;
+        locker.unlock();
+
+        const bool success = drmModeAtomicCommit(m_gpu->fd(), commit.req, commit.flags, nullptr) == 0;
+        if (!success) {
+            qCCritical(KWIN_DRM) << "Atomic commit failed! This should never happen!" << strerror(errno);
+        }
+        drmModeAtomicFree(commit.req);
+
+        locker.relock();
+        m_committing = false;
+        if (!success) {
+            const bool notify = m_failedCrtcs.isEmpty();
+            m_failedCrtcs << commit.crtcs;
+            if (notify) {
+                QMetaObject::invokeMethod(m_gpu, &DrmGpu::handleFailedCommits, Qt::QueuedConnection);
+            }
+        }
+        m_idle.wakeAll();
+    }
+}
+
+}
@@ -0,0 +1,96 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <xf86drmMode.h>
+
+class QThread;
+
+namespace KWin
+{
+
+class DrmGpu;
+
+/**
+ * The DrmCommitThread class passes atomic commits to the kernel on a separate thread.
+ *
+ * Even non-blocking atomic commits can take a long time in the kernel, for example
+ * if the driver has to wait for a previous commit or for a modeset on another crtc.
+ * Queueing the commits allows the main thread to go back to handling input and
+ * Wayland requests right after rendering. The commits are tested before they are
+ * queued, so failing is not expected; if it still happens, DrmGpu is notified
+ * asynchronously.
+ */
+class DrmCommitThread
+{
+public:
+    explicit DrmCommitThread(DrmGpu *gpu);
+    ~DrmCommitThread();
+
+    /**
+     * Queues the atomic request @p req to be committed with the given @p flags, the
+     * commit thread takes ownership of the request. @p crtcs are the ids of the crtcs
+     * that are affected by the commit.
+     *
+     * If a @p deadline is set, the commit is held back until then, so that it can still
+     * be amended, see amendCommit(). The deadline is in the CLOCK_MONOTONIC time domain.
+     */
+    void addCommit(drmModeAtomicReq *req, uint32_t flags, const QVector<uint32_t> &crtcs,
+                   std::chrono::nanoseconds deadline = std::chrono::nanoseconds::zero());
+
+    /**
+     * Adds the properties of @p req to the queued commit for the crtc with the id @p crtcId,
+     * if that commit hasn't been passed to the kernel yet. Properties that are in both
+     * requests get the values from @p req. @p amended is called while the queue is still
+     * locked, so the objects can be updated before the commit can go to the kernel. Returns
+     * @c false if there is no such commit.
+     */
+    bool amendCommit(uint32_t crtcId, drmModeAtomicReq *req, const std::function<void()> &amended);
+
+    /**
+     * Passes the commits that are held back to the kernel right away and blocks until all
+     * queued commits have been passed to the kernel.
+     */
+    void waitIdle();
+
+    /**
+     * Returns the ids of the crtcs of all commits that failed since the last call.
+     */
+    QVector<uint32_t> takeFailedCrtcs();
+
+private:
+    void run();
+
+    struct Commit
+    {
+        drmModeAtomicReq *req;
+        uint32_t flags;
+        QVector<uint32_t> crtcs;
+        std::chrono::nanoseconds deadline;
+    };
+
+    DrmGpu *const m_gpu;
+    std::unique_ptr<QThread> m_thread;
+    QMutex m_mutex;
+    QWaitCondition m_commitAdded;
+    QWaitCondition m_idle;
+    std::deque<Commit> m_commits;
+    QVector<uint32_t> m_failedCrtcs;
+    bool m_committing = false;
+    bool m_quit = false;
+};
+
+}
@@ -12,6 +12,7 @@
 
 #include "abstract_egl_backend.h"
 #include "drm_backend.h"
+#include "drm_commit_thread.h"
 #include "drm_layer.h"
 #include "drm_lease_output.h"
 #include "drm_object_connector.h"
@@ -41,6 +42,10 @@
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 
+#ifndef DRM_CAP_ATOMIC_ASYNC_PAGE_FLIP
+#define DRM_CAP_ATOMIC_ASYNC_PAGE_FLIP 0x15
+#endif
+
 namespace KWin
 {
 
@@ -76,6 +81,9 @@ DrmGpu::DrmGpu(DrmBackend *backend, const QString &devNode, int fd, dev_t device
     m_addFB2ModifiersSupported = drmGetCap(fd, DRM_CAP_ADDFB2_MODIFIERS, &capability) == 0 && capability == 1;
     qCDebug(KWIN_DRM) << "drmModeAddFB2WithModifiers is" << (m_addFB2ModifiersSupported ? "supported" : "not supported") << "on GPU" << m_devNode;
 
+    m_legacyAsyncPageflipSupported = drmGetCap(fd, DRM_CAP_ASYNC_PAGE_FLIP, &capability) == 0 && capability == 1;
+    m_atomicAsyncPageflipSupported = drmGetCap(fd, DRM_CAP_ATOMIC_ASYNC_PAGE_FLIP, &capability) == 0 && capability == 1;
+
     // find out what driver this kms device is using
     DrmScopedPointer<drmVersion> version(drmGetVersion(fd));
     m_isNVidia = strstr(version->name, "nvidia-drm");
@@ -88,6 +96,12 @@ DrmGpu::DrmGpu(DrmBackend *backend, const QString &devNode, int fd, dev_t device
 
     initDrmResources();
 
+    static bool noCommitThreadSet;
+    static const bool noCommitThread = qEnvironmentVariableIntValue("KWIN_DRM_NO_COMMIT_THREAD", &noCommitThreadSet) == 1 && noCommitThreadSet;
+    if (m_atomicModeSetting && !noCommitThread) {
+        m_commitThread = std::make_unique<DrmCommitThread>(this);
+    }
+
     m_leaseDevice = new KWaylandServer::DrmLeaseDeviceV1Interface(waylandServer()->display(), [this] {
         char *path = drmGetDeviceNameFromFd2(m_fd);
         int fd = open(path, O_RDWR | O_CLOEXEC);
@@ -122,6 +136,7 @@ DrmGpu::~DrmGpu()
     }
     delete m_leaseDevice;
     waitIdle();
+    m_commitThread.reset();
     const auto outputs = m_outputs;
     for (const auto &output : outputs) {
         if (auto drmOutput = qobject_cast<DrmOutput *>(output)) {
@@ -222,12 +237,36 @@ void DrmGpu::initDrmResources()
     }
 }
 
+void DrmGpu::setProbedConnector(uint32_t connectorId)
+{
+    m_probedConnector = connectorId;
+}
+
+bool DrmGpu::shouldProbeConnector(uint32_t connectorId) const
+{
+    return !m_probedConnector || *m_probedConnector == connectorId;
+}
+
+QByteArray DrmGpu::propertyName(uint32_t propertyId)
+{
+    auto it = m_propertyNames.constFind(propertyId);
+    if (it != m_propertyNames.constEnd()) {
+        return *it;
+    }
+    DrmScopedPointer<drmModePropertyRes> prop(drmModeGetProperty(m_fd, propertyId));
+    if (!prop) {
+        return QByteArray();
+    }
+    return *m_propertyNames.insert(propertyId, QByteArray(prop->name));
+}
+
 bool DrmGpu::updateOutputs()
 {
     waitIdle();
     DrmScopedPointer<drmModeRes> resources(drmModeGetResources(m_fd));
     if (!resources) {
         qCWarning(KWIN_DRM) << "drmModeGetResources failed";
+        m_probedConnector.reset();
         return false;
     }
 
@@ -317,6 +356,8 @@ bool DrmGpu::updateOutputs()
         plane->updateProperties();
     }
 
+    m_probedConnector.reset();
+
     if (testPendingConfiguration()) {
         for (const auto &pipeline : qAsConst(m_pipelines)) {
             pipeline->applyPendingChanges();
@@ -340,63 +381,67 @@ bool DrmGpu::updateOutputs()
     return true;
 }
 
-bool DrmGpu::checkCrtcAssignment(QVector<DrmConnector *> connectors, const QVector<DrmCrtc *> &crtcs)
+bool DrmGpu::checkCrtcAssignment(const QVector<DrmConnector *> &connectors, int index, const QVector<DrmCrtc *> &crtcs, QVector<bool> &usedCrtcs)
 {
-    if (connectors.isEmpty() || crtcs.isEmpty()) {
+    const bool crtcsLeft = std::find(usedCrtcs.cbegin(), usedCrtcs.cend(), false) != usedCrtcs.cend();
+    if (index == connectors.count() || !crtcsLeft) {
         if (m_pipelines.isEmpty()) {
             // nothing to do
             return true;
         }
         // remaining connectors can't be powered
-        for (const auto &conn : qAsConst(connectors)) {
-            qCWarning(KWIN_DRM) << "disabling connector" << conn->modelName() << "without a crtc";
-            conn->pipeline()->setCrtc(nullptr);
+        for (int i = index; i < connectors.count(); i++) {
+            qCWarning(KWIN_DRM) << "disabling connector" << connectors[i]->modelName() << "without a crtc";
+            connectors[i]->pipeline()->setCrtc(nullptr);
         }
         return testPipelines();
     }
-    auto connector = connectors.takeFirst();
+    auto connector = connectors[index];
     auto pipeline = connector->pipeline();
     if (!pipeline->enabled()) {
         // disabled pipelines don't need CRTCs
         pipeline->setCrtc(nullptr);
-        return checkCrtcAssignment(connectors, crtcs);
-    }
-    DrmCrtc *currentCrtc = nullptr;
-    if (m_atomicModeSetting) {
-        // try the crtc that this connector is already connected to first
-        uint32_t id = connector->getProp(DrmConnector::PropertyIndex::CrtcId)->pending();
-        auto it = std::find_if(crtcs.begin(), crtcs.end(), [id](const auto &crtc) {
-            return id == crtc->id();
-        });
-        if (it != crtcs.end()) {
-            currentCrtc = *it;
-            auto crtcsLeft = crtcs;
-            crtcsLeft.removeOne(currentCrtc);
-            pipeline->setCrtc(currentCrtc);
-            do {
-                if (checkCrtcAssignment(connectors, crtcsLeft)) {
-                    return true;
-                }
-            } while (pipeline->pruneModifier());
+        return checkCrtcAssignment(connectors, index + 1, crtcs, usedCrtcs);
+    }
+
+    // try the crtc that this connector is already connected to first, then the one
+    // that worked for it the last time, and only then all others
+    QVector<int> candidates;
+    candidates.reserve(crtcs.count());
+    const uint32_t connectedCrtc = m_atomicModeSetting ? connector->getProp(DrmConnector::PropertyIndex::CrtcId)->pending() : 0;
+    const uint32_t preferredCrtc = m_preferredCrtcs.value(connector->id());
+    for (const uint32_t id : {connectedCrtc, preferredCrtc}) {
+        for (int i = 0; i < crtcs.count(); i++) {
+            if (id != 0 && crtcs[i]->id() == id && !usedCrtcs[i] && !candidates.contains(i) && connector->isCrtcSupported(crtcs[i])) {
+                candidates << i;
+            }
         }
     }
-    for (const auto &crtc : qAsConst(crtcs)) {
-        if (connector->isCrtcSupported(crtc) && crtc != currentCrtc) {
-            auto crtcsLeft = crtcs;
-            crtcsLeft.removeOne(crtc);
-            pipeline->setCrtc(crtc);
-            do {
-                if (checkCrtcAssignment(connectors, crtcsLeft)) {
-                    return true;
-                }
-            } while (pipeline->pruneModifier());
+    for (int i = 0; i < crtcs.count(); i++) {
+        if (!usedCrtcs[i] && !candidates.contains(i) && connector->isCrtcSupported(crtcs[i])) {
+            candidates << i;
         }
     }
+
+    for (const int i : qAsConst(candidates)) {
+        usedCrtcs[i] = true;
+        pipeline->setCrtc(crtcs[i]);
+        // a lower link depth is tried first, it doesn't restrict the buffers that can be used
+        do {
+            if (checkCrtcAssignment(connectors, index + 1, crtcs, usedCrtcs)) {
+                return true;
+            }
+        } while (pipeline->pruneColorDepth() || pipeline->pruneModifier());
+        usedCrtcs[i] = false;
+    }
     return false;
 }
 
 bool DrmGpu::testPendingConfiguration()
 {
+    // The key only covers what the crtc assignment search varies, so results must not
+    // outlive a single search: gamma, planes and buffers may have changed since the last one
+    m_testResults.clear();
     QVector<DrmConnector *> connectors;
     for (const auto &conn : qAsConst(m_connectors)) {
         if (conn->isConnected()) {
@@ -417,20 +462,67 @@ bool DrmGpu::testPendingConfiguration()
             return c1->getProp(DrmConnector::PropertyIndex::CrtcId)->current() > c2->getProp(DrmConnector::PropertyIndex::CrtcId)->current();
         });
     }
-    if (checkCrtcAssignment(connectors, crtcs)) {
-        return true;
-    } else {
+    QVector<bool> usedCrtcs(crtcs.count(), false);
+    bool ok = checkCrtcAssignment(connectors, 0, crtcs, usedCrtcs);
+    if (!ok) {
         // try again without hw rotation
         bool hwRotationUsed = false;
         for (const auto &pipeline : qAsConst(m_pipelines)) {
             hwRotationUsed |= (pipeline->bufferOrientation() != DrmPlane::Transformations(DrmPlane::Transformation::Rotate0));
             pipeline->setBufferOrientation(DrmPlane::Transformation::Rotate0);
         }
-        return hwRotationUsed ? checkCrtcAssignment(connectors, crtcs) : false;
+        if (hwRotationUsed) {
+            usedCrtcs.fill(false);
+            ok = checkCrtcAssignment(connectors, 0, crtcs, usedCrtcs);
+        }
+    }
+    if (ok) {
+        // remember the working assignment, so that it gets tried first the next time
+        for (const auto &pipeline : qAsConst(m_pipelines)) {
+            if (pipeline->crtc()) {
+                m_preferredCrtcs[pipeline->connector()->id()] = pipeline->crtc()->id();
+            }
+        }
+    }
+    return ok;
+}
+
+static QByteArray configurationKey(const QVector<DrmPipeline *> &pipelines)
+{
+    QVector<quint64> key;
+    for (const auto &pipeline : pipelines) {
+        const auto formats = pipeline->formats();
+        uint formatsHash = 0;
+        for (auto it = formats.constBegin(); it != formats.constEnd(); ++it) {
+            formatsHash = qHash(it.key(), formatsHash);
+            formatsHash = qHash(it.value(), formatsHash);
+        }
+        key << pipeline->connector()->id()
+            << (pipeline->crtc() ? pipeline->crtc()->id() : 0)
+            << quint64(pipeline->mode() ? pipeline->mode()->blobId() : 0)
+            << quint64(pipeline->enabled()) << quint64(pipeline->active())
+            << quint64(pipeline->bufferOrientation()) << quint64(pipeline->syncMode())
+            << pipeline->overscan() << quint64(pipeline->rgbRange())
+            << pipeline->maxBpc() << formatsHash;
     }
+    return QByteArray(reinterpret_cast<const char *>(key.constData()), key.count() * sizeof(quint64));
 }
 
 bool DrmGpu::testPipelines()
+{
+    // The search for a working crtc assignment may end up at identical configurations
+    // several times, e.g. when pruning modifiers doesn't change anything
+    const QByteArray key = configurationKey(m_pipelines);
+    const auto cached = m_testResults.constFind(key);
+    if (cached != m_testResults.constEnd()) {
+        return *cached;
+    }
+    const bool result = testPipelinesInternal();
+    m_testResults.insert(key, result);
+    return result;
+}
+
+bool DrmGpu::testPipelinesInternal()
 {
     QVector<DrmPipeline *> inactivePipelines;
     std::copy_if(m_pipelines.constBegin(), m_pipelines.constEnd(), std::back_inserter(inactivePipelines), [](const auto pipeline) {
@@ -463,8 +555,30 @@ DrmOutput *DrmGpu::findOutput(quint32 connector)
     return nullptr;
 }
 
+DrmCommitThread *DrmGpu::commitThread() const
+{
+    return m_commitThread.get();
+}
+
+void DrmGpu::handleFailedCommits()
+{
+    if (!m_commitThread) {
+        return;
+    }
+    const QVector<uint32_t> crtcs = m_commitThread->takeFailedCrtcs();
+    for (DrmPipeline *pipeline : qAsConst(m_pipelines)) {
+        if (pipeline->currentCrtc() && crtcs.contains(pipeline->currentCrtc()->id())) {
+            pipeline->queuedCommitFailed();
+        }
+    }
+}
+
 void DrmGpu::waitIdle()
 {
+    if (m_commitThread) {
+        m_commitThread->waitIdle();
+        handleFailedCommits();
+    }
     m_socketNotifier->setEnabled(false);
     while (true) {
         const bool idle = std::all_of(m_drmOutputs.constBegin(), m_drmOutputs.constEnd(), [](DrmOutput *output) {
@@ -517,7 +631,6 @@ static std::chrono::nanoseconds convertTimestamp(clockid_t sourceClock, clockid_
 
 void DrmGpu::pageFlipHandler(int fd, unsigned int sequence, unsigned int sec, unsigned int usec, unsigned int crtc_id, void *user_data)
 {
-    Q_UNUSED(sequence)
     Q_UNUSED(user_data)
     auto backend = dynamic_cast<DrmBackend *>(kwinApp()->platform());
     if (!backend) {
@@ -535,10 +648,12 @@ void DrmGpu::pageFlipHandler(int fd, unsigned int sequence, unsigned int sec, un
     // unsigned multiplication.
     std::chrono::nanoseconds timestamp = convertTimestamp(gpu->presentationClock(), CLOCK_MONOTONIC,
                                                           {static_cast<time_t>(sec), static_cast<long>(usec * 1000)});
+    std::optional<uint32_t> flipSequence = sequence;
     if (timestamp == std::chrono::nanoseconds::zero()) {
         qCDebug(KWIN_DRM, "Got invalid timestamp (sec: %u, usec: %u) on gpu %s",
                 sec, usec, qPrintable(gpu->devNode()));
         timestamp = std::chrono::steady_clock::now().time_since_epoch();
+        flipSequence.reset();
     }
     const auto pipelines = gpu->pipelines();
     auto it = std::find_if(pipelines.begin(), pipelines.end(), [crtc_id](const auto &pipeline) {
@@ -547,7 +662,7 @@ void DrmGpu::pageFlipHandler(int fd, unsigned int sequence, unsigned int sec, un
     if (it == pipelines.end()) {
         qCWarning(KWIN_DRM, "received invalid page flip event for crtc %u", crtc_id);
     } else {
-        (*it)->pageFlipped(timestamp);
+        (*it)->pageFlipped(timestamp, flipSequence);
     }
 }
 
@@ -571,6 +686,7 @@ void DrmGpu::removeOutput(DrmOutput *output)
     m_outputs.removeOne(output);
     Q_EMIT outputRemoved(output);
     delete output;
+    DrmPipeline::flushGroupPresents(m_pipelines);
 }
 
 DrmBackend *DrmGpu::platform() const
@@ -620,6 +736,13 @@ void DrmGpu::handleLeaseRequest(KWaylandServer::DrmLeaseV1Interface *leaseReques
     for (const auto &connector : conns) {
         auto output = qobject_cast<DrmLeaseOutput *>(connector);
         if (m_leaseOutputs.contains(output) && !output->lease()) {
+            if (!output->pipeline()->crtc()) {
+                // lease a crtc that isn't in use, so the desktop outputs don't need to be reconfigured
+                if (DrmCrtc *crtc = findFreeCrtc(output->pipeline()->connector())) {
+                    output->pipeline()->setCrtc(crtc);
+                    output->pipeline()->applyPendingChanges();
+                }
+            }
             if (!output->addLeaseObjects(objects)) {
                 leaseRequest->deny();
                 return;
@@ -715,6 +838,11 @@ bool DrmGpu::addFB2ModifiersSupported() const
     return m_addFB2ModifiersSupported;
 }
 
+bool DrmGpu::asyncPageflipSupported() const
+{
+    return m_atomicModeSetting ? m_atomicAsyncPageflipSupported : m_legacyAsyncPageflipSupported;
+}
+
 bool DrmGpu::isNVidia() const
 {
     return m_isNVidia;
@@ -772,6 +900,49 @@ QVector<DrmObject *> DrmGpu::unusedObjects() const
             ret.removeOne(pipeline->crtc()->primaryPlane());
             ret.removeOne(pipeline->crtc()->cursorPlane());
         }
+        const auto overlayPlanes = pipeline->overlayPlanes();
+        for (DrmPlane *plane : overlayPlanes) {
+            ret.removeOne(plane);
+        }
+    }
+    return ret;
+}
+
+DrmCrtc *DrmGpu::findFreeCrtc(DrmConnector *connector) const
+{
+    for (DrmCrtc *crtc : m_crtcs) {
+        if (!connector->isCrtcSupported(crtc)) {
+            continue;
+        }
+        const bool used = std::any_of(m_pipelines.constBegin(), m_pipelines.constEnd(), [crtc](const DrmPipeline *pipeline) {
+            return pipeline->crtc() == crtc;
+        });
+        if (!used) {
+            return crtc;
+        }
+    }
+    return nullptr;
+}
+
+QVector<DrmPlane *> DrmGpu::overlayPlanes(const DrmPipeline *pipeline) const
+{
+    if (!m_atomicModeSetting || !pipeline->crtc()) {
+        return {};
+    }
+    QVector<DrmPlane *> ret;
+    for (DrmPlane *plane : m_planes) {
+        if (plane->type() == DrmPlane::TypeIndex::Overlay && plane->isCrtcSupported(pipeline->crtc()->pipeIndex())
+            && plane->canBeStackedAbove(pipeline->crtc()->primaryPlane())) {
+            ret << plane;
+        }
+    }
+    for (const auto &other : m_pipelines) {
+        if (other != pipeline) {
+            const auto usedPlanes = other->overlayPlanes();
+            for (DrmPlane *plane : usedPlanes) {
+                ret.removeOne(plane);
+            }
+        }
     }
     return ret;
 }
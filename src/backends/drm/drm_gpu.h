@@ -12,6 +12,7 @@
 
 #include "drm_virtual_output.h"
 
+#include <QHash>
 #include <QPointer>
 #include <QSize>
 #include <QSocketNotifier>
@@ -19,6 +20,8 @@
 #include <qobject.h>
 
 #include <epoxy/egl.h>
+#include <memory>
+#include <optional>
 #include <sys/types.h>
 
 struct gbm_device;
@@ -38,6 +41,7 @@ class DrmCrtc;
 class DrmConnector;
 class DrmPlane;
 class DrmBackend;
+class DrmCommitThread;
 class EglGbmBackend;
 class DrmPipeline;
 class DrmAbstractOutput;
@@ -57,6 +61,7 @@ public:
 
     bool atomicModeSetting() const;
     bool addFB2ModifiersSupported() const;
+    bool asyncPageflipSupported() const;
     bool isNVidia() const;
     gbm_device *gbmDevice() const;
     EGLDisplay eglDisplay() const;
@@ -70,10 +75,30 @@ public:
 
     QVector<DrmAbstractOutput *> outputs() const;
     const QVector<DrmPipeline *> pipelines() const;
+    /**
+     * Returns the overlay planes that @p pipeline can use, i.e. the ones that are compatible
+     * with its crtc and are not used by any other pipeline.
+     */
+    QVector<DrmPlane *> overlayPlanes(const DrmPipeline *pipeline) const;
 
     void setEglDisplay(EGLDisplay display);
 
     bool updateOutputs();
+    /**
+     * Limits the forced probe of the next updateOutputs() to the connector with the given id,
+     * the other connectors are refreshed from their current kernel state. Pass 0 to probe
+     * none of them.
+     */
+    void setProbedConnector(uint32_t connectorId);
+    /**
+     * Returns whether the connector with the given id must be probed when it's refreshed.
+     */
+    bool shouldProbeConnector(uint32_t connectorId) const;
+    /**
+     * Returns the name of the DRM property with the given id, property metadata doesn't
+     * change during the lifetime of the device so it's only queried once.
+     */
+    QByteArray propertyName(uint32_t propertyId);
 
     DrmVirtualOutput *createVirtualOutput(const QString &name, const QSize &size, double scale, DrmVirtualOutput::Type type);
     void removeVirtualOutput(DrmVirtualOutput *output);
@@ -85,6 +110,13 @@ public:
     void releaseBuffers();
     void recreateSurfaces();
 
+    /**
+     * Returns the thread non-blocking atomic commits are passed to the kernel on,
+     * or @c nullptr if commits are done on the main thread.
+     */
+    DrmCommitThread *commitThread() const;
+    void handleFailedCommits();
+
 Q_SIGNALS:
     void outputAdded(DrmAbstractOutput *output);
     void outputRemoved(DrmAbstractOutput *output);
@@ -100,9 +132,11 @@ private:
     void initDrmResources();
     void waitIdle();
 
-    bool checkCrtcAssignment(QVector<DrmConnector *> connectors, const QVector<DrmCrtc *> &crtcs);
+    bool checkCrtcAssignment(const QVector<DrmConnector *> &connectors, int index, const QVector<DrmCrtc *> &crtcs, QVector<bool> &usedCrtcs);
     bool testPipelines();
+    bool testPipelinesInternal();
     QVector<DrmObject *> unusedObjects() const;
+    DrmCrtc *findFreeCrtc(DrmConnector *connector) const;
 
     void handleLeaseRequest(KWaylandServer::DrmLeaseV1Interface *leaseRequest);
     void handleLeaseRevoked(KWaylandServer::DrmLeaseV1Interface *lease);
@@ -114,6 +148,8 @@ private:
     const QString m_devNode;
     bool m_atomicModeSetting;
     bool m_addFB2ModifiersSupported = false;
+    bool m_legacyAsyncPageflipSupported = false;
+    bool m_atomicAsyncPageflipSupported = false;
     bool m_isNVidia;
     bool m_isVirtualMachine;
     clockid_t m_presentationClock;
@@ -126,11 +162,18 @@ private:
     QVector<DrmConnector *> m_connectors;
     QVector<DrmObject *> m_allObjects;
     QVector<DrmPipeline *> m_pipelines;
+    // results of test commits during one crtc assignment search, keyed by the tested configuration
+    QHash<QByteArray, bool> m_testResults;
+    // connector id -> crtc id of the last working assignment
+    QHash<uint32_t, uint32_t> m_preferredCrtcs;
+    QHash<uint32_t, QByteArray> m_propertyNames;
+    std::optional<uint32_t> m_probedConnector;
 
     QVector<DrmOutput *> m_drmOutputs;
     QVector<DrmAbstractOutput *> m_outputs;
     QVector<DrmLeaseOutput *> m_leaseOutputs;
     KWaylandServer::DrmLeaseDeviceV1Interface *m_leaseDevice = nullptr;
+    std::unique_ptr<DrmCommitThread> m_commitThread;
 
     QSocketNotifier *m_socketNotifier = nullptr;
     QSize m_cursorSize;
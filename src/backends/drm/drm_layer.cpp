@@ -7,9 +7,19 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 #include "drm_layer.h"
+#include "drm_buffer.h"
+#include "drm_buffer_gbm.h"
+#include "drm_gpu.h"
+#include "drm_object_connector.h"
+#include "drm_output.h"
 #include "drm_pipeline.h"
+#include "surfaceitem_wayland.h"
+#include "wayland/linuxdmabufv1clientbuffer.h"
+#include "wayland/surface_interface.h"
 
 #include <QMatrix4x4>
+#include <algorithm>
+#include <drm_fourcc.h>
 
 namespace KWin
 {
@@ -36,6 +46,191 @@ bool DrmPipelineLayer::hasDirectScanoutBuffer() const
     return false;
 }
 
+std::optional<DrmPipeline::Overlay> DrmPipelineLayer::createOverlay(SurfaceItem *surfaceItem, QHash<KWaylandServer::ClientBuffer *, OverlayBuffer> &buffers) const
+{
+    SurfaceItemWayland *item = qobject_cast<SurfaceItemWayland *>(surfaceItem);
+    if (!item || !item->surface()) {
+        return std::nullopt;
+    }
+    const auto surface = item->surface();
+    const DrmOutput *output = m_pipeline->output();
+    // Overlay planes are always programmed without rotation, so buffers that would have
+    // to be rotated or flipped on the way to the screen have to be composited
+    if (surface->bufferTransform() != Output::Transform::Normal || output->transform() != Output::Transform::Normal
+        || m_pipeline->bufferOrientation() != DrmPlane::Transformations(DrmPlane::Transformation::Rotate0)) {
+        return std::nullopt;
+    }
+    const auto buffer = qobject_cast<KWaylandServer::LinuxDmaBufV1ClientBuffer *>(surface->buffer());
+    if (!buffer || buffer->planes().isEmpty()) {
+        return std::nullopt;
+    }
+
+    const QRectF logicalRect = surfaceItem->mapToGlobal(surfaceItem->rect()).translated(-output->geometry().topLeft());
+    const QRectF deviceRect(logicalRect.topLeft() * output->scale(), logicalRect.size() * output->scale());
+    if (deviceRect != deviceRect.toRect()) {
+        // the plane would have to be positioned with sub-pixel precision
+        return std::nullopt;
+    }
+    // the part of the buffer that is shown, which the viewport may crop
+    const QRectF sourceRect = surface->surfaceToBufferMatrix().mapRect(QRectF(QPointF(0, 0), surface->size()));
+    if (sourceRect != sourceRect.toRect() || !QRect(QPoint(0, 0), buffer->size()).contains(sourceRect.toRect())) {
+        return std::nullopt;
+    }
+
+    std::shared_ptr<DrmFramebuffer> framebuffer;
+    const auto it = m_overlayBuffers.constFind(buffer);
+    if (it != m_overlayBuffers.constEnd() && it->clientBuffer) {
+        framebuffer = it->framebuffer;
+    } else {
+        const auto gbmBuffer = GbmBuffer::importBuffer(m_pipeline->gpu(), buffer);
+        if (!gbmBuffer) {
+            return std::nullopt;
+        }
+        framebuffer = DrmFramebuffer::createFramebuffer(gbmBuffer);
+        if (!framebuffer) {
+            return std::nullopt;
+        }
+    }
+    buffers.insert(buffer, OverlayBuffer{buffer, framebuffer});
+    return DrmPipeline::Overlay{
+        .buffer = framebuffer,
+        .sourceRect = sourceRect.toRect(),
+        .destinationRect = deviceRect.toRect(),
+    };
+}
+
+bool DrmPipelineLayer::OverlayParams::operator==(const OverlayParams &other) const
+{
+    return plane == other.plane && format == other.format && modifier == other.modifier && bufferSize == other.bufferSize
+        && sourceRect == other.sourceRect && destinationRect == other.destinationRect;
+}
+
+bool DrmPipelineLayer::OverlayTestBase::operator==(const OverlayTestBase &other) const
+{
+    return modeBlob == other.modeBlob && primaryFormat == other.primaryFormat && primaryModifier == other.primaryModifier
+        && primarySize == other.primarySize && cursorVisible == other.cursorVisible && cursorPosition == other.cursorPosition;
+}
+
+bool DrmPipelineLayer::OverlayTestBase::operator!=(const OverlayTestBase &other) const
+{
+    return !(*this == other);
+}
+
+bool DrmPipelineLayer::testOverlays(const QVector<DrmPipeline::Overlay> &overlays, QVector<OverlayTest> &tests)
+{
+    QVector<OverlayParams> params;
+    params.reserve(overlays.size());
+    for (const DrmPipeline::Overlay &overlay : overlays) {
+        params << OverlayParams{
+            .plane = overlay.plane,
+            .format = overlay.buffer->buffer()->format(),
+            .modifier = overlay.buffer->buffer()->modifier(),
+            .bufferSize = overlay.buffer->buffer()->size(),
+            .sourceRect = overlay.sourceRect,
+            .destinationRect = overlay.destinationRect,
+        };
+    }
+    // Swapping a buffer for one with the same parameters doesn't change the outcome of the
+    // test commit, so only new configurations are tested
+    const auto it = std::find_if(m_overlayTests.cbegin(), m_overlayTests.cend(), [&params](const OverlayTest &test) {
+        return test.overlays == params;
+    });
+    bool result;
+    if (it != m_overlayTests.cend()) {
+        result = it->result;
+    } else {
+        m_pipeline->setOverlays(overlays);
+        result = m_pipeline->testScanout();
+    }
+    tests << OverlayTest{params, result};
+    return result;
+}
+
+bool DrmPipelineLayer::overlaysSupported() const
+{
+    static bool valid;
+    static const bool overlaysDisabled = qEnvironmentVariableIntValue("KWIN_DRM_NO_OVERLAYS", &valid) == 1 && valid;
+    // legacy KMS can only test a configuration by presenting it
+    return !overlaysDisabled && m_pipeline->output() && m_pipeline->gpu()->atomicModeSetting() && m_pipeline->gpu()->gbmDevice() && !m_pipeline->gpu()->needsModeset();
+}
+
+QMap<uint32_t, QVector<uint64_t>> DrmPipelineLayer::overlayFormats() const
+{
+    QMap<uint32_t, QVector<uint64_t>> ret;
+    if (!overlaysSupported()) {
+        return ret;
+    }
+    const QVector<DrmPlane *> planes = m_pipeline->gpu()->overlayPlanes(m_pipeline);
+    for (DrmPlane *plane : planes) {
+        const auto formats = plane->formats();
+        for (auto it = formats.constBegin(); it != formats.constEnd(); it++) {
+            QVector<uint64_t> &modifiers = ret[it.key()];
+            for (const uint64_t modifier : it.value()) {
+                if (!modifiers.contains(modifier)) {
+                    modifiers << modifier;
+                }
+            }
+        }
+    }
+    return ret;
+}
+
+QVector<SurfaceItem *> DrmPipelineLayer::assignOverlays(const QVector<SurfaceItem *> &surfaceItems)
+{
+    QVector<DrmPipeline::Overlay> overlays;
+    QVector<SurfaceItem *> ret;
+    QHash<KWaylandServer::ClientBuffer *, OverlayBuffer> buffers;
+    QVector<OverlayTest> tests;
+    OverlayTestBase base;
+    base.modeBlob = m_pipeline->mode() ? m_pipeline->mode()->blobId() : 0;
+    if (const auto primary = currentBuffer()) {
+        base.primaryFormat = primary->buffer()->format();
+        base.primaryModifier = primary->buffer()->modifier();
+        base.primarySize = primary->buffer()->size();
+    }
+    if (const DrmOverlayLayer *cursor = m_pipeline->cursorLayer()) {
+        base.cursorVisible = cursor->isVisible();
+        base.cursorPosition = cursor->position();
+    }
+    if (m_overlayTestBase != base) {
+        // the test results don't carry over to other modes or primary and cursor plane states
+        m_overlayTests.clear();
+        m_overlayTestBase = base;
+    }
+    if (overlaysSupported()) {
+        QVector<DrmPlane *> planes = m_pipeline->gpu()->overlayPlanes(m_pipeline);
+        for (SurfaceItem *surfaceItem : surfaceItems) {
+            if (planes.isEmpty()) {
+                break;
+            }
+            auto overlay = createOverlay(surfaceItem, buffers);
+            if (!overlay) {
+                continue;
+            }
+            const uint32_t format = overlay->buffer->buffer()->format();
+            const uint64_t modifier = overlay->buffer->buffer()->modifier();
+            for (auto it = planes.begin(); it != planes.end(); ++it) {
+                const auto formats = (*it)->formats();
+                if (!formats.contains(format) || (modifier != DRM_FORMAT_MOD_INVALID && !formats[format].isEmpty() && !formats[format].contains(modifier))) {
+                    continue;
+                }
+                overlay->plane = *it;
+                if (testOverlays(overlays + QVector<DrmPipeline::Overlay>{*overlay}, tests)) {
+                    overlays << *overlay;
+                    ret << surfaceItem;
+                    planes.erase(it);
+                    surfaceItem->resetDamage();
+                    break;
+                }
+            }
+        }
+    }
+    m_pipeline->setOverlays(overlays);
+    m_overlayBuffers = buffers;
+    m_overlayTests = tests;
+    return ret;
+}
+
 DrmOverlayLayer::DrmOverlayLayer(DrmPipeline *pipeline)
     : DrmPipelineLayer(pipeline)
 {
@@ -9,10 +9,21 @@
 #pragma once
 #include "outputlayer.h"
 
+#include "drm_pipeline.h"
+
+#include <QHash>
+#include <QMap>
+#include <QPointer>
 #include <QRegion>
 #include <QSharedPointer>
+#include <memory>
 #include <optional>
 
+namespace KWaylandServer
+{
+class ClientBuffer;
+}
+
 namespace KWin
 {
 
@@ -40,8 +51,66 @@ public:
     virtual std::shared_ptr<DrmFramebuffer> currentBuffer() const = 0;
     virtual bool hasDirectScanoutBuffer() const;
 
+    QVector<SurfaceItem *> assignOverlays(const QVector<SurfaceItem *> &surfaceItems) override;
+
 protected:
+    bool overlaysSupported() const;
+    /**
+     * Returns the formats and modifiers supported by any of the overlay planes this layer can use
+     */
+    QMap<uint32_t, QVector<uint64_t>> overlayFormats() const;
+
     DrmPipeline *const m_pipeline;
+
+private:
+    struct OverlayBuffer
+    {
+        QPointer<KWaylandServer::ClientBuffer> clientBuffer;
+        std::shared_ptr<DrmFramebuffer> framebuffer;
+    };
+    /**
+     * The parameters of an overlay that decide whether a test commit passes
+     */
+    struct OverlayParams
+    {
+        DrmPlane *plane;
+        uint32_t format;
+        uint64_t modifier;
+        QSize bufferSize;
+        QRect sourceRect;
+        QRect destinationRect;
+
+        bool operator==(const OverlayParams &other) const;
+    };
+    struct OverlayTest
+    {
+        QVector<OverlayParams> overlays;
+        bool result;
+    };
+    /**
+     * The state of the rest of the pipeline that the overlay test results depend on
+     */
+    struct OverlayTestBase
+    {
+        uint32_t modeBlob = 0;
+        uint32_t primaryFormat = 0;
+        uint64_t primaryModifier = 0;
+        QSize primarySize;
+        bool cursorVisible = false;
+        QPoint cursorPosition;
+
+        bool operator==(const OverlayTestBase &other) const;
+        bool operator!=(const OverlayTestBase &other) const;
+    };
+
+    std::optional<DrmPipeline::Overlay> createOverlay(SurfaceItem *surfaceItem, QHash<KWaylandServer::ClientBuffer *, OverlayBuffer> &buffers) const;
+    bool testOverlays(const QVector<DrmPipeline::Overlay> &overlays, QVector<OverlayTest> &tests);
+
+    // the framebuffers imported for overlays in the last frame
+    QHash<KWaylandServer::ClientBuffer *, OverlayBuffer> m_overlayBuffers;
+    // the overlay configurations tested in the last frame
+    QVector<OverlayTest> m_overlayTests;
+    OverlayTestBase m_overlayTestBase;
 };
 
 class DrmOverlayLayer : public DrmPipelineLayer
@@ -139,26 +139,45 @@ bool DrmObject::updateProperties()
         qCWarning(KWIN_DRM) << "Failed to get properties for object" << m_id;
         return false;
     }
-    for (int propIndex = 0; propIndex < m_propertyDefinitions.count(); propIndex++) {
-        const PropertyDefinition &def = m_propertyDefinitions[propIndex];
-        bool found = false;
-        for (uint32_t drmPropIndex = 0; drmPropIndex < properties->count_props; drmPropIndex++) {
-            DrmScopedPointer<drmModePropertyRes> prop(drmModeGetProperty(m_gpu->fd(), properties->props[drmPropIndex]));
-            if (!prop) {
-                qCWarning(KWIN_DRM, "Getting property %d of object %d failed!", drmPropIndex, m_id);
+    // Known properties only need their values refreshed, the full property is only
+    // queried when it's seen for the first time
+    QVector<bool> found(m_propertyDefinitions.count(), false);
+    for (uint32_t drmPropIndex = 0; drmPropIndex < properties->count_props; drmPropIndex++) {
+        const uint32_t propId = properties->props[drmPropIndex];
+        const uint64_t value = properties->prop_values[drmPropIndex];
+        int propIndex = -1;
+        for (int i = 0; i < m_props.count(); i++) {
+            if (m_props[i] && m_props[i]->propId() == propId) {
+                propIndex = i;
+                break;
+            }
+        }
+        if (propIndex != -1) {
+            m_props[propIndex]->setCurrent(value);
+            found[propIndex] = true;
+            continue;
+        }
+
+        const QByteArray name = m_gpu->propertyName(propId);
+        if (name.isEmpty()) {
+            qCWarning(KWIN_DRM, "Getting property %d of object %d failed!", drmPropIndex, m_id);
+            continue;
+        }
+        for (int i = 0; i < m_propertyDefinitions.count(); i++) {
+            if (m_propertyDefinitions[i].name != name) {
                 continue;
             }
-            if (def.name == prop->name) {
-                if (m_props[propIndex]) {
-                    m_props[propIndex]->setCurrent(properties->prop_values[drmPropIndex]);
-                } else {
-                    m_props[propIndex] = new DrmProperty(this, prop.data(), properties->prop_values[drmPropIndex], def.enumNames);
-                }
-                found = true;
-                break;
+            DrmScopedPointer<drmModePropertyRes> prop(drmModeGetProperty(m_gpu->fd(), propId));
+            if (prop) {
+                delete m_props[i];
+                m_props[i] = new DrmProperty(this, prop.data(), value, m_propertyDefinitions[i].enumNames);
+                found[i] = true;
             }
+            break;
         }
-        if (!found) {
+    }
+    for (int propIndex = 0; propIndex < m_propertyDefinitions.count(); propIndex++) {
+        if (!found[propIndex]) {
             deleteProp(propIndex);
         }
     }
@@ -281,12 +281,32 @@ Output::RgbRange DrmConnector::rgbRange() const
     return rgb->enumForValue<Output::RgbRange>(rgb->pending());
 }
 
+static Edid parseEdid(const drmModePropertyBlobRes *blob)
+{
+    // Monitors come back after hotplugs and VT switches, and looking up the vendor name
+    // means reading the whole PNP ID database.
+    static QHash<QByteArray, Edid> cache;
+    const QByteArray raw(static_cast<const char *>(blob->data), blob->length);
+    auto it = cache.constFind(raw);
+    if (it == cache.constEnd()) {
+        it = cache.insert(raw, Edid(blob->data, blob->length));
+    }
+    return *it;
+}
+
 bool DrmConnector::updateProperties()
 {
     if (!DrmObject::updateProperties()) {
         return false;
     }
-    m_conn.reset(drmModeGetConnector(gpu()->fd(), id()));
+    // Probing a connector can take a long time, only do it if it may have changed. The current
+    // state only has the modes the kernel knows about, which may be none for a connector that
+    // has never been probed or got connected without it
+    if (!m_conn || m_conn->count_modes == 0 || gpu()->shouldProbeConnector(id())) {
+        m_conn.reset(drmModeGetConnector(gpu()->fd(), id()));
+    } else {
+        m_conn.reset(drmModeGetConnectorCurrent(gpu()->fd(), id()));
+    }
     if (!m_conn) {
         return false;
     }
@@ -307,7 +327,7 @@ bool DrmConnector::updateProperties()
 
     // parse edid
     if (const auto edidProp = getProp(PropertyIndex::Edid); edidProp && edidProp->immutableBlob()) {
-        m_edid = Edid(edidProp->immutableBlob()->data, edidProp->immutableBlob()->length);
+        m_edid = parseEdid(edidProp->immutableBlob());
         if (!m_edid.isValid()) {
             qCWarning(KWIN_DRM) << "Couldn't parse EDID for connector" << this;
         }
@@ -14,6 +14,7 @@
 #include "drm_pointer.h"
 #include "logging.h"
 #include <cerrno>
+#include <cstring>
 
 namespace KWin
 {
@@ -52,8 +53,39 @@ bool DrmCrtc::needsModeset() const
     if (!gpu()->atomicModeSetting()) {
         return false;
     }
-    return getProp(PropertyIndex::Active)->needsCommit()
-        || getProp(PropertyIndex::ModeId)->needsCommit();
+    if (getProp(PropertyIndex::Active)->needsCommit()) {
+        return true;
+    }
+    // After a VT switch or resume the kernel may hold a different blob for the same mode,
+    // committing the new blob doesn't need a modeset then
+    const DrmProperty *modeId = getProp(PropertyIndex::ModeId);
+    return modeId->needsCommit() && !isSameMode(modeId->current(), modeId->pending());
+}
+
+bool DrmCrtc::isSameMode(uint32_t blobA, uint32_t blobB) const
+{
+    if (!blobA || !blobB) {
+        return false;
+    }
+    if (m_sameModeBlobs == std::make_pair(blobA, blobB)) {
+        return true;
+    }
+    const DrmScopedPointer<drmModePropertyBlobRes> a(drmModeGetPropertyBlob(gpu()->fd(), blobA));
+    const DrmScopedPointer<drmModePropertyBlobRes> b(drmModeGetPropertyBlob(gpu()->fd(), blobB));
+    if (!a || !b || a->length != sizeof(drmModeModeInfo) || b->length != sizeof(drmModeModeInfo)) {
+        return false;
+    }
+    auto modeA = *static_cast<const drmModeModeInfo *>(a->data);
+    auto modeB = *static_cast<const drmModeModeInfo *>(b->data);
+    // the name and the preferred flag don't affect the timings
+    modeA.type = modeB.type = 0;
+    std::memset(modeA.name, 0, sizeof(modeA.name));
+    std::memset(modeB.name, 0, sizeof(modeB.name));
+    if (std::memcmp(&modeA, &modeB, sizeof(drmModeModeInfo)) != 0) {
+        return false;
+    }
+    m_sameModeBlobs = std::make_pair(blobA, blobB);
+    return true;
 }
 
 int DrmCrtc::pipeIndex() const
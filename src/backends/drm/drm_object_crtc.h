@@ -56,7 +56,11 @@ public:
     void releaseBuffers();
 
 private:
+    bool isSameMode(uint32_t blobA, uint32_t blobB) const;
+
     DrmScopedPointer<drmModeCrtc> m_crtc;
+    // the last pair of mode blobs that were found to describe the same mode
+    mutable std::pair<uint32_t, uint32_t> m_sameModeBlobs{0, 0};
     std::shared_ptr<DrmFramebuffer> m_currentBuffer;
     std::shared_ptr<DrmFramebuffer> m_nextBuffer;
     int m_pipeIndex;
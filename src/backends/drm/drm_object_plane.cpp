@@ -35,6 +35,7 @@ DrmPlane::DrmPlane(DrmGpu *gpu, uint32_t planeId)
                                   PropertyDefinition(QByteArrayLiteral("CRTC_ID"), Requirement::Required),
                                   PropertyDefinition(QByteArrayLiteral("rotation"), Requirement::Optional, {QByteArrayLiteral("rotate-0"), QByteArrayLiteral("rotate-90"), QByteArrayLiteral("rotate-180"), QByteArrayLiteral("rotate-270"), QByteArrayLiteral("reflect-x"), QByteArrayLiteral("reflect-y")}),
                                   PropertyDefinition(QByteArrayLiteral("IN_FORMATS"), Requirement::Optional),
+                                  PropertyDefinition(QByteArrayLiteral("zpos"), Requirement::Optional),
                               },
                 DRM_MODE_OBJECT_PLANE)
 {
@@ -170,6 +171,17 @@ bool DrmPlane::isCrtcSupported(int pipeIndex) const
     return (m_possibleCrtcs & (1 << pipeIndex));
 }
 
+bool DrmPlane::canBeStackedAbove(const DrmPlane *other) const
+{
+    const DrmProperty *zpos = getProp(PropertyIndex::Zpos);
+    const DrmProperty *otherZpos = other->getProp(PropertyIndex::Zpos);
+    if (!zpos || !otherZpos) {
+        return true;
+    }
+    const uint64_t highest = zpos->isImmutable() ? zpos->current() : zpos->maxValue();
+    return highest > otherZpos->current();
+}
+
 QMap<uint32_t, QVector<uint64_t>> DrmPlane::formats() const
 {
     return m_supportedFormats;
@@ -42,6 +42,7 @@ public:
         CrtcId,
         Rotation,
         In_Formats,
+        Zpos,
         Count
     };
     Q_ENUM(PropertyIndex)
@@ -71,6 +72,11 @@ public:
     TypeIndex type() const;
 
     bool isCrtcSupported(int pipeIndex) const;
+    /**
+     * Returns @c true if the plane can be stacked above @a other. Without zpos properties,
+     * overlay planes are assumed to be above the primary plane.
+     */
+    bool canBeStackedAbove(const DrmPlane *other) const;
     QMap<uint32_t, QVector<uint64_t>> formats() const;
 
     std::shared_ptr<DrmFramebuffer> current() const;
@@ -14,6 +14,7 @@
 #include "drm_object_crtc.h"
 #include "drm_pipeline.h"
 
+#include "colors/colortransformation.h"
 #include "composite.h"
 #include "cursor.h"
 #include "drm_dumb_buffer.h"
@@ -50,7 +51,7 @@ DrmOutput::DrmOutput(DrmPipeline *pipeline)
 {
     m_pipeline->setOutput(this);
     const auto conn = m_pipeline->connector();
-    m_renderLoop->setRefreshRate(m_pipeline->mode()->refreshRate());
+    updateRefreshRate();
 
     Capabilities capabilities = Capability::Dpms;
     if (conn->hasOverscan()) {
@@ -280,6 +281,14 @@ DrmPlane::Transformations outputToPlaneTransform(DrmOutput::Transform transform)
     }
 }
 
+void DrmOutput::updateRefreshRate()
+{
+    m_renderLoop->setRefreshRate(m_pipeline->mode()->refreshRate());
+    // the monitor behind the connector may have changed along with the mode
+    const int minimumRefreshRate = m_connector->vrrCapable() && m_connector->edid() ? m_connector->edid()->minimumRefreshRate() : 0;
+    m_renderLoop->setMinimumRefreshRate(minimumRefreshRate * 1000);
+}
+
 void DrmOutput::updateModes()
 {
     const QList<QSharedPointer<OutputMode>> modes = getModes();
@@ -291,7 +300,7 @@ void DrmOutput::updateModes()
             m_pipeline->setMode(currentMode ? currentMode : m_pipeline->connector()->modes().constFirst());
             if (m_gpu->testPendingConfiguration()) {
                 m_pipeline->applyPendingChanges();
-                m_renderLoop->setRefreshRate(m_pipeline->mode()->refreshRate());
+                updateRefreshRate();
             } else {
                 qCWarning(KWIN_DRM) << "Setting changed mode failed!";
                 m_pipeline->revertPendingChanges();
@@ -307,17 +316,35 @@ void DrmOutput::updateModes()
     setModesInternal(modes, currentMode);
 }
 
+bool DrmOutput::updateSyncMode(RenderLoopPrivate::SyncMode syncMode)
+{
+    if (m_pipeline->syncMode() == syncMode) {
+        return true;
+    }
+    m_pipeline->setSyncMode(syncMode);
+    if (DrmPipeline::commitPipelines({m_pipeline}, DrmPipeline::CommitMode::Test)) {
+        m_pipeline->applyPendingChanges();
+        return true;
+    } else {
+        m_pipeline->revertPendingChanges();
+        return false;
+    }
+}
+
 bool DrmOutput::present()
 {
     RenderLoopPrivate *renderLoopPrivate = RenderLoopPrivate::get(m_renderLoop);
-    if (m_pipeline->syncMode() != renderLoopPrivate->presentMode) {
-        m_pipeline->setSyncMode(renderLoopPrivate->presentMode);
-        if (DrmPipeline::commitPipelines({m_pipeline}, DrmPipeline::CommitMode::Test)) {
-            m_pipeline->applyPendingChanges();
-        } else {
-            m_pipeline->revertPendingChanges();
+    RenderLoopPrivate::SyncMode syncMode = renderLoopPrivate->presentMode;
+    if (syncMode == RenderLoopPrivate::SyncMode::Async) {
+        // Only the surface that has asked for tearing may tear, so it has to be scanned out directly.
+        if (!gpu()->asyncPageflipSupported() || !m_pipeline->primaryLayer()->hasDirectScanoutBuffer()) {
+            syncMode = renderLoopPrivate->synchronizedPresentMode();
         }
     }
+    if (!updateSyncMode(syncMode) && syncMode == RenderLoopPrivate::SyncMode::Async) {
+        // the driver doesn't accept an async flip of this buffer
+        updateSyncMode(renderLoopPrivate->synchronizedPresentMode());
+    }
     bool modeset = gpu()->needsModeset();
     if (modeset ? m_pipeline->maybeModeset() : m_pipeline->present()) {
         Q_EMIT outputChange(m_pipeline->primaryLayer()->currentDamage());
@@ -342,7 +369,7 @@ DrmPipeline *DrmOutput::pipeline() const
 bool DrmOutput::queueChanges(const OutputConfiguration &config)
 {
     static bool valid;
-    static int envOnlySoftwareRotations = qEnvironmentVariableIntValue("KWIN_DRM_SW_ROTATIONS_ONLY", &valid) == 1 || !valid;
+    static int envOnlySoftwareRotations = qEnvironmentVariableIntValue("KWIN_DRM_SW_ROTATIONS_ONLY", &valid) == 1 && valid;
 
     const auto props = config.constChangeSet(this);
     m_pipeline->setActive(props->enabled);
@@ -357,9 +384,19 @@ bool DrmOutput::queueChanges(const OutputConfiguration &config)
     m_pipeline->setMode(*it);
     m_pipeline->setOverscan(props->overscan);
     m_pipeline->setRgbRange(props->rgbRange);
+    const DrmPlane::Transformations previousOrientation = m_pipeline->renderOrientation();
     m_pipeline->setRenderOrientation(outputToPlaneTransform(props->transform));
-    if (!envOnlySoftwareRotations && m_gpu->atomicModeSetting()) {
-        m_pipeline->setBufferOrientation(m_pipeline->renderOrientation());
+    // try rotating with the primary plane to avoid the shadow buffer. If the crtc assignment
+    // can't be tested with it, DrmGpu::testPendingConfiguration falls back to software rotation
+    const bool planeSupportsRotation = !m_pipeline->crtc() || (m_pipeline->crtc()->primaryPlane()->supportedTransformations() & m_pipeline->renderOrientation());
+    // Unless the orientation changes, whatever rotation the last test settled on is kept,
+    // so unrelated changes don't need a new test.
+    if (m_pipeline->renderOrientation() != previousOrientation || m_pipeline->enabled() != props->enabled) {
+        if (!envOnlySoftwareRotations && m_gpu->atomicModeSetting() && planeSupportsRotation) {
+            m_pipeline->setBufferOrientation(m_pipeline->renderOrientation());
+        } else {
+            m_pipeline->setBufferOrientation(DrmPlane::Transformation::Rotate0);
+        }
     }
     m_pipeline->setEnable(props->enabled);
     return true;
@@ -384,7 +421,7 @@ void DrmOutput::applyQueuedChanges(const OutputConfiguration &config)
 
     const auto mode = m_pipeline->mode();
     setCurrentModeInternal(mode);
-    m_renderLoop->setRefreshRate(mode->refreshRate());
+    updateRefreshRate();
     setOverscanInternal(m_pipeline->overscan());
     setRgbRangeInternal(m_pipeline->rgbRange());
     setVrrPolicy(props->vrrPolicy);
@@ -412,13 +449,33 @@ DrmOutputLayer *DrmOutput::outputLayer() const
 
 void DrmOutput::setColorTransformation(const QSharedPointer<ColorTransformation> &transformation)
 {
-    m_pipeline->setColorTransformation(transformation);
+    const DrmCrtc *crtc = m_pipeline->currentCrtc();
+    if (transformation && transformation->isPerChannel() && crtc && crtc->gammaRampSize() > 0) {
+        // With atomic modesetting, swapping a gamma ramp the kernel already accepted for another
+        // one of the same size can't make the commit fail, so it doesn't need a test commit of its
+        // own and simply goes out with the next page flip. This keeps night color transitions cheap.
+        // Legacy page flips don't carry the gamma ramp, it's only written by the commit below.
+        const bool gammaRampAccepted = m_gpu->atomicModeSetting() && m_pipeline->colorTransformation() && m_pipeline->crtc() == crtc;
+        m_pipeline->setColorTransformation(transformation);
+        if (gammaRampAccepted || DrmPipeline::commitPipelines({m_pipeline}, DrmPipeline::CommitMode::Test)) {
+            m_pipeline->applyPendingChanges();
+            setCompositedColorTransformation(nullptr);
+            m_renderLoop->scheduleRepaint();
+            return;
+        }
+        m_pipeline->revertPendingChanges();
+    }
+
+    // Gamma ramps can only express transformations that don't mix the color channels,
+    // anything else is left to the compositor.
+    m_pipeline->setColorTransformation(nullptr);
     if (DrmPipeline::commitPipelines({m_pipeline}, DrmPipeline::CommitMode::Test)) {
         m_pipeline->applyPendingChanges();
-        m_renderLoop->scheduleRepaint();
     } else {
         m_pipeline->revertPendingChanges();
     }
+    setCompositedColorTransformation(transformation);
+    m_renderLoop->scheduleRepaint();
 }
 
 void DrmOutput::renderCursorOpengl(const RenderTarget &renderTarget, const QSize &cursorSize)
@@ -12,6 +12,7 @@
 #include "drm_abstract_output.h"
 #include "drm_object.h"
 #include "drm_object_plane.h"
+#include "renderloop_p.h"
 
 #include <QObject>
 #include <QPoint>
@@ -57,6 +58,8 @@ public:
     void setColorTransformation(const QSharedPointer<ColorTransformation> &transformation) override;
 
 private:
+    bool updateSyncMode(RenderLoopPrivate::SyncMode syncMode);
+    void updateRefreshRate();
     void updateEnablement(bool enable) override;
     bool setDrmDpmsMode(DpmsMode mode);
     void setDpmsMode(DpmsMode mode) override;
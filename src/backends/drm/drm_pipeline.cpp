@@ -15,6 +15,7 @@
 #include "drm_backend.h"
 #include "drm_buffer.h"
 #include "drm_buffer_gbm.h"
+#include "drm_commit_thread.h"
 #include "drm_gpu.h"
 #include "drm_layer.h"
 #include "drm_object_connector.h"
@@ -25,6 +26,7 @@
 #include "logging.h"
 #include "session.h"
 
+#include <algorithm>
 #include <drm_fourcc.h>
 #include <gbm.h>
 
@@ -41,11 +43,71 @@ DrmPipeline::DrmPipeline(DrmConnector *conn)
 
 DrmPipeline::~DrmPipeline()
 {
-    if (m_pageflipPending && m_current.crtc) {
+    m_presentPending = false;
+    m_groupPresentPending = false;
+    m_cursorUpdatePending = false;
+    if ((m_pageflipPending || m_cursorFlipPending) && m_current.crtc) {
         pageFlipped({});
     }
 }
 
+// how long before the predicted vblank late commits are passed to the kernel
+static const std::chrono::microseconds s_lateCommitMargin(1500);
+
+static bool lateCommitsEnabled()
+{
+    static bool valid;
+    static const bool enabled = qEnvironmentVariableIntValue("KWIN_DRM_LATE_COMMIT", &valid) == 1 && valid;
+    return enabled;
+}
+
+std::chrono::nanoseconds DrmPipeline::lateCommitDeadline(const QVector<DrmPipeline *> &pipelines)
+{
+    if (!lateCommitsEnabled()) {
+        return std::chrono::nanoseconds::zero();
+    }
+    std::chrono::nanoseconds deadline = std::chrono::nanoseconds::max();
+    for (const auto &pipeline : pipelines) {
+        // with adaptive sync or tearing, there is no vblank to wait for
+        if (!pipeline->m_output || pipeline->m_pending.syncMode != RenderLoopPrivate::SyncMode::Fixed) {
+            return std::chrono::nanoseconds::zero();
+        }
+        deadline = std::min(deadline, pipeline->m_output->renderLoop()->nextPresentationTimestamp() - s_lateCommitMargin);
+    }
+    return deadline;
+}
+
+static bool outputGroupsEnabled()
+{
+    static bool valid;
+    static const bool enabled = qEnvironmentVariableIntValue("KWIN_DRM_OUTPUT_GROUPS", &valid) == 1 && valid;
+    return enabled;
+}
+
+static uint32_t preferredMaxBpc(DrmConnector *connector, const QSharedPointer<DrmConnectorMode> &mode)
+{
+    auto backend = dynamic_cast<EglGbmBackend *>(connector->gpu()->platform()->renderBackend());
+    if (!backend || !backend->prefer10bpc()) {
+        return 8;
+    }
+    // don't bother testing deep color if the EDID already says that it can't work
+    const Edid *edid = connector->edid();
+    if (edid->bitsPerColor() != 0 && edid->bitsPerColor() < 10) {
+        return 8;
+    }
+    if (mode && edid->maxTmdsClock() != 0 && mode->nativeMode()->clock * 10 / 8 > uint32_t(edid->maxTmdsClock())) {
+        return 8;
+    }
+    return 10;
+}
+
+static bool cursorCommitsEnabled()
+{
+    static bool valid;
+    static const bool disabled = qEnvironmentVariableIntValue("KWIN_DRM_NO_CURSOR_COMMITS", &valid) == 1 && valid;
+    return !disabled;
+}
+
 bool DrmPipeline::testScanout()
 {
     // TODO make the modeset check only be tested at most once per scanout cycle
@@ -65,6 +127,20 @@ bool DrmPipeline::present()
 {
     Q_ASSERT(m_pending.crtc);
     if (gpu()->atomicModeSetting()) {
+        if (m_cursorFlipPending) {
+            // the kernel only accepts one commit per vblank. If the cursor commit is still queued,
+            // the frame is latched into it, otherwise it's committed once the cursor update is done
+            if (!commitPipelines({this}, CommitMode::Test)) {
+                return false;
+            }
+            if (!amendQueuedPresent()) {
+                m_presentPending = true;
+            }
+            return true;
+        }
+        if (outputGroupsEnabled()) {
+            return presentGroup();
+        }
         return commitPipelines({this}, CommitMode::Commit);
     } else {
         if (m_pending.layer->hasDirectScanoutBuffer()) {
@@ -78,6 +154,86 @@ bool DrmPipeline::present()
     return true;
 }
 
+QVector<DrmPipeline *> DrmPipeline::outputGroup() const
+{
+    const auto isGroupable = [](const DrmPipeline *pipeline) {
+        return pipeline->m_output && pipeline->activePending() && !pipeline->m_cursorFlipPending
+            && pipeline->m_pending.syncMode == RenderLoopPrivate::SyncMode::Fixed;
+    };
+    if (!isGroupable(this)) {
+        return {const_cast<DrmPipeline *>(this)};
+    }
+    QVector<DrmPipeline *> group;
+    const auto pipelines = gpu()->pipelines();
+    for (DrmPipeline *pipeline : pipelines) {
+        if (isGroupable(pipeline) && pipeline->m_pending.mode->refreshRate() == m_pending.mode->refreshRate()) {
+            group << pipeline;
+        }
+    }
+    return group;
+}
+
+bool DrmPipeline::presentGroup()
+{
+    const QVector<DrmPipeline *> group = outputGroup();
+    if (group.size() < 2) {
+        return commitPipelines({this}, CommitMode::Commit);
+    }
+    if (!commitPipelines({this}, CommitMode::Test)) {
+        return false;
+    }
+    m_groupPresentPending = true;
+    bool complete = true;
+    for (DrmPipeline *pipeline : group) {
+        if (!pipeline->m_groupPresentPending) {
+            // keep the render loops of the group in lockstep
+            pipeline->m_output->renderLoop()->scheduleRepaint();
+            complete = false;
+        }
+    }
+    if (!complete) {
+        return true;
+    }
+    for (DrmPipeline *pipeline : group) {
+        pipeline->m_groupPresentPending = false;
+    }
+    if (commitPipelines(group, CommitMode::Commit)) {
+        return true;
+    }
+    // the other outputs of the group have already reported their frame as presented
+    for (DrmPipeline *pipeline : group) {
+        if (pipeline != this) {
+            pipeline->m_output->frameFailed();
+        }
+    }
+    return false;
+}
+
+void DrmPipeline::flushGroupPresents(const QVector<DrmPipeline *> &pipelines)
+{
+    for (DrmPipeline *pipeline : pipelines) {
+        if (!pipeline->m_groupPresentPending) {
+            continue;
+        }
+        const QVector<DrmPipeline *> group = pipeline->outputGroup();
+        const bool complete = std::all_of(group.begin(), group.end(), [](const DrmPipeline *member) {
+            return member->m_groupPresentPending;
+        });
+        if (!complete) {
+            continue;
+        }
+        for (DrmPipeline *member : group) {
+            member->m_groupPresentPending = false;
+        }
+        if (!commitPipelines(group, CommitMode::Commit)) {
+            // all outputs of the group have already reported their frame as presented
+            for (DrmPipeline *member : group) {
+                member->m_output->frameFailed();
+            }
+        }
+    }
+}
+
 bool DrmPipeline::maybeModeset()
 {
     m_modesetPresentPending = true;
@@ -150,9 +306,26 @@ bool DrmPipeline::commitPipelinesAtomic(const QVector<DrmPipeline *> &pipelines,
         qCDebug(KWIN_DRM) << "Atomic test for" << mode << "failed!" << strerror(errno);
         return failed();
     }
-    if (mode != CommitMode::Test && drmModeAtomicCommit(pipelines[0]->gpu()->fd(), req, flags, nullptr) != 0) {
-        qCCritical(KWIN_DRM) << "Atomic commit failed! This should never happen!" << strerror(errno);
-        return failed();
+    DrmCommitThread *commitThread = pipelines[0]->gpu()->commitThread();
+    if (mode == CommitMode::Commit && commitThread) {
+        // the commit has been tested, the commit thread hands it to the kernel
+        QVector<uint32_t> crtcs;
+        for (const auto &pipeline : pipelines) {
+            if (pipeline->m_pending.crtc) {
+                crtcs << pipeline->m_pending.crtc->id();
+            }
+        }
+        commitThread->addCommit(req, flags, crtcs, lateCommitDeadline(pipelines));
+        req = nullptr;
+    } else if (mode != CommitMode::Test) {
+        if (commitThread) {
+            // blocking commits must not overtake the queued ones
+            commitThread->waitIdle();
+        }
+        if (drmModeAtomicCommit(pipelines[0]->gpu()->fd(), req, flags, nullptr) != 0) {
+            qCCritical(KWIN_DRM) << "Atomic commit failed! This should never happen!" << strerror(errno);
+            return failed();
+        }
     }
     for (const auto &pipeline : pipelines) {
         pipeline->atomicCommitSuccessful(mode);
@@ -176,9 +349,15 @@ bool DrmPipeline::populateAtomicValues(drmModeAtomicReq *req, uint32_t &flags)
     }
     if (activePending()) {
         flags |= DRM_MODE_PAGE_FLIP_EVENT;
+        if (m_pending.syncMode == RenderLoopPrivate::SyncMode::Async && !m_pending.needsModeset) {
+            flags |= DRM_MODE_PAGE_FLIP_ASYNC;
+        }
+    }
+    if (m_pending.needsModeset && !prepareAtomicModeset()) {
+        return false;
     }
-    if (m_pending.needsModeset) {
-        prepareAtomicModeset();
+    if (flags & DRM_MODE_PAGE_FLIP_ASYNC) {
+        return populateAsyncFlip(req);
     }
     if (m_pending.crtc) {
         m_pending.crtc->setPending(DrmCrtc::PropertyIndex::VrrEnabled, m_pending.syncMode == RenderLoopPrivate::SyncMode::Adaptive);
@@ -196,6 +375,33 @@ bool DrmPipeline::populateAtomicValues(drmModeAtomicReq *req, uint32_t &flags)
             m_pending.crtc->cursorPlane()->setPending(DrmPlane::PropertyIndex::CrtcId, active ? m_pending.crtc->id() : 0);
         }
     }
+    const auto planes = overlayPlanes();
+    for (DrmPlane *plane : planes) {
+        plane->disable();
+    }
+    if (m_pending.crtc && activePending()) {
+        const DrmProperty *primaryZpos = m_pending.crtc->primaryPlane()->getProp(DrmPlane::PropertyIndex::Zpos);
+        for (int i = 0; i < m_pending.overlays.size(); i++) {
+            const Overlay &overlay = m_pending.overlays[i];
+            overlay.plane->set(overlay.sourceRect.topLeft(), overlay.sourceRect.size(), overlay.destinationRect.topLeft(), overlay.destinationRect.size());
+            if (overlay.plane->getProp(DrmPlane::PropertyIndex::Rotation)) {
+                overlay.plane->setTransformation(DrmPlane::Transformation::Rotate0);
+            }
+            // the overlays don't overlap each other, they only have to be above the primary plane
+            DrmProperty *zpos = overlay.plane->getProp(DrmPlane::PropertyIndex::Zpos);
+            if (zpos && !zpos->isImmutable()) {
+                const uint64_t bottom = primaryZpos ? primaryZpos->current() + 1 : zpos->minValue();
+                zpos->setPending(std::clamp(bottom + i, zpos->minValue(), zpos->maxValue()));
+            }
+            overlay.plane->setBuffer(overlay.buffer.get());
+            overlay.plane->setPending(DrmPlane::PropertyIndex::CrtcId, m_pending.crtc->id());
+        }
+    }
+    for (DrmPlane *plane : planes) {
+        if (!plane->atomicPopulate(req)) {
+            return false;
+        }
+    }
     if (!m_connector->atomicPopulate(req)) {
         return false;
     }
@@ -213,11 +419,25 @@ bool DrmPipeline::populateAtomicValues(drmModeAtomicReq *req, uint32_t &flags)
     return true;
 }
 
-void DrmPipeline::prepareAtomicModeset()
+bool DrmPipeline::populateAsyncFlip(drmModeAtomicReq *req)
+{
+    // Async page flips may only change the framebuffer of the primary plane. Everything else,
+    // like the cursor, the overlays or the gamma ramp, waits for the next synchronized flip.
+    DrmPlane *plane = m_pending.crtc->primaryPlane();
+    plane->setBuffer(m_pending.layer->currentBuffer().get());
+    const DrmProperty *fbId = plane->getProp(DrmPlane::PropertyIndex::FbId);
+    if (drmModeAtomicAddProperty(req, plane->id(), fbId->propId(), fbId->pending()) <= 0) {
+        qCWarning(KWIN_DRM) << "Adding the framebuffer to the async commit failed" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool DrmPipeline::prepareAtomicModeset()
 {
     if (!m_pending.crtc) {
         m_connector->setPending(DrmConnector::PropertyIndex::CrtcId, 0);
-        return;
+        return true;
     }
 
     m_connector->setPending(DrmConnector::PropertyIndex::CrtcId, activePending() ? m_pending.crtc->id() : 0);
@@ -236,21 +456,22 @@ void DrmPipeline::prepareAtomicModeset()
         m_connector->getProp(DrmConnector::PropertyIndex::Underscan_hborder)->setPending(hborder);
     }
     if (const auto bpc = m_connector->getProp(DrmConnector::PropertyIndex::MaxBpc)) {
-        uint64_t preferred = 8;
-        if (auto backend = dynamic_cast<EglGbmBackend *>(gpu()->platform()->renderBackend()); backend && backend->prefer10bpc()) {
-            preferred = 10;
-        }
-        bpc->setPending(std::min(bpc->maxValue(), preferred));
+        bpc->setPending(std::min(bpc->maxValue(), uint64_t(m_pending.maxBpc)));
     }
 
     m_pending.crtc->setPending(DrmCrtc::PropertyIndex::Active, activePending());
     m_pending.crtc->setPending(DrmCrtc::PropertyIndex::ModeId, activePending() ? m_pending.mode->blobId() : 0);
 
     m_pending.crtc->primaryPlane()->setPending(DrmPlane::PropertyIndex::CrtcId, activePending() ? m_pending.crtc->id() : 0);
-    m_pending.crtc->primaryPlane()->setTransformation(m_pending.bufferOrientation);
+    if (!m_pending.crtc->primaryPlane()->setTransformation(m_pending.bufferOrientation)
+        && m_pending.bufferOrientation != DrmPlane::Transformations(DrmPlane::Transformation::Rotate0)) {
+        // the buffer would be shown with the wrong orientation
+        return false;
+    }
     if (m_pending.crtc->cursorPlane()) {
         m_pending.crtc->cursorPlane()->setTransformation(DrmPlane::Transformation::Rotate0);
     }
+    return true;
 }
 
 uint32_t DrmPipeline::calculateUnderscan()
@@ -268,6 +489,10 @@ uint32_t DrmPipeline::calculateUnderscan()
 
 void DrmPipeline::atomicCommitFailed()
 {
+    const auto planes = overlayPlanes();
+    for (DrmPlane *plane : planes) {
+        plane->rollbackPending();
+    }
     m_connector->rollbackPending();
     if (m_pending.crtc) {
         m_pending.crtc->rollbackPending();
@@ -280,6 +505,14 @@ void DrmPipeline::atomicCommitFailed()
 
 void DrmPipeline::atomicCommitSuccessful(CommitMode mode)
 {
+    if (activePending() && m_pending.syncMode == RenderLoopPrivate::SyncMode::Async && !m_pending.needsModeset) {
+        asyncFlipSuccessful(mode);
+        return;
+    }
+    const auto planes = overlayPlanes();
+    for (DrmPlane *plane : planes) {
+        plane->commitPending();
+    }
     m_connector->commitPending();
     if (m_pending.crtc) {
         m_pending.crtc->commitPending();
@@ -290,9 +523,12 @@ void DrmPipeline::atomicCommitSuccessful(CommitMode mode)
     }
     if (mode != CommitMode::Test) {
         m_pending.needsModeset = false;
+        m_groupPresentPending = false;
         if (activePending()) {
             m_pageflipPending = true;
         }
+        // the cursor plane is part of the commit
+        m_cursorUpdatePending = false;
         m_connector->commit();
         if (m_pending.crtc) {
             m_pending.crtc->commit();
@@ -303,6 +539,14 @@ void DrmPipeline::atomicCommitSuccessful(CommitMode mode)
                 m_pending.crtc->cursorPlane()->commit();
             }
         }
+        for (DrmPlane *plane : planes) {
+            plane->setNext(nullptr);
+            plane->commit();
+        }
+        for (const Overlay &overlay : qAsConst(m_pending.overlays)) {
+            overlay.plane->setNext(activePending() ? overlay.buffer : nullptr);
+        }
+        m_flipPendingOverlayPlanes = planes;
         m_current = m_pending;
         if (mode == CommitMode::CommitModeset && activePending()) {
             pageFlipped(std::chrono::steady_clock::now().time_since_epoch());
@@ -310,6 +554,27 @@ void DrmPipeline::atomicCommitSuccessful(CommitMode mode)
     }
 }
 
+void DrmPipeline::asyncFlipSuccessful(CommitMode mode)
+{
+    // Only the framebuffer of the primary plane was part of the commit, see populateAsyncFlip().
+    // The pending state of everything else is carried by the next synchronized commit.
+    DrmPlane *primary = m_pending.crtc->primaryPlane();
+    DrmProperty *fbId = primary->getProp(DrmPlane::PropertyIndex::FbId);
+    fbId->commitPending();
+    if (mode == CommitMode::Test) {
+        return;
+    }
+    fbId->commit();
+    primary->setNext(m_pending.layer->currentBuffer());
+    if (DrmPlane *cursor = m_pending.crtc->cursorPlane()) {
+        // the cursor plane keeps showing its current buffer after the flip
+        cursor->setNext(cursor->current());
+    }
+    m_flipPendingOverlayPlanes.clear();
+    m_groupPresentPending = false;
+    m_pageflipPending = true;
+}
+
 bool DrmPipeline::setCursor(const QPoint &hotspot)
 {
     bool result;
@@ -317,7 +582,7 @@ bool DrmPipeline::setCursor(const QPoint &hotspot)
     // explicitly check for the cursor plane and not for AMS, as we might not always have one
     if (m_pending.crtc->cursorPlane()) {
         result = commitPipelines({this}, CommitMode::Test);
-        if (result && m_output) {
+        if (result && m_output && !commitCursor()) {
             m_output->renderLoop()->scheduleRepaint();
         }
     } else {
@@ -334,15 +599,17 @@ bool DrmPipeline::setCursor(const QPoint &hotspot)
 bool DrmPipeline::moveCursor()
 {
     bool result;
+    bool committed = false;
     // explicitly check for the cursor plane and not for AMS, as we might not always have one
     if (m_pending.crtc->cursorPlane()) {
         result = commitPipelines({this}, CommitMode::Test);
+        committed = result && commitCursor();
     } else {
         result = moveCursorLegacy();
     }
     if (result) {
         m_next = m_pending;
-        if (m_output) {
+        if (m_output && !committed) {
             m_output->renderLoop()->scheduleRepaint();
         }
     } else {
@@ -351,12 +618,124 @@ bool DrmPipeline::moveCursor()
     return result;
 }
 
+bool DrmPipeline::commitCursor()
+{
+    if (!cursorCommitsEnabled() || !activePending() || m_pending.needsModeset) {
+        return false;
+    }
+    DrmPlane *plane = m_pending.crtc->cursorPlane();
+    if (m_pageflipPending && !m_cursorFlipPending && plane->needsCommit() && amendQueuedCommit(plane)) {
+        return true;
+    }
+    if (m_pageflipPending || m_cursorFlipPending) {
+        // the cursor gets updated when the pending flip is done
+        m_cursorUpdatePending = true;
+        return true;
+    }
+    if (!plane->needsCommit()) {
+        return true;
+    }
+    drmModeAtomicReq *req = drmModeAtomicAlloc();
+    if (!req) {
+        return false;
+    }
+    // only the cursor plane properties are added, so neither the primary plane nor
+    // the overlay planes have to be touched until the next frame is presented
+    const uint32_t flags = DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT;
+    if (!plane->atomicPopulate(req)) {
+        qCDebug(KWIN_DRM) << "Populating the cursor plane failed";
+        drmModeAtomicFree(req);
+        return false;
+    }
+    if (DrmCommitThread *commitThread = gpu()->commitThread()) {
+        // the cursor commit must not overtake the commits that are still queued
+        if (drmModeAtomicCommit(gpu()->fd(), req, (flags & (~DRM_MODE_PAGE_FLIP_EVENT)) | DRM_MODE_ATOMIC_TEST_ONLY, nullptr) != 0) {
+            qCDebug(KWIN_DRM) << "Atomic test for the cursor plane failed:" << strerror(errno);
+            drmModeAtomicFree(req);
+            return false;
+        }
+        // held back like the frames, so that a frame presented in the meantime can be latched into it
+        commitThread->addCommit(req, flags, {m_pending.crtc->id()}, lateCommitDeadline({this}));
+    } else {
+        if (drmModeAtomicCommit(gpu()->fd(), req, flags, nullptr) != 0) {
+            qCDebug(KWIN_DRM) << "Committing the cursor plane failed:" << strerror(errno);
+            drmModeAtomicFree(req);
+            return false;
+        }
+        drmModeAtomicFree(req);
+    }
+    plane->setNext(cursorLayer()->currentBuffer());
+    plane->commit();
+    m_cursorFlipPending = true;
+    m_cursorUpdatePending = false;
+    // the pipeline isn't part of its output group until the cursor update is done
+    flushGroupPresents(gpu()->pipelines());
+    return true;
+}
+
+bool DrmPipeline::amendQueuedCommit(DrmPlane *plane)
+{
+    DrmCommitThread *commitThread = gpu()->commitThread();
+    if (!commitThread) {
+        return false;
+    }
+    drmModeAtomicReq *req = drmModeAtomicAlloc();
+    if (!req) {
+        return false;
+    }
+    // the state including the new plane properties has been tested already, so if the
+    // commit is still waiting for its deadline, the plane update can be latched into it
+    const bool amended = plane->atomicPopulate(req) && commitThread->amendCommit(m_pending.crtc->id(), req, [this, plane]() {
+        plane->setNext(cursorLayer()->currentBuffer());
+        plane->commit();
+    });
+    drmModeAtomicFree(req);
+    return amended;
+}
+
+bool DrmPipeline::amendQueuedPresent()
+{
+    DrmCommitThread *commitThread = gpu()->commitThread();
+    if (!commitThread || m_pending.needsModeset || m_pending.syncMode == RenderLoopPrivate::SyncMode::Async) {
+        return false;
+    }
+    drmModeAtomicReq *req = drmModeAtomicAlloc();
+    if (!req) {
+        return false;
+    }
+    // the frame has been tested already, its properties are added to the queued cursor commit,
+    // which then flips everything at once
+    uint32_t flags = 0;
+    const bool amended = populateAtomicValues(req, flags) && commitThread->amendCommit(m_pending.crtc->id(), req, [this]() {
+        m_cursorFlipPending = false;
+        atomicCommitSuccessful(CommitMode::Commit);
+    });
+    drmModeAtomicFree(req);
+    return amended;
+}
+
+void DrmPipeline::commitPendingCursor()
+{
+    if (!m_cursorUpdatePending) {
+        return;
+    }
+    if (m_output && RenderLoopPrivate::get(m_output->renderLoop())->compositeTimer.isActive()) {
+        // the next frame is about to be rendered, it will contain the cursor update
+        return;
+    }
+    if (!commitCursor() && m_output) {
+        m_cursorUpdatePending = false;
+        m_output->renderLoop()->scheduleRepaint();
+    }
+}
+
 void DrmPipeline::applyPendingChanges()
 {
     if (!m_pending.crtc) {
         m_pending.active = false;
     }
     m_next = m_pending;
+    flushGroupPresents(gpu()->pipelines());
 }
 
 QSize DrmPipeline::bufferSize() const
@@ -378,8 +757,24 @@ DrmGpu *DrmPipeline::gpu() const
     return m_connector->gpu();
 }
 
-void DrmPipeline::pageFlipped(std::chrono::nanoseconds timestamp)
+void DrmPipeline::pageFlipped(std::chrono::nanoseconds timestamp, std::optional<uint32_t> sequence)
 {
+    if (m_cursorFlipPending) {
+        m_cursorFlipPending = false;
+        if (m_current.crtc->cursorPlane()) {
+            m_current.crtc->cursorPlane()->flipBuffer();
+        }
+        if (m_presentPending) {
+            m_presentPending = false;
+            if (!commitPipelines({this}, CommitMode::Commit) && m_output) {
+                qCWarning(KWIN_DRM) << "Presentation failed!" << strerror(errno);
+                m_output->frameFailed();
+            }
+        } else {
+            commitPendingCursor();
+        }
+        return;
+    }
     m_current.crtc->flipBuffer();
     if (m_current.crtc->primaryPlane()) {
         m_current.crtc->primaryPlane()->flipBuffer();
@@ -387,9 +782,52 @@ void DrmPipeline::pageFlipped(std::chrono::nanoseconds timestamp)
     if (m_current.crtc->cursorPlane()) {
         m_current.crtc->cursorPlane()->flipBuffer();
     }
+    for (DrmPlane *plane : qAsConst(m_flipPendingOverlayPlanes)) {
+        plane->flipBuffer();
+    }
+    m_flipPendingOverlayPlanes.clear();
+    m_pageflipPending = false;
+    if (m_output) {
+        m_output->pageFlipped(timestamp, sequence);
+    }
+    commitPendingCursor();
+}
+
+void DrmPipeline::queuedCommitFailed()
+{
+    // the buffers and property values of the commit never reached the kernel,
+    // read back what is actually being used
+    if (m_current.crtc) {
+        m_current.crtc->updateProperties();
+        m_current.crtc->primaryPlane()->setNext(nullptr);
+        m_current.crtc->primaryPlane()->updateProperties();
+        if (m_current.crtc->cursorPlane()) {
+            m_current.crtc->cursorPlane()->setNext(nullptr);
+            m_current.crtc->cursorPlane()->updateProperties();
+        }
+    }
+    for (DrmPlane *plane : qAsConst(m_flipPendingOverlayPlanes)) {
+        plane->setNext(nullptr);
+        plane->updateProperties();
+    }
+    m_flipPendingOverlayPlanes.clear();
+    if (m_cursorFlipPending) {
+        // it was a cursor-only commit, the postponed present can go ahead
+        m_cursorFlipPending = false;
+        m_cursorUpdatePending = true;
+        if (m_presentPending) {
+            m_presentPending = false;
+            if (!commitPipelines({this}, CommitMode::Commit) && m_output) {
+                m_output->frameFailed();
+            }
+        } else {
+            commitPendingCursor();
+        }
+        return;
+    }
     m_pageflipPending = false;
     if (m_output) {
-        m_output->pageFlipped(timestamp);
+        m_output->frameFailed();
     }
 }
 
@@ -408,6 +846,11 @@ QMap<uint32_t, QVector<uint64_t>> DrmPipeline::formats() const
     return m_pending.formats;
 }
 
+uint32_t DrmPipeline::maxBpc() const
+{
+    return m_pending.maxBpc;
+}
+
 QMap<uint32_t, QVector<uint64_t>> DrmPipeline::cursorFormats() const
 {
     if (m_pending.crtc && m_pending.crtc->cursorPlane()) {
@@ -432,6 +875,16 @@ bool DrmPipeline::pruneModifier()
     return true;
 }
 
+bool DrmPipeline::pruneColorDepth()
+{
+    if (m_pending.maxBpc <= 8 || !gpu()->atomicModeSetting()) {
+        return false;
+    }
+    // the formats stay, the display engine dithers deep color buffers down to the link depth
+    m_pending.maxBpc = 8;
+    return true;
+}
+
 bool DrmPipeline::needsModeset() const
 {
     return m_pending.crtc != m_current.crtc
@@ -443,6 +896,17 @@ bool DrmPipeline::needsModeset() const
         || m_modesetPresentPending;
 }
 
+bool DrmPipeline::hasPendingChanges() const
+{
+    return m_pending.active != m_next.active
+        || m_pending.enabled != m_next.enabled
+        || m_pending.mode != m_next.mode
+        || m_pending.overscan != m_next.overscan
+        || m_pending.rgbRange != m_next.rgbRange
+        || m_pending.bufferOrientation != m_next.bufferOrientation
+        || m_pending.renderOrientation != m_next.renderOrientation;
+}
+
 bool DrmPipeline::activePending() const
 {
     return m_pending.crtc && m_pending.mode && m_pending.active;
@@ -451,11 +915,12 @@ bool DrmPipeline::activePending() const
 void DrmPipeline::revertPendingChanges()
 {
     m_pending = m_next;
+    flushGroupPresents(gpu()->pipelines());
 }
 
 bool DrmPipeline::pageflipPending() const
 {
-    return m_pageflipPending;
+    return m_pageflipPending || m_cursorFlipPending;
 }
 
 bool DrmPipeline::modesetPresentPending() const
@@ -563,6 +1028,10 @@ void DrmPipeline::printDebugInfo() const
             printProps(m_pending.crtc->cursorPlane(), PrintMode::All);
         }
     }
+    const auto planes = overlayPlanes();
+    for (DrmPlane *plane : planes) {
+        printProps(plane, PrintMode::All);
+    }
 }
 
 DrmCrtc *DrmPipeline::crtc() const
@@ -595,6 +1064,25 @@ DrmOverlayLayer *DrmPipeline::cursorLayer() const
     return m_pending.cursorLayer.get();
 }
 
+QVector<DrmPipeline::Overlay> DrmPipeline::overlays() const
+{
+    return m_pending.overlays;
+}
+
+QVector<DrmPlane *> DrmPipeline::overlayPlanes() const
+{
+    QVector<DrmPlane *> ret;
+    for (const Overlay &overlay : m_pending.overlays) {
+        ret << overlay.plane;
+    }
+    for (const Overlay &overlay : m_current.overlays) {
+        if (!ret.contains(overlay.plane)) {
+            ret << overlay.plane;
+        }
+    }
+    return ret;
+}
+
 DrmPlane::Transformations DrmPipeline::renderOrientation() const
 {
     return m_pending.renderOrientation;
@@ -623,9 +1111,13 @@ Output::RgbRange DrmPipeline::rgbRange() const
 void DrmPipeline::setCrtc(DrmCrtc *crtc)
 {
     if (crtc && m_pending.crtc && crtc->gammaRampSize() != m_pending.crtc->gammaRampSize() && m_pending.colorTransformation) {
-        m_pending.gamma = QSharedPointer<DrmGammaRamp>::create(crtc, m_pending.colorTransformation);
+        m_pending.gamma = gammaRamp(crtc, m_pending.colorTransformation);
+    }
+    if (crtc != m_pending.crtc) {
+        m_pending.overlays.clear();
     }
     m_pending.crtc = crtc;
+    m_pending.maxBpc = preferredMaxBpc(m_connector, m_pending.mode);
     if (crtc) {
         m_pending.formats = crtc->primaryPlane() ? crtc->primaryPlane()->formats() : legacyFormats;
     } else {
@@ -654,6 +1146,14 @@ void DrmPipeline::setLayers(const QSharedPointer<DrmPipelineLayer> &primaryLayer
     m_pending.cursorLayer = cursorLayer;
 }
 
+void DrmPipeline::setOverlays(const QVector<Overlay> &overlays)
+{
+    // Overlays are reassigned for every frame, they don't go through the usual
+    // test and apply cycle of the other pipeline properties.
+    m_pending.overlays = overlays;
+    m_next.overlays = overlays;
+}
+
 void DrmPipeline::setRenderOrientation(DrmPlane::Transformations orientation)
 {
     m_pending.renderOrientation = orientation;
@@ -682,6 +1182,33 @@ void DrmPipeline::setRgbRange(Output::RgbRange range)
 void DrmPipeline::setColorTransformation(const QSharedPointer<ColorTransformation> &transformation)
 {
     m_pending.colorTransformation = transformation;
-    m_pending.gamma = QSharedPointer<DrmGammaRamp>::create(m_pending.crtc, transformation);
+    if (transformation) {
+        m_pending.gamma = gammaRamp(m_pending.crtc, transformation);
+    } else {
+        m_pending.gamma.reset();
+    }
+}
+
+QSharedPointer<ColorTransformation> DrmPipeline::colorTransformation() const
+{
+    return m_pending.colorTransformation;
+}
+
+QSharedPointer<DrmGammaRamp> DrmPipeline::gammaRamp(DrmCrtc *crtc, const QSharedPointer<ColorTransformation> &transformation)
+{
+    static const int cacheSize = 16;
+    for (int i = 0; i < m_gammaRampCache.size(); i++) {
+        const auto ramp = m_gammaRampCache[i];
+        if (ramp->lut().transformation() == transformation && ramp->lut().size() == crtc->gammaRampSize()) {
+            m_gammaRampCache.move(i, 0);
+            return ramp;
+        }
+    }
+    const auto ramp = QSharedPointer<DrmGammaRamp>::create(crtc, transformation);
+    m_gammaRampCache.prepend(ramp);
+    if (m_gammaRampCache.size() > cacheSize) {
+        m_gammaRampCache.removeLast();
+    }
+    return ramp;
 }
 }
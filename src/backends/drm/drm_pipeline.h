@@ -10,11 +10,13 @@
 #pragma once
 
 #include <QPoint>
+#include <QRect>
 #include <QSharedPointer>
 #include <QSize>
 #include <QVector>
 
 #include <chrono>
+#include <optional>
 #include <xf86drmMode.h>
 
 #include "colorlut.h"
@@ -51,6 +53,19 @@ private:
 class DrmPipeline
 {
 public:
+    /**
+     * A buffer shown on an overlay plane above the primary plane
+     */
+    struct Overlay
+    {
+        DrmPlane *plane = nullptr;
+        std::shared_ptr<DrmFramebuffer> buffer;
+        // in buffer pixels
+        QRect sourceRect;
+        // in device pixels, relative to the crtc
+        QRect destinationRect;
+    };
+
     DrmPipeline(DrmConnector *conn);
     ~DrmPipeline();
 
@@ -63,6 +78,11 @@ public:
     bool maybeModeset();
 
     bool needsModeset() const;
+    /**
+     * Returns @c true if the pending state differs from the last applied one in anything
+     * that has to be tested with the kernel.
+     */
+    bool hasPendingChanges() const;
     void applyPendingChanges();
     void revertPendingChanges();
 
@@ -73,7 +93,11 @@ public:
     DrmCrtc *currentCrtc() const;
     DrmGpu *gpu() const;
 
-    void pageFlipped(std::chrono::nanoseconds timestamp);
+    void pageFlipped(std::chrono::nanoseconds timestamp, std::optional<uint32_t> sequence = std::nullopt);
+    /**
+     * Called if a commit that has been queued for the commit thread was rejected by the kernel.
+     */
+    void queuedCommitFailed();
     bool pageflipPending() const;
     bool modesetPresentPending() const;
     void resetModesetPresentPending();
@@ -86,6 +110,12 @@ public:
     QMap<uint32_t, QVector<uint64_t>> formats() const;
     QMap<uint32_t, QVector<uint64_t>> cursorFormats() const;
     bool pruneModifier();
+    /**
+     * Lowers the color depth of the link to 8 bits per color, which needs less bandwidth
+     * than deep color. The supported formats are not changed. Returns @c false if the
+     * pipeline already is at 8 bits per color.
+     */
+    bool pruneColorDepth();
 
     void setOutput(DrmOutput *output);
     DrmOutput *output() const;
@@ -96,17 +126,25 @@ public:
     bool enabled() const;
     DrmPipelineLayer *primaryLayer() const;
     DrmOverlayLayer *cursorLayer() const;
+    QVector<Overlay> overlays() const;
+    /**
+     * Returns all overlay planes this pipeline currently uses or is about to use
+     */
+    QVector<DrmPlane *> overlayPlanes() const;
     DrmPlane::Transformations renderOrientation() const;
     DrmPlane::Transformations bufferOrientation() const;
     RenderLoopPrivate::SyncMode syncMode() const;
     uint32_t overscan() const;
+    uint32_t maxBpc() const;
     Output::RgbRange rgbRange() const;
+    QSharedPointer<ColorTransformation> colorTransformation() const;
 
     void setCrtc(DrmCrtc *crtc);
     void setMode(const QSharedPointer<DrmConnectorMode> &mode);
     void setActive(bool active);
     void setEnable(bool enable);
     void setLayers(const QSharedPointer<DrmPipelineLayer> &primaryLayer, const QSharedPointer<DrmOverlayLayer> &cursorLayer);
+    void setOverlays(const QVector<Overlay> &overlays);
     void setRenderOrientation(DrmPlane::Transformations orientation);
     void setBufferOrientation(DrmPlane::Transformations orientation);
     void setSyncMode(RenderLoopPrivate::SyncMode mode);
@@ -121,10 +159,17 @@ public:
     };
     Q_ENUM(CommitMode);
     static bool commitPipelines(const QVector<DrmPipeline *> &pipelines, CommitMode mode, const QVector<DrmObject *> &unusedObjects = {});
+    /**
+     * Presents the frames that wait for the rest of their output group, if the group
+     * they are waiting for has changed and is now complete, e.g. because an output of
+     * the group got disabled, removed or switched to adaptive sync.
+     */
+    static void flushGroupPresents(const QVector<DrmPipeline *> &pipelines);
 
 private:
     bool activePending() const;
     bool isBufferForDirectScanout() const;
+    QSharedPointer<DrmGammaRamp> gammaRamp(DrmCrtc *crtc, const QSharedPointer<ColorTransformation> &transformation);
     uint32_t calculateUnderscan();
 
     // legacy only
@@ -139,7 +184,24 @@ private:
     bool populateAtomicValues(drmModeAtomicReq *req, uint32_t &flags);
     void atomicCommitFailed();
     void atomicCommitSuccessful(CommitMode mode);
-    void prepareAtomicModeset();
+    void asyncFlipSuccessful(CommitMode mode);
+    bool populateAsyncFlip(drmModeAtomicReq *req);
+    bool prepareAtomicModeset();
+    bool commitCursor();
+    void commitPendingCursor();
+    bool amendQueuedCommit(DrmPlane *plane);
+    /**
+     * Latches the pending frame into the queued cursor commit, if that hasn't been passed
+     * to the kernel yet. Returns @c false if the frame has to wait for the cursor flip.
+     */
+    bool amendQueuedPresent();
+    /**
+     * Returns the active pipelines of the gpu that are presented together with this one,
+     * those with the same refresh rate that don't use adaptive sync or tearing.
+     */
+    QVector<DrmPipeline *> outputGroup() const;
+    bool presentGroup();
+    static std::chrono::nanoseconds lateCommitDeadline(const QVector<DrmPipeline *> &pipelines);
     static bool commitPipelinesAtomic(const QVector<DrmPipeline *> &pipelines, CommitMode mode, const QVector<DrmObject *> &unusedObjects);
 
     // logging helpers
@@ -155,6 +217,19 @@ private:
 
     bool m_pageflipPending = false;
     bool m_modesetPresentPending = false;
+    // a commit that only updates the cursor plane is waiting for the next vblank
+    bool m_cursorFlipPending = false;
+    // the cursor changed while a page flip was pending
+    bool m_cursorUpdatePending = false;
+    // a present is postponed until the cursor plane commit is done
+    bool m_presentPending = false;
+    // the frame has been tested and waits for the other outputs of the group, see outputGroup()
+    bool m_groupPresentPending = false;
+    // overlay planes that got a new buffer or got disabled with the last commit
+    QVector<DrmPlane *> m_flipPendingOverlayPlanes;
+    // recently used gamma ramps, most recent first, so going back and forth between night
+    // color temperatures doesn't need new lookup tables and blobs
+    QVector<QSharedPointer<DrmGammaRamp>> m_gammaRampCache;
 
     struct State
     {
@@ -165,6 +240,8 @@ private:
         bool needsModeset = false;
         QSharedPointer<DrmConnectorMode> mode;
         uint32_t overscan = 0;
+        // the bits per color that the connector may use on the link
+        uint32_t maxBpc = 8;
         Output::RgbRange rgbRange = Output::RgbRange::Automatic;
         RenderLoopPrivate::SyncMode syncMode = RenderLoopPrivate::SyncMode::Fixed;
         QSharedPointer<ColorTransformation> colorTransformation;
@@ -173,6 +250,7 @@ private:
         QSharedPointer<DrmPipelineLayer> layer;
         QSharedPointer<DrmOverlayLayer> cursorLayer;
         QPoint cursorHotspot;
+        QVector<Overlay> overlays;
 
         // the transformation that this pipeline will apply to submitted buffers
         DrmPlane::Transformations bufferOrientation = DrmPlane::Transformation::Rotate0;
@@ -17,6 +17,7 @@
 
 #include <errno.h>
 #include <gbm.h>
+#include <vector>
 
 namespace KWin
 {
@@ -27,7 +28,11 @@ bool DrmPipeline::presentLegacy()
         return false;
     }
     const auto buffer = m_pending.layer->currentBuffer();
-    if (drmModePageFlip(gpu()->fd(), m_pending.crtc->id(), buffer->framebufferId(), DRM_MODE_PAGE_FLIP_EVENT, nullptr) != 0) {
+    uint32_t flags = DRM_MODE_PAGE_FLIP_EVENT;
+    if (m_pending.syncMode == RenderLoopPrivate::SyncMode::Async) {
+        flags |= DRM_MODE_PAGE_FLIP_ASYNC;
+    }
+    if (drmModePageFlip(gpu()->fd(), m_pending.crtc->id(), buffer->framebufferId(), flags, nullptr) != 0) {
         qCWarning(KWIN_DRM) << "Page flip failed:" << strerror(errno);
         return false;
     }
@@ -91,7 +96,7 @@ bool DrmPipeline::applyPendingChangesLegacy()
     }
     if (activePending()) {
         auto vrr = m_pending.crtc->getProp(DrmCrtc::PropertyIndex::VrrEnabled);
-        if (vrr && !vrr->setPropertyLegacy(m_pending.syncMode == RenderLoopPrivate::SyncMode::Adaptive)) {
+        if (vrr && m_pending.syncMode != RenderLoopPrivate::SyncMode::Async && !vrr->setPropertyLegacy(m_pending.syncMode == RenderLoopPrivate::SyncMode::Adaptive)) {
             qCWarning(KWIN_DRM) << "Setting vrr failed!" << strerror(errno);
             return false;
         }
@@ -109,9 +114,23 @@ bool DrmPipeline::applyPendingChangesLegacy()
         if (needsModeset() && !legacyModeset()) {
             return false;
         }
-        if (m_pending.gamma && drmModeCrtcSetGamma(gpu()->fd(), m_pending.crtc->id(), m_pending.gamma->lut().size(), m_pending.gamma->lut().red(), m_pending.gamma->lut().green(), m_pending.gamma->lut().blue()) != 0) {
-            qCWarning(KWIN_DRM) << "Setting gamma failed!" << strerror(errno);
-            return false;
+        if (m_pending.gamma) {
+            if (drmModeCrtcSetGamma(gpu()->fd(), m_pending.crtc->id(), m_pending.gamma->lut().size(), m_pending.gamma->lut().red(), m_pending.gamma->lut().green(), m_pending.gamma->lut().blue()) != 0) {
+                qCWarning(KWIN_DRM) << "Setting gamma failed!" << strerror(errno);
+                return false;
+            }
+        } else if (m_current.gamma && m_pending.crtc->gammaRampSize() > 0) {
+            // The legacy gamma ramp stays until it's replaced. Reset it, otherwise a color
+            // transformation that moved to the compositor would be applied twice
+            const int size = m_pending.crtc->gammaRampSize();
+            std::vector<uint16_t> identity(size);
+            for (int i = 0; i < size; ++i) {
+                identity[i] = size > 1 ? i * 0xffff / (size - 1) : 0xffff;
+            }
+            if (drmModeCrtcSetGamma(gpu()->fd(), m_pending.crtc->id(), size, identity.data(), identity.data(), identity.data()) != 0) {
+                qCWarning(KWIN_DRM) << "Resetting gamma failed!" << strerror(errno);
+                return false;
+            }
         }
         setCursorLegacy();
         moveCursorLegacy();
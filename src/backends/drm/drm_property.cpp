@@ -113,8 +113,8 @@ bool DrmProperty::needsCommit() const
 void DrmProperty::setCurrent(uint64_t value)
 {
     if (m_current != value) {
-        updateBlob();
         m_current = value;
+        updateBlob();
     }
 }
 
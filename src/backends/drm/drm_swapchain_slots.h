@@ -0,0 +1,102 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwineffects.h"
+#include "utils/damagejournal.h"
+
+#include <QVector>
+#include <memory>
+
+namespace KWin
+{
+
+/**
+ * The SwapchainSlots class keeps track of the buffers of a swapchain that are used in turns,
+ * their ages and the damage history, which tells what's outdated in a buffer.
+ */
+template<typename Buffer>
+class SwapchainSlots
+{
+public:
+    void append(const std::shared_ptr<Buffer> &buffer)
+    {
+        m_slots.append(Slot{
+            .buffer = buffer,
+            .age = 0,
+        });
+        m_damageJournal.setCapacity(m_slots.count());
+    }
+
+    void clear()
+    {
+        m_slots.clear();
+        m_index = 0;
+    }
+
+    bool isEmpty() const
+    {
+        return m_slots.isEmpty();
+    }
+
+    qsizetype count() const
+    {
+        return m_slots.count();
+    }
+
+    /**
+     * Returns the next buffer to use. If @a needsRepaint is set, it is filled with the region
+     * of the buffer that is outdated.
+     */
+    std::shared_ptr<Buffer> acquire(QRegion *needsRepaint)
+    {
+        if (m_slots.isEmpty()) {
+            return {};
+        }
+        m_index = (m_index + 1) % m_slots.count();
+        if (needsRepaint) {
+            *needsRepaint = m_damageJournal.accumulate(m_slots[m_index].age, infiniteRegion());
+        }
+        return m_slots[m_index].buffer;
+    }
+
+    std::shared_ptr<Buffer> current() const
+    {
+        return m_slots[m_index].buffer;
+    }
+
+    /**
+     * Marks @a buffer, which has been updated within @a damage, as the newest buffer.
+     */
+    void release(const std::shared_ptr<Buffer> &buffer, const QRegion &damage)
+    {
+        Q_ASSERT(m_slots[m_index].buffer == buffer);
+
+        for (Slot &slot : m_slots) {
+            if (slot.buffer == buffer) {
+                slot.age = 1;
+            } else if (slot.age > 0) {
+                slot.age++;
+            }
+        }
+        m_damageJournal.add(damage);
+    }
+
+private:
+    struct Slot
+    {
+        std::shared_ptr<Buffer> buffer;
+        int age = 0;
+    };
+
+    QVector<Slot> m_slots;
+    int m_index = 0;
+    DamageJournal m_damageJournal;
+};
+
+}
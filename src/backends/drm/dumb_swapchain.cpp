@@ -27,12 +27,8 @@ DumbSwapchain::DumbSwapchain(DrmGpu *gpu, const QSize &size, uint32_t drmFormat)
             break;
         }
         buffer->image()->fill(Qt::black);
-        m_slots.append(Slot{
-            .buffer = buffer,
-            .age = 0,
-        });
+        m_slots.append(buffer);
     }
-    m_damageJournal.setCapacity(2);
     if (m_slots.count() < 2) {
         qCWarning(KWIN_DRM) << "Failed to create dumb buffers for swapchain!";
         m_slots.clear();
@@ -41,33 +37,17 @@ DumbSwapchain::DumbSwapchain(DrmGpu *gpu, const QSize &size, uint32_t drmFormat)
 
 std::shared_ptr<DrmDumbBuffer> DumbSwapchain::acquireBuffer(QRegion *needsRepaint)
 {
-    if (m_slots.isEmpty()) {
-        return {};
-    }
-    index = (index + 1) % m_slots.count();
-    if (needsRepaint) {
-        *needsRepaint = m_damageJournal.accumulate(m_slots[index].age, infiniteRegion());
-    }
-    return m_slots[index].buffer;
+    return m_slots.acquire(needsRepaint);
 }
 
 std::shared_ptr<DrmDumbBuffer> DumbSwapchain::currentBuffer() const
 {
-    return m_slots[index].buffer;
+    return m_slots.current();
 }
 
 void DumbSwapchain::releaseBuffer(const std::shared_ptr<DrmDumbBuffer> &buffer, const QRegion &damage)
 {
-    Q_ASSERT(m_slots[index].buffer == buffer);
-
-    for (qsizetype i = 0; i < m_slots.count(); ++i) {
-        if (m_slots[i].buffer == buffer) {
-            m_slots[i].age = 1;
-        } else if (m_slots[i].age > 0) {
-            m_slots[i].age++;
-        }
-    }
-    m_damageJournal.add(damage);
+    m_slots.release(buffer, damage);
 }
 
 uint32_t DumbSwapchain::drmFormat() const
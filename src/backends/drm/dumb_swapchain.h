@@ -9,7 +9,7 @@
 
 #pragma once
 
-#include "utils/damagejournal.h"
+#include "drm_swapchain_slots.h"
 
 #include <QImage>
 #include <QSharedPointer>
@@ -37,17 +37,9 @@ public:
     uint32_t drmFormat() const;
 
 private:
-    struct Slot
-    {
-        std::shared_ptr<DrmDumbBuffer> buffer;
-        int age = 0;
-    };
-
     QSize m_size;
-    int index = 0;
     uint32_t m_format;
-    QVector<Slot> m_slots;
-    DamageJournal m_damageJournal;
+    SwapchainSlots<DrmDumbBuffer> m_slots;
 };
 
 }
@@ -16,6 +16,9 @@
 
 #include <KLocalizedString>
 
+#include <algorithm>
+#include <tuple>
+
 namespace KWin
 {
 
@@ -133,6 +136,67 @@ static QByteArray parseSerialNumber(const uint8_t *data)
     return QByteArray();
 }
 
+static std::pair<int, int> parseRefreshRateRange(const uint8_t *data)
+{
+    for (int i = 72; i <= 108; i += 18) {
+        // Skip the block if it isn't used as monitor descriptor.
+        if (data[i]) {
+            continue;
+        }
+        if (data[i + 1]) {
+            continue;
+        }
+
+        // The display range limits descriptor, with EDID 1.4 the rates may have an offset.
+        if (data[i + 3] == 0xfd) {
+            const bool minimumOffset = (data[i + 4] & 0x3) == 0x3;
+            const bool maximumOffset = data[i + 4] & 0x2;
+            return {data[i + 5] + (minimumOffset ? 255 : 0), data[i + 6] + (maximumOffset ? 255 : 0)};
+        }
+    }
+
+    return {0, 0};
+}
+
+static int parseBitsPerColor(const uint8_t *data)
+{
+    // Only EDID 1.4 describes the color depth of digital inputs
+    if (data[0x12] != 1 || data[0x13] < 4 || !(data[0x14] & 0x80)) {
+        return 0;
+    }
+    const int depth = (data[0x14] >> 4) & 0x7;
+    return depth >= 1 && depth <= 6 ? 4 + 2 * depth : 0;
+}
+
+static int parseMaxTmdsClock(const uint8_t *data, uint32_t size)
+{
+    int maxTmdsClock = 0;
+    for (uint32_t block = 128; block + 128 <= size; block += 128) {
+        const uint8_t *extension = data + block;
+        // Only the CTA-861 extension carries the HDMI vendor specific data blocks
+        if (extension[0] != 0x02) {
+            continue;
+        }
+        const uint32_t end = std::min<uint32_t>(extension[2], 127);
+        for (uint32_t i = 4; i < end; i += (extension[i] & 0x1f) + 1) {
+            const int tag = extension[i] >> 5;
+            const int length = extension[i] & 0x1f;
+            if (tag != 3 || length < 5 || i + length >= 127) {
+                continue;
+            }
+            const uint32_t oui = extension[i + 1] | (extension[i + 2] << 8) | (extension[i + 3] << 16);
+            if (oui == 0x000c03 && length >= 7) {
+                // HDMI 1.4 vendor specific data block, in units of 5 MHz
+                maxTmdsClock = std::max(maxTmdsClock, extension[i + 7] * 5000);
+            } else if (oui == 0xc45dd8) {
+                // HDMI Forum vendor specific data block, in units of 5 MHz
+                maxTmdsClock = std::max(maxTmdsClock, extension[i + 5] * 5000);
+            }
+        }
+    }
+    return maxTmdsClock;
+}
+
 static QByteArray parseVendor(const uint8_t *data)
 {
     const auto pnpId = parsePnpId(data);
@@ -174,6 +238,9 @@ Edid::Edid(const void *data, uint32_t size)
     m_eisaId = parseEisaId(bytes);
     m_monitorName = parseMonitorName(bytes);
     m_serialNumber = parseSerialNumber(bytes);
+    std::tie(m_minimumRefreshRate, m_maximumRefreshRate) = parseRefreshRateRange(bytes);
+    m_bitsPerColor = parseBitsPerColor(bytes);
+    m_maxTmdsClock = parseMaxTmdsClock(bytes, size);
     m_vendor = parseVendor(bytes);
 
     m_isValid = true;
@@ -199,6 +266,26 @@ QByteArray Edid::monitorName() const
     return m_monitorName;
 }
 
+int Edid::minimumRefreshRate() const
+{
+    return m_minimumRefreshRate;
+}
+
+int Edid::maximumRefreshRate() const
+{
+    return m_maximumRefreshRate;
+}
+
+int Edid::bitsPerColor() const
+{
+    return m_bitsPerColor;
+}
+
+int Edid::maxTmdsClock() const
+{
+    return m_maxTmdsClock;
+}
+
 QByteArray Edid::serialNumber() const
 {
     return m_serialNumber;
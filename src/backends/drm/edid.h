@@ -72,12 +72,40 @@ public:
      */
     QString nameString() const;
 
+    /**
+     * Returns the minimum vertical refresh rate in the display range limits of the monitor,
+     * in hertz, or 0 if the monitor doesn't report it.
+     */
+    int minimumRefreshRate() const;
+
+    /**
+     * Returns the maximum vertical refresh rate in the display range limits of the monitor,
+     * in hertz, or 0 if the monitor doesn't report it.
+     */
+    int maximumRefreshRate() const;
+
+    /**
+     * Returns the bits per color that the digital input of the monitor supports, or 0 if
+     * the EDID doesn't say, which is the case before EDID 1.4.
+     */
+    int bitsPerColor() const;
+
+    /**
+     * Returns the highest TMDS clock that the HDMI sink supports, in kilohertz, or 0 if
+     * the monitor doesn't report it.
+     */
+    int maxTmdsClock() const;
+
 private:
     QSize m_physicalSize;
     QByteArray m_vendor;
     QByteArray m_eisaId;
     QByteArray m_monitorName;
     QByteArray m_serialNumber;
+    int m_minimumRefreshRate = 0;
+    int m_maximumRefreshRate = 0;
+    int m_bitsPerColor = 0;
+    int m_maxTmdsClock = 0;
 
     QByteArray m_raw;
     bool m_isValid = false;
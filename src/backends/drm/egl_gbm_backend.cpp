@@ -35,7 +35,9 @@
 #include "virtual_egl_gbm_layer.h"
 #include "wayland/clientconnection.h"
 #include "wayland/linuxdmabufv1clientbuffer.h"
+#include "wayland/linuxdrmsyncobj_v1_interface.h"
 #include "wayland/surface_interface.h"
+#include "wayland_server.h"
 // kwin libs
 #include <kwineglimagetexture.h>
 #include <kwinglplatform.h>
@@ -54,11 +56,15 @@ EglGbmBackend::EglGbmBackend(DrmBackend *drmBackend)
 {
     drmBackend->setRenderBackend(this);
     setIsDirectRendering(true);
+
+    m_gbmSurfacePoolTimer.setSingleShot(true);
+    connect(&m_gbmSurfacePoolTimer, &QTimer::timeout, this, &EglGbmBackend::expireGbmSurfaces);
 }
 
 EglGbmBackend::~EglGbmBackend()
 {
     m_backend->releaseBuffers();
+    m_gbmSurfacePool.clear();
     cleanup();
     m_backend->setRenderBackend(nullptr);
 }
@@ -111,6 +117,11 @@ void EglGbmBackend::init()
     initBufferAge();
     initKWinGL();
     initWayland();
+
+    const int drmFd = m_backend->primaryGpu()->fd();
+    if (KWaylandServer::LinuxDrmSyncObjV1Interface::isSupported(drmFd)) {
+        new KWaylandServer::LinuxDrmSyncObjV1Interface(waylandServer()->display(), drmFd, this);
+    }
 }
 
 bool EglGbmBackend::initRenderingContext()
@@ -263,6 +274,64 @@ DrmGpu *EglGbmBackend::gpu() const
     return m_backend->primaryGpu();
 }
 
+// how many released gbm surfaces are kept for reuse
+static const size_t s_gbmSurfacePoolSize = 4;
+// how long a released gbm surface is kept, its buffers can take up a lot of memory
+static const std::chrono::milliseconds s_gbmSurfacePoolTimeout(5000);
+
+std::shared_ptr<GbmSurface> EglGbmBackend::takeGbmSurface(const QSize &size, uint32_t format, const QVector<uint64_t> &modifiers, uint32_t flags)
+{
+    const auto it = std::find_if(m_gbmSurfacePool.begin(), m_gbmSurfacePool.end(), [&](const PooledGbmSurface &pooled) {
+        const auto &surface = pooled.surface;
+        // buffers of the surface that are still held, e.g. for scanout, keep a reference
+        return surface.use_count() == 1 && surface->size() == size && surface->format() == format
+            && surface->modifiers() == modifiers && surface->flags() == flags;
+    });
+    if (it == m_gbmSurfacePool.end()) {
+        return nullptr;
+    }
+    const std::shared_ptr<GbmSurface> surface = it->surface;
+    m_gbmSurfacePool.erase(it);
+    // the buffer contents belong to whatever the previous user painted
+    surface->resetDamage();
+    return surface;
+}
+
+void EglGbmBackend::recycleGbmSurface(const std::shared_ptr<GbmSurface> &surface)
+{
+    if (!surface) {
+        return;
+    }
+    const bool pooled = std::any_of(m_gbmSurfacePool.begin(), m_gbmSurfacePool.end(), [&surface](const PooledGbmSurface &pooled) {
+        return pooled.surface == surface;
+    });
+    if (pooled) {
+        return;
+    }
+    m_gbmSurfacePool.push_front(PooledGbmSurface{
+        .surface = surface,
+        .releaseTime = std::chrono::steady_clock::now(),
+    });
+    if (m_gbmSurfacePool.size() > s_gbmSurfacePoolSize) {
+        m_gbmSurfacePool.pop_back();
+    }
+    if (!m_gbmSurfacePoolTimer.isActive()) {
+        m_gbmSurfacePoolTimer.start(s_gbmSurfacePoolTimeout);
+    }
+}
+
+void EglGbmBackend::expireGbmSurfaces()
+{
+    const auto now = std::chrono::steady_clock::now();
+    while (!m_gbmSurfacePool.empty() && now - m_gbmSurfacePool.back().releaseTime >= s_gbmSurfacePoolTimeout) {
+        m_gbmSurfacePool.pop_back();
+    }
+    if (!m_gbmSurfacePool.empty()) {
+        const auto remaining = s_gbmSurfacePoolTimeout - (now - m_gbmSurfacePool.back().releaseTime);
+        m_gbmSurfacePoolTimer.start(std::chrono::ceil<std::chrono::milliseconds>(remaining));
+    }
+}
+
 bool operator==(const GbmFormat &lhs, const GbmFormat &rhs)
 {
     return lhs.drmFormat == rhs.drmFormat;
@@ -15,6 +15,10 @@
 #include <QHash>
 #include <QPointer>
 #include <QSharedPointer>
+#include <QTimer>
+#include <chrono>
+#include <deque>
+#include <memory>
 #include <optional>
 
 struct gbm_surface;
@@ -81,6 +85,17 @@ public:
     std::optional<GbmFormat> gbmFormatForDrmFormat(uint32_t format) const;
     DrmGpu *gpu() const;
 
+    /**
+     * Returns a previously released gbm surface with the given properties that isn't in use
+     * anymore, or @c null if there is none. Surfaces created with modifiers have no flags.
+     */
+    std::shared_ptr<GbmSurface> takeGbmSurface(const QSize &size, uint32_t format, const QVector<uint64_t> &modifiers, uint32_t flags);
+    /**
+     * Keeps the released @p surface around for a few seconds, so that it can be reused when
+     * the same buffer configuration comes back, e.g. after a mode change or for test commits.
+     */
+    void recycleGbmSurface(const std::shared_ptr<GbmSurface> &surface);
+
     EGLImageKHR importDmaBufAsImage(const DmaBufAttributes &attributes);
     EGLImageKHR importDmaBufAsImage(gbm_bo *bo);
     QSharedPointer<GLTexture> importDmaBufAsTexture(const DmaBufAttributes &attributes);
@@ -90,10 +105,19 @@ private:
     bool initializeEgl();
     bool initBufferConfigs();
     bool initRenderingContext();
+    void expireGbmSurfaces();
 
     DrmBackend *m_backend;
     QHash<uint32_t, GbmFormat> m_formats;
     QHash<uint32_t, EGLConfig> m_configs;
+    struct PooledGbmSurface
+    {
+        std::shared_ptr<GbmSurface> surface;
+        std::chrono::steady_clock::time_point releaseTime;
+    };
+    // recently released gbm surfaces, most recent first
+    std::deque<PooledGbmSurface> m_gbmSurfacePool;
+    QTimer m_gbmSurfacePoolTimer;
 
     friend class EglGbmTexture;
 };
@@ -35,7 +35,7 @@ void EglGbmCursorLayer::aboutToStartPainting(const QRegion &damagedRegion)
 bool EglGbmCursorLayer::endFrame(const QRegion &renderedRegion, const QRegion &damagedRegion)
 {
     Q_UNUSED(renderedRegion)
-    const auto ret = m_surface.endRendering(m_pipeline->renderOrientation(), damagedRegion);
+    const auto ret = m_surface.endRendering(nullptr, m_pipeline->renderOrientation(), damagedRegion);
     if (ret.has_value()) {
         QRegion throwaway;
         std::tie(m_currentBuffer, throwaway) = ret.value();
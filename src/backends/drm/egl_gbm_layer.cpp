@@ -39,7 +39,6 @@ EglGbmLayer::EglGbmLayer(EglGbmBackend *eglBackend, DrmPipeline *pipeline)
 OutputLayerBeginFrameInfo EglGbmLayer::beginFrame()
 {
     m_scanoutBuffer.reset();
-    m_dmabufFeedback.renderingSurface();
 
     return m_surface.startRendering(m_pipeline->bufferSize(), m_pipeline->renderOrientation(), m_pipeline->bufferOrientation(), m_pipeline->formats());
 }
@@ -52,7 +51,7 @@ void EglGbmLayer::aboutToStartPainting(const QRegion &damagedRegion)
 bool EglGbmLayer::endFrame(const QRegion &renderedRegion, const QRegion &damagedRegion)
 {
     Q_UNUSED(renderedRegion)
-    const auto ret = m_surface.endRendering(m_pipeline->renderOrientation(), damagedRegion);
+    const auto ret = m_surface.endRendering(m_pipeline->output(), m_pipeline->renderOrientation(), damagedRegion);
     if (ret.has_value()) {
         std::tie(m_currentBuffer, m_currentDamage) = ret.value();
         return m_currentBuffer != nullptr;
@@ -61,6 +60,11 @@ bool EglGbmLayer::endFrame(const QRegion &renderedRegion, const QRegion &damaged
     }
 }
 
+std::chrono::nanoseconds EglGbmLayer::queryRenderTime()
+{
+    return m_surface.queryRenderTime();
+}
+
 QRegion EglGbmLayer::currentDamage() const
 {
     return m_currentDamage;
@@ -162,6 +166,31 @@ bool EglGbmLayer::scanout(SurfaceItem *surfaceItem)
     }
 }
 
+QVector<SurfaceItem *> EglGbmLayer::assignOverlays(const QVector<SurfaceItem *> &surfaceItems)
+{
+    const QVector<SurfaceItem *> ret = DrmPipelineLayer::assignOverlays(surfaceItems);
+    if (overlaysSupported()) {
+        std::optional<QMap<uint32_t, QVector<uint64_t>>> formats;
+        for (SurfaceItem *surfaceItem : surfaceItems) {
+            SurfaceItemWayland *item = qobject_cast<SurfaceItemWayland *>(surfaceItem);
+            if (!item || !item->surface() || !qobject_cast<KWaylandServer::LinuxDmaBufV1ClientBuffer *>(item->surface()->buffer())) {
+                continue;
+            }
+            if (ret.contains(surfaceItem)) {
+                m_dmabufFeedback.scanoutSuccessful(item->surface());
+            } else {
+                if (!formats) {
+                    formats = overlayFormats();
+                }
+                m_dmabufFeedback.scanoutFailed(item->surface(), *formats);
+            }
+        }
+    }
+    // this is called once per frame, after the fullscreen surface got its chance to be scanned out
+    m_dmabufFeedback.endFrame();
+    return ret;
+}
+
 std::shared_ptr<DrmFramebuffer> EglGbmLayer::currentBuffer() const
 {
     return m_scanoutBuffer ? m_scanoutBuffer : m_currentBuffer;
@@ -34,12 +34,14 @@ public:
     void aboutToStartPainting(const QRegion &damagedRegion) override;
     bool endFrame(const QRegion &renderedRegion, const QRegion &damagedRegion) override;
     bool scanout(SurfaceItem *surfaceItem) override;
+    QVector<SurfaceItem *> assignOverlays(const QVector<SurfaceItem *> &surfaceItems) override;
     bool checkTestBuffer() override;
     std::shared_ptr<DrmFramebuffer> currentBuffer() const override;
     bool hasDirectScanoutBuffer() const override;
     QRegion currentDamage() const override;
     QSharedPointer<GLTexture> texture() const override;
     void releaseBuffers() override;
+    std::chrono::nanoseconds queryRenderTime() override;
 
 private:
     std::shared_ptr<DrmFramebuffer> m_scanoutBuffer;
@@ -16,8 +16,10 @@
 #include "dumb_swapchain.h"
 #include "egl_dmabuf.h"
 #include "egl_gbm_backend.h"
+#include "egl_import_swapchain.h"
 #include "gbm_surface.h"
 #include "kwineglutils_p.h"
+#include "kwinglutils.h"
 #include "logging.h"
 #include "shadowbuffer.h"
 #include "surfaceitem_wayland.h"
@@ -32,6 +34,33 @@
 namespace KWin
 {
 
+static QRegion logicalToBufferRegion(DrmAbstractOutput *output, const QRegion &region)
+{
+    if (!output || region == infiniteRegion()) {
+        return infiniteRegion();
+    }
+    const QMatrix4x4 matrix = Output::logicalToNativeMatrix(output->rect(), output->scale(), output->transform());
+    QRegion ret;
+    for (const QRect &rect : region) {
+        ret += matrix.mapRect(rect);
+    }
+    return ret;
+}
+
+static QRegion logicalToShadowBufferRegion(DrmAbstractOutput *output, const QRegion &region)
+{
+    if (!output || region == infiniteRegion()) {
+        return infiniteRegion();
+    }
+    // the scene renders into the shadow buffer untransformed, the blit applies the transform
+    const QMatrix4x4 matrix = Output::logicalToNativeMatrix(output->rect(), output->scale(), Output::Transform::Normal);
+    QRegion ret;
+    for (const QRect &rect : region) {
+        ret += matrix.mapRect(rect);
+    }
+    return ret;
+}
+
 EglGbmLayerSurface::EglGbmLayerSurface(DrmGpu *gpu, EglGbmBackend *eglBackend)
     : m_gpu(gpu)
     , m_eglBackend(eglBackend)
@@ -46,13 +75,17 @@ EglGbmLayerSurface::~EglGbmLayerSurface()
 void EglGbmLayerSurface::destroyResources()
 {
     m_currentBuffer.reset();
-    if (m_gbmSurface && (m_shadowBuffer || m_oldShadowBuffer)) {
+    if (m_gbmSurface && (m_shadowBuffer || m_oldShadowBuffer || m_timeQuery || m_eglImportSwapchain || m_oldEglImportSwapchain || !m_importedTextures.isEmpty())) {
         m_gbmSurface->makeContextCurrent();
     }
+    m_timeQuery.reset();
+    m_importedTextures.clear();
+    m_eglImportSwapchain.reset();
+    m_oldEglImportSwapchain.reset();
     m_shadowBuffer.reset();
     m_oldShadowBuffer.reset();
-    m_gbmSurface.reset();
-    m_oldGbmSurface.reset();
+    m_eglBackend->recycleGbmSurface(std::exchange(m_gbmSurface, nullptr));
+    m_eglBackend->recycleGbmSurface(std::exchange(m_oldGbmSurface, nullptr));
 }
 
 OutputLayerBeginFrameInfo EglGbmLayerSurface::startRendering(const QSize &bufferSize, DrmPlane::Transformations renderOrientation, DrmPlane::Transformations bufferOrientation, const QMap<uint32_t, QVector<uint64_t>> &formats, uint32_t additionalFlags)
@@ -63,12 +96,20 @@ OutputLayerBeginFrameInfo EglGbmLayerSurface::startRendering(const QSize &buffer
     if (!m_gbmSurface->makeContextCurrent()) {
         return {};
     }
+    if (!m_timeQuery) {
+        m_timeQuery = std::make_unique<GLRenderTimeQuery>();
+    }
+    m_timeQuery->begin();
+    m_timeQueryPending = false;
 
     // shadow buffer
     const QSize renderSize = (renderOrientation & (DrmPlane::Transformation::Rotate90 | DrmPlane::Transformation::Rotate270)) ? m_gbmSurface->size().transposed() : m_gbmSurface->size();
+    // the shadow buffer keeps its contents between frames, unless it was just switched
+    bool shadowBufferOutdated = false;
     if (doesShadowBufferFit(m_shadowBuffer.get(), renderSize, renderOrientation, bufferOrientation)) {
         m_oldShadowBuffer.reset();
     } else {
+        shadowBufferOutdated = true;
         if (doesShadowBufferFit(m_oldShadowBuffer.get(), renderSize, renderOrientation, bufferOrientation)) {
             m_shadowBuffer = m_oldShadowBuffer;
         } else {
@@ -90,10 +131,10 @@ OutputLayerBeginFrameInfo EglGbmLayerSurface::startRendering(const QSize &buffer
     GLFramebuffer::pushFramebuffer(m_gbmSurface->fbo());
     if (m_shadowBuffer) {
         GLFramebuffer::pushFramebuffer(m_shadowBuffer->fbo());
-        // the blit after rendering will completely overwrite the back buffer anyways
+        // the blit after rendering takes care of the outdated parts of the back buffer
         return OutputLayerBeginFrameInfo{
             .renderTarget = RenderTarget(m_shadowBuffer->fbo()),
-            .repaint = {},
+            .repaint = shadowBufferOutdated ? infiniteRegion() : QRegion(),
         };
     } else {
         return OutputLayerBeginFrameInfo{
@@ -106,7 +147,7 @@ OutputLayerBeginFrameInfo EglGbmLayerSurface::startRendering(const QSize &buffer
 void EglGbmLayerSurface::aboutToStartPainting(DrmOutput *output, const QRegion &damagedRegion)
 {
     if (m_shadowBuffer) {
-        // with a shadow buffer, we always fully damage the surface
+        // the shadow buffer is blitted without declaring a damage region, the back buffer keeps its contents
         return;
     }
     if (m_gbmSurface && m_gbmSurface->bufferAge() > 0 && !damagedRegion.isEmpty() && m_eglBackend->supportsPartialUpdate()) {
@@ -118,14 +159,17 @@ void EglGbmLayerSurface::aboutToStartPainting(DrmOutput *output, const QRegion &
     }
 }
 
-std::optional<std::tuple<std::shared_ptr<DrmFramebuffer>, QRegion>> EglGbmLayerSurface::endRendering(DrmPlane::Transformations renderOrientation, const QRegion &damagedRegion)
+std::optional<std::tuple<std::shared_ptr<DrmFramebuffer>, QRegion>> EglGbmLayerSurface::endRendering(DrmAbstractOutput *output, DrmPlane::Transformations renderOrientation, const QRegion &damagedRegion)
 {
     if (m_shadowBuffer) {
         GLFramebuffer::popFramebuffer();
+        // only the damage and what's outdated in the back buffer needs to be blitted
         // TODO handle bufferOrientation != Rotate0
-        m_shadowBuffer->render(renderOrientation);
+        m_shadowBuffer->render(renderOrientation, logicalToShadowBufferRegion(output, damagedRegion | m_gbmSurface->repaintRegion()));
     }
     GLFramebuffer::popFramebuffer();
+    m_timeQuery->end();
+    m_timeQueryPending = true;
     if (m_gpu == m_eglBackend->gpu()) {
         if (const auto buffer = m_gbmSurface->swapBuffers(damagedRegion)) {
             m_currentBuffer = buffer;
@@ -138,7 +182,7 @@ std::optional<std::tuple<std::shared_ptr<DrmFramebuffer>, QRegion>> EglGbmLayerS
     } else {
         if (const auto gbmBuffer = m_gbmSurface->swapBuffers(damagedRegion)) {
             m_currentBuffer = gbmBuffer;
-            const auto buffer = importBuffer();
+            const auto buffer = importBuffer(logicalToBufferRegion(output, damagedRegion));
             if (buffer) {
                 return std::tuple(buffer, damagedRegion);
             }
@@ -147,13 +191,23 @@ std::optional<std::tuple<std::shared_ptr<DrmFramebuffer>, QRegion>> EglGbmLayerS
     return {};
 }
 
+std::chrono::nanoseconds EglGbmLayerSurface::queryRenderTime()
+{
+    // frames that haven't been rendered, e.g. with direct scanout, have no render time
+    if (!m_timeQueryPending || !m_eglBackend->makeCurrent()) {
+        return std::chrono::nanoseconds::zero();
+    }
+    m_timeQueryPending = false;
+    return m_timeQuery->result();
+}
+
 bool EglGbmLayerSurface::checkGbmSurface(const QSize &bufferSize, const QMap<uint32_t, QVector<uint64_t>> &formats, uint32_t flags)
 {
     if (doesGbmSurfaceFit(m_gbmSurface.get(), bufferSize, formats)) {
-        m_oldGbmSurface.reset();
+        m_eglBackend->recycleGbmSurface(std::exchange(m_oldGbmSurface, nullptr));
     } else {
         if (doesGbmSurfaceFit(m_oldGbmSurface.get(), bufferSize, formats)) {
-            m_gbmSurface = m_oldGbmSurface;
+            m_eglBackend->recycleGbmSurface(std::exchange(m_gbmSurface, m_oldGbmSurface));
         } else {
             if (!createGbmSurface(bufferSize, formats, flags)) {
                 return false;
@@ -162,6 +216,8 @@ bool EglGbmLayerSurface::checkGbmSurface(const QSize &bufferSize, const QMap<uin
             m_importMode = MultiGpuImportMode::Dmabuf;
             m_importSwapchain.reset();
             m_oldImportSwapchain.reset();
+            m_eglImportSwapchain.reset();
+            m_oldEglImportSwapchain.reset();
         }
     }
     return m_gbmSurface != nullptr;
@@ -181,9 +237,14 @@ bool EglGbmLayerSurface::createGbmSurface(const QSize &size, uint32_t format, co
     }
 
     if (allowModifiers) {
+        if (auto surface = m_eglBackend->takeGbmSurface(size, format, modifiers, 0)) {
+            m_eglBackend->recycleGbmSurface(std::exchange(m_oldGbmSurface, m_gbmSurface));
+            m_gbmSurface = surface;
+            return true;
+        }
         const auto ret = GbmSurface::createSurface(m_eglBackend, size, format, modifiers, config);
         if (const auto surface = std::get_if<std::shared_ptr<GbmSurface>>(&ret)) {
-            m_oldGbmSurface = m_gbmSurface;
+            m_eglBackend->recycleGbmSurface(std::exchange(m_oldGbmSurface, m_gbmSurface));
             m_gbmSurface = *surface;
             return true;
         } else if (std::get<GbmSurface::Error>(ret) != GbmSurface::Error::ModifiersUnsupported) {
@@ -196,9 +257,14 @@ bool EglGbmLayerSurface::createGbmSurface(const QSize &size, uint32_t format, co
     } else {
         gbmFlags |= GBM_BO_USE_LINEAR;
     }
+    if (auto surface = m_eglBackend->takeGbmSurface(size, format, {}, gbmFlags)) {
+        m_eglBackend->recycleGbmSurface(std::exchange(m_oldGbmSurface, m_gbmSurface));
+        m_gbmSurface = surface;
+        return true;
+    }
     const auto ret = GbmSurface::createSurface(m_eglBackend, size, format, gbmFlags, config);
     if (const auto surface = std::get_if<std::shared_ptr<GbmSurface>>(&ret)) {
-        m_oldGbmSurface = m_gbmSurface;
+        m_eglBackend->recycleGbmSurface(std::exchange(m_oldGbmSurface, m_gbmSurface));
         m_gbmSurface = *surface;
         return true;
     } else {
@@ -256,17 +322,24 @@ bool EglGbmLayerSurface::doesShadowBufferFit(ShadowBuffer *buffer, const QSize &
     }
 }
 
-std::shared_ptr<DrmFramebuffer> EglGbmLayerSurface::importBuffer()
+std::shared_ptr<DrmFramebuffer> EglGbmLayerSurface::importBuffer(const QRegion &bufferDamage)
 {
     if (m_importMode == MultiGpuImportMode::Dmabuf) {
         if (const auto buffer = importDmabuf()) {
             return buffer;
         } else {
             // don't bother trying again, it will most likely fail every time
+            m_importMode = MultiGpuImportMode::Egl;
+        }
+    }
+    if (m_importMode == MultiGpuImportMode::Egl) {
+        if (const auto buffer = importWithEgl(bufferDamage)) {
+            return buffer;
+        } else {
             m_importMode = MultiGpuImportMode::DumbBuffer;
         }
     }
-    if (const auto buffer = importWithCpu()) {
+    if (const auto buffer = importWithCpu(bufferDamage)) {
         return buffer;
     } else if (m_importMode == MultiGpuImportMode::DumbBuffer) {
         m_importMode = MultiGpuImportMode::DumbBufferXrgb8888;
@@ -293,7 +366,89 @@ std::shared_ptr<DrmFramebuffer> EglGbmLayerSurface::importDmabuf()
     return ret;
 }
 
-std::shared_ptr<DrmFramebuffer> EglGbmLayerSurface::importWithCpu()
+std::shared_ptr<DrmFramebuffer> EglGbmLayerSurface::importWithEgl(const QRegion &bufferDamage)
+{
+    if (doesSwapchainFit(m_eglImportSwapchain.get())) {
+        m_oldEglImportSwapchain.reset();
+    } else {
+        if (doesSwapchainFit(m_oldEglImportSwapchain.get())) {
+            m_eglImportSwapchain = m_oldEglImportSwapchain;
+        } else {
+            const auto swapchain = std::make_shared<EglImportSwapchain>(m_gpu, m_eglBackend, m_gbmSurface->size(), m_gbmSurface->format());
+            if (swapchain->isEmpty()) {
+                return nullptr;
+            }
+            m_eglImportSwapchain = swapchain;
+        }
+    }
+
+    const auto sourceTexture = importedTexture(m_currentBuffer->bo());
+    if (!sourceTexture) {
+        return nullptr;
+    }
+    QRegion repaint;
+    const auto importBuffer = m_eglImportSwapchain->acquireBuffer(&repaint);
+    const QRect bufferRect(QPoint(), m_eglImportSwapchain->size());
+    repaint = (repaint | bufferDamage) & bufferRect;
+
+    // both buffers have their first row at the start of the memory, which maps to
+    // a texture coordinate and viewport coordinate of zero, so no flip is needed
+    const float width = bufferRect.width();
+    const float height = bufferRect.height();
+    QVector<float> verts;
+    QVector<float> texcoords;
+    verts.reserve(repaint.rectCount() * 12);
+    texcoords.reserve(repaint.rectCount() * 12);
+    for (const QRect &rect : repaint) {
+        const float x0 = rect.x() / width;
+        const float y0 = rect.y() / height;
+        const float x1 = (rect.x() + rect.width()) / width;
+        const float y1 = (rect.y() + rect.height()) / height;
+        texcoords << x0 << y0 << x0 << y1 << x1 << y1
+                  << x0 << y0 << x1 << y1 << x1 << y0;
+        verts << x0 * 2 - 1 << y0 * 2 - 1 << x0 * 2 - 1 << y1 * 2 - 1 << x1 * 2 - 1 << y1 * 2 - 1
+              << x0 * 2 - 1 << y0 * 2 - 1 << x1 * 2 - 1 << y1 * 2 - 1 << x1 * 2 - 1 << y0 * 2 - 1;
+    }
+
+    GLFramebuffer::pushFramebuffer(importBuffer->fbo.get());
+    if (!verts.isEmpty()) {
+        GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
+        vbo->reset();
+        vbo->setData(verts.size() / 2, 2, verts.constData(), texcoords.constData());
+        auto shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
+        shader->setUniform(GLShader::ModelViewProjectionMatrix, QMatrix4x4());
+        sourceTexture->bind();
+        vbo->render(GL_TRIANGLES);
+        sourceTexture->unbind();
+        ShaderManager::instance()->popShader();
+    }
+    GLFramebuffer::popFramebuffer();
+    // submit the copy before the buffer is handed to the other gpu, implicit sync takes care of the rest
+    glFlush();
+    m_eglImportSwapchain->releaseBuffer(importBuffer, bufferDamage & bufferRect);
+
+    const auto ret = DrmFramebuffer::createFramebuffer(importBuffer->gbmBuffer);
+    if (!ret) {
+        qCWarning(KWIN_DRM, "Failed to create framebuffer for multi-gpu egl import: %s", strerror(errno));
+    }
+    return ret;
+}
+
+QSharedPointer<GLTexture> EglGbmLayerSurface::importedTexture(gbm_bo *bo)
+{
+    // the buffers of a gbm surface are used in turns, so their textures only need to be created once
+    if (m_importedTexturesSurface.lock() != m_gbmSurface || m_importedTextures.size() >= s_maxImportedTextures) {
+        m_importedTextures.clear();
+        m_importedTexturesSurface = m_gbmSurface;
+    }
+    auto &texture = m_importedTextures[bo];
+    if (!texture) {
+        texture = m_eglBackend->importDmaBufAsTexture(bo);
+    }
+    return texture;
+}
+
+std::shared_ptr<DrmFramebuffer> EglGbmLayerSurface::importWithCpu(const QRegion &bufferDamage)
 {
     if (doesSwapchainFit(m_importSwapchain.get())) {
         m_oldImportSwapchain.reset();
@@ -313,14 +468,33 @@ std::shared_ptr<DrmFramebuffer> EglGbmLayerSurface::importWithCpu()
         qCWarning(KWIN_DRM, "mapping a gbm_bo failed: %s", strerror(errno));
         return nullptr;
     }
-    const auto importBuffer = m_importSwapchain->acquireBuffer();
+    QRegion repaint;
+    const auto importBuffer = m_importSwapchain->acquireBuffer(&repaint);
     if (m_currentBuffer->planeCount() != 1 || m_currentBuffer->strides()[0] != importBuffer->strides()[0]) {
         qCCritical(KWIN_DRM, "stride of gbm_bo (%d) and dumb buffer (%d) don't match!", m_currentBuffer->strides()[0], importBuffer->strides()[0]);
         return nullptr;
     }
-    if (!memcpy(importBuffer->data(), m_currentBuffer->mappedData(), importBuffer->size().height() * importBuffer->strides()[0])) {
-        return nullptr;
+    const QRect bufferRect(QPoint(), importBuffer->size());
+    repaint = (repaint | bufferDamage) & bufferRect;
+
+    // only copy the rows and columns that changed since the dumb buffer was last used
+    const uint32_t stride = importBuffer->strides()[0];
+    const uint32_t bytesPerPixel = gbm_bo_get_bpp(m_currentBuffer->bo()) / 8;
+    const auto src = static_cast<const char *>(m_currentBuffer->mappedData());
+    const auto dst = static_cast<char *>(importBuffer->data());
+    for (const QRect &rect : repaint) {
+        if (rect.left() == 0 && rect.width() == bufferRect.width()) {
+            const size_t offset = rect.top() * stride;
+            memcpy(dst + offset, src + offset, rect.height() * stride);
+            continue;
+        }
+        for (int y = rect.top(); y <= rect.bottom(); y++) {
+            const size_t offset = y * stride + rect.left() * bytesPerPixel;
+            memcpy(dst + offset, src + offset, rect.width() * bytesPerPixel);
+        }
     }
+    m_importSwapchain->releaseBuffer(importBuffer, bufferDamage & bufferRect);
+
     const auto ret = DrmFramebuffer::createFramebuffer(importBuffer);
     if (!ret) {
         qCWarning(KWIN_DRM, "Failed to create framebuffer for CPU import: %s", strerror(errno));
@@ -333,6 +507,11 @@ bool EglGbmLayerSurface::doesSwapchainFit(DumbSwapchain *swapchain) const
     return swapchain && swapchain->size() == m_gbmSurface->size() && swapchain->drmFormat() == m_gbmSurface->format();
 }
 
+bool EglGbmLayerSurface::doesSwapchainFit(EglImportSwapchain *swapchain) const
+{
+    return swapchain && swapchain->size() == m_gbmSurface->size() && swapchain->drmFormat() == m_gbmSurface->format();
+}
+
 EglGbmBackend *EglGbmLayerSurface::eglBackend() const
 {
     return m_eglBackend;
@@ -365,7 +544,7 @@ std::shared_ptr<DrmFramebuffer> EglGbmLayerSurface::renderTestBuffer(const QSize
     if (m_currentBuffer) {
         if (m_gpu != m_eglBackend->gpu()) {
             auto oldImportMode = m_importMode;
-            auto buffer = importBuffer();
+            auto buffer = importBuffer(infiniteRegion());
             if (buffer) {
                 return buffer;
             } else if (m_importMode != oldImportMode) {
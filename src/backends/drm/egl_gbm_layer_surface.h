@@ -8,6 +8,7 @@
 */
 #pragma once
 
+#include <QHash>
 #include <QMap>
 #include <QPointer>
 #include <QRegion>
@@ -17,6 +18,8 @@
 #include "drm_object_plane.h"
 #include "outputlayer.h"
 
+struct gbm_bo;
+
 namespace KWaylandServer
 {
 class SurfaceInterface;
@@ -29,11 +32,14 @@ namespace KWin
 class DrmFramebuffer;
 class GbmSurface;
 class DumbSwapchain;
+class EglImportSwapchain;
 class ShadowBuffer;
 class EglGbmBackend;
 class SurfaceItem;
 class GLTexture;
 class GbmBuffer;
+class GLRenderTimeQuery;
+class DrmAbstractOutput;
 
 class EglGbmLayerSurface : public QObject
 {
@@ -44,13 +50,18 @@ public:
 
     OutputLayerBeginFrameInfo startRendering(const QSize &bufferSize, DrmPlane::Transformations renderOrientation, DrmPlane::Transformations bufferOrientation, const QMap<uint32_t, QVector<uint64_t>> &formats, uint32_t additionalFlags = 0);
     void aboutToStartPainting(DrmOutput *output, const QRegion &damagedRegion);
-    std::optional<std::tuple<std::shared_ptr<DrmFramebuffer>, QRegion>> endRendering(DrmPlane::Transformations renderOrientation, const QRegion &damagedRegion);
+    std::optional<std::tuple<std::shared_ptr<DrmFramebuffer>, QRegion>> endRendering(DrmAbstractOutput *output, DrmPlane::Transformations renderOrientation, const QRegion &damagedRegion);
 
     bool doesSurfaceFit(const QSize &size, const QMap<uint32_t, QVector<uint64_t>> &formats) const;
     QSharedPointer<GLTexture> texture() const;
     void destroyResources();
     EglGbmBackend *eglBackend() const;
     std::shared_ptr<DrmFramebuffer> renderTestBuffer(const QSize &bufferSize, const QMap<uint32_t, QVector<uint64_t>> &formats, uint32_t additionalFlags = 0);
+    /**
+     * Returns the render time of the last rendered frame, or zero if it has been queried
+     * already or no frame has been rendered since.
+     */
+    std::chrono::nanoseconds queryRenderTime();
 
 private:
     bool checkGbmSurface(const QSize &size, const QMap<uint32_t, QVector<uint64_t>> &formats, uint32_t flags);
@@ -60,13 +71,17 @@ private:
 
     bool doesShadowBufferFit(ShadowBuffer *buffer, const QSize &size, DrmPlane::Transformations renderOrientation, DrmPlane::Transformations bufferOrientation) const;
     bool doesSwapchainFit(DumbSwapchain *swapchain) const;
+    bool doesSwapchainFit(EglImportSwapchain *swapchain) const;
 
-    std::shared_ptr<DrmFramebuffer> importBuffer();
+    std::shared_ptr<DrmFramebuffer> importBuffer(const QRegion &bufferDamage);
     std::shared_ptr<DrmFramebuffer> importDmabuf();
-    std::shared_ptr<DrmFramebuffer> importWithCpu();
+    std::shared_ptr<DrmFramebuffer> importWithEgl(const QRegion &bufferDamage);
+    std::shared_ptr<DrmFramebuffer> importWithCpu(const QRegion &bufferDamage);
+    QSharedPointer<GLTexture> importedTexture(gbm_bo *bo);
 
     enum class MultiGpuImportMode {
         Dmabuf,
+        Egl,
         DumbBuffer,
         DumbBufferXrgb8888,
         Failed
@@ -81,6 +96,15 @@ private:
     std::shared_ptr<ShadowBuffer> m_oldShadowBuffer;
     std::shared_ptr<DumbSwapchain> m_importSwapchain;
     std::shared_ptr<DumbSwapchain> m_oldImportSwapchain;
+    std::shared_ptr<EglImportSwapchain> m_eglImportSwapchain;
+    std::shared_ptr<EglImportSwapchain> m_oldEglImportSwapchain;
+    std::unique_ptr<GLRenderTimeQuery> m_timeQuery;
+    // whether m_timeQuery measured a frame whose render time hasn't been queried yet
+    bool m_timeQueryPending = false;
+    // textures of the buffers of m_importedTexturesSurface, for copying them to the secondary gpu
+    QHash<gbm_bo *, QSharedPointer<GLTexture>> m_importedTextures;
+    std::weak_ptr<GbmSurface> m_importedTexturesSurface;
+    static constexpr int s_maxImportedTextures = 4;
 
     DrmGpu *const m_gpu;
     EglGbmBackend *const m_eglBackend;
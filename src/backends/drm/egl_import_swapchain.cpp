@@ -0,0 +1,77 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "egl_import_swapchain.h"
+#include "drm_buffer_gbm.h"
+#include "drm_gpu.h"
+#include "egl_gbm_backend.h"
+#include "kwineffects.h"
+#include "kwinglutils.h"
+#include "logging.h"
+
+#include <gbm.h>
+
+namespace KWin
+{
+
+EglImportSwapchain::EglImportSwapchain(DrmGpu *gpu, EglGbmBackend *eglBackend, const QSize &size, uint32_t drmFormat)
+    : m_size(size)
+    , m_format(drmFormat)
+{
+    for (int i = 0; i < 2; i++) {
+        gbm_bo *bo = gbm_bo_create(gpu->gbmDevice(), size.width(), size.height(), drmFormat, GBM_BO_USE_SCANOUT | GBM_BO_USE_LINEAR);
+        if (!bo) {
+            break;
+        }
+        const auto buffer = std::make_shared<GbmBuffer>(gpu, bo);
+        // the texture is created in the context of the primary gpu
+        const auto texture = eglBackend->importDmaBufAsTexture(bo);
+        if (!texture) {
+            break;
+        }
+        const auto fbo = std::make_shared<GLFramebuffer>(texture.data());
+        if (!fbo->valid()) {
+            break;
+        }
+        m_slots.append(std::make_shared<Buffer>(Buffer{
+            .gbmBuffer = buffer,
+            .texture = texture,
+            .fbo = fbo,
+        }));
+    }
+    if (m_slots.count() < 2) {
+        qCWarning(KWIN_DRM) << "Failed to create linear buffers for multi-gpu import!";
+        m_slots.clear();
+    }
+}
+
+std::shared_ptr<EglImportSwapchain::Buffer> EglImportSwapchain::acquireBuffer(QRegion *needsRepaint)
+{
+    return m_slots.acquire(needsRepaint);
+}
+
+void EglImportSwapchain::releaseBuffer(const std::shared_ptr<Buffer> &buffer, const QRegion &damage)
+{
+    m_slots.release(buffer, damage);
+}
+
+QSize EglImportSwapchain::size() const
+{
+    return m_size;
+}
+
+bool EglImportSwapchain::isEmpty() const
+{
+    return m_slots.isEmpty();
+}
+
+uint32_t EglImportSwapchain::drmFormat() const
+{
+    return m_format;
+}
+
+}
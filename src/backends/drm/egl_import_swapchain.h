@@ -0,0 +1,60 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "drm_swapchain_slots.h"
+
+#include <QSharedPointer>
+#include <QSize>
+#include <QVector>
+#include <memory>
+
+namespace KWin
+{
+
+class DrmGpu;
+class EglGbmBackend;
+class GbmBuffer;
+class GLFramebuffer;
+class GLTexture;
+
+/**
+ * The EglImportSwapchain class holds linear buffers that are allocated on a secondary gpu
+ * and imported into the rendering context of the primary gpu, so that frames rendered
+ * on the primary gpu can be copied to them by the gpu instead of the cpu.
+ */
+class EglImportSwapchain
+{
+public:
+    struct Buffer
+    {
+        std::shared_ptr<GbmBuffer> gbmBuffer;
+        QSharedPointer<GLTexture> texture;
+        std::shared_ptr<GLFramebuffer> fbo;
+    };
+
+    EglImportSwapchain(DrmGpu *gpu, EglGbmBackend *eglBackend, const QSize &size, uint32_t drmFormat);
+
+    /**
+     * Returns the next buffer to copy to. If @a needsRepaint is set, it is filled
+     * with the region of the buffer that is outdated, in buffer coordinates.
+     */
+    std::shared_ptr<Buffer> acquireBuffer(QRegion *needsRepaint = nullptr);
+    void releaseBuffer(const std::shared_ptr<Buffer> &buffer, const QRegion &damage = {});
+
+    QSize size() const;
+    bool isEmpty() const;
+    uint32_t drmFormat() const;
+
+private:
+    QSize m_size;
+    uint32_t m_format;
+    SwapchainSlots<Buffer> m_slots;
+};
+
+}
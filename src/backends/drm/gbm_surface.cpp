@@ -23,6 +23,12 @@
 namespace KWin
 {
 
+// The buffers are allocated by the driver, the estimate assumes double buffering
+static qint64 swapchainMemoryUsage(const QSize &size)
+{
+    return 2 * GLMemoryTracker::estimateSize(GL_RGBA8, size);
+}
+
 GbmSurface::GbmSurface(EglGbmBackend *backend, const QSize &size, uint32_t format, const QVector<uint64_t> &modifiers, uint32_t flags, gbm_surface *surface, EGLSurface eglSurface)
     : m_surface(surface)
     , m_eglBackend(backend)
@@ -33,10 +39,12 @@ GbmSurface::GbmSurface(EglGbmBackend *backend, const QSize &size, uint32_t forma
     , m_flags(flags)
     , m_fbo(new GLFramebuffer(0, size))
 {
+    GLMemoryTracker::self()->allocate(GLMemoryTracker::Swapchain, swapchainMemoryUsage(m_size));
 }
 
 GbmSurface::~GbmSurface()
 {
+    GLMemoryTracker::self()->release(GLMemoryTracker::Swapchain, swapchainMemoryUsage(m_size));
     if (m_eglSurface != EGL_NO_SURFACE) {
         eglDestroySurface(m_eglBackend->eglDisplay(), m_eglSurface);
     }
@@ -120,6 +128,12 @@ QRegion GbmSurface::repaintRegion() const
     }
 }
 
+void GbmSurface::resetDamage()
+{
+    m_bufferAge = 0;
+    m_damageJournal.clear();
+}
+
 uint32_t GbmSurface::flags() const
 {
     return m_flags;
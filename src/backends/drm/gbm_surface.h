@@ -47,6 +47,10 @@ public:
     uint32_t flags() const;
     int bufferAge() const;
     QRegion repaintRegion() const;
+    /**
+     * Forgets the damage history, so that the next frame is painted entirely.
+     */
+    void resetDamage();
 
     enum class Error {
         ModifiersUnsupported,
@@ -12,6 +12,11 @@
 namespace KWin
 {
 
+PlaceholderInputEventFilter::PlaceholderInputEventFilter()
+    : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::WheelEvents | InputRedirection::KeyboardEvents | InputRedirection::TouchEvents)
+{
+}
+
 bool PlaceholderInputEventFilter::pointerEvent(QMouseEvent *event, quint32 nativeButton)
 {
     Q_UNUSED(event)
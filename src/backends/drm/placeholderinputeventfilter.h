@@ -16,6 +16,8 @@ namespace KWin
 class PlaceholderInputEventFilter : public InputEventFilter
 {
 public:
+    PlaceholderInputEventFilter();
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override;
     bool wheelEvent(QWheelEvent *event) override;
     bool keyEvent(QKeyEvent *event) override;
@@ -44,6 +44,7 @@ ShadowBuffer::ShadowBuffer(const QSize &size, const GbmFormat &format)
     , m_drmFormat(format.drmFormat)
 {
     m_texture.reset(new GLTexture(internalFormat(format), size));
+    m_texture->setMemoryCategory(GLMemoryTracker::ShadowBuffer);
     m_texture->setFilter(GL_NEAREST);
     m_texture->setYInverted(true);
 
@@ -61,8 +62,11 @@ ShadowBuffer::~ShadowBuffer()
 {
 }
 
-void ShadowBuffer::render(DrmPlane::Transformations transform)
+void ShadowBuffer::render(DrmPlane::Transformations transform, const QRegion &region)
 {
+    if (region.isEmpty()) {
+        return;
+    }
     QMatrix4x4 mvpMatrix;
     if (transform & DrmPlane::Transformation::Rotate90) {
         mvpMatrix.rotate(90, 0, 0, 1);
@@ -82,7 +86,29 @@ void ShadowBuffer::render(DrmPlane::Transformations transform)
     shader->setUniform(GLShader::ModelViewProjectionMatrix, mvpMatrix);
 
     m_texture->bind();
-    m_vbo->render(GL_TRIANGLES);
+    if (region == infiniteRegion()) {
+        m_vbo->render(GL_TRIANGLES);
+    } else {
+        // maps shadow buffer pixels to framebuffer pixels with the origin at the bottom left,
+        // going through the same transformation as the blit itself
+        const QSize targetSize = GLFramebuffer::currentFramebuffer()->size();
+        QMatrix4x4 scissorMatrix;
+        scissorMatrix.scale(targetSize.width() / 2.0, targetSize.height() / 2.0);
+        scissorMatrix.translate(1, 1);
+        scissorMatrix *= mvpMatrix;
+        scissorMatrix.translate(-1, 1);
+        scissorMatrix.scale(2.0 / m_size.width(), -2.0 / m_size.height());
+
+        glEnable(GL_SCISSOR_TEST);
+        m_vbo->bindArrays();
+        for (const QRect &rect : region) {
+            const QRect scissor = scissorMatrix.mapRect(QRectF(rect)).toAlignedRect();
+            glScissor(scissor.x(), scissor.y(), scissor.width(), scissor.height());
+            m_vbo->draw(GL_TRIANGLES, 0, 6);
+        }
+        m_vbo->unbindArrays();
+        glDisable(GL_SCISSOR_TEST);
+    }
     ShaderManager::instance()->popShader();
 }
 
@@ -8,7 +8,9 @@
 */
 #pragma once
 
+#include <QRegion>
 #include <QSize>
+#include <kwineffects.h>
 #include <kwinglutils.h>
 
 #include "drm_object_plane.h"
@@ -24,7 +26,11 @@ public:
     ~ShadowBuffer();
 
     bool isComplete() const;
-    void render(DrmPlane::Transformations transform);
+    /**
+     * Draws the shadow buffer into the current framebuffer. Only the parts within @p region,
+     * in device pixels of the shadow buffer, are updated.
+     */
+    void render(DrmPlane::Transformations transform, const QRegion &region = infiniteRegion());
 
     GLFramebuffer *fbo() const;
     QSharedPointer<GLTexture> texture() const;
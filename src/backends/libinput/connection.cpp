@@ -32,6 +32,11 @@
 
 #include <cmath>
 #include <libinput.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <utility>
 
 namespace KWin
 {
@@ -127,8 +132,11 @@ Connection::Connection(Context *input, QObject *parent)
     : QObject(parent)
     , m_input(input)
     , m_notifier(nullptr)
+    , m_eventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
 {
     Q_ASSERT(m_input);
+    // the connection is moved to the input thread later on
+    loadRealTimePolicy();
     // need to connect to KGlobalSettings as the mouse KCM does not emit a dedicated signal
     QDBusConnection::sessionBus().connect(QString(), QStringLiteral("/KGlobalSettings"), QStringLiteral("org.kde.KGlobalSettings"),
                                           QStringLiteral("notifyChange"), this, SLOT(slotKGlobalSettingsNotifyChange(int, int)));
@@ -136,6 +144,7 @@ Connection::Connection(Context *input, QObject *parent)
 
 Connection::~Connection()
 {
+    close(m_eventFd);
     delete s_adaptor;
     s_adaptor = nullptr;
     s_self = nullptr;
@@ -152,7 +161,7 @@ void Connection::doSetup()
 {
     Q_ASSERT(!m_notifier);
 
-    gainRealTime();
+    gainRealTime(RealTimeTier::Input);
 
     m_notifier = new QSocketNotifier(m_input->fileDescriptor(), QSocketNotifier::Read, this);
     connect(m_notifier, &QSocketNotifier::activated, this, &Connection::handleEvent);
@@ -180,20 +189,70 @@ void Connection::deactivate()
     handleEvent();
 }
 
+int Connection::eventFd() const
+{
+    return m_eventFd;
+}
+
 void Connection::handleEvent()
 {
-    QMutexLocker locker(&m_mutex);
-    const bool wasEmpty = m_eventQueue.isEmpty();
+    if (m_notifier) {
+        m_notifier->setEnabled(true);
+    }
+    bool eventsRead = false;
     do {
-        m_input->dispatch();
-        Event *event = m_input->event();
+        libinput_event *event = nullptr;
+        bool full;
+        {
+            // only the libinput calls are serialized with the device handling on the main thread,
+            // destroying the reclaimed events in isFull() is one of them
+            QMutexLocker locker(&m_mutex);
+            m_input->dispatch();
+            full = m_eventRing.isFull();
+            if (!full) {
+                event = m_input->event();
+            }
+        }
+        if (full) {
+            // Leave the events in libinput until the main thread catches up, processEvents()
+            // will resume reading. The fence pairs with the one in processEvents(): either the
+            // main thread sees the flag, or this thread sees the slots that it has freed.
+            if (m_notifier) {
+                m_notifier->setEnabled(false);
+            }
+            m_stalled.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool stillFull;
+            {
+                QMutexLocker locker(&m_mutex);
+                stillFull = m_eventRing.isFull();
+            }
+            if (stillFull || !m_stalled.exchange(false, std::memory_order_acq_rel)) {
+                // the main thread resumes reading, or already has scheduled it
+                break;
+            }
+            if (m_notifier) {
+                m_notifier->setEnabled(true);
+            }
+            continue;
+        }
         if (!event) {
             break;
         }
-        m_eventQueue << event;
+        m_eventRing.push(event);
+        eventsRead = true;
     } while (true);
-    if (wasEmpty && !m_eventQueue.isEmpty()) {
-        Q_EMIT eventsRead();
+    if (eventsRead) {
+        // one wakeup for the whole batch
+        const quint64 one = 1;
+        ssize_t ret;
+        do {
+            ret = write(m_eventFd, &one, sizeof(one));
+        } while (ret == -1 && errno == EINTR);
+        // EAGAIN means that the counter is saturated, the main thread gets woken up anyway
+        if (ret != sizeof(one) && errno != EAGAIN) {
+            qCWarning(KWIN_LIBINPUT) << "Failed to signal the libinput events:" << strerror(errno);
+        }
     }
 }
 
@@ -284,22 +343,35 @@ KWin::TabletToolId createTabletId(libinput_tablet_tool *tool, void *userData)
 
 void Connection::processEvents()
 {
-    QMutexLocker locker(&m_mutex);
-    while (!m_eventQueue.isEmpty()) {
-        QScopedPointer<Event> event(m_eventQueue.takeFirst());
+    // Reset the eventfd before draining the ring, events pushed later signal it again. EAGAIN
+    // means that the notifier fired without new events, which is harmless.
+    quint64 count;
+    ssize_t ret;
+    do {
+        ret = read(m_eventFd, &count, sizeof(count));
+    } while (ret == -1 && errno == EINTR);
+    if (ret == -1 && errno != EAGAIN) {
+        qCWarning(KWIN_LIBINPUT) << "Failed to read the libinput event counter:" << strerror(errno);
+    } else if (ret != -1 && ret != sizeof(count)) {
+        qCWarning(KWIN_LIBINPUT) << "Short read of the libinput event counter:" << ret;
+    }
+
+    while (Event *event = m_eventRing.peek()) {
         switch (event->type()) {
         case LIBINPUT_EVENT_DEVICE_ADDED: {
+            QMutexLocker locker(&m_mutex);
             auto device = new Device(event->nativeDevice());
             device->moveToThread(thread());
             m_devices << device;
 
             applyDeviceConfig(device);
-            applyScreenToDevice(device);
+            scheduleScreenToDevice(device);
 
             Q_EMIT deviceAdded(device);
             break;
         }
         case LIBINPUT_EVENT_DEVICE_REMOVED: {
+            QMutexLocker locker(&m_mutex);
             auto it = std::find_if(m_devices.begin(), m_devices.end(), [&event](Device *d) {
                 return event->device() == d;
             });
@@ -309,17 +381,19 @@ void Connection::processEvents()
             }
             auto device = *it;
             m_devices.erase(it);
+            m_pendingConfigDevices.remove(device);
+            m_pendingScreenDevices.remove(device);
             Q_EMIT deviceRemoved(device);
             device->deleteLater();
             break;
         }
         case LIBINPUT_EVENT_KEYBOARD_KEY: {
-            KeyEvent *ke = static_cast<KeyEvent *>(event.data());
+            KeyEvent *ke = static_cast<KeyEvent *>(event);
             Q_EMIT ke->device()->keyChanged(ke->key(), ke->state(), ke->time(), ke->device());
             break;
         }
         case LIBINPUT_EVENT_POINTER_AXIS: {
-            PointerEvent *pe = static_cast<PointerEvent *>(event.data());
+            PointerEvent *pe = static_cast<PointerEvent *>(event);
             const auto axes = pe->axis();
             for (const InputRedirection::PointerAxis &axis : axes) {
                 Q_EMIT pe->device()->pointerAxisChanged(axis, pe->axisValue(axis), pe->discreteAxisValue(axis),
@@ -328,40 +402,41 @@ void Connection::processEvents()
             break;
         }
         case LIBINPUT_EVENT_POINTER_BUTTON: {
-            PointerEvent *pe = static_cast<PointerEvent *>(event.data());
+            PointerEvent *pe = static_cast<PointerEvent *>(event);
             Q_EMIT pe->device()->pointerButtonChanged(pe->button(), pe->buttonState(), pe->time(), pe->device());
             break;
         }
         case LIBINPUT_EVENT_POINTER_MOTION: {
-            PointerEvent *pe = static_cast<PointerEvent *>(event.data());
+            PointerEvent *pe = static_cast<PointerEvent *>(event);
+            Device *device = pe->device();
             auto delta = pe->delta();
             auto deltaNonAccel = pe->deltaUnaccelerated();
             quint32 latestTime = pe->time();
             quint64 latestTimeUsec = pe->timeMicroseconds();
-            auto it = m_eventQueue.begin();
-            while (it != m_eventQueue.end()) {
-                if ((*it)->type() == LIBINPUT_EVENT_POINTER_MOTION) {
-                    QScopedPointer<PointerEvent> p(static_cast<PointerEvent *>(*it));
-                    delta += p->delta();
-                    deltaNonAccel += p->deltaUnaccelerated();
-                    latestTime = p->time();
-                    latestTimeUsec = p->timeMicroseconds();
-                    it = m_eventQueue.erase(it);
-                } else {
+            m_eventRing.pop();
+            event = nullptr;
+            while (Event *next = m_eventRing.peek()) {
+                if (next->type() != LIBINPUT_EVENT_POINTER_MOTION) {
                     break;
                 }
+                PointerEvent *p = static_cast<PointerEvent *>(next);
+                delta += p->delta();
+                deltaNonAccel += p->deltaUnaccelerated();
+                latestTime = p->time();
+                latestTimeUsec = p->timeMicroseconds();
+                m_eventRing.pop();
             }
-            Q_EMIT pe->device()->pointerMotion(delta, deltaNonAccel, latestTime, latestTimeUsec, pe->device());
+            Q_EMIT device->pointerMotion(delta, deltaNonAccel, latestTime, latestTimeUsec, device);
             break;
         }
         case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE: {
-            PointerEvent *pe = static_cast<PointerEvent *>(event.data());
+            PointerEvent *pe = static_cast<PointerEvent *>(event);
             Q_EMIT pe->device()->pointerMotionAbsolute(pe->absolutePos(workspace()->geometry().size()), pe->time(), pe->device());
             break;
         }
         case LIBINPUT_EVENT_TOUCH_DOWN: {
 #ifndef KWIN_BUILD_TESTING
-            TouchEvent *te = static_cast<TouchEvent *>(event.data());
+            TouchEvent *te = static_cast<TouchEvent *>(event);
             const auto *output = te->device()->output();
             const QPointF globalPos = devicePointToGlobalPosition(te->absolutePos(output->modeSize()), output);
             Q_EMIT te->device()->touchDown(te->id(), globalPos, te->time(), te->device());
@@ -369,13 +444,13 @@ void Connection::processEvents()
 #endif
         }
         case LIBINPUT_EVENT_TOUCH_UP: {
-            TouchEvent *te = static_cast<TouchEvent *>(event.data());
+            TouchEvent *te = static_cast<TouchEvent *>(event);
             Q_EMIT te->device()->touchUp(te->id(), te->time(), te->device());
             break;
         }
         case LIBINPUT_EVENT_TOUCH_MOTION: {
 #ifndef KWIN_BUILD_TESTING
-            TouchEvent *te = static_cast<TouchEvent *>(event.data());
+            TouchEvent *te = static_cast<TouchEvent *>(event);
             const auto *output = te->device()->output();
             const QPointF globalPos = devicePointToGlobalPosition(te->absolutePos(output->modeSize()), output);
             Q_EMIT te->device()->touchMotion(te->id(), globalPos, te->time(), te->device());
@@ -391,17 +466,17 @@ void Connection::processEvents()
             break;
         }
         case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN: {
-            PinchGestureEvent *pe = static_cast<PinchGestureEvent *>(event.data());
+            PinchGestureEvent *pe = static_cast<PinchGestureEvent *>(event);
             Q_EMIT pe->device()->pinchGestureBegin(pe->fingerCount(), pe->time(), pe->device());
             break;
         }
         case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE: {
-            PinchGestureEvent *pe = static_cast<PinchGestureEvent *>(event.data());
+            PinchGestureEvent *pe = static_cast<PinchGestureEvent *>(event);
             Q_EMIT pe->device()->pinchGestureUpdate(pe->scale(), pe->angleDelta(), pe->delta(), pe->time(), pe->device());
             break;
         }
         case LIBINPUT_EVENT_GESTURE_PINCH_END: {
-            PinchGestureEvent *pe = static_cast<PinchGestureEvent *>(event.data());
+            PinchGestureEvent *pe = static_cast<PinchGestureEvent *>(event);
             if (pe->isCancelled()) {
                 Q_EMIT pe->device()->pinchGestureCancelled(pe->time(), pe->device());
             } else {
@@ -410,17 +485,17 @@ void Connection::processEvents()
             break;
         }
         case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN: {
-            SwipeGestureEvent *se = static_cast<SwipeGestureEvent *>(event.data());
+            SwipeGestureEvent *se = static_cast<SwipeGestureEvent *>(event);
             Q_EMIT se->device()->swipeGestureBegin(se->fingerCount(), se->time(), se->device());
             break;
         }
         case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE: {
-            SwipeGestureEvent *se = static_cast<SwipeGestureEvent *>(event.data());
+            SwipeGestureEvent *se = static_cast<SwipeGestureEvent *>(event);
             Q_EMIT se->device()->swipeGestureUpdate(se->delta(), se->time(), se->device());
             break;
         }
         case LIBINPUT_EVENT_GESTURE_SWIPE_END: {
-            SwipeGestureEvent *se = static_cast<SwipeGestureEvent *>(event.data());
+            SwipeGestureEvent *se = static_cast<SwipeGestureEvent *>(event);
             if (se->isCancelled()) {
                 Q_EMIT se->device()->swipeGestureCancelled(se->time(), se->device());
             } else {
@@ -429,12 +504,12 @@ void Connection::processEvents()
             break;
         }
         case LIBINPUT_EVENT_GESTURE_HOLD_BEGIN: {
-            HoldGestureEvent *he = static_cast<HoldGestureEvent *>(event.data());
+            HoldGestureEvent *he = static_cast<HoldGestureEvent *>(event);
             Q_EMIT he->device()->holdGestureBegin(he->fingerCount(), he->time(), he->device());
             break;
         }
         case LIBINPUT_EVENT_GESTURE_HOLD_END: {
-            HoldGestureEvent *he = static_cast<HoldGestureEvent *>(event.data());
+            HoldGestureEvent *he = static_cast<HoldGestureEvent *>(event);
             if (he->isCancelled()) {
                 Q_EMIT he->device()->holdGestureCancelled(he->time(), he->device());
             } else {
@@ -443,7 +518,7 @@ void Connection::processEvents()
             break;
         }
         case LIBINPUT_EVENT_SWITCH_TOGGLE: {
-            SwitchEvent *se = static_cast<SwitchEvent *>(event.data());
+            SwitchEvent *se = static_cast<SwitchEvent *>(event);
             switch (se->state()) {
             case SwitchEvent::State::Off:
                 Q_EMIT se->device()->switchToggledOff(se->time(), se->timeMicroseconds(), se->device());
@@ -459,7 +534,7 @@ void Connection::processEvents()
         case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
         case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
         case LIBINPUT_EVENT_TABLET_TOOL_TIP: {
-            auto *tte = static_cast<TabletToolEvent *>(event.data());
+            auto *tte = static_cast<TabletToolEvent *>(event);
 
             KWin::InputRedirection::TabletEventType tabletEventType;
             switch (event->type()) {
@@ -498,21 +573,21 @@ void Connection::processEvents()
             break;
         }
         case LIBINPUT_EVENT_TABLET_TOOL_BUTTON: {
-            auto *tabletEvent = static_cast<TabletToolButtonEvent *>(event.data());
+            auto *tabletEvent = static_cast<TabletToolButtonEvent *>(event);
             Q_EMIT event->device()->tabletToolButtonEvent(tabletEvent->buttonId(),
                                                           tabletEvent->isButtonPressed(),
                                                           createTabletId(tabletEvent->tool(), event->device()->groupUserData()));
             break;
         }
         case LIBINPUT_EVENT_TABLET_PAD_BUTTON: {
-            auto *tabletEvent = static_cast<TabletPadButtonEvent *>(event.data());
+            auto *tabletEvent = static_cast<TabletPadButtonEvent *>(event);
             Q_EMIT event->device()->tabletPadButtonEvent(tabletEvent->buttonId(),
                                                          tabletEvent->isButtonPressed(),
                                                          {event->device()->groupUserData()});
             break;
         }
         case LIBINPUT_EVENT_TABLET_PAD_RING: {
-            auto *tabletEvent = static_cast<TabletPadRingEvent *>(event.data());
+            auto *tabletEvent = static_cast<TabletPadRingEvent *>(event);
             tabletEvent->position();
             Q_EMIT event->device()->tabletPadRingEvent(tabletEvent->number(),
                                                        tabletEvent->position(),
@@ -521,7 +596,7 @@ void Connection::processEvents()
             break;
         }
         case LIBINPUT_EVENT_TABLET_PAD_STRIP: {
-            auto *tabletEvent = static_cast<TabletPadStripEvent *>(event.data());
+            auto *tabletEvent = static_cast<TabletPadStripEvent *>(event);
             Q_EMIT event->device()->tabletPadStripEvent(tabletEvent->number(),
                                                         tabletEvent->position(),
                                                         tabletEvent->source() == LIBINPUT_TABLET_PAD_STRIP_SOURCE_FINGER,
@@ -532,6 +607,15 @@ void Connection::processEvents()
             // nothing
             break;
         }
+        if (event) {
+            m_eventRing.pop();
+        }
+    }
+
+    // pairs with the fence in handleEvent(), the popped slots are visible before the flag is read
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_stalled.load(std::memory_order_relaxed) && m_stalled.exchange(false, std::memory_order_acq_rel)) {
+        QMetaObject::invokeMethod(this, &Connection::handleEvent, Qt::QueuedConnection);
     }
 }
 
@@ -539,6 +623,39 @@ void Connection::updateScreens()
 {
     QMutexLocker locker(&m_mutex);
     for (auto device : qAsConst(m_devices)) {
+        scheduleScreenToDevice(device);
+    }
+}
+
+void Connection::scheduleDeviceConfig(Device *device)
+{
+    m_pendingConfigDevices.insert(device);
+    if (!m_applyPendingScheduled) {
+        m_applyPendingScheduled = true;
+        QMetaObject::invokeMethod(this, &Connection::applyPendingDeviceChanges, Qt::QueuedConnection);
+    }
+}
+
+void Connection::scheduleScreenToDevice(Device *device)
+{
+    m_pendingScreenDevices.insert(device);
+    if (!m_applyPendingScheduled) {
+        m_applyPendingScheduled = true;
+        QMetaObject::invokeMethod(this, &Connection::applyPendingDeviceChanges, Qt::QueuedConnection);
+    }
+}
+
+void Connection::applyPendingDeviceChanges()
+{
+    QMutexLocker locker(&m_mutex);
+    m_applyPendingScheduled = false;
+
+    const QSet<Device *> configDevices = std::exchange(m_pendingConfigDevices, {});
+    const QSet<Device *> screenDevices = std::exchange(m_pendingScreenDevices, {});
+    for (Device *device : configDevices) {
+        applyDeviceConfig(device);
+    }
+    for (Device *device : screenDevices) {
         applyScreenToDevice(device);
     }
 }
@@ -640,7 +757,7 @@ void Connection::slotKGlobalSettingsNotifyChange(int type, int arg)
         m_config->reparseConfiguration();
         for (auto it = m_devices.constBegin(), end = m_devices.constEnd(); it != end; ++it) {
             if ((*it)->isPointer()) {
-                applyDeviceConfig(*it);
+                scheduleDeviceConfig(*it);
             }
         }
     }
@@ -9,6 +9,8 @@
 #ifndef KWIN_LIBINPUT_CONNECTION_H
 #define KWIN_LIBINPUT_CONNECTION_H
 
+#include "eventring.h"
+
 #include <kwinglobals.h>
 
 #include <KSharedConfig>
@@ -16,10 +18,13 @@
 #include <QObject>
 #include <QPointer>
 #include <QRecursiveMutex>
+#include <QSet>
 #include <QSize>
 #include <QStringList>
 #include <QVector>
 
+#include <atomic>
+
 class QSocketNotifier;
 class QThread;
 
@@ -47,7 +52,14 @@ public:
     void setup();
     void updateScreens();
     void deactivate();
+    /**
+     * Handles all events that have been read so far. Must be called on the main thread.
+     */
     void processEvents();
+    /**
+     * Returns an eventfd that becomes readable when there are new events for processEvents().
+     */
+    int eventFd() const;
 
     QStringList devicesSysNames() const;
 
@@ -55,8 +67,6 @@ Q_SIGNALS:
     void deviceAdded(KWin::LibInput::Device *);
     void deviceRemoved(KWin::LibInput::Device *);
 
-    void eventsRead();
-
 private Q_SLOTS:
     void doSetup();
     void slotKGlobalSettingsNotifyChange(int type, int arg);
@@ -66,12 +76,23 @@ private:
     void handleEvent();
     void applyDeviceConfig(Device *device);
     void applyScreenToDevice(Device *device);
+    void scheduleDeviceConfig(Device *device);
+    void scheduleScreenToDevice(Device *device);
+    void applyPendingDeviceChanges();
     Context *m_input;
     QSocketNotifier *m_notifier;
     QRecursiveMutex m_mutex;
-    QVector<Event *> m_eventQueue;
+    EventRing m_eventRing;
+    int m_eventFd = -1;
+    // set when the libinput thread stopped reading because the main thread fell behind, whoever
+    // clears it is responsible for resuming the reading
+    std::atomic<bool> m_stalled{false};
     QVector<Device *> m_devices;
     KSharedConfigPtr m_config;
+    // devices whose configuration gets applied in one pass on the next event loop iteration
+    QSet<Device *> m_pendingConfigDevices;
+    QSet<Device *> m_pendingScreenDevices;
+    bool m_applyPendingScheduled = false;
 
     KWIN_SINGLETON(Connection)
 };
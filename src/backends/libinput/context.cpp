@@ -7,7 +7,6 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 #include "context.h"
-#include "events.h"
 #include "libinput_logging.h"
 
 #include "main.h"
@@ -146,9 +145,9 @@ void Context::closeRestricted(int fd)
     kwinApp()->platform()->session()->closeRestricted(fd);
 }
 
-Event *Context::event()
+libinput_event *Context::event()
 {
-    return Event::create(libinput_get_event(m_libinput));
+    return libinput_get_event(m_libinput);
 }
 
 void Context::suspend()
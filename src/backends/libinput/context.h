@@ -19,8 +19,6 @@ class Udev;
 namespace LibInput
 {
 
-class Event;
-
 class Context
 {
 public:
@@ -52,9 +50,9 @@ public:
 
     /**
      * Gets the next event, if there is no new event @c null is returned.
-     * The caller takes ownership of the returned pointer.
+     * The caller takes ownership of the returned event.
      */
-    Event *event();
+    libinput_event *event();
 
     static int openRestrictedCallback(const char *path, int flags, void *user_data);
     static void closeRestrictedCallBack(int fd, void *user_data);
@@ -381,6 +381,9 @@ Device::Device(libinput_device *device, QObject *parent)
 Device::~Device()
 {
     QDBusConnection::sessionBus().unregisterObject(QStringLiteral("/org/kde/KWin/InputDevice/") + m_sysName);
+    if (m_configSyncScheduled) {
+        m_config.sync();
+    }
     libinput_device_set_user_data(m_device, nullptr);
     libinput_device_unref(m_device);
 }
@@ -402,7 +405,20 @@ void Device::writeEntry(const ConfigKey &key, const T &value)
     auto it = s_configData.find(key);
     Q_ASSERT(it != s_configData.end());
     m_config.writeEntry(it.value()->key.constData(), value);
-    m_config.sync();
+
+    // Several settings usually change together, write them back to disk once.
+    if (!m_configSyncScheduled) {
+        m_configSyncScheduled = true;
+        QMetaObject::invokeMethod(this, &Device::syncConfig, Qt::QueuedConnection);
+    }
+}
+
+void Device::syncConfig()
+{
+    m_configSyncScheduled = false;
+    if (m_config.isValid()) {
+        m_config.sync();
+    }
 }
 
 void Device::loadConfiguration()
@@ -664,6 +680,9 @@ Output *Device::output() const
 void Device::setOutput(Output *output)
 {
 #ifndef KWIN_BUILD_TESTING
+    if (m_output == output && m_outputName == (output ? output->name() : QString())) {
+        return;
+    }
     m_output = output;
     if (m_output) {
         m_outputName = output->name();
@@ -647,6 +647,7 @@ Q_SIGNALS:
 private:
     template<typename T>
     void writeEntry(const ConfigKey &key, const T &value);
+    void syncConfig();
 
     template<typename T>
     T defaultValue(const char *key, const T &fallback) const
@@ -719,6 +720,7 @@ private:
     KConfigGroup m_config;
     KConfigGroup m_defaultConfig;
     bool m_loading = false;
+    bool m_configSyncScheduled = false;
 
     QPointer<Output> m_output;
     Qt::ScreenOrientation m_orientation = Qt::PrimaryOrientation;
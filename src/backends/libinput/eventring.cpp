@@ -0,0 +1,84 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "eventring.h"
+#include "events.h"
+
+#include <cstddef>
+
+namespace KWin
+{
+namespace LibInput
+{
+
+static size_t slotSize()
+{
+    constexpr size_t alignment = alignof(std::max_align_t);
+    return (Event::maxSize() + alignment - 1) / alignment * alignment;
+}
+
+EventRing::EventRing(quint32 capacity)
+    : m_capacity(capacity)
+    , m_slotSize(slotSize())
+    , m_storage(new unsigned char[capacity * m_slotSize])
+{
+    // the slot index must stay continuous when the indices wrap around
+    Q_ASSERT((capacity & (capacity - 1)) == 0);
+}
+
+EventRing::~EventRing()
+{
+    const quint32 writeIndex = m_writeIndex.load(std::memory_order_acquire);
+    for (; m_reclaimIndex != writeIndex; ++m_reclaimIndex) {
+        slot(m_reclaimIndex)->~Event();
+    }
+}
+
+Event *EventRing::slot(quint32 index) const
+{
+    return reinterpret_cast<Event *>(m_storage.get() + (index % m_capacity) * m_slotSize);
+}
+
+bool EventRing::isFull()
+{
+    const quint32 writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+    if (writeIndex - m_reclaimIndex < m_capacity) {
+        return false;
+    }
+    const quint32 readIndex = m_readIndex.load(std::memory_order_acquire);
+    for (; m_reclaimIndex != readIndex; ++m_reclaimIndex) {
+        slot(m_reclaimIndex)->~Event();
+    }
+    return writeIndex - m_reclaimIndex >= m_capacity;
+}
+
+void EventRing::push(libinput_event *event)
+{
+    const quint32 writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+    Q_ASSERT(writeIndex - m_reclaimIndex < m_capacity);
+    Event::create(event, slot(writeIndex));
+    m_writeIndex.store(writeIndex + 1, std::memory_order_release);
+}
+
+Event *EventRing::peek() const
+{
+    const quint32 readIndex = m_readIndex.load(std::memory_order_relaxed);
+    if (readIndex == m_writeIndex.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return slot(readIndex);
+}
+
+void EventRing::pop()
+{
+    const quint32 readIndex = m_readIndex.load(std::memory_order_relaxed);
+    Q_ASSERT(readIndex != m_writeIndex.load(std::memory_order_acquire));
+    m_readIndex.store(readIndex + 1, std::memory_order_release);
+}
+
+} // namespace LibInput
+} // namespace KWin
@@ -0,0 +1,75 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <memory>
+
+struct libinput_event;
+
+namespace KWin
+{
+namespace LibInput
+{
+
+class Event;
+
+/**
+ * The EventRing class hands libinput events over from the libinput thread to the main thread.
+ *
+ * It's a bounded single producer, single consumer queue. The events are constructed in place
+ * in preallocated slots, so no memory is allocated per event, and the two threads synchronize
+ * only on the read and write indices: the indices are published with release stores and read
+ * with acquire loads, so a slot is never accessed by both threads at the same time. The consumer only marks events as done, the producer
+ * destroys them when it reuses their slots. That way libinput_event_destroy() is called on
+ * the libinput thread, like all other calls that modify the libinput state.
+ */
+class EventRing
+{
+public:
+    explicit EventRing(quint32 capacity = 1024);
+    ~EventRing();
+
+    /**
+     * Returns @c true if there is no free slot, even after destroying the events that the
+     * consumer is done with. Must be called by the producer.
+     */
+    bool isFull();
+    /**
+     * Appends the given @a event. The ring must not be full, i.e. isFull() must have returned
+     * @c false since the last push. Must be called by the producer.
+     */
+    void push(libinput_event *event);
+
+    /**
+     * Returns the oldest event that hasn't been popped yet, or @c null if there is none. Must
+     * be called by the consumer.
+     */
+    Event *peek() const;
+    /**
+     * Marks the oldest event as done. Must be called by the consumer.
+     */
+    void pop();
+
+private:
+    Event *slot(quint32 index) const;
+
+    const quint32 m_capacity;
+    const size_t m_slotSize;
+    std::unique_ptr<unsigned char[]> m_storage;
+
+    // The indices only ever grow, a slot is addressed by the index modulo the capacity.
+    alignas(64) std::atomic<quint32> m_readIndex{0};
+    alignas(64) std::atomic<quint32> m_writeIndex{0};
+    quint32 m_reclaimIndex = 0;
+};
+
+} // namespace LibInput
+} // namespace KWin
@@ -11,12 +11,29 @@
 
 #include <QSize>
 
+#include <algorithm>
+#include <new>
+
 namespace KWin
 {
 namespace LibInput
 {
 
+template<typename T, typename... Args>
+Event *Event::construct(void *storage, Args &&...args)
+{
+    if (storage) {
+        return new (storage) T(std::forward<Args>(args)...);
+    }
+    return new T(std::forward<Args>(args)...);
+}
+
 Event *Event::create(libinput_event *event)
+{
+    return create(event, nullptr);
+}
+
+Event *Event::create(libinput_event *event, void *storage)
 {
     if (!event) {
         return nullptr;
@@ -26,48 +43,56 @@ Event *Event::create(libinput_event *event)
     // TODO: add device notify events
     switch (t) {
     case LIBINPUT_EVENT_KEYBOARD_KEY:
-        return new KeyEvent(event);
+        return construct<KeyEvent>(storage, event);
     case LIBINPUT_EVENT_POINTER_AXIS:
     case LIBINPUT_EVENT_POINTER_BUTTON:
     case LIBINPUT_EVENT_POINTER_MOTION:
     case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
-        return new PointerEvent(event, t);
+        return construct<PointerEvent>(storage, event, t);
     case LIBINPUT_EVENT_TOUCH_DOWN:
     case LIBINPUT_EVENT_TOUCH_UP:
     case LIBINPUT_EVENT_TOUCH_MOTION:
     case LIBINPUT_EVENT_TOUCH_CANCEL:
     case LIBINPUT_EVENT_TOUCH_FRAME:
-        return new TouchEvent(event, t);
+        return construct<TouchEvent>(storage, event, t);
     case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
     case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
     case LIBINPUT_EVENT_GESTURE_SWIPE_END:
-        return new SwipeGestureEvent(event, t);
+        return construct<SwipeGestureEvent>(storage, event, t);
     case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
     case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
     case LIBINPUT_EVENT_GESTURE_PINCH_END:
-        return new PinchGestureEvent(event, t);
+        return construct<PinchGestureEvent>(storage, event, t);
     case LIBINPUT_EVENT_GESTURE_HOLD_BEGIN:
     case LIBINPUT_EVENT_GESTURE_HOLD_END:
-        return new HoldGestureEvent(event, t);
+        return construct<HoldGestureEvent>(storage, event, t);
     case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
     case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
     case LIBINPUT_EVENT_TABLET_TOOL_TIP:
-        return new TabletToolEvent(event, t);
+        return construct<TabletToolEvent>(storage, event, t);
     case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
-        return new TabletToolButtonEvent(event, t);
+        return construct<TabletToolButtonEvent>(storage, event, t);
     case LIBINPUT_EVENT_TABLET_PAD_RING:
-        return new TabletPadRingEvent(event, t);
+        return construct<TabletPadRingEvent>(storage, event, t);
     case LIBINPUT_EVENT_TABLET_PAD_STRIP:
-        return new TabletPadStripEvent(event, t);
+        return construct<TabletPadStripEvent>(storage, event, t);
     case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
-        return new TabletPadButtonEvent(event, t);
+        return construct<TabletPadButtonEvent>(storage, event, t);
     case LIBINPUT_EVENT_SWITCH_TOGGLE:
-        return new SwitchEvent(event, t);
+        return construct<SwitchEvent>(storage, event, t);
     default:
-        return new Event(event, t);
+        return construct<Event>(storage, event, t);
     }
 }
 
+size_t Event::maxSize()
+{
+    return std::max({sizeof(Event), sizeof(KeyEvent), sizeof(PointerEvent), sizeof(TouchEvent),
+                     sizeof(SwipeGestureEvent), sizeof(PinchGestureEvent), sizeof(HoldGestureEvent),
+                     sizeof(TabletToolEvent), sizeof(TabletToolButtonEvent), sizeof(TabletPadRingEvent),
+                     sizeof(TabletPadStripEvent), sizeof(TabletPadButtonEvent), sizeof(SwitchEvent)});
+}
+
 Event::Event(libinput_event *event, libinput_event_type type)
     : m_event(event)
     , m_type(type)
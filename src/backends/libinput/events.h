@@ -39,11 +39,24 @@ public:
     }
 
     static Event *create(libinput_event *event);
+    /**
+     * Same as create(), but constructs the event in the given @a storage, which must be at
+     * least maxSize() bytes large and suitably aligned. The event must be destroyed by calling
+     * its destructor instead of deleting it.
+     */
+    static Event *create(libinput_event *event, void *storage);
+    /**
+     * Returns the size of the largest event class.
+     */
+    static size_t maxSize();
 
 protected:
     Event(libinput_event *event, libinput_event_type type);
 
 private:
+    template<typename T, typename... Args>
+    static Event *construct(void *storage, Args &&...args);
+
     libinput_event *m_event;
     libinput_event_type m_type;
     mutable Device *m_device;
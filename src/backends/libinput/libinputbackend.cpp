@@ -8,6 +8,8 @@
 #include "connection.h"
 #include "device.h"
 
+#include <QSocketNotifier>
+
 namespace KWin
 {
 
@@ -21,11 +23,10 @@ LibinputBackend::LibinputBackend(QObject *parent)
     m_connection = LibInput::Connection::create(this);
     m_connection->moveToThread(m_thread);
 
-    connect(
-        m_connection, &LibInput::Connection::eventsRead, this, [this]() {
-            m_connection->processEvents();
-        },
-        Qt::QueuedConnection);
+    m_eventNotifier = new QSocketNotifier(m_connection->eventFd(), QSocketNotifier::Read, this);
+    connect(m_eventNotifier, &QSocketNotifier::activated, this, [this]() {
+        m_connection->processEvents();
+    });
 
     // Direct connection because the deviceAdded() and the deviceRemoved() signals are emitted
     // from the main thread.
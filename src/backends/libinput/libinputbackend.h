@@ -10,6 +10,8 @@
 
 #include <QThread>
 
+class QSocketNotifier;
+
 namespace KWin
 {
 
@@ -31,6 +33,7 @@ public:
 private:
     QThread *m_thread = nullptr;
     LibInput::Connection *m_connection = nullptr;
+    QSocketNotifier *m_eventNotifier = nullptr;
 };
 
 } // namespace KWin
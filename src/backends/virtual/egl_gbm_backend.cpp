@@ -103,6 +103,7 @@ void EglGbmBackend::init()
     initKWinGL();
 
     m_backBuffer = new GLTexture(GL_RGB8, screens()->size().width(), screens()->size().height());
+    m_backBuffer->setMemoryCategory(GLMemoryTracker::Swapchain);
     m_fbo = new GLFramebuffer(m_backBuffer);
     if (!m_fbo->valid()) {
         setFailed("Could not create framebuffer object");
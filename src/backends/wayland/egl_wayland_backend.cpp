@@ -17,13 +17,20 @@
 #include "wayland_output.h"
 
 #include "composite.h"
+#include "egl_dmabuf.h"
+#include "kwineglext.h"
 #include "kwinglutils.h"
 #include "logging.h"
 #include "options.h"
 
 #include "screens.h"
+#include "surfaceitem_wayland.h"
+#include "wayland/linuxdmabufv1clientbuffer.h"
+#include "wayland/surface_interface.h"
 #include "wayland_server.h"
 
+#include "wayland-linux-dmabuf-unstable-v1-client-protocol.h"
+
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -64,6 +71,91 @@ static QVector<EGLint> regionToRects(const QRegion &region, Output *output)
     return rects;
 }
 
+DmabufPassthroughBuffer::DmabufPassthroughBuffer(KWaylandServer::LinuxDmaBufV1ClientBuffer *clientBuffer, WaylandBackend *backend)
+    : m_clientBuffer(clientBuffer)
+{
+    const QVector<KWaylandServer::LinuxDmaBufV1Plane> planes = clientBuffer->planes();
+    if (!backend->supportsDmabufFormat(clientBuffer->format(), planes.constFirst().modifier)) {
+        m_state = State::Failed;
+        return;
+    }
+
+    m_params = zwp_linux_dmabuf_v1_create_params(backend->linuxDmabuf());
+    for (int i = 0; i < planes.count(); ++i) {
+        const KWaylandServer::LinuxDmaBufV1Plane &plane = planes[i];
+        zwp_linux_buffer_params_v1_add(m_params, plane.fd, i, plane.offset, plane.stride,
+                                       plane.modifier >> 32, plane.modifier & 0xffffffff);
+    }
+
+    static const zwp_linux_buffer_params_v1_listener paramsListener = {
+        .created = [](void *data, zwp_linux_buffer_params_v1 *params, wl_buffer *buffer) {
+            Q_UNUSED(params)
+            auto passthrough = static_cast<DmabufPassthroughBuffer *>(data);
+            passthrough->m_buffer = buffer;
+            passthrough->m_state = State::Ready;
+
+            static const wl_buffer_listener bufferListener = {
+                .release = [](void *data, wl_buffer *buffer) {
+                    Q_UNUSED(buffer)
+                    static_cast<DmabufPassthroughBuffer *>(data)->release();
+                },
+            };
+            wl_buffer_add_listener(buffer, &bufferListener, passthrough);
+        },
+        .failed = [](void *data, zwp_linux_buffer_params_v1 *params) {
+            Q_UNUSED(params)
+            static_cast<DmabufPassthroughBuffer *>(data)->m_state = State::Failed;
+        },
+    };
+    zwp_linux_buffer_params_v1_add_listener(m_params, &paramsListener, this);
+    zwp_linux_buffer_params_v1_create(m_params, clientBuffer->size().width(), clientBuffer->size().height(),
+                                      clientBuffer->format(), clientBuffer->flags());
+    backend->flush();
+}
+
+DmabufPassthroughBuffer::~DmabufPassthroughBuffer()
+{
+    if (m_buffer) {
+        wl_buffer_destroy(m_buffer);
+    }
+    if (m_params) {
+        zwp_linux_buffer_params_v1_destroy(m_params);
+    }
+    release();
+}
+
+DmabufPassthroughBuffer::State DmabufPassthroughBuffer::state() const
+{
+    return m_state;
+}
+
+wl_buffer *DmabufPassthroughBuffer::buffer() const
+{
+    return m_buffer;
+}
+
+KWaylandServer::LinuxDmaBufV1ClientBuffer *DmabufPassthroughBuffer::clientBuffer() const
+{
+    return m_clientBuffer;
+}
+
+void DmabufPassthroughBuffer::attach()
+{
+    // The client must not reuse the buffer while the host compositor still reads from it
+    if (!m_referenced) {
+        m_clientBuffer->ref();
+        m_referenced = true;
+    }
+}
+
+void DmabufPassthroughBuffer::release()
+{
+    if (m_referenced) {
+        m_referenced = false;
+        m_clientBuffer->unref();
+    }
+}
+
 EglWaylandOutput::EglWaylandOutput(WaylandOutput *output, EglWaylandBackend *backend)
     : m_waylandOutput(output)
     , m_backend(backend)
@@ -179,8 +271,66 @@ void EglWaylandOutput::aboutToStartPainting(const QRegion &damage)
     }
 }
 
+bool EglWaylandOutput::scanout(SurfaceItem *surfaceItem)
+{
+    static bool valid;
+    static const bool directScanoutDisabled = qEnvironmentVariableIntValue("KWIN_WAYLAND_NO_DIRECT_SCANOUT", &valid) == 1 && valid;
+    if (directScanoutDisabled || !m_backend->backend()->linuxDmabuf()) {
+        return false;
+    }
+
+    SurfaceItemWayland *item = qobject_cast<SurfaceItemWayland *>(surfaceItem);
+    if (!item || !item->surface()) {
+        return false;
+    }
+    const auto buffer = qobject_cast<KWaylandServer::LinuxDmaBufV1ClientBuffer *>(item->surface()->buffer());
+    if (!buffer || buffer->planes().isEmpty() || buffer->size() != m_waylandOutput->pixelSize()
+        || m_waylandOutput->transform() != Output::Transform::Normal) {
+        return false;
+    }
+
+    // The first frame of a new buffer is composited, the host buffer is ready by the next one
+    DmabufPassthroughBuffer *passthrough = m_backend->passthroughBuffer(buffer);
+    if (passthrough->state() != DmabufPassthroughBuffer::State::Ready) {
+        return false;
+    }
+
+    // damage tracking for screen casting
+    m_scanoutDamage = m_scanoutSurface == item->surface() ? surfaceItem->damage() : infiniteRegion();
+    surfaceItem->resetDamage();
+    m_scanoutSurface = item->surface();
+    m_scanoutBuffer = passthrough;
+    return true;
+}
+
+void EglWaylandOutput::presentScanout()
+{
+    KWayland::Client::Surface *surface = m_waylandOutput->surface();
+    surface->setupFrameCallback();
+    surface->setScale(std::ceil(m_waylandOutput->scale()));
+    m_presentedScanoutBuffer = m_scanoutBuffer->clientBuffer();
+    Q_EMIT m_waylandOutput->outputChange(m_scanoutDamage);
+
+    m_scanoutBuffer->attach();
+    wl_surface_attach(*surface, m_scanoutBuffer->buffer(), 0, 0);
+    wl_surface_damage_buffer(*surface, 0, 0, INT32_MAX, INT32_MAX);
+    surface->commit(KWayland::Client::Surface::CommitFlag::None);
+    m_backend->backend()->flush();
+
+    m_scanoutBuffer = nullptr;
+    // The EGL back buffers missed everything that happened meanwhile
+    resetBufferAge();
+}
+
 void EglWaylandOutput::present()
 {
+    if (m_scanoutBuffer) {
+        presentScanout();
+        return;
+    }
+    m_scanoutSurface.clear();
+    m_presentedScanoutBuffer.clear();
+
     m_waylandOutput->surface()->setupFrameCallback();
     m_waylandOutput->surface()->setScale(std::ceil(m_waylandOutput->scale()));
     Q_EMIT m_waylandOutput->outputChange(m_damageJournal.lastDamage());
@@ -233,6 +383,7 @@ EglWaylandBackend::EglWaylandBackend(WaylandBackend *b)
 
 EglWaylandBackend::~EglWaylandBackend()
 {
+    qDeleteAll(m_passthroughBuffers);
     cleanup();
 }
 
@@ -364,6 +515,19 @@ bool EglWaylandBackend::initBufferConfigs()
 
 QSharedPointer<KWin::GLTexture> EglWaylandBackend::textureForOutput(KWin::Output *output) const
 {
+    // nothing is rendered into the back buffer while a client buffer is passed through
+    if (const auto buffer = dynamic_cast<EglDmabufBuffer *>(m_outputs[output]->m_presentedScanoutBuffer.data())) {
+        if (buffer->images().isEmpty() || buffer->images().constFirst() == EGL_NO_IMAGE_KHR) {
+            return nullptr;
+        }
+        // the texture keeps the buffer storage alive, even after the client buffer is gone
+        QSharedPointer<GLTexture> texture(new GLTexture(GL_RGBA8, buffer->size(), 1, true));
+        texture->bind();
+        glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(buffer->images().constFirst()));
+        texture->unbind();
+        return texture;
+    }
+
     QSharedPointer<GLTexture> texture(new GLTexture(GL_RGBA8, output->pixelSize()));
     GLFramebuffer::pushFramebuffer(m_outputs[output]->fbo());
     GLFramebuffer renderTarget(texture.data());
@@ -382,6 +546,18 @@ SurfaceTexture *EglWaylandBackend::createSurfaceTextureWayland(SurfacePixmapWayl
     return new BasicEGLSurfaceTextureWayland(this, pixmap);
 }
 
+DmabufPassthroughBuffer *EglWaylandBackend::passthroughBuffer(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer)
+{
+    DmabufPassthroughBuffer *&passthrough = m_passthroughBuffers[buffer];
+    if (!passthrough) {
+        passthrough = new DmabufPassthroughBuffer(buffer, m_backend);
+        connect(buffer, &QObject::destroyed, this, [this, buffer]() {
+            delete m_passthroughBuffers.take(buffer);
+        });
+    }
+    return passthrough;
+}
+
 void EglWaylandBackend::present(Output *output)
 {
     m_outputs[output]->present();
@@ -15,9 +15,18 @@
 // wayland
 #include <wayland-egl.h>
 
+#include <QPointer>
+
 class QTemporaryFile;
 struct wl_buffer;
 struct wl_shm;
+struct zwp_linux_buffer_params_v1;
+
+namespace KWaylandServer
+{
+class LinuxDmaBufV1ClientBuffer;
+class SurfaceInterface;
+}
 
 namespace KWin
 {
@@ -29,6 +38,42 @@ class WaylandBackend;
 class WaylandOutput;
 class EglWaylandBackend;
 
+/**
+ * A client dmabuf re-exported to the host compositor, so it can be attached to the output
+ * surface as is. The host buffer is created asynchronously, it can only be used once it's
+ * ready. While the host uses it, the client buffer is kept referenced.
+ */
+class DmabufPassthroughBuffer
+{
+public:
+    enum class State {
+        Pending,
+        Ready,
+        Failed,
+    };
+
+    DmabufPassthroughBuffer(KWaylandServer::LinuxDmaBufV1ClientBuffer *clientBuffer, WaylandBackend *backend);
+    ~DmabufPassthroughBuffer();
+
+    State state() const;
+    wl_buffer *buffer() const;
+    KWaylandServer::LinuxDmaBufV1ClientBuffer *clientBuffer() const;
+
+    /**
+     * Marks the buffer as attached to a host surface, until the host releases it.
+     */
+    void attach();
+
+private:
+    void release();
+
+    KWaylandServer::LinuxDmaBufV1ClientBuffer *m_clientBuffer;
+    zwp_linux_buffer_params_v1 *m_params = nullptr;
+    wl_buffer *m_buffer = nullptr;
+    State m_state = State::Pending;
+    bool m_referenced = false;
+};
+
 class EglWaylandOutput : public OutputLayer
 {
 public:
@@ -45,9 +90,11 @@ public:
     OutputLayerBeginFrameInfo beginFrame() override;
     bool endFrame(const QRegion &renderedRegion, const QRegion &damagedRegion) override;
     void aboutToStartPainting(const QRegion &damage) override;
+    bool scanout(SurfaceItem *surfaceItem) override;
 
 private:
     void resetBufferAge();
+    void presentScanout();
 
     WaylandOutput *m_waylandOutput;
     wl_egl_window *m_overlay = nullptr;
@@ -56,6 +103,11 @@ private:
     DamageJournal m_damageJournal;
     QScopedPointer<GLFramebuffer> m_fbo;
     EglWaylandBackend *const m_backend;
+    DmabufPassthroughBuffer *m_scanoutBuffer = nullptr;
+    // the client buffer that's shown instead of the composited frame, if any
+    QPointer<KWaylandServer::LinuxDmaBufV1ClientBuffer> m_presentedScanoutBuffer;
+    QPointer<KWaylandServer::SurfaceInterface> m_scanoutSurface;
+    QRegion m_scanoutDamage;
 
     friend class EglWaylandBackend;
 };
@@ -90,9 +142,18 @@ public:
     {
         return m_havePlatformBase;
     }
+    WaylandBackend *backend() const
+    {
+        return m_backend;
+    }
 
     QSharedPointer<KWin::GLTexture> textureForOutput(KWin::Output *output) const override;
 
+    /**
+     * Returns the host buffer for the client dmabuf @a buffer, creating it on first use.
+     */
+    DmabufPassthroughBuffer *passthroughBuffer(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer);
+
 private:
     bool initializeEgl();
     bool initBufferConfigs();
@@ -106,6 +167,7 @@ private:
 
     WaylandBackend *m_backend;
     QMap<Output *, QSharedPointer<EglWaylandOutput>> m_outputs;
+    QHash<KWaylandServer::LinuxDmaBufV1ClientBuffer *, DmabufPassthroughBuffer *> m_passthroughBuffers;
     bool m_havePlatformBase;
     friend class EglWaylandTexture;
 };
@@ -49,6 +49,8 @@
 #include <KWayland/Client/touch.h>
 #include <KWayland/Client/xdgshell.h>
 
+#include "wayland-linux-dmabuf-unstable-v1-client-protocol.h"
+
 #include <QMetaMethod>
 #include <QThread>
 
@@ -613,6 +615,9 @@ WaylandBackend::~WaylandBackend()
     if (m_xdgShell) {
         m_xdgShell->release();
     }
+    if (m_linuxDmabuf) {
+        zwp_linux_dmabuf_v1_destroy(m_linuxDmabuf);
+    }
     m_subCompositor->release();
     m_compositor->release();
     m_registry->release();
@@ -629,6 +634,11 @@ WaylandBackend::~WaylandBackend()
     qCDebug(KWIN_WAYLAND_BACKEND) << "Destroyed Wayland display";
 }
 
+bool WaylandBackend::supportsDmabufFormat(uint32_t format, uint64_t modifier) const
+{
+    return m_dmabufFormats.value(format).contains(modifier);
+}
+
 bool WaylandBackend::initialize()
 {
     connect(m_registry, &Registry::compositorAnnounced, this, [this](quint32 name, quint32 version) {
@@ -667,6 +677,26 @@ bool WaylandBackend::initialize()
         }
         m_pointerGestures = m_registry->createPointerGestures(name, version, this);
     });
+    connect(m_registry, &Registry::interfaceAnnounced, this, [this](const QByteArray &interface, quint32 name, quint32 version) {
+        if (interface != zwp_linux_dmabuf_v1_interface.name || version < 3) {
+            return;
+        }
+        m_linuxDmabuf = static_cast<zwp_linux_dmabuf_v1 *>(wl_registry_bind(*m_registry, name, &zwp_linux_dmabuf_v1_interface, 3));
+        static const zwp_linux_dmabuf_v1_listener dmabufListener = {
+            .format = [](void *data, zwp_linux_dmabuf_v1 *dmabuf, uint32_t format) {
+                Q_UNUSED(data)
+                Q_UNUSED(dmabuf)
+                Q_UNUSED(format)
+                // Superseded by the modifier event in version 3
+            },
+            .modifier = [](void *data, zwp_linux_dmabuf_v1 *dmabuf, uint32_t format, uint32_t modifierHigh, uint32_t modifierLow) {
+                Q_UNUSED(dmabuf)
+                auto backend = static_cast<WaylandBackend *>(data);
+                backend->m_dmabufFormats[format].append((uint64_t(modifierHigh) << 32) | modifierLow);
+            },
+        };
+        zwp_linux_dmabuf_v1_add_listener(m_linuxDmabuf, &dmabufListener, this);
+    });
     connect(m_registry, &Registry::interfacesAnnounced, this, &WaylandBackend::createOutputs);
     connect(m_registry, &Registry::interfacesAnnounced, this, [this]() {
         const auto seatInterface = m_registry->interface(Registry::Interface::Seat);
@@ -21,6 +21,7 @@
 #include <QObject>
 #include <QPoint>
 #include <QSize>
+#include <QVector>
 
 class QTemporaryFile;
 struct wl_buffer;
@@ -28,6 +29,7 @@ struct wl_display;
 struct wl_event_queue;
 struct wl_seat;
 struct gbm_device;
+struct zwp_linux_dmabuf_v1;
 
 namespace KWayland
 {
@@ -263,6 +265,20 @@ public:
 
     void flush();
 
+    /**
+     * Returns the host's linux-dmabuf global, or @c nullptr if the host compositor doesn't
+     * support it.
+     */
+    zwp_linux_dmabuf_v1 *linuxDmabuf() const
+    {
+        return m_linuxDmabuf;
+    }
+    /**
+     * Returns @c true if the host compositor accepts dmabufs with the given @a format
+     * and @a modifier.
+     */
+    bool supportsDmabufFormat(uint32_t format, uint64_t modifier) const;
+
     WaylandSeat *seat() const
     {
         return m_seat;
@@ -331,6 +347,8 @@ private:
     KWayland::Client::RelativePointerManager *m_relativePointerManager = nullptr;
     KWayland::Client::PointerConstraints *m_pointerConstraints = nullptr;
     KWayland::Client::PointerGestures *m_pointerGestures = nullptr;
+    zwp_linux_dmabuf_v1 *m_linuxDmabuf = nullptr;
+    QHash<uint32_t, QVector<uint64_t>> m_dmabufFormats;
 
     QThread *m_connectionThread;
     QVector<WaylandOutput *> m_outputs;
@@ -23,6 +23,8 @@
 #include <QtPlatformHeaders/QEGLNativeContext>
 #endif
 
+#include <utility>
+
 namespace KWin
 {
 
@@ -227,11 +229,27 @@ void EglSurfaceTextureX11::update(const QRegion &region)
     Q_UNUSED(region)
     // mipmaps need to be updated
     m_texture->setDirty();
+    static_cast<EglPixmapTexture *>(m_texture.data())->scheduleRebind();
+}
+
+void EglBackend::rebindPixmaps()
+{
+    const QVector<EglPixmapTexturePrivate *> textures = std::exchange(m_pendingRebinds, {});
+    if (textures.isEmpty()) {
+        return;
+    }
+    // This is just implemented to be consistent with
+    // the example in mesa/demos/src/egl/opengles1/texture_from_pixmap.c
+    eglWaitNative(EGL_CORE_NATIVE_ENGINE);
+    for (EglPixmapTexturePrivate *texture : textures) {
+        texture->rebind();
+    }
 }
 
 EglPixmapTexture::EglPixmapTexture(EglBackend *backend)
     : GLTexture(*new EglPixmapTexturePrivate(this, backend))
 {
+    setMemoryCategory(GLMemoryTracker::Surface);
 }
 
 bool EglPixmapTexture::create(SurfacePixmapX11 *texture)
@@ -240,6 +258,12 @@ bool EglPixmapTexture::create(SurfacePixmapX11 *texture)
     return d->create(texture);
 }
 
+void EglPixmapTexture::scheduleRebind()
+{
+    Q_D(EglPixmapTexture);
+    d->scheduleRebind();
+}
+
 EglPixmapTexturePrivate::EglPixmapTexturePrivate(EglPixmapTexture *texture, EglBackend *backend)
     : q(texture)
     , m_backend(backend)
@@ -249,6 +273,9 @@ EglPixmapTexturePrivate::EglPixmapTexturePrivate(EglPixmapTexture *texture, EglB
 
 EglPixmapTexturePrivate::~EglPixmapTexturePrivate()
 {
+    if (m_rebindPending) {
+        m_backend->m_pendingRebinds.removeOne(this);
+    }
     if (m_image != EGL_NO_IMAGE_KHR) {
         eglDestroyImageKHR(m_backend->eglDisplay(), m_image);
     }
@@ -284,16 +311,33 @@ bool EglPixmapTexturePrivate::create(SurfacePixmapX11 *pixmap)
     q->setYInverted(true);
     m_size = pixmap->size();
     updateMatrix();
+    updateMemoryUsage();
     return true;
 }
 
+void EglPixmapTexturePrivate::scheduleRebind()
+{
+    if (!options->isGlStrictBinding() || m_image == EGL_NO_IMAGE_KHR || m_rebindPending) {
+        return;
+    }
+    m_rebindPending = true;
+    m_backend->m_pendingRebinds.append(this);
+}
+
+void EglPixmapTexturePrivate::rebind()
+{
+    m_rebindPending = false;
+    glBindTexture(m_target, m_texture);
+    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(m_image));
+}
+
 void EglPixmapTexturePrivate::onDamage()
 {
-    if (options->isGlStrictBinding()) {
-        // This is just implemented to be consistent with
-        // the example in mesa/demos/src/egl/opengles1/texture_from_pixmap.c
-        eglWaitNative(EGL_CORE_NATIVE_ENGINE);
-        glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(m_image));
+    if (m_rebindPending) {
+        // The first damaged texture that gets painted rebinds the pixmaps of all other damaged
+        // windows too, the ones that are occluded haven't been scheduled.
+        m_backend->rebindPixmaps();
+        glBindTexture(m_target, m_texture);
     }
     GLTexturePrivate::onDamage();
 }
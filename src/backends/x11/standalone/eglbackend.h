@@ -50,6 +50,12 @@ public:
     void present(Output *output) override;
     OutputLayer *primaryLayer(Output *output) override;
 
+    /**
+     * Rebinds all window pixmaps that have been damaged since the last frame at once, so
+     * the X server has to be waited for only once. Only used with strict binding.
+     */
+    void rebindPixmaps();
+
 private:
     void screenGeometryChanged();
     void presentSurface(EGLSurface surface, const QRegion &damage, const QRect &screenGeometry);
@@ -62,6 +68,8 @@ private:
     int m_bufferAge = 0;
     QRegion m_lastRenderedRegion;
     QScopedPointer<EglLayer> m_layer;
+    QVector<EglPixmapTexturePrivate *> m_pendingRebinds;
+    friend class EglPixmapTexturePrivate;
 };
 
 class EglPixmapTexture : public GLTexture
@@ -70,6 +78,7 @@ public:
     explicit EglPixmapTexture(EglBackend *backend);
 
     bool create(SurfacePixmapX11 *texture);
+    void scheduleRebind();
 
 private:
     Q_DECLARE_PRIVATE(EglPixmapTexture)
@@ -82,6 +91,8 @@ public:
     ~EglPixmapTexturePrivate() override;
 
     bool create(SurfacePixmapX11 *texture);
+    void scheduleRebind();
+    void rebind();
 
 protected:
     void onDamage() override;
@@ -90,6 +101,7 @@ private:
     EglPixmapTexture *q;
     EglBackend *m_backend;
     EGLImageKHR m_image = EGL_NO_IMAGE_KHR;
+    bool m_rebindPending = false;
 };
 
 class EglSurfaceTextureX11 : public OpenGLSurfaceTextureX11
@@ -74,6 +74,7 @@ typedef struct xcb_glx_buffer_swap_complete_event_t
 #endif
 
 #include <tuple>
+#include <utility>
 
 namespace KWin
 {
@@ -153,6 +154,10 @@ GlxBackend::~GlxBackend()
     }
     // TODO: cleanup in error case
     // do cleanup after initBuffer()
+    if (m_copySubBufferQueries[0]) {
+        makeCurrent();
+        glDeleteQueries(2, m_copySubBufferQueries);
+    }
     cleanupGL();
     doneCurrent();
 
@@ -271,6 +276,11 @@ void GlxBackend::init()
         supportsSwapEvent = false;
     }
 
+    qCDebug(KWIN_X11STANDALONE) << "Partial updates:"
+                                << "buffer age" << supportsBufferAge()
+                                << "copy sub buffer" << m_haveMESACopySubBuffer
+                                << "swap event" << supportsSwapEvent;
+
     static bool syncToVblankDisabled = qEnvironmentVariableIsSet("KWIN_X11_NO_SYNC_TO_VBLANK");
     if (!syncToVblankDisabled) {
         if (haveSwapInterval) {
@@ -732,6 +742,107 @@ void GlxBackend::setSwapInterval(int interval)
     }
 }
 
+static qint64 rectArea(const QRect &rect)
+{
+    return qint64(rect.width()) * rect.height();
+}
+
+void CopySubBufferEstimator::addSample(int rectCount, qint64 pixelCount, std::chrono::nanoseconds duration)
+{
+    // Older samples fade out so the estimate follows changing clocks and workloads.
+    static const double decay = 0.98;
+
+    const double rects = rectCount;
+    const double pixels = pixelCount;
+    const double time = duration.count();
+    m_weight = m_weight * decay + 1;
+    m_sumRectsSquared = m_sumRectsSquared * decay + rects * rects;
+    m_sumRectsPixels = m_sumRectsPixels * decay + rects * pixels;
+    m_sumPixelsSquared = m_sumPixelsSquared * decay + pixels * pixels;
+    m_sumRectsDuration = m_sumRectsDuration * decay + rects * time;
+    m_sumPixelsDuration = m_sumPixelsDuration * decay + pixels * time;
+}
+
+bool CopySubBufferEstimator::hasEstimate() const
+{
+    // the costs can't be told apart until frames with different rects per pixel were seen
+    return m_weight >= 16 && m_sumRectsSquared * m_sumPixelsSquared - m_sumRectsPixels * m_sumRectsPixels > 0;
+}
+
+double CopySubBufferEstimator::estimate(int rectCount, qint64 pixelCount) const
+{
+    const double determinant = m_sumRectsSquared * m_sumPixelsSquared - m_sumRectsPixels * m_sumRectsPixels;
+    const double callCost = std::max(0.0, (m_sumRectsDuration * m_sumPixelsSquared - m_sumPixelsDuration * m_sumRectsPixels) / determinant);
+    const double pixelCost = std::max(0.0, (m_sumPixelsDuration * m_sumRectsSquared - m_sumRectsDuration * m_sumRectsPixels) / determinant);
+    return rectCount * callCost + pixelCount * pixelCost;
+}
+
+void GlxBackend::collectCopySubBufferSample()
+{
+    if (!m_copySubBufferQueryPending) {
+        return;
+    }
+    GLint available = 0;
+    glGetQueryObjectiv(m_copySubBufferQueries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        // the copy is still in flight, skip this sample rather than stalling
+        return;
+    }
+    m_copySubBufferQueryPending = false;
+
+    GLuint64 start = 0;
+    GLuint64 end = 0;
+    glGetQueryObjectui64v(m_copySubBufferQueries[0], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(m_copySubBufferQueries[1], GL_QUERY_RESULT, &end);
+    m_copySubBufferEstimator.addSample(m_copySubBufferRectCount, m_copySubBufferPixelCount, std::chrono::nanoseconds(end - start));
+}
+
+void GlxBackend::copySubBuffer(const QRegion &damage)
+{
+    const QSize &screenSize = screens()->size();
+
+    qint64 damagedArea = 0;
+    for (const QRect &rect : damage) {
+        damagedArea += rectArea(rect);
+    }
+
+    // The bounding rect can be copied only if everything in it has been painted since the
+    // last buffer swap, and only pays off if the calls dominate the cost of copying.
+    QRegion rects = damage;
+    const QRect bounds = damage.boundingRect();
+    if (damage.rectCount() > 1 && m_copySubBufferEstimator.hasEstimate() && (QRegion(bounds) - m_validBackBufferRegion).isEmpty()) {
+        if (m_copySubBufferEstimator.estimate(1, rectArea(bounds)) < m_copySubBufferEstimator.estimate(damage.rectCount(), damagedArea)) {
+            rects = bounds;
+        }
+    }
+
+    // The copies are executed by the GPU, measure them there. Only one measurement is
+    // in flight at a time, so a pending one is never overwritten.
+    collectCopySubBufferSample();
+    const bool measure = GLRenderTimeQuery::supported() && !m_copySubBufferQueryPending;
+    if (measure) {
+        if (!m_copySubBufferQueries[0]) {
+            glGenQueries(2, m_copySubBufferQueries);
+        }
+        glQueryCounter(m_copySubBufferQueries[0], GL_TIMESTAMP);
+    }
+
+    qint64 copiedArea = 0;
+    for (const QRect &r : rects) {
+        // convert to OpenGL coordinates
+        int y = screenSize.height() - r.y() - r.height();
+        glXCopySubBufferMESA(display(), glxWindow, r.x(), y, r.width(), r.height());
+        copiedArea += rectArea(r);
+    }
+
+    if (measure) {
+        glQueryCounter(m_copySubBufferQueries[1], GL_TIMESTAMP);
+        m_copySubBufferQueryPending = true;
+        m_copySubBufferRectCount = rects.rectCount();
+        m_copySubBufferPixelCount = copiedArea;
+    }
+}
+
 void GlxBackend::present(const QRegion &damage)
 {
     const QSize &screenSize = screens()->size();
@@ -743,12 +854,15 @@ void GlxBackend::present(const QRegion &damage)
         if (supportsBufferAge()) {
             glXQueryDrawable(display(), glxWindow, GLX_BACK_BUFFER_AGE_EXT, (GLuint *)&m_bufferAge);
         }
+        m_validBackBufferRegion = QRegion();
     } else if (m_haveMESACopySubBuffer) {
-        for (const QRect &r : damage) {
-            // convert to OpenGL coordinates
-            int y = screenSize.height() - r.y() - r.height();
-            glXCopySubBufferMESA(display(), glxWindow, r.x(), y, r.width(), r.height());
+        m_validBackBufferRegion += damage;
+        // Keep the region cheap to test against, falling back to what was just painted
+        // never claims more than what's actually valid.
+        if (m_validBackBufferRegion.rectCount() > 16) {
+            m_validBackBufferRegion = damage;
         }
+        copySubBuffer(damage);
     } else { // Copy Pixels (horribly slow on Mesa)
         glDrawBuffer(GL_FRONT);
         copyPixels(damage);
@@ -772,6 +886,7 @@ void GlxBackend::screenGeometryChanged()
 
     // The back buffer contents are now undefined
     m_bufferAge = 0;
+    m_validBackBufferRegion = QRegion();
     m_fbo.reset(new GLFramebuffer(0, size));
 }
 
@@ -887,11 +1002,21 @@ void GlxSurfaceTextureX11::update(const QRegion &region)
     Q_UNUSED(region)
     // mipmaps need to be updated
     m_texture->setDirty();
+    static_cast<GlxPixmapTexture *>(m_texture.data())->scheduleRebind();
+}
+
+void GlxBackend::rebindPixmaps()
+{
+    const QVector<GlxPixmapTexturePrivate *> textures = std::exchange(m_pendingRebinds, {});
+    for (GlxPixmapTexturePrivate *texture : textures) {
+        texture->rebind();
+    }
 }
 
 GlxPixmapTexture::GlxPixmapTexture(GlxBackend *backend)
     : GLTexture(*new GlxPixmapTexturePrivate(this, backend))
 {
+    setMemoryCategory(GLMemoryTracker::Surface);
 }
 
 bool GlxPixmapTexture::create(SurfacePixmapX11 *texture)
@@ -900,6 +1025,12 @@ bool GlxPixmapTexture::create(SurfacePixmapX11 *texture)
     return d->create(texture);
 }
 
+void GlxPixmapTexture::scheduleRebind()
+{
+    Q_D(GlxPixmapTexture);
+    d->scheduleRebind();
+}
+
 GlxPixmapTexturePrivate::GlxPixmapTexturePrivate(GlxPixmapTexture *texture, GlxBackend *backend)
     : m_backend(backend)
     , q(texture)
@@ -909,6 +1040,9 @@ GlxPixmapTexturePrivate::GlxPixmapTexturePrivate(GlxPixmapTexture *texture, GlxB
 
 GlxPixmapTexturePrivate::~GlxPixmapTexturePrivate()
 {
+    if (m_rebindPending) {
+        m_backend->m_pendingRebinds.removeOne(this);
+    }
     if (m_glxPixmap != None) {
         if (!options->isGlStrictBinding()) {
             glXReleaseTexImageEXT(m_backend->display(), m_glxPixmap, GLX_FRONT_LEFT_EXT);
@@ -918,11 +1052,30 @@ GlxPixmapTexturePrivate::~GlxPixmapTexturePrivate()
     }
 }
 
+void GlxPixmapTexturePrivate::scheduleRebind()
+{
+    if (!options->isGlStrictBinding() || !m_glxPixmap || m_rebindPending) {
+        return;
+    }
+    m_rebindPending = true;
+    m_backend->m_pendingRebinds.append(this);
+}
+
+void GlxPixmapTexturePrivate::rebind()
+{
+    m_rebindPending = false;
+    glBindTexture(m_target, m_texture);
+    glXReleaseTexImageEXT(m_backend->display(), m_glxPixmap, GLX_FRONT_LEFT_EXT);
+    glXBindTexImageEXT(m_backend->display(), m_glxPixmap, GLX_FRONT_LEFT_EXT, nullptr);
+}
+
 void GlxPixmapTexturePrivate::onDamage()
 {
-    if (options->isGlStrictBinding() && m_glxPixmap) {
-        glXReleaseTexImageEXT(m_backend->display(), m_glxPixmap, GLX_FRONT_LEFT_EXT);
-        glXBindTexImageEXT(m_backend->display(), m_glxPixmap, GLX_FRONT_LEFT_EXT, nullptr);
+    if (m_rebindPending) {
+        // The first damaged texture that gets painted rebinds the pixmaps of all other damaged
+        // windows too, the ones that are occluded haven't been scheduled.
+        m_backend->rebindPixmaps();
+        glBindTexture(m_target, m_texture);
     }
     GLTexturePrivate::onDamage();
 }
@@ -970,6 +1123,7 @@ bool GlxPixmapTexturePrivate::create(SurfacePixmapX11 *texture)
     glXBindTexImageEXT(m_backend->display(), m_glxPixmap, GLX_FRONT_LEFT_EXT, nullptr);
 
     updateMatrix();
+    updateMemoryUsage();
     return true;
 }
 
@@ -23,6 +23,7 @@
 
 #include <QHash>
 
+#include <chrono>
 #include <memory>
 
 namespace KWin
@@ -60,6 +61,38 @@ private:
     xcb_glx_drawable_t m_glxDrawable;
 };
 
+/**
+ * The CopySubBufferEstimator class keeps a running estimate of what glXCopySubBufferMESA()
+ * costs on the GPU, made up of a fixed cost per call and a cost per copied pixel. It is used
+ * to decide whether copying the damaged rectangles one by one or their bounding rectangle is
+ * cheaper on the current driver.
+ */
+class CopySubBufferEstimator
+{
+public:
+    /**
+     * Adds the GPU time it took to copy @a rectCount rectangles that contain @a pixelCount
+     * pixels in total.
+     */
+    void addSample(int rectCount, qint64 pixelCount, std::chrono::nanoseconds duration);
+    bool hasEstimate() const;
+
+    /**
+     * Returns the estimated time in nanoseconds to copy @a rectCount rectangles that contain
+     * @a pixelCount pixels in total.
+     */
+    double estimate(int rectCount, qint64 pixelCount) const;
+
+private:
+    // exponentially decaying sums of a least squares fit without intercept
+    double m_weight = 0;
+    double m_sumRectsSquared = 0;
+    double m_sumRectsPixels = 0;
+    double m_sumPixelsSquared = 0;
+    double m_sumRectsDuration = 0;
+    double m_sumPixelsDuration = 0;
+};
+
 class GlxLayer : public OutputLayer
 {
 public:
@@ -97,9 +130,17 @@ public:
         return m_x11Display;
     }
 
+    /**
+     * Rebinds all window pixmaps that have been damaged since the last frame at once, rather
+     * than one by one in between draw calls. Only used with strict binding.
+     */
+    void rebindPixmaps();
+
 private:
     void vblank(std::chrono::nanoseconds timestamp);
     void present(const QRegion &damage);
+    void copySubBuffer(const QRegion &damage);
+    void collectCopySubBufferSample();
     bool initBuffer();
     bool checkVersion();
     void initExtensions();
@@ -126,6 +167,14 @@ private:
     QScopedPointer<GLFramebuffer> m_fbo;
     DamageJournal m_damageJournal;
     QRegion m_lastRenderedRegion;
+    // the part of the back buffer that has well defined contents if buffer age is unsupported
+    QRegion m_validBackBufferRegion;
+    CopySubBufferEstimator m_copySubBufferEstimator;
+    // timestamps around the last glXCopySubBufferMESA() calls, if timer queries are supported
+    GLuint m_copySubBufferQueries[2] = {0, 0};
+    bool m_copySubBufferQueryPending = false;
+    int m_copySubBufferRectCount = 0;
+    qint64 m_copySubBufferPixelCount = 0;
     int m_bufferAge;
     bool m_haveMESACopySubBuffer = false;
     bool m_haveMESASwapControl = false;
@@ -135,6 +184,7 @@ private:
     X11StandalonePlatform *m_backend;
     VsyncMonitor *m_vsyncMonitor = nullptr;
     QScopedPointer<GlxLayer> m_layer;
+    QVector<GlxPixmapTexturePrivate *> m_pendingRebinds;
     friend class GlxPixmapTexturePrivate;
 };
 
@@ -144,6 +194,7 @@ public:
     explicit GlxPixmapTexture(GlxBackend *backend);
 
     bool create(SurfacePixmapX11 *texture);
+    void scheduleRebind();
 
 private:
     Q_DECLARE_PRIVATE(GlxPixmapTexture)
@@ -156,6 +207,8 @@ public:
     ~GlxPixmapTexturePrivate() override;
 
     bool create(SurfacePixmapX11 *texture);
+    void scheduleRebind();
+    void rebind();
 
 protected:
     void onDamage() override;
@@ -164,6 +217,7 @@ private:
     GlxBackend *m_backend;
     GlxPixmapTexture *q;
     GLXPixmap m_glxPixmap;
+    bool m_rebindPending = false;
 };
 
 class GlxSurfaceTextureX11 final : public OpenGLSurfaceTextureX11
@@ -35,10 +35,6 @@ X11Cursor::X11Cursor(QObject *parent, bool xInputSupport)
     m_mousePollingTimer->setInterval(50);
     connect(m_mousePollingTimer, &QTimer::timeout, this, &X11Cursor::mousePolled);
 
-    if (m_hasXInput) {
-        connect(qApp->eventDispatcher(), &QAbstractEventDispatcher::aboutToBlock, this, &X11Cursor::aboutToBlock);
-    }
-
 #ifndef KCMRULES
     connect(kwinApp(), &Application::workspaceCreated, this, [this]() {
         if (Xcb::Extensions::self()->isFixesAvailable()) {
@@ -91,14 +87,23 @@ void X11Cursor::aboutToBlock()
 
 void X11Cursor::doStartMousePolling()
 {
-    if (!m_hasXInput) {
+    if (m_hasXInput) {
+        // XInput reports the pointer motion, the position only has to be fetched once
+        // a batch of events has been processed
+        connect(qApp->eventDispatcher(), &QAbstractEventDispatcher::aboutToBlock, this, &X11Cursor::aboutToBlock);
+        Q_EMIT mousePollingChanged(true);
+    } else {
         m_mousePollingTimer->start();
     }
 }
 
 void X11Cursor::doStopMousePolling()
 {
-    if (!m_hasXInput) {
+    if (m_hasXInput) {
+        disconnect(qApp->eventDispatcher(), &QAbstractEventDispatcher::aboutToBlock, this, &X11Cursor::aboutToBlock);
+        m_needsPoll = false;
+        Q_EMIT mousePollingChanged(false);
+    } else {
         m_mousePollingTimer->stop();
     }
 }
@@ -35,6 +35,13 @@ public:
      */
     void notifyCursorChanged();
 
+Q_SIGNALS:
+    /**
+     * Emitted when the mouse polling gets activated or deactivated while XInput is
+     * used to find out when the pointer moves.
+     */
+    void mousePollingChanged(bool active);
+
 protected:
     void doSetPos() override;
     void doGetPos() override;
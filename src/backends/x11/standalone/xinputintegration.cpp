@@ -240,9 +240,22 @@ void XInputIntegration::init()
 void XInputIntegration::setCursor(X11Cursor *cursor)
 {
     m_x11Cursor = QPointer<X11Cursor>(cursor);
+    connect(cursor, &X11Cursor::mousePollingChanged, this, &XInputIntegration::setRawMotionEnabled);
 }
 
-void XInputIntegration::startListening()
+void XInputIntegration::setRawMotionEnabled(bool enabled)
+{
+    if (m_rawMotion == enabled) {
+        return;
+    }
+    m_rawMotion = enabled;
+    if (m_xiEventFilter) {
+        selectEvents();
+        XFlush(display());
+    }
+}
+
+void XInputIntegration::selectEvents()
 {
     // this assumes KWin is the only one setting events on the root window
     // given Qt's source code this seems to be true. If it breaks, we need to change
@@ -251,7 +264,11 @@ void XInputIntegration::startListening()
 
     memset(mask1, 0, sizeof(mask1));
 
-    XISetMask(mask1, XI_RawMotion);
+    // the pointer motion is only needed while someone polls the mouse position,
+    // so an idle pointer doesn't keep waking us up
+    if (m_rawMotion) {
+        XISetMask(mask1, XI_RawMotion);
+    }
     XISetMask(mask1, XI_RawButtonPress);
     XISetMask(mask1, XI_RawButtonRelease);
     if (m_majorVersion >= 2 && m_minorVersion >= 1) {
@@ -271,6 +288,11 @@ void XInputIntegration::startListening()
     evmasks[0].mask_len = sizeof(mask1);
     evmasks[0].mask = mask1;
     XISelectEvents(display(), rootWindow(), evmasks, 1);
+}
+
+void XInputIntegration::startListening()
+{
+    selectEvents();
 
     m_xiEventFilter.reset(new XInputEventFilter(m_xiOpcode));
     m_xiEventFilter->setCursor(m_x11Cursor);
@@ -38,6 +38,9 @@ public:
     void setCursor(X11Cursor *cursor);
 
 private:
+    void selectEvents();
+    void setRawMotionEnabled(bool enabled);
+
     Display *display() const
     {
         return m_x11Display;
@@ -47,6 +50,7 @@ private:
     int m_xiOpcode = 0;
     int m_majorVersion = 0;
     int m_minorVersion = 0;
+    bool m_rawMotion = false;
     QPointer<X11Cursor> m_x11Cursor;
     Display *m_x11Display;
 
@@ -46,7 +46,15 @@ public:
     };
     Q_DECLARE_FLAGS(DirtyToneCurves, DirtyToneCurveBit)
 
+    struct CachedTransformation
+    {
+        uint temperature;
+        uint brightness;
+        QSharedPointer<ColorTransformation> transformation;
+    };
+
     void rebuildPipeline();
+    bool restoreCachedTransformation();
 
     void updateTemperatureToneCurves();
     void updateBrightnessToneCurves();
@@ -64,12 +72,32 @@ public:
     std::unique_ptr<ColorPipelineStage> calibrationStage;
 
     QSharedPointer<ColorTransformation> transformation;
+    // recently built transformations for the current profile, most recent first
+    QVector<CachedTransformation> cache;
 };
 
+bool ColorDevicePrivate::restoreCachedTransformation()
+{
+    for (int i = 0; i < cache.size(); ++i) {
+        if (cache[i].temperature == temperature && cache[i].brightness == brightness) {
+            cache.move(i, 0);
+            transformation = cache.first().transformation;
+            return true;
+        }
+    }
+    return false;
+}
+
 void ColorDevicePrivate::rebuildPipeline()
 {
     if (dirtyCurves & DirtyCalibrationToneCurve) {
+        cache.clear();
         updateCalibrationToneCurves();
+    } else if (restoreCachedTransformation()) {
+        // Night color transitions go through the same temperatures over and over again, reuse
+        // the transformation so that outputs can keep their gamma ramps. The other tone curves
+        // stay dirty until a transformation has to be built again.
+        return;
     }
     if (dirtyCurves & DirtyBrightnessToneCurve) {
         updateBrightnessToneCurves();
@@ -102,10 +130,22 @@ void ColorDevicePrivate::rebuildPipeline()
         }
     }
 
-    const auto tmp = QSharedPointer<ColorTransformation>::create(std::move(stages));
-    if (tmp->valid()) {
+    static const int cacheSize = 16;
+    if (stages.empty()) {
+        // An identity transformation would make outputs without gamma ramps composite the
+        // whole screen through the color transformation pass for nothing
+        transformation.reset();
+    } else {
+        const auto tmp = QSharedPointer<ColorTransformation>::create(std::move(stages));
+        if (!tmp->valid()) {
+            return;
+        }
         transformation = tmp;
     }
+    cache.prepend(CachedTransformation{temperature, brightness, transformation});
+    if (cache.size() > cacheSize) {
+        cache.removeLast();
+    }
 }
 
 static qreal interpolate(qreal a, qreal b, qreal blendFactor)
@@ -16,10 +16,19 @@ namespace KWin
 ColorLUT::ColorLUT(const QSharedPointer<ColorTransformation> &transformation, size_t size)
     : m_transformation(transformation)
 {
-    m_data.fill(0, 3 * size);
+    QVector<uint16_t> in(3 * size);
     for (uint64_t i = 0; i < size; i++) {
         const uint16_t index = (i * 0xFFFF) / size;
-        std::tie(m_data[i], m_data[size + i], m_data[size * 2 + i]) = transformation->transform(index, index, index);
+        in[i * 3] = in[i * 3 + 1] = in[i * 3 + 2] = index;
+    }
+    QVector<uint16_t> out(3 * size);
+    transformation->transform(in.constData(), out.data(), size);
+
+    m_data.resize(3 * size);
+    for (uint64_t i = 0; i < size; i++) {
+        m_data[i] = out[i * 3];
+        m_data[size + i] = out[i * 3 + 1];
+        m_data[size * 2 + i] = out[i * 3 + 2];
     }
 }
 
@@ -0,0 +1,51 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "colorlut3d.h"
+
+#include "colortransformation.h"
+
+namespace KWin
+{
+
+ColorLUT3D::ColorLUT3D(const QSharedPointer<ColorTransformation> &transformation, size_t size)
+    : m_size(size)
+    , m_transformation(transformation)
+{
+    m_data.resize(3 * size * size * size);
+    uint16_t *data = m_data.data();
+    for (size_t b = 0; b < size; b++) {
+        const uint16_t blue = (b * 0xFFFF) / (size - 1);
+        for (size_t g = 0; g < size; g++) {
+            const uint16_t green = (g * 0xFFFF) / (size - 1);
+            for (size_t r = 0; r < size; r++) {
+                const uint16_t red = (r * 0xFFFF) / (size - 1);
+                data[0] = red;
+                data[1] = green;
+                data[2] = blue;
+                data += 3;
+            }
+        }
+    }
+    transformation->transform(m_data.constData(), m_data.data(), size * size * size);
+}
+
+const uint16_t *ColorLUT3D::data() const
+{
+    return m_data.constData();
+}
+
+size_t ColorLUT3D::size() const
+{
+    return m_size;
+}
+
+QSharedPointer<ColorTransformation> ColorLUT3D::transformation() const
+{
+    return m_transformation;
+}
+
+}
@@ -0,0 +1,42 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+
+#include <QSharedPointer>
+#include <QVector>
+
+#include "kwin_export.h"
+
+namespace KWin
+{
+
+class ColorTransformation;
+
+/**
+ * The ColorLUT3D class is a three dimensional lookup table of a color transformation, which
+ * can also express transformations that mix the color channels.
+ *
+ * The table contains size^3 RGB triplets, the red coordinate varies fastest.
+ *
+ * @since 5.26
+ */
+class KWIN_EXPORT ColorLUT3D
+{
+public:
+    ColorLUT3D(const QSharedPointer<ColorTransformation> &transformation, size_t size);
+
+    const uint16_t *data() const;
+    size_t size() const;
+    QSharedPointer<ColorTransformation> transformation() const;
+
+private:
+    QVector<uint16_t> m_data;
+    size_t m_size;
+    const QSharedPointer<ColorTransformation> m_transformation;
+};
+
+}
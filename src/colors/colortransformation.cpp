@@ -10,6 +10,8 @@
 
 #include <lcms2.h>
 
+#include <algorithm>
+
 #include "colorpipelinestage.h"
 #include "utils/common.h"
 
@@ -32,10 +34,29 @@ ColorTransformation::ColorTransformation(std::vector<std::unique_ptr<ColorPipeli
             return;
         }
     }
+
+    // An lcms transform optimizes the pipeline when it's created, e.g. consecutive tone curves
+    // get joined into a single table, so it's used for evaluating many colors at once.
+    cmsHPROFILE link = cmsCreateProfilePlaceholder(nullptr);
+    if (link) {
+        cmsSetDeviceClass(link, cmsSigLinkClass);
+        cmsSetColorSpace(link, cmsSigRgbData);
+        cmsSetPCS(link, cmsSigRgbData);
+        if (cmsWriteTag(link, cmsSigAToB0Tag, m_pipeline)) {
+            m_transform = cmsCreateTransform(link, TYPE_RGB_16, nullptr, TYPE_RGB_16, INTENT_PERCEPTUAL, cmsFLAGS_NOCACHE | cmsFLAGS_HIGHRESPRECALC);
+        }
+        cmsCloseProfile(link);
+    }
+    if (!m_transform) {
+        qCWarning(KWIN_CORE) << "Failed to create the cmsHTRANSFORM, falling back to evaluating the pipeline";
+    }
 }
 
 ColorTransformation::~ColorTransformation()
 {
+    if (m_transform) {
+        cmsDeleteTransform(m_transform);
+    }
     if (m_pipeline) {
         cmsStage *last = nullptr;
         do {
@@ -50,6 +71,13 @@ bool ColorTransformation::valid() const
     return m_valid;
 }
 
+bool ColorTransformation::isPerChannel() const
+{
+    return std::all_of(m_stages.begin(), m_stages.end(), [](const std::unique_ptr<ColorPipelineStage> &stage) {
+        return cmsStageType(stage->stage()) == cmsSigCurveSetElemType;
+    });
+}
+
 std::tuple<uint16_t, uint16_t, uint16_t> ColorTransformation::transform(uint16_t r, uint16_t g, uint16_t b) const
 {
     const uint16_t in[3] = {r, g, b};
@@ -58,4 +86,15 @@ std::tuple<uint16_t, uint16_t, uint16_t> ColorTransformation::transform(uint16_t
     return {out[0], out[1], out[2]};
 }
 
+void ColorTransformation::transform(const uint16_t *in, uint16_t *out, size_t count) const
+{
+    if (m_transform) {
+        cmsDoTransform(m_transform, in, out, count);
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        cmsPipelineEval16(in + 3 * i, out + 3 * i, m_pipeline);
+    }
+}
+
 }
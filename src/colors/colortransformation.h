@@ -16,6 +16,7 @@
 #include "kwin_export.h"
 
 typedef struct _cmsPipeline_struct cmsPipeline;
+typedef void *cmsHTRANSFORM;
 
 namespace KWin
 {
@@ -30,10 +31,27 @@ public:
 
     bool valid() const;
 
+    /**
+     * Returns @c true if every stage transforms the color channels independently of each
+     * other, so the transformation can be expressed with per channel gamma ramps.
+     */
+    bool isPerChannel() const;
+
     std::tuple<uint16_t, uint16_t, uint16_t> transform(uint16_t r, uint16_t g, uint16_t b) const;
 
+    /**
+     * Transforms @a count colors with interleaved red, green and blue components from @a in
+     * into @a out. This is a lot faster than transforming the colors one by one, as the stages
+     * are folded together into lookup tables once. The results can be off by one from the ones
+     * of the per color transform().
+     *
+     * @since 5.26
+     */
+    void transform(const uint16_t *in, uint16_t *out, size_t count) const;
+
 private:
     cmsPipeline *const m_pipeline;
+    cmsHTRANSFORM m_transform = nullptr;
     const std::vector<std::unique_ptr<ColorPipelineStage>> m_stages;
     bool m_valid = true;
 };
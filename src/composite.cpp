@@ -16,7 +16,9 @@
 #include "decorations/decoratedclient.h"
 #include "deleted.h"
 #include "effects.h"
+#include "framedropmonitor.h"
 #include "ftrace.h"
+#include "inputlatencymonitor.h"
 #include "internalwindow.h"
 #include "openglbackend.h"
 #include "output.h"
@@ -26,11 +28,14 @@
 #include "qpainterbackend.h"
 #include "renderlayer.h"
 #include "renderloop.h"
+#include "renderloop_p.h"
 #include "scene.h"
 #include "scenes/opengl/scene_opengl.h"
 #include "scenes/qpainter/scene_qpainter.h"
 #include "screens.h"
 #include "shadow.h"
+#include "startuptracer.h"
+#include "surfaceitem_wayland.h"
 #include "surfaceitem_x11.h"
 #include "unmanaged.h"
 #include "useractions.h"
@@ -52,6 +57,7 @@
 #endif
 #include <KSelectionOwner>
 
+#include <QDBusConnection>
 #include <QDateTime>
 #include <QFutureWatcher>
 #include <QMenu>
@@ -64,7 +70,9 @@
 #include <xcb/composite.h>
 #include <xcb/damage.h>
 
+#include <algorithm>
 #include <cstdio>
+#include <numeric>
 
 Q_DECLARE_METATYPE(KWin::X11Compositor::SuspendReason)
 
@@ -129,6 +137,16 @@ Compositor::Compositor(QObject *workspace)
     connect(options, &Options::configChanged, this, &Compositor::configChanged);
     connect(options, &Options::animationSpeedChanged, this, &Compositor::configChanged);
 
+    // Everything else is either read live or only needs the effects to be reconfigured
+    const auto requireRestart = [this]() {
+        m_restartRequired = true;
+    };
+    connect(options, &Options::compositingModeChanged, this, requireRestart);
+    connect(options, &Options::useCompositingChanged, this, requireRestart);
+    connect(options, &Options::glPlatformInterfaceChanged, this, requireRestart);
+    connect(options, &Options::glPreferBufferSwapChanged, this, requireRestart);
+    connect(options, &Options::hiddenPreviewsChanged, this, requireRestart);
+
     // 2 sec which should be enough to restart the compositor.
     static const int compositorLostMessageDelay = 2000;
 
@@ -164,11 +182,14 @@ Compositor::Compositor(QObject *workspace)
 
     // register DBus
     new CompositorDBusInterface(this);
+    QDBusConnection::sessionBus().registerObject(QStringLiteral("/GpuMemory"), GLMemoryTracker::self(), QDBusConnection::ExportScriptableContents);
     FTraceLogger::create();
+    FrameDropMonitor::create(this);
 }
 
 Compositor::~Compositor()
 {
+    QDBusConnection::sessionBus().unregisterObject(QStringLiteral("/GpuMemory"));
     deleteUnusedSupportProperties();
     destroyCompositorSelection();
     s_compositor = nullptr;
@@ -435,7 +456,7 @@ void Compositor::addOutput(Output *output)
     auto cursorLayer = new RenderLayer(output->renderLoop());
     cursorLayer->setVisible(false);
     if (m_backend->compositingType() == OpenGLCompositing) {
-        cursorLayer->setDelegate(new CursorDelegateOpenGL());
+        cursorLayer->setDelegate(new CursorDelegateOpenGL(static_cast<SceneOpenGL *>(m_scene)->cursorTextureCache()));
     } else {
         cursorLayer->setDelegate(new CursorDelegateQPainter());
     }
@@ -455,11 +476,65 @@ void Compositor::addOutput(Output *output)
     connect(Cursors::self(), &Cursors::positionChanged, cursorLayer, updateCursorLayer);
 
     addSuperLayer(workspaceLayer);
+
+    auto updateFrameRateLimit = [this, output]() {
+        this->updateFrameRateLimit(output);
+    };
+    updateFrameRateLimit();
+    connect(Cursors::self(), &Cursors::positionChanged, workspaceLayer, updateFrameRateLimit);
+    connect(workspace(), &Workspace::windowActivated, workspaceLayer, updateFrameRateLimit);
+    connect(options, &Options::idleOutputFrameRateChanged, workspaceLayer, updateFrameRateLimit);
+
+    connect(output, &Output::dpmsModeChanged, this, &Compositor::updateSleeping);
+    updateSleeping();
 }
 
 void Compositor::removeOutput(Output *output)
 {
+    disconnect(output, &Output::dpmsModeChanged, this, &Compositor::updateSleeping);
+    output->renderLoop()->setMaximumFrameRate(0);
     removeSuperLayer(m_superlayers[output->renderLoop()]);
+    updateSleeping();
+}
+
+void Compositor::updateFrameRateLimit(Output *output)
+{
+    const int idleFrameRate = options->idleOutputFrameRate();
+    const bool fullFrameRate = idleFrameRate <= 0
+        || m_fullFrameRateLoops.contains(output->renderLoop())
+        || output == workspace()->activeOutput()
+        || Cursors::self()->mouse()->isOnOutput(output);
+    output->renderLoop()->setMaximumFrameRate(fullFrameRate ? 0 : idleFrameRate * 1000);
+}
+
+void Compositor::updateSleeping()
+{
+    bool sleeping = !m_superlayers.isEmpty();
+    for (auto it = m_superlayers.keyBegin(); it != m_superlayers.keyEnd(); ++it) {
+        const Output *output = findOutput(*it);
+        if (!output || output->dpmsMode() == Output::DpmsMode::On) {
+            sleeping = false;
+            break;
+        }
+    }
+    if (m_sleeping == sleeping) {
+        return;
+    }
+    m_sleeping = sleeping;
+
+    if (m_sleeping) {
+        qCDebug(KWIN_CORE) << "All outputs are off, the compositor goes to sleep";
+        // Nothing is going to be painted for a while, give the memory back to the driver.
+        if (m_backend && m_backend->compositingType() == OpenGLCompositing) {
+            GLMemoryTracker::self()->evict();
+        }
+    } else {
+        qCDebug(KWIN_CORE) << "An output is on, the compositor wakes up";
+        if (m_scene) {
+            m_scene->addRepaintFull();
+        }
+    }
+    Q_EMIT sleepingChanged(m_sleeping);
 }
 
 void Compositor::addSuperLayer(RenderLayer *layer)
@@ -471,6 +546,8 @@ void Compositor::addSuperLayer(RenderLayer *layer)
 void Compositor::removeSuperLayer(RenderLayer *layer)
 {
     m_superlayers.remove(layer->loop());
+    m_overlayRegions.remove(layer->loop());
+    m_fullFrameRateLoops.remove(layer->loop());
     disconnect(layer->loop(), &RenderLoop::frameRequested, this, &Compositor::handleFrameRequested);
     delete layer;
 }
@@ -526,8 +603,12 @@ void Compositor::stop()
 
     const auto superlayers = m_superlayers;
     for (auto it = superlayers.begin(); it != superlayers.end(); ++it) {
+        if (Output *output = findOutput(it.key())) {
+            disconnect(output, &Output::dpmsModeChanged, this, &Compositor::updateSleeping);
+        }
         removeSuperLayer(*it);
     }
+    updateSleeping();
 
     disconnect(kwinApp()->platform(), &Platform::outputEnabled, this, &Compositor::addOutput);
     disconnect(kwinApp()->platform(), &Platform::outputDisabled, this, &Compositor::removeOutput);
@@ -599,7 +680,16 @@ void Compositor::deleteUnusedSupportProperties()
 
 void Compositor::configChanged()
 {
-    reinitialize();
+    if (m_restartRequired || m_state != State::On) {
+        reinitialize();
+        return;
+    }
+
+    // Settings like the latency policy are picked up by the render loops on their own,
+    // there's no need to tear down the scene and flash the screens
+    kwinApp()->config()->reparseConfiguration();
+    effects->reconfigure();
+    m_scene->addRepaintFull();
 }
 
 void Compositor::reinitialize()
@@ -608,6 +698,7 @@ void Compositor::reinitialize()
     kwinApp()->config()->reparseConfiguration();
 
     // Restart compositing
+    m_restartRequired = false;
     stop();
     start();
 
@@ -616,8 +707,55 @@ void Compositor::reinitialize()
     }
 }
 
+void Compositor::recoverFromGraphicsReset()
+{
+    // All GPU resources died with the context and have to be recreated, but unlike
+    // reinitialize() the configuration didn't change and effects loaded at runtime,
+    // e.g. through D-Bus or scripts, are brought back.
+    QStringList loadedEffects;
+    if (effects) {
+        loadedEffects = static_cast<EffectsHandlerImpl *>(effects)->loadedEffects();
+    }
+
+    stop();
+    start();
+
+    if (effects) {
+        auto effectsImpl = static_cast<EffectsHandlerImpl *>(effects);
+        for (const QString &name : qAsConst(loadedEffects)) {
+            if (!effectsImpl->isEffectLoaded(name)) {
+                effectsImpl->loadEffect(name);
+            }
+        }
+    }
+}
+
 void Compositor::handleFrameRequested(RenderLoop *renderLoop)
 {
+    // The outputs are composited one after another. If the frames of other outputs are due
+    // as well, the ones whose vblank comes first are composited first, so they don't miss
+    // it while waiting for an output that has more time left.
+    const std::chrono::nanoseconds currentTime(std::chrono::steady_clock::now().time_since_epoch());
+    const std::chrono::nanoseconds deadline = RenderLoopPrivate::get(renderLoop)->nextPresentationTimestamp;
+    QVector<RenderLoopPrivate *> earlier;
+    for (auto it = m_superlayers.keyBegin(); it != m_superlayers.keyEnd(); ++it) {
+        RenderLoopPrivate *other = RenderLoopPrivate::get(*it);
+        if (*it != renderLoop && other->compositeTimer.isActive()
+            && other->scheduledRenderTimestamp <= currentTime && other->nextPresentationTimestamp < deadline) {
+            earlier.append(other);
+        }
+    }
+    std::sort(earlier.begin(), earlier.end(), [](const RenderLoopPrivate *a, const RenderLoopPrivate *b) {
+        return a->nextPresentationTimestamp < b->nextPresentationTimestamp;
+    });
+    for (RenderLoopPrivate *other : qAsConst(earlier)) {
+        // another frame may have rescheduled it in the meantime
+        if (other->compositeTimer.isActive()) {
+            other->compositeTimer.stop();
+            other->dispatch();
+        }
+    }
+
     composite(renderLoop);
 }
 
@@ -628,7 +766,7 @@ void Compositor::composite(RenderLoop *renderLoop)
 #if KWIN_BUILD_NOTIFICATIONS
         KNotification::event(QStringLiteral("graphicsreset"), i18n("Desktop effects were restarted due to a graphics reset"));
 #endif
-        reinitialize();
+        recoverFromGraphicsReset();
         return;
     }
 
@@ -641,7 +779,11 @@ void Compositor::composite(RenderLoop *renderLoop)
     superLayer->setOutputLayer(outputLayer);
 
     SurfaceItem *scanoutCandidate = superLayer->delegate()->scanoutCandidate();
-    renderLoop->setFullscreenSurface(scanoutCandidate);
+    bool allowTearing = false;
+    if (const auto waylandCandidate = qobject_cast<SurfaceItemWayland *>(scanoutCandidate)) {
+        allowTearing = waylandCandidate->surface() && waylandCandidate->surface()->presentationHint() == KWaylandServer::PresentationHint::Async;
+    }
+    renderLoop->setFullscreenSurface(scanoutCandidate, allowTearing);
 
     renderLoop->beginFrame();
     bool directScanout = false;
@@ -650,31 +792,74 @@ void Compositor::composite(RenderLoop *renderLoop)
         const bool scanoutPossible = std::none_of(sublayers.begin(), sublayers.end(), [](RenderLayer *sublayer) {
             return sublayer->isVisible();
         });
-        if (scanoutPossible && !output->directScanoutInhibited()) {
+        if (scanoutPossible && !output->directScanoutInhibited() && !output->compositedColorTransformation()) {
             directScanout = outputLayer->scanout(scanoutCandidate);
         }
     }
+    const auto waylandScanout = directScanout ? qobject_cast<SurfaceItemWayland *>(scanoutCandidate) : nullptr;
+    renderLoop->setZeroCopySurface(waylandScanout ? waylandScanout->surface() : nullptr);
+
+    QVector<SurfaceItem *> overlayCandidates;
+    if (!directScanout && !output->directScanoutInhibited() && !output->compositedColorTransformation()) {
+        overlayCandidates = superLayer->delegate()->overlayCandidates();
+    }
+    QRegion overlayRegion;
+    const QVector<SurfaceItem *> overlays = outputLayer->assignOverlays(overlayCandidates);
+    for (SurfaceItem *overlay : overlays) {
+        overlayRegion += overlay->mapToGlobal(overlay->rect()).translated(-output->geometry().topLeft());
+    }
+    // Whatever was hidden by overlay planes that are gone now has to be composited again.
+    const QRegion previousOverlayRegion = m_overlayRegions.value(renderLoop);
+    outputLayer->addRepaint(previousOverlayRegion.subtracted(overlayRegion));
+    m_overlayRegions[renderLoop] = overlayRegion;
 
+    // Fullscreen surfaces and surfaces on overlay planes are most likely videos or games,
+    // they are never limited to the idle frame rate.
+    if (scanoutCandidate || !overlays.isEmpty()) {
+        m_fullFrameRateLoops.insert(renderLoop);
+    } else {
+        m_fullFrameRateLoops.remove(renderLoop);
+    }
+    if (kwinApp()->operationMode() != Application::OperationModeX11) {
+        updateFrameRateLimit(output);
+    }
+
+    bool rendered = false;
     if (!directScanout) {
         QRegion surfaceDamage = outputLayer->repaints();
         outputLayer->resetRepaints();
         preparePaintPass(superLayer, &surfaceDamage);
-
-        OutputLayerBeginFrameInfo beginInfo = outputLayer->beginFrame();
-        beginInfo.renderTarget.setDevicePixelRatio(output->scale());
-
-        const QRegion bufferDamage = surfaceDamage.united(beginInfo.repaint).intersected(superLayer->rect());
-        outputLayer->aboutToStartPainting(bufferDamage);
-
-        paintPass(superLayer, &beginInfo.renderTarget, bufferDamage);
-        outputLayer->endFrame(bufferDamage, surfaceDamage);
+        surfaceDamage -= overlayRegion;
+
+        // If only surfaces on overlay planes have changed, the last composited frame is reused.
+        if (overlayRegion.isEmpty() || previousOverlayRegion.isEmpty() || !surfaceDamage.isEmpty()) {
+            OutputLayerBeginFrameInfo beginInfo = outputLayer->beginFrame();
+            beginInfo.renderTarget.setDevicePixelRatio(output->scale());
+
+            QRegion bufferDamage = surfaceDamage.united(beginInfo.repaint);
+            RenderTarget *renderTarget = m_scene->beginColorTransformation(output, &beginInfo.renderTarget, &bufferDamage);
+            bufferDamage &= superLayer->rect();
+            outputLayer->aboutToStartPainting(bufferDamage);
+            fTraceCounter("Damage area", std::accumulate(bufferDamage.begin(), bufferDamage.end(), qint64(0), [](qint64 area, const QRect &rect) {
+                return area + qint64(rect.width()) * rect.height();
+            }));
+
+            paintPass(superLayer, renderTarget, bufferDamage);
+            m_scene->endColorTransformation(output, bufferDamage);
+            outputLayer->endFrame(bufferDamage, surfaceDamage);
+            rendered = true;
+        }
     }
-    renderLoop->endFrame();
+    renderLoop->endFrame(rendered);
 
     postPaintPass(superLayer);
 
     m_backend->present(output);
 
+    if (StartupTracer::self()->isRecording()) {
+        StartupTracer::self()->markFirstFrame();
+    }
+
     // TODO: Put it inside the cursor layer once the cursor layer can be backed by a real output layer.
     if (waylandServer()) {
         const std::chrono::milliseconds frameTime =
@@ -742,6 +927,7 @@ WaylandCompositor::WaylandCompositor(QObject *parent)
 {
     connect(kwinApp(), &Application::x11ConnectionAboutToBeDestroyed,
             this, &WaylandCompositor::destroyCompositorSelection);
+    InputLatencyMonitor::create(this);
 }
 
 WaylandCompositor::~WaylandCompositor()
@@ -777,6 +963,17 @@ X11Compositor::X11Compositor(QObject *parent)
     if (qEnvironmentVariableIsSet("KWIN_MAX_FRAMES_TESTED")) {
         m_framesToTestForSafety = qEnvironmentVariableIntValue("KWIN_MAX_FRAMES_TESTED");
     }
+
+    // A window has to qualify for unredirection for a while before it's unredirected, so
+    // briefly opened popups or tooltips don't make the screen flicker.
+    m_unredirectTimer = new QTimer(this);
+    m_unredirectTimer->setSingleShot(true);
+    m_unredirectTimer->setInterval(1000);
+    connect(m_unredirectTimer, &QTimer::timeout, this, [this]() {
+        if (m_unredirectCandidate && m_unredirectCandidate == findUnredirectCandidate()) {
+            setUnredirectedWindow(m_unredirectCandidate);
+        }
+    });
 }
 
 X11Compositor::~X11Compositor()
@@ -876,6 +1073,9 @@ void X11Compositor::start()
 
 void X11Compositor::stop()
 {
+    m_unredirectTimer->stop();
+    m_unredirectCandidate.clear();
+    setUnredirectedWindow(nullptr);
     m_syncManager.reset();
     Compositor::stop();
 }
@@ -887,6 +1087,12 @@ void X11Compositor::composite(RenderLoop *renderLoop)
         return;
     }
 
+    updateUnredirectedWindow();
+    if (m_unredirectedWindow && m_unredirectedWindow->frameGeometry().contains(workspace()->geometry())) {
+        // The unredirected window covers everything the compositor could paint.
+        return;
+    }
+
     QList<Window *> windows = workspace()->stackingOrder();
     QList<SurfaceItemX11 *> dirtyItems;
 
@@ -996,6 +1202,122 @@ void X11Compositor::updateClientCompositeBlocking(X11Window *c)
     }
 }
 
+X11Window *X11Compositor::unredirectedWindow() const
+{
+    return m_unredirectedWindow;
+}
+
+X11Window *X11Compositor::findUnredirectCandidate() const
+{
+    if (!options->unredirectFullscreen() || !backend() || !backend()->overlayWindow()) {
+        return nullptr;
+    }
+    if (effects && static_cast<EffectsHandlerImpl *>(effects)->activeFullScreenEffect()) {
+        return nullptr;
+    }
+
+    const QList<Window *> windows = workspace()->stackingOrder();
+    QRegion occupied;
+    for (auto it = windows.crbegin(); it != windows.crend(); ++it) {
+        Window *window = *it;
+        if (window->isUnmanaged() || window->isDeleted()) {
+            // Popup menus, tooltips and windows that are being animated out.
+            occupied += window->frameGeometry();
+            continue;
+        }
+        if (!window->isShown() || !window->isOnCurrentDesktop() || !window->isOnCurrentActivity()) {
+            continue;
+        }
+
+        auto x11Window = qobject_cast<X11Window *>(window);
+        if (!x11Window || !x11Window->isFullScreen()) {
+            occupied += window->frameGeometry();
+            continue;
+        }
+        const QRect geometry = x11Window->frameGeometry();
+        if (occupied.intersects(geometry)) {
+            return nullptr;
+        }
+        if (x11Window->hasAlpha() || x11Window->opacity() < 1.0 || x11Window->shape()) {
+            return nullptr;
+        }
+        const auto outputs = kwinApp()->platform()->enabledOutputs();
+        const bool coversOutput = std::any_of(outputs.begin(), outputs.end(), [&geometry](const Output *output) {
+            return geometry.contains(output->geometry());
+        });
+        return coversOutput ? x11Window : nullptr;
+    }
+    return nullptr;
+}
+
+void X11Compositor::updateUnredirectedWindow()
+{
+    X11Window *candidate = findUnredirectCandidate();
+    if (candidate == m_unredirectedWindow) {
+        return;
+    }
+
+    // Anything that shows up above the window has to be composited right away.
+    setUnredirectedWindow(nullptr);
+
+    if (candidate != m_unredirectCandidate) {
+        m_unredirectCandidate = candidate;
+        if (candidate) {
+            m_unredirectTimer->start();
+        } else {
+            m_unredirectTimer->stop();
+        }
+    }
+}
+
+void X11Compositor::setUnredirectedWindow(X11Window *window)
+{
+    if (m_unredirectedWindow == window) {
+        return;
+    }
+
+    xcb_connection_t *connection = kwinApp()->x11Connection();
+    if (m_unredirectedWindow) {
+        disconnect(m_unredirectedWindow, nullptr, this, nullptr);
+        xcb_composite_redirect_window(connection, m_unredirectedWindow->frameId(), XCB_COMPOSITE_REDIRECT_MANUAL);
+        // The window got a new backing pixmap.
+        if (SurfaceItem *surfaceItem = m_unredirectedWindow->surfaceItem()) {
+            surfaceItem->discardPixmap();
+        }
+        m_unredirectedWindow->addRepaintFull();
+    }
+
+    m_unredirectedWindow = window;
+
+    if (m_unredirectedWindow) {
+        xcb_composite_unredirect_window(connection, m_unredirectedWindow->frameId(), XCB_COMPOSITE_REDIRECT_MANUAL);
+        connect(m_unredirectedWindow, &Window::windowClosed, this, [this]() {
+            m_unredirectedWindow.clear();
+            backend()->overlayWindow()->setShape(workspace()->geometry());
+        });
+        connect(m_unredirectedWindow, &Window::frameGeometryChanged, this, [this]() {
+            setUnredirectedWindow(nullptr);
+            // The window has to qualify for unredirection again, start over with the new geometry.
+            m_unredirectCandidate.clear();
+            updateUnredirectedWindow();
+        });
+    }
+
+    if (OverlayWindow *overlayWindow = backend() ? backend()->overlayWindow() : nullptr) {
+        // Punch a hole into the overlay window so the unredirected window is visible.
+        QRegion shape = workspace()->geometry();
+        if (m_unredirectedWindow) {
+            shape -= m_unredirectedWindow->frameGeometry();
+        }
+        overlayWindow->setShape(shape);
+    }
+    xcb_flush(connection);
+
+    if (m_unredirectedWindow) {
+        qCDebug(KWIN_CORE) << "Unredirected fullscreen window" << m_unredirectedWindow;
+    }
+}
+
 X11Compositor *X11Compositor::self()
 {
     return qobject_cast<X11Compositor *>(Compositor::self());
@@ -12,7 +12,9 @@
 #include <kwinglobals.h>
 
 #include <QObject>
+#include <QPointer>
 #include <QRegion>
+#include <QSet>
 #include <QTimer>
 
 namespace KWin
@@ -87,6 +89,16 @@ public:
         return s_compositor != nullptr && s_compositor->isActive();
     }
 
+    /**
+     * Whether all outputs are powered off. While the compositor sleeps nothing is painted,
+     * transient GPU caches are released and screencasts are paused. Waking up forces a
+     * full repaint.
+     */
+    bool isSleeping() const
+    {
+        return m_sleeping;
+    }
+
     // for delayed supportproperty management of effects
     void keepSupportProperty(xcb_atom_t atom);
     void removeSupportProperty(xcb_atom_t atom);
@@ -96,6 +108,7 @@ Q_SIGNALS:
     void aboutToDestroy();
     void aboutToToggleCompositing();
     void sceneCreated();
+    void sleepingChanged(bool sleeping);
 
 protected:
     explicit Compositor(QObject *parent = nullptr);
@@ -131,6 +144,7 @@ private:
 
     void releaseCompositorSelection();
     void deleteUnusedSupportProperties();
+    void recoverFromGraphicsReset();
 
     bool attemptOpenGLCompositing();
     bool attemptQPainterCompositing();
@@ -141,6 +155,8 @@ private:
 
     void addSuperLayer(RenderLayer *layer);
     void removeSuperLayer(RenderLayer *layer);
+    void updateSleeping();
+    void updateFrameRateLimit(Output *output);
 
     void prePaintPass(RenderLayer *layer);
     void postPaintPass(RenderLayer *layer);
@@ -155,6 +171,11 @@ private:
     Scene *m_scene = nullptr;
     RenderBackend *m_backend = nullptr;
     QHash<RenderLoop *, RenderLayer *> m_superlayers;
+    QHash<RenderLoop *, QRegion> m_overlayRegions;
+    QSet<RenderLoop *> m_fullFrameRateLoops;
+    bool m_sleeping = false;
+    // Set when an option changed that only takes effect with a new backend
+    bool m_restartRequired = false;
 };
 
 class KWIN_EXPORT WaylandCompositor final : public Compositor
@@ -241,6 +262,12 @@ public:
 
     void updateClientCompositeBlocking(X11Window *client = nullptr);
 
+    /**
+     * Returns the fullscreen window that is currently presented by the X server directly,
+     * bypassing the compositor.
+     */
+    X11Window *unredirectedWindow() const;
+
     static X11Compositor *self();
 
 protected:
@@ -250,7 +277,14 @@ protected:
 
 private:
     explicit X11Compositor(QObject *parent);
+    X11Window *findUnredirectCandidate() const;
+    void updateUnredirectedWindow();
+    void setUnredirectedWindow(X11Window *window);
+
     QScopedPointer<X11SyncManager> m_syncManager;
+    QPointer<X11Window> m_unredirectedWindow;
+    QPointer<X11Window> m_unredirectCandidate;
+    QTimer *m_unredirectTimer;
     /**
      * Whether the Compositor is currently suspended, 8 bits encoding the reason
      */
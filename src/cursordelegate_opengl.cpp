@@ -6,6 +6,7 @@
 
 #include "cursordelegate_opengl.h"
 #include "cursor.h"
+#include "scenes/opengl/cursortexturecache.h"
 #include "kwingltexture.h"
 #include "kwinglutils.h"
 #include "renderlayer.h"
@@ -14,8 +15,9 @@
 namespace KWin
 {
 
-CursorDelegateOpenGL::CursorDelegateOpenGL(QObject *parent)
+CursorDelegateOpenGL::CursorDelegateOpenGL(CursorTextureCache *textureCache, QObject *parent)
     : RenderLayerDelegate(parent)
+    , m_textureCache(textureCache)
 {
 }
 
@@ -29,33 +31,10 @@ void CursorDelegateOpenGL::paint(RenderTarget *renderTarget, const QRegion &regi
         return;
     }
 
-    auto allocateTexture = [this]() {
-        const QImage img = Cursors::self()->currentCursor()->image();
-        if (img.isNull()) {
-            m_cursorTextureDirty = false;
-            return;
-        }
-        m_cursorTexture.reset(new GLTexture(img));
-        m_cursorTexture->setWrapMode(GL_CLAMP_TO_EDGE);
-        m_cursorTextureDirty = false;
-    };
-
-    // lazy init texture cursor only in case we need software rendering
+    // The texture is shared with the cursor layers of other outputs and screencasts.
+    m_cursorTexture = m_textureCache->texture(Cursors::self()->currentCursor()->image());
     if (!m_cursorTexture) {
-        allocateTexture();
-
-        // handle shape update on case cursor image changed
-        connect(Cursors::self(), &Cursors::currentCursorChanged, this, [this]() {
-            m_cursorTextureDirty = true;
-        });
-    } else if (m_cursorTextureDirty) {
-        const QImage image = Cursors::self()->currentCursor()->image();
-        if (image.size() == m_cursorTexture->size()) {
-            m_cursorTexture->update(image);
-            m_cursorTextureDirty = false;
-        } else {
-            allocateTexture();
-        }
+        return;
     }
 
     const QRect cursorRect = layer()->mapToGlobal(layer()->rect());
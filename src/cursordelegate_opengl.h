@@ -8,9 +8,12 @@
 
 #include "renderlayerdelegate.h"
 
+#include <memory>
+
 namespace KWin
 {
 
+class CursorTextureCache;
 class GLTexture;
 
 class CursorDelegateOpenGL final : public RenderLayerDelegate
@@ -18,14 +21,14 @@ class CursorDelegateOpenGL final : public RenderLayerDelegate
     Q_OBJECT
 
 public:
-    explicit CursorDelegateOpenGL(QObject *parent = nullptr);
+    explicit CursorDelegateOpenGL(CursorTextureCache *textureCache, QObject *parent = nullptr);
     ~CursorDelegateOpenGL() override;
 
     void paint(RenderTarget *renderTarget, const QRegion &region) override;
 
 private:
-    QScopedPointer<GLTexture> m_cursorTexture;
-    bool m_cursorTextureDirty = false;
+    CursorTextureCache *m_textureCache;
+    std::shared_ptr<GLTexture> m_cursorTexture;
 };
 
 } // namespace KWin
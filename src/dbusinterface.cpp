@@ -17,6 +17,7 @@
 #include "atoms.h"
 #include "composite.h"
 #include "debug_console.h"
+#include "internalwindow.h"
 #include "kwinadaptor.h"
 #include "main.h"
 #include "output.h"
@@ -35,6 +36,9 @@
 // Qt
 #include <QDBusServiceWatcher>
 #include <QOpenGLContext>
+#include <QTimer>
+
+#include <algorithm>
 
 namespace KWin
 {
@@ -60,6 +64,19 @@ DBusInterface::DBusInterface(QObject *parent)
     dbus.connect(QString(), QStringLiteral("/KWin"), QStringLiteral("org.kde.KWin"), QStringLiteral("reloadConfig"),
                  Workspace::self(), SLOT(slotReloadConfig()));
     connect(kwinApp(), &Application::x11ConnectionChanged, this, &DBusInterface::announceService);
+
+    connect(Workspace::self(), &Workspace::windowAdded, this, &DBusInterface::trackWindow);
+    connect(Workspace::self(), &Workspace::windowRemoved, this, &DBusInterface::untrackWindow);
+    connect(Workspace::self(), &Workspace::internalWindowAdded, this, &DBusInterface::trackWindow);
+    connect(Workspace::self(), &Workspace::internalWindowRemoved, this, &DBusInterface::untrackWindow);
+    const auto windows = Workspace::self()->allClientList();
+    for (Window *window : windows) {
+        trackWindow(window);
+    }
+    const auto internalWindows = Workspace::self()->internalWindows();
+    for (Window *window : internalWindows) {
+        trackWindow(window);
+    }
 }
 
 void DBusInterface::becomeKWinService(const QString &service)
@@ -254,17 +271,127 @@ QVariantMap DBusInterface::queryWindowInfo()
 
 QVariantMap DBusInterface::getWindowInfo(const QString &uuid)
 {
-    const auto id = QUuid::fromString(uuid);
-    const auto client = workspace()->findAbstractClient([&id](const Window *c) {
-        return c->internalId() == id;
-    });
-    if (client) {
-        return clientToVariantMap(client);
+    const Window *window = m_windows.value(QUuid::fromString(uuid));
+    if (window) {
+        return clientToVariantMap(window);
     } else {
         return {};
     }
 }
 
+QVariantMap DBusInterface::getAllWindowInfo()
+{
+    QVariantMap windows;
+    for (auto it = m_windows.constBegin(); it != m_windows.constEnd(); ++it) {
+        windows.insert(it.key().toString(), clientToVariantMap(it.value()));
+    }
+    return {
+        {QStringLiteral("generation"), m_windowInfoGeneration},
+        {QStringLiteral("windows"), windows},
+    };
+}
+
+QVariantMap DBusInterface::getWindowInfoChanges(qulonglong generation)
+{
+    if (generation < m_oldestRemovalGeneration) {
+        QVariantMap reply = getAllWindowInfo();
+        reply.insert(QStringLiteral("removed"), QStringList());
+        reply.insert(QStringLiteral("reset"), true);
+        return reply;
+    }
+
+    QVariantMap windows;
+    for (auto it = m_windowGenerations.constBegin(); it != m_windowGenerations.constEnd(); ++it) {
+        if (it.value() > generation) {
+            windows.insert(it.key().toString(), clientToVariantMap(m_windows.value(it.key())));
+        }
+    }
+    QStringList removed;
+    for (auto it = m_removedWindows.constBegin(); it != m_removedWindows.constEnd(); ++it) {
+        if (it.value() > generation) {
+            removed.append(it.key().toString());
+        }
+    }
+    return {
+        {QStringLiteral("generation"), m_windowInfoGeneration},
+        {QStringLiteral("windows"), windows},
+        {QStringLiteral("removed"), removed},
+        {QStringLiteral("reset"), false},
+    };
+}
+
+void DBusInterface::trackWindow(Window *window)
+{
+    if (m_windows.contains(window->internalId())) {
+        return;
+    }
+    m_windows.insert(window->internalId(), window);
+    m_removedWindows.remove(window->internalId());
+    markWindowChanged(window);
+
+    // everything clientToVariantMap() reports
+    auto changed = [this, window]() {
+        markWindowChanged(window);
+    };
+    connect(window, &Window::frameGeometryChanged, this, changed);
+    connect(window, &Window::captionChanged, this, changed);
+    connect(window, &Window::windowClassChanged, this, changed);
+    connect(window, &Window::windowRoleChanged, this, changed);
+    connect(window, &Window::desktopFileNameChanged, this, changed);
+    connect(window, &Window::desktopChanged, this, changed);
+    connect(window, &Window::activitiesChanged, this, changed);
+    connect(window, &Window::minimizedChanged, this, changed);
+    connect(window, &Window::shadeChanged, this, changed);
+    connect(window, &Window::fullScreenChanged, this, changed);
+    connect(window, &Window::keepAboveChanged, this, changed);
+    connect(window, &Window::keepBelowChanged, this, changed);
+    connect(window, &Window::decorationChanged, this, changed);
+    connect(window, &Window::skipTaskbarChanged, this, changed);
+    connect(window, &Window::skipPagerChanged, this, changed);
+    connect(window, &Window::skipSwitcherChanged, this, changed);
+    connect(window, qOverload<Window *, MaximizeMode>(&Window::clientMaximizedStateChanged), this, changed);
+}
+
+void DBusInterface::untrackWindow(Window *window)
+{
+    const QUuid id = window->internalId();
+    if (!m_windows.remove(id)) {
+        return;
+    }
+    disconnect(window, nullptr, this, nullptr);
+    m_windowGenerations.remove(id);
+    m_removedWindows.insert(id, ++m_windowInfoGeneration);
+
+    // only remember a bounded number of removals, clients that fall further behind get a full reset
+    static const int maxRemovedWindows = 256;
+    while (m_removedWindows.count() > maxRemovedWindows) {
+        auto oldest = std::min_element(m_removedWindows.begin(), m_removedWindows.end());
+        m_oldestRemovalGeneration = oldest.value();
+        m_removedWindows.erase(oldest);
+    }
+
+    scheduleWindowInfoChanged();
+}
+
+void DBusInterface::markWindowChanged(Window *window)
+{
+    m_windowGenerations.insert(window->internalId(), ++m_windowInfoGeneration);
+    scheduleWindowInfoChanged();
+}
+
+void DBusInterface::scheduleWindowInfoChanged()
+{
+    // a moving window changes on every frame, collapse that into one notification
+    if (m_windowInfoChangedScheduled) {
+        return;
+    }
+    m_windowInfoChangedScheduled = true;
+    QTimer::singleShot(0, this, [this]() {
+        m_windowInfoChangedScheduled = false;
+        Q_EMIT windowInfoChanged(m_windowInfoGeneration);
+    });
+}
+
 CompositorDBusInterface::CompositorDBusInterface(Compositor *parent)
     : QObject(parent)
     , m_compositor(parent)
@@ -11,6 +11,7 @@
 #define KWIN_DBUS_INTERFACE_H
 
 #include <QObject>
+#include <QUuid>
 #include <QtDBus>
 
 #include "virtualdesktopsdbustypes.h"
@@ -21,6 +22,7 @@ namespace KWin
 class Compositor;
 class PluginManager;
 class VirtualDesktopManager;
+class Window;
 
 /**
  * @brief This class is a wrapper for the org.kde.KWin D-Bus interface.
@@ -86,13 +88,51 @@ public Q_SLOTS: // METHODS
      */
     QVariantMap getWindowInfo(const QString &uuid);
 
+    /**
+     * Returns information about all windows in one call.
+     *
+     * The map contains the entries @c generation, the current window info generation,
+     * and @c windows, a map from window uuid to the map returned by getWindowInfo.
+     */
+    QVariantMap getAllWindowInfo();
+
+    /**
+     * Returns information about the windows that changed after @p generation.
+     *
+     * The map contains the entries @c generation, the current window info generation,
+     * @c windows, a map from uuid to window info for every window that was added or
+     * changed, and @c removed, the uuids of the windows that are gone. If @p generation
+     * is too old for the removals to be known, @c reset is @c true and @c windows holds
+     * all windows; the caller should then drop everything it knows.
+     */
+    QVariantMap getWindowInfoChanges(qulonglong generation);
+
+Q_SIGNALS:
+    /**
+     * Emitted at most once per event loop iteration when window info changed.
+     * @p generation can be passed to getWindowInfoChanges after the changes were fetched.
+     */
+    void windowInfoChanged(qulonglong generation);
+
 private Q_SLOTS:
     void becomeKWinService(const QString &service);
 
 private:
     void announceService();
+    void trackWindow(Window *window);
+    void untrackWindow(Window *window);
+    void markWindowChanged(Window *window);
+    void scheduleWindowInfoChanged();
+
     QString m_serviceName;
     QDBusMessage m_replyQueryWindowInfo;
+
+    QHash<QUuid, Window *> m_windows;
+    QHash<QUuid, quint64> m_windowGenerations;
+    QHash<QUuid, quint64> m_removedWindows;
+    quint64 m_windowInfoGeneration = 0;
+    quint64 m_oldestRemovalGeneration = 0;
+    bool m_windowInfoChangedScheduled = false;
 };
 
 class CompositorDBusInterface : public QObject
@@ -13,6 +13,10 @@
 #include "internalwindow.h"
 #include "keyboard_input.h"
 #include "main.h"
+#include "output.h"
+#include "platform.h"
+#include "renderloop.h"
+#include "renderloop_p.h"
 #include "scene.h"
 #include "unmanaged.h"
 #include "utils/subsurfacemonitor.h"
@@ -45,6 +49,7 @@
 #include <QMetaType>
 #include <QMouseEvent>
 #include <QScopeGuard>
+#include <QTimer>
 #include <QtConcurrentRun>
 
 #include <wayland-server-core.h>
@@ -52,6 +57,7 @@
 // xkb
 #include <xkbcommon/xkbcommon.h>
 
+#include <algorithm>
 #include <fcntl.h>
 #include <functional>
 #include <sys/poll.h>
@@ -597,6 +603,10 @@ DebugConsole::DebugConsole()
     m_ui->clipboardContent->setModel(new DataSourceModel(this));
     m_ui->primaryContent->setModel(new DataSourceModel(this));
     m_ui->inputDevicesView->setModel(new InputDeviceModel(this));
+    m_ui->clientsView->setModel(new ClientStatisticsModel(this));
+    m_ui->latencyView->setModel(new InputLatencyModel(this));
+    m_ui->gpuMemoryView->setModel(new GpuMemoryModel(this));
+    m_ui->frameTimingView->setModel(new FrameTimingModel(this));
     m_ui->inputDevicesView->setItemDelegate(new DebugConsoleDelegate(this));
     m_ui->quitButton->setIcon(QIcon::fromTheme(QStringLiteral("application-exit")));
     m_ui->tabWidget->setTabIcon(0, QIcon::fromTheme(QStringLiteral("view-list-tree")));
@@ -606,6 +616,8 @@ DebugConsole::DebugConsole()
         m_ui->tabWidget->setTabEnabled(1, false);
         m_ui->tabWidget->setTabEnabled(2, false);
         m_ui->tabWidget->setTabEnabled(6, false);
+        m_ui->tabWidget->setTabEnabled(7, false);
+        m_ui->tabWidget->setTabEnabled(8, false);
     }
 
     connect(m_ui->quitButton, &QAbstractButton::clicked, this, &DebugConsole::deleteLater);
@@ -619,6 +631,39 @@ DebugConsole::DebugConsole()
             updateKeyboardTab();
             connect(input(), &InputRedirection::keyStateChanged, this, &DebugConsole::updateKeyboardTab);
         }
+        if (index == 7 && !m_clientStatisticsTimer) {
+            auto model = static_cast<ClientStatisticsModel *>(m_ui->clientsView->model());
+            model->refresh();
+            m_clientStatisticsTimer = new QTimer(this);
+            m_clientStatisticsTimer->setInterval(1000);
+            connect(m_clientStatisticsTimer, &QTimer::timeout, model, &ClientStatisticsModel::refresh);
+            m_clientStatisticsTimer->start();
+            // The model must not keep pointers to connections that are about to be deleted.
+            connect(waylandServer()->display(), &KWaylandServer::Display::clientDisconnected, model, &ClientStatisticsModel::refresh);
+        }
+        if (index == 8 && !m_inputLatencyTimer) {
+            auto model = static_cast<InputLatencyModel *>(m_ui->latencyView->model());
+            model->refresh();
+            m_inputLatencyTimer = new QTimer(this);
+            m_inputLatencyTimer->setInterval(1000);
+            connect(m_inputLatencyTimer, &QTimer::timeout, model, &InputLatencyModel::refresh);
+            m_inputLatencyTimer->start();
+        }
+        if (index == 9 && !m_gpuMemoryTimer) {
+            auto model = static_cast<GpuMemoryModel *>(m_ui->gpuMemoryView->model());
+            m_gpuMemoryTimer = new QTimer(this);
+            m_gpuMemoryTimer->setInterval(1000);
+            connect(m_gpuMemoryTimer, &QTimer::timeout, model, &GpuMemoryModel::refresh);
+            m_gpuMemoryTimer->start();
+        }
+        if (index == 10 && !m_frameTimingTimer) {
+            auto model = static_cast<FrameTimingModel *>(m_ui->frameTimingView->model());
+            model->refresh();
+            m_frameTimingTimer = new QTimer(this);
+            m_frameTimingTimer->setInterval(1000);
+            connect(m_frameTimingTimer, &QTimer::timeout, model, &FrameTimingModel::refresh);
+            m_frameTimingTimer->start();
+        }
         if (index == 6) {
             static_cast<DataSourceModel *>(m_ui->clipboardContent->model())->setSource(waylandServer()->seat()->selection());
             m_ui->clipboardSource->setText(sourceString(waylandServer()->seat()->selection()));
@@ -896,6 +941,7 @@ void DebugConsoleModel::remove(int parentRow, QVector<T *> &windows, T *window)
     }
     beginRemoveRows(index(parentRow, 0, QModelIndex()), remove, remove);
     windows.removeAt(remove);
+    m_fetchedWindows.remove(window);
     endRemoveRows();
 }
 
@@ -1002,6 +1048,11 @@ int DebugConsoleModel::rowCount(const QModelIndex &parent) const
         return 0;
     }
 
+    if (!m_fetchedWindows.contains(windowObject(parent))) {
+        // properties are only fetched once the window gets expanded
+        return 0;
+    }
+
     if (parent.internalId() < s_idDistance * (s_x11WindowId + 1)) {
         return propertyCount(parent, &DebugConsoleModel::x11Window);
     } else if (parent.internalId() < s_idDistance * (s_x11UnmanagedId + 1)) {
@@ -1111,6 +1162,36 @@ QModelIndex DebugConsoleModel::parent(const QModelIndex &child) const
     return QModelIndex();
 }
 
+bool DebugConsoleModel::hasChildren(const QModelIndex &parent) const
+{
+    if (QObject *window = windowObject(parent)) {
+        return window->metaObject()->propertyCount() > 0;
+    }
+    return QAbstractItemModel::hasChildren(parent);
+}
+
+bool DebugConsoleModel::canFetchMore(const QModelIndex &parent) const
+{
+    QObject *window = windowObject(parent);
+    return window && !m_fetchedWindows.contains(window);
+}
+
+void DebugConsoleModel::fetchMore(const QModelIndex &parent)
+{
+    QObject *window = windowObject(parent);
+    if (!window || m_fetchedWindows.contains(window)) {
+        return;
+    }
+    const int count = window->metaObject()->propertyCount();
+    if (count == 0) {
+        m_fetchedWindows.insert(window);
+        return;
+    }
+    beginInsertRows(parent, 0, count - 1);
+    m_fetchedWindows.insert(window);
+    endInsertRows();
+}
+
 QVariant DebugConsoleModel::propertyData(QObject *object, const QModelIndex &index, int role) const
 {
     Q_UNUSED(role)
@@ -1285,6 +1366,24 @@ Unmanaged *DebugConsoleModel::unmanaged(const QModelIndex &index) const
     return windowForIndex(index, m_unmanageds, s_x11UnmanagedId);
 }
 
+QObject *DebugConsoleModel::windowObject(const QModelIndex &index) const
+{
+    // only the second level refers to windows, the first level are the categories
+    if (!index.isValid() || index.internalId() <= s_workspaceInternalId || (index.internalId() & s_propertyBitMask)) {
+        return nullptr;
+    }
+    if (index.internalId() < s_idDistance * (s_x11WindowId + 1)) {
+        return x11Window(index);
+    } else if (index.internalId() < s_idDistance * (s_x11UnmanagedId + 1)) {
+        return unmanaged(index);
+    } else if (index.internalId() < s_idDistance * (s_waylandWindowId + 1)) {
+        return waylandWindow(index);
+    } else if (index.internalId() < s_idDistance * (s_workspaceInternalId + 1)) {
+        return internalWindow(index);
+    }
+    return nullptr;
+}
+
 /////////////////////////////////////// SurfaceTreeModel
 SurfaceTreeModel::SurfaceTreeModel(QObject *parent)
     : QAbstractItemModel(parent)
@@ -1294,28 +1393,76 @@ SurfaceTreeModel::SurfaceTreeModel(QObject *parent)
         beginResetModel();
         endResetModel();
     };
-    using namespace KWaylandServer;
+    // removals have to reset right away, the view must not keep indexes to destroyed surfaces
+    connect(workspace(), &Workspace::windowAdded, this, &SurfaceTreeModel::scheduleReset);
+    connect(workspace(), &Workspace::windowRemoved, this, reset);
+    connect(workspace(), &Workspace::unmanagedAdded, this, &SurfaceTreeModel::scheduleReset);
+    connect(workspace(), &Workspace::unmanagedRemoved, this, reset);
+}
 
-    auto watchSubsurfaces = [this, reset](Window *c) {
-        if (!c->surface()) {
-            return;
+void SurfaceTreeModel::scheduleReset()
+{
+    // several windows often appear in one go, e.g. a client mapping a toplevel and its popups
+    if (m_resetScheduled) {
+        return;
+    }
+    m_resetScheduled = true;
+    QTimer::singleShot(0, this, [this]() {
+        m_resetScheduled = false;
+        beginResetModel();
+        endResetModel();
+    });
+}
+
+bool SurfaceTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    using namespace KWaylandServer;
+    if (SurfaceInterface *surface = static_cast<SurfaceInterface *>(parent.internalPointer())) {
+        if (!surface->subSurface() && !m_fetchedSurfaces.contains(surface)) {
+            // not expanded yet, assume there are sub-surfaces
+            return true;
         }
-        auto monitor = new SubSurfaceMonitor(c->surface(), this);
-        connect(monitor, &SubSurfaceMonitor::subSurfaceAdded, this, reset);
-        connect(monitor, &SubSurfaceMonitor::subSurfaceRemoved, this, reset);
-        connect(c, &QObject::destroyed, monitor, &QObject::deleteLater);
-    };
+    }
+    return QAbstractItemModel::hasChildren(parent);
+}
+
+bool SurfaceTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    using namespace KWaylandServer;
+    if (SurfaceInterface *surface = static_cast<SurfaceInterface *>(parent.internalPointer())) {
+        return !surface->subSurface() && !m_fetchedSurfaces.contains(surface);
+    }
+    return false;
+}
 
-    for (auto c : workspace()->allClientList()) {
-        watchSubsurfaces(c);
+void SurfaceTreeModel::fetchMore(const QModelIndex &parent)
+{
+    using namespace KWaylandServer;
+    SurfaceInterface *surface = static_cast<SurfaceInterface *>(parent.internalPointer());
+    if (!surface || surface->subSurface() || m_fetchedSurfaces.contains(surface)) {
+        return;
     }
-    connect(workspace(), &Workspace::windowAdded, this, [reset, watchSubsurfaces](Window *c) {
-        watchSubsurfaces(c);
-        reset();
+
+    // only watch the sub-surface trees that are shown
+    auto monitor = new SubSurfaceMonitor(surface, this);
+    connect(monitor, &SubSurfaceMonitor::subSurfaceAdded, this, &SurfaceTreeModel::scheduleReset);
+    connect(monitor, &SubSurfaceMonitor::subSurfaceRemoved, this, [this] {
+        beginResetModel();
+        endResetModel();
     });
-    connect(workspace(), &Workspace::windowRemoved, this, reset);
-    connect(workspace(), &Workspace::unmanagedAdded, this, reset);
-    connect(workspace(), &Workspace::unmanagedRemoved, this, reset);
+    connect(surface, &QObject::destroyed, monitor, &QObject::deleteLater);
+    connect(surface, &QObject::destroyed, this, [this, surface]() {
+        m_fetchedSurfaces.remove(surface);
+    });
+
+    const int count = surface->below().count() + surface->above().count();
+    if (count == 0) {
+        m_fetchedSurfaces.insert(surface);
+        return;
+    }
+    beginInsertRows(parent, 0, count - 1);
+    m_fetchedSurfaces.insert(surface);
+    endInsertRows();
 }
 
 SurfaceTreeModel::~SurfaceTreeModel() = default;
@@ -1331,6 +1478,9 @@ int SurfaceTreeModel::rowCount(const QModelIndex &parent) const
     if (parent.isValid()) {
         using namespace KWaylandServer;
         if (SurfaceInterface *surface = static_cast<SurfaceInterface *>(parent.internalPointer())) {
+            if (!surface->subSurface() && !m_fetchedSurfaces.contains(surface)) {
+                return 0;
+            }
             return surface->below().count() + surface->above().count();
         }
         return 0;
@@ -1691,4 +1841,414 @@ void DataSourceModel::setSource(KWaylandServer::AbstractDataSource *source)
     }
     endResetModel();
 }
+
+int ClientStatisticsModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_clients.count();
+}
+
+int ClientStatisticsModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 7;
+}
+
+QVariant ClientStatisticsModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch (section) {
+    case 0:
+        return i18n("Client");
+    case 1:
+        return i18n("Requests");
+    case 2:
+        return i18n("Handler Time (ms)");
+    case 3:
+        return i18n("Commits");
+    case 4:
+        return i18n("Commits per Second");
+    case 5:
+        return i18n("Damaged Pixels");
+    case 6:
+        return i18n("Busiest Interface");
+    default:
+        return QVariant();
+    }
+}
+
+QVariant ClientStatisticsModel::data(const QModelIndex &index, int role) const
+{
+    if (!checkIndex(index, CheckIndexOption::IndexIsValid) || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    const KWaylandServer::ClientConnection *client = m_clients.at(index.row());
+    const KWaylandServer::ClientStatistics &statistics = m_statistics.at(index.row());
+    switch (index.column()) {
+    case 0:
+        return QStringLiteral("%1 (%2)").arg(client->executablePath()).arg(client->processId());
+    case 1:
+        return statistics.requestCount;
+    case 2:
+        return std::chrono::duration<double, std::milli>(statistics.handlerTime).count();
+    case 3:
+        return statistics.commitCount;
+    case 4:
+        return statistics.commitsPerSecond;
+    case 5:
+        return statistics.damagedArea;
+    case 6: {
+        auto busiest = std::max_element(statistics.interfaces.constBegin(), statistics.interfaces.constEnd(), [](const auto &a, const auto &b) {
+            return a.handlerTime < b.handlerTime;
+        });
+        return busiest != statistics.interfaces.constEnd() ? QString::fromLatin1(busiest.key()) : QString();
+    }
+    default:
+        return QVariant();
+    }
+}
+
+void ClientStatisticsModel::refresh()
+{
+    QVector<KWaylandServer::ClientConnection *> clients = waylandServer()->display()->connections();
+    std::sort(clients.begin(), clients.end(), [](KWaylandServer::ClientConnection *a, KWaylandServer::ClientConnection *b) {
+        return a->processId() < b->processId();
+    });
+
+    QVector<KWaylandServer::ClientStatistics> statistics;
+    statistics.reserve(clients.count());
+    for (KWaylandServer::ClientConnection *client : qAsConst(clients)) {
+        statistics.append(client->statistics());
+    }
+
+    // Only reset the model if clients have come or gone so the selection is kept.
+    if (clients != m_clients) {
+        beginResetModel();
+        m_clients = clients;
+        m_statistics = statistics;
+        endResetModel();
+    } else {
+        m_statistics = statistics;
+        if (!m_clients.isEmpty()) {
+            Q_EMIT dataChanged(index(0, 1), index(m_clients.count() - 1, columnCount() - 1), {Qt::DisplayRole});
+        }
+    }
+}
+
+int InputLatencyModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_outputs.count();
+}
+
+int InputLatencyModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 7;
+}
+
+QVariant InputLatencyModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch (section) {
+    case 0:
+        return i18n("Output");
+    case 1:
+        return i18n("Samples");
+    case 2:
+        return i18n("Minimum (ms)");
+    case 3:
+        return i18n("Median (ms)");
+    case 4:
+        return i18n("90th Percentile (ms)");
+    case 5:
+        return i18n("99th Percentile (ms)");
+    case 6:
+        return i18n("Maximum (ms)");
+    default:
+        return QVariant();
+    }
+}
+
+QVariant InputLatencyModel::data(const QModelIndex &index, int role) const
+{
+    if (!checkIndex(index, CheckIndexOption::IndexIsValid) || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    auto toMilliseconds = [](std::chrono::nanoseconds value) {
+        return std::chrono::duration<double, std::milli>(value).count();
+    };
+
+    const InputLatencyMonitor::Statistics &statistics = m_statistics.at(index.row());
+    switch (index.column()) {
+    case 0:
+        return m_outputs.at(index.row());
+    case 1:
+        return statistics.count;
+    case 2:
+        return toMilliseconds(statistics.minimum);
+    case 3:
+        return toMilliseconds(statistics.percentile(50));
+    case 4:
+        return toMilliseconds(statistics.percentile(90));
+    case 5:
+        return toMilliseconds(statistics.percentile(99));
+    case 6:
+        return toMilliseconds(statistics.maximum);
+    default:
+        return QVariant();
+    }
+}
+
+void InputLatencyModel::refresh()
+{
+    const InputLatencyMonitor *monitor = InputLatencyMonitor::self();
+    const QHash<QString, InputLatencyMonitor::Statistics> statistics = monitor ? monitor->statistics() : QHash<QString, InputLatencyMonitor::Statistics>();
+
+    QVector<QString> outputs = statistics.keys().toVector();
+    std::sort(outputs.begin(), outputs.end());
+
+    QVector<InputLatencyMonitor::Statistics> outputStatistics;
+    outputStatistics.reserve(outputs.count());
+    for (const QString &output : qAsConst(outputs)) {
+        outputStatistics.append(statistics.value(output));
+    }
+
+    if (outputs != m_outputs) {
+        beginResetModel();
+        m_outputs = outputs;
+        m_statistics = outputStatistics;
+        endResetModel();
+    } else {
+        m_statistics = outputStatistics;
+        if (!m_outputs.isEmpty()) {
+            Q_EMIT dataChanged(index(0, 1), index(m_outputs.count() - 1, columnCount() - 1), {Qt::DisplayRole});
+        }
+    }
+}
+
+// One row per category, followed by the total and the budget
+static const int s_gpuMemoryTotalRow = GLMemoryTracker::CategoryCount;
+
+static QString gpuMemoryCategoryName(GLMemoryTracker::Category category)
+{
+    switch (category) {
+    case GLMemoryTracker::Other:
+        return i18nc("GPU memory category", "Other");
+    case GLMemoryTracker::Surface:
+        return i18nc("GPU memory category", "Window contents");
+    case GLMemoryTracker::Decoration:
+        return i18nc("GPU memory category", "Decorations");
+    case GLMemoryTracker::Shadow:
+        return i18nc("GPU memory category", "Shadows");
+    case GLMemoryTracker::Blur:
+        return i18nc("GPU memory category", "Blur");
+    case GLMemoryTracker::Thumbnail:
+        return i18nc("GPU memory category", "Thumbnails");
+    case GLMemoryTracker::Mipmap:
+        return i18nc("GPU memory category", "Mipmaps");
+    case GLMemoryTracker::OffscreenView:
+        return i18nc("GPU memory category", "Offscreen views");
+    case GLMemoryTracker::ShadowBuffer:
+        return i18nc("GPU memory category", "Shadow buffers");
+    case GLMemoryTracker::Swapchain:
+        return i18nc("GPU memory category", "Swapchains");
+    }
+    return GLMemoryTracker::categoryName(category);
+}
+
+int GpuMemoryModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : GLMemoryTracker::CategoryCount + 2;
+}
+
+int GpuMemoryModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 3;
+}
+
+QVariant GpuMemoryModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch (section) {
+    case 0:
+        return i18n("Category");
+    case 1:
+        return i18n("Allocations");
+    case 2:
+        return i18n("Memory (MiB)");
+    default:
+        return QVariant();
+    }
+}
+
+QVariant GpuMemoryModel::data(const QModelIndex &index, int role) const
+{
+    if (!checkIndex(index, CheckIndexOption::IndexIsValid) || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    auto toMegabytes = [](qint64 bytes) {
+        return QString::number(bytes / (1024.0 * 1024.0), 'f', 1);
+    };
+
+    const GLMemoryTracker *tracker = GLMemoryTracker::self();
+    if (index.row() == s_gpuMemoryTotalRow) {
+        switch (index.column()) {
+        case 0:
+            return i18n("Total");
+        case 2:
+            return toMegabytes(tracker->totalUsage());
+        default:
+            return QVariant();
+        }
+    }
+    if (index.row() == s_gpuMemoryTotalRow + 1) {
+        switch (index.column()) {
+        case 0:
+            return i18n("Budget");
+        case 2:
+            return tracker->budget() > 0 ? toMegabytes(tracker->budget()) : i18n("None");
+        default:
+            return QVariant();
+        }
+    }
+
+    const auto category = GLMemoryTracker::Category(index.row());
+    switch (index.column()) {
+    case 0:
+        return gpuMemoryCategoryName(category);
+    case 1:
+        return tracker->allocationCount(category);
+    case 2:
+        return toMegabytes(tracker->usage(category));
+    default:
+        return QVariant();
+    }
+}
+
+void GpuMemoryModel::refresh()
+{
+    Q_EMIT dataChanged(index(0, 1), index(rowCount() - 1, columnCount() - 1), {Qt::DisplayRole});
+}
+
+int FrameTimingModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.count();
+}
+
+int FrameTimingModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 6;
+}
+
+QVariant FrameTimingModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    switch (section) {
+    case 0:
+        return i18n("Output");
+    case 1:
+        return i18n("Refresh Rate (Hz)");
+    case 2:
+        return i18n("Frames per Second");
+    case 3:
+        return i18n("Longest Frame Interval (ms)");
+    case 4:
+        return i18n("Average Render Time (ms)");
+    case 5:
+        return i18n("Maximum Render Time (ms)");
+    default:
+        return QVariant();
+    }
+}
+
+QVariant FrameTimingModel::data(const QModelIndex &index, int role) const
+{
+    if (!checkIndex(index, CheckIndexOption::IndexIsValid) || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    auto toMilliseconds = [](std::chrono::nanoseconds value) {
+        return QString::number(std::chrono::duration<double, std::milli>(value).count(), 'f', 2);
+    };
+
+    const Row &row = m_rows.at(index.row());
+    switch (index.column()) {
+    case 0:
+        return row.output;
+    case 1:
+        return QString::number(row.refreshRate / 1000.0, 'f', 2);
+    case 2:
+        return row.frames;
+    case 3:
+        return toMilliseconds(row.longestInterval);
+    case 4:
+        return toMilliseconds(row.averageRenderTime);
+    case 5:
+        return toMilliseconds(row.maximumRenderTime);
+    default:
+        return QVariant();
+    }
+}
+
+void FrameTimingModel::handleFramePresented(RenderLoop *loop, std::chrono::nanoseconds timestamp)
+{
+    Timing &timing = m_timings[loop];
+    if (timing.lastPresentation != std::chrono::nanoseconds::zero()) {
+        timing.longestInterval = std::max(timing.longestInterval, timestamp - timing.lastPresentation);
+    }
+    timing.lastPresentation = timestamp;
+    timing.frames++;
+}
+
+void FrameTimingModel::refresh()
+{
+    // the refresh timer fires once per second, so the frame count is the frame rate
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+
+    QVector<Row> rows;
+    rows.reserve(outputs.count());
+    QHash<RenderLoop *, Timing> timings;
+    for (Output *output : outputs) {
+        RenderLoop *loop = output->renderLoop();
+        connect(loop, &RenderLoop::framePresented, this, &FrameTimingModel::handleFramePresented, Qt::UniqueConnection);
+
+        Timing &timing = m_timings[loop];
+        const RenderJournal &journal = RenderLoopPrivate::get(loop)->renderJournal;
+
+        Row row;
+        row.output = output->name();
+        row.refreshRate = loop->refreshRate();
+        row.frames = timing.frames;
+        row.longestInterval = timing.longestInterval;
+        row.averageRenderTime = journal.average();
+        row.maximumRenderTime = journal.maximum();
+        rows.append(row);
+
+        // keep the last presentation timestamp so the next interval is measured correctly
+        Timing next;
+        next.lastPresentation = timing.lastPresentation;
+        timings.insert(loop, next);
+    }
+    // drops the render loops of outputs that went away
+    m_timings = timings;
+
+    if (rows.count() != m_rows.count()) {
+        beginResetModel();
+        m_rows = rows;
+        endResetModel();
+    } else {
+        m_rows = rows;
+        if (!m_rows.isEmpty()) {
+            Q_EMIT dataChanged(index(0, 0), index(m_rows.count() - 1, columnCount() - 1), {Qt::DisplayRole});
+        }
+    }
+}
 }
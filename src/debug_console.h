@@ -11,19 +11,25 @@
 
 #include "input.h"
 #include "input_event_spy.h"
+#include "inputlatencymonitor.h"
+#include "wayland/clientconnection.h"
 #include <config-kwin.h>
 #include <kwin_export.h>
 
 #include <QAbstractItemModel>
+#include <QSet>
 #include <QStyledItemDelegate>
 #include <QVector>
+#include <chrono>
 #include <functional>
 
 class QTextEdit;
+class QTimer;
 
 namespace KWaylandServer
 {
 class AbstractDataSource;
+class SurfaceInterface;
 }
 
 namespace Ui
@@ -40,6 +46,7 @@ class InternalWindow;
 class Unmanaged;
 class DebugConsoleFilter;
 class WaylandWindow;
+class RenderLoop;
 
 class KWIN_EXPORT DebugConsoleModel : public QAbstractItemModel
 {
@@ -53,6 +60,9 @@ public:
     QModelIndex index(int row, int column, const QModelIndex &parent) const override;
     int rowCount(const QModelIndex &parent) const override;
     QModelIndex parent(const QModelIndex &child) const override;
+    bool hasChildren(const QModelIndex &parent) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
 
 private Q_SLOTS:
     void handleWindowAdded(Window *window);
@@ -76,12 +86,15 @@ private:
     InternalWindow *internalWindow(const QModelIndex &index) const;
     X11Window *x11Window(const QModelIndex &index) const;
     Unmanaged *unmanaged(const QModelIndex &index) const;
+    QObject *windowObject(const QModelIndex &index) const;
     int topLevelRowCount() const;
 
     QVector<WaylandWindow *> m_waylandWindows;
     QVector<InternalWindow *> m_internalWindows;
     QVector<X11Window *> m_x11Windows;
     QVector<Unmanaged *> m_unmanageds;
+    // windows whose properties have been expanded in the view
+    QSet<QObject *> m_fetchedWindows;
 };
 
 class DebugConsoleDelegate : public QStyledItemDelegate
@@ -110,6 +123,10 @@ private:
 
     QScopedPointer<Ui::DebugConsole> m_ui;
     QScopedPointer<DebugConsoleFilter> m_inputFilter;
+    QTimer *m_clientStatisticsTimer = nullptr;
+    QTimer *m_inputLatencyTimer = nullptr;
+    QTimer *m_gpuMemoryTimer = nullptr;
+    QTimer *m_frameTimingTimer = nullptr;
 };
 
 class SurfaceTreeModel : public QAbstractItemModel
@@ -124,6 +141,16 @@ public:
     QModelIndex index(int row, int column, const QModelIndex &parent) const override;
     int rowCount(const QModelIndex &parent) const override;
     QModelIndex parent(const QModelIndex &child) const override;
+    bool hasChildren(const QModelIndex &parent) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+private:
+    void scheduleReset();
+
+    // windows whose sub-surfaces have been expanded and are being monitored
+    QSet<KWaylandServer::SurfaceInterface *> m_fetchedSurfaces;
+    bool m_resetScheduled = false;
 };
 
 class DebugConsoleFilter : public InputEventSpy
@@ -203,6 +230,89 @@ private:
     KWaylandServer::AbstractDataSource *m_source = nullptr;
     QVector<QByteArray> m_data;
 };
+
+class ClientStatisticsModel : public QAbstractTableModel
+{
+public:
+    using QAbstractTableModel::QAbstractTableModel;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void refresh();
+
+private:
+    QVector<KWaylandServer::ClientConnection *> m_clients;
+    QVector<KWaylandServer::ClientStatistics> m_statistics;
+};
+
+class InputLatencyModel : public QAbstractTableModel
+{
+public:
+    using QAbstractTableModel::QAbstractTableModel;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void refresh();
+
+private:
+    QVector<QString> m_outputs;
+    QVector<InputLatencyMonitor::Statistics> m_statistics;
+};
+
+class GpuMemoryModel : public QAbstractTableModel
+{
+public:
+    using QAbstractTableModel::QAbstractTableModel;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void refresh();
+};
+
+class FrameTimingModel : public QAbstractTableModel
+{
+public:
+    using QAbstractTableModel::QAbstractTableModel;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void refresh();
+
+private:
+    struct Timing
+    {
+        std::chrono::nanoseconds lastPresentation = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds longestInterval = std::chrono::nanoseconds::zero();
+        int frames = 0;
+    };
+    struct Row
+    {
+        QString output;
+        int refreshRate = 0;
+        int frames = 0;
+        std::chrono::nanoseconds longestInterval = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds averageRenderTime = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds maximumRenderTime = std::chrono::nanoseconds::zero();
+    };
+
+    void handleFramePresented(RenderLoop *loop, std::chrono::nanoseconds timestamp);
+
+    // accumulated since the last refresh
+    QHash<RenderLoop *, Timing> m_timings;
+    QVector<Row> m_rows;
+};
 }
 
 #endif
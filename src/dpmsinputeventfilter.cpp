@@ -20,7 +20,7 @@ namespace KWin
 {
 
 DpmsInputEventFilter::DpmsInputEventFilter()
-    : InputEventFilter()
+    : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::WheelEvents | InputRedirection::KeyboardEvents | InputRedirection::TouchEvents)
 {
     KSharedConfig::Ptr kwinSettings = kwinApp()->config();
     m_enableDoubleTap = kwinSettings->group("Wayland").readEntry<bool>("DoubleTapWakeup", true);
@@ -13,6 +13,7 @@
 // KWin
 #include "plugin.h"
 #include "scripting/scriptedeffect.h"
+#include "startuptracer.h"
 #include "utils/common.h"
 #include <kwineffects.h>
 // KDE
@@ -24,6 +25,7 @@
 #include <QFutureWatcher>
 #include <QStaticPlugin>
 #include <QStringList>
+#include <QtConcurrentMap>
 #include <QtConcurrentRun>
 
 namespace KWin
@@ -127,6 +129,7 @@ bool ScriptedEffectLoader::loadEffect(const KPluginMetaData &effect, LoadEffectF
         return false;
     }
 
+    StartupPhase phase(QByteArrayLiteral("Effect ") + name.toUtf8());
     ScriptedEffect *e = ScriptedEffect::create(effect);
     if (!e) {
         qCDebug(KWIN_CORE) << "Could not initialize scripted effect: " << name;
@@ -310,6 +313,7 @@ bool PluginEffectLoader::loadEffect(const KPluginMetaData &info, LoadEffectFlags
     }
 
     // ok, now we can try to create the Effect
+    StartupPhase phase(QByteArrayLiteral("Effect ") + name.toUtf8());
     Effect *e = effectFactory->createEffect();
     if (!e) {
         qCDebug(KWIN_CORE) << "Failed to create effect: " << name;
@@ -327,13 +331,60 @@ bool PluginEffectLoader::loadEffect(const KPluginMetaData &info, LoadEffectFlags
 
 void PluginEffectLoader::queryAndLoadAll()
 {
-    const auto effects = findAllEffects();
-    for (const auto &effect : effects) {
-        const LoadEffectFlags flags = readConfig(effect.pluginId(), effect.isEnabledByDefault());
-        if (flags.testFlag(LoadEffectFlag::Load)) {
-            loadEffect(effect, flags);
-        }
+    if (m_queryConnection) {
+        return;
     }
+    // the effects may only be created after the first frame, keep the startup trace open until then
+    StartupTracer::self()->begin(QByteArrayLiteral("Binary effect loading"));
+    // scan the plugin directories in a thread, the config is read on the main thread
+    QFutureWatcher<QVector<KPluginMetaData>> *watcher = new QFutureWatcher<QVector<KPluginMetaData>>(this);
+    m_queryConnection = connect(
+        watcher, &QFutureWatcher<QVector<KPluginMetaData>>::finished, this, [this, watcher]() {
+            const auto effects = watcher->result();
+            watcher->deleteLater();
+
+            QVector<QPair<KPluginMetaData, LoadEffectFlags>> effectsToLoad;
+            for (const auto &effect : effects) {
+                const LoadEffectFlags flags = readConfig(effect.pluginId(), effect.isEnabledByDefault());
+                if (flags.testFlag(LoadEffectFlag::Load)) {
+                    effectsToLoad.append(qMakePair(effect, flags));
+                }
+            }
+            preloadAndLoadEffects(effectsToLoad);
+        },
+        Qt::QueuedConnection);
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    watcher->setFuture(QtConcurrent::run(this, &PluginEffectLoader::findAllEffects));
+#else
+    watcher->setFuture(QtConcurrent::run(&PluginEffectLoader::findAllEffects, this));
+#endif
+}
+
+static bool preloadEffectLibrary(const QPair<KPluginMetaData, LoadEffectFlags> &effect)
+{
+    if (effect.first.isStaticPlugin()) {
+        return true;
+    }
+    // the library stays loaded when the loader goes away
+    return QPluginLoader(effect.first.fileName()).load();
+}
+
+void PluginEffectLoader::preloadAndLoadEffects(const QVector<QPair<KPluginMetaData, LoadEffectFlags>> &effectsToLoad)
+{
+    // Mapping the libraries is done in a thread as well. The factories must be instantiated
+    // on the main thread though, so loadEffect() picks them up once the libraries are loaded.
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    m_queryConnection = connect(
+        watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, effectsToLoad]() {
+            watcher->deleteLater();
+            m_queryConnection = QMetaObject::Connection();
+            for (const auto &effect : effectsToLoad) {
+                loadEffect(effect.first, effect.second);
+            }
+            StartupTracer::self()->end(QByteArrayLiteral("Binary effect loading"));
+        },
+        Qt::QueuedConnection);
+    watcher->setFuture(QtConcurrent::mapped(effectsToLoad, preloadEffectLibrary));
 }
 
 QVector<KPluginMetaData> PluginEffectLoader::findAllEffects() const
@@ -348,6 +399,11 @@ void PluginEffectLoader::setPluginSubDirectory(const QString &directory)
 
 void PluginEffectLoader::clear()
 {
+    if (m_queryConnection) {
+        StartupTracer::self()->end(QByteArrayLiteral("Binary effect loading"));
+    }
+    disconnect(m_queryConnection);
+    m_queryConnection = QMetaObject::Connection();
 }
 
 EffectLoader::EffectLoader(QObject *parent)
@@ -318,8 +318,10 @@ private:
     QVector<KPluginMetaData> findAllEffects() const;
     KPluginMetaData findEffect(const QString &name) const;
     EffectPluginFactory *factory(const KPluginMetaData &info) const;
+    void preloadAndLoadEffects(const QVector<QPair<KPluginMetaData, LoadEffectFlags>> &effectsToLoad);
     QStringList m_loadedEffects;
     QString m_pluginSubDirectory;
+    QMetaObject::Connection m_queryConnection;
 };
 
 class KWIN_EXPORT EffectLoader : public AbstractEffectLoader
@@ -0,0 +1,340 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "effectprofiler.h"
+
+#include "kwinglplatform.h"
+#include "kwinglutils.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+namespace KWin
+{
+
+// Never wait for the GPU, drop the samples if they are still not available after this many frames
+static const int s_maxPendingGpuFrames = 4;
+
+RollingHistogram::RollingHistogram()
+{
+    m_bins.fill(0);
+}
+
+int RollingHistogram::binOf(std::chrono::nanoseconds sample)
+{
+    return int(std::clamp<qint64>(sample / s_binWidth, 0, s_binCount - 1));
+}
+
+void RollingHistogram::add(std::chrono::nanoseconds sample)
+{
+    if (m_count == s_windowSize) {
+        const std::chrono::nanoseconds evicted = m_samples[m_next];
+        m_bins[binOf(evicted)]--;
+        m_sum -= evicted;
+    } else {
+        m_count++;
+    }
+
+    m_samples[m_next] = sample;
+    m_bins[binOf(sample)]++;
+    m_sum += sample;
+    m_next = (m_next + 1) % s_windowSize;
+}
+
+void RollingHistogram::clear()
+{
+    m_bins.fill(0);
+    m_sum = std::chrono::nanoseconds::zero();
+    m_next = 0;
+    m_count = 0;
+}
+
+int RollingHistogram::count() const
+{
+    return m_count;
+}
+
+std::chrono::nanoseconds RollingHistogram::average() const
+{
+    if (!m_count) {
+        return std::chrono::nanoseconds::zero();
+    }
+    return m_sum / m_count;
+}
+
+std::chrono::nanoseconds RollingHistogram::percentile(int percentile) const
+{
+    if (!m_count) {
+        return std::chrono::nanoseconds::zero();
+    }
+
+    const int threshold = std::max(1, (m_count * qBound(0, percentile, 100) + 99) / 100);
+    int accumulated = 0;
+    for (int i = 0; i < s_binCount; ++i) {
+        accumulated += m_bins[i];
+        if (accumulated >= threshold) {
+            return s_binWidth * (i + 1);
+        }
+    }
+    return s_binWidth * s_binCount;
+}
+
+EffectProfiler::EffectProfiler()
+{
+}
+
+EffectProfiler::~EffectProfiler() = default;
+
+void EffectProfiler::destroyQueries()
+{
+    setEnabled(false);
+    if (!m_allQueries.isEmpty()) {
+        glDeleteQueries(m_allQueries.count(), m_allQueries.constData());
+        m_allQueries.clear();
+        m_freeQueries.clear();
+    }
+}
+
+bool EffectProfiler::isEnabled() const
+{
+    return m_enabled;
+}
+
+void EffectProfiler::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled) {
+        return;
+    }
+    m_enabled = enabled;
+    m_gpuSupported = enabled && effects->isOpenGLCompositing() && GLRenderTimeQuery::supported();
+
+    m_frameCpuCosts.clear();
+    m_nestedTime = std::chrono::nanoseconds::zero();
+    for (const QVector<GpuSample> &frame : m_pendingGpuFrames) {
+        for (const GpuSample &sample : frame) {
+            m_freeQueries << sample.begin << sample.end;
+        }
+    }
+    m_pendingGpuFrames.clear();
+    for (const GpuSample &sample : qAsConst(m_gpuSamples)) {
+        m_freeQueries << sample.begin << sample.end;
+    }
+    m_gpuSamples.clear();
+    m_currentGpuSample = -1;
+}
+
+int EffectProfiler::hookIndex(Effect::PaintHook hook)
+{
+    return qCountTrailingZeroBits(quint32(hook));
+}
+
+QString EffectProfiler::hookName(int index)
+{
+    static const char *const names[hookCount] = {
+        "prePaintScreen",
+        "paintScreen",
+        "postPaintScreen",
+        "prePaintWindow",
+        "paintWindow",
+        "postPaintWindow",
+        "drawWindow",
+    };
+    return QString::fromLatin1(names[index]);
+}
+
+bool EffectProfiler::tracksGpuTime(int hook) const
+{
+    // The other hooks don't issue any rendering commands
+    return m_gpuSupported
+        && (hook == hookIndex(Effect::PaintScreenHook)
+            || hook == hookIndex(Effect::PaintWindowHook)
+            || hook == hookIndex(Effect::DrawWindowHook));
+}
+
+GLuint EffectProfiler::takeQuery()
+{
+    if (m_freeQueries.isEmpty()) {
+        GLuint queries[16];
+        glGenQueries(16, queries);
+        for (GLuint query : queries) {
+            m_freeQueries << query;
+            m_allQueries << query;
+        }
+    }
+    return m_freeQueries.takeLast();
+}
+
+EffectProfiler::Measurement EffectProfiler::begin(Effect *effect, Effect::PaintHook hook)
+{
+    Measurement measurement;
+    measurement.effect = effect;
+    measurement.hook = hookIndex(hook);
+    measurement.gpuSample = -1;
+
+    if (tracksGpuTime(measurement.hook)) {
+        if (m_currentGpuSample == -1 && m_gpuSamples.isEmpty()) {
+            // The context is only guaranteed to be current while painting
+            resolveGpuFrames();
+        }
+        GpuSample sample;
+        sample.effect = effect;
+        sample.hook = measurement.hook;
+        sample.parent = m_currentGpuSample;
+        sample.discarded = false;
+        sample.begin = takeQuery();
+        sample.end = takeQuery();
+        glQueryCounter(sample.begin, GL_TIMESTAMP);
+        measurement.gpuSample = m_gpuSamples.count();
+        m_currentGpuSample = measurement.gpuSample;
+        m_gpuSamples.append(sample);
+    }
+
+    // The effect calls the next effect from within the hook, the time spent there is subtracted
+    measurement.nestedTime = m_nestedTime;
+    m_nestedTime = std::chrono::nanoseconds::zero();
+    measurement.start = std::chrono::steady_clock::now();
+    return measurement;
+}
+
+void EffectProfiler::end(const Measurement &measurement)
+{
+    const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - measurement.start;
+
+    FrameCost &cost = m_frameCpuCosts[measurement.effect];
+    cost.time[measurement.hook] += std::max(elapsed - m_nestedTime, std::chrono::nanoseconds::zero());
+    cost.called[measurement.hook] = true;
+    m_statistics[measurement.effect].hooks[measurement.hook].calls++;
+
+    m_nestedTime = measurement.nestedTime + elapsed;
+
+    if (measurement.gpuSample != -1) {
+        const GpuSample &sample = m_gpuSamples[measurement.gpuSample];
+        glQueryCounter(sample.end, GL_TIMESTAMP);
+        m_currentGpuSample = sample.parent;
+    }
+}
+
+void EffectProfiler::beginFrame()
+{
+    for (const auto &[effect, cost] : m_frameCpuCosts) {
+        Statistics &statistics = m_statistics[effect];
+        for (int i = 0; i < hookCount; ++i) {
+            if (cost.called[i]) {
+                statistics.hooks[i].cpu.add(cost.time[i]);
+            }
+        }
+    }
+    m_frameCpuCosts.clear();
+    m_nestedTime = std::chrono::nanoseconds::zero();
+
+    if (!m_gpuSamples.isEmpty()) {
+        m_pendingGpuFrames.push_back(m_gpuSamples);
+        m_gpuSamples.clear();
+    }
+    m_currentGpuSample = -1;
+}
+
+void EffectProfiler::resolveGpuFrames()
+{
+    while (!m_pendingGpuFrames.empty()) {
+        const QVector<GpuSample> frame = m_pendingGpuFrames.front();
+
+        // The outermost sample that started last is the one that finished last
+        auto last = std::find_if(frame.crbegin(), frame.crend(), [](const GpuSample &sample) {
+            return sample.parent == -1;
+        });
+        GLint available = 0;
+        glGetQueryObjectiv(last->end, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available && int(m_pendingGpuFrames.size()) <= s_maxPendingGpuFrames) {
+            return;
+        }
+        m_pendingGpuFrames.pop_front();
+
+        bool disjoint = false;
+        if (available && GLPlatform::instance()->isGLES()) {
+            GLint value = 0;
+            glGetIntegerv(GL_GPU_DISJOINT_EXT, &value);
+            disjoint = value;
+        }
+
+        if (available && !disjoint) {
+            QVector<std::chrono::nanoseconds> durations(frame.count());
+            for (int i = 0; i < frame.count(); ++i) {
+                GLuint64 begin = 0;
+                GLuint64 end = 0;
+                glGetQueryObjectui64v(frame[i].begin, GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(frame[i].end, GL_QUERY_RESULT, &end);
+                durations[i] = std::chrono::nanoseconds(end > begin ? end - begin : 0);
+            }
+
+            QVector<std::chrono::nanoseconds> selfTimes = durations;
+            for (int i = 0; i < frame.count(); ++i) {
+                if (frame[i].parent != -1) {
+                    selfTimes[frame[i].parent] -= durations[i];
+                }
+            }
+
+            std::unordered_map<Effect *, FrameCost> costs;
+            for (int i = 0; i < frame.count(); ++i) {
+                if (frame[i].discarded) {
+                    continue;
+                }
+                FrameCost &cost = costs[frame[i].effect];
+                cost.time[frame[i].hook] += std::max(selfTimes[i], std::chrono::nanoseconds::zero());
+                cost.called[frame[i].hook] = true;
+            }
+            for (const auto &[effect, cost] : costs) {
+                Statistics &statistics = m_statistics[effect];
+                for (int i = 0; i < hookCount; ++i) {
+                    if (cost.called[i]) {
+                        statistics.hooks[i].gpu.add(cost.time[i]);
+                    }
+                }
+            }
+        }
+
+        for (const GpuSample &sample : frame) {
+            m_freeQueries << sample.begin << sample.end;
+        }
+    }
+}
+
+const EffectProfiler::Statistics *EffectProfiler::statistics(Effect *effect) const
+{
+    auto it = m_statistics.find(effect);
+    if (it == m_statistics.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void EffectProfiler::removeEffect(Effect *effect)
+{
+    m_statistics.erase(effect);
+    m_frameCpuCosts.erase(effect);
+
+    // The pending GPU samples can't be dropped without breaking the parent links
+    auto forget = [effect](QVector<GpuSample> &samples) {
+        for (GpuSample &sample : samples) {
+            if (sample.effect == effect) {
+                sample.discarded = true;
+            }
+        }
+    };
+    for (QVector<GpuSample> &frame : m_pendingGpuFrames) {
+        forget(frame);
+    }
+    forget(m_gpuSamples);
+}
+
+void EffectProfiler::reset()
+{
+    m_statistics.clear();
+}
+
+} // namespace KWin
@@ -0,0 +1,169 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwineffects.h"
+
+#include <epoxy/gl.h>
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <unordered_map>
+
+namespace KWin
+{
+
+/**
+ * The RollingHistogram class keeps a histogram of the most recent samples.
+ */
+class KWIN_EXPORT RollingHistogram
+{
+public:
+    RollingHistogram();
+
+    void add(std::chrono::nanoseconds sample);
+    void clear();
+
+    int count() const;
+    std::chrono::nanoseconds average() const;
+    /**
+     * Returns the upper bound of the bin that @a percentile percent of the samples fit in.
+     */
+    std::chrono::nanoseconds percentile(int percentile) const;
+
+private:
+    static constexpr std::chrono::nanoseconds s_binWidth = std::chrono::microseconds(50);
+    static constexpr int s_binCount = 400;
+    static constexpr int s_windowSize = 256;
+
+    static int binOf(std::chrono::nanoseconds sample);
+
+    std::array<quint16, s_binCount> m_bins;
+    std::array<std::chrono::nanoseconds, s_windowSize> m_samples;
+    std::chrono::nanoseconds m_sum = std::chrono::nanoseconds::zero();
+    int m_next = 0;
+    int m_count = 0;
+};
+
+/**
+ * The EffectProfiler class measures how much CPU and GPU time the paint hooks of every
+ * effect take. The time spent further down the effect chain is not attributed to the
+ * caller. The final calls into the scene are recorded with a null effect.
+ *
+ * Samples are aggregated per frame and fed into rolling histograms. GPU times are read
+ * back from timer queries a few frames later, so they lag behind the CPU times.
+ */
+class KWIN_EXPORT EffectProfiler
+{
+public:
+    static constexpr int hookCount = 7;
+
+    struct HookStatistics
+    {
+        RollingHistogram cpu;
+        RollingHistogram gpu;
+        quint64 calls = 0;
+    };
+
+    struct Statistics
+    {
+        std::array<HookStatistics, hookCount> hooks;
+    };
+
+    EffectProfiler();
+    ~EffectProfiler();
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+
+    /**
+     * Deletes the GPU timer queries. Must be called with the OpenGL context current before
+     * the profiler is destroyed, the destructor doesn't touch the OpenGL context.
+     */
+    void destroyQueries();
+
+    /**
+     * Commits the samples of the previous frame. Must be called before the effect chain
+     * of a new frame is walked.
+     */
+    void beginFrame();
+
+    template<typename Function>
+    void measure(Effect *effect, Effect::PaintHook hook, Function &&function);
+
+    /**
+     * Returns the statistics of the given @a effect, or @c null if it has not been profiled.
+     */
+    const Statistics *statistics(Effect *effect) const;
+    void removeEffect(Effect *effect);
+    void reset();
+
+    static int hookIndex(Effect::PaintHook hook);
+    static QString hookName(int index);
+
+private:
+    struct Measurement
+    {
+        Effect *effect;
+        int hook;
+        std::chrono::nanoseconds nestedTime;
+        std::chrono::steady_clock::time_point start;
+        int gpuSample;
+    };
+
+    struct GpuSample
+    {
+        Effect *effect;
+        int hook;
+        int parent;
+        GLuint begin;
+        GLuint end;
+        bool discarded;
+    };
+
+    struct FrameCost
+    {
+        std::array<std::chrono::nanoseconds, hookCount> time{};
+        std::array<bool, hookCount> called{};
+    };
+
+    Measurement begin(Effect *effect, Effect::PaintHook hook);
+    void end(const Measurement &measurement);
+
+    bool tracksGpuTime(int hook) const;
+    GLuint takeQuery();
+    void resolveGpuFrames();
+
+    bool m_enabled = false;
+    bool m_gpuSupported = false;
+
+    std::chrono::nanoseconds m_nestedTime = std::chrono::nanoseconds::zero();
+    std::unordered_map<Effect *, FrameCost> m_frameCpuCosts;
+    std::unordered_map<Effect *, Statistics> m_statistics;
+
+    QVector<GpuSample> m_gpuSamples;
+    int m_currentGpuSample = -1;
+    std::deque<QVector<GpuSample>> m_pendingGpuFrames;
+    QVector<GLuint> m_freeQueries;
+    QVector<GLuint> m_allQueries;
+};
+
+template<typename Function>
+void EffectProfiler::measure(Effect *effect, Effect::PaintHook hook, Function &&function)
+{
+    if (Q_LIKELY(!m_enabled)) {
+        function();
+        return;
+    }
+    const Measurement measurement = begin(effect, hook);
+    function();
+    end(measurement);
+}
+
+} // namespace KWin
@@ -13,6 +13,7 @@
 #include <config-kwin.h>
 
 #include "effectloader.h"
+#include "effectprofiler.h"
 #include "effectsadaptor.h"
 #include "output.h"
 #if KWIN_BUILD_ACTIVITIES
@@ -88,6 +89,64 @@ static QByteArray readWindowProperty(xcb_window_t win, xcb_atom_t atom, xcb_atom
     }
 }
 
+/**
+ * Keeps the replies for the properties that effects have registered on one X11 window.
+ *
+ * The requests are sent as soon as the window is known or a property changes, and the
+ * reply is only collected when an effect reads the property, by which time it usually has
+ * already arrived. Atoms that are not registered don't get PropertyNotify forwarded, so
+ * they are never cached and always read directly.
+ */
+class X11PropertyCache
+{
+public:
+    explicit X11PropertyCache(xcb_window_t window)
+        : m_window(window)
+    {
+    }
+
+    void prefetch(xcb_atom_t atom)
+    {
+        if (m_window == XCB_WINDOW_NONE) {
+            return;
+        }
+        m_properties.erase(atom);
+        m_properties.emplace(std::piecewise_construct,
+                             std::forward_as_tuple(atom),
+                             std::forward_as_tuple(false, m_window, atom, XCB_ATOM_ANY, 0, 32768));
+    }
+
+    void invalidate(xcb_atom_t atom)
+    {
+        m_properties.erase(atom);
+    }
+
+    QByteArray read(xcb_atom_t atom, xcb_atom_t type, int format)
+    {
+        auto it = m_properties.find(atom);
+        if (it == m_properties.end()) {
+            prefetch(atom);
+            it = m_properties.find(atom);
+            if (it == m_properties.end()) {
+                return QByteArray();
+            }
+        }
+        Xcb::Property &prop = it->second;
+        if (prop.isNull()) {
+            return QByteArray();
+        }
+        if (prop->bytes_after > 0) {
+            // Too large for the initial request, which is rare enough to not be worth caching.
+            return readWindowProperty(m_window, atom, type, format);
+        }
+        return prop.toByteArray(format, type);
+    }
+
+private:
+    xcb_window_t m_window;
+    std::unordered_map<xcb_atom_t, Xcb::Property> m_properties;
+};
+
 static void deleteWindowProperty(xcb_window_t win, long int atom)
 {
     if (win == XCB_WINDOW_NONE) {
@@ -126,6 +185,7 @@ EffectsHandlerImpl::EffectsHandlerImpl(Compositor *compositor, Scene *scene)
     , m_scene(scene)
     , m_effectLoader(new EffectLoader(this))
     , m_trackingCursorChanges(0)
+    , m_profiler(std::make_unique<EffectProfiler>())
 {
     qRegisterMetaType<QVector<KWin::EffectWindow *>>();
     connect(m_effectLoader, &AbstractEffectLoader::effectLoaded, this, [this](Effect *effect, const QString &name) {
@@ -134,6 +194,7 @@ EffectsHandlerImpl::EffectsHandlerImpl(Compositor *compositor, Scene *scene)
         effectsChanged();
     });
     m_effectLoader->setConfig(kwinApp()->config());
+    m_profiler->setEnabled(qEnvironmentVariableIntValue("KWIN_EFFECT_PROFILING") == 1);
     new EffectsAdaptor(this);
     QDBusConnection dbus = QDBusConnection::sessionBus();
     dbus.registerObject(QStringLiteral("/Effects"), this);
@@ -213,12 +274,14 @@ EffectsHandlerImpl::EffectsHandlerImpl(Compositor *compositor, Scene *scene)
     connect(tabBox, &TabBox::TabBox::tabBoxKeyEvent, this, &EffectsHandler::tabBoxKeyEvent);
 #endif
     connect(ScreenEdges::self(), &ScreenEdges::approaching, this, &EffectsHandler::screenEdgeApproaching);
+    connect(m_compositor, &Compositor::sleepingChanged, this, &EffectsHandler::sleepingChanged);
 #if KWIN_BUILD_SCREENLOCKER
     connect(ScreenLockerWatcher::self(), &ScreenLockerWatcher::locked, this, &EffectsHandler::screenLockingChanged);
     connect(ScreenLockerWatcher::self(), &ScreenLockerWatcher::aboutToLock, this, &EffectsHandler::screenAboutToLock);
 #endif
 
     connect(kwinApp(), &Application::x11ConnectionChanged, this, [this]() {
+        m_rootPropertyCache.reset();
         registered_atoms.clear();
         for (auto it = m_propertiesForEffects.keyBegin(); it != m_propertiesForEffects.keyEnd(); it++) {
             const auto atom = registerSupportProperty(*it);
@@ -272,6 +335,12 @@ EffectsHandlerImpl::EffectsHandlerImpl(Compositor *compositor, Scene *scene)
 EffectsHandlerImpl::~EffectsHandlerImpl()
 {
     unloadAllEffects();
+
+    // the profiler owns GPU timer queries, they're gone with the context otherwise
+    if (makeOpenGLContextCurrent()) {
+        m_profiler->destroyQueries();
+    }
+    m_profiler.reset();
 }
 
 void EffectsHandlerImpl::unloadAllEffects()
@@ -362,63 +431,203 @@ void EffectsHandlerImpl::reconfigure()
     m_effectLoader->queryAndLoadAll();
 }
 
+/**
+ * Advances an effect chain cursor by one effect for the duration of a hook call.
+ *
+ * The chains of window hooks differ per window. A nested call for another window than the
+ * one of the caller switches to the chain of that window for its duration, and carries on
+ * after the calling effect like a nested call for the same window does.
+ */
+class EffectsHandlerImpl::EffectChainStep
+{
+public:
+    explicit EffectChainStep(EffectChainCursor &cursor, EffectWindow *window = nullptr)
+        : m_cursor(cursor)
+        , m_saved(cursor)
+        , m_window(window)
+        , m_outermost(!cursor.effects)
+        , m_otherWindow(cursor.effects && cursor.window != window)
+    {
+    }
+
+    ~EffectChainStep()
+    {
+        if (m_outermost) {
+            m_cursor = EffectChainCursor();
+        } else if (m_otherWindow) {
+            m_cursor = m_saved;
+        } else if (m_advanced) {
+            --m_cursor.current;
+        }
+    }
+
+    /**
+     * Returns whether the chain has to be picked with start().
+     */
+    bool needsChain() const
+    {
+        return m_outermost || m_otherWindow;
+    }
+
+    /**
+     * Starts walking @p effects. The effects are in the order of @p order, which is needed
+     * to find the effects after the caller of a nested call for another window.
+     */
+    void start(const EffectsList &effects, const EffectsList &order = EffectsList())
+    {
+        m_cursor.effects = &effects;
+        m_cursor.current = effects.constBegin();
+        m_cursor.window = m_window;
+        if (m_otherWindow && m_saved.current != m_saved.effects->constBegin()) {
+            const int caller = order.indexOf(*(m_saved.current - 1));
+            while (m_cursor.current != effects.constEnd() && order.indexOf(*m_cursor.current) <= caller) {
+                ++m_cursor.current;
+            }
+        }
+    }
+
+    Effect *next()
+    {
+        if (m_cursor.current == m_cursor.effects->constEnd()) {
+            return nullptr;
+        }
+        m_advanced = true;
+        return *m_cursor.current++;
+    }
+
+private:
+    EffectChainCursor &m_cursor;
+    const EffectChainCursor m_saved;
+    EffectWindow *const m_window;
+    const bool m_outermost;
+    const bool m_otherWindow;
+    bool m_advanced = false;
+};
+
 // the idea is that effects call this function again which calls the next one
 void EffectsHandlerImpl::prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseconds presentTime)
 {
-    if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
-        (*m_currentPaintScreenIterator++)->prePaintScreen(data, presentTime);
-        --m_currentPaintScreenIterator;
+    EffectChainStep step(m_prePaintScreenCursor);
+    if (step.needsChain()) {
+        step.start(m_prePaintScreenEffects);
+    }
+    if (Effect *effect = step.next()) {
+        m_profiler->measure(effect, Effect::PrePaintScreenHook, [&]() {
+            effect->prePaintScreen(data, presentTime);
+        });
     }
     // no special final code
 }
 
 void EffectsHandlerImpl::paintScreen(int mask, const QRegion &region, ScreenPaintData &data)
 {
-    if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
-        (*m_currentPaintScreenIterator++)->paintScreen(mask, region, data);
-        --m_currentPaintScreenIterator;
+    EffectChainStep step(m_paintScreenCursor);
+    if (step.needsChain()) {
+        step.start(m_paintScreenEffects);
+    }
+    if (Effect *effect = step.next()) {
+        m_profiler->measure(effect, Effect::PaintScreenHook, [&]() {
+            effect->paintScreen(mask, region, data);
+        });
     } else {
-        m_scene->finalPaintScreen(mask, region, data);
+        m_profiler->measure(nullptr, Effect::PaintScreenHook, [&]() {
+            m_scene->finalPaintScreen(mask, region, data);
+        });
     }
 }
 
 void EffectsHandlerImpl::postPaintScreen()
 {
-    if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
-        (*m_currentPaintScreenIterator++)->postPaintScreen();
-        --m_currentPaintScreenIterator;
+    EffectChainStep step(m_postPaintScreenCursor);
+    if (step.needsChain()) {
+        step.start(m_postPaintScreenEffects);
+    }
+    if (Effect *effect = step.next()) {
+        m_profiler->measure(effect, Effect::PostPaintScreenHook, [&]() {
+            effect->postPaintScreen();
+        });
     }
     // no special final code
 }
 
 void EffectsHandlerImpl::prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::chrono::milliseconds presentTime)
 {
-    if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
-        (*m_currentPaintWindowIterator++)->prePaintWindow(w, data, presentTime);
-        --m_currentPaintWindowIterator;
+    EffectChainStep step(m_prePaintWindowCursor, w);
+    if (step.needsChain()) {
+        step.start(windowPaintChain(w).prePaint, m_activeEffects);
+    }
+    if (Effect *effect = step.next()) {
+        m_profiler->measure(effect, Effect::PrePaintWindowHook, [&]() {
+            effect->prePaintWindow(w, data, presentTime);
+        });
     }
     // no special final code
 }
 
 void EffectsHandlerImpl::paintWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data)
 {
-    if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
-        (*m_currentPaintWindowIterator++)->paintWindow(w, mask, region, data);
-        --m_currentPaintWindowIterator;
+    EffectChainStep step(m_paintWindowCursor, w);
+    if (step.needsChain()) {
+        step.start(windowPaintChain(w).paint, m_activeEffects);
+    }
+    if (Effect *effect = step.next()) {
+        m_profiler->measure(effect, Effect::PaintWindowHook, [&]() {
+            effect->paintWindow(w, mask, region, data);
+        });
     } else {
-        m_scene->finalPaintWindow(static_cast<EffectWindowImpl *>(w), mask, region, data);
+        m_profiler->measure(nullptr, Effect::PaintWindowHook, [&]() {
+            m_scene->finalPaintWindow(static_cast<EffectWindowImpl *>(w), mask, region, data);
+        });
     }
 }
 
 void EffectsHandlerImpl::postPaintWindow(EffectWindow *w)
 {
-    if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
-        (*m_currentPaintWindowIterator++)->postPaintWindow(w);
-        --m_currentPaintWindowIterator;
+    EffectChainStep step(m_postPaintWindowCursor, w);
+    if (step.needsChain()) {
+        step.start(windowPaintChain(w).postPaint, m_activeEffects);
+    }
+    if (Effect *effect = step.next()) {
+        m_profiler->measure(effect, Effect::PostPaintWindowHook, [&]() {
+            effect->postPaintWindow(w);
+        });
     }
     // no special final code
 }
 
+const EffectsHandlerImpl::WindowPaintChain &EffectsHandlerImpl::windowPaintChain(EffectWindow *w)
+{
+    auto it = m_windowPaintChains.find(w);
+    if (it != m_windowPaintChains.end()) {
+        return it->second;
+    }
+
+    WindowPaintChain &chain = m_windowPaintChains[w];
+    for (int i = 0; i < m_activeEffects.count(); ++i) {
+        const Effect::PaintHooks hooks = m_activeEffectHooks[i];
+        if (!(hooks & Effect::WindowPaintHooks)) {
+            continue;
+        }
+        Effect *effect = m_activeEffects[i];
+        if (!effect->isActiveForWindow(w)) {
+            continue;
+        }
+        if (hooks & Effect::PrePaintWindowHook) {
+            chain.prePaint.append(effect);
+        }
+        if (hooks & Effect::PaintWindowHook) {
+            chain.paint.append(effect);
+        }
+        if (hooks & Effect::PostPaintWindowHook) {
+            chain.postPaint.append(effect);
+        }
+        if (hooks & Effect::DrawWindowHook) {
+            chain.draw.append(effect);
+        }
+    }
+    return chain;
+}
+
 Effect *EffectsHandlerImpl::provides(Effect::Feature ef)
 {
     for (int i = 0; i < loaded_effects.size(); ++i) {
@@ -431,14 +640,26 @@ Effect *EffectsHandlerImpl::provides(Effect::Feature ef)
 
 void EffectsHandlerImpl::drawWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data)
 {
-    if (m_currentDrawWindowIterator != m_activeEffects.constEnd()) {
-        (*m_currentDrawWindowIterator++)->drawWindow(w, mask, region, data);
-        --m_currentDrawWindowIterator;
+    EffectChainStep step(m_drawWindowCursor, w);
+    if (step.needsChain()) {
+        step.start(windowPaintChain(w).draw, m_activeEffects);
+    }
+    if (Effect *effect = step.next()) {
+        m_profiler->measure(effect, Effect::DrawWindowHook, [&]() {
+            effect->drawWindow(w, mask, region, data);
+        });
     } else {
-        m_scene->finalDrawWindow(static_cast<EffectWindowImpl *>(w), mask, region, data);
+        m_profiler->measure(nullptr, Effect::DrawWindowHook, [&]() {
+            m_scene->finalDrawWindow(static_cast<EffectWindowImpl *>(w), mask, region, data);
+        });
     }
 }
 
+void EffectsHandlerImpl::renderWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data)
+{
+    m_scene->finalDrawWindow(static_cast<EffectWindowImpl *>(w), mask, region, data);
+}
+
 bool EffectsHandlerImpl::hasDecorationShadows() const
 {
     return false;
@@ -452,16 +673,133 @@ bool EffectsHandlerImpl::decorationsHaveAlpha() const
 // start another painting pass
 void EffectsHandlerImpl::startPaint()
 {
+    m_profiler->beginFrame();
+
     m_activeEffects.clear();
+    m_activeEffectHooks.clear();
+    m_prePaintScreenEffects.clear();
+    m_paintScreenEffects.clear();
+    m_postPaintScreenEffects.clear();
+    m_windowPaintChains.clear();
+
     m_activeEffects.reserve(loaded_effects.count());
+    m_activeEffectHooks.reserve(loaded_effects.count());
     for (QVector<KWin::EffectPair>::const_iterator it = loaded_effects.constBegin(); it != loaded_effects.constEnd(); ++it) {
-        if (it->second->isActive()) {
-            m_activeEffects << it->second;
+        Effect *effect = it->second;
+        if (!effect->isActive()) {
+            continue;
+        }
+        const Effect::PaintHooks hooks = effect->paintHooks();
+        m_activeEffects << effect;
+        m_activeEffectHooks << hooks;
+        if (hooks & Effect::PrePaintScreenHook) {
+            m_prePaintScreenEffects << effect;
+        }
+        if (hooks & Effect::PaintScreenHook) {
+            m_paintScreenEffects << effect;
+        }
+        if (hooks & Effect::PostPaintScreenHook) {
+            m_postPaintScreenEffects << effect;
         }
     }
-    m_currentDrawWindowIterator = m_activeEffects.constBegin();
-    m_currentPaintWindowIterator = m_activeEffects.constBegin();
-    m_currentPaintScreenIterator = m_activeEffects.constBegin();
+}
+
+EffectProfiler *EffectsHandlerImpl::profiler() const
+{
+    return m_profiler.get();
+}
+
+void EffectsHandlerImpl::setEffectProfilingEnabled(bool enabled)
+{
+    m_profiler->setEnabled(enabled);
+}
+
+bool EffectsHandlerImpl::isEffectProfilingEnabled() const
+{
+    return m_profiler->isEnabled();
+}
+
+QVector<EffectsHandler::EffectCost> EffectsHandlerImpl::effectCosts() const
+{
+    QVector<EffectCost> costs;
+
+    auto addCost = [this, &costs](const QString &name, Effect *effect) {
+        const EffectProfiler::Statistics *statistics = m_profiler->statistics(effect);
+        if (!statistics) {
+            return;
+        }
+        EffectCost cost;
+        cost.name = name;
+        cost.cpuTime = std::chrono::nanoseconds::zero();
+        cost.gpuTime = std::chrono::nanoseconds::zero();
+        for (const EffectProfiler::HookStatistics &hook : statistics->hooks) {
+            cost.cpuTime += hook.cpu.average();
+            cost.gpuTime += hook.gpu.average();
+        }
+        costs.append(cost);
+    };
+
+    addCost(QString(), nullptr);
+    for (const EffectPair &pair : loaded_effects) {
+        addCost(pair.first, pair.second);
+    }
+
+    std::sort(costs.begin(), costs.end(), [](const EffectCost &a, const EffectCost &b) {
+        return std::max(a.cpuTime, a.gpuTime) > std::max(b.cpuTime, b.gpuTime);
+    });
+    return costs;
+}
+
+bool EffectsHandlerImpl::isSleeping() const
+{
+    return m_compositor->isSleeping();
+}
+
+QVariantMap EffectsHandlerImpl::effectProfile(const QString &name) const
+{
+    Effect *effect = nullptr;
+    if (name != QLatin1String("scene")) {
+        effect = findEffect(name);
+        if (!effect) {
+            return QVariantMap();
+        }
+    }
+    const EffectProfiler::Statistics *statistics = m_profiler->statistics(effect);
+    if (!statistics) {
+        return QVariantMap();
+    }
+
+    auto microseconds = [](std::chrono::nanoseconds duration) {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    };
+
+    QVariantMap profile;
+    for (int i = 0; i < EffectProfiler::hookCount; ++i) {
+        const EffectProfiler::HookStatistics &hook = statistics->hooks[i];
+        if (!hook.calls) {
+            continue;
+        }
+        QVariantMap entry;
+        entry[QStringLiteral("calls")] = hook.calls;
+        entry[QStringLiteral("frames")] = hook.cpu.count();
+        entry[QStringLiteral("cpuAverage")] = microseconds(hook.cpu.average());
+        entry[QStringLiteral("cpuP50")] = microseconds(hook.cpu.percentile(50));
+        entry[QStringLiteral("cpuP95")] = microseconds(hook.cpu.percentile(95));
+        entry[QStringLiteral("cpuP99")] = microseconds(hook.cpu.percentile(99));
+        if (hook.gpu.count()) {
+            entry[QStringLiteral("gpuAverage")] = microseconds(hook.gpu.average());
+            entry[QStringLiteral("gpuP50")] = microseconds(hook.gpu.percentile(50));
+            entry[QStringLiteral("gpuP95")] = microseconds(hook.gpu.percentile(95));
+            entry[QStringLiteral("gpuP99")] = microseconds(hook.gpu.percentile(99));
+        }
+        profile[EffectProfiler::hookName(i)] = entry;
+    }
+    return profile;
+}
+
+void EffectsHandlerImpl::resetEffectProfile()
+{
+    m_profiler->reset();
 }
 
 void EffectsHandlerImpl::slotClientMaximized(Window *window, MaximizeMode maxMode)
@@ -850,10 +1188,25 @@ void EffectsHandlerImpl::registerPropertyType(long atom, bool reg)
     } else {
         if (--registered_atoms[atom] == 0) {
             registered_atoms.remove(atom);
+            // Changes of the atom are not tracked anymore, so the cached values may go stale.
+            if (m_rootPropertyCache) {
+                m_rootPropertyCache->invalidate(atom);
+            }
+            const auto windows = stackingOrder();
+            for (EffectWindow *window : windows) {
+                static_cast<EffectWindowImpl *>(window)->invalidateProperty(atom);
+            }
         }
     }
 }
 
+void EffectsHandlerImpl::invalidateRootProperty(xcb_atom_t atom)
+{
+    if (m_rootPropertyCache) {
+        m_rootPropertyCache->prefetch(atom);
+    }
+}
+
 xcb_atom_t EffectsHandlerImpl::announceSupportProperty(const QByteArray &propertyName, Effect *effect)
 {
     PropertyEffectMap::iterator it = m_propertiesForEffects.find(propertyName);
@@ -903,7 +1256,13 @@ QByteArray EffectsHandlerImpl::readRootProperty(long atom, long type, int format
     if (!kwinApp()->x11Connection()) {
         return QByteArray();
     }
-    return readWindowProperty(kwinApp()->x11RootWindow(), atom, type, format);
+    if (!isPropertyTypeRegistered(atom)) {
+        return readWindowProperty(kwinApp()->x11RootWindow(), atom, type, format);
+    }
+    if (!m_rootPropertyCache) {
+        m_rootPropertyCache = std::make_unique<X11PropertyCache>(kwinApp()->x11RootWindow());
+    }
+    return m_rootPropertyCache->read(atom, type, format);
 }
 
 void EffectsHandlerImpl::activateWindow(EffectWindow *effectWindow)
@@ -1257,6 +1616,18 @@ void EffectsHandlerImpl::addRepaint(int x, int y, int w, int h)
     m_compositor->scene()->addRepaint(x, y, w, h);
 }
 
+QRegion EffectsHandlerImpl::windowScreensArea(const EffectWindow *w) const
+{
+    const QRect geometry = w->expandedGeometry();
+    QRegion area;
+    for (const EffectScreen *screen : m_effectScreens) {
+        if (screen->geometry().intersects(geometry)) {
+            area += screen->geometry();
+        }
+    }
+    return area;
+}
+
 EffectScreen *EffectsHandlerImpl::activeScreen() const
 {
     return EffectScreenImpl::get(workspace()->activeOutput());
@@ -1466,6 +1837,7 @@ void EffectsHandlerImpl::destroyEffect(Effect *effect)
     }
 
     stopMouseInterception(effect);
+    m_profiler->removeEffect(effect);
 
     const QList<QByteArray> properties = m_propertiesForEffects.keys();
     for (const QByteArray &property : properties) {
@@ -1539,7 +1911,13 @@ void EffectsHandlerImpl::reloadEffect(Effect *effect)
 void EffectsHandlerImpl::effectsChanged()
 {
     loaded_effects.clear();
-    m_activeEffects.clear(); // it's possible to have a reconfigure and a quad rebuild between two paint cycles - bug #308201
+    // it's possible to have a reconfigure and a quad rebuild between two paint cycles - bug #308201
+    m_activeEffects.clear();
+    m_activeEffectHooks.clear();
+    m_prePaintScreenEffects.clear();
+    m_paintScreenEffects.clear();
+    m_postPaintScreenEffects.clear();
+    m_windowPaintChains.clear();
 
     loaded_effects.reserve(effect_order.count());
     std::copy(effect_order.constBegin(), effect_order.constEnd(),
@@ -1568,6 +1946,12 @@ bool EffectsHandlerImpl::blocksDirectScanout() const
     });
 }
 
+bool EffectsHandlerImpl::hasWindowPaintEffects(EffectWindow *w)
+{
+    const WindowPaintChain &chain = windowPaintChain(w);
+    return !chain.paint.isEmpty() || !chain.draw.isEmpty();
+}
+
 KWaylandServer::Display *EffectsHandlerImpl::waylandDisplay() const
 {
     if (waylandServer()) {
@@ -1921,6 +2305,18 @@ EffectWindowImpl::EffectWindowImpl(Window *window)
 
     m_waylandWindow = qobject_cast<KWin::WaylandWindow *>(window) != nullptr;
     m_x11Window = qobject_cast<KWin::X11Window *>(window) != nullptr || qobject_cast<KWin::Unmanaged *>(window) != nullptr;
+
+    // Ask for the properties effects care about right away, so reading them later doesn't
+    // have to wait for the X server.
+    if (m_x11Window && kwinApp()->x11Connection()) {
+        m_propertyCache = std::make_unique<X11PropertyCache>(window->window());
+        if (effects) {
+            const auto atoms = static_cast<EffectsHandlerImpl *>(effects)->registeredPropertyTypes();
+            for (long atom : atoms) {
+                m_propertyCache->prefetch(atom);
+            }
+        }
+    }
 }
 
 EffectWindowImpl::~EffectWindowImpl()
@@ -2123,7 +2519,22 @@ QByteArray EffectWindowImpl::readProperty(long atom, long type, int format) cons
     if (!kwinApp()->x11Connection()) {
         return QByteArray();
     }
-    return readWindowProperty(window()->window(), atom, type, format);
+    if (!m_propertyCache || !static_cast<EffectsHandlerImpl *>(effects)->isPropertyTypeRegistered(atom)) {
+        return readWindowProperty(window()->window(), atom, type, format);
+    }
+    return m_propertyCache->read(atom, type, format);
+}
+
+void EffectWindowImpl::invalidateProperty(xcb_atom_t atom)
+{
+    if (!m_propertyCache) {
+        return;
+    }
+    if (static_cast<EffectsHandlerImpl *>(effects)->isPropertyTypeRegistered(atom)) {
+        m_propertyCache->prefetch(atom);
+    } else {
+        m_propertyCache->invalidate(atom);
+    }
 }
 
 void EffectWindowImpl::deleteProperty(long int atom) const
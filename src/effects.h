@@ -20,6 +20,7 @@
 #include <QHash>
 
 #include <memory>
+#include <unordered_map>
 
 class QMouseEvent;
 class QWheelEvent;
@@ -38,9 +39,11 @@ class Window;
 class Compositor;
 class Deleted;
 class EffectLoader;
+class EffectProfiler;
 class Group;
 class Unmanaged;
 class WindowPropertyNotifyX11Filter;
+class X11PropertyCache;
 class TabletEvent;
 class TabletPadId;
 class TabletToolId;
@@ -52,6 +55,7 @@ class KWIN_EXPORT EffectsHandlerImpl : public EffectsHandler
     Q_PROPERTY(QStringList activeEffects READ activeEffects)
     Q_PROPERTY(QStringList loadedEffects READ loadedEffects)
     Q_PROPERTY(QStringList listOfEffects READ listOfEffects)
+    Q_PROPERTY(bool profilingEnabled READ isEffectProfilingEnabled WRITE setEffectProfilingEnabled)
 public:
     EffectsHandlerImpl(Compositor *compositor, Scene *scene);
     ~EffectsHandlerImpl() override;
@@ -65,6 +69,7 @@ public:
     Effect *provides(Effect::Feature ef);
 
     void drawWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data) override;
+    void renderWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data) override;
 
     void activateWindow(EffectWindow *c) override;
     EffectWindow *activeWindow() const override;
@@ -136,6 +141,7 @@ public:
     void addRepaint(const QRect &r) override;
     void addRepaint(const QRegion &r) override;
     void addRepaint(int x, int y, int w, int h) override;
+    QRegion windowScreensArea(const EffectWindow *w) const override;
     EffectScreen *activeScreen() const override;
     QRect clientArea(clientAreaOption, const EffectScreen *screen, int desktop) const override;
     QRect clientArea(clientAreaOption, const EffectWindow *c) const override;
@@ -195,6 +201,12 @@ public:
      */
     bool blocksDirectScanout() const;
 
+    /**
+     * @returns whether any effect in the current painting pass can intercept the painting
+     * of the window @p w, in which case the window must be painted on its own
+     */
+    bool hasWindowPaintEffects(EffectWindow *w);
+
     KWaylandServer::Display *waylandDisplay() const override;
 
     bool animationsSupported() const override;
@@ -234,6 +246,14 @@ public:
     {
         return registered_atoms.contains(atom);
     }
+    QList<long> registeredPropertyTypes() const
+    {
+        return registered_atoms.keys();
+    }
+    /**
+     * Drops the cached value of @p atom on the root window and requests it again.
+     */
+    void invalidateRootProperty(xcb_atom_t atom);
 
     void windowToDesktops(EffectWindow *w, const QVector<uint> &desktops) override;
 
@@ -261,6 +281,17 @@ public:
     KWin::EffectWindow *inputPanel() const override;
     bool isInputPanelOverlay() const override;
 
+    void setEffectProfilingEnabled(bool enabled) override;
+    bool isEffectProfilingEnabled() const override;
+    QVector<EffectCost> effectCosts() const override;
+
+    bool isSleeping() const override;
+
+    /**
+     * Returns the profiler that measures the paint hooks of the effects.
+     */
+    EffectProfiler *profiler() const;
+
 public Q_SLOTS:
     void slotCurrentTabAboutToChange(EffectWindow *from, EffectWindow *to);
     void slotTabAdded(EffectWindow *from, EffectWindow *to);
@@ -271,11 +302,13 @@ public Q_SLOTS:
     Q_SCRIPTABLE bool loadEffect(const QString &name);
     Q_SCRIPTABLE void toggleEffect(const QString &name);
     Q_SCRIPTABLE void unloadEffect(const QString &name);
-    Q_SCRIPTABLE bool isEffectLoaded(const QString &name) const;
+    Q_SCRIPTABLE bool isEffectLoaded(const QString &name) const override;
     Q_SCRIPTABLE bool isEffectSupported(const QString &name);
     Q_SCRIPTABLE QList<bool> areEffectsSupported(const QStringList &names);
     Q_SCRIPTABLE QString supportInformation(const QString &name) const;
     Q_SCRIPTABLE QString debug(const QString &name, const QString &parameter = QString()) const;
+    Q_SCRIPTABLE QVariantMap effectProfile(const QString &name) const;
+    Q_SCRIPTABLE void resetEffectProfile();
 
 protected Q_SLOTS:
     void slotWindowShown(KWin::Window *);
@@ -333,10 +366,47 @@ private:
 
     typedef QVector<Effect *> EffectsList;
     typedef EffectsList::const_iterator EffectsIterator;
+
+    /**
+     * The position in the chain of a paint hook. The outermost call of the hook picks the
+     * chain, calls made by the effects from within the hook continue where the caller is.
+     */
+    struct EffectChainCursor
+    {
+        const EffectsList *effects = nullptr;
+        EffectsIterator current;
+        // the window whose chain is walked, if it's a window hook
+        EffectWindow *window = nullptr;
+    };
+    class EffectChainStep;
+
+    /**
+     * The effects that are involved in painting a window in the current frame.
+     */
+    struct WindowPaintChain
+    {
+        EffectsList prePaint;
+        EffectsList paint;
+        EffectsList postPaint;
+        EffectsList draw;
+    };
+    const WindowPaintChain &windowPaintChain(EffectWindow *w);
+
     EffectsList m_activeEffects;
-    EffectsIterator m_currentDrawWindowIterator;
-    EffectsIterator m_currentPaintWindowIterator;
-    EffectsIterator m_currentPaintScreenIterator;
+    QVector<Effect::PaintHooks> m_activeEffectHooks;
+    EffectsList m_prePaintScreenEffects;
+    EffectsList m_paintScreenEffects;
+    EffectsList m_postPaintScreenEffects;
+    // References to the chains must stay valid when windows are added, hence no QHash
+    std::unordered_map<EffectWindow *, WindowPaintChain> m_windowPaintChains;
+    EffectChainCursor m_prePaintScreenCursor;
+    EffectChainCursor m_paintScreenCursor;
+    EffectChainCursor m_postPaintScreenCursor;
+    EffectChainCursor m_prePaintWindowCursor;
+    EffectChainCursor m_paintWindowCursor;
+    EffectChainCursor m_postPaintWindowCursor;
+    EffectChainCursor m_drawWindowCursor;
+    std::unique_ptr<EffectProfiler> m_profiler;
     typedef QHash<QByteArray, QList<Effect *>> PropertyEffectMap;
     PropertyEffectMap m_propertiesForEffects;
     QHash<QByteArray, qulonglong> m_managedProperties;
@@ -346,6 +416,7 @@ private:
     EffectLoader *m_effectLoader;
     int m_trackingCursorChanges;
     std::unique_ptr<WindowPropertyNotifyX11Filter> m_x11WindowPropertyNotify;
+    mutable std::unique_ptr<X11PropertyCache> m_rootPropertyCache;
     QList<EffectScreen *> m_effectScreens;
 };
 
@@ -501,6 +572,11 @@ public:
     void setData(int role, const QVariant &data) override;
     QVariant data(int role) const override;
 
+    /**
+     * Requests the given property again, called when it changes on the X server.
+     */
+    void invalidateProperty(xcb_atom_t atom); // internal
+
 private:
     Window *m_window;
     WindowItem *m_windowItem; // This one is used only during paint pass.
@@ -508,6 +584,7 @@ private:
     bool managed = false;
     bool m_waylandWindow;
     bool m_x11Window;
+    mutable std::unique_ptr<X11PropertyCache> m_propertyCache;
 };
 
 class EffectWindowGroupImpl
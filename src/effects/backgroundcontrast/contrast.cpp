@@ -466,6 +466,17 @@ bool ContrastEffect::isActive() const
     return !effects->isScreenLocked();
 }
 
+Effect::PaintHooks ContrastEffect::paintHooks() const
+{
+    return DrawWindowHook;
+}
+
+bool ContrastEffect::isActiveForWindow(EffectWindow *w) const
+{
+    // contrastRegion() is empty unless the role is set
+    return w->hasAlpha() && w->data(WindowBackgroundContrastRole).isValid();
+}
+
 bool ContrastEffect::blocksDirectScanout() const
 {
     return false;
@@ -40,6 +40,8 @@ public:
 
     bool provides(Feature feature) override;
     bool isActive() const override;
+    PaintHooks paintHooks() const override;
+    bool isActiveForWindow(EffectWindow *w) const override;
 
     int requestedEffectChainPosition() const override
     {
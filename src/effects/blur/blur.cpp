@@ -21,6 +21,7 @@
 #include <QTime>
 #include <QTimer>
 #include <QWindow>
+#include <algorithm>
 #include <cmath> // for ceil()
 #include <cstdlib>
 
@@ -77,6 +78,15 @@ BlurEffect::BlurEffect()
             net_wm_blur_region = effects->announceSupportProperty(s_blurAtomName, this);
         }
     });
+    // The cached blurs are recomputed the next time the windows are painted
+    connect(GLMemoryTracker::self(), &GLMemoryTracker::evictionRequested, this, &BlurEffect::evictBlurCache);
+
+    // Restacking, closing, minimizing or unminimizing a window changes the backdrop of the
+    // windows above it without damaging them
+    connect(effects, &EffectsHandler::stackingOrderChanged, this, &BlurEffect::invalidateBlurCache);
+    connect(effects, &EffectsHandler::windowClosed, this, &BlurEffect::invalidateBlurCache);
+    connect(effects, &EffectsHandler::windowMinimized, this, &BlurEffect::invalidateBlurCache);
+    connect(effects, &EffectsHandler::windowUnminimized, this, &BlurEffect::invalidateBlurCache);
 
     // Fetch the blur regions for all windows
     const auto stackingOrder = effects->stackingOrder();
@@ -117,6 +127,7 @@ bool BlurEffect::renderTargetsValid() const
 
 void BlurEffect::deleteFBOs()
 {
+    m_blurCache.clear();
     qDeleteAll(m_renderTargets);
     qDeleteAll(m_renderTextures);
 
@@ -163,6 +174,7 @@ void BlurEffect::updateTexture()
 
     for (int i = 0; i <= m_downSampleIterations; i++) {
         m_renderTextures.append(new GLTexture(textureFormat, effects->virtualScreenSize() / (1 << i)));
+        m_renderTextures.constLast()->setMemoryCategory(GLMemoryTracker::Blur);
         m_renderTextures.constLast()->setFilter(GL_LINEAR);
         m_renderTextures.constLast()->setWrapMode(GL_CLAMP_TO_EDGE);
 
@@ -171,6 +183,7 @@ void BlurEffect::updateTexture()
 
     // This last set is used as a temporary helper texture
     m_renderTextures.append(new GLTexture(textureFormat, effects->virtualScreenSize()));
+    m_renderTextures.constLast()->setMemoryCategory(GLMemoryTracker::Blur);
     m_renderTextures.constLast()->setFilter(GL_LINEAR);
     m_renderTextures.constLast()->setWrapMode(GL_CLAMP_TO_EDGE);
 
@@ -344,6 +357,11 @@ void BlurEffect::slotWindowAdded(EffectWindow *w)
 
 void BlurEffect::slotWindowDeleted(EffectWindow *w)
 {
+    if (auto cache = m_blurCache.find(w); cache != m_blurCache.end()) {
+        effects->makeOpenGLContextCurrent();
+        m_blurCache.erase(cache);
+    }
+
     auto it = windowBlurChangedConnections.find(w);
     if (it == windowBlurChangedConnections.end()) {
         return;
@@ -525,8 +543,62 @@ void BlurEffect::prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseco
 {
     m_paintedArea = QRegion();
     m_currentBlur = QRegion();
+    m_changedArea = QRegion();
+    m_prePaintSerial++;
 
     effects->prePaintScreen(data, presentTime);
+
+    // with transformed windows, the painted area doesn't say what changed on the screen
+    m_cacheable = !(data.mask & (PAINT_SCREEN_TRANSFORMED | PAINT_SCREEN_WITH_TRANSFORMED_WINDOWS)) && !effects->activeFullScreenEffect();
+}
+
+void BlurEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData &data)
+{
+    // The repaints that don't come from the damage of the windows, for example a full repaint
+    // or the area of a window that went away, aren't tracked by prePaintWindow()
+    const QRegion untracked = region - m_paintedArea;
+    if (!untracked.isEmpty()) {
+        for (auto &entry : m_blurCache) {
+            if (entry.second.region.intersects(untracked)) {
+                entry.second.valid = false;
+            }
+        }
+    }
+
+    effects->paintScreen(mask, region, data);
+}
+
+void BlurEffect::evictBlurCache()
+{
+    if (m_blurCache.empty()) {
+        return;
+    }
+
+    // The least recently painted windows go first, the blurs of the windows on screen are
+    // reused in the next frame. Without a budget to get under, only those are kept.
+    std::vector<std::pair<quint64, EffectWindow *>> entries;
+    entries.reserve(m_blurCache.size());
+    for (const auto &entry : m_blurCache) {
+        entries.emplace_back(entry.second.lastPrePaint, entry.first);
+    }
+    std::sort(entries.begin(), entries.end());
+
+    const GLMemoryTracker *tracker = GLMemoryTracker::self();
+    effects->makeOpenGLContextCurrent();
+    for (const auto &[lastPrePaint, window] : entries) {
+        const bool overBudget = tracker->budget() > 0 && tracker->totalUsage() > tracker->budget();
+        if (!overBudget && lastPrePaint >= m_prePaintSerial) {
+            break;
+        }
+        m_blurCache.erase(window);
+    }
+}
+
+void BlurEffect::invalidateBlurCache()
+{
+    for (auto &entry : m_blurCache) {
+        entry.second.valid = false;
+    }
 }
 
 void BlurEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::chrono::milliseconds presentTime)
@@ -539,6 +611,7 @@ void BlurEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::
         return;
     }
 
+    const QRegion changed = data.paint;
     const QRegion oldOpaque = data.opaque;
     if (data.opaque.intersects(m_currentBlur)) {
         // to blur an area partially we have to shrink the opaque area of a window
@@ -578,6 +651,26 @@ void BlurEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::
 
     m_paintedArea -= data.opaque;
     m_paintedArea |= data.paint;
+
+    // the cached blur of this window is outdated if anything changed underneath it, or if
+    // this window wasn't seen in the last frame, so that changes might have gone unnoticed
+    bool backdropChanged = m_changedArea.intersects(expandedBlur);
+    if (auto it = m_blurCache.find(w); it != m_blurCache.end()) {
+        BlurCache &cache = it->second;
+        if (!m_cacheable || cache.lastPrePaint != m_prePaintSerial - 1) {
+            cache.valid = false;
+        } else if (cache.screen == effects->renderTargetRect() && backdropChanged) {
+            cache.valid = false;
+        }
+        cache.lastPrePaint = m_prePaintSerial;
+    }
+
+    m_changedArea -= data.opaque;
+    m_changedArea |= changed;
+    if (backdropChanged) {
+        // the blurred area of this window changes with its backdrop
+        m_changedArea |= blurArea;
+    }
 }
 
 bool BlurEffect::shouldBlur(const EffectWindow *w, int mask, const WindowPaintData &data) const
@@ -641,7 +734,7 @@ void BlurEffect::drawWindow(EffectWindow *w, int mask, const QRegion &region, Wi
         const bool transientForIsDock = (modal ? modal->isDock() : false);
 
         if (!shape.isEmpty()) {
-            doBlur(shape, screen, data.opacity(), data.screenProjectionMatrix(), w->isDock() || transientForIsDock, w->frameGeometry());
+            doBlur(w, shape, screen, data.opacity(), data.screenProjectionMatrix(), w->isDock() || transientForIsDock, w->frameGeometry());
         }
     }
 
@@ -672,11 +765,12 @@ void BlurEffect::generateNoiseTexture()
     noiseImage = noiseImage.scaled(noiseImage.size() * m_scalingFactor);
 
     m_noiseTexture.reset(new GLTexture(noiseImage));
+    m_noiseTexture->setMemoryCategory(GLMemoryTracker::Blur);
     m_noiseTexture->setFilter(GL_NEAREST);
     m_noiseTexture->setWrapMode(GL_REPEAT);
 }
 
-void BlurEffect::doBlur(const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect)
+void BlurEffect::doBlur(EffectWindow *w, const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect)
 {
     // Blur would not render correctly on a secondary monitor because of wrong coordinates
     // BUG: 393723
@@ -698,39 +792,88 @@ void BlurEffect::doBlur(const QRegion &shape, const QRect &screen, const float o
     const QRect destRect = sourceRect.translated(xTranslate, yTranslate);
     int blurRectCount = expandedBlurRegion.rectCount() * 6;
 
-    /*
-     * If the window is a dock or panel we avoid the "extended blur" effect.
-     * Extended blur is when windows that are not under the blurred area affect
-     * the final blur result.
-     * We want to avoid this on panels, because it looks really weird and ugly
-     * when maximized windows or windows near the panel affect the dock blur.
-     */
-    if (isDock) {
-        m_renderTargets.last()->blitFromFramebuffer(effects->mapToRenderTarget(sourceRect), destRect);
-        GLFramebuffer::pushFramebuffers(m_renderTargetStack);
-
+    if (restoreBlurCache(w, screen, expandedBlurRegion, isDock)) {
+        // nothing changed underneath the window, so the previous result is still correct
         if (useSRGB) {
             glEnable(GL_FRAMEBUFFER_SRGB);
         }
-
-        const QRect screenRect = effects->virtualScreenGeometry();
-        QMatrix4x4 mvp;
-        mvp.ortho(0, screenRect.width(), screenRect.height(), 0, 0, 65535);
-        copyScreenSampleTexture(vbo, blurRectCount, shape.translated(xTranslate, yTranslate), mvp);
     } else {
-        m_renderTargets.first()->blitFromFramebuffer(effects->mapToRenderTarget(sourceRect), destRect);
-        GLFramebuffer::pushFramebuffers(m_renderTargetStack);
+        /*
+         * If the window is a dock or panel we avoid the "extended blur" effect.
+         * Extended blur is when windows that are not under the blurred area affect
+         * the final blur result.
+         * We want to avoid this on panels, because it looks really weird and ugly
+         * when maximized windows or windows near the panel affect the dock blur.
+         */
+        const bool useCompute = m_shader->isImageFormatSupported(m_renderTextures.constFirst()->internalFormat());
+        const bool fuseCopySample = canFuseCopySample(isDock);
+
+        if (isDock) {
+            m_renderTargets.last()->blitFromFramebuffer(effects->mapToRenderTarget(sourceRect), destRect);
+            if (useCompute) {
+                GLFramebuffer::pushFramebuffer(m_renderTargets.first());
+            } else {
+                GLFramebuffer::pushFramebuffers(m_renderTargetStack);
+            }
 
-        if (useSRGB) {
-            glEnable(GL_FRAMEBUFFER_SRGB);
+            if (useSRGB) {
+                glEnable(GL_FRAMEBUFFER_SRGB);
+            }
+
+            const QRect screenRect = effects->virtualScreenGeometry();
+            QMatrix4x4 mvp;
+            mvp.ortho(0, screenRect.width(), screenRect.height(), 0, 0, 65535);
+            copyScreenSampleTexture(vbo, blurRectCount, shape.translated(xTranslate, yTranslate), mvp);
+        } else if (fuseCopySample) {
+            // Sample the backdrop straight from the device pixels into the first downsample
+            // level; the scaled copy already discards more detail than the first pass would add
+            const QRect fusedRect(QPoint(destRect.left() / 2, destRect.top() / 2),
+                                  QPoint((destRect.right() + 1) / 2, (destRect.bottom() + 1) / 2));
+            const QRect fusedSourceRect = QRect(fusedRect.topLeft() * 2, fusedRect.size() * 2).translated(-xTranslate, -yTranslate) & screen;
+            m_renderTargets[1]->blitFromFramebuffer(effects->mapToRenderTarget(fusedSourceRect), fusedRect);
+            if (!useCompute) {
+                GLFramebuffer::pushFramebuffers(m_renderTargetStack);
+            }
+
+            if (useSRGB) {
+                glEnable(GL_FRAMEBUFFER_SRGB);
+            }
+
+            if (!useCompute) {
+                // Remove the m_renderTargets[0] and [1] from the top of the stack that we will not use
+                GLFramebuffer::popFramebuffer();
+                GLFramebuffer::popFramebuffer();
+            }
+        } else {
+            m_renderTargets.first()->blitFromFramebuffer(effects->mapToRenderTarget(sourceRect), destRect);
+            if (!useCompute) {
+                GLFramebuffer::pushFramebuffers(m_renderTargetStack);
+            }
+
+            if (useSRGB) {
+                glEnable(GL_FRAMEBUFFER_SRGB);
+            }
+
+            if (!useCompute) {
+                // Remove the m_renderTargets[0] from the top of the stack that we will not use
+                GLFramebuffer::popFramebuffer();
+            }
         }
 
-        // Remove the m_renderTargets[0] from the top of the stack that we will not use
-        GLFramebuffer::popFramebuffer();
-    }
+        const int firstIteration = fuseCopySample ? 2 : 1;
+        if (useCompute) {
+            const QRect blurRect = expandedBlurRegion.translated(xTranslate, yTranslate).boundingRect();
+            downSampleTextureCompute(blurRect, firstIteration);
+            upSampleTextureCompute(blurRect);
+        } else {
+            downSampleTexture(vbo, blurRectCount, firstIteration);
+            upSampleTexture(vbo, blurRectCount);
+        }
 
-    downSampleTexture(vbo, blurRectCount);
-    upSampleTexture(vbo, blurRectCount);
+        if (m_cacheable) {
+            saveBlurCache(w, screen, expandedBlurRegion, destRect, isDock);
+        }
+    }
 
     // Modulate the blurred texture with the window opacity if the window isn't opaque
     if (opacity < 1.0) {
@@ -780,6 +923,80 @@ void BlurEffect::doBlur(const QRegion &shape, const QRect &screen, const float o
     vbo->unbindArrays();
 }
 
+bool BlurEffect::canFuseCopySample(bool isDock) const
+{
+    // Docks clamp the copy to their own shape with the copy shader, so they still need a full sized copy.
+    // With fewer than two iterations, skipping the first downsample would leave the backdrop barely blurred.
+    static bool fuseEnvSet = false;
+    static const bool fuseEnv = qEnvironmentVariableIntValue("KWIN_BLUR_FUSED_DOWNSAMPLE", &fuseEnvSet) != 0;
+    if (fuseEnvSet && !fuseEnv) {
+        return false;
+    }
+    return !isDock && m_downSampleIterations > 1 && effects->renderTargetScale() >= 2;
+}
+
+QRect BlurEffect::cacheTextureRect(const QRect &destRect) const
+{
+    // the area of the first downsample level that holds the blurred contents of destRect
+    const QPoint topLeft(destRect.left() / 2, destRect.top() / 2);
+    const QPoint bottomRight((destRect.right() + 2) / 2, (destRect.bottom() + 2) / 2);
+    return QRect(topLeft, bottomRight) & QRect(QPoint(0, 0), m_renderTextures[1]->size());
+}
+
+void BlurEffect::saveBlurCache(EffectWindow *w, const QRect &screen, const QRegion &expandedBlurRegion, const QRect &destRect, bool isDock)
+{
+    const QRect textureRect = cacheTextureRect(destRect);
+    if (textureRect.isEmpty()) {
+        return;
+    }
+
+    BlurCache &cache = m_blurCache[w];
+    if (!cache.texture || cache.texture->size() != textureRect.size()) {
+        cache.framebuffer.reset();
+        cache.texture = std::make_unique<GLTexture>(m_renderTextures[1]->internalFormat(), textureRect.size());
+        cache.texture->setMemoryCategory(GLMemoryTracker::Blur);
+        cache.texture->setFilter(GL_NEAREST);
+        cache.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        cache.framebuffer = std::make_unique<GLFramebuffer>(cache.texture.get());
+    }
+    if (!cache.framebuffer->valid()) {
+        m_blurCache.erase(w);
+        return;
+    }
+
+    GLFramebuffer::pushFramebuffer(m_renderTargets[1]);
+    cache.framebuffer->blitFromFramebuffer(textureRect, QRect(QPoint(0, 0), textureRect.size()), GL_NEAREST);
+    GLFramebuffer::popFramebuffer();
+
+    cache.screen = screen;
+    cache.region = expandedBlurRegion;
+    cache.textureRect = textureRect;
+    cache.isDock = isDock;
+    cache.valid = true;
+    cache.lastPrePaint = m_prePaintSerial;
+}
+
+bool BlurEffect::restoreBlurCache(EffectWindow *w, const QRect &screen, const QRegion &expandedBlurRegion, bool isDock)
+{
+    if (!m_cacheable) {
+        return false;
+    }
+    const auto it = m_blurCache.find(w);
+    if (it == m_blurCache.end()) {
+        return false;
+    }
+    const BlurCache &cache = it->second;
+    // the cached result has to cover everything that gets blurred now
+    if (!cache.valid || cache.screen != screen || cache.isDock != isDock || !(expandedBlurRegion - cache.region).isEmpty()) {
+        return false;
+    }
+
+    GLFramebuffer::pushFramebuffer(cache.framebuffer.get());
+    m_renderTargets[1]->blitFromFramebuffer(QRect(QPoint(0, 0), cache.textureRect.size()), cache.textureRect, GL_NEAREST);
+    GLFramebuffer::popFramebuffer();
+    return true;
+}
+
 void BlurEffect::upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition)
 {
     Q_UNUSED(windowPosition)
@@ -813,14 +1030,14 @@ void BlurEffect::applyNoise(GLVertexBuffer *vbo, int vboStart, int blurRectCount
     m_shader->unbind();
 }
 
-void BlurEffect::downSampleTexture(GLVertexBuffer *vbo, int blurRectCount)
+void BlurEffect::downSampleTexture(GLVertexBuffer *vbo, int blurRectCount, int firstIteration)
 {
     QMatrix4x4 modelViewProjectionMatrix;
 
     m_shader->bind(BlurShader::DownSampleType);
     m_shader->setOffset(m_offset);
 
-    for (int i = 1; i <= m_downSampleIterations; i++) {
+    for (int i = firstIteration; i <= m_downSampleIterations; i++) {
         modelViewProjectionMatrix.setToIdentity();
         modelViewProjectionMatrix.ortho(0, m_renderTextures[i]->width(), m_renderTextures[i]->height(), 0, 0, 65535);
 
@@ -861,6 +1078,32 @@ void BlurEffect::upSampleTexture(GLVertexBuffer *vbo, int blurRectCount)
     m_shader->unbind();
 }
 
+QRect BlurEffect::computeRect(const QRect &rect, int iteration) const
+{
+    // the texels covered by the given rect at a downsample iteration, with the origin at the bottom left
+    const int divisionRatio = (1 << iteration);
+    const QSize size = m_renderTextures[iteration]->size();
+    const int left = rect.x() / divisionRatio;
+    const int top = rect.y() / divisionRatio;
+    const int right = (rect.x() + rect.width() + divisionRatio - 1) / divisionRatio;
+    const int bottom = (rect.y() + rect.height() + divisionRatio - 1) / divisionRatio;
+    return QRect(left, size.height() - bottom, right - left, bottom - top) & QRect(QPoint(0, 0), size);
+}
+
+void BlurEffect::downSampleTextureCompute(const QRect &rect, int firstIteration)
+{
+    for (int i = firstIteration; i <= m_downSampleIterations; i++) {
+        m_shader->dispatch(BlurShader::DownSampleType, m_renderTextures[i - 1], m_renderTextures[i], computeRect(rect, i), m_offset);
+    }
+}
+
+void BlurEffect::upSampleTextureCompute(const QRect &rect)
+{
+    for (int i = m_downSampleIterations - 1; i >= 1; i--) {
+        m_shader->dispatch(BlurShader::UpSampleType, m_renderTextures[i + 1], m_renderTextures[i], computeRect(rect, i), m_offset);
+    }
+}
+
 void BlurEffect::copyScreenSampleTexture(GLVertexBuffer *vbo, int blurRectCount, QRegion blurShape, const QMatrix4x4 &screenProjection)
 {
     m_shader->bind(BlurShader::CopySampleType);
@@ -886,6 +1129,12 @@ bool BlurEffect::isActive() const
     return !effects->isScreenLocked();
 }
 
+Effect::PaintHooks BlurEffect::paintHooks() const
+{
+    // prePaintWindow has to see every window to track the blurred and opaque areas
+    return PrePaintScreenHook | PaintScreenHook | PrePaintWindowHook | DrawWindowHook;
+}
+
 bool BlurEffect::blocksDirectScanout() const
 {
     return false;
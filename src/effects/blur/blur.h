@@ -16,6 +16,9 @@
 #include <QVector2D>
 #include <QVector>
 
+#include <memory>
+#include <unordered_map>
+
 namespace KWaylandServer
 {
 class BlurManagerInterface;
@@ -41,11 +44,13 @@ public:
 
     void reconfigure(ReconfigureFlags flags) override;
     void prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseconds presentTime) override;
+    void paintScreen(int mask, const QRegion &region, ScreenPaintData &data) override;
     void prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::chrono::milliseconds presentTime) override;
     void drawWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data) override;
 
     bool provides(Feature feature) override;
     bool isActive() const override;
+    PaintHooks paintHooks() const override;
 
     int requestedEffectChainPosition() const override
     {
@@ -62,6 +67,8 @@ public Q_SLOTS:
     void slotPropertyNotify(KWin::EffectWindow *w, long atom);
     void slotScreenGeometryChanged();
     void setupDecorationConnections(EffectWindow *w);
+    void invalidateBlurCache();
+    void evictBlurCache();
 
 private:
     QRect expand(const QRect &rect) const;
@@ -75,16 +82,23 @@ private:
     bool decorationSupportsBlurBehind(const EffectWindow *w) const;
     bool shouldBlur(const EffectWindow *w, int mask, const WindowPaintData &data) const;
     void updateBlurRegion(EffectWindow *w) const;
-    void doBlur(const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect);
+    void doBlur(EffectWindow *w, const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect);
     void uploadRegion(QVector2D *&map, const QRegion &region, const int downSampleIterations);
     void uploadGeometry(GLVertexBuffer *vbo, const QRegion &blurRegion, const QRegion &windowRegion);
     void generateNoiseTexture();
 
     void upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition);
     void applyNoise(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition);
-    void downSampleTexture(GLVertexBuffer *vbo, int blurRectCount);
+    void downSampleTexture(GLVertexBuffer *vbo, int blurRectCount, int firstIteration);
     void upSampleTexture(GLVertexBuffer *vbo, int blurRectCount);
+    void downSampleTextureCompute(const QRect &rect, int firstIteration);
+    void upSampleTextureCompute(const QRect &rect);
+    QRect computeRect(const QRect &rect, int iteration) const;
     void copyScreenSampleTexture(GLVertexBuffer *vbo, int blurRectCount, QRegion blurShape, const QMatrix4x4 &screenProjection);
+    QRect cacheTextureRect(const QRect &destRect) const;
+    bool canFuseCopySample(bool isDock) const;
+    void saveBlurCache(EffectWindow *w, const QRect &screen, const QRegion &expandedBlurRegion, const QRect &destRect, bool isDock);
+    bool restoreBlurCache(EffectWindow *w, const QRect &screen, const QRegion &expandedBlurRegion, bool isDock);
 
 private:
     BlurShader *m_shader;
@@ -98,6 +112,26 @@ private:
     long net_wm_blur_region = 0;
     QRegion m_paintedArea; // keeps track of all painted areas (from bottom to top)
     QRegion m_currentBlur; // keeps track of the currently blured area of the windows(from bottom to top)
+    QRegion m_changedArea; // keeps track of the areas whose contents changed (from bottom to top)
+    bool m_cacheable = false;
+    quint64 m_prePaintSerial = 0;
+
+    /**
+     * The result of the last down and upsample chain of a window, at the first downsample level.
+     * It's reused as long as nothing changes underneath the window.
+     */
+    struct BlurCache
+    {
+        std::unique_ptr<GLTexture> texture;
+        std::unique_ptr<GLFramebuffer> framebuffer;
+        QRect screen;
+        QRegion region;
+        QRect textureRect;
+        bool isDock = false;
+        bool valid = false;
+        quint64 lastPrePaint = 0;
+    };
+    std::unordered_map<EffectWindow *, BlurCache> m_blurCache;
 
     int m_downSampleIterations; // number of times the texture will be downsized to half size
     int m_offset;
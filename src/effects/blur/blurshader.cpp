@@ -214,10 +214,187 @@ BlurShader::BlurShader(QObject *parent)
 
         ShaderManager::instance()->popShader();
     }
+
+    // The compute variants of the down and upsample passes write the blurred pixels directly
+    // into the textures, so a chain of passes doesn't need to switch framebuffers
+    static bool computeEnvSet = false;
+    static const bool computeEnv = qEnvironmentVariableIntValue("KWIN_BLUR_COMPUTE", &computeEnvSet) != 0;
+    const bool computeSupported = gles ? hasGLVersion(3, 1) : hasGLVersion(4, 3);
+    if (m_valid && computeSupported && (!computeEnvSet || computeEnv)) {
+        QByteArray computeHeader;
+        if (gles) {
+            computeHeader += "#version 310 es\n\n"
+                             "precision highp float;\n"
+                             "precision highp image2D;\n";
+        } else {
+            computeHeader += "#version 430 core\n\n";
+        }
+        computeHeader += "layout(local_size_x = 16, local_size_y = 16) in;\n"
+                         "layout(rgba8, binding = 0) uniform writeonly image2D outputImage;\n"
+                         "layout(binding = 0) uniform sampler2D texUnit;\n"
+                         "uniform float offset;\n"
+                         "uniform vec2 halfpixel;\n"
+                         "uniform ivec2 origin;\n"
+                         "uniform ivec2 extent;\n\n"
+                         "void main(void)\n"
+                         "{\n"
+                         "    if (any(greaterThanEqual(ivec2(gl_GlobalInvocationID.xy), extent))) {\n"
+                         "        return;\n"
+                         "    }\n"
+                         "    ivec2 pos = origin + ivec2(gl_GlobalInvocationID.xy);\n"
+                         "    vec2 uv = (vec2(pos) + 0.5) / vec2(imageSize(outputImage));\n"
+                         "    \n";
+
+        const QByteArray computeDownSource = computeHeader
+            + "    vec4 sum = texture(texUnit, uv) * 4.0;\n"
+              "    sum += texture(texUnit, uv - halfpixel.xy * offset);\n"
+              "    sum += texture(texUnit, uv + halfpixel.xy * offset);\n"
+              "    sum += texture(texUnit, uv + vec2(halfpixel.x, -halfpixel.y) * offset);\n"
+              "    sum += texture(texUnit, uv - vec2(halfpixel.x, -halfpixel.y) * offset);\n"
+              "    \n"
+              "    imageStore(outputImage, pos, sum / 8.0);\n"
+              "}\n";
+
+        const QByteArray computeUpSource = computeHeader
+            + "    vec4 sum = texture(texUnit, uv + vec2(-halfpixel.x * 2.0, 0.0) * offset);\n"
+              "    sum += texture(texUnit, uv + vec2(-halfpixel.x, halfpixel.y) * offset) * 2.0;\n"
+              "    sum += texture(texUnit, uv + vec2(0.0, halfpixel.y * 2.0) * offset);\n"
+              "    sum += texture(texUnit, uv + vec2(halfpixel.x, halfpixel.y) * offset) * 2.0;\n"
+              "    sum += texture(texUnit, uv + vec2(halfpixel.x * 2.0, 0.0) * offset);\n"
+              "    sum += texture(texUnit, uv + vec2(halfpixel.x, -halfpixel.y) * offset) * 2.0;\n"
+              "    sum += texture(texUnit, uv + vec2(0.0, -halfpixel.y * 2.0) * offset);\n"
+              "    sum += texture(texUnit, uv + vec2(-halfpixel.x, -halfpixel.y) * offset) * 2.0;\n"
+              "    \n"
+              "    imageStore(outputImage, pos, sum / 12.0);\n"
+              "}\n";
+
+        m_computeDownsample = createComputeProgram(computeDownSource);
+        m_computeUpsample = createComputeProgram(computeUpSource);
+        m_computeValid = m_computeDownsample && m_computeUpsample;
+
+        if (m_computeValid) {
+            m_offsetLocationComputeDownsample = glGetUniformLocation(m_computeDownsample, "offset");
+            m_halfpixelLocationComputeDownsample = glGetUniformLocation(m_computeDownsample, "halfpixel");
+            m_originLocationComputeDownsample = glGetUniformLocation(m_computeDownsample, "origin");
+            m_extentLocationComputeDownsample = glGetUniformLocation(m_computeDownsample, "extent");
+
+            m_offsetLocationComputeUpsample = glGetUniformLocation(m_computeUpsample, "offset");
+            m_halfpixelLocationComputeUpsample = glGetUniformLocation(m_computeUpsample, "halfpixel");
+            m_originLocationComputeUpsample = glGetUniformLocation(m_computeUpsample, "origin");
+            m_extentLocationComputeUpsample = glGetUniformLocation(m_computeUpsample, "extent");
+        }
+    }
 }
 
 BlurShader::~BlurShader()
 {
+    if (m_computeDownsample) {
+        glDeleteProgram(m_computeDownsample);
+    }
+    if (m_computeUpsample) {
+        glDeleteProgram(m_computeUpsample);
+    }
+}
+
+GLuint BlurShader::createComputeProgram(const QByteArray &source)
+{
+    const GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+    const char *data = source.constData();
+    glShaderSource(shader, 1, &data, nullptr);
+    glCompileShader(shader);
+
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status == 0) {
+        GLsizei length = 0;
+        QByteArray log(4096, 0);
+        glGetShaderInfoLog(shader, log.size(), &length, log.data());
+        qCWarning(KWINEFFECTS) << "Failed to compile blur compute shader:" << log.left(length);
+        glDeleteShader(shader);
+        return 0;
+    }
+
+    const GLuint program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glDeleteShader(shader);
+
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == 0) {
+        GLsizei length = 0;
+        QByteArray log(4096, 0);
+        glGetProgramInfoLog(program, log.size(), &length, log.data());
+        qCWarning(KWINEFFECTS) << "Failed to link blur compute shader:" << log.left(length);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+bool BlurShader::isImageFormatSupported(GLenum internalFormat)
+{
+    if (!m_computeValid) {
+        return false;
+    }
+    auto it = m_imageFormatSupport.find(internalFormat);
+    if (it == m_imageFormatSupport.end()) {
+        // sRGB formats would need an encoding that image stores don't do
+        bool supported = internalFormat == GL_RGBA8;
+        if (supported && !GLPlatform::instance()->isGLES()) {
+            // OpenGL ES 3.1 requires rgba8 images, desktop OpenGL can be asked
+            GLint support = GL_NONE;
+            glGetInternalformativ(GL_TEXTURE_2D, internalFormat, GL_SHADER_IMAGE_STORE, 1, &support);
+            supported = support != GL_NONE;
+        }
+        it = m_imageFormatSupport.insert(internalFormat, supported);
+    }
+    return *it;
+}
+
+void BlurShader::dispatch(SampleType sampleType, GLTexture *source, GLTexture *target, const QRect &rect, float offset)
+{
+    if (!m_computeValid || rect.isEmpty()) {
+        return;
+    }
+
+    const QVector2D halfpixel(0.5 / target->width(), 0.5 / target->height());
+    switch (sampleType) {
+    case DownSampleType:
+        glUseProgram(m_computeDownsample);
+        glUniform1f(m_offsetLocationComputeDownsample, offset);
+        glUniform2f(m_halfpixelLocationComputeDownsample, halfpixel.x(), halfpixel.y());
+        glUniform2i(m_originLocationComputeDownsample, rect.x(), rect.y());
+        glUniform2i(m_extentLocationComputeDownsample, rect.width(), rect.height());
+        break;
+
+    case UpSampleType:
+        glUseProgram(m_computeUpsample);
+        glUniform1f(m_offsetLocationComputeUpsample, offset);
+        glUniform2f(m_halfpixelLocationComputeUpsample, halfpixel.x(), halfpixel.y());
+        glUniform2i(m_originLocationComputeUpsample, rect.x(), rect.y());
+        glUniform2i(m_extentLocationComputeUpsample, rect.width(), rect.height());
+        break;
+
+    default:
+        Q_UNREACHABLE();
+        break;
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    source->bind();
+    glBindImageTexture(0, target->texture(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glDispatchCompute((rect.width() + 15) / 16, (rect.height() + 15) / 16, 1);
+    // the next pass samples what was just written, and the result gets blitted and rendered
+    // from through framebuffers
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+    // ShaderManager doesn't know about the compute program
+    if (GLShader *shader = ShaderManager::instance()->getBoundShader()) {
+        shader->bind();
+    } else {
+        glUseProgram(0);
+    }
 }
 
 void BlurShader::setModelViewProjectionMatrix(const QMatrix4x4 &matrix)
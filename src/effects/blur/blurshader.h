@@ -10,6 +10,7 @@
 
 #include <kwinglutils.h>
 
+#include <QHash>
 #include <QMatrix4x4>
 #include <QObject>
 #include <QScopedPointer>
@@ -46,7 +47,27 @@ public:
     void setTexturePosition(const QPoint &texPos);
     void setBlurRect(const QRect &blurRect, const QSize &screenSize);
 
+    /**
+     * Returns whether the down and upsample passes can run as compute shaders, which
+     * needs OpenGL 4.3 or OpenGL ES 3.1.
+     */
+    bool isComputeValid() const;
+    /**
+     * Returns whether the compute passes can write to textures with the given @p internalFormat.
+     * The shaders store rgba8 pixels, so the format has to take them without any conversion.
+     */
+    bool isImageFormatSupported(GLenum internalFormat);
+
+    /**
+     * Runs the down or upsample pass with a compute shader. It reads from @p source and
+     * writes the pixels in @p rect of the RGBA8 texture @p target, in texel coordinates
+     * with the origin at the bottom left. No framebuffer is involved.
+     */
+    void dispatch(SampleType sampleType, GLTexture *source, GLTexture *target, const QRect &rect, float offset);
+
 private:
+    GLuint createComputeProgram(const QByteArray &source);
+
     QScopedPointer<GLShader> m_shaderDownsample;
     QScopedPointer<GLShader> m_shaderUpsample;
     QScopedPointer<GLShader> m_shaderCopysample;
@@ -88,7 +109,21 @@ private:
     QVector2D m_noiseTextureSizeNoisesample;
     QMatrix4x4 m_matrixNoisesample;
 
+    GLuint m_computeDownsample = 0;
+    int m_offsetLocationComputeDownsample;
+    int m_halfpixelLocationComputeDownsample;
+    int m_originLocationComputeDownsample;
+    int m_extentLocationComputeDownsample;
+
+    GLuint m_computeUpsample = 0;
+    int m_offsetLocationComputeUpsample;
+    int m_halfpixelLocationComputeUpsample;
+    int m_originLocationComputeUpsample;
+    int m_extentLocationComputeUpsample;
+
     bool m_valid = false;
+    bool m_computeValid = false;
+    QHash<GLenum, bool> m_imageFormatSupport;
 
     Q_DISABLE_COPY(BlurShader);
 };
@@ -98,6 +133,11 @@ inline bool BlurShader::isValid() const
     return m_valid;
 }
 
+inline bool BlurShader::isComputeValid() const
+{
+    return m_computeValid;
+}
+
 } // namespace KWin
 
 #endif
@@ -161,8 +161,11 @@ void GlideEffect::paintWindow(EffectWindow *w, int mask, QRegion region, WindowP
 
 void GlideEffect::postPaintScreen()
 {
+    // The projected window can't be bounded cheaply, repaint only the screens that show it.
+    QRegion repaint;
     auto animationIt = m_animations.begin();
     while (animationIt != m_animations.end()) {
+        repaint += effects->windowScreensArea(animationIt.key());
         if ((*animationIt).timeLine.done()) {
             animationIt = m_animations.erase(animationIt);
         } else {
@@ -170,7 +173,7 @@ void GlideEffect::postPaintScreen()
         }
     }
 
-    effects->addRepaintFull();
+    effects->addRepaint(repaint);
     effects->postPaintScreen();
 }
 
@@ -212,7 +215,7 @@ void GlideEffect::windowAdded(EffectWindow *w)
     animation.timeLine.setDuration(m_duration);
     animation.timeLine.setEasingCurve(QEasingCurve::InCurve);
 
-    effects->addRepaintFull();
+    effects->addRepaint(effects->windowScreensArea(w));
 }
 
 void GlideEffect::windowClosed(EffectWindow *w)
@@ -244,7 +247,7 @@ void GlideEffect::windowClosed(EffectWindow *w)
     animation.timeLine.setDuration(m_duration);
     animation.timeLine.setEasingCurve(QEasingCurve::OutCurve);
 
-    effects->addRepaintFull();
+    effects->addRepaint(effects->windowScreensArea(w));
 }
 
 void GlideEffect::windowDeleted(EffectWindow *w)
@@ -44,7 +44,6 @@ LookingGlassEffect::LookingGlassEffect()
     , polling(false)
     , m_texture(nullptr)
     , m_fbo(nullptr)
-    , m_vbo(nullptr)
     , m_shader(nullptr)
     , m_lastPresentTime(std::chrono::milliseconds::zero())
     , m_enabled(false)
@@ -78,12 +77,13 @@ LookingGlassEffect::~LookingGlassEffect()
     delete m_texture;
     delete m_fbo;
     delete m_shader;
-    delete m_vbo;
 }
 
 bool LookingGlassEffect::supported()
 {
-    return effects->compositingType() == OpenGLCompositing && !GLPlatform::instance()->supports(LimitedNPOT);
+    // the area around the lens is copied from the render target with a framebuffer blit
+    return effects->compositingType() == OpenGLCompositing && !GLPlatform::instance()->supports(LimitedNPOT)
+        && GLFramebuffer::blitSupported();
 }
 
 void LookingGlassEffect::reconfigure(ReconfigureFlags)
@@ -99,46 +99,13 @@ bool LookingGlassEffect::loadData()
 {
     ensureResources();
 
-    const QSize screenSize = effects->virtualScreenSize();
-    int texw = screenSize.width();
-    int texh = screenSize.height();
-
-    // Create texture and render target
-    const int levels = std::log2(qMin(texw, texh)) + 1;
-    m_texture = new GLTexture(GL_RGBA8, texw, texh, levels);
-    m_texture->setFilter(GL_LINEAR_MIPMAP_LINEAR);
-    m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
-
-    m_fbo = new GLFramebuffer(m_texture);
-    if (!m_fbo->valid()) {
-        return false;
-    }
-
+    // The texture only holds the area around the lens, it is created when the lens is painted.
+    delete m_shader;
     m_shader = ShaderManager::instance()->generateShaderFromFile(ShaderTrait::MapTexture, QString(), QStringLiteral(":/effects/lookingglass/shaders/lookingglass.frag"));
-    if (m_shader->isValid()) {
-        ShaderBinder binder(m_shader);
-        m_shader->setUniform("u_textureSize", QVector2D(screenSize.width(), screenSize.height()));
-    } else {
+    if (!m_shader->isValid()) {
         qCCritical(KWIN_LOOKINGGLASS) << "The shader failed to load!";
         return false;
     }
-
-    m_vbo = new GLVertexBuffer(GLVertexBuffer::Static);
-    QVector<float> verts;
-    QVector<float> texcoords;
-    texcoords << screenSize.width() << 0.0;
-    verts << screenSize.width() << 0.0;
-    texcoords << 0.0 << 0.0;
-    verts << 0.0 << 0.0;
-    texcoords << 0.0 << screenSize.height();
-    verts << 0.0 << screenSize.height();
-    texcoords << 0.0 << screenSize.height();
-    verts << 0.0 << screenSize.height();
-    texcoords << screenSize.width() << screenSize.height();
-    verts << screenSize.width() << screenSize.height();
-    texcoords << screenSize.width() << 0.0;
-    verts << screenSize.width() << 0.0;
-    m_vbo->setData(6, 2, verts.constData(), texcoords.constData());
     return true;
 }
 
@@ -196,6 +163,13 @@ QRect LookingGlassEffect::magnifierArea() const
     return QRect(cursorPos().x() - radius, cursorPos().y() - radius, 2 * radius, 2 * radius);
 }
 
+QRect LookingGlassEffect::sourceArea() const
+{
+    // The shader displaces texture coordinates inside of the lens by up to this many pixels.
+    const int margin = std::ceil((zoom - 1.0) * 20.0);
+    return magnifierArea().adjusted(-margin, -margin, margin, margin);
+}
+
 void LookingGlassEffect::prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseconds presentTime)
 {
     const int time = m_lastPresentTime.count() ? (presentTime - m_lastPresentTime).count() : 0;
@@ -220,13 +194,11 @@ void LookingGlassEffect::prePaintScreen(ScreenPrePaintData &data, std::chrono::m
     } else {
         m_lastPresentTime = std::chrono::milliseconds::zero();
     }
+    effects->prePaintScreen(data, presentTime);
     if (m_valid && m_enabled) {
-        data.mask |= PAINT_SCREEN_WITH_TRANSFORMED_WINDOWS;
-        // Start rendering to texture
-        GLFramebuffer::pushFramebuffer(m_fbo);
+        // The lens is painted over whatever the scene paints below it.
+        data.paint |= magnifierArea();
     }
-
-    effects->prePaintScreen(data, presentTime);
 }
 
 void LookingGlassEffect::slotMouseChanged(const QPoint &pos, const QPoint &old, Qt::MouseButtons,
@@ -238,9 +210,10 @@ void LookingGlassEffect::slotMouseChanged(const QPoint &pos, const QPoint &old,
     }
 }
 
-void LookingGlassEffect::slotWindowDamaged()
+void LookingGlassEffect::slotWindowDamaged(EffectWindow *w)
 {
-    if (isActive()) {
+    // Only the area around the lens is magnified, damage elsewhere doesn't change it.
+    if (isActive() && w->expandedGeometry().intersects(sourceArea())) {
         effects->addRepaint(magnifierArea());
     }
 }
@@ -249,23 +222,64 @@ void LookingGlassEffect::paintScreen(int mask, const QRegion &region, ScreenPain
 {
     // Call the next effect.
     effects->paintScreen(mask, region, data);
-    if (m_valid && m_enabled) {
-        // Disable render texture
-        GLFramebuffer *target = GLFramebuffer::popFramebuffer();
-        Q_ASSERT(target == m_fbo);
-        Q_UNUSED(target);
-        m_texture->bind();
-        m_texture->generateMipmaps();
-
-        // Use the shader
-        ShaderBinder binder(m_shader);
-        m_shader->setUniform("u_zoom", (float)zoom);
-        m_shader->setUniform("u_radius", (float)radius);
-        m_shader->setUniform("u_cursor", QVector2D(cursorPos().x(), cursorPos().y()));
-        m_shader->setUniform(GLShader::ModelViewProjectionMatrix, data.projectionMatrix());
-        m_vbo->render(GL_TRIANGLES);
-        m_texture->unbind();
+    if (!m_valid || !m_enabled) {
+        return;
+    }
+
+    const QRect renderTargetRect = effects->renderTargetRect();
+    const QRect lensArea = magnifierArea() & renderTargetRect;
+    if (lensArea.isEmpty() || !region.intersects(lensArea)) {
+        return;
+    }
+
+    // Copy just the area that the lens samples from, instead of the whole screen.
+    const QRect source = sourceArea() & renderTargetRect;
+    const QSize textureSize = source.size() * effects->renderTargetScale();
+    if (!m_texture || m_texture->size() != textureSize) {
+        delete m_fbo;
+        delete m_texture;
+        m_texture = new GLTexture(GL_RGBA8, textureSize);
+        m_texture->setFilter(GL_LINEAR);
+        m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_fbo = new GLFramebuffer(m_texture);
+    }
+    if (!m_fbo->valid()) {
+        return;
     }
+    m_fbo->blitFromFramebuffer(effects->mapToRenderTarget(source));
+
+    // The texture coordinates are in logical pixels, relative to the copied area.
+    const QRectF lensRect = lensArea;
+    const QRectF textureRect = lensRect.translated(-source.topLeft());
+    const float verts[] = {
+        float(lensRect.right()), float(lensRect.top()),
+        float(lensRect.left()), float(lensRect.top()),
+        float(lensRect.left()), float(lensRect.bottom()),
+        float(lensRect.left()), float(lensRect.bottom()),
+        float(lensRect.right()), float(lensRect.bottom()),
+        float(lensRect.right()), float(lensRect.top()),
+    };
+    const float texcoords[] = {
+        float(textureRect.right()), float(textureRect.top()),
+        float(textureRect.left()), float(textureRect.top()),
+        float(textureRect.left()), float(textureRect.bottom()),
+        float(textureRect.left()), float(textureRect.bottom()),
+        float(textureRect.right()), float(textureRect.bottom()),
+        float(textureRect.right()), float(textureRect.top()),
+    };
+    GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
+    vbo->reset();
+    vbo->setData(6, 2, verts, texcoords);
+
+    m_texture->bind();
+    ShaderBinder binder(m_shader);
+    m_shader->setUniform("u_zoom", (float)zoom);
+    m_shader->setUniform("u_radius", (float)radius);
+    m_shader->setUniform("u_cursor", QVector2D(cursorPos() - source.topLeft()));
+    m_shader->setUniform("u_textureSize", QVector2D(source.width(), source.height()));
+    m_shader->setUniform(GLShader::ModelViewProjectionMatrix, data.projectionMatrix());
+    vbo->render(GL_TRIANGLES);
+    m_texture->unbind();
 }
 
 bool LookingGlassEffect::isActive() const
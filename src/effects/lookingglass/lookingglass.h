@@ -54,10 +54,11 @@ public Q_SLOTS:
     void slotMouseChanged(const QPoint &pos, const QPoint &old,
                           Qt::MouseButtons buttons, Qt::MouseButtons oldbuttons,
                           Qt::KeyboardModifiers modifiers, Qt::KeyboardModifiers oldmodifiers);
-    void slotWindowDamaged();
+    void slotWindowDamaged(EffectWindow *w);
 
 private:
     bool loadData();
+    QRect sourceArea() const;
     double zoom;
     double target_zoom;
     bool polling; // Mouse polling
@@ -65,7 +66,6 @@ private:
     int initialradius;
     GLTexture *m_texture;
     GLFramebuffer *m_fbo;
-    GLVertexBuffer *m_vbo;
     GLShader *m_shader;
     std::chrono::milliseconds m_lastPresentTime;
     bool m_enabled;
@@ -269,9 +269,10 @@ void MagnifierEffect::slotMouseChanged(const QPoint &pos, const QPoint &old,
     }
 }
 
-void MagnifierEffect::slotWindowDamaged()
+void MagnifierEffect::slotWindowDamaged(EffectWindow *w)
 {
-    if (isActive()) {
+    // The lens only shows what is under it, damage elsewhere doesn't change it.
+    if (isActive() && w->expandedGeometry().intersects(magnifierArea())) {
         effects->addRepaint(magnifierArea());
     }
 }
@@ -51,7 +51,7 @@ private Q_SLOTS:
     void slotMouseChanged(const QPoint &pos, const QPoint &old,
                           Qt::MouseButtons buttons, Qt::MouseButtons oldbuttons,
                           Qt::KeyboardModifiers modifiers, Qt::KeyboardModifiers oldmodifiers);
-    void slotWindowDamaged();
+    void slotWindowDamaged(EffectWindow *w);
 
 private:
     QRect magnifierArea(QPoint pos = cursorPos()) const;
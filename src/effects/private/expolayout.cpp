@@ -10,6 +10,8 @@
 
 #include "expolayout.h"
 
+#include <QDataStream>
+
 #include <cmath>
 
 ExpoCell::ExpoCell(QObject *parent)
@@ -297,16 +299,56 @@ void ExpoLayout::setReady()
     }
 }
 
+QByteArray ExpoLayout::layoutSignature() const
+{
+    QByteArray signature;
+    QDataStream stream(&signature, QIODevice::WriteOnly);
+    stream << uint(m_mode) << m_fillGaps << m_spacing << int(width()) << int(height());
+    for (const ExpoCell *cell : m_cells) {
+        stream << cell->persistentKey() << cell->naturalRect() << cell->margins();
+    }
+    return signature;
+}
+
 void ExpoLayout::updatePolish()
 {
     if (!m_cells.isEmpty()) {
-        switch (m_mode) {
-        case LayoutClosest:
-            calculateWindowTransformationsClosest();
-            break;
-        case LayoutNatural:
-            calculateWindowTransformationsNatural();
-            break;
+        if (m_mode == LayoutNatural) {
+            // As we are using pseudo-random movement (See "slot") we need to make sure the list
+            // is always sorted the same way no matter which window is currently active.
+            std::sort(m_cells.begin(), m_cells.end(), [](const ExpoCell *a, const ExpoCell *b) {
+                return a->persistentKey() < b->persistentKey();
+            });
+        }
+
+        // Filtering the windows typically toggles between a few sets of cells, e.g. while
+        // typing and deleting a search term, so the computed layouts are kept around.
+        const QByteArray signature = layoutSignature();
+        auto it = m_layoutCache.constFind(signature);
+        if (it == m_layoutCache.constEnd()) {
+            QVector<QRect> geometries;
+            switch (m_mode) {
+            case LayoutClosest:
+                geometries = calculateWindowTransformationsClosest();
+                break;
+            case LayoutNatural:
+                geometries = calculateWindowTransformationsNatural();
+                break;
+            }
+            if (m_layoutCache.size() >= 32) {
+                m_layoutCache.clear();
+            }
+            it = m_layoutCache.insert(signature, geometries);
+        }
+
+        const QVector<QRect> &geometries = *it;
+        for (int i = 0; i < m_cells.count(); ++i) {
+            ExpoCell *cell = m_cells[i];
+            const QRect &rect = geometries[i];
+            cell->setX(rect.x());
+            cell->setY(rect.y());
+            cell->setWidth(rect.width());
+            cell->setHeight(rect.height());
         }
     }
 
@@ -349,7 +391,7 @@ static int distance(const QPoint &a, const QPoint &b)
     return int(std::sqrt(qreal(xdiff * xdiff + ydiff * ydiff)));
 }
 
-static QRect centered(ExpoCell *cell, const QRect &bounds)
+static QRect centered(const ExpoCell *cell, const QRect &bounds)
 {
     const QSize scaled = QSize(cell->naturalWidth(), cell->naturalHeight())
                              .scaled(bounds.size(), Qt::KeepAspectRatio);
@@ -360,8 +402,10 @@ static QRect centered(ExpoCell *cell, const QRect &bounds)
                  scaled.height());
 }
 
-void ExpoLayout::calculateWindowTransformationsClosest()
+QVector<QRect> ExpoLayout::calculateWindowTransformationsClosest() const
 {
+    QVector<QRect> geometries(m_cells.count());
+
     QRect area = QRect(0, 0, width(), height());
     const int columns = int(std::ceil(std::sqrt(qreal(m_cells.count()))));
     const int rows = int(std::ceil(m_cells.count() / qreal(columns)));
@@ -369,9 +413,16 @@ void ExpoLayout::calculateWindowTransformationsClosest()
     // Assign slots
     const int slotWidth = area.width() / columns;
     const int slotHeight = area.height() / rows;
-    QVector<ExpoCell *> takenSlots;
+    QVector<int> takenSlots;
     takenSlots.resize(rows * columns);
-    takenSlots.fill(nullptr);
+    takenSlots.fill(-1);
+
+    // precalculate the centers of the natural geometries
+    QVector<QPoint> cellCenters;
+    cellCenters.reserve(m_cells.count());
+    for (const ExpoCell *cell : m_cells) {
+        cellCenters.append(cell->naturalRect().center());
+    }
 
     // precalculate all slot centers
     QVector<QPoint> slotCenters;
@@ -384,18 +435,22 @@ void ExpoLayout::calculateWindowTransformationsClosest()
     }
 
     // Assign each window to the closest available slot
-    QList<ExpoCell *> tmpList = m_cells; // use a QLinkedList copy instead?
+    QList<int> tmpList;
+    tmpList.reserve(m_cells.count());
+    for (int i = 0; i < m_cells.count(); ++i) {
+        tmpList.append(i);
+    }
     while (!tmpList.isEmpty()) {
-        ExpoCell *cell = tmpList.first();
+        const int cell = tmpList.first();
         int slotCandidate = -1, slotCandidateDistance = INT_MAX;
-        const QPoint pos = cell->naturalRect().center();
+        const QPoint pos = cellCenters[cell];
 
         for (int i = 0; i < columns * rows; ++i) { // all slots
             const int dist = distance(pos, slotCenters[i]);
             if (dist < slotCandidateDistance) { // window is interested in this slot
-                ExpoCell *occupier = takenSlots[i];
+                const int occupier = takenSlots[i];
                 Q_ASSERT(occupier != cell);
-                if (!occupier || dist < distance(occupier->naturalRect().center(), slotCenters[i])) {
+                if (occupier == -1 || dist < distance(cellCenters[occupier], slotCenters[i])) {
                     // either nobody lives here, or we're better - takeover the slot if it's our best
                     slotCandidate = i;
                     slotCandidateDistance = dist;
@@ -403,7 +458,7 @@ void ExpoLayout::calculateWindowTransformationsClosest()
             }
         }
         Q_ASSERT(slotCandidate != -1);
-        if (takenSlots[slotCandidate]) {
+        if (takenSlots[slotCandidate] != -1) {
             tmpList << takenSlots[slotCandidate]; // occupier needs a new home now :p
         }
         tmpList.removeAll(cell);
@@ -411,10 +466,10 @@ void ExpoLayout::calculateWindowTransformationsClosest()
     }
 
     for (int slot = 0; slot < columns * rows; ++slot) {
-        ExpoCell *cell = takenSlots[slot];
-        if (!cell) { // some slots might be empty
+        if (takenSlots[slot] == -1) { // some slots might be empty
             continue;
         }
+        const ExpoCell *cell = m_cells[takenSlots[slot]];
 
         // Work out where the slot is
         QRect target(area.x() + (slot % columns) * slotWidth,
@@ -444,63 +499,59 @@ void ExpoLayout::calculateWindowTransformationsClosest()
                 scale * cell->naturalWidth(), scale * cell->naturalHeight());
         }
 
-        cell->setX(target.x());
-        cell->setY(target.y());
-        cell->setWidth(target.width());
-        cell->setHeight(target.height());
+        geometries[takenSlots[slot]] = target;
     }
+
+    return geometries;
 }
 
-static inline int heightForWidth(ExpoCell *cell, int width)
+static inline int heightForWidth(const ExpoCell *cell, int width)
 {
     return int((width / qreal(cell->naturalWidth())) * cell->naturalHeight());
 }
 
-static bool isOverlappingAny(ExpoCell *w, const QHash<ExpoCell *, QRect> &targets, const QRegion &border, int spacing)
+static bool isOverlappingAny(int index, const QVector<QRect> &targets, const QRegion &border, int spacing)
 {
-    QHash<ExpoCell *, QRect>::const_iterator winTarget = targets.find(w);
-    if (winTarget == targets.constEnd()) {
-        return false;
-    }
-    if (border.intersects(*winTarget)) {
+    const QRect &winTarget = targets[index];
+    if (border.intersects(winTarget)) {
         return true;
     }
     const QMargins halfSpacing(spacing / 2, spacing / 2, spacing / 2, spacing / 2);
+    const QRect expandedTarget = winTarget.marginsAdded(halfSpacing);
 
     // Is there a better way to do this?
-    QHash<ExpoCell *, QRect>::const_iterator target;
-    for (target = targets.constBegin(); target != targets.constEnd(); ++target) {
-        if (target == winTarget) {
+    for (int i = 0; i < targets.count(); ++i) {
+        if (i == index) {
             continue;
         }
-        if (winTarget->marginsAdded(halfSpacing).intersects(target->marginsAdded(halfSpacing))) {
+        if (expandedTarget.intersects(targets[i].marginsAdded(halfSpacing))) {
             return true;
         }
     }
     return false;
 }
 
-void ExpoLayout::calculateWindowTransformationsNatural()
+QVector<QRect> ExpoLayout::calculateWindowTransformationsNatural() const
 {
     const QRect area = QRect(0, 0, width(), height());
 
-    // As we are using pseudo-random movement (See "slot") we need to make sure the list
-    // is always sorted the same way no matter which window is currently active.
-    std::sort(m_cells.begin(), m_cells.end(), [](const ExpoCell *a, const ExpoCell *b) {
-        return a->persistentKey() < b->persistentKey();
-    });
+    // The cells are sorted by their persistent keys in updatePolish(), the targets and the
+    // directions are indexed the same way as the cells.
+    const int count = m_cells.count();
 
     QRect bounds;
     int direction = 0;
-    QHash<ExpoCell *, QRect> targets;
-    QHash<ExpoCell *, int> directions;
+    QVector<QRect> targets;
+    QVector<int> directions;
+    targets.reserve(count);
+    directions.reserve(count);
 
-    for (ExpoCell *cell : qAsConst(m_cells)) {
+    for (const ExpoCell *cell : m_cells) {
         const QRect cellRect(cell->naturalX(), cell->naturalY(), cell->naturalWidth(), cell->naturalHeight());
-        targets[cell] = cellRect;
+        targets.append(cellRect);
         // Reuse the unused "slot" as a preferred direction attribute. This is used when the window
         // is on the edge of the screen to try to use as much screen real estate as possible.
-        directions[cell] = direction;
+        directions.append(direction);
         bounds = bounds.united(cellRect);
         direction++;
         if (direction == 4) {
@@ -514,9 +565,9 @@ void ExpoLayout::calculateWindowTransformationsNatural()
     bool overlap;
     do {
         overlap = false;
-        for (ExpoCell *cell : qAsConst(m_cells)) {
+        for (int cell = 0; cell < count; ++cell) {
             QRect *target_w = &targets[cell];
-            for (ExpoCell *e : qAsConst(m_cells)) {
+            for (int e = 0; e < count; ++e) {
                 if (cell == e) {
                     continue;
                 }
@@ -605,13 +656,11 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                    area.height() / scale);
 
     // Move all windows back onto the screen and set their scale
-    QHash<ExpoCell *, QRect>::iterator target = targets.begin();
-    while (target != targets.end()) {
-        target->setRect((target->x() - bounds.x()) * scale + area.x(),
-                        (target->y() - bounds.y()) * scale + area.y(),
-                        target->width() * scale,
-                        target->height() * scale);
-        ++target;
+    for (QRect &target : targets) {
+        target.setRect((target.x() - bounds.x()) * scale + area.x(),
+                       (target.y() - bounds.y()) * scale + area.y(),
+                       target.width() * scale,
+                       target.height() * scale);
     }
 
     // Try to fill the gaps by enlarging windows if they have the space
@@ -623,9 +672,10 @@ void ExpoLayout::calculateWindowTransformationsNatural()
         bool moved;
         do {
             moved = false;
-            for (ExpoCell *cell : qAsConst(m_cells)) {
+            for (int index = 0; index < count; ++index) {
+                const ExpoCell *cell = m_cells[index];
                 QRect oldRect;
-                QRect *target = &targets[cell];
+                QRect *target = &targets[index];
                 // This may cause some slight distortion if the windows are enlarged a large amount
                 int widthDiff = m_accuracy;
                 int heightDiff = heightForWidth(cell, target->width() + widthDiff) - target->height();
@@ -641,7 +691,7 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                                 target->y() - yDiff - heightDiff,
                                 target->width() + widthDiff,
                                 target->height() + heightDiff);
-                if (isOverlappingAny(cell, targets, borderRegion, m_spacing)) {
+                if (isOverlappingAny(index, targets, borderRegion, m_spacing)) {
                     *target = oldRect;
                 } else {
                     moved = true;
@@ -655,7 +705,7 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                                 target->y() + yDiff,
                                 target->width() + widthDiff,
                                 target->height() + heightDiff);
-                if (isOverlappingAny(cell, targets, borderRegion, m_spacing)) {
+                if (isOverlappingAny(index, targets, borderRegion, m_spacing)) {
                     *target = oldRect;
                 } else {
                     moved = true;
@@ -669,7 +719,7 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                                 target->y() + yDiff,
                                 target->width() + widthDiff,
                                 target->height() + heightDiff);
-                if (isOverlappingAny(cell, targets, borderRegion, m_spacing)) {
+                if (isOverlappingAny(index, targets, borderRegion, m_spacing)) {
                     *target = oldRect;
                 } else {
                     moved = true;
@@ -683,7 +733,7 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                                 target->y() - yDiff - heightDiff,
                                 target->width() + widthDiff,
                                 target->height() + heightDiff);
-                if (isOverlappingAny(cell, targets, borderRegion, m_spacing)) {
+                if (isOverlappingAny(index, targets, borderRegion, m_spacing)) {
                     *target = oldRect;
                 } else {
                     moved = true;
@@ -694,8 +744,9 @@ void ExpoLayout::calculateWindowTransformationsNatural()
         // The expanding code above can actually enlarge windows over 1.0/2.0 scale, we don't like this
         // We can't add this to the loop above as it would cause a never-ending loop so we have to make
         // do with the less-than-optimal space usage with using this method.
-        for (ExpoCell *cell : qAsConst(m_cells)) {
-            QRect *target = &targets[cell];
+        for (int index = 0; index < count; ++index) {
+            const ExpoCell *cell = m_cells[index];
+            QRect *target = &targets[index];
             qreal scale = target->width() / qreal(cell->naturalWidth());
             if (scale > 2.0 || (scale > 1.0 && (cell->naturalWidth() > 300 || cell->naturalHeight() > 300))) {
                 scale = (cell->naturalWidth() > 300 || cell->naturalHeight() > 300) ? 1.0 : 2.0;
@@ -707,12 +758,10 @@ void ExpoLayout::calculateWindowTransformationsNatural()
         }
     }
 
-    for (ExpoCell *cell : qAsConst(m_cells)) {
-        const QRect rect = centered(cell, targets.value(cell).marginsRemoved(cell->margins()));
-
-        cell->setX(rect.x());
-        cell->setY(rect.y());
-        cell->setWidth(rect.width());
-        cell->setHeight(rect.height());
+    for (int index = 0; index < count; ++index) {
+        const ExpoCell *cell = m_cells[index];
+        targets[index] = centered(cell, targets[index].marginsRemoved(cell->margins()));
     }
+
+    return targets;
 }
@@ -6,9 +6,11 @@
 
 #pragma once
 
+#include <QHash>
 #include <QObject>
 #include <QQuickItem>
 #include <QRect>
+#include <QVector>
 
 #include <optional>
 
@@ -61,10 +63,13 @@ Q_SIGNALS:
     void readyChanged();
 
 private:
-    void calculateWindowTransformationsClosest();
-    void calculateWindowTransformationsNatural();
+    QVector<QRect> calculateWindowTransformationsClosest() const;
+    QVector<QRect> calculateWindowTransformationsNatural() const;
+    QByteArray layoutSignature() const;
 
     QList<ExpoCell *> m_cells;
+    // the computed cell geometries, by the layout inputs
+    QHash<QByteArray, QVector<QRect>> m_layoutCache;
     LayoutMode m_mode = LayoutNatural;
     int m_accuracy = 20;
     int m_spacing = 10;
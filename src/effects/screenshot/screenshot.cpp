@@ -17,6 +17,8 @@
 
 #include <QPainter>
 
+#include <cstring>
+
 namespace KWin
 {
 
@@ -34,6 +36,8 @@ struct ScreenShotAreaData
     QRect area;
     QImage result;
     QList<EffectScreen *> screens;
+    // the number of screen parts whose pixels are still being transferred
+    int pendingReadbacks = 0;
 };
 
 struct ScreenShotScreenData
@@ -43,7 +47,7 @@ struct ScreenShotScreenData
     EffectScreen *screen = nullptr;
 };
 
-static void convertFromGLImage(QImage &img, int w, int h)
+static void convertFromGLPixels(QImage &img, int w, int h)
 {
     // from QtOpenGL/qgl.cpp
     // SPDX-FileCopyrightText: 2010 Nokia Corporation and /or its subsidiary(-ies)
@@ -70,9 +74,119 @@ static void convertFromGLImage(QImage &img, int w, int h)
             }
         }
     }
+}
+
+static void convertFromGLImage(QImage &img, int w, int h)
+{
+    convertFromGLPixels(img, w, h);
     img = img.mirrored();
 }
 
+static GLenum readbackFormat()
+{
+    // On little endian machines, QImage::Format_ARGB32 is laid out as BGRA in memory,
+    // OpenGL ES however only guarantees that GL_RGBA can be read back.
+    if (!GLPlatform::instance()->isGLES() && QSysInfo::ByteOrder == QSysInfo::LittleEndian) {
+        return GL_BGRA;
+    }
+    return GL_RGBA;
+}
+
+/**
+ * The ScreenShotReadback class transfers a rectangle of the current framebuffer into a pixel
+ * buffer object. The transfer is followed by a fence, the image can be taken without stalling
+ * once the fence has been signaled.
+ */
+class ScreenShotReadback
+{
+public:
+    ScreenShotReadback(const QRect &rect, qreal devicePixelRatio, std::function<void(const QImage &)> callback);
+    ~ScreenShotReadback();
+
+    static bool supported();
+
+    bool isReady() const;
+    QImage takeImage();
+
+    const std::function<void(const QImage &)> callback;
+
+private:
+    GLuint m_buffer = 0;
+    GLsync m_fence = nullptr;
+    QSize m_size;
+    qreal m_devicePixelRatio;
+    GLenum m_format;
+};
+
+ScreenShotReadback::ScreenShotReadback(const QRect &rect, qreal devicePixelRatio, std::function<void(const QImage &)> callback)
+    : callback(std::move(callback))
+    , m_size(rect.size())
+    , m_devicePixelRatio(devicePixelRatio)
+    , m_format(readbackFormat())
+{
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, m_size.width() * m_size.height() * 4, nullptr, GL_STREAM_READ);
+    glReadPixels(rect.x(), rect.y(), m_size.width(), m_size.height(), m_format, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Make sure the transfer starts now rather than when the fence is polled.
+    glFlush();
+}
+
+ScreenShotReadback::~ScreenShotReadback()
+{
+    if (m_fence) {
+        glDeleteSync(m_fence);
+    }
+    glDeleteBuffers(1, &m_buffer);
+}
+
+bool ScreenShotReadback::supported()
+{
+    if (GLPlatform::instance()->isGLES()) {
+        return hasGLVersion(3, 0);
+    }
+    if (hasGLVersion(3, 2)) {
+        return true;
+    }
+    return hasGLExtension(QByteArrayLiteral("GL_ARB_pixel_buffer_object"))
+        && hasGLExtension(QByteArrayLiteral("GL_ARB_map_buffer_range"))
+        && hasGLExtension(QByteArrayLiteral("GL_ARB_sync"));
+}
+
+bool ScreenShotReadback::isReady() const
+{
+    return !m_fence || glClientWaitSync(m_fence, 0, 0) != GL_TIMEOUT_EXPIRED;
+}
+
+QImage ScreenShotReadback::takeImage()
+{
+    const int stride = m_size.width() * 4;
+
+    QImage image(m_size, QImage::Format_ARGB32);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_buffer);
+    if (const auto pixels = static_cast<const uchar *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, stride * m_size.height(), GL_MAP_READ_BIT))) {
+        // The rows are stored bottom to top, flip them while copying.
+        for (int y = 0; y < m_size.height(); ++y) {
+            memcpy(image.scanLine(m_size.height() - y - 1), pixels + y * stride, stride);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        image = QImage();
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (!image.isNull()) {
+        if (m_format == GL_RGBA) {
+            convertFromGLPixels(image, m_size.width(), m_size.height());
+        }
+        image.setDevicePixelRatio(m_devicePixelRatio);
+    }
+    return image;
+}
+
 bool ScreenShotEffect::supported()
 {
     return effects->isOpenGLCompositing() && GLFramebuffer::supported();
@@ -85,10 +199,21 @@ ScreenShotEffect::ScreenShotEffect()
     connect(effects, &EffectsHandler::screenAdded, this, &ScreenShotEffect::handleScreenAdded);
     connect(effects, &EffectsHandler::screenRemoved, this, &ScreenShotEffect::handleScreenRemoved);
     connect(effects, &EffectsHandler::windowClosed, this, &ScreenShotEffect::handleWindowClosed);
+
+    m_readbackTimer.setInterval(1);
+    connect(&m_readbackTimer, &QTimer::timeout, this, &ScreenShotEffect::handleReadbacks);
 }
 
 ScreenShotEffect::~ScreenShotEffect()
 {
+    if (!m_readbacks.empty()) {
+        effects->makeOpenGLContextCurrent();
+        while (!m_readbacks.empty()) {
+            std::unique_ptr<ScreenShotReadback> readback = std::move(m_readbacks.back());
+            m_readbacks.pop_back();
+            readback->callback(QImage());
+        }
+    }
     cancelWindowScreenShots();
     cancelAreaScreenShots();
     cancelScreenScreenShots();
@@ -115,41 +240,41 @@ QFuture<QImage> ScreenShotEffect::scheduleScreenShot(EffectScreen *screen, Scree
 
 QFuture<QImage> ScreenShotEffect::scheduleScreenShot(const QRect &area, ScreenShotFlags flags)
 {
-    for (ScreenShotAreaData &data : m_areaScreenShots) {
-        if (data.area == area && data.flags == flags) {
-            return data.promise.future();
+    for (const QSharedPointer<ScreenShotAreaData> &data : qAsConst(m_areaScreenShots)) {
+        if (data->area == area && data->flags == flags) {
+            return data->promise.future();
         }
     }
 
-    ScreenShotAreaData data;
-    data.area = area;
-    data.flags = flags;
+    auto data = QSharedPointer<ScreenShotAreaData>::create();
+    data->area = area;
+    data->flags = flags;
 
     const QList<EffectScreen *> screens = effects->screens();
     for (EffectScreen *screen : screens) {
         if (screen->geometry().intersects(area)) {
-            data.screens.append(screen);
+            data->screens.append(screen);
         }
     }
 
     qreal devicePixelRatio = 1.0;
     if (flags & ScreenShotNativeResolution) {
-        for (const EffectScreen *screen : qAsConst(data.screens)) {
+        for (const EffectScreen *screen : qAsConst(data->screens)) {
             if (screen->devicePixelRatio() > devicePixelRatio) {
                 devicePixelRatio = screen->devicePixelRatio();
             }
         }
     }
 
-    data.result = QImage(area.size() * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
-    data.result.fill(Qt::transparent);
-    data.result.setDevicePixelRatio(devicePixelRatio);
+    data->result = QImage(area.size() * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    data->result.fill(Qt::transparent);
+    data->result.setDevicePixelRatio(devicePixelRatio);
 
     m_areaScreenShots.append(data);
     effects->addRepaint(area);
 
-    data.promise.reportStarted();
-    return data.promise.future();
+    data->promise.reportStarted();
+    return data->promise.future();
 }
 
 QFuture<QImage> ScreenShotEffect::scheduleScreenShot(EffectWindow *window, ScreenShotFlags flags)
@@ -182,8 +307,8 @@ void ScreenShotEffect::cancelWindowScreenShots()
 void ScreenShotEffect::cancelAreaScreenShots()
 {
     while (!m_areaScreenShots.isEmpty()) {
-        ScreenShotAreaData screenshot = m_areaScreenShots.takeLast();
-        screenshot.promise.reportCanceled();
+        const QSharedPointer<ScreenShotAreaData> screenshot = m_areaScreenShots.takeLast();
+        screenshot->promise.reportCanceled();
     }
 }
 
@@ -206,7 +331,7 @@ void ScreenShotEffect::paintScreen(int mask, const QRegion &region, ScreenPaintD
     }
 
     for (int i = m_areaScreenShots.count() - 1; i >= 0; --i) {
-        if (takeScreenShot(&m_areaScreenShots[i])) {
+        if (takeScreenShot(m_areaScreenShots[i])) {
             m_areaScreenShots.removeAt(i);
         }
     }
@@ -247,6 +372,8 @@ void ScreenShotEffect::takeScreenShot(ScreenShotWindowData *screenshot)
         d.setXTranslation(-geometry.x());
         d.setYTranslation(-geometry.y());
 
+        const auto complete = completeScreenShot(screenshot->promise, screenshot->flags, geometry.topLeft());
+
         // render window into offscreen texture
         int mask = PAINT_WINDOW_TRANSFORMED | PAINT_WINDOW_TRANSLUCENT;
         QImage img;
@@ -262,6 +389,12 @@ void ScreenShotEffect::takeScreenShot(ScreenShotWindowData *screenshot)
 
             effects->drawWindow(window, mask, infiniteRegion(), d);
 
+            if (ScreenShotReadback::supported()) {
+                readFramebuffer(QRect(QPoint(0, 0), offscreenTexture->size()), devicePixelRatio, complete);
+                GLFramebuffer::popFramebuffer();
+                return;
+            }
+
             // copy content from framebuffer into image
             img = QImage(offscreenTexture->size(), QImage::Format_ARGB32);
             img.setDevicePixelRatio(devicePixelRatio);
@@ -271,40 +404,43 @@ void ScreenShotEffect::takeScreenShot(ScreenShotWindowData *screenshot)
             convertFromGLImage(img, img.width(), img.height());
         }
 
-        if (screenshot->flags & ScreenShotIncludeCursor) {
-            grabPointerImage(img, geometry.x(), geometry.y());
-        }
-
-        screenshot->promise.reportResult(img);
-        screenshot->promise.reportFinished();
+        complete(img);
     } else {
         screenshot->promise.reportCanceled();
     }
 }
 
-bool ScreenShotEffect::takeScreenShot(ScreenShotAreaData *screenshot)
+bool ScreenShotEffect::takeScreenShot(const QSharedPointer<ScreenShotAreaData> &screenshot)
 {
     if (!effects->waylandDisplay()) {
         // On X11, all screens are painted simultaneously and there is no native HiDPI support.
-        QImage snapshot = blitScreenshot(screenshot->area);
-        if (screenshot->flags & ScreenShotIncludeCursor) {
-            grabPointerImage(snapshot, screenshot->area.x(), screenshot->area.y());
-        }
-        screenshot->promise.reportResult(snapshot);
-        screenshot->promise.reportFinished();
-    } else {
-        if (!screenshot->screens.contains(m_paintedScreen)) {
-            return false;
-        }
-        screenshot->screens.removeOne(m_paintedScreen);
+        screenshot->screens.clear();
+        readScreenshot(screenshot->area, 1.0, completeScreenShot(screenshot->promise, screenshot->flags, screenshot->area.topLeft()));
+        return true;
+    }
 
-        const QRect sourceRect = screenshot->area & m_paintedScreen->geometry();
-        qreal sourceDevicePixelRatio = 1.0;
-        if (screenshot->flags & ScreenShotNativeResolution) {
-            sourceDevicePixelRatio = m_paintedScreen->devicePixelRatio();
+    if (!screenshot->screens.contains(m_paintedScreen)) {
+        return false;
+    }
+    screenshot->screens.removeOne(m_paintedScreen);
+
+    const QRect sourceRect = screenshot->area & m_paintedScreen->geometry();
+    qreal sourceDevicePixelRatio = 1.0;
+    if (screenshot->flags & ScreenShotNativeResolution) {
+        sourceDevicePixelRatio = m_paintedScreen->devicePixelRatio();
+    }
+
+    screenshot->pendingReadbacks++;
+    readScreenshot(sourceRect, sourceDevicePixelRatio, [this, screenshot, sourceRect](const QImage &snapshot) {
+        screenshot->pendingReadbacks--;
+        if (screenshot->promise.isCanceled()) {
+            return;
+        }
+        if (snapshot.isNull()) {
+            screenshot->promise.reportCanceled();
+            return;
         }
 
-        const QImage snapshot = blitScreenshot(sourceRect, sourceDevicePixelRatio);
         const QRect nativeArea(screenshot->area.topLeft(),
                                screenshot->area.size() * screenshot->result.devicePixelRatio());
 
@@ -313,16 +449,22 @@ bool ScreenShotEffect::takeScreenShot(ScreenShotAreaData *screenshot)
         painter.drawImage(sourceRect, snapshot);
         painter.end();
 
-        if (screenshot->screens.isEmpty()) {
-            if (screenshot->flags & ScreenShotIncludeCursor) {
-                grabPointerImage(screenshot->result, screenshot->area.x(), screenshot->area.y());
-            }
-            screenshot->promise.reportResult(screenshot->result);
-            screenshot->promise.reportFinished();
-        }
-    }
+        finishScreenShot(screenshot);
+    });
 
-    return screenshot->promise.isFinished();
+    return screenshot->screens.isEmpty();
+}
+
+void ScreenShotEffect::finishScreenShot(const QSharedPointer<ScreenShotAreaData> &screenshot)
+{
+    if (!screenshot->screens.isEmpty() || screenshot->pendingReadbacks > 0) {
+        return;
+    }
+    if (screenshot->flags & ScreenShotIncludeCursor) {
+        grabPointerImage(screenshot->result, screenshot->area.x(), screenshot->area.y());
+    }
+    screenshot->promise.reportResult(screenshot->result);
+    screenshot->promise.reportFinished();
 }
 
 bool ScreenShotEffect::takeScreenShot(ScreenShotScreenData *screenshot)
@@ -333,18 +475,84 @@ bool ScreenShotEffect::takeScreenShot(ScreenShotScreenData *screenshot)
             devicePixelRatio = screenshot->screen->devicePixelRatio();
         }
 
-        QImage snapshot = blitScreenshot(screenshot->screen->geometry(), devicePixelRatio);
-        if (screenshot->flags & ScreenShotIncludeCursor) {
-            const int xOffset = screenshot->screen->geometry().x();
-            const int yOffset = screenshot->screen->geometry().y();
-            grabPointerImage(snapshot, xOffset, yOffset);
+        const QRect geometry = screenshot->screen->geometry();
+        readScreenshot(geometry, devicePixelRatio, completeScreenShot(screenshot->promise, screenshot->flags, geometry.topLeft()));
+        return true;
+    }
+
+    return false;
+}
+
+std::function<void(const QImage &)> ScreenShotEffect::completeScreenShot(const QFutureInterface<QImage> &promise, ScreenShotFlags flags, const QPoint &offset) const
+{
+    return [this, promise, flags, offset](const QImage &image) mutable {
+        if (promise.isCanceled()) {
+            return;
+        }
+        if (image.isNull() && effects->isOpenGLCompositing()) {
+            promise.reportCanceled();
+            return;
+        }
+        QImage snapshot = image;
+        if (flags & ScreenShotIncludeCursor) {
+            grabPointerImage(snapshot, offset.x(), offset.y());
         }
+        promise.reportResult(snapshot);
+        promise.reportFinished();
+    };
+}
 
-        screenshot->promise.reportResult(snapshot);
-        screenshot->promise.reportFinished();
+void ScreenShotEffect::readScreenshot(const QRect &geometry, qreal devicePixelRatio, std::function<void(const QImage &)> callback)
+{
+    if (!effects->isOpenGLCompositing() || !ScreenShotReadback::supported()) {
+        callback(blitScreenshot(geometry, devicePixelRatio));
+        return;
     }
 
-    return screenshot->promise.isFinished();
+    const QSize nativeSize = geometry.size() * devicePixelRatio;
+    const QRect source = effects->mapToRenderTarget(geometry);
+    if (source.size() == nativeSize) {
+        // The requested area can be read back from the render target as is.
+        const int framebufferHeight = GLFramebuffer::currentFramebuffer()->size().height();
+        readFramebuffer(QRect(source.x(), framebufferHeight - source.y() - source.height(), source.width(), source.height()),
+                        devicePixelRatio, std::move(callback));
+    } else if (GLFramebuffer::blitSupported()) {
+        GLTexture texture(GL_RGBA8, nativeSize);
+        GLFramebuffer target(&texture);
+        target.blitFromFramebuffer(source);
+        GLFramebuffer::pushFramebuffer(&target);
+        readFramebuffer(QRect(QPoint(0, 0), nativeSize), devicePixelRatio, std::move(callback));
+        GLFramebuffer::popFramebuffer();
+    } else {
+        callback(blitScreenshot(geometry, devicePixelRatio));
+    }
+}
+
+void ScreenShotEffect::readFramebuffer(const QRect &rect, qreal devicePixelRatio, std::function<void(const QImage &)> callback)
+{
+    m_readbacks.push_back(std::make_unique<ScreenShotReadback>(rect, devicePixelRatio, std::move(callback)));
+    if (!m_readbackTimer.isActive()) {
+        m_readbackTimer.start();
+    }
+}
+
+void ScreenShotEffect::handleReadbacks()
+{
+    effects->makeOpenGLContextCurrent();
+
+    for (auto it = m_readbacks.begin(); it != m_readbacks.end();) {
+        if ((*it)->isReady()) {
+            std::unique_ptr<ScreenShotReadback> readback = std::move(*it);
+            it = m_readbacks.erase(it);
+            readback->callback(readback->takeImage());
+        } else {
+            ++it;
+        }
+    }
+
+    if (m_readbacks.empty()) {
+        m_readbackTimer.stop();
+    }
 }
 
 QImage ScreenShotEffect::blitScreenshot(const QRect &geometry, qreal devicePixelRatio) const
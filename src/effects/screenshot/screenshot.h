@@ -16,6 +16,10 @@
 #include <QFutureInterface>
 #include <QImage>
 #include <QObject>
+#include <QTimer>
+
+#include <functional>
+#include <memory>
 
 namespace KWin
 {
@@ -35,6 +39,7 @@ class ScreenShotDBusInterface2;
 struct ScreenShotWindowData;
 struct ScreenShotAreaData;
 struct ScreenShotScreenData;
+class ScreenShotReadback;
 
 /**
  * The ScreenShotEffect provides a convenient way to capture the contents of a given window,
@@ -43,6 +48,10 @@ struct ScreenShotScreenData;
  * Use the QFutureWatcher class to get notified when the requested screenshot is ready. Note
  * that the screenshot QFuture object can get cancelled if the captured window or the screen is
  * removed.
+ *
+ * If the OpenGL context supports pixel buffer objects and fences, the pixels are transferred
+ * asynchronously and the QFuture is finished once the GPU has signaled the fence that follows
+ * the transfer, so large screenshots don't stall the compositor.
  */
 class ScreenShotEffect : public Effect
 {
@@ -82,11 +91,14 @@ private Q_SLOTS:
     void handleWindowClosed(EffectWindow *window);
     void handleScreenAdded();
     void handleScreenRemoved(EffectScreen *screen);
+    void handleReadbacks();
 
 private:
     void takeScreenShot(ScreenShotWindowData *screenshot);
-    bool takeScreenShot(ScreenShotAreaData *screenshot);
+    bool takeScreenShot(const QSharedPointer<ScreenShotAreaData> &screenshot);
     bool takeScreenShot(ScreenShotScreenData *screenshot);
+    void finishScreenShot(const QSharedPointer<ScreenShotAreaData> &screenshot);
+    std::function<void(const QImage &)> completeScreenShot(const QFutureInterface<QImage> &promise, ScreenShotFlags flags, const QPoint &offset) const;
 
     void cancelWindowScreenShots();
     void cancelAreaScreenShots();
@@ -94,10 +106,14 @@ private:
 
     void grabPointerImage(QImage &snapshot, int xOffset, int yOffset) const;
     QImage blitScreenshot(const QRect &geometry, qreal devicePixelRatio = 1.0) const;
+    void readScreenshot(const QRect &geometry, qreal devicePixelRatio, std::function<void(const QImage &)> callback);
+    void readFramebuffer(const QRect &rect, qreal devicePixelRatio, std::function<void(const QImage &)> callback);
 
     QVector<ScreenShotWindowData> m_windowScreenShots;
-    QVector<ScreenShotAreaData> m_areaScreenShots;
+    QVector<QSharedPointer<ScreenShotAreaData>> m_areaScreenShots;
     QVector<ScreenShotScreenData> m_screenScreenShots;
+    std::vector<std::unique_ptr<ScreenShotReadback>> m_readbacks;
+    QTimer m_readbackTimer;
 
     QScopedPointer<ScreenShotDBusInterface1> m_dbusInterface1;
     QScopedPointer<ScreenShotDBusInterface2> m_dbusInterface2;
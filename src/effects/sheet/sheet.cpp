@@ -111,16 +111,14 @@ void SheetEffect::postPaintWindow(EffectWindow *w)
         EffectWindow *w = animationIt.key();
         w->addRepaintFull();
         if ((*animationIt).timeLine.done()) {
+            // the perspective projection may have painted outside the window
+            effects->addRepaint(effects->windowScreensArea(w));
             animationIt = m_animations.erase(animationIt);
         } else {
             ++animationIt;
         }
     }
 
-    if (m_animations.isEmpty()) {
-        effects->addRepaintFull();
-    }
-
     effects->postPaintWindow(w);
 }
 
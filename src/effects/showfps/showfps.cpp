@@ -18,6 +18,7 @@
 
 #include <KLocalizedString>
 
+#include <QFontMetrics>
 #include <QPainter>
 #include <QPalette>
 #include <QVector2D>
@@ -29,6 +30,7 @@ namespace KWin
 
 const int FPS_WIDTH = 10;
 const int MAX_TIME = 100;
+const int MAX_EFFECT_COSTS = 6;
 
 ShowFpsEffect::ShowFpsEffect()
     : paints_pos(0)
@@ -56,6 +58,9 @@ ShowFpsEffect::ShowFpsEffect()
 
 ShowFpsEffect::~ShowFpsEffect()
 {
+    if (m_profilingEnabledByUs) {
+        effects->setEffectProfilingEnabled(false);
+    }
 }
 
 void ShowFpsEffect::reconfigure(ReconfigureFlags)
@@ -67,6 +72,7 @@ void ShowFpsEffect::reconfigure(ReconfigureFlags)
     m_showNoBenchmark = ShowFpsConfig::showNoBenchmark();
     m_showGraph = ShowFpsConfig::showGraph();
     m_colorizeText = ShowFpsConfig::colorizeText();
+    m_showEffectCosts = ShowFpsConfig::showEffectCosts();
     const QSize screenSize = effects->virtualScreenSize();
     if (x == -10000) { // there's no -0 :(
         x = screenSize.width() - 2 * NUM_PAINTS - FPS_WIDTH;
@@ -117,6 +123,26 @@ void ShowFpsEffect::reconfigure(ReconfigureFlags)
         textAlign = Qt::AlignTop | Qt::AlignRight;
         break;
     }
+
+    // don't turn off the profiler if someone else has enabled it
+    if (m_showEffectCosts && !effects->isEffectProfilingEnabled()) {
+        effects->setEffectProfilingEnabled(true);
+        m_profilingEnabledByUs = true;
+    } else if (!m_showEffectCosts && m_profilingEnabledByUs) {
+        effects->setEffectProfilingEnabled(false);
+        m_profilingEnabledByUs = false;
+    }
+    if (m_showEffectCosts) {
+        // below the "not a benchmark" message
+        const int lineHeight = QFontMetrics(textFont).height();
+        m_effectCostsRect = QRect(fps_rect.left(), fps_rect.bottom() + 2 * lineHeight,
+                                  fps_rect.width(), (MAX_EFFECT_COSTS + 1) * lineHeight);
+    } else {
+        m_effectCostsRect = QRect();
+    }
+    m_effectCosts.clear();
+    m_effectCostsText.reset();
+    m_effectCostsTimer.invalidate();
 }
 
 void ShowFpsEffect::prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseconds presentTime)
@@ -127,6 +153,7 @@ void ShowFpsEffect::prePaintScreen(ScreenPrePaintData &data, std::chrono::millis
     }
     effects->prePaintScreen(data, presentTime);
     data.paint += fps_rect;
+    data.paint += m_effectCostsRect;
 
     paint_size[paints_pos] = 0;
     t.restart();
@@ -171,6 +198,9 @@ void ShowFpsEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData
             ++fps; // count all frames in the last second
         }
     }
+    if (m_showEffectCosts) {
+        updateEffectCosts();
+    }
     if (effects->isOpenGLCompositing()) {
         paintGL(fps, data.projectionMatrix());
         glFinish(); // make sure all rendering is done
@@ -254,6 +284,16 @@ void ShowFpsEffect::paintGL(int fps, const QMatrix4x4 &projectionMatrix)
         effects->addRepaint(fpsTextRect);
     }
 
+    if (m_effectCostsText) {
+        m_effectCostsText->bind();
+        ShaderBinder binder(ShaderTrait::MapTexture);
+        QMatrix4x4 mvp = projectionMatrix;
+        mvp.translate(m_effectCostsRect.x(), m_effectCostsRect.y());
+        binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+        m_effectCostsText->render(m_effectCostsRect);
+        m_effectCostsText->unbind();
+    }
+
     // Paint paint sizes
     glDisable(GL_BLEND);
 }
@@ -290,6 +330,10 @@ void ShowFpsEffect::paintQPainter(int fps)
     painter->setPen(Qt::black);
     painter->drawText(fpsTextRect, textAlign, QString::number(fps));
 
+    if (m_showEffectCosts) {
+        painter->drawImage(m_effectCostsRect.topLeft(), effectCostsImage());
+    }
+
     painter->restore();
 }
 
@@ -423,6 +467,62 @@ void ShowFpsEffect::postPaintScreen()
         paints_pos = 0;
     }
     effects->addRepaint(fps_rect);
+    effects->addRepaint(m_effectCostsRect);
+}
+
+void ShowFpsEffect::updateEffectCosts()
+{
+    // the averages change slowly, no need to rebuild the texture every frame
+    if (m_effectCostsTimer.isValid() && m_effectCostsTimer.elapsed() < 500) {
+        return;
+    }
+    m_effectCostsTimer.start();
+
+    m_effectCosts = effects->effectCosts();
+    if (m_effectCosts.count() > MAX_EFFECT_COSTS) {
+        m_effectCosts.resize(MAX_EFFECT_COSTS);
+    }
+    if (effects->isOpenGLCompositing()) {
+        m_effectCostsText.reset(new GLTexture(effectCostsImage()));
+    }
+}
+
+QImage ShowFpsEffect::effectCostsImage() const
+{
+    QImage im(m_effectCostsRect.size(), QImage::Format_ARGB32);
+    QColor background(255, 255, 255);
+    background.setAlphaF(alpha);
+    im.fill(background);
+
+    QPainter painter(&im);
+    painter.setFont(textFont);
+    painter.setPen(Qt::black);
+
+    const int lineHeight = QFontMetrics(textFont).height();
+    const int columnWidth = im.width() / 4;
+    QRect nameRect(2, 0, im.width() - 2 * columnWidth - 4, lineHeight);
+    QRect cpuRect(nameRect.right(), 0, columnWidth, lineHeight);
+    QRect gpuRect(cpuRect.right(), 0, columnWidth, lineHeight);
+
+    painter.drawText(cpuRect, Qt::AlignRight, i18nc("CPU time in milliseconds", "CPU ms"));
+    painter.drawText(gpuRect, Qt::AlignRight, i18nc("GPU time in milliseconds", "GPU ms"));
+
+    auto milliseconds = [](std::chrono::nanoseconds duration) {
+        return QString::number(std::chrono::duration<double, std::milli>(duration).count(), 'f', 2);
+    };
+
+    for (const EffectsHandler::EffectCost &cost : m_effectCosts) {
+        nameRect.translate(0, lineHeight);
+        cpuRect.translate(0, lineHeight);
+        gpuRect.translate(0, lineHeight);
+
+        const QString name = cost.name.isEmpty() ? i18nc("Rendering done by KWin, not by an effect", "Scene") : cost.name;
+        painter.drawText(nameRect, Qt::AlignLeft, painter.fontMetrics().elidedText(name, Qt::ElideRight, nameRect.width()));
+        painter.drawText(cpuRect, Qt::AlignRight, milliseconds(cost.cpuTime));
+        painter.drawText(gpuRect, Qt::AlignRight, cost.gpuTime.count() ? milliseconds(cost.gpuTime) : QStringLiteral("-"));
+    }
+    painter.end();
+    return im;
 }
 
 QImage ShowFpsEffect::fpsTextImage(int fps)
@@ -33,6 +33,7 @@ class ShowFpsEffect
     Q_PROPERTY(bool showGraph READ configuredShowGraph)
     Q_PROPERTY(bool showNoBenchmark READ configuredShowNoBenchmark)
     Q_PROPERTY(bool colorizeText READ configuredColorizeText)
+    Q_PROPERTY(bool showEffectCosts READ configuredShowEffectCosts)
 public:
     ShowFpsEffect();
     ~ShowFpsEffect() override;
@@ -92,6 +93,10 @@ public:
     {
         return m_colorizeText;
     }
+    bool configuredShowEffectCosts() const
+    {
+        return m_showEffectCosts;
+    }
 
 private:
     void paintGL(int fps, const QMatrix4x4 &projectionMatrix);
@@ -100,6 +105,8 @@ private:
     void paintDrawSizeGraph(int x, int y);
     void paintGraph(int x, int y, QList<int> values, QList<int> lines, bool colorize);
     QImage fpsTextImage(int fps);
+    void updateEffectCosts();
+    QImage effectCostsImage() const;
     QElapsedTimer t;
     enum {
         NUM_PAINTS = 100,
@@ -116,6 +123,12 @@ private:
     bool m_showNoBenchmark;
     bool m_showGraph;
     bool m_colorizeText;
+    bool m_showEffectCosts;
+    bool m_profilingEnabledByUs = false;
+    QVector<EffectsHandler::EffectCost> m_effectCosts;
+    QElapsedTimer m_effectCostsTimer;
+    QRect m_effectCostsRect;
+    QScopedPointer<GLTexture> m_effectCostsText;
     int detectedMaxFps;
     int x;
     int y;
@@ -15,6 +15,8 @@
 // KConfigSkeleton
 #include "slideconfig.h"
 
+#include <kwinglutils.h>
+
 #include <cmath>
 
 namespace KWin
@@ -35,6 +37,10 @@ SlideEffect::SlideEffect()
             this, &SlideEffect::windowAdded);
     connect(effects, &EffectsHandler::windowDeleted,
             this, &SlideEffect::windowDeleted);
+    connect(effects, &EffectsHandler::windowDamaged,
+            this, &SlideEffect::windowDamaged);
+    connect(effects, &EffectsHandler::stackingOrderChanged,
+            this, &SlideEffect::invalidateSnapshots);
     connect(effects, &EffectsHandler::numberDesktopsChanged,
             this, &SlideEffect::finishedSwitching);
     connect(effects, &EffectsHandler::screenAdded,
@@ -180,6 +186,7 @@ void SlideEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData &
     // Windows, such as docks or keep-above windows, are painted in
     // the last pass so they are above other windows.
     m_paintCtx.firstPass = true;
+    m_paintCtx.region = region;
     const int lastDesktop = m_paintCtx.visibleDesktops.last();
     for (int desktop : qAsConst(m_paintCtx.visibleDesktops)) {
         m_paintCtx.desktop = desktop;
@@ -195,7 +202,14 @@ void SlideEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData &
             m_paintCtx.translation = QPointF(m_paintCtx.translation.x(), m_paintCtx.translation.y() + h);
         }
 
+        m_paintCtx.useSnapshot = canPaintSnapshot();
+        m_paintCtx.snapshotWindows.clear();
+
         effects->paintScreen(mask, region, data);
+        // another effect may have dropped the topmost window of the snapshot
+        if (!m_paintCtx.snapshotWindows.empty()) {
+            paintSnapshot();
+        }
         m_paintCtx.firstPass = false;
     }
 }
@@ -281,6 +295,15 @@ void SlideEffect::paintWindow(EffectWindow *w, int mask, QRegion region, WindowP
         return;
     }
 
+    // The translated windows still go through the paint chain, so the other effects can
+    // do their work. They are collected in drawWindow() and end up in the snapshot.
+    if (m_paintCtx.useSnapshot && isTranslated(w)) {
+        m_paintCtx.snapshotWindow = w;
+        effects->paintWindow(w, mask, region, data);
+        m_paintCtx.snapshotWindow = nullptr;
+        return;
+    }
+
     for (EffectScreen *screen : effects->screens()) {
         QPoint translation = getDrawCoords(m_paintCtx.translation, screen);
         if (isTranslated(w)) {
@@ -301,6 +324,199 @@ void SlideEffect::paintWindow(EffectWindow *w, int mask, QRegion region, WindowP
     }
 }
 
+void SlideEffect::drawWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data)
+{
+    if (w != m_paintCtx.snapshotWindow) {
+        effects->drawWindow(w, mask, region, data);
+        return;
+    }
+
+    // The snapshot takes the place of the topmost translated window.
+    m_paintCtx.snapshotWindows.push_back(SnapshotWindow{w, mask, data});
+    if (w == m_paintCtx.lastSnapshotWindow) {
+        paintSnapshot();
+    }
+}
+
+/**
+ * Decide whether the translated windows of the desktop in the current pass can be painted
+ * from a snapshot. They must not be interleaved with windows that are not translated,
+ * otherwise the stacking order would change.
+ */
+bool SlideEffect::canPaintSnapshot()
+{
+    m_paintCtx.snapshotWindow = nullptr;
+    m_paintCtx.lastSnapshotWindow = nullptr;
+    if (!effects->isOpenGLCompositing() || m_liveDesktops.contains(m_paintCtx.desktop)) {
+        return false;
+    }
+
+    EffectWindow *lastTranslated = nullptr;
+    bool translated = false;
+    bool otherAbove = false;
+    const auto windows = effects->stackingOrder();
+    for (EffectWindow *w : windows) {
+        if (!isPainted(w)) {
+            continue;
+        }
+        // closed windows are only painted while another effect animates them
+        if (w->isDeleted()) {
+            return false;
+        }
+        if (isTranslated(w)) {
+            if (otherAbove) {
+                return false;
+            }
+            translated = true;
+            lastTranslated = w;
+        } else if (translated) {
+            otherAbove = true;
+        }
+    }
+    m_paintCtx.lastSnapshotWindow = lastTranslated;
+    return translated;
+}
+
+SlideEffect::SnapshotWindowState SlideEffect::snapshotWindowState(const SnapshotWindow &window)
+{
+    return SnapshotWindowState{
+        .window = window.window,
+        .mask = window.mask,
+        .opacity = window.data.opacity(),
+        .brightness = window.data.brightness(),
+        .saturation = window.data.saturation(),
+        .translation = window.data.translation(),
+        .scale = window.data.scale(),
+    };
+}
+
+bool SlideEffect::SnapshotWindowState::operator==(const SnapshotWindowState &other) const
+{
+    return window == other.window
+        && mask == other.mask
+        && qFuzzyCompare(opacity, other.opacity)
+        && qFuzzyCompare(brightness, other.brightness)
+        && qFuzzyCompare(saturation, other.saturation)
+        && translation == other.translation
+        && scale == other.scale;
+}
+
+GLTexture *SlideEffect::renderSnapshot(EffectScreen *screen)
+{
+    DesktopSnapshot &snapshot = m_snapshots[std::make_pair(m_paintCtx.desktop, screen)];
+
+    const QRect geometry = screen->geometry();
+    const QSize textureSize = geometry.size() * screen->devicePixelRatio();
+    if (!snapshot.texture || snapshot.texture->size() != textureSize) {
+        snapshot.texture = std::make_unique<GLTexture>(GL_RGBA8, textureSize);
+        snapshot.texture->setFilter(GL_LINEAR);
+        snapshot.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        snapshot.fbo = std::make_unique<GLFramebuffer>(snapshot.texture.get());
+        snapshot.isDirty = true;
+    }
+    if (!snapshot.fbo->valid()) {
+        return nullptr;
+    }
+
+    // The other effects may paint the windows differently now
+    QVector<SnapshotWindowState> windowStates;
+    windowStates.reserve(m_paintCtx.snapshotWindows.size());
+    for (const SnapshotWindow &window : m_paintCtx.snapshotWindows) {
+        windowStates.append(snapshotWindowState(window));
+    }
+    if (windowStates != snapshot.windows) {
+        snapshot.windows = windowStates;
+        snapshot.isDirty = true;
+    }
+
+    if (!snapshot.isDirty) {
+        snapshot.consecutiveUpdates = 0;
+        return snapshot.texture.get();
+    }
+    if (++snapshot.consecutiveUpdates > 2) {
+        m_liveDesktops.insert(m_paintCtx.desktop);
+    }
+
+    GLFramebuffer::pushFramebuffer(snapshot.fbo.get());
+    glClearColor(0.0, 0.0, 0.0, 0.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    QMatrix4x4 projectionMatrix;
+    projectionMatrix.ortho(QRect(0, 0, geometry.width(), geometry.height()));
+
+    // The windows are rendered without the drawWindow() hooks of other effects, effects such
+    // as blur would only see the empty snapshot behind the windows.
+    for (const SnapshotWindow &window : m_paintCtx.snapshotWindows) {
+        if (!window.window->expandedGeometry().intersects(geometry)) {
+            continue;
+        }
+        WindowPaintData data(window.data);
+        data += QPoint(-geometry.x(), -geometry.y());
+        data.setProjectionMatrix(projectionMatrix);
+
+        effects->renderWindow(window.window, window.mask | PAINT_WINDOW_TRANSFORMED | PAINT_WINDOW_TRANSLUCENT, infiniteRegion(), data);
+    }
+
+    GLFramebuffer::popFramebuffer();
+    snapshot.isDirty = false;
+    return snapshot.texture.get();
+}
+
+void SlideEffect::paintSnapshot()
+{
+    const QMatrix4x4 screenProjectionMatrix = m_paintCtx.snapshotWindows.front().data.screenProjectionMatrix();
+
+    for (EffectScreen *screen : effects->screens()) {
+        const QRect geometry = screen->geometry();
+        const QRect target = geometry.translated(getDrawCoords(m_paintCtx.translation, screen));
+
+        // Same clip as for individual windows, every desktop only shows up on its own screen.
+        const QRegion clip = m_paintCtx.region.intersected(target).intersected(geometry);
+        if (clip.isEmpty()) {
+            continue;
+        }
+
+        GLTexture *texture = renderSnapshot(screen);
+        if (!texture) {
+            continue;
+        }
+
+        ShaderBinder binder(ShaderTrait::MapTexture);
+        QMatrix4x4 mvp = screenProjectionMatrix;
+        mvp.translate(target.x(), target.y());
+        binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        glEnable(GL_SCISSOR_TEST);
+        texture->bind();
+        texture->render(effects->mapToRenderTarget(clip), target, true);
+        texture->unbind();
+        glDisable(GL_SCISSOR_TEST);
+        glDisable(GL_BLEND);
+    }
+    m_paintCtx.snapshotWindows.clear();
+}
+
+void SlideEffect::windowDamaged(EffectWindow *w)
+{
+    if (!isTranslated(w)) {
+        return;
+    }
+    for (auto &[key, snapshot] : m_snapshots) {
+        if (w->isOnDesktop(key.first)) {
+            snapshot.isDirty = true;
+        }
+    }
+}
+
+void SlideEffect::invalidateSnapshots()
+{
+    for (auto &[key, snapshot] : m_snapshots) {
+        snapshot.isDirty = true;
+    }
+}
+
 void SlideEffect::postPaintScreen()
 {
     if (m_state == State::ActiveAnimation && !m_motionX.isMoving() && !m_motionY.isMoving()) {
@@ -402,6 +618,11 @@ void SlideEffect::finishedSwitching()
 
     m_windowData.clear();
     m_paintCtx.fullscreenWindows.clear();
+    if (!m_snapshots.empty()) {
+        effects->makeOpenGLContextCurrent();
+        m_snapshots.clear();
+    }
+    m_liveDesktops.clear();
     m_movingWindow = nullptr;
     m_state = State::Inactive;
     m_lastPresentTime = std::chrono::milliseconds::zero();
@@ -484,6 +705,7 @@ void SlideEffect::windowAdded(EffectWindow *w)
     }
     w->setData(WindowForceBackgroundContrastRole, QVariant(true));
     w->setData(WindowForceBlurRole, QVariant(true));
+    invalidateSnapshots();
 
     m_windowData[w] = WindowData{
         .visibilityRef = EffectWindowVisibleRef(w, EffectWindow::PAINT_DISABLED_BY_DESKTOP),
@@ -501,6 +723,7 @@ void SlideEffect::windowDeleted(EffectWindow *w)
     m_elevatedWindows.removeAll(w);
     m_windowData.remove(w);
     m_paintCtx.fullscreenWindows.removeAll(w);
+    invalidateSnapshots();
 }
 
 /*
@@ -17,9 +17,16 @@
 
 #include "springmotion.h"
 
+#include <map>
+#include <memory>
+#include <vector>
+
 namespace KWin
 {
 
+class GLFramebuffer;
+class GLTexture;
+
 /*
  * How it Works:
  *
@@ -64,6 +71,7 @@ public:
 
     void prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::chrono::milliseconds presentTime) override;
     void paintWindow(EffectWindow *w, int mask, QRegion region, WindowPaintData &data) override;
+    void drawWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data) override;
 
     bool isActive() const override;
     int requestedEffectChainPosition() const override;
@@ -81,6 +89,8 @@ private Q_SLOTS:
     void desktopChangingCancelled();
     void windowAdded(EffectWindow *w);
     void windowDeleted(EffectWindow *w);
+    void windowDamaged(EffectWindow *w);
+    void invalidateSnapshots();
 
 private:
     QPoint getDrawCoords(QPointF pos, EffectScreen *screen);
@@ -92,6 +102,30 @@ private:
     QPointF forcePositivePosition(QPointF p) const;
     void optimizePath(); // Find the best path to target desktop
 
+    bool canPaintSnapshot();
+    void paintSnapshot();
+    GLTexture *renderSnapshot(EffectScreen *screen);
+
+    struct SnapshotWindow
+    {
+        EffectWindow *window;
+        int mask;
+        WindowPaintData data;
+    };
+    struct SnapshotWindowState
+    {
+        EffectWindow *window;
+        int mask;
+        qreal opacity;
+        qreal brightness;
+        qreal saturation;
+        QVector3D translation;
+        QVector3D scale;
+
+        bool operator==(const SnapshotWindowState &other) const;
+    };
+    static SnapshotWindowState snapshotWindowState(const SnapshotWindow &window);
+
     void startAnimation(int old, int current, EffectWindow *movingWindow = nullptr);
     void prepareSwitching();
     void finishedSwitching();
@@ -131,8 +165,34 @@ private:
         QPoint currentPos;
         QVector<int> visibleDesktops;
         EffectWindowList fullscreenWindows;
+
+        QRegion region;
+        bool useSnapshot;
+        // the translated windows that went through the paint chain, they end up in the snapshot
+        std::vector<SnapshotWindow> snapshotWindows;
+        EffectWindow *snapshotWindow = nullptr;
+        EffectWindow *lastSnapshotWindow = nullptr;
     } m_paintCtx;
 
+    /**
+     * The translated windows of a desktop on a screen, rendered once and moved around as a
+     * whole while sliding. Snapshots are rendered again only if a window on the desktop
+     * gets damaged.
+     */
+    struct DesktopSnapshot
+    {
+        std::unique_ptr<GLTexture> texture;
+        std::unique_ptr<GLFramebuffer> fbo;
+        bool isDirty = true;
+        // how the windows were painted when the snapshot got rendered
+        QVector<SnapshotWindowState> windows;
+        // the number of frames in a row in which the snapshot had to be rendered again
+        int consecutiveUpdates = 0;
+    };
+    std::map<std::pair<int, EffectScreen *>, DesktopSnapshot> m_snapshots;
+    // desktops whose content changes every frame, a snapshot would only add a copy
+    QSet<int> m_liveDesktops;
+
     struct WindowData
     {
         EffectWindowVisibleRef visibilityRef;
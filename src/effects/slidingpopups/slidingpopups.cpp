@@ -580,4 +580,14 @@ bool SlidingPopupsEffect::isActive() const
     return !m_animations.isEmpty();
 }
 
+Effect::PaintHooks SlidingPopupsEffect::paintHooks() const
+{
+    return PrePaintWindowHook | PaintWindowHook | PostPaintWindowHook;
+}
+
+bool SlidingPopupsEffect::isActiveForWindow(EffectWindow *w) const
+{
+    return m_animations.contains(w);
+}
+
 } // namespace
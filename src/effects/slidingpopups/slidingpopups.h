@@ -37,6 +37,8 @@ public:
     void postPaintWindow(EffectWindow *w) override;
     void reconfigure(ReconfigureFlags flags) override;
     bool isActive() const override;
+    PaintHooks paintHooks() const override;
+    bool isActiveForWindow(EffectWindow *w) const override;
 
     int requestedEffectChainPosition() const override
     {
@@ -10,6 +10,8 @@
 #include "wobblywindows.h"
 #include "wobblywindowsconfig.h"
 
+#include <kwinglutils.h>
+
 #include <cmath>
 
 //#define COMPUTE_STATS
@@ -119,6 +121,25 @@ static const ParameterSet set_4 = {
 
 static const ParameterSet pset[5] = {set_0, set_1, set_2, set_3, set_4};
 
+// The same bicubic bezier surface as computeBezierPoint(), with the control points
+// relative to the top-left corner of the frame geometry
+static const char s_deformation[] =
+    "uniform vec2 controlPoints[16];\n"
+    "uniform vec2 frameSize;\n"
+    "\n"
+    "vec2 deformVertex(vec2 position)\n"
+    "{\n"
+    "    vec2 t = position / frameSize;\n"
+    "    vec2 s = vec2(1.0) - t;\n"
+    "    vec4 px = vec4(s.x * s.x * s.x, 3.0 * s.x * s.x * t.x, 3.0 * s.x * t.x * t.x, t.x * t.x * t.x);\n"
+    "    vec4 py = vec4(s.y * s.y * s.y, 3.0 * s.y * s.y * t.y, 3.0 * s.y * t.y * t.y, t.y * t.y * t.y);\n"
+    "    vec2 row0 = px.x * controlPoints[0] + px.y * controlPoints[1] + px.z * controlPoints[2] + px.w * controlPoints[3];\n"
+    "    vec2 row1 = px.x * controlPoints[4] + px.y * controlPoints[5] + px.z * controlPoints[6] + px.w * controlPoints[7];\n"
+    "    vec2 row2 = px.x * controlPoints[8] + px.y * controlPoints[9] + px.z * controlPoints[10] + px.w * controlPoints[11];\n"
+    "    vec2 row3 = px.x * controlPoints[12] + px.y * controlPoints[13] + px.z * controlPoints[14] + px.w * controlPoints[15];\n"
+    "    return py.x * row0 + py.y * row1 + py.z * row2 + py.w * row3;\n"
+    "}\n";
+
 WobblyWindowsEffect::WobblyWindowsEffect()
 {
     initConfig<WobblyWindowsConfig>();
@@ -127,6 +148,12 @@ WobblyWindowsEffect::WobblyWindowsEffect()
     connect(effects, &EffectsHandler::windowStepUserMovedResized, this, &WobblyWindowsEffect::slotWindowStepUserMovedResized);
     connect(effects, &EffectsHandler::windowFinishUserMovedResized, this, &WobblyWindowsEffect::slotWindowFinishUserMovedResized);
     connect(effects, &EffectsHandler::windowMaximizedStateChanged, this, &WobblyWindowsEffect::slotWindowMaximizeStateChanged);
+
+    m_deformationShader.reset(createDeformationShader(s_deformation));
+    if (!m_deformationShader->isValid()) {
+        qCDebug(KWIN_WOBBLYWINDOWS) << "Failed to create the deformation shader, falling back to deforming on the CPU";
+        m_deformationShader.reset();
+    }
 }
 
 WobblyWindowsEffect::~WobblyWindowsEffect()
@@ -244,6 +271,11 @@ void WobblyWindowsEffect::prePaintScreen(ScreenPrePaintData &data, std::chrono::
 
 static const std::chrono::milliseconds integrationStep(10);
 
+// If a frame is very late, e.g. after the compositor was blocked, catching up with every
+// missed integration step would only make the next frame late as well. Only the most
+// recent steps are integrated, the mesh just lags behind for a moment.
+static const int maxIntegrationSteps = 5;
+
 void WobblyWindowsEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::chrono::milliseconds presentTime)
 {
     auto infoIt = windows.find(w);
@@ -254,6 +286,10 @@ void WobblyWindowsEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &da
         // opaque wobbly windows.
         data.opaque = QRegion();
 
+        if (presentTime - infoIt->clock > maxIntegrationSteps * integrationStep) {
+            infoIt->clock = presentTime - maxIntegrationSteps * integrationStep;
+        }
+
         while ((presentTime - infoIt->clock).count() > 0) {
             const auto delta = std::min(presentTime - infoIt->clock, integrationStep);
             infoIt->clock += delta;
@@ -293,15 +329,75 @@ void WobblyWindowsEffect::deform(EffectWindow *w, int mask, WindowPaintData &dat
             right = qMax(right, quads[i].right());
             bottom = qMax(bottom, quads[i].bottom());
         }
-        QRectF dirtyRect(
-            left * data.xScale() + w->x() + data.xTranslation(),
-            top * data.yScale() + w->y() + data.yTranslation(),
-            (right - left + 1.0) * data.xScale(),
-            (bottom - top + 1.0) * data.yScale());
-        // Expand the dirty region by 1px to fix potential round/floor issues.
-        dirtyRect.adjust(-1.0, -1.0, 1.0, 1.0);
-        m_updateRegion = m_updateRegion.united(dirtyRect.toRect());
+        addDirtyRect(w, data, left, top, right, bottom);
+    }
+}
+
+void WobblyWindowsEffect::updateDeformation(EffectWindow *w, int mask, WindowPaintData &data, GLShader *shader)
+{
+    const auto it = windows.constFind(w);
+    if (it == windows.constEnd()) {
+        return;
+    }
+    const WindowWobblyInfos &wwi = *it;
+
+    const QRectF frame = w->frameGeometry();
+    const bool deformed = !(mask & PAINT_SCREEN_TRANSFORMED);
+
+    GLfloat controlPoints[16 * 2];
+    for (unsigned int j = 0; j < 4; ++j) {
+        for (unsigned int i = 0; i < 4; ++i) {
+            const unsigned int index = i + j * wwi.width;
+            if (deformed) {
+                controlPoints[2 * index] = wwi.position[index].x - frame.x();
+                controlPoints[2 * index + 1] = wwi.position[index].y - frame.y();
+            } else {
+                // evenly spaced control points leave the window as it is
+                controlPoints[2 * index] = i * frame.width() / 3.0;
+                controlPoints[2 * index + 1] = j * frame.height() / 3.0;
+            }
+        }
+    }
+    glUniform2fv(shader->uniformLocation("controlPoints"), 16, controlPoints);
+    shader->setUniform("frameSize", QVector2D(frame.width(), frame.height()));
+
+    if (!deformed) {
+        return;
     }
+
+    // The bezier surface can bulge out anywhere, not only along the edges, so every vertex
+    // of the grid counts for the repaint. Only the positions are computed on the CPU.
+    const QRectF expanded = w->expandedGeometry();
+    const QRectF visibleRect(expanded.topLeft() - frame.topLeft(), expanded.size());
+    double left = 0.0;
+    double top = 0.0;
+    double right = w->width();
+    double bottom = w->height();
+    for (int j = 0; j <= m_yTesselation; ++j) {
+        const qreal y = visibleRect.y() + j * visibleRect.height() / m_yTesselation;
+        for (int i = 0; i <= m_xTesselation; ++i) {
+            const qreal x = visibleRect.x() + i * visibleRect.width() / m_xTesselation;
+            const Pair uv = {x / frame.width(), y / frame.height()};
+            const Pair point = computeBezierPoint(wwi, uv);
+            left = qMin(left, point.x - frame.x());
+            top = qMin(top, point.y - frame.y());
+            right = qMax(right, point.x - frame.x());
+            bottom = qMax(bottom, point.y - frame.y());
+        }
+    }
+    addDirtyRect(w, data, left, top, right, bottom);
+}
+
+void WobblyWindowsEffect::addDirtyRect(EffectWindow *w, const WindowPaintData &data, double left, double top, double right, double bottom)
+{
+    QRectF dirtyRect(
+        left * data.xScale() + w->x() + data.xTranslation(),
+        top * data.yScale() + w->y() + data.yTranslation(),
+        (right - left + 1.0) * data.xScale(),
+        (bottom - top + 1.0) * data.yScale());
+    // Expand the dirty region by 1px to fix potential round/floor issues.
+    dirtyRect.adjust(-1.0, -1.0, 1.0, 1.0);
+    m_updateRegion = m_updateRegion.united(dirtyRect.toRect());
 }
 
 void WobblyWindowsEffect::postPaintScreen()
@@ -404,6 +500,10 @@ void WobblyWindowsEffect::startMovedResized(EffectWindow *w)
         initWobblyInfo(new_wwi, w->frameGeometry());
         windows[w] = new_wwi;
         redirect(w);
+        if (m_deformationShader) {
+            setShader(w, m_deformationShader.get());
+            setDeformationGrid(w, QSize(static_cast<int>(m_xTesselation), static_cast<int>(m_yTesselation)));
+        }
     }
 
     WindowWobblyInfos &wwi = windows[w];
@@ -559,12 +659,19 @@ WobblyWindowsEffect::Pair WobblyWindowsEffect::computeBezierPoint(const WindowWo
 
     Pair res = {0.0, 0.0};
 
+    // The surface is separable, so evaluate the curve of each row first and then the curve
+    // through the rows. The inner loop has no dependencies and can be vectorised.
     for (unsigned int j = 0; j < 4; ++j) {
+        // this assume the grid is 4*4
+        const Pair *row = wwi.position + j * wwi.width;
+        qreal rowX = 0.0;
+        qreal rowY = 0.0;
         for (unsigned int i = 0; i < 4; ++i) {
-            // this assume the grid is 4*4
-            res.x += px[i] * py[j] * wwi.position[i + j * wwi.width].x;
-            res.y += px[i] * py[j] * wwi.position[i + j * wwi.width].y;
+            rowX += px[i] * row[i].x;
+            rowY += px[i] * row[i].y;
         }
+        res.x += py[j] * rowX;
+        res.y += py[j] * rowY;
     }
 
     return res;
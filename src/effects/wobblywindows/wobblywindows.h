@@ -13,6 +13,8 @@
 // Include with base class for effects.
 #include <kwindeformeffect.h>
 
+#include <memory>
+
 namespace KWin
 {
 
@@ -130,6 +132,7 @@ public:
 
 protected:
     void deform(EffectWindow *w, int mask, WindowPaintData &data, WindowQuadList &quads) override;
+    void updateDeformation(EffectWindow *w, int mask, WindowPaintData &data, GLShader *shader) override;
 
 public Q_SLOTS:
     void slotWindowStartUserMovedResized(KWin::EffectWindow *w);
@@ -141,6 +144,7 @@ private:
     void startMovedResized(EffectWindow *w);
     void stepMovedResized(EffectWindow *w);
     bool updateWindowWobblyDatas(EffectWindow *w, qreal time);
+    void addDirtyRect(EffectWindow *w, const WindowPaintData &data, double left, double top, double right, double bottom);
 
     struct WindowWobblyInfos
     {
@@ -176,6 +180,9 @@ private:
 
     QRegion m_updateRegion;
 
+    // evaluates the bezier surface in the vertex shader, if supported
+    std::unique_ptr<GLShader> m_deformationShader;
+
     qreal m_stiffness;
     qreal m_drag;
     qreal m_move_factor;
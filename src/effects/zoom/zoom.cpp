@@ -263,6 +263,13 @@ void ZoomEffect::prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseco
     effects->prePaintScreen(data, presentTime);
 }
 
+bool ZoomEffect::needsOffscreenRendering() const
+{
+    // These effects read back what is behind a window from the framebuffer, which only
+    // works if the screen is not transformed while it is being painted.
+    return effects->isEffectLoaded(QStringLiteral("blur")) || effects->isEffectLoaded(QStringLiteral("contrast"));
+}
+
 ZoomEffect::OffscreenData *ZoomEffect::ensureOffscreenData(EffectScreen *screen)
 {
     const QRect rect = effects->renderTargetRect();
@@ -309,12 +316,18 @@ ZoomEffect::OffscreenData *ZoomEffect::ensureOffscreenData(EffectScreen *screen)
 
 void ZoomEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData &data)
 {
-    OffscreenData *offscreenData = ensureOffscreenData(data.screen());
-
-    // Render the scene in an offscreen texture and then upscale it.
-    GLFramebuffer::pushFramebuffer(offscreenData->framebuffer.data());
-    effects->paintScreen(mask, region, data);
-    GLFramebuffer::popFramebuffer();
+    const bool offscreen = needsOffscreenRendering();
+    if (offscreen) {
+        OffscreenData *offscreenData = ensureOffscreenData(data.screen());
+
+        // Render the scene in an offscreen texture and then upscale it.
+        GLFramebuffer::pushFramebuffer(offscreenData->framebuffer.data());
+        effects->paintScreen(mask, region, data);
+        GLFramebuffer::popFramebuffer();
+    } else if (!m_offscreenData.isEmpty()) {
+        qDeleteAll(m_offscreenData);
+        m_offscreenData.clear();
+    }
 
     data *= QVector2D(zoom, zoom);
     const QSize screenSize = effects->virtualScreenSize();
@@ -377,22 +390,28 @@ void ZoomEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData &d
         }
     }
 
-    // Render transformed offscreen texture.
-    glClearColor(0.0, 0.0, 0.0, 0.0);
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    QMatrix4x4 matrix;
-    matrix.translate(data.translation());
-    matrix.scale(data.scale());
-
-    auto shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
-    shader->setUniform(GLShader::ModelViewProjectionMatrix, data.projectionMatrix() * matrix);
-    for (OffscreenData *data : std::as_const(m_offscreenData)) {
-        data->texture->bind();
-        data->vbo->render(GL_TRIANGLES);
-        data->texture->unbind();
+    if (offscreen) {
+        // Render transformed offscreen texture.
+        glClearColor(0.0, 0.0, 0.0, 0.0);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        QMatrix4x4 matrix;
+        matrix.translate(data.translation());
+        matrix.scale(data.scale());
+
+        auto shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
+        shader->setUniform(GLShader::ModelViewProjectionMatrix, data.projectionMatrix() * matrix);
+        for (OffscreenData *data : std::as_const(m_offscreenData)) {
+            data->texture->bind();
+            data->vbo->render(GL_TRIANGLES);
+            data->texture->unbind();
+        }
+        ShaderManager::instance()->popShader();
+    } else {
+        // Paint the scene with the zoomed-in screen transform, only the pixels that end up
+        // in the visible part of the screen are rendered.
+        effects->paintScreen(mask, region, data);
     }
-    ShaderManager::instance()->popShader();
 
     if (mousePointer != MousePointerHide) {
         // Draw the mouse-texture at the position matching to zoomed-in image of the desktop. Hiding the
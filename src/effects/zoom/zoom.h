@@ -113,6 +113,7 @@ private:
     };
 
     GLTexture *ensureCursorTexture();
+    bool needsOffscreenRendering() const;
     OffscreenData *ensureOffscreenData(EffectScreen *screen);
     void markCursorTextureDirty();
 
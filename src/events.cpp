@@ -1336,9 +1336,11 @@ void Window::clientMessageEvent(xcb_client_message_event_t *e)
     if (e->type == atoms->wl_surface_id) {
         m_pendingSurfaceId = e->data.data32[0];
         if (auto w = waylandServer()) {
-            if (auto s = KWaylandServer::SurfaceInterface::get(m_pendingSurfaceId, w->xWaylandConnection())) {
-                setSurface(s);
-            }
+            w->associateXwaylandSurfaceId(this, m_pendingSurfaceId);
+        }
+    } else if (e->type == atoms->wl_surface_serial) {
+        if (auto w = waylandServer()) {
+            w->associateXwaylandSurfaceSerial(this, (quint64(e->data.data32[1]) << 32) | e->data.data32[0]);
         }
     }
 }
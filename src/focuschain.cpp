@@ -15,6 +15,60 @@ namespace KWin
 
 KWIN_SINGLETON_FACTORY_VARIABLE(FocusChain, s_manager)
 
+FocusChain::Chain::Chain(const Chain &other)
+{
+    *this = other;
+}
+
+FocusChain::Chain &FocusChain::Chain::operator=(const Chain &other)
+{
+    if (this == &other) {
+        return *this;
+    }
+    // The positions point into the list they have been created for, so they can't be copied
+    m_windows.clear();
+    m_positions.clear();
+    for (Window *window : other.m_windows) {
+        append(window);
+    }
+    return *this;
+}
+
+FocusChain::Chain::const_iterator FocusChain::Chain::find(Window *window) const
+{
+    auto it = m_positions.constFind(window);
+    if (it == m_positions.constEnd()) {
+        return m_windows.cend();
+    }
+    return *it;
+}
+
+void FocusChain::Chain::append(Window *window)
+{
+    insert(m_windows.cend(), window);
+}
+
+void FocusChain::Chain::prepend(Window *window)
+{
+    insert(m_windows.cbegin(), window);
+}
+
+void FocusChain::Chain::insert(const_iterator before, Window *window)
+{
+    Q_ASSERT(!contains(window));
+    m_positions.insert(window, m_windows.insert(before, window));
+}
+
+void FocusChain::Chain::remove(Window *window)
+{
+    auto it = m_positions.find(window);
+    if (it == m_positions.end()) {
+        return;
+    }
+    m_windows.erase(*it);
+    m_positions.erase(it);
+}
+
 FocusChain::FocusChain(QObject *parent)
     : QObject(parent)
     , m_separateScreenFocus(false)
@@ -32,9 +86,9 @@ void FocusChain::remove(Window *window)
     for (auto it = m_desktopFocusChains.begin();
          it != m_desktopFocusChains.end();
          ++it) {
-        it.value().removeAll(window);
+        it.value().remove(window);
     }
-    m_mostRecentlyUsed.removeAll(window);
+    m_mostRecentlyUsed.remove(window);
 }
 
 void FocusChain::addDesktop(VirtualDesktop *desktop)
@@ -62,8 +116,8 @@ Window *FocusChain::getForActivation(VirtualDesktop *desktop, Output *output) co
         return nullptr;
     }
     const auto &chain = it.value();
-    for (int i = chain.size() - 1; i >= 0; --i) {
-        auto tmp = chain.at(i);
+    for (auto window = chain.rbegin(); window != chain.rend(); ++window) {
+        auto tmp = *window;
         // TODO: move the check into Window
         if (!tmp->isShade() && tmp->isShown() && tmp->isOnCurrentActivity()
             && (!m_separateScreenFocus || tmp->output() == output)) {
@@ -108,7 +162,7 @@ void FocusChain::update(Window *window, FocusChain::Change change)
             if (window->isOnDesktop(it.key())) {
                 updateWindowInChain(window, change, chain);
             } else {
-                chain.removeAll(window);
+                chain.remove(window);
             }
         }
     }
@@ -133,9 +187,9 @@ void FocusChain::insertWindowIntoChain(Window *window, Chain &chain)
     if (chain.contains(window)) {
         return;
     }
-    if (m_activeWindow && m_activeWindow != window && !chain.empty() && chain.last() == m_activeWindow) {
+    if (m_activeWindow && m_activeWindow != window && !chain.isEmpty() && chain.last() == m_activeWindow) {
         // Add it after the active window
-        chain.insert(chain.size() - 1, window);
+        chain.insert(std::prev(chain.end()), window);
     } else {
         // Otherwise add as the first one
         chain.append(window);
@@ -165,13 +219,13 @@ void FocusChain::moveAfterWindowInChain(Window *window, Window *reference, Chain
         return;
     }
     if (Window::belongToSameApplication(reference, window)) {
-        chain.removeAll(window);
-        chain.insert(chain.indexOf(reference), window);
+        chain.remove(window);
+        chain.insert(chain.find(reference), window);
     } else {
-        chain.removeAll(window);
-        for (int i = chain.size() - 1; i >= 0; --i) {
-            if (Window::belongToSameApplication(reference, chain.at(i))) {
-                chain.insert(i, window);
+        chain.remove(window);
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            if (Window::belongToSameApplication(reference, *it)) {
+                chain.insert(std::next(it).base(), window);
                 break;
             }
         }
@@ -191,14 +245,14 @@ Window *FocusChain::nextMostRecentlyUsed(Window *reference) const
     if (m_mostRecentlyUsed.isEmpty()) {
         return nullptr;
     }
-    const int index = m_mostRecentlyUsed.indexOf(reference);
-    if (index == -1) {
+    const auto it = m_mostRecentlyUsed.find(reference);
+    if (it == m_mostRecentlyUsed.end()) {
         return m_mostRecentlyUsed.first();
     }
-    if (index == 0) {
+    if (it == m_mostRecentlyUsed.begin()) {
         return m_mostRecentlyUsed.last();
     }
-    return m_mostRecentlyUsed.at(index - 1);
+    return *std::prev(it);
 }
 
 // copied from activation.cpp
@@ -214,8 +268,8 @@ Window *FocusChain::nextForDesktop(Window *reference, VirtualDesktop *desktop) c
         return nullptr;
     }
     const auto &chain = it.value();
-    for (int i = chain.size() - 1; i >= 0; --i) {
-        auto window = chain.at(i);
+    for (auto candidate = chain.rbegin(); candidate != chain.rend(); ++candidate) {
+        auto window = *candidate;
         if (isUsableFocusCandidate(window, reference)) {
             return window;
         }
@@ -225,12 +279,12 @@ Window *FocusChain::nextForDesktop(Window *reference, VirtualDesktop *desktop) c
 
 void FocusChain::makeFirstInChain(Window *window, Chain &chain)
 {
-    chain.removeAll(window);
+    chain.remove(window);
     if (options->moveMinimizedWindowsToEndOfTabBoxFocusChain()) {
         if (window->isMinimized()) { // add it before the first minimized ...
-            for (int i = chain.count() - 1; i >= 0; --i) {
-                if (chain.at(i)->isMinimized()) {
-                    chain.insert(i + 1, window);
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+                if ((*it)->isMinimized()) {
+                    chain.insert(it.base(), window);
                     return;
                 }
             }
@@ -245,7 +299,7 @@ void FocusChain::makeFirstInChain(Window *window, Chain &chain)
 
 void FocusChain::makeLastInChain(Window *window, Chain &chain)
 {
-    chain.removeAll(window);
+    chain.remove(window);
     chain.prepend(window);
 }
 
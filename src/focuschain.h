@@ -13,6 +13,8 @@
 // Qt
 #include <QHash>
 #include <QObject>
+// std
+#include <list>
 
 namespace KWin
 {
@@ -173,7 +175,65 @@ public Q_SLOTS:
     void removeDesktop(VirtualDesktop *desktop);
 
 private:
-    using Chain = QList<Window *>;
+    /**
+     * A focus chain, ordered like the most recently used chain with the first Window at the
+     * end. The position of every Window is tracked, so looking up, moving and removing a Window
+     * doesn't have to search the chain.
+     */
+    class Chain
+    {
+    public:
+        using const_iterator = std::list<Window *>::const_iterator;
+        using const_reverse_iterator = std::list<Window *>::const_reverse_iterator;
+
+        Chain() = default;
+        Chain(const Chain &other);
+        Chain &operator=(const Chain &other);
+
+        bool isEmpty() const
+        {
+            return m_windows.empty();
+        }
+        bool contains(Window *window) const
+        {
+            return m_positions.contains(window);
+        }
+        Window *first() const
+        {
+            return m_windows.front();
+        }
+        Window *last() const
+        {
+            return m_windows.back();
+        }
+        const_iterator begin() const
+        {
+            return m_windows.cbegin();
+        }
+        const_iterator end() const
+        {
+            return m_windows.cend();
+        }
+        const_reverse_iterator rbegin() const
+        {
+            return m_windows.crbegin();
+        }
+        const_reverse_iterator rend() const
+        {
+            return m_windows.crend();
+        }
+
+        const_iterator find(Window *window) const;
+        void append(Window *window);
+        void prepend(Window *window);
+        void insert(const_iterator before, Window *window);
+        void remove(Window *window);
+
+    private:
+        std::list<Window *> m_windows;
+        QHash<Window *, std::list<Window *>::iterator> m_positions;
+    };
+
     /**
      * @brief Makes @p window the first Window in the given focus @p chain.
      *
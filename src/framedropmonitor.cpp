@@ -0,0 +1,119 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "framedropmonitor.h"
+#include "ftrace.h"
+#include "utils/common.h"
+
+#include <QDBusConnection>
+#include <QDateTime>
+#include <QMetaEnum>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+namespace KWin
+{
+KWIN_SINGLETON_FACTORY(KWin::FrameDropMonitor)
+
+// How much of the trace is written when a frame is missed
+static const std::chrono::seconds s_snapshotDuration(5);
+// The minimum interval between two snapshots
+static const qint64 s_snapshotInterval = 60 * 1000;
+
+FrameDropMonitor::FrameDropMonitor(QObject *parent)
+    : QObject(parent)
+{
+    QDBusConnection::sessionBus().registerObject(QStringLiteral("/FrameDrops"), this, QDBusConnection::ExportScriptableContents);
+}
+
+FrameDropMonitor::~FrameDropMonitor()
+{
+    QDBusConnection::sessionBus().unregisterObject(QStringLiteral("/FrameDrops"));
+    s_self = nullptr;
+}
+
+void FrameDropMonitor::reportFrame(const Frame &frame)
+{
+    ++m_frameCount;
+
+    // A frame that is presented up to half a refresh cycle after the expected time still
+    // made it into the vblank, the expected presentation time is only an estimate.
+    if (frame.presentationTimestamp <= frame.expectedPresentationTimestamp + frame.vblankInterval / 2) {
+        return;
+    }
+
+    const std::chrono::nanoseconds budget = frame.expectedPresentationTimestamp - frame.renderTimestamp;
+    Reason reason;
+    if (frame.renderTimestamp > frame.scheduledRenderTimestamp + frame.safetyMargin) {
+        reason = Reason::LateRenderStart;
+    } else if (frame.cpuRenderTime > budget) {
+        reason = Reason::LongCpuRenderTime;
+    } else if (frame.gpuRenderTime > budget) {
+        reason = Reason::LongGpuRenderTime;
+    } else {
+        reason = Reason::LatePresentation;
+    }
+
+    ++m_missedFrameCount;
+    ++m_missedFramesByReason[int(reason)];
+
+    qCDebug(KWIN_CORE) << "Missed a vblank:" << reason
+                       << "late by" << (frame.presentationTimestamp - frame.expectedPresentationTimestamp).count() / 1000 << "us,"
+                       << "render started" << (frame.renderTimestamp - frame.scheduledRenderTimestamp).count() / 1000 << "us late,"
+                       << "cpu" << frame.cpuRenderTime.count() / 1000 << "us,"
+                       << "gpu" << frame.gpuRenderTime.count() / 1000 << "us";
+    if (FTraceLogger::self()) {
+        fTrace("Missed vblank: ", QMetaEnum::fromType<Reason>().valueToKey(int(reason)));
+    }
+
+    maybeWriteSnapshot(reason);
+}
+
+void FrameDropMonitor::maybeWriteSnapshot(Reason reason)
+{
+    FTraceLogger *logger = FTraceLogger::self();
+    if (!logger || !logger->isBufferEnabled()) {
+        return;
+    }
+    if (m_lastSnapshot.isValid() && m_lastSnapshot.elapsed() < s_snapshotInterval) {
+        return;
+    }
+    m_lastSnapshot.start();
+
+    const QString fileName = QStringLiteral("%1/kwin-frame-drop-%2-%3.json")
+                                 .arg(QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation),
+                                      QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-hhmmss")),
+                                      QString::fromLatin1(QMetaEnum::fromType<Reason>().valueToKey(int(reason))));
+    // serializing and writing the trace takes a while, don't stall the next frames with it
+    logger->dumpBufferInBackground(fileName, s_snapshotDuration);
+    qCInfo(KWIN_CORE) << "Writing a trace of a missed vblank to" << fileName;
+}
+
+QVariantMap FrameDropMonitor::summary() const
+{
+    QVariantMap missedFramesByReason;
+    const QMetaEnum reasons = QMetaEnum::fromType<Reason>();
+    for (int i = 0; i < reasons.keyCount(); ++i) {
+        missedFramesByReason.insert(QString::fromLatin1(reasons.key(i)), m_missedFramesByReason[reasons.value(i)]);
+    }
+
+    return QVariantMap{
+        {QStringLiteral("frames"), m_frameCount},
+        {QStringLiteral("missedFrames"), m_missedFrameCount},
+        {QStringLiteral("missedFramesByReason"), missedFramesByReason},
+    };
+}
+
+void FrameDropMonitor::resetSummary()
+{
+    m_frameCount = 0;
+    m_missedFrameCount = 0;
+    std::fill(std::begin(m_missedFramesByReason), std::end(m_missedFramesByReason), 0);
+}
+
+} // namespace KWin
@@ -0,0 +1,95 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QVariantMap>
+
+#include <chrono>
+
+namespace KWin
+{
+
+/**
+ * The FrameDropMonitor collects the frames that missed the vblank they were scheduled for.
+ *
+ * Every missed frame is classified by its most likely cause. If the trace ring buffer of the
+ * FTraceLogger is enabled, the last seconds of the trace are written to disk when a frame is
+ * missed, at most once per minute, so sporadic stutter can be analysed after the fact.
+ *
+ * The statistics are available on DBus as org.kde.kwin.FrameDrops at /FrameDrops.
+ *
+ * @since 5.26
+ */
+class KWIN_EXPORT FrameDropMonitor : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.kwin.FrameDrops")
+
+public:
+    enum class Reason {
+        /**
+         * Compositing started too late to finish before the vblank, e.g. because the event
+         * loop was busy.
+         */
+        LateRenderStart,
+        /**
+         * Recording the rendering commands took longer than the available time.
+         */
+        LongCpuRenderTime,
+        /**
+         * The GPU finished rendering after the vblank.
+         */
+        LongGpuRenderTime,
+        /**
+         * The frame was finished in time but presented late, e.g. because of the driver.
+         */
+        LatePresentation,
+    };
+    Q_ENUM(Reason)
+
+    struct Frame
+    {
+        std::chrono::nanoseconds scheduledRenderTimestamp;
+        std::chrono::nanoseconds renderTimestamp;
+        std::chrono::nanoseconds expectedPresentationTimestamp;
+        std::chrono::nanoseconds presentationTimestamp;
+        std::chrono::nanoseconds cpuRenderTime;
+        std::chrono::nanoseconds gpuRenderTime;
+        std::chrono::nanoseconds vblankInterval;
+        std::chrono::nanoseconds safetyMargin;
+    };
+
+    ~FrameDropMonitor() override;
+
+    /**
+     * Checks whether the presented @p frame has missed its vblank.
+     */
+    void reportFrame(const Frame &frame);
+
+    /**
+     * Returns the number of presented frames, the number of missed frames and the number of
+     * missed frames per reason.
+     */
+    Q_SCRIPTABLE Q_INVOKABLE QVariantMap summary() const;
+    Q_SCRIPTABLE Q_INVOKABLE void resetSummary();
+
+private:
+    void maybeWriteSnapshot(Reason reason);
+
+    quint64 m_frameCount = 0;
+    quint64 m_missedFrameCount = 0;
+    quint64 m_missedFramesByReason[int(Reason::LatePresentation) + 1] = {};
+    QElapsedTimer m_lastSnapshot;
+    KWIN_SINGLETON(FrameDropMonitor)
+};
+
+} // namespace KWin
@@ -10,26 +10,38 @@
 
 #include "ftrace.h"
 
+#include <QCoreApplication>
 #include <QDBusConnection>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QScopeGuard>
 #include <QTextStream>
+#include <QThread>
+#include <QtConcurrent>
 
 namespace KWin
 {
 KWIN_SINGLETON_FACTORY(KWin::FTraceLogger)
 
+// The number of events kept in the ring buffer, roughly the last few seconds of compositing
+static const int s_bufferCapacity = 1 << 16;
+
 FTraceLogger::FTraceLogger(QObject *parent)
     : QObject(parent)
 {
+    if (qEnvironmentVariableIsSet("KWIN_PERF_TRACE_BUFFER")) {
+        setBufferEnabled(true);
+    }
     if (qEnvironmentVariableIsSet("KWIN_PERF_FTRACE")) {
         setEnabled(true);
-    } else {
-        QDBusConnection::sessionBus().registerObject(QStringLiteral("/FTrace"), this, QDBusConnection::ExportScriptableContents);
     }
+    // the buffer can only be dumped through DBus
+    QDBusConnection::sessionBus().registerObject(QStringLiteral("/FTrace"), this, QDBusConnection::ExportScriptableContents);
 }
 
 bool FTraceLogger::isEnabled() const
@@ -52,6 +64,179 @@ void FTraceLogger::setEnabled(bool enabled)
     Q_EMIT enabledChanged();
 }
 
+void FTraceLogger::setBufferEnabled(bool enabled)
+{
+    QMutexLocker lock(&m_mutex);
+    if (enabled == isBufferEnabled()) {
+        return;
+    }
+
+    if (enabled) {
+        m_buffer.reserve(s_bufferCapacity);
+    } else {
+        m_buffer.clear();
+        m_buffer.squeeze();
+        m_bufferHead = 0;
+    }
+    m_bufferEnabled.storeRelaxed(enabled);
+    Q_EMIT bufferEnabledChanged();
+}
+
+void FTraceLogger::record(Event event)
+{
+    event.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    event.thread = quint64(quintptr(QThread::currentThreadId()));
+
+    QMutexLocker lock(&m_mutex);
+    if (!isBufferEnabled()) {
+        return;
+    }
+    if (m_buffer.size() < s_bufferCapacity) {
+        m_buffer.append(std::move(event));
+    } else {
+        m_buffer[m_bufferHead] = std::move(event);
+        m_bufferHead = (m_bufferHead + 1) % s_bufferCapacity;
+    }
+}
+
+void FTraceLogger::beginSpan(const QByteArray &name, quint32 context)
+{
+    Event event;
+    event.name = name;
+    event.id = context;
+    event.phase = 'B';
+    record(std::move(event));
+}
+
+void FTraceLogger::endSpan(const QByteArray &name, quint32 context)
+{
+    Event event;
+    event.name = name;
+    event.id = context;
+    event.phase = 'E';
+    record(std::move(event));
+}
+
+void FTraceLogger::counter(const char *name, qint64 value)
+{
+    if (isEnabled()) {
+        trace(name, " value=", value);
+    }
+    if (isBufferEnabled()) {
+        Event event;
+        event.name = name;
+        event.value = value;
+        event.phase = 'C';
+        record(std::move(event));
+    }
+}
+
+void FTraceLogger::flow(const char *name, quint64 id, FlowPhase phase)
+{
+    if (isEnabled()) {
+        trace(name, " flow=", id);
+    }
+    if (isBufferEnabled()) {
+        Event event;
+        event.name = name;
+        event.id = id;
+        switch (phase) {
+        case FlowPhase::Begin:
+            event.phase = 's';
+            break;
+        case FlowPhase::Step:
+            event.phase = 't';
+            break;
+        case FlowPhase::End:
+            event.phase = 'f';
+            break;
+        }
+        record(std::move(event));
+        Q_EMIT flowRecorded(QByteArray(name), id, phase);
+    }
+}
+
+bool FTraceLogger::dumpBuffer(const QString &fileName)
+{
+    return dumpBuffer(fileName, std::chrono::nanoseconds::zero());
+}
+
+bool FTraceLogger::dumpBuffer(const QString &fileName, std::chrono::nanoseconds duration)
+{
+    return writeEvents(fileName, bufferedEvents(duration));
+}
+
+void FTraceLogger::dumpBufferInBackground(const QString &fileName, std::chrono::nanoseconds duration)
+{
+    QtConcurrent::run(&FTraceLogger::writeEvents, fileName, bufferedEvents(duration));
+}
+
+QVector<FTraceLogger::Event> FTraceLogger::bufferedEvents(std::chrono::nanoseconds duration)
+{
+    const qint64 since = duration.count() > 0
+        ? std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch() - duration).count()
+        : 0;
+
+    QVector<Event> events;
+    {
+        QMutexLocker lock(&m_mutex);
+        events.reserve(m_buffer.size());
+        for (int i = 0; i < m_buffer.size(); ++i) {
+            const Event &event = m_buffer[(m_bufferHead + i) % m_buffer.size()];
+            if (event.timestamp >= since) {
+                events.append(event);
+            }
+        }
+    }
+    return events;
+}
+
+bool FTraceLogger::writeEvents(const QString &fileName, const QVector<Event> &events)
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+    for (const Event &event : qAsConst(events)) {
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), QString::fromUtf8(event.name));
+        object.insert(QStringLiteral("pid"), pid);
+        object.insert(QStringLiteral("tid"), qint64(event.thread));
+        object.insert(QStringLiteral("ts"), event.timestamp / 1000.0);
+        switch (event.phase) {
+        case 'C':
+            object.insert(QStringLiteral("args"), QJsonObject{{QStringLiteral("value"), event.value}});
+            break;
+        case 's':
+        case 't':
+        case 'f': {
+            // Flow events are attached to a slice, give them a short one of their own
+            QJsonObject slice = object;
+            slice.insert(QStringLiteral("ph"), QStringLiteral("X"));
+            slice.insert(QStringLiteral("dur"), 1);
+            traceEvents.append(slice);
+
+            object.insert(QStringLiteral("cat"), QStringLiteral("flow"));
+            object.insert(QStringLiteral("id"), QString::number(event.id));
+            if (event.phase == 'f') {
+                object.insert(QStringLiteral("bp"), QStringLiteral("e"));
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        object.insert(QStringLiteral("ph"), QString(QLatin1Char(event.phase)));
+        traceEvents.append(object);
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to write the trace buffer to" << fileName << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(QJsonObject{{QStringLiteral("traceEvents"), traceEvents}}).toJson(QJsonDocument::Compact));
+    return true;
+}
+
 bool FTraceLogger::open()
 {
     const QString path = filePath();
@@ -115,7 +300,15 @@ QString FTraceLogger::filePath()
 
 FTraceDuration::~FTraceDuration()
 {
-    FTraceLogger::self()->trace(m_message, " end_ctx=", m_context);
+    if (FTraceLogger::self()->isEnabled()) {
+        FTraceLogger::self()->trace(m_message, " end_ctx=", m_context);
+    }
+    if (FTraceLogger::self()->isBufferEnabled()) {
+        FTraceLogger::self()->endSpan(m_message, m_context);
+        if (m_start) {
+            Q_EMIT FTraceLogger::self()->spanFinished(m_message, std::chrono::steady_clock::now() - *m_start);
+        }
+    }
 }
 
 }
@@ -16,6 +16,10 @@
 #include <QMutexLocker>
 #include <QObject>
 #include <QTextStream>
+#include <QVector>
+
+#include <chrono>
+#include <optional>
 
 namespace KWin
 {
@@ -26,19 +30,90 @@ namespace KWin
  *  Set the KWIN_PERF_FTRACE environment variable before starting the application
  *  Calling on DBus /FTrace org.kde.kwin.FTrace.setEnabled true
  * After having created the ftrace mount
+ *
+ * Additionally, the logger can record structured events (spans, counters and flows) into an
+ * in-memory ring buffer, which only keeps the most recent events and can therefore be left
+ * enabled. The buffer is enabled with the KWIN_PERF_TRACE_BUFFER environment variable or
+ * org.kde.kwin.FTrace.setBufferEnabled, and org.kde.kwin.FTrace.dumpBuffer writes it as a
+ * Chrome trace JSON file, which chrome://tracing and ui.perfetto.dev can open.
  */
 class KWIN_EXPORT FTraceLogger : public QObject
 {
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "org.kde.kwin.FTrace");
     Q_PROPERTY(bool isEnabled READ isEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool isBufferEnabled READ isBufferEnabled NOTIFY bufferEnabledChanged)
 
 public:
+    enum class FlowPhase {
+        Begin,
+        Step,
+        End,
+    };
+
     /**
      * Enabled through DBus and logging has started
      */
     bool isEnabled() const;
 
+    /**
+     * Structured events are recorded into the ring buffer
+     *
+     * @since 5.26
+     */
+    bool isBufferEnabled() const
+    {
+        return m_bufferEnabled.loadRelaxed();
+    }
+
+    /**
+     * Either the ftrace markers are written or the ring buffer records events
+     *
+     * @since 5.26
+     */
+    bool isTracing() const
+    {
+        return isEnabled() || isBufferEnabled();
+    }
+
+    /**
+     * Records the begin or end of a span. Spans on the same thread must be nested.
+     *
+     * @since 5.26
+     */
+    void beginSpan(const QByteArray &name, quint32 context);
+    void endSpan(const QByteArray &name, quint32 context);
+
+    /**
+     * Records the current @p value of the counter @p name.
+     *
+     * @since 5.26
+     */
+    void counter(const char *name, qint64 value);
+
+    /**
+     * Records a step of the flow @p id, which links related events across threads and
+     * frames, e.g. a surface commit to the frame that showed it.
+     *
+     * @since 5.26
+     */
+    void flow(const char *name, quint64 id, FlowPhase phase);
+
+    /**
+     * Writes the events of the last @p duration in the ring buffer to @p fileName.
+     *
+     * @since 5.26
+     */
+    bool dumpBuffer(const QString &fileName, std::chrono::nanoseconds duration);
+
+    /**
+     * Like dumpBuffer(), but only takes the events from the ring buffer on the calling thread
+     * and writes them to @p fileName on a worker thread.
+     *
+     * @since 5.26
+     */
+    void dumpBufferInBackground(const QString &fileName, std::chrono::nanoseconds duration);
+
     /**
      * Main log function
      * Takes any number of arguments that can be written into QTextStream
@@ -57,15 +132,51 @@ public:
 
 Q_SIGNALS:
     void enabledChanged();
+    void bufferEnabledChanged();
+    /**
+     * Emitted when a span recorded into the ring buffer ends, @p duration is the time
+     * between its begin and end. Only emitted on the thread that recorded the span.
+     *
+     * @since 5.26
+     */
+    void spanFinished(const QByteArray &name, std::chrono::nanoseconds duration);
+    /**
+     * Emitted when a step of a flow is recorded into the ring buffer.
+     *
+     * @since 5.26
+     */
+    void flowRecorded(const QByteArray &name, quint64 id, KWin::FTraceLogger::FlowPhase phase);
 
 public Q_SLOTS:
     Q_SCRIPTABLE void setEnabled(bool enabled);
+    Q_SCRIPTABLE void setBufferEnabled(bool enabled);
+    /**
+     * Writes the events in the ring buffer to @p fileName as Chrome trace JSON.
+     */
+    Q_SCRIPTABLE bool dumpBuffer(const QString &fileName);
 
 private:
+    struct Event
+    {
+        QByteArray name;
+        qint64 timestamp = 0;
+        qint64 value = 0;
+        quint64 id = 0;
+        quint64 thread = 0;
+        char phase = 0;
+    };
+
     static QString filePath();
+    static bool writeEvents(const QString &fileName, const QVector<Event> &events);
     bool open();
+    void record(Event event);
+    QVector<Event> bufferedEvents(std::chrono::nanoseconds duration);
+
     QFile m_file;
     QMutex m_mutex;
+    QAtomicInteger<int> m_bufferEnabled = 0;
+    QVector<Event> m_buffer;
+    int m_bufferHead = 0;
     KWIN_SINGLETON(FTraceLogger)
 };
 
@@ -80,7 +191,13 @@ public:
         (stream << ... << args);
         stream.flush();
         m_context = ++s_context;
-        FTraceLogger::self()->trace(m_message, " begin_ctx=", m_context);
+        if (FTraceLogger::self()->isEnabled()) {
+            FTraceLogger::self()->trace(m_message, " begin_ctx=", m_context);
+        }
+        if (FTraceLogger::self()->isBufferEnabled()) {
+            m_start = std::chrono::steady_clock::now();
+            FTraceLogger::self()->beginSpan(m_message, m_context);
+        }
     }
 
     ~FTraceDuration();
@@ -88,6 +205,7 @@ public:
 private:
     QByteArray m_message;
     quint32 m_context;
+    std::optional<std::chrono::steady_clock::time_point> m_start;
 };
 
 } // namespace KWin
@@ -104,4 +222,25 @@ private:
  * In GPUVis this will appear as a timed block with begin_ctx and end_ctx markers
  */
 #define fTraceDuration(...) \
-    QScopedPointer<KWin::FTraceDuration> _duration(KWin::FTraceLogger::self()->isEnabled() ? new KWin::FTraceDuration(__VA_ARGS__) : nullptr);
+    QScopedPointer<KWin::FTraceDuration> _duration(KWin::FTraceLogger::self()->isTracing() ? new KWin::FTraceDuration(__VA_ARGS__) : nullptr);
+
+/**
+ * Records the value of a counter, e.g. the number of pending frames. The value is only
+ * evaluated if tracing is enabled. Safe to use before the logger has been created.
+ */
+#define fTraceCounter(name, value)                                                   \
+    do {                                                                             \
+        if (KWin::FTraceLogger::self() && KWin::FTraceLogger::self()->isTracing()) { \
+            KWin::FTraceLogger::self()->counter(name, value);                        \
+        }                                                                            \
+    } while (false)
+
+/**
+ * Records a step of a flow, see FTraceLogger::flow(). Safe to use before the logger has been created.
+ */
+#define fTraceFlow(name, id, phase)                                                           \
+    do {                                                                                      \
+        if (KWin::FTraceLogger::self() && KWin::FTraceLogger::self()->isTracing()) {          \
+            KWin::FTraceLogger::self()->flow(name, id, KWin::FTraceLogger::FlowPhase::phase); \
+        }                                                                                     \
+    } while (false)
@@ -104,6 +104,9 @@ void GestureRecognizer::unregisterSwipeGesture(KWin::SwipeGesture *gesture)
         m_destroyConnections.erase(it);
     }
     m_swipeGestures.removeAll(gesture);
+    for (QVector<SwipeGesture *> &candidates : m_swipeCandidates) {
+        candidates.removeOne(gesture);
+    }
     if (m_activeSwipeGestures.removeOne(gesture)) {
         Q_EMIT gesture->cancelled();
     }
@@ -125,18 +128,19 @@ void GestureRecognizer::unregisterPinchGesture(KWin::PinchGesture *gesture)
         m_destroyConnections.erase(it);
     }
     m_pinchGestures.removeAll(gesture);
+    for (QVector<PinchGesture *> &candidates : m_pinchCandidates) {
+        candidates.removeOne(gesture);
+    }
     if (m_activePinchGestures.removeOne(gesture)) {
         Q_EMIT gesture->cancelled();
     }
 }
 
-int GestureRecognizer::startSwipeGesture(uint fingerCount, const QPointF &startPos, StartPositionBehavior startPosBehavior)
+void GestureRecognizer::collectSwipeCandidates(uint fingerCount, const QPointF &startPos, StartPositionBehavior startPosBehavior)
 {
-    m_currentFingerCount = fingerCount;
-    if (!m_activeSwipeGestures.isEmpty() || !m_activePinchGestures.isEmpty()) {
-        return 0;
+    for (QVector<SwipeGesture *> &candidates : m_swipeCandidates) {
+        candidates.clear();
     }
-    int count = 0;
     for (SwipeGesture *gesture : qAsConst(m_swipeGestures)) {
         if (gesture->minimumFingerCountIsRelevant()) {
             if (gesture->minimumFingerCount() > fingerCount) {
@@ -170,28 +174,71 @@ int GestureRecognizer::startSwipeGesture(uint fingerCount, const QPointF &startP
                 }
             }
         }
+        m_swipeCandidates[int(gesture->direction())] << gesture;
+    }
+    m_swipeCandidatesCollected = true;
+}
 
-        // Only add gestures who's direction aligns with current swipe axis
-        switch (gesture->direction()) {
-        case SwipeGesture::Direction::Up:
-        case SwipeGesture::Direction::Down:
-            if (m_currentSwipeAxis == Axis::Horizontal) {
-                continue;
+int GestureRecognizer::startSwipeGesture(uint fingerCount, const QPointF &startPos, StartPositionBehavior startPosBehavior)
+{
+    m_currentFingerCount = fingerCount;
+    if (!m_activeSwipeGestures.isEmpty() || !m_activePinchGestures.isEmpty()) {
+        return 0;
+    }
+    collectSwipeCandidates(fingerCount, startPos, startPosBehavior);
+
+    int count = 0;
+    for (const QVector<SwipeGesture *> &candidates : m_swipeCandidates) {
+        for (SwipeGesture *gesture : candidates) {
+            // Only add gestures who's direction aligns with current swipe axis
+            switch (gesture->direction()) {
+            case SwipeGesture::Direction::Up:
+            case SwipeGesture::Direction::Down:
+                if (m_currentSwipeAxis == Axis::Horizontal) {
+                    continue;
+                }
+                break;
+            case SwipeGesture::Direction::Left:
+            case SwipeGesture::Direction::Right:
+                if (m_currentSwipeAxis == Axis::Vertical) {
+                    continue;
+                }
+                break;
             }
-            break;
-        case SwipeGesture::Direction::Left:
-        case SwipeGesture::Direction::Right:
-            if (m_currentSwipeAxis == Axis::Vertical) {
+
+            m_activeSwipeGestures << gesture;
+            count++;
+            Q_EMIT gesture->started();
+        }
+    }
+    return count;
+}
+
+void GestureRecognizer::setSwipeDirection(SwipeGesture::Direction direction)
+{
+    m_currentSwipeDirection = direction;
+
+    // Eliminate wrong gestures
+    for (auto it = m_activeSwipeGestures.begin(); it != m_activeSwipeGestures.end();) {
+        SwipeGesture *g = *it;
+        if (g->direction() != direction) {
+            // If a gesture was started from a touchscreen border never cancel it
+            if (!g->minimumXIsRelevant() || !g->maximumXIsRelevant() || !g->minimumYIsRelevant() || !g->maximumYIsRelevant()) {
+                Q_EMIT g->cancelled();
+                it = m_activeSwipeGestures.erase(it);
                 continue;
             }
-            break;
         }
+        it++;
+    }
 
-        m_activeSwipeGestures << gesture;
-        count++;
-        Q_EMIT gesture->started();
+    // The fingers turned around, continue with the gestures of the new direction
+    if (m_activeSwipeGestures.isEmpty()) {
+        for (SwipeGesture *gesture : qAsConst(m_swipeCandidates[int(direction)])) {
+            m_activeSwipeGestures << gesture;
+            Q_EMIT gesture->started();
+        }
     }
-    return count;
 }
 
 void GestureRecognizer::updateSwipeGesture(const QSizeF &delta)
@@ -231,27 +278,12 @@ void GestureRecognizer::updateSwipeGesture(const QSizeF &delta)
         Q_UNREACHABLE();
     }
 
-    // Eliminate wrong gestures (takes two iterations)
-    for (int i = 0; i < 2; i++) {
-
-        if (m_activeSwipeGestures.isEmpty()) {
-            startSwipeGesture(m_currentFingerCount);
-        }
-
-        for (auto it = m_activeSwipeGestures.begin(); it != m_activeSwipeGestures.end();) {
-            auto g = static_cast<SwipeGesture *>(*it);
-
-            if (g->direction() != direction) {
-                // If a gesture was started from a touchscreen border never cancel it
-                if (!g->minimumXIsRelevant() || !g->maximumXIsRelevant() || !g->minimumYIsRelevant() || !g->maximumYIsRelevant()) {
-                    Q_EMIT g->cancelled();
-                    it = m_activeSwipeGestures.erase(it);
-                    continue;
-                }
-            }
-
-            it++;
-        }
+    if (!m_swipeCandidatesCollected) {
+        startSwipeGesture(m_currentFingerCount);
+    }
+    // The active gestures only need to be revisited when the direction changes
+    if (m_currentSwipeDirection != direction) {
+        setSwipeDirection(direction);
     }
 
     // Send progress update
@@ -261,6 +293,20 @@ void GestureRecognizer::updateSwipeGesture(const QSizeF &delta)
     }
 }
 
+void GestureRecognizer::resetCandidates()
+{
+    for (QVector<SwipeGesture *> &candidates : m_swipeCandidates) {
+        candidates.clear();
+    }
+    for (QVector<PinchGesture *> &candidates : m_pinchCandidates) {
+        candidates.clear();
+    }
+    m_swipeCandidatesCollected = false;
+    m_pinchCandidatesCollected = false;
+    m_currentSwipeDirection.reset();
+    m_currentPinchDirection.reset();
+}
+
 void GestureRecognizer::cancelActiveGestures()
 {
     for (auto g : qAsConst(m_activeSwipeGestures)) {
@@ -271,6 +317,7 @@ void GestureRecognizer::cancelActiveGestures()
     }
     m_activeSwipeGestures.clear();
     m_activePinchGestures.clear();
+    resetCandidates();
     m_currentScale = 0;
     m_currentDelta = QSizeF(0, 0);
     m_currentSwipeAxis = Axis::None;
@@ -295,17 +342,16 @@ void GestureRecognizer::endSwipeGesture()
         }
     }
     m_activeSwipeGestures.clear();
+    resetCandidates();
     m_currentFingerCount = 0;
     m_currentDelta = QSizeF(0, 0);
     m_currentSwipeAxis = Axis::None;
 }
 
-int GestureRecognizer::startPinchGesture(uint fingerCount)
+void GestureRecognizer::collectPinchCandidates(uint fingerCount)
 {
-    m_currentFingerCount = fingerCount;
-    int count = 0;
-    if (!m_activeSwipeGestures.isEmpty() || !m_activePinchGestures.isEmpty()) {
-        return 0;
+    for (QVector<PinchGesture *> &candidates : m_pinchCandidates) {
+        candidates.clear();
     }
     for (PinchGesture *gesture : qAsConst(m_pinchGestures)) {
         if (gesture->minimumFingerCountIsRelevant()) {
@@ -318,15 +364,55 @@ int GestureRecognizer::startPinchGesture(uint fingerCount)
                 continue;
             }
         }
+        m_pinchCandidates[int(gesture->direction())] << gesture;
+    }
+    m_pinchCandidatesCollected = true;
+}
 
-        // direction doesn't matter yet
-        m_activePinchGestures << gesture;
-        count++;
-        Q_EMIT gesture->started();
+int GestureRecognizer::startPinchGesture(uint fingerCount)
+{
+    m_currentFingerCount = fingerCount;
+    int count = 0;
+    if (!m_activeSwipeGestures.isEmpty() || !m_activePinchGestures.isEmpty()) {
+        return 0;
+    }
+    collectPinchCandidates(fingerCount);
+
+    for (const QVector<PinchGesture *> &candidates : m_pinchCandidates) {
+        for (PinchGesture *gesture : candidates) {
+            // direction doesn't matter yet
+            m_activePinchGestures << gesture;
+            count++;
+            Q_EMIT gesture->started();
+        }
     }
     return count;
 }
 
+void GestureRecognizer::setPinchDirection(PinchGesture::Direction direction)
+{
+    m_currentPinchDirection = direction;
+
+    // Eliminate wrong gestures
+    for (auto it = m_activePinchGestures.begin(); it != m_activePinchGestures.end();) {
+        PinchGesture *g = *it;
+        if (g->direction() != direction) {
+            Q_EMIT g->cancelled();
+            it = m_activePinchGestures.erase(it);
+            continue;
+        }
+        it++;
+    }
+
+    // The fingers turned around, continue with the gestures of the new direction
+    if (m_activePinchGestures.isEmpty()) {
+        for (PinchGesture *gesture : qAsConst(m_pinchCandidates[int(direction)])) {
+            m_activePinchGestures << gesture;
+            Q_EMIT gesture->started();
+        }
+    }
+}
+
 void GestureRecognizer::updatePinchGesture(qreal scale, qreal angleDelta, const QSizeF &posDelta)
 {
     Q_UNUSED(angleDelta);
@@ -341,22 +427,12 @@ void GestureRecognizer::updatePinchGesture(qreal scale, qreal angleDelta, const
         direction = PinchGesture::Direction::Expanding;
     }
 
-    // Eliminate wrong gestures (takes two iterations)
-    for (int i = 0; i < 2; i++) {
-        if (m_activePinchGestures.isEmpty()) {
-            startPinchGesture(m_currentFingerCount);
-        }
-
-        for (auto it = m_activePinchGestures.begin(); it != m_activePinchGestures.end();) {
-            auto g = static_cast<PinchGesture *>(*it);
-
-            if (g->direction() != direction) {
-                Q_EMIT g->cancelled();
-                it = m_activePinchGestures.erase(it);
-                continue;
-            }
-            it++;
-        }
+    if (!m_pinchCandidatesCollected) {
+        startPinchGesture(m_currentFingerCount);
+    }
+    // The active gestures only need to be revisited when the direction changes
+    if (m_currentPinchDirection != direction) {
+        setPinchDirection(direction);
     }
 
     for (PinchGesture *g : std::as_const(m_activePinchGestures)) {
@@ -383,6 +459,7 @@ void GestureRecognizer::endPinchGesture() // because fingers up
     }
     m_activeSwipeGestures.clear();
     m_activePinchGestures.clear();
+    resetCandidates();
     m_currentScale = 1;
     m_currentFingerCount = 0;
     m_currentSwipeAxis = Axis::None;
@@ -17,6 +17,9 @@
 #include <QSizeF>
 #include <QVector>
 
+#include <array>
+#include <optional>
+
 namespace KWin
 {
 /*
@@ -216,12 +219,27 @@ private:
         None,
     };
     int startSwipeGesture(uint fingerCount, const QPointF &startPos, StartPositionBehavior startPosBehavior);
+    void collectSwipeCandidates(uint fingerCount, const QPointF &startPos, StartPositionBehavior startPosBehavior);
+    void collectPinchCandidates(uint fingerCount);
+    void setSwipeDirection(SwipeGesture::Direction direction);
+    void setPinchDirection(PinchGesture::Direction direction);
+    void resetCandidates();
     QVector<SwipeGesture *> m_swipeGestures;
     QVector<PinchGesture *> m_pinchGestures;
     QVector<SwipeGesture *> m_activeSwipeGestures;
     QVector<PinchGesture *> m_activePinchGestures;
     QMap<Gesture *, QMetaObject::Connection> m_destroyConnections;
 
+    // The gestures matching the finger count and start position of the current gesture,
+    // indexed by direction. They are collected once when the fingers go down, so updates
+    // only deal with the gestures of the direction the fingers are moving in.
+    std::array<QVector<SwipeGesture *>, 4> m_swipeCandidates;
+    std::array<QVector<PinchGesture *>, 2> m_pinchCandidates;
+    bool m_swipeCandidatesCollected = false;
+    bool m_pinchCandidatesCollected = false;
+    std::optional<SwipeGesture::Direction> m_currentSwipeDirection;
+    std::optional<PinchGesture::Direction> m_currentPinchDirection;
+
     QSizeF m_currentDelta = QSizeF(0, 0);
     qreal m_currentScale = 1; // For Pinch Gesture recognition
     uint m_currentFingerCount = 0;
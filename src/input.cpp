@@ -89,7 +89,10 @@ static KWaylandServer::PointerAxisSource kwinAxisSourceToKWaylandAxisSource(Inpu
     }
 }
 
-InputEventFilter::InputEventFilter() = default;
+InputEventFilter::InputEventFilter(InputRedirection::FilterEvents events)
+    : m_events(events)
+{
+}
 
 InputEventFilter::~InputEventFilter()
 {
@@ -98,6 +101,27 @@ InputEventFilter::~InputEventFilter()
     }
 }
 
+InputRedirection::FilterEvents InputEventFilter::events() const
+{
+    return m_events;
+}
+
+bool InputEventFilter::isActive() const
+{
+    return m_active;
+}
+
+void InputEventFilter::setActive(bool active)
+{
+    if (m_active == active) {
+        return;
+    }
+    m_active = active;
+    if (input()) {
+        input()->updateActiveFilters();
+    }
+}
+
 bool InputEventFilter::pointerEvent(QMouseEvent *event, quint32 nativeButton)
 {
     Q_UNUSED(event)
@@ -311,6 +335,11 @@ bool InputEventFilter::passToInputMethod(QKeyEvent *event)
 class VirtualTerminalFilter : public InputEventFilter
 {
 public:
+    VirtualTerminalFilter()
+        : InputEventFilter(InputRedirection::KeyboardEvents)
+    {
+    }
+
     bool keyEvent(QKeyEvent *event) override
     {
         // really on press and not on release? X11 switches on press.
@@ -328,6 +357,11 @@ public:
 class TerminateServerFilter : public InputEventFilter
 {
 public:
+    TerminateServerFilter()
+        : InputEventFilter(InputRedirection::KeyboardEvents)
+    {
+    }
+
     bool keyEvent(QKeyEvent *event) override
     {
         if (event->type() == QEvent::KeyPress && !event->isAutoRepeat()) {
@@ -344,6 +378,11 @@ public:
 class LockScreenFilter : public InputEventFilter
 {
 public:
+    LockScreenFilter()
+        : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::WheelEvents | InputRedirection::KeyboardEvents | InputRedirection::TouchEvents | InputRedirection::GestureEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         if (!waylandServer()->isScreenLocked()) {
@@ -565,6 +604,11 @@ private:
 class EffectsFilter : public InputEventFilter
 {
 public:
+    EffectsFilter()
+        : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::WheelEvents | InputRedirection::KeyboardEvents | InputRedirection::TouchEvents | InputRedirection::TabletEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
@@ -651,6 +695,11 @@ public:
 class MoveResizeFilter : public InputEventFilter
 {
 public:
+    MoveResizeFilter()
+        : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::WheelEvents | InputRedirection::KeyboardEvents | InputRedirection::TouchEvents | InputRedirection::TabletEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
@@ -768,10 +817,16 @@ private:
 class WindowSelectorFilter : public InputEventFilter
 {
 public:
+    WindowSelectorFilter()
+        : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::WheelEvents | InputRedirection::KeyboardEvents | InputRedirection::TouchEvents)
+    {
+        setActive(false);
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
-        if (!m_active) {
+        if (!isActive()) {
             return false;
         }
         switch (event->type()) {
@@ -793,12 +848,12 @@ public:
     {
         Q_UNUSED(event)
         // filter out while selecting a window
-        return m_active;
+        return isActive();
     }
     bool keyEvent(QKeyEvent *event) override
     {
         Q_UNUSED(event)
-        if (!m_active) {
+        if (!isActive()) {
             return false;
         }
         waylandServer()->seat()->setFocusedKeyboardSurface(nullptr);
@@ -877,22 +932,18 @@ public:
         return true;
     }
 
-    bool isActive() const
-    {
-        return m_active;
-    }
     void start(std::function<void(KWin::Window *)> callback)
     {
-        Q_ASSERT(!m_active);
-        m_active = true;
+        Q_ASSERT(!isActive());
+        setActive(true);
         m_callback = callback;
         input()->keyboard()->update();
         input()->touch()->cancel();
     }
     void start(std::function<void(const QPoint &)> callback)
     {
-        Q_ASSERT(!m_active);
-        m_active = true;
+        Q_ASSERT(!isActive());
+        setActive(true);
         m_pointSelectionFallback = callback;
         input()->keyboard()->update();
         input()->touch()->cancel();
@@ -901,7 +952,7 @@ public:
 private:
     void deactivate()
     {
-        m_active = false;
+        setActive(false);
         m_callback = std::function<void(KWin::Window *)>();
         m_pointSelectionFallback = std::function<void(const QPoint &)>();
         input()->pointer()->removeWindowSelectionCursor();
@@ -933,7 +984,6 @@ private:
     {
         accept(pos.toPoint());
     }
-    bool m_active = false;
     std::function<void(KWin::Window *)> m_callback;
     std::function<void(const QPoint &)> m_pointSelectionFallback;
     QMap<quint32, QPointF> m_touchPoints;
@@ -943,6 +993,7 @@ class GlobalShortcutFilter : public InputEventFilter
 {
 public:
     GlobalShortcutFilter()
+        : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::WheelEvents | InputRedirection::KeyboardEvents | InputRedirection::TouchEvents | InputRedirection::GestureEvents)
     {
         m_powerDown = new QTimer;
         m_powerDown->setSingleShot(true);
@@ -1093,7 +1144,7 @@ public:
             if (m_touchPoints.count() >= 3 && !m_gestureCancelled) {
                 m_gestureTaken = true;
                 m_syntheticCancel = true;
-                input()->processFilters(std::bind(&InputEventFilter::touchCancel, std::placeholders::_1));
+                input()->processFilters(InputRedirection::TouchEvents, std::bind(&InputEventFilter::touchCancel, std::placeholders::_1));
                 m_syntheticCancel = false;
                 input()->shortcuts()->processSwipeStart(DeviceType::Touchscreen, m_touchPoints.count());
                 return true;
@@ -1233,6 +1284,13 @@ std::pair<bool, bool> performWindowWheelAction(QWheelEvent *event, Window *windo
 
 class InternalWindowEventFilter : public InputEventFilter
 {
+public:
+    InternalWindowEventFilter()
+        : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::WheelEvents | InputRedirection::KeyboardEvents | InputRedirection::TouchEvents)
+    {
+    }
+
+private:
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
@@ -1406,6 +1464,11 @@ private:
 class DecorationEventFilter : public InputEventFilter
 {
 public:
+    DecorationEventFilter()
+        : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::WheelEvents | InputRedirection::TouchEvents | InputRedirection::TabletEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
@@ -1621,6 +1684,11 @@ private:
 class TabBoxInputFilter : public InputEventFilter
 {
 public:
+    TabBoxInputFilter()
+        : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::WheelEvents | InputRedirection::KeyboardEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 button) override
     {
         Q_UNUSED(button)
@@ -1661,6 +1729,11 @@ public:
 class ScreenEdgeInputFilter : public InputEventFilter
 {
 public:
+    ScreenEdgeInputFilter()
+        : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::TouchEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
@@ -1721,6 +1794,11 @@ private:
 class WindowActionInputFilter : public InputEventFilter
 {
 public:
+    WindowActionInputFilter()
+        : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::WheelEvents | InputRedirection::TouchEvents | InputRedirection::TabletEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         Q_UNUSED(nativeButton)
@@ -1793,6 +1871,11 @@ public:
 class InputKeyboardFilter : public InputEventFilter
 {
 public:
+    InputKeyboardFilter()
+        : InputEventFilter(InputRedirection::KeyboardEvents)
+    {
+    }
+
     bool keyEvent(QKeyEvent *event) override
     {
         return passToInputMethod(event);
@@ -1805,6 +1888,11 @@ public:
 class ForwardInputFilter : public InputEventFilter
 {
 public:
+    ForwardInputFilter()
+        : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::WheelEvents | InputRedirection::KeyboardEvents | InputRedirection::TouchEvents | InputRedirection::GestureEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
     {
         auto seat = waylandServer()->seat();
@@ -2024,6 +2112,7 @@ class TabletInputFilter : public QObject, public InputEventFilter
 {
 public:
     TabletInputFilter()
+        : InputEventFilter(InputRedirection::TabletEvents)
     {
         const auto devices = input()->devices();
         for (InputDevice *device : devices) {
@@ -2203,6 +2292,7 @@ public:
         tool->setCurrentSurface(surface);
 
         if (!tool->isClientSupported() || (tablet && !tablet->isSurfaceSupported(surface))) {
+            m_pressureByTool.remove(tool);
             return emulateTabletEvent(event);
         }
 
@@ -2218,6 +2308,8 @@ public:
             m_cursorByTool[tool]->setPos(pos);
             tool->sendProximityIn(tablet);
             tool->sendMotion(window->mapToLocal(event->globalPosF()));
+            // the client doesn't know the pressure of a tool that has just come in
+            m_pressureByTool.remove(tool);
             break;
         }
         case QEvent::TabletLeaveProximity:
@@ -2237,8 +2329,15 @@ public:
             qCWarning(KWIN_CORE) << "Unexpected tablet event type" << event;
             break;
         }
+        // Pens report motion at a high rate while the pressure mostly stays the same,
+        // the client keeps the last pressure until a new one is sent
         const quint32 MAX_VAL = 65535;
-        tool->sendPressure(MAX_VAL * event->pressure());
+        const quint32 pressure = MAX_VAL * event->pressure();
+        auto lastPressure = m_pressureByTool.find(tool);
+        if (lastPressure == m_pressureByTool.end() || lastPressure->surface != surface || lastPressure->pressure != pressure) {
+            tool->sendPressure(pressure);
+            m_pressureByTool[tool] = {surface, pressure};
+        }
         tool->sendFrame(event->timestamp());
         return true;
     }
@@ -2346,6 +2445,12 @@ public:
     }
 
     QHash<KWaylandServer::TabletToolV2Interface *, Cursor *> m_cursorByTool;
+    struct SentPressure
+    {
+        QPointer<KWaylandServer::SurfaceInterface> surface;
+        quint32 pressure;
+    };
+    QHash<KWaylandServer::TabletToolV2Interface *, SentPressure> m_pressureByTool;
 };
 
 static KWaylandServer::AbstractDropHandler *dropHandler(Window *window)
@@ -2372,10 +2477,31 @@ class DragAndDropInputFilter : public QObject, public InputEventFilter
     Q_OBJECT
 public:
     DragAndDropInputFilter()
+        : InputEventFilter(InputRedirection::PointerEvents | InputRedirection::KeyboardEvents | InputRedirection::TouchEvents)
     {
         m_raiseTimer.setSingleShot(true);
         m_raiseTimer.setInterval(250);
         connect(&m_raiseTimer, &QTimer::timeout, this, &DragAndDropInputFilter::raiseDragTarget);
+
+        // only needed while something is dragged
+        auto seat = waylandServer()->seat();
+        setActive(seat->isDrag());
+        connect(seat, &KWaylandServer::SeatInterface::dragStarted, this, [this]() {
+            setActive(true);
+        });
+        connect(seat, &KWaylandServer::SeatInterface::dragEnded, this, [this]() {
+            setActive(false);
+            invalidateDropTargets();
+        });
+
+        // the drop target candidates only change together with the stacking order or
+        // the set of windows visible on the current desktop and activity
+        connect(workspace(), &Workspace::stackingOrderChanged, this, &DragAndDropInputFilter::invalidateDropTargets);
+        connect(workspace(), &Workspace::currentDesktopChanged, this, &DragAndDropInputFilter::invalidateDropTargets);
+        connect(workspace(), &Workspace::currentActivityChanged, this, &DragAndDropInputFilter::invalidateDropTargets);
+        connect(workspace(), &Workspace::desktopPresenceChanged, this, &DragAndDropInputFilter::invalidateDropTargets);
+        connect(workspace(), &Workspace::windowAdded, this, &DragAndDropInputFilter::invalidateDropTargets);
+        connect(workspace(), &Workspace::windowRemoved, this, &DragAndDropInputFilter::invalidateDropTargets);
     }
 
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override
@@ -2396,7 +2522,7 @@ public:
 
             const auto eventPos = event->globalPos();
             // TODO: use InputDeviceHandler::at() here and check isClient()?
-            Window *t = input()->findManagedToplevel(eventPos);
+            Window *t = findDropTarget(eventPos);
             const auto dragTarget = static_cast<Window *>(t && t->isClient() ? t : nullptr);
             if (dragTarget) {
                 if (dragTarget != m_dragTarget) {
@@ -2547,10 +2673,51 @@ private:
             workspace()->takeActivity(m_dragTarget, Workspace::ActivityFlag::ActivityRaise);
         }
     }
+    void invalidateDropTargets()
+    {
+        m_dropTargetsValid = false;
+        m_dropTargets.clear();
+    }
+    /**
+     * Same as InputRedirection::findManagedToplevel(), but the windows on the current
+     * desktop and activity are collected once per stacking order change instead of
+     * walking the whole stacking order on every motion event of the drag.
+     */
+    Window *findDropTarget(const QPoint &pos)
+    {
+        if (waylandServer()->isScreenLocked()) {
+            return input()->findManagedToplevel(pos);
+        }
+        if (!m_dropTargetsValid) {
+            const QList<Window *> &stacking = workspace()->stackingOrder();
+            for (auto it = stacking.crbegin(); it != stacking.crend(); ++it) {
+                Window *window = *it;
+                if (window->isDeleted() || !window->isOnCurrentActivity() || !window->isOnCurrentDesktop()) {
+                    continue;
+                }
+                m_dropTargets.append(window);
+            }
+            m_dropTargetsValid = true;
+        }
+        for (const QPointer<Window> &window : qAsConst(m_dropTargets)) {
+            if (!window || window->isDeleted() || window->isMinimized() || window->isHiddenInternal()) {
+                continue;
+            }
+            if (!window->readyForPainting()) {
+                continue;
+            }
+            if (window->hitTest(pos)) {
+                return window;
+            }
+        }
+        return nullptr;
+    }
     qint32 m_touchId = -1;
     QPointF m_lastPos = QPointF(-1, -1);
     QPointer<Window> m_dragTarget;
     QTimer m_raiseTimer;
+    QVector<QPointer<Window>> m_dropTargets;
+    bool m_dropTargetsValid = false;
 };
 
 KWIN_SINGLETON_FACTORY(InputRedirection)
@@ -2587,17 +2754,35 @@ void InputRedirection::installInputEventFilter(InputEventFilter *filter)
 {
     Q_ASSERT(!m_filters.contains(filter));
     m_filters << filter;
+    updateActiveFilters();
 }
 
 void InputRedirection::prependInputEventFilter(InputEventFilter *filter)
 {
     Q_ASSERT(!m_filters.contains(filter));
     m_filters.prepend(filter);
+    updateActiveFilters();
 }
 
 void InputRedirection::uninstallInputEventFilter(InputEventFilter *filter)
 {
     m_filters.removeOne(filter);
+    updateActiveFilters();
+}
+
+void InputRedirection::updateActiveFilters()
+{
+    for (uint i = 0; i < m_activeFilters.size(); ++i) {
+        const FilterEvent type = FilterEvent(1 << i);
+        QVector<InputEventFilter *> filters;
+        for (InputEventFilter *filter : qAsConst(m_filters)) {
+            if (filter->isActive() && filter->events().testFlag(type)) {
+                filters.append(filter);
+            }
+        }
+        m_activeFilters[i] = filters;
+    }
+    m_activeFiltersGeneration++;
 }
 
 void InputRedirection::installInputEventSpy(InputEventSpy *spy)
@@ -2951,7 +3136,7 @@ void InputRedirection::addInputDevice(InputDevice *device)
     auto handleSwitchEvent = [this](SwitchEvent::State state, quint32 time, quint64 timeMicroseconds, InputDevice *device) {
         SwitchEvent event(state, time, timeMicroseconds, device);
         processSpies(std::bind(&InputEventSpy::switchEvent, std::placeholders::_1, &event));
-        processFilters(std::bind(&InputEventFilter::switchEvent, std::placeholders::_1, &event));
+        processFilters(SwitchEvents, std::bind(&InputEventFilter::switchEvent, std::placeholders::_1, &event));
     };
     connect(device, &InputDevice::switchToggledOn, this,
             std::bind(handleSwitchEvent, SwitchEvent::State::On, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
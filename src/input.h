@@ -22,6 +22,7 @@
 #include <KSharedConfig>
 #include <QSet>
 
+#include <array>
 #include <functional>
 
 class KGlobalAccelInterface;
@@ -86,6 +87,20 @@ public:
         KeyboardKeyPressed,
         KeyboardKeyAutoRepeat
     };
+    /**
+     * The kinds of events an InputEventFilter can be interested in.
+     */
+    enum FilterEvent {
+        PointerEvents = 1 << 0,
+        WheelEvents = 1 << 1,
+        KeyboardEvents = 1 << 2,
+        TouchEvents = 1 << 3,
+        GestureEvents = 1 << 4,
+        SwitchEvents = 1 << 5,
+        TabletEvents = 1 << 6,
+        AllEvents = (1 << 7) - 1,
+    };
+    Q_DECLARE_FLAGS(FilterEvents, FilterEvent)
     enum TabletEventType {
         Axis,
         Proximity,
@@ -174,9 +189,9 @@ public:
     }
 
     /**
-     * Sends an event through all InputFilters.
-     * The method @p function is invoked on each input filter. Processing is stopped if
-     * a filter returns @c true for @p function.
+     * Sends an event of the given @p type through all active InputFilters that are
+     * interested in it. The method @p function is invoked on each of these input filters.
+     * Processing is stopped if a filter returns @c true for @p function.
      *
      * The UnaryPredicate is defined like the UnaryPredicate of std::any_of.
      * The signature of the function should be equivalent to the following:
@@ -188,9 +203,21 @@ public:
      * bind.
      */
     template<class UnaryPredicate>
-    void processFilters(UnaryPredicate function)
+    void processFilters(FilterEvent type, UnaryPredicate function)
     {
-        std::any_of(m_filters.constBegin(), m_filters.constEnd(), function);
+        // Filters can be uninstalled or deactivated while an event is processed. The list is
+        // implicitly shared, so walking a copy is cheap, the filters that are gone are skipped.
+        const int index = qCountTrailingZeroBits(uint(type));
+        const QVector<InputEventFilter *> filters = m_activeFilters[index];
+        const quint64 generation = m_activeFiltersGeneration;
+        for (InputEventFilter *filter : filters) {
+            if (generation != m_activeFiltersGeneration && !m_activeFilters[index].contains(filter)) {
+                continue;
+            }
+            if (function(filter)) {
+                break;
+            }
+        }
     }
 
     /**
@@ -310,6 +337,7 @@ private:
     void setupWorkspace();
     void setupInputFilters();
     void installInputEventFilter(InputEventFilter *filter);
+    void updateActiveFilters();
     void updateLeds(LEDs leds);
     void updateAvailableInputDevices();
     void addInputBackend(InputBackend *inputBackend);
@@ -327,6 +355,10 @@ private:
     WindowSelectorFilter *m_windowSelector = nullptr;
 
     QVector<InputEventFilter *> m_filters;
+    // the active filters for each FilterEvent, in processing order
+    std::array<QVector<InputEventFilter *>, 7> m_activeFilters;
+    // incremented whenever m_activeFilters changes
+    quint64 m_activeFiltersGeneration = 0;
     QVector<InputEventSpy *> m_spies;
     KConfigWatcher::Ptr m_inputConfigWatcher;
 
@@ -343,6 +375,7 @@ private:
     friend class DecorationEventFilter;
     friend class InternalWindowEventFilter;
     friend class ForwardInputFilter;
+    friend class InputEventFilter;
 };
 
 /**
@@ -361,15 +394,28 @@ private:
  * a filter returns @c false the next one is invoked. This means a filter
  * installed early gets to see more events than a filter installed later on.
  *
+ * A filter only gets the kinds of events it has been constructed for, and only
+ * while it is active. Filters that don't have anything to do most of the time
+ * should deactivate themselves, so they don't slow down event processing.
+ *
  * Deleting an instance of InputEventFilter automatically uninstalls it from
  * InputRedirection.
  */
 class KWIN_EXPORT InputEventFilter
 {
 public:
-    InputEventFilter();
+    explicit InputEventFilter(InputRedirection::FilterEvents events = InputRedirection::AllEvents);
     virtual ~InputEventFilter();
 
+    /**
+     * Returns the kinds of events this filter is interested in.
+     */
+    InputRedirection::FilterEvents events() const;
+    /**
+     * Returns @c true if the filter gets events; otherwise returns @c false.
+     */
+    bool isActive() const;
+
     /**
      * Event filter for pointer events which can be described by a QMouseEvent.
      *
@@ -428,6 +474,11 @@ public:
 protected:
     void passToWaylandServer(QKeyEvent *event);
     bool passToInputMethod(QKeyEvent *event);
+    void setActive(bool active);
+
+private:
+    InputRedirection::FilterEvents m_events;
+    bool m_active = true;
 };
 
 class KWIN_EXPORT InputDeviceHandler : public QObject
@@ -539,6 +590,7 @@ inline void InputRedirection::registerShortcut(const QKeySequence &shortcut, QAc
 
 } // namespace KWin
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(KWin::InputRedirection::FilterEvents)
 Q_DECLARE_METATYPE(KWin::InputRedirection::KeyboardKeyState)
 Q_DECLARE_METATYPE(KWin::InputRedirection::PointerButtonState)
 Q_DECLARE_METATYPE(KWin::InputRedirection::PointerAxis)
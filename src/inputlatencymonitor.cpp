@@ -0,0 +1,202 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "inputlatencymonitor.h"
+#include "input.h"
+#include "input_event.h"
+#include "main.h"
+#include "output.h"
+#include "platform.h"
+#include "renderloop.h"
+#include "wayland/seat_interface.h"
+#include "wayland/surface_interface.h"
+#include "wayland_server.h"
+
+#include <QDBusConnection>
+
+namespace KWin
+{
+KWIN_SINGLETON_FACTORY(KWin::InputLatencyMonitor)
+
+// The resolution and the range of the latency histogram
+static const std::chrono::microseconds s_bucketSize(100);
+static const int s_bucketCount = 1000;
+// Events that haven't been presented after this time are not reflected by any frame, e.g.
+// because the cursor is on a hardware plane and nothing else has to be repainted
+static const std::chrono::seconds s_maximumLatency(1);
+
+InputLatencyMonitor::Statistics::Statistics()
+    : m_histogram(s_bucketCount + 1)
+{
+}
+
+void InputLatencyMonitor::Statistics::add(std::chrono::nanoseconds latency)
+{
+    ++count;
+    minimum = std::min(minimum, latency);
+    maximum = std::max(maximum, latency);
+    total += latency;
+    ++m_histogram[std::min<qint64>(latency / s_bucketSize, s_bucketCount)];
+}
+
+std::chrono::nanoseconds InputLatencyMonitor::Statistics::percentile(int percentile) const
+{
+    if (!count) {
+        return std::chrono::nanoseconds::zero();
+    }
+    const quint64 rank = (count * percentile + 99) / 100;
+    quint64 seen = 0;
+    for (int i = 0; i < s_bucketCount; ++i) {
+        seen += m_histogram[i];
+        if (seen >= rank) {
+            return std::min<std::chrono::nanoseconds>((i + 1) * s_bucketSize, maximum);
+        }
+    }
+    return maximum;
+}
+
+InputLatencyMonitor::InputLatencyMonitor(QObject *parent)
+    : QObject(parent)
+{
+    input()->installInputEventSpy(this);
+    QDBusConnection::sessionBus().registerObject(QStringLiteral("/InputLatency"), this, QDBusConnection::ExportScriptableContents);
+}
+
+InputLatencyMonitor::~InputLatencyMonitor()
+{
+    QDBusConnection::sessionBus().unregisterObject(QStringLiteral("/InputLatency"));
+    s_self = nullptr;
+}
+
+void InputLatencyMonitor::pointerEvent(MouseEvent *event)
+{
+    // warps and synthesized events have no kernel timestamp
+    if (event->type() != QEvent::MouseMove || !event->timestampMicroseconds()) {
+        return;
+    }
+    const std::chrono::nanoseconds timestamp = std::chrono::microseconds(event->timestampMicroseconds());
+    Output *output = kwinApp()->platform()->outputAt(event->globalPos());
+    if (!output) {
+        return;
+    }
+
+    if (event->screenPos() != m_lastCursorPos) {
+        m_lastCursorPos = event->screenPos();
+        markReady(output, timestamp);
+        return;
+    }
+
+    // The cursor didn't move, so the event can only be reflected by the client.
+    trackSurface(waylandServer()->seat()->focusedPointerSurface());
+    if (m_surface) {
+        m_surfaceOutput = output;
+        if (!m_surfaceEvent) {
+            m_surfaceEvent = timestamp;
+        }
+    }
+}
+
+void InputLatencyMonitor::trackSurface(KWaylandServer::SurfaceInterface *surface)
+{
+    if (m_surface == surface) {
+        return;
+    }
+    disconnect(m_surfaceConnection);
+    m_surface = surface;
+    m_surfaceEvent.reset();
+    if (surface) {
+        m_surfaceConnection = connect(surface, &KWaylandServer::SurfaceInterface::committed, this, &InputLatencyMonitor::handleSurfaceCommitted);
+    }
+}
+
+void InputLatencyMonitor::handleSurfaceCommitted()
+{
+    if (m_surfaceEvent && m_surfaceOutput) {
+        markReady(m_surfaceOutput, *m_surfaceEvent);
+    }
+    m_surfaceEvent.reset();
+}
+
+void InputLatencyMonitor::markReady(Output *output, std::chrono::nanoseconds timestamp)
+{
+    RenderLoop *loop = output->renderLoop();
+    auto it = m_pendingEvents.find(loop);
+    if (it == m_pendingEvents.end()) {
+        it = m_pendingEvents.insert(loop, PendingEvents{output->name(), std::nullopt, std::nullopt});
+        connect(loop, &QObject::destroyed, this, [this, loop]() {
+            m_pendingEvents.remove(loop);
+        });
+    }
+    // The latency of the oldest event that a frame reflects is reported.
+    if (!it->ready) {
+        it->ready = timestamp;
+    }
+}
+
+void InputLatencyMonitor::frameStarted(RenderLoop *loop)
+{
+    auto it = m_pendingEvents.find(loop);
+    if (it == m_pendingEvents.end() || !it->ready) {
+        return;
+    }
+    // If the previous frame has failed, its events are reflected by this one.
+    if (!it->inFlight) {
+        it->inFlight = it->ready;
+    }
+    it->ready.reset();
+}
+
+void InputLatencyMonitor::framePresented(RenderLoop *loop, std::chrono::nanoseconds timestamp)
+{
+    auto it = m_pendingEvents.find(loop);
+    if (it == m_pendingEvents.end() || !it->inFlight) {
+        return;
+    }
+    const std::chrono::nanoseconds latency = timestamp - *it->inFlight;
+    it->inFlight.reset();
+    if (latency < std::chrono::nanoseconds::zero() || latency > s_maximumLatency) {
+        return;
+    }
+
+    auto statistics = m_statistics.find(it->outputName);
+    if (statistics == m_statistics.end()) {
+        statistics = m_statistics.insert(it->outputName, Statistics());
+    }
+    statistics->add(latency);
+}
+
+QHash<QString, InputLatencyMonitor::Statistics> InputLatencyMonitor::statistics() const
+{
+    return m_statistics;
+}
+
+QVariantMap InputLatencyMonitor::latencies() const
+{
+    auto toMicroseconds = [](std::chrono::nanoseconds value) {
+        return qlonglong(std::chrono::duration_cast<std::chrono::microseconds>(value).count());
+    };
+
+    QVariantMap ret;
+    for (auto it = m_statistics.constBegin(); it != m_statistics.constEnd(); ++it) {
+        ret.insert(it.key(), QVariantMap{
+                                 {QStringLiteral("samples"), it->count},
+                                 {QStringLiteral("minimum"), toMicroseconds(it->minimum)},
+                                 {QStringLiteral("median"), toMicroseconds(it->percentile(50))},
+                                 {QStringLiteral("p90"), toMicroseconds(it->percentile(90))},
+                                 {QStringLiteral("p99"), toMicroseconds(it->percentile(99))},
+                                 {QStringLiteral("maximum"), toMicroseconds(it->maximum)},
+                             });
+    }
+    return ret;
+}
+
+void InputLatencyMonitor::resetLatencies()
+{
+    m_statistics.clear();
+}
+
+} // namespace KWin
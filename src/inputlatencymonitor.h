@@ -0,0 +1,120 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "input_event_spy.h"
+#include <kwinglobals.h>
+
+#include <QHash>
+#include <QObject>
+#include <QPointF>
+#include <QPointer>
+#include <QVariantMap>
+#include <QVector>
+
+#include <chrono>
+#include <optional>
+
+namespace KWaylandServer
+{
+class SurfaceInterface;
+}
+
+namespace KWin
+{
+
+class Output;
+class RenderLoop;
+
+/**
+ * The InputLatencyMonitor measures the time between a pointer motion event having been
+ * generated by the kernel and the first frame that reflects it having been presented.
+ *
+ * If the motion has moved the cursor, the next frame of the output with the cursor reflects
+ * the event. Otherwise, e.g. if the pointer is locked, the first frame that is started after
+ * the focused surface has committed new content is attributed to the event.
+ *
+ * The latency distribution of every output is available on DBus as org.kde.kwin.InputLatency
+ * at /InputLatency and in the debug console.
+ *
+ * @since 5.26
+ */
+class KWIN_EXPORT InputLatencyMonitor : public QObject, public InputEventSpy
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.kwin.InputLatency")
+
+public:
+    class Statistics
+    {
+    public:
+        Statistics();
+
+        void add(std::chrono::nanoseconds latency);
+        std::chrono::nanoseconds percentile(int percentile) const;
+
+        quint64 count = 0;
+        std::chrono::nanoseconds minimum = std::chrono::nanoseconds::max();
+        std::chrono::nanoseconds maximum = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds total = std::chrono::nanoseconds::zero();
+
+    private:
+        QVector<quint32> m_histogram;
+    };
+
+    ~InputLatencyMonitor() override;
+
+    void pointerEvent(MouseEvent *event) override;
+
+    /**
+     * Notifies the monitor that the @p loop has started compositing a frame.
+     */
+    void frameStarted(RenderLoop *loop);
+    /**
+     * Notifies the monitor that the frame of the @p loop has been presented at @p timestamp.
+     */
+    void framePresented(RenderLoop *loop, std::chrono::nanoseconds timestamp);
+
+    /**
+     * Returns the latency statistics, indexed by the output name.
+     */
+    QHash<QString, Statistics> statistics() const;
+
+    /**
+     * Returns the number of samples and the minimum, median, 90th and 99th percentile and
+     * maximum latency in microseconds for every output.
+     */
+    Q_SCRIPTABLE Q_INVOKABLE QVariantMap latencies() const;
+    Q_SCRIPTABLE Q_INVOKABLE void resetLatencies();
+
+private:
+    struct PendingEvents
+    {
+        QString outputName;
+        // events that will be reflected by the next frame
+        std::optional<std::chrono::nanoseconds> ready;
+        // events that are reflected by the frame being composited
+        std::optional<std::chrono::nanoseconds> inFlight;
+    };
+
+    void markReady(Output *output, std::chrono::nanoseconds timestamp);
+    void trackSurface(KWaylandServer::SurfaceInterface *surface);
+    void handleSurfaceCommitted();
+
+    QHash<RenderLoop *, PendingEvents> m_pendingEvents;
+    QHash<QString, Statistics> m_statistics;
+    QPointF m_lastCursorPos;
+    // events waiting for the focused surface to commit
+    QPointer<KWaylandServer::SurfaceInterface> m_surface;
+    QPointer<Output> m_surfaceOutput;
+    std::optional<std::chrono::nanoseconds> m_surfaceEvent;
+    QMetaObject::Connection m_surfaceConnection;
+    KWIN_SINGLETON(InputLatencyMonitor)
+};
+
+} // namespace KWin
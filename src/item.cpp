@@ -28,7 +28,7 @@ Item::~Item()
     setParentItem(nullptr);
     for (const auto &dirty : qAsConst(m_repaints)) {
         if (!dirty.isEmpty()) {
-            Compositor::self()->scene()->addRepaint(dirty);
+            Compositor::self()->scene()->addRepaint(dirty.toRegion());
         }
     }
 }
@@ -42,6 +42,7 @@ void Item::setOpacity(qreal opacity)
 {
     if (m_opacity != opacity) {
         m_opacity = opacity;
+        markRenderSerialDirty();
         scheduleRepaint(boundingRect());
     }
 }
@@ -120,6 +121,7 @@ void Item::setPosition(const QPoint &point)
     if (m_position != point) {
         scheduleRepaint(boundingRect());
         m_position = point;
+        markRenderSerialDirty();
         if (m_parentItem) {
             m_parentItem->updateBoundingRect();
         }
@@ -200,7 +202,10 @@ QMatrix4x4 Item::transform() const
 
 void Item::setTransform(const QMatrix4x4 &transform)
 {
-    m_transform = transform;
+    if (m_transform != transform) {
+        m_transform = transform;
+        markRenderSerialDirty();
+    }
 }
 
 QRegion Item::mapToGlobal(const QRegion &region) const
@@ -283,6 +288,57 @@ void Item::stackAfter(Item *sibling)
     sibling->scheduleRepaint(sibling->boundingRect());
 }
 
+void Item::restackChildItems(const QVector<std::pair<Item *, int>> &zValues)
+{
+    bool changed = false;
+    for (const auto &[item, z] : zValues) {
+        Q_ASSERT(item->parentItem() == this);
+        if (item->m_z != z) {
+            changed = true;
+            break;
+        }
+    }
+    if (!changed) {
+        return;
+    }
+
+    const QList<Item *> oldOrder = sortedChildItems();
+    for (const auto &[item, z] : zValues) {
+        item->m_z = z;
+    }
+    markSortedChildItemsDirty();
+    const QList<Item *> newOrder = sortedChildItems();
+
+    QHash<Item *, int> oldIndices;
+    oldIndices.reserve(oldOrder.count());
+    for (int i = 0; i < oldOrder.count(); ++i) {
+        oldIndices.insert(oldOrder[i], i);
+    }
+
+    // Swapping two children changes nothing on the screen unless they overlap
+    QVector<QRect> geometries(newOrder.count());
+    for (int i = 0; i < newOrder.count(); ++i) {
+        if (newOrder[i]->isVisible()) {
+            geometries[i] = newOrder[i]->mapToGlobal(newOrder[i]->boundingRect());
+        }
+    }
+    for (int i = 0; i < newOrder.count(); ++i) {
+        if (geometries[i].isEmpty()) {
+            continue;
+        }
+        const int oldIndex = oldIndices.value(newOrder[i]);
+        for (int j = i + 1; j < newOrder.count(); ++j) {
+            if (oldIndices.value(newOrder[j]) > oldIndex) {
+                continue;
+            }
+            const QRect overlap = geometries[i] & geometries[j];
+            if (!overlap.isEmpty()) {
+                newOrder[i]->scheduleRepaint(newOrder[i]->mapFromGlobal(overlap));
+            }
+        }
+    }
+}
+
 void Item::scheduleRepaint(const QRegion &region)
 {
     if (isVisible()) {
@@ -293,17 +349,31 @@ void Item::scheduleRepaint(const QRegion &region)
 void Item::scheduleRepaintInternal(const QRegion &region)
 {
     const QVector<Output *> outputs = kwinApp()->platform()->enabledOutputs();
-    const QRegion globalRegion = mapToGlobal(region);
+    const QPoint offset = rootPosition();
     if (kwinApp()->operationMode() != Application::OperationModeX11) {
+        const QRect boundingRect = region.boundingRect().translated(offset);
         for (const auto &output : outputs) {
-            const QRegion dirtyRegion = globalRegion & output->geometry();
-            if (!dirtyRegion.isEmpty()) {
-                m_repaints[output] += dirtyRegion;
+            const QRect geometry = output->geometry();
+            if (!boundingRect.intersects(geometry)) {
+                continue;
+            }
+            // Mark the rects directly instead of translating, intersecting and uniting regions
+            CompactRegion *repaints = nullptr;
+            for (const QRect &rect : region) {
+                const QRect dirtyRect = rect.translated(offset) & geometry;
+                if (!dirtyRect.isEmpty()) {
+                    if (!repaints) {
+                        repaints = &m_repaints[output];
+                    }
+                    *repaints += dirtyRect;
+                }
+            }
+            if (repaints) {
                 output->renderLoop()->scheduleRepaint(this);
             }
         }
     } else {
-        m_repaints[outputs.constFirst()] += globalRegion;
+        m_repaints[outputs.constFirst()] += region.translated(offset);
         outputs.constFirst()->renderLoop()->scheduleRepaint(this);
     }
 }
@@ -338,6 +408,8 @@ WindowQuadList Item::buildQuads() const
 void Item::discardQuads()
 {
     m_quads.reset();
+    m_geometry.reset();
+    markRenderSerialDirty();
 }
 
 WindowQuadList Item::quads() const
@@ -348,14 +420,42 @@ WindowQuadList Item::quads() const
     return m_quads.value();
 }
 
+RenderGeometry Item::geometry() const
+{
+    if (!m_geometry.has_value()) {
+        m_geometry = RenderGeometry::fromWindowQuadList(quads());
+    }
+    return m_geometry.value();
+}
+
 QRegion Item::repaints(Output *output) const
 {
-    return m_repaints.value(output, QRect(QPoint(0, 0), screens()->size()));
+    const auto it = m_repaints.constFind(output);
+    if (it == m_repaints.constEnd()) {
+        return QRect(QPoint(0, 0), screens()->size());
+    }
+    // The tile fallback of the compact region can spill over the output edges
+    if (it->isTiled() && kwinApp()->operationMode() != Application::OperationModeX11) {
+        return it->toRegion() & output->geometry();
+    }
+    return it->toRegion();
 }
 
 void Item::resetRepaints(Output *output)
 {
-    m_repaints.insert(output, QRegion());
+    m_repaints[output].clear();
+}
+
+void Item::takeRepaints(Output *output, CompactRegion *repaints)
+{
+    auto it = m_repaints.find(output);
+    if (it == m_repaints.end()) {
+        *repaints += QRect(QPoint(0, 0), screens()->size());
+        m_repaints.insert(output, CompactRegion());
+    } else {
+        *repaints += *it;
+        it->clear();
+    }
 }
 
 void Item::removeRepaints(Output *output)
@@ -377,6 +477,7 @@ void Item::setVisible(bool visible)
 {
     if (m_explicitVisible != visible) {
         m_explicitVisible = visible;
+        markRenderSerialDirty();
         updateEffectiveVisibility();
     }
 }
@@ -423,6 +524,19 @@ QList<Item *> Item::sortedChildItems() const
 void Item::markSortedChildItemsDirty()
 {
     m_sortedChildItems.reset();
+    markRenderSerialDirty();
+}
+
+void Item::markRenderSerialDirty()
+{
+    for (Item *item = this; item; item = item->parentItem()) {
+        item->m_renderSerial++;
+    }
+}
+
+quint64 Item::renderSerial() const
+{
+    return m_renderSerial;
 }
 
 } // namespace KWin
@@ -8,6 +8,7 @@
 
 #include "kwineffects.h"
 #include "kwinglobals.h"
+#include "utils/compactregion.h"
 
 #include <QMatrix4x4>
 #include <QObject>
@@ -92,6 +93,11 @@ public:
      * Moves this item right after the specified @a sibling in the parent's children list.
      */
     void stackAfter(Item *sibling);
+    /**
+     * Assigns new z values to several child items at once. Unlike calling setZ() on every
+     * child, only the parts where overlapping children have swapped places are repainted.
+     */
+    void restackChildItems(const QVector<std::pair<Item *, int>> &zValues);
 
     bool explicitVisible() const;
     bool isVisible() const;
@@ -101,10 +107,25 @@ public:
     void scheduleFrame();
     QRegion repaints(Output *output) const;
     void resetRepaints(Output *output);
+    /**
+     * Adds the repaints of this item on the given @a output to @a repaints and resets them.
+     */
+    void takeRepaints(Output *output, CompactRegion *repaints);
 
     WindowQuadList quads() const;
+    /**
+     * Returns the quads of this item in the compact representation used for rendering.
+     */
+    RenderGeometry geometry() const;
     virtual void preprocess();
 
+    /**
+     * Returns a serial that changes whenever the position, size, transform, opacity,
+     * visibility, stacking order or quads of this item or any of its descendants change.
+     * It can be used to find out whether data derived from the item tree is stale.
+     */
+    quint64 renderSerial() const;
+
 Q_SIGNALS:
     /**
      * This signal is emitted when the position of this item has changed.
@@ -131,6 +152,7 @@ private:
     void updateBoundingRect();
     void scheduleRepaintInternal(const QRegion &region);
     void markSortedChildItemsDirty();
+    void markRenderSerialDirty();
 
     bool computeEffectiveVisibility() const;
     void updateEffectiveVisibility();
@@ -144,10 +166,12 @@ private:
     QSize m_size = QSize(0, 0);
     qreal m_opacity = 1;
     int m_z = 0;
+    quint64 m_renderSerial = 0;
     bool m_explicitVisible = true;
     bool m_effectiveVisible = true;
-    QMap<Output *, QRegion> m_repaints;
+    QMap<Output *, CompactRegion> m_repaints;
     mutable std::optional<WindowQuadList> m_quads;
+    mutable std::optional<RenderGeometry> m_geometry;
     mutable std::optional<QList<Item *>> m_sortedChildItems;
 };
 
@@ -251,7 +251,7 @@ void KeyboardInputRedirection::processKey(uint32_t key, InputRedirection::Keyboa
         return;
     }
     input()->setLastInputHandler(this);
-    m_input->processFilters(std::bind(&InputEventFilter::keyEvent, std::placeholders::_1, &event));
+    m_input->processFilters(InputRedirection::KeyboardEvents, std::bind(&InputEventFilter::keyEvent, std::placeholders::_1, &event));
 
     m_xkb->forwardModifiers();
     if (auto *inputmethod = InputMethod::self()) {
@@ -15,6 +15,8 @@
 
 #include <QTimer>
 
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -23,6 +25,8 @@ KeyboardRepeat::KeyboardRepeat(Xkb *xkb)
     , m_timer(new QTimer(this))
     , m_xkb(xkb)
 {
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
     connect(m_timer, &QTimer::timeout, this, &KeyboardRepeat::handleKeyRepeat);
 }
 
@@ -31,11 +35,23 @@ KeyboardRepeat::~KeyboardRepeat() = default;
 void KeyboardRepeat::handleKeyRepeat()
 {
     // TODO: don't depend on WaylandServer
+    qint64 interval = waylandServer()->seat()->keyboard()->keyRepeatDelay();
     if (waylandServer()->seat()->keyboard()->keyRepeatRate() != 0) {
-        m_timer->setInterval(1000 / waylandServer()->seat()->keyboard()->keyRepeatRate());
+        interval = 1000 / waylandServer()->seat()->keyboard()->keyRepeatRate();
+    }
+    interval = std::max<qint64>(interval, 1);
+
+    // If the main thread has been busy, send only the last due repeat rather than a burst of them
+    const qint64 elapsed = m_pressTimer.elapsed();
+    qint64 repeat = m_nextRepeat;
+    if (elapsed > repeat) {
+        repeat += (elapsed - repeat) / interval * interval;
     }
-    // TODO: better time
-    Q_EMIT keyRepeat(m_key, m_time);
+    m_nextRepeat = repeat + interval;
+    m_timer->start(std::max<qint64>(0, m_nextRepeat - elapsed));
+
+    // The timestamp is when the repeat was due, in the clock of the key press
+    Q_EMIT keyRepeat(m_key, m_time + repeat);
 }
 
 void KeyboardRepeat::keyEvent(KeyEvent *event)
@@ -47,10 +63,11 @@ void KeyboardRepeat::keyEvent(KeyEvent *event)
     if (event->type() == QEvent::KeyPress) {
         // TODO: don't get these values from WaylandServer
         if (m_xkb->shouldKeyRepeat(key) && waylandServer()->seat()->keyboard()->keyRepeatDelay() != 0) {
-            m_timer->setInterval(waylandServer()->seat()->keyboard()->keyRepeatDelay());
             m_key = key;
             m_time = event->timestamp();
-            m_timer->start();
+            m_pressTimer.start();
+            m_nextRepeat = waylandServer()->seat()->keyboard()->keyRepeatDelay();
+            m_timer->start(m_nextRepeat);
         }
     } else if (event->type() == QEvent::KeyRelease) {
         if (key == m_key) {
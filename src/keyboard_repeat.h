@@ -11,6 +11,7 @@
 
 #include "input_event_spy.h"
 
+#include <QElapsedTimer>
 #include <QObject>
 
 class QTimer;
@@ -37,6 +38,9 @@ private:
     Xkb *m_xkb;
     quint32 m_time;
     quint32 m_key = 0;
+    // The repeats are scheduled relative to the key press so they don't drift
+    QElapsedTimer m_pressTimer;
+    qint64 m_nextRepeat = 0;
 };
 
 }
@@ -68,6 +68,7 @@
 #include "deleted.h"
 #include "effects.h"
 #include "focuschain.h"
+#include "ftrace.h"
 #include "group.h"
 #include "internalwindow.h"
 #include "netinfo.h"
@@ -102,10 +103,17 @@ void Workspace::updateStackingOrder(bool propagate_new_windows)
         }
         return;
     }
+    fTraceDuration("Update stacking order");
     QList<Window *> new_stacking_order = constrainedStackingOrder();
     bool changed = (force_restacking || new_stacking_order != stacking_order);
+    if (force_restacking) {
+        invalidateX11Stack();
+    }
     force_restacking = false;
     stacking_order = new_stacking_order;
+    if (changed) {
+        invalidateDesktopStackingOrders();
+    }
     if (changed || propagate_new_windows) {
         propagateWindows(propagate_new_windows);
 
@@ -134,6 +142,16 @@ void Workspace::stackScreenEdgesUnderOverrideRedirect()
         return;
     }
     Xcb::restackWindows(QVector<xcb_window_t>() << rootInfo()->supportWindow() << ScreenEdges::self()->windows());
+    invalidateX11Stack();
+}
+
+/**
+ * Makes the next propagateWindows() restack all windows, needs to be called after windows
+ * in the stack have been restacked by other means.
+ */
+void Workspace::invalidateX11Stack()
+{
+    m_x11Stack.clear();
 }
 
 /**
@@ -189,7 +207,9 @@ void Workspace::propagateWindows(bool propagate_new_windows)
     // TODO isn't it too inefficient to restack always all windows?
     // TODO don't restack not visible windows?
     Q_ASSERT(newWindowStack.at(0) == rootInfo()->supportWindow());
-    Xcb::restackWindows(newWindowStack);
+    // Only restack the part of the stack that has changed since the last time
+    Xcb::restackWindows(newWindowStack, m_x11Stack);
+    m_x11Stack = newWindowStack;
 
     int pos = 0;
     xcb_window_t *cl(nullptr);
@@ -205,19 +225,20 @@ void Workspace::propagateWindows(bool propagate_new_windows)
         delete[] cl;
     }
 
-    cl = new xcb_window_t[manual_overlays.count() + stacking_order.count()];
-    pos = 0;
+    QVector<xcb_window_t> clientListStacking;
+    clientListStacking.reserve(manual_overlays.count() + stacking_order.count());
     for (auto it = stacking_order.constBegin(); it != stacking_order.constEnd(); ++it) {
         X11Window *window = qobject_cast<X11Window *>(*it);
         if (window) {
-            cl[pos++] = window->window();
+            clientListStacking << window->window();
         }
     }
-    for (const auto win : qAsConst(manual_overlays)) {
-        cl[pos++] = win;
+    clientListStacking << manual_overlays;
+    // Don't rewrite the property for restacks that don't change it
+    if (propagate_new_windows || clientListStacking != m_clientListStacking) {
+        rootInfo()->setClientListStacking(clientListStacking.constData(), clientListStacking.count());
+        m_clientListStacking = clientListStacking;
     }
-    rootInfo()->setClientListStacking(cl, pos);
-    delete[] cl;
 }
 
 /**
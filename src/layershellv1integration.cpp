@@ -182,40 +182,72 @@ static QList<LayerShellV1Window *> windowsForOutput(Output *output)
     return result;
 }
 
-static void rearrangeOutput(Output *output)
+static StrutRects rearrangeOutput(Output *output)
 {
     const QList<LayerShellV1Window *> windows = windowsForOutput(output);
-    if (!windows.isEmpty()) {
-        QRect workArea = output->geometry();
-
-        rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::OverlayLayer, true);
-        rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::TopLayer, true);
-        rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::BottomLayer, true);
-        rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::BackgroundLayer, true);
-
-        rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::OverlayLayer, false);
-        rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::TopLayer, false);
-        rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::BottomLayer, false);
-        rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::BackgroundLayer, false);
+    if (windows.isEmpty()) {
+        return StrutRects();
     }
+
+    QRect workArea = output->geometry();
+
+    rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::OverlayLayer, true);
+    rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::TopLayer, true);
+    rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::BottomLayer, true);
+    rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::BackgroundLayer, true);
+
+    rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::OverlayLayer, false);
+    rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::TopLayer, false);
+    rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::BottomLayer, false);
+    rearrangeLayer(windows, &workArea, LayerSurfaceV1Interface::BackgroundLayer, false);
+
+    StrutRects exclusiveZones;
+    for (LayerShellV1Window *window : windows) {
+        if (window->hasStrut()) {
+            exclusiveZones += window->strutRects();
+        }
+    }
+    return exclusiveZones;
 }
 
 void LayerShellV1Integration::rearrange()
 {
     m_rearrangeTimer->stop();
 
+    // Only the outputs whose layer surfaces changed need to be laid out again. The client
+    // area depends only on the exclusive zones, so there is no need to update it if an
+    // auto-hide panel or an osd got moved around without reserving any different space.
+    QHash<Output *, StrutRects> exclusiveZones;
+    bool exclusiveZonesChanged = false;
+
     const QVector<Output *> outputs = kwinApp()->platform()->enabledOutputs();
     for (Output *output : outputs) {
-        rearrangeOutput(output);
+        if (m_pendingOutputs.contains(output) || !m_exclusiveZones.contains(output)) {
+            exclusiveZones[output] = rearrangeOutput(output);
+            if (exclusiveZones[output] != m_exclusiveZones.value(output)) {
+                exclusiveZonesChanged = true;
+            }
+        } else {
+            exclusiveZones[output] = m_exclusiveZones[output];
+        }
     }
+    for (auto it = m_exclusiveZones.constBegin(); it != m_exclusiveZones.constEnd(); ++it) {
+        if (!exclusiveZones.contains(it.key()) && !it.value().isEmpty()) {
+            exclusiveZonesChanged = true;
+        }
+    }
+
+    m_exclusiveZones = exclusiveZones;
+    m_pendingOutputs.clear();
 
-    if (workspace()) {
+    if (exclusiveZonesChanged && workspace()) {
         workspace()->updateClientArea();
     }
 }
 
-void LayerShellV1Integration::scheduleRearrange()
+void LayerShellV1Integration::scheduleRearrange(Output *output)
 {
+    m_pendingOutputs.insert(output);
     m_rearrangeTimer->start();
 }
 
@@ -6,8 +6,11 @@
 
 #pragma once
 
+#include "utils/common.h"
 #include "waylandshellintegration.h"
 
+#include <QSet>
+
 namespace KWaylandServer
 {
 class LayerSurfaceV1Interface;
@@ -16,6 +19,8 @@ class LayerSurfaceV1Interface;
 namespace KWin
 {
 
+class Output;
+
 class LayerShellV1Integration : public WaylandShellIntegration
 {
     Q_OBJECT
@@ -24,7 +29,7 @@ public:
     explicit LayerShellV1Integration(QObject *parent = nullptr);
 
     void rearrange();
-    void scheduleRearrange();
+    void scheduleRearrange(Output *output);
 
     void createWindow(KWaylandServer::LayerSurfaceV1Interface *shellSurface);
     void recreateWindow(KWaylandServer::LayerSurfaceV1Interface *shellSurface);
@@ -32,6 +37,8 @@ public:
 
 private:
     QTimer *m_rearrangeTimer;
+    QSet<Output *> m_pendingOutputs;
+    QHash<Output *, StrutRects> m_exclusiveZones;
 };
 
 } // namespace KWin
@@ -93,7 +93,7 @@ Output *LayerShellV1Window::desiredOutput() const
 
 void LayerShellV1Window::scheduleRearrange()
 {
-    m_integration->scheduleRearrange();
+    m_integration->scheduleRearrange(m_desiredOutput);
 }
 
 NET::WindowType LayerShellV1Window::windowType(bool, int) const
@@ -58,6 +58,15 @@ public:
 
     bool isActive() const;
 
+    /**
+     * Evaluates the easing curve of the timeline at its current position. The result is
+     * kept in value, so painting doesn't need to evaluate the curve for every attribute.
+     */
+    inline void updateValue()
+    {
+        value = timeLine.value();
+    }
+
     inline bool isOneDimensional() const
     {
         return from[0] == from[1] && to[0] == to[1];
@@ -69,6 +78,7 @@ public:
     int customCurve;
     FPx2 from, to;
     TimeLine timeLine;
+    qreal value{0.0};
     uint meta;
     qint64 frozenTime;
     qint64 startTime;
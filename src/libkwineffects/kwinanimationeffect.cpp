@@ -263,6 +263,7 @@ quint64 AnimationEffect::p_animate(EffectWindow *w, Attribute a, uint meta, int
     animation.timeLine.setEasingCurve(curve);
     animation.timeLine.setSourceRedirectMode(TimeLine::RedirectMode::Strict);
     animation.timeLine.setTargetRedirectMode(TimeLine::RedirectMode::Relaxed);
+    animation.updateValue();
 
     animation.terminationFlags = TerminateAtSource;
     if (!keepAtTarget) {
@@ -308,6 +309,7 @@ bool AnimationEffect::retarget(quint64 animationId, FPx2 newTarget, int newRemai
                 anim->timeLine.setDirection(TimeLine::Forward);
                 anim->timeLine.setDuration(std::chrono::milliseconds(newRemainingTime));
                 anim->timeLine.reset();
+                anim->updateValue();
 
                 return true;
             }
@@ -332,6 +334,7 @@ bool AnimationEffect::freezeInTime(quint64 animationId, qint64 frozenTime)
             if (anim->id == animationId) {
                 if (frozenTime >= 0) {
                     anim->timeLine.setElapsed(std::chrono::milliseconds(frozenTime));
+                    anim->updateValue();
                 }
                 anim->frozenTime = frozenTime;
                 return true;
@@ -369,6 +372,7 @@ bool AnimationEffect::redirect(quint64 animationId, Direction direction, Termina
         }
 
         animIt->terminationFlags = terminationFlags & ~TerminateAtTarget;
+        animIt->updateValue();
 
         return true;
     }
@@ -394,6 +398,7 @@ bool AnimationEffect::complete(quint64 animationId)
         }
 
         animIt->timeLine.setElapsed(animIt->timeLine.duration());
+        animIt->updateValue();
 
         return true;
     }
@@ -436,13 +441,15 @@ void AnimationEffect::prePaintScreen(ScreenPrePaintData &data, std::chrono::mill
         return;
     }
 
+    // Advance all timelines and evaluate their easing curves in one pass, the paint
+    // functions only read the cached values afterwards
+    const qint64 now = clock();
     for (auto entry = d->m_animations.begin(); entry != d->m_animations.end(); ++entry) {
         for (auto anim = entry->first.begin(); anim != entry->first.end(); ++anim) {
-            if (anim->startTime <= clock()) {
-                if (anim->frozenTime < 0) {
-                    anim->timeLine.advance(presentTime);
-                }
+            if (anim->startTime <= now && anim->frozenTime < 0) {
+                anim->timeLine.advance(presentTime);
             }
+            anim->updateValue();
         }
     }
 
@@ -503,8 +510,9 @@ void AnimationEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &data,
     Q_D(AnimationEffect);
     AniMap::const_iterator entry = d->m_animations.constFind(w);
     if (entry != d->m_animations.constEnd()) {
+        const qint64 now = clock();
         for (QList<AniData>::const_iterator anim = entry->first.constBegin(); anim != entry->first.constEnd(); ++anim) {
-            if (anim->startTime > clock() && !anim->waitAtSource) {
+            if (anim->startTime > now && !anim->waitAtSource) {
                 continue;
             }
 
@@ -534,9 +542,10 @@ void AnimationEffect::paintWindow(EffectWindow *w, int mask, QRegion region, Win
     Q_D(AnimationEffect);
     AniMap::const_iterator entry = d->m_animations.constFind(w);
     if (entry != d->m_animations.constEnd()) {
+        const qint64 now = clock();
         for (QList<AniData>::const_iterator anim = entry->first.constBegin(); anim != entry->first.constEnd(); ++anim) {
 
-            if (anim->startTime > clock() && !anim->waitAtSource) {
+            if (anim->startTime > now && !anim->waitAtSource) {
                 continue;
             }
 
@@ -738,12 +747,12 @@ void AnimationEffect::postPaintScreen()
 
 float AnimationEffect::interpolated(const AniData &a, int i) const
 {
-    return a.from[i] + a.timeLine.value() * (a.to[i] - a.from[i]);
+    return a.from[i] + a.value * (a.to[i] - a.from[i]);
 }
 
 float AnimationEffect::progress(const AniData &a) const
 {
-    return a.startTime < clock() ? a.timeLine.value() : 0.0;
+    return a.startTime < clock() ? a.value : 0.0;
 }
 
 // TODO - get this out of the header - the functionpointer usage of QEasingCurve somehow sucks ;-)
@@ -870,7 +879,7 @@ void AnimationEffect::updateLayerRepaints()
                 break;
             case Rotation:
                 createRegion = false;
-                *layerRect = QRect(QPoint(0, 0), effects->virtualScreenSize());
+                *layerRect = effects->windowScreensArea(entry.key()).boundingRect();
                 goto region_creation; // sic! no need to do anything else
             case Generic:
                 d->m_needSceneRepaint = true; // we don't know whether this will change visual stacking order
@@ -5,9 +5,15 @@
 */
 
 #include "kwindeformeffect.h"
+#include "kwinglplatform.h"
 #include "kwingltexture.h"
 #include "kwinglutils.h"
 
+#include <QTextStream>
+
+#include <map>
+#include <memory>
+
 namespace KWin
 {
 
@@ -17,6 +23,7 @@ struct DeformOffscreenData
     QScopedPointer<GLFramebuffer> fbo;
     bool isDirty = true;
     GLShader *shader = nullptr;
+    QSize gridSize;
 };
 
 class DeformEffectPrivate
@@ -27,10 +34,17 @@ public:
     QMetaObject::Connection windowDeletedConnection;
 
     void paint(EffectWindow *window, GLTexture *texture, const QRegion &region,
-               const WindowPaintData &data, const WindowQuadList &quads, GLShader *offscreenShader);
+               const WindowPaintData &data, const RenderGeometry &geometry, GLShader *offscreenShader);
+
+    void paintGrid(EffectWindow *window, GLTexture *texture, const QRegion &region,
+                   const WindowPaintData &data, const QRectF &visibleRect, DeformOffscreenData *offscreenData);
 
     GLTexture *maybeRender(EffectWindow *window, DeformOffscreenData *offscreenData);
+    GLVertexBuffer *deformationGrid(const QSize &gridSize);
     bool live = true;
+
+    // the static grid meshes, in normalized coordinates, by their number of columns and rows
+    std::map<std::pair<int, int>, std::unique_ptr<GLVertexBuffer>> grids;
 };
 
 DeformEffect::DeformEffect(QObject *parent)
@@ -49,6 +63,57 @@ bool DeformEffect::supported()
     return effects->isOpenGLCompositing();
 }
 
+GLShader *DeformEffect::createDeformationShader(const QByteArray &deformation)
+{
+    QByteArray source;
+    QTextStream stream(&source);
+
+    GLPlatform *const gl = GLPlatform::instance();
+    QByteArray attribute, varying;
+
+    if (!gl->isGLES()) {
+        const bool glsl_140 = gl->glslVersion() >= kVersionNumber(1, 40);
+
+        attribute = glsl_140 ? QByteArrayLiteral("in") : QByteArrayLiteral("attribute");
+        varying = glsl_140 ? QByteArrayLiteral("out") : QByteArrayLiteral("varying");
+
+        if (glsl_140) {
+            stream << "#version 140\n\n";
+        }
+    } else {
+        const bool glsl_es_300 = gl->glslVersion() >= kVersionNumber(3, 0);
+
+        attribute = glsl_es_300 ? QByteArrayLiteral("in") : QByteArrayLiteral("attribute");
+        varying = glsl_es_300 ? QByteArrayLiteral("out") : QByteArrayLiteral("varying");
+
+        if (glsl_es_300) {
+            stream << "#version 300 es\n\n";
+        }
+    }
+
+    stream << attribute << " vec4 position;\n";
+    stream << varying << " vec2 texcoord0;\n\n";
+
+    stream << "uniform mat4 modelViewProjectionMatrix;\n";
+    stream << "uniform mat4 textureMatrix;\n";
+    // x, y, width and height of the painted area relative to the frame geometry
+    stream << "uniform vec4 deformationRect;\n\n";
+
+    stream.flush();
+    source += deformation;
+    stream << "\n\n";
+
+    stream << "void main()\n{\n";
+    stream << "    texcoord0 = (textureMatrix * vec4(position.xy, 0.0, 1.0)).st;\n";
+    stream << "    vec2 vertex = deformationRect.xy + position.xy * deformationRect.zw;\n";
+    stream << "    gl_Position = modelViewProjectionMatrix * vec4(deformVertex(vertex), 0.0, 1.0);\n";
+    stream << "}\n";
+    stream.flush();
+
+    const ShaderTraits traits = ShaderTrait::MapTexture | ShaderTrait::Modulate | ShaderTrait::AdjustSaturation;
+    return ShaderManager::instance()->generateCustomShader(traits, source);
+}
+
 void DeformEffect::setLive(bool live)
 {
     Q_ASSERT(d->windows.isEmpty());
@@ -89,6 +154,54 @@ void DeformEffect::deform(EffectWindow *window, int mask, WindowPaintData &data,
     Q_UNUSED(quads)
 }
 
+void DeformEffect::updateDeformation(EffectWindow *window, int mask, WindowPaintData &data, GLShader *shader)
+{
+    Q_UNUSED(window)
+    Q_UNUSED(mask)
+    Q_UNUSED(data)
+    Q_UNUSED(shader)
+}
+
+GLVertexBuffer *DeformEffectPrivate::deformationGrid(const QSize &gridSize)
+{
+    std::unique_ptr<GLVertexBuffer> &grid = grids[std::make_pair(gridSize.width(), gridSize.height())];
+    if (grid) {
+        return grid.get();
+    }
+
+    QVector<GLVertex2D> vertices;
+    vertices.reserve(gridSize.width() * gridSize.height() * 6);
+
+    for (int row = 0; row < gridSize.height(); ++row) {
+        const float top = float(row) / gridSize.height();
+        const float bottom = float(row + 1) / gridSize.height();
+        for (int column = 0; column < gridSize.width(); ++column) {
+            const float left = float(column) / gridSize.width();
+            const float right = float(column + 1) / gridSize.width();
+
+            // the positions double as texture coordinates
+            const GLVertex2D topLeft{QVector2D(left, top), QVector2D(left, top)};
+            const GLVertex2D topRight{QVector2D(right, top), QVector2D(right, top)};
+            const GLVertex2D bottomRight{QVector2D(right, bottom), QVector2D(right, bottom)};
+            const GLVertex2D bottomLeft{QVector2D(left, bottom), QVector2D(left, bottom)};
+
+            vertices << topLeft << topRight << bottomRight;
+            vertices << bottomRight << bottomLeft << topLeft;
+        }
+    }
+
+    const GLVertexAttrib attribs[] = {
+        {VA_Position, 2, GL_FLOAT, offsetof(GLVertex2D, position)},
+        {VA_TexCoord, 2, GL_FLOAT, offsetof(GLVertex2D, texcoord)},
+    };
+
+    grid = std::make_unique<GLVertexBuffer>(GLVertexBuffer::Static);
+    grid->setAttribLayout(attribs, 2, sizeof(GLVertex2D));
+    grid->setData(vertices.constData(), vertices.size() * sizeof(GLVertex2D));
+    grid->setVertexCount(vertices.size());
+    return grid.get();
+}
+
 GLTexture *DeformEffectPrivate::maybeRender(EffectWindow *window, DeformOffscreenData *offscreenData)
 {
     const QRect geometry = window->expandedGeometry();
@@ -131,7 +244,7 @@ GLTexture *DeformEffectPrivate::maybeRender(EffectWindow *window, DeformOffscree
 }
 
 void DeformEffectPrivate::paint(EffectWindow *window, GLTexture *texture, const QRegion &region,
-                                const WindowPaintData &data, const WindowQuadList &quads, GLShader *offscreenShader)
+                                const WindowPaintData &data, const RenderGeometry &geometry, GLShader *offscreenShader)
 {
     GLShader *shader = offscreenShader ? offscreenShader : ShaderManager::instance()->shader(ShaderTrait::MapTexture | ShaderTrait::Modulate | ShaderTrait::AdjustSaturation);
     ShaderBinder binder(shader);
@@ -148,10 +261,10 @@ void DeformEffectPrivate::paint(EffectWindow *window, GLTexture *texture, const
     GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
     vbo->reset();
     vbo->setAttribLayout(attribs, 2, sizeof(GLVertex2D));
-    const size_t size = verticesPerQuad * quads.count() * sizeof(GLVertex2D);
+    const size_t size = verticesPerQuad * geometry.count() * sizeof(GLVertex2D);
     GLVertex2D *map = static_cast<GLVertex2D *>(vbo->map(size));
 
-    quads.makeInterleavedArrays(primitiveType, map, texture->matrix(NormalizedCoordinates));
+    geometry.makeInterleavedArrays(primitiveType, map, texture->matrix(NormalizedCoordinates));
     vbo->unmap();
     vbo->bindArrays();
 
@@ -169,7 +282,8 @@ void DeformEffectPrivate::paint(EffectWindow *window, GLTexture *texture, const
     const bool clipping = region != infiniteRegion();
     const QRegion clipRegion = clipping ? effects->mapToRenderTarget(region) : infiniteRegion();
 
-    if (clipping) {
+    const bool scissorWasEnabled = glIsEnabled(GL_SCISSOR_TEST);
+    if (clipping && !scissorWasEnabled) {
         glEnable(GL_SCISSOR_TEST);
     }
 
@@ -177,16 +291,58 @@ void DeformEffectPrivate::paint(EffectWindow *window, GLTexture *texture, const
     glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
     texture->bind();
-    vbo->draw(clipRegion, primitiveType, 0, verticesPerQuad * quads.count(), clipping);
+    vbo->draw(clipRegion, primitiveType, 0, verticesPerQuad * geometry.count(), clipping);
     texture->unbind();
 
     glDisable(GL_BLEND);
-    if (clipping) {
+    if (clipping && !scissorWasEnabled) {
         glDisable(GL_SCISSOR_TEST);
     }
     vbo->unbindArrays();
 }
 
+void DeformEffectPrivate::paintGrid(EffectWindow *window, GLTexture *texture, const QRegion &region,
+                                    const WindowPaintData &data, const QRectF &visibleRect, DeformOffscreenData *offscreenData)
+{
+    GLShader *shader = offscreenData->shader;
+    GLVertexBuffer *vbo = deformationGrid(offscreenData->gridSize);
+
+    const qreal rgb = data.brightness() * data.opacity();
+    const qreal a = data.opacity();
+
+    QMatrix4x4 mvp = data.screenProjectionMatrix();
+    mvp.translate(window->x(), window->y());
+    shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+    shader->setUniform(GLShader::TextureMatrix, texture->matrix(NormalizedCoordinates));
+    shader->setUniform(GLShader::ModulationConstant, QVector4D(rgb, rgb, rgb, a));
+    shader->setUniform(GLShader::Saturation, data.saturation());
+    shader->setUniform(GLShader::TextureWidth, texture->width());
+    shader->setUniform(GLShader::TextureHeight, texture->height());
+    shader->setUniform("deformationRect", QVector4D(visibleRect.x(), visibleRect.y(), visibleRect.width(), visibleRect.height()));
+
+    const bool clipping = region != infiniteRegion();
+    const QRegion clipRegion = clipping ? effects->mapToRenderTarget(region) : infiniteRegion();
+
+    const bool scissorWasEnabled = glIsEnabled(GL_SCISSOR_TEST);
+    if (clipping && !scissorWasEnabled) {
+        glEnable(GL_SCISSOR_TEST);
+    }
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    texture->bind();
+    vbo->bindArrays();
+    vbo->draw(clipRegion, GL_TRIANGLES, 0, offscreenData->gridSize.width() * offscreenData->gridSize.height() * 6, clipping);
+    vbo->unbindArrays();
+    texture->unbind();
+
+    glDisable(GL_BLEND);
+    if (clipping && !scissorWasEnabled) {
+        glDisable(GL_SCISSOR_TEST);
+    }
+}
+
 void DeformEffect::drawWindow(EffectWindow *window, int mask, const QRegion &region, WindowPaintData &data)
 {
     DeformOffscreenData *offscreenData = d->windows.value(window);
@@ -200,6 +356,15 @@ void DeformEffect::drawWindow(EffectWindow *window, int mask, const QRegion &reg
 
     QRectF visibleRect = expandedGeometry;
     visibleRect.moveTopLeft(expandedGeometry.topLeft() - frameGeometry.topLeft());
+
+    if (offscreenData->shader && !offscreenData->gridSize.isEmpty()) {
+        GLTexture *texture = d->maybeRender(window, offscreenData);
+        ShaderBinder binder(offscreenData->shader);
+        updateDeformation(window, mask, data, offscreenData->shader);
+        d->paintGrid(window, texture, region, data, visibleRect, offscreenData);
+        return;
+    }
+
     WindowQuad quad;
     quad[0] = WindowVertex(visibleRect.topLeft(), QPointF(0, 0));
     quad[1] = WindowVertex(visibleRect.topRight(), QPointF(1, 0));
@@ -211,7 +376,7 @@ void DeformEffect::drawWindow(EffectWindow *window, int mask, const QRegion &reg
     deform(window, mask, data, quads);
 
     GLTexture *texture = d->maybeRender(window, offscreenData);
-    d->paint(window, texture, region, data, quads, offscreenData->shader);
+    d->paint(window, texture, region, data, RenderGeometry::fromWindowQuadList(quads), offscreenData->shader);
 }
 
 void DeformEffect::handleWindowDamaged(EffectWindow *window)
@@ -254,4 +419,12 @@ void DeformEffect::setShader(EffectWindow *window, GLShader *shader)
     }
 }
 
+void DeformEffect::setDeformationGrid(EffectWindow *window, const QSize &gridSize)
+{
+    DeformOffscreenData *offscreenData = d->windows.value(window);
+    if (offscreenData) {
+        offscreenData->gridSize = gridSize;
+    }
+}
+
 } // namespace KWin
@@ -26,6 +26,12 @@ class DeformEffectPrivate;
  * If a window is redirected into offscreen texture, the deform() function will be
  * called with the window quads that can be mutated by the effect. The effect can
  * sub-divide, remove, or transform the window quads.
+ *
+ * Alternatively, the effect can deform the window on the GPU. If a deformation grid
+ * has been set with setDeformationGrid(), the window is painted as a static grid mesh
+ * that is transformed by the vertex shader set with setShader(), and the
+ * updateDeformation() function is called instead of deform() to let the effect update
+ * the uniforms of the shader.
  */
 class KWINEFFECTS_EXPORT DeformEffect : public Effect
 {
@@ -37,6 +43,21 @@ public:
 
     static bool supported();
 
+    /**
+     * Creates a shader that paints the deformation grid of a window. The @a deformation
+     * code declares the uniforms of the effect and defines the function
+     * @code
+     * vec2 deformVertex(vec2 position)
+     * @endcode
+     * which returns the deformed position of a grid vertex, given its undeformed
+     * @a position, both relative to the top-left corner of the frame geometry. The
+     * fragment stage is the same as for windows painted with deform().
+     *
+     * The ownership of the shader is passed to the caller.
+     * @since 5.26
+     */
+    static GLShader *createDeformationShader(const QByteArray &deformation);
+
     /**
      * If set our offscreen texture will be updated with the latest contents
      * It should be set before redirecting windows
@@ -70,6 +91,24 @@ protected:
      **/
     void setShader(EffectWindow *window, GLShader *shader);
 
+    /**
+     * Makes @p window be painted as a static grid of @p gridSize quads that is deformed
+     * by the vertex shader set with setShader(), see createDeformationShader(). The grid
+     * mesh is uploaded once and shared with all windows that use the same grid size.
+     * An empty @p gridSize switches the window back to deform().
+     * Can only be called once the window is redirected.
+     * @since 5.26
+     */
+    void setDeformationGrid(EffectWindow *window, const QSize &gridSize);
+
+    /**
+     * Override this function to update the uniforms of the deformation shader of the
+     * given window, which is bound when this function is called. It is only called for
+     * windows that have a deformation grid.
+     * @since 5.26
+     */
+    virtual void updateDeformation(EffectWindow *window, int mask, WindowPaintData &data, GLShader *shader);
+
 private Q_SLOTS:
     void handleWindowDamaged(EffectWindow *window);
     void handleWindowDeleted(EffectWindow *window);
@@ -596,6 +596,17 @@ bool Effect::isActive() const
     return true;
 }
 
+Effect::PaintHooks Effect::paintHooks() const
+{
+    return AllPaintHooks;
+}
+
+bool Effect::isActiveForWindow(EffectWindow *w) const
+{
+    Q_UNUSED(w)
+    return true;
+}
+
 QString Effect::debug(const QString &) const
 {
     return QString();
@@ -1264,6 +1275,164 @@ void WindowQuadList::makeArrays(float **vertices, float **texcoords, const QSize
     }
 }
 
+/***************************************************************
+ RenderGeometry
+***************************************************************/
+
+RenderGeometry RenderGeometry::fromWindowQuadList(const WindowQuadList &quads)
+{
+    RenderGeometry geometry;
+    geometry.reserve(quads.count());
+    for (const WindowQuad &quad : quads) {
+        geometry.append(quad);
+    }
+    return geometry;
+}
+
+WindowQuadList RenderGeometry::toWindowQuadList() const
+{
+    WindowQuadList quads;
+    quads.reserve(count());
+    for (int i = 0; i < m_positions.count(); i += 4) {
+        WindowQuad quad;
+        for (int j = 0; j < 4; ++j) {
+            const QVector2D &position = m_positions[i + j];
+            const QVector2D &texcoord = m_texcoords[i + j];
+            quad[j] = WindowVertex(position.x(), position.y(), texcoord.x(), texcoord.y());
+        }
+        quads.append(quad);
+    }
+    return quads;
+}
+
+int RenderGeometry::count() const
+{
+    return m_positions.count() / 4;
+}
+
+bool RenderGeometry::isEmpty() const
+{
+    return m_positions.isEmpty();
+}
+
+void RenderGeometry::reserve(int quadCount)
+{
+    m_positions.reserve(quadCount * 4);
+    m_texcoords.reserve(quadCount * 4);
+}
+
+void RenderGeometry::clear()
+{
+    m_positions.clear();
+    m_texcoords.clear();
+}
+
+void RenderGeometry::append(const WindowQuad &quad)
+{
+    for (int i = 0; i < 4; ++i) {
+        const WindowVertex &vertex = quad[i];
+        m_positions.append(QVector2D(vertex.x(), vertex.y()));
+        m_texcoords.append(QVector2D(vertex.u(), vertex.v()));
+    }
+}
+
+void RenderGeometry::appendSubQuad(const WindowQuad &quad, double x1, double y1, double x2, double y2)
+{
+    Q_ASSERT(x1 < x2 && y1 < y2 && x1 >= quad.left() && x2 <= quad.right() && y1 >= quad.top() && y2 <= quad.bottom());
+
+    const double xOrigin = quad.left();
+    const double yOrigin = quad.top();
+
+    const double widthReciprocal = 1 / (quad.right() - xOrigin);
+    const double heightReciprocal = 1 / (quad.bottom() - yOrigin);
+
+    // vertices are clockwise starting from topleft
+    const double xs[4] = {x1, x2, x2, x1};
+    const double ys[4] = {y1, y1, y2, y2};
+
+    for (int i = 0; i < 4; ++i) {
+        const double w1 = (xs[i] - xOrigin) * widthReciprocal;
+        const double w2 = (ys[i] - yOrigin) * heightReciprocal;
+
+        // Use bilinear interpolation to compute the texture coords.
+        const double u = (1 - w1) * (1 - w2) * quad[0].u() + w1 * (1 - w2) * quad[1].u() + w1 * w2 * quad[2].u() + (1 - w1) * w2 * quad[3].u();
+        const double v = (1 - w1) * (1 - w2) * quad[0].v() + w1 * (1 - w2) * quad[1].v() + w1 * w2 * quad[2].v() + (1 - w1) * w2 * quad[3].v();
+
+        m_positions.append(QVector2D(xs[i], ys[i]));
+        m_texcoords.append(QVector2D(u, v));
+    }
+}
+
+void RenderGeometry::map(const QMatrix4x4 &matrix)
+{
+    if (matrix.isIdentity()) {
+        return;
+    }
+    for (QVector2D &position : m_positions) {
+        position = QVector2D(matrix.map(position.toPointF()));
+    }
+}
+
+void RenderGeometry::makeInterleavedArrays(unsigned int type, GLVertex2D *vertices, const QMatrix4x4 &textureMatrix) const
+{
+    // Since we know that the texture matrix just scales and translates
+    // we can use this information to optimize the transformation
+    const QVector2D coeff(textureMatrix(0, 0), textureMatrix(1, 1));
+    const QVector2D offset(textureMatrix(0, 3), textureMatrix(1, 3));
+
+    const QVector2D *positions = m_positions.constData();
+    const QVector2D *texcoords = m_texcoords.constData();
+    const int vertexCount = m_positions.count();
+
+    GLVertex2D *vertex = vertices;
+
+    Q_ASSERT(type == GL_QUADS || type == GL_TRIANGLES);
+
+    switch (type) {
+    case GL_QUADS:
+        for (int i = 0; i < vertexCount; ++i) {
+            vertex->position = positions[i];
+            vertex->texcoord = texcoords[i] * coeff + offset;
+            ++vertex;
+        }
+        break;
+
+    case GL_TRIANGLES:
+        for (int i = 0; i < vertexCount; i += 4) {
+            GLVertex2D v[4]; // Four unique vertices / quad
+
+            for (int j = 0; j < 4; j++) {
+                v[j].position = positions[i + j];
+                v[j].texcoord = texcoords[i + j] * coeff + offset;
+            }
+
+            // First triangle
+            *(vertex++) = v[1]; // Top-right
+            *(vertex++) = v[0]; // Top-left
+            *(vertex++) = v[3]; // Bottom-left
+
+            // Second triangle
+            *(vertex++) = v[3]; // Bottom-left
+            *(vertex++) = v[2]; // Bottom-right
+            *(vertex++) = v[1]; // Top-right
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+const QVector2D *RenderGeometry::positions() const
+{
+    return m_positions.constData();
+}
+
+const QVector2D *RenderGeometry::textureCoordinates() const
+{
+    return m_texcoords.constData();
+}
+
 /***************************************************************
  Motion1D
 ***************************************************************/
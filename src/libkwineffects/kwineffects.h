@@ -38,6 +38,7 @@
 
 #include <netwm.h>
 
+#include <chrono>
 #include <climits>
 #include <functional>
 
@@ -180,7 +181,7 @@ X-KDE-Library=kwin4_effect_cooleffect
 
 #define KWIN_EFFECT_API_MAKE_VERSION(major, minor) ((major) << 8 | (minor))
 #define KWIN_EFFECT_API_VERSION_MAJOR 0
-#define KWIN_EFFECT_API_VERSION_MINOR 234
+#define KWIN_EFFECT_API_VERSION_MINOR 240
 #define KWIN_EFFECT_API_VERSION KWIN_EFFECT_API_MAKE_VERSION( \
     KWIN_EFFECT_API_VERSION_MAJOR, KWIN_EFFECT_API_VERSION_MINOR)
 
@@ -359,6 +360,24 @@ public:
     };
     Q_DECLARE_FLAGS(ReconfigureFlags, ReconfigureFlag)
 
+    /**
+     * Flags describing which paint hooks are implemented by the effect.
+     * @since 5.26
+     */
+    enum PaintHook {
+        PrePaintScreenHook = 1 << 0,
+        PaintScreenHook = 1 << 1,
+        PostPaintScreenHook = 1 << 2,
+        PrePaintWindowHook = 1 << 3,
+        PaintWindowHook = 1 << 4,
+        PostPaintWindowHook = 1 << 5,
+        DrawWindowHook = 1 << 6,
+        ScreenPaintHooks = PrePaintScreenHook | PaintScreenHook | PostPaintScreenHook,
+        WindowPaintHooks = PrePaintWindowHook | PaintWindowHook | PostPaintWindowHook | DrawWindowHook,
+        AllPaintHooks = ScreenPaintHooks | WindowPaintHooks,
+    };
+    Q_DECLARE_FLAGS(PaintHooks, PaintHook)
+
     /**
      * Called when configuration changes (either the effect's or KWin's global).
      *
@@ -498,6 +517,31 @@ public:
      */
     virtual bool isActive() const;
 
+    /**
+     * Reimplement this method to indicate which paint hooks the effect implements. The
+     * effect will be skipped when the compositor walks the chain of a hook that is not
+     * in the returned set. The method is called once per frame for every active effect.
+     *
+     * The default implementation returns AllPaintHooks.
+     * @see isActiveForWindow
+     * @since 5.26
+     */
+    virtual PaintHooks paintHooks() const;
+
+    /**
+     * Reimplement this method to indicate whether the effect wants to be involved in
+     * painting the window @p w in the next frame. If the method returns @c false, the
+     * prePaintWindow(), paintWindow(), drawWindow() and postPaintWindow() hooks of the
+     * effect will not be called for @p w.
+     *
+     * The method is called at most once per window and frame, but it is called for
+     * every painted window, so it should be cheap.
+     *
+     * The default implementation returns @c true.
+     * @since 5.26
+     */
+    virtual bool isActiveForWindow(EffectWindow *w) const;
+
     /**
      * Reimplement this method to provide online debugging.
      * This could be as trivial as printing specific detail information about the effect state
@@ -863,6 +907,12 @@ public:
     virtual void paintWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data) = 0;
     virtual void postPaintWindow(EffectWindow *w) = 0;
     virtual void drawWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data) = 0;
+    /**
+     * Renders the window @p w right away, without calling the drawWindow() hooks of the
+     * effects, e.g. to render it into an offscreen texture.
+     * @since 5.26
+     */
+    virtual void renderWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data) = 0;
     virtual QVariant kwinOption(KWinOption kwopt) = 0;
     /**
      * Sets the cursor while the mouse is intercepted.
@@ -1175,6 +1225,14 @@ public:
     Q_SCRIPTABLE virtual void addRepaint(const QRect &r) = 0;
     Q_SCRIPTABLE virtual void addRepaint(const QRegion &r) = 0;
     Q_SCRIPTABLE virtual void addRepaint(int x, int y, int w, int h) = 0;
+    /**
+     * Returns the area of the screens that the window @p w is on. Effects that transform a
+     * window in a way whose bounds are hard to predict, e.g. with a perspective projection,
+     * should repaint this area instead of calling addRepaintFull(), so that screens which
+     * don't show the window aren't repainted.
+     * @since 5.26
+     */
+    virtual QRegion windowScreensArea(const EffectWindow *w) const = 0;
 
     CompositingType compositingType() const;
     /**
@@ -1461,6 +1519,50 @@ public:
     virtual KWin::EffectWindow *inputPanel() const = 0;
     virtual bool isInputPanelOverlay() const = 0;
 
+    /**
+     * The EffectCost struct describes how much time the paint hooks of an effect
+     * take per frame, averaged over the recent frames.
+     * @since 5.26
+     */
+    struct EffectCost
+    {
+        /**
+         * The name of the effect, or an empty string for the scene.
+         */
+        QString name;
+        std::chrono::nanoseconds cpuTime;
+        /**
+         * Zero if GPU timer queries are not supported.
+         */
+        std::chrono::nanoseconds gpuTime;
+    };
+
+    /**
+     * Enables or disables measuring how long the paint hooks of the effects take.
+     * @since 5.26
+     */
+    virtual void setEffectProfilingEnabled(bool enabled) = 0;
+    virtual bool isEffectProfilingEnabled() const = 0;
+    /**
+     * Returns the cost of every profiled effect, the most expensive effect first.
+     * @since 5.26
+     */
+    virtual QVector<EffectCost> effectCosts() const = 0;
+
+    /**
+     * Returns @c true if all outputs are powered off. Nothing is painted while the
+     * compositor sleeps, so effects should not drive animations or render offscreen content.
+     * @see sleepingChanged
+     * @since 5.26
+     */
+    virtual bool isSleeping() const = 0;
+
+    /**
+     * Returns @c true if the effect with the given @a name is loaded.
+     * @since 5.26
+     */
+    virtual bool isEffectLoaded(const QString &name) const = 0;
+
 Q_SIGNALS:
     /**
      * This signal is emitted whenever a new @a screen is added to the system.
@@ -1788,6 +1890,12 @@ Q_SIGNALS:
      * @since 4.11
      */
     void screenLockingChanged(bool locked);
+    /**
+     * This signal is emitted when all outputs have been powered off or the first of them
+     * has been powered on again.
+     * @since 5.26
+     */
+    void sleepingChanged(bool sleeping);
 
     /**
      * This signal is emitted just before the screen locker tries to grab keys and lock the screen
@@ -2924,6 +3032,57 @@ public:
     void makeArrays(float **vertices, float **texcoords, const QSizeF &size, bool yInverted) const;
 };
 
+/**
+ * @short Compact single precision storage for window quads.
+ *
+ * RenderGeometry keeps the vertex positions and the texture coordinates of a list of quads
+ * in two separate single precision arrays. Every quad occupies four consecutive vertices in
+ * the clockwise order starting from the top-left corner, like in WindowQuad.
+ *
+ * This is half the size of a WindowQuadList with the same contents, and passes that only
+ * touch the positions, e.g. transforming the vertices, don't have to load texture coordinates.
+ *
+ * WindowQuadList remains the geometry type that effects work with; use fromWindowQuadList()
+ * and toWindowQuadList() to convert between the two representations.
+ *
+ * @since 5.26
+ */
+class KWINEFFECTS_EXPORT RenderGeometry
+{
+public:
+    static RenderGeometry fromWindowQuadList(const WindowQuadList &quads);
+    WindowQuadList toWindowQuadList() const;
+
+    /**
+     * Returns the number of quads in the geometry.
+     */
+    int count() const;
+    bool isEmpty() const;
+    void reserve(int quadCount);
+    void clear();
+
+    void append(const WindowQuad &quad);
+    /**
+     * Appends the part of the @a quad inside the rectangle specified by @a x1, @a y1,
+     * @a x2, and @a y2. This is equivalent to appending quad.makeSubQuad(x1, y1, x2, y2).
+     */
+    void appendSubQuad(const WindowQuad &quad, double x1, double y1, double x2, double y2);
+
+    /**
+     * Maps all vertex positions by the given @a matrix. Texture coordinates are left as is.
+     */
+    void map(const QMatrix4x4 &matrix);
+
+    void makeInterleavedArrays(unsigned int type, GLVertex2D *vertices, const QMatrix4x4 &textureMatrix) const;
+
+    const QVector2D *positions() const;
+    const QVector2D *textureCoordinates() const;
+
+private:
+    QVector<QVector2D> m_positions;
+    QVector<QVector2D> m_texcoords;
+};
+
 class KWINEFFECTS_EXPORT WindowPrePaintData
 {
 public:
@@ -4195,6 +4354,7 @@ inline void EffectWindow::addLayerRepaint(int x, int y, int w, int h)
 }
 
 } // namespace
+Q_DECLARE_OPERATORS_FOR_FLAGS(KWin::Effect::PaintHooks)
 Q_DECLARE_METATYPE(KWin::EffectWindow *)
 Q_DECLARE_METATYPE(KWin::EffectWindowList)
 Q_DECLARE_METATYPE(KWin::TimeLine)
@@ -0,0 +1,184 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "kwinglshadercache_p.h"
+
+#include "kwinglplatform.h"
+#include "kwinglutils.h"
+#include "logging_p.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace KWin
+{
+
+static const quint32 s_magic = 0x4b575342; // "KWSB"
+static const quint32 s_version = 1;
+// binaries that haven't been used for this long belong to shaders that don't exist anymore
+static const int s_maxUnusedDays = 30;
+
+GLShaderCache *GLShaderCache::s_cache = nullptr;
+bool GLShaderCache::s_initialized = false;
+
+static bool programBinariesSupported()
+{
+    if (GLPlatform::instance()->isGLES()) {
+        if (!hasGLVersion(3, 0)) {
+            return false;
+        }
+    } else if (!hasGLVersion(4, 1) && !hasGLExtension(QByteArrayLiteral("GL_ARB_get_program_binary"))) {
+        return false;
+    }
+
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+GLShaderCache *GLShaderCache::instance()
+{
+    if (s_initialized) {
+        return s_cache;
+    }
+    s_initialized = true;
+
+    bool valid;
+    const int enabled = qEnvironmentVariableIntValue("KWIN_GL_SHADER_CACHE", &valid);
+    if ((valid && !enabled) || !programBinariesSupported()) {
+        return nullptr;
+    }
+
+    const QString cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (cacheDirectory.isEmpty()) {
+        return nullptr;
+    }
+
+    // binaries are only valid for the driver that has created them
+    const GLPlatform *platform = GLPlatform::instance();
+    QCryptographicHash driverHash(QCryptographicHash::Sha1);
+    driverHash.addData(platform->glVendorString());
+    driverHash.addData(platform->glRendererString());
+    driverHash.addData(platform->glVersionString());
+    driverHash.addData(platform->glShadingLanguageVersionString());
+    const QString driverDirectory = QString::fromLatin1(driverHash.result().toHex().left(16));
+
+    // the directories of other drivers are left alone, they may belong to another gpu or
+    // to another instance of kwin that is running at the same time
+    QDir baseDirectory(cacheDirectory + QLatin1String("/kwin/shaders"));
+    if (!baseDirectory.mkpath(driverDirectory)) {
+        qCWarning(LIBKWINGLUTILS) << "Failed to create the shader cache directory in" << baseDirectory.path();
+        return nullptr;
+    }
+
+    s_cache = new GLShaderCache(baseDirectory.filePath(driverDirectory));
+    s_cache->prune();
+    return s_cache;
+}
+
+void GLShaderCache::prune() const
+{
+    const QDateTime threshold = QDateTime::currentDateTime().addDays(-s_maxUnusedDays);
+    const QFileInfoList entries = QDir(m_directory).entryInfoList(QDir::Files);
+    for (const QFileInfo &entry : entries) {
+        if (entry.lastModified() < threshold) {
+            QFile::remove(entry.filePath());
+        }
+    }
+}
+
+void GLShaderCache::cleanup()
+{
+    delete s_cache;
+    s_cache = nullptr;
+    s_initialized = false;
+}
+
+GLShaderCache::GLShaderCache(const QString &directory)
+    : m_directory(directory)
+{
+}
+
+QByteArray GLShaderCache::key(const QByteArray &vertexSource, const QByteArray &fragmentSource, const QByteArray &bindings) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(vertexSource);
+    hash.addData("\0", 1);
+    hash.addData(fragmentSource);
+    hash.addData("\0", 1);
+    hash.addData(bindings);
+    return hash.result().toHex();
+}
+
+QString GLShaderCache::filePath(const QByteArray &key) const
+{
+    return m_directory + QLatin1Char('/') + QString::fromLatin1(key);
+}
+
+bool GLShaderCache::load(GLuint program, const QByteArray &key) const
+{
+    QFile file(filePath(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic;
+    quint32 version;
+    quint32 format;
+    QByteArray binary;
+    stream >> magic >> version >> format >> binary;
+    if (stream.status() != QDataStream::Ok || magic != s_magic || version != s_version || binary.isEmpty()) {
+        file.remove();
+        return false;
+    }
+
+    glProgramBinary(program, format, binary.constData(), binary.size());
+
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status) {
+        // the driver may reject binaries it has created itself, e.g. after a configuration change
+        qCDebug(LIBKWINGLUTILS) << "Discarding rejected shader binary" << key;
+        file.remove();
+        return false;
+    }
+    // the modification time tells when the binary was last used, see prune()
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return true;
+}
+
+void GLShaderCache::store(GLuint program, const QByteArray &key) const
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    QByteArray binary(length, Qt::Uninitialized);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    binary.truncate(length);
+
+    QSaveFile file(filePath(key));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    stream << s_magic << s_version << quint32(format) << binary;
+    if (!file.commit()) {
+        qCDebug(LIBKWINGLUTILS) << "Failed to write shader binary" << file.fileName();
+    }
+}
+
+} // namespace KWin
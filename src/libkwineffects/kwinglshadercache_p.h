@@ -0,0 +1,57 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+#include <epoxy/gl.h>
+
+namespace KWin
+{
+
+/**
+ * The GLShaderCache class stores linked shader programs on disk with glProgramBinary(),
+ * so the shaders don't have to be compiled again after a restart.
+ *
+ * The cache is keyed on the shader sources and the attribute bindings. Binaries created
+ * by a different driver are kept in a different directory. Only the binaries of the current
+ * driver that haven't been used for a month are removed.
+ */
+class GLShaderCache
+{
+public:
+    /**
+     * Returns the cache, or @c null if program binaries are not supported or the cache is
+     * disabled with KWIN_GL_SHADER_CACHE=0.
+     */
+    static GLShaderCache *instance();
+    static void cleanup();
+
+    QByteArray key(const QByteArray &vertexSource, const QByteArray &fragmentSource, const QByteArray &bindings) const;
+
+    /**
+     * Loads the binary with the given @a key into the @a program. Returns @c true if the
+     * program is linked afterwards.
+     */
+    bool load(GLuint program, const QByteArray &key) const;
+    void store(GLuint program, const QByteArray &key) const;
+
+private:
+    GLShaderCache(const QString &directory);
+
+    QString filePath(const QByteArray &key) const;
+    void prune() const;
+
+    static GLShaderCache *s_cache;
+    static bool s_initialized;
+
+    QString m_directory;
+};
+
+} // namespace KWin
@@ -16,8 +16,10 @@
 #include "kwinglutils_funcs.h"
 
 #include "kwingltexture_p.h"
+#include "logging_p.h"
 
 #include <QImage>
+#include <QMetaEnum>
 #include <QPixmap>
 #include <QVector2D>
 #include <QVector3D>
@@ -26,6 +28,149 @@
 namespace KWin
 {
 
+//****************************************
+// GLMemoryTracker
+//****************************************
+
+// Evictions are requested at most this often while the usage stays above the budget
+static const qint64 s_evictionInterval = 1000;
+
+GLMemoryTracker::GLMemoryTracker()
+{
+    bool ok = false;
+    const int megabytes = qEnvironmentVariableIntValue("KWIN_GL_MEMORY_BUDGET", &ok);
+    m_budget = ok ? qint64(megabytes) * 1024 * 1024 : 0;
+}
+
+GLMemoryTracker *GLMemoryTracker::self()
+{
+    static GLMemoryTracker *tracker = new GLMemoryTracker();
+    return tracker;
+}
+
+void GLMemoryTracker::allocate(Category category, qint64 bytes)
+{
+    m_usage[category] += bytes;
+    ++m_count[category];
+    checkBudget();
+}
+
+void GLMemoryTracker::release(Category category, qint64 bytes)
+{
+    m_usage[category] -= bytes;
+    --m_count[category];
+}
+
+qint64 GLMemoryTracker::usage(Category category) const
+{
+    return m_usage[category];
+}
+
+int GLMemoryTracker::allocationCount(Category category) const
+{
+    return m_count[category];
+}
+
+qint64 GLMemoryTracker::totalUsage() const
+{
+    qint64 total = 0;
+    for (int i = 0; i < CategoryCount; ++i) {
+        total += m_usage[i];
+    }
+    return total;
+}
+
+qint64 GLMemoryTracker::budget() const
+{
+    return m_budget;
+}
+
+void GLMemoryTracker::setBudget(qint64 bytes)
+{
+    m_budget = std::max<qint64>(bytes, 0);
+    m_lastEviction.invalidate();
+    checkBudget();
+}
+
+QVariantMap GLMemoryTracker::memoryUsage() const
+{
+    QVariantMap ret;
+    for (int i = 0; i < CategoryCount; ++i) {
+        const Category category = Category(i);
+        ret.insert(categoryName(category), QVariantMap{
+                                               {QStringLiteral("count"), allocationCount(category)},
+                                               {QStringLiteral("bytes"), usage(category)},
+                                           });
+    }
+    return ret;
+}
+
+void GLMemoryTracker::evict()
+{
+    m_lastEviction.invalidate();
+    processEviction();
+}
+
+QString GLMemoryTracker::categoryName(Category category)
+{
+    return QString::fromLatin1(QMetaEnum::fromType<Category>().valueToKey(category));
+}
+
+qint64 GLMemoryTracker::estimateSize(GLenum internalFormat, const QSize &size, int levels)
+{
+    qint64 bytesPerPixel;
+    switch (internalFormat) {
+    case GL_R8:
+        bytesPerPixel = 1;
+        break;
+    case GL_RG8:
+    case GL_R16:
+        bytesPerPixel = 2;
+        break;
+    case GL_RGBA16:
+    case GL_RGBA16F:
+        bytesPerPixel = 8;
+        break;
+    case GL_RGBA32F:
+        bytesPerPixel = 16;
+        break;
+    default:
+        // Drivers pad 24 bit formats, so everything else is assumed to take 32 bits
+        bytesPerPixel = 4;
+        break;
+    }
+
+    const qint64 baseLevel = qint64(size.width()) * size.height() * bytesPerPixel;
+    // A full mipmap chain adds a third of the base level
+    return levels > 1 ? baseLevel + baseLevel / 3 : baseLevel;
+}
+
+void GLMemoryTracker::checkBudget()
+{
+    const qint64 budget = m_budget;
+    if (budget <= 0 || totalUsage() <= budget) {
+        return;
+    }
+    if (m_evictionScheduled.exchange(true)) {
+        return;
+    }
+    // Textures are allocated while painting, the caches can only be trimmed afterwards
+    QMetaObject::invokeMethod(this, &GLMemoryTracker::processEviction, Qt::QueuedConnection);
+}
+
+void GLMemoryTracker::processEviction()
+{
+    m_evictionScheduled = false;
+    if (m_lastEviction.isValid() && m_lastEviction.elapsed() < s_evictionInterval) {
+        return;
+    }
+    m_lastEviction.start();
+
+    const qint64 before = totalUsage();
+    Q_EMIT evictionRequested();
+    qCDebug(LIBKWINGLUTILS) << "GPU memory eviction released" << (before - totalUsage()) << "bytes, now using" << totalUsage() << "of" << budget();
+}
+
 //****************************************
 // GLTexture
 //****************************************
@@ -178,6 +323,7 @@ GLTexture::GLTexture(const QImage &image, GLenum target)
 
     unbind();
     setFilter(GL_LINEAR);
+    d->updateMemoryUsage();
 }
 
 GLTexture::GLTexture(const QPixmap &pixmap, GLenum target)
@@ -232,6 +378,7 @@ GLTexture::GLTexture(GLenum internalFormat, int width, int height, int levels, b
     }
 
     unbind();
+    d->updateMemoryUsage();
 }
 
 GLTexture::GLTexture(GLenum internalFormat, const QSize &size, int levels, bool needsMutability)
@@ -268,6 +415,7 @@ bool GLTexture::create()
         return true;
     }
     glGenTextures(1, &d->m_texture);
+    d->updateMemoryUsage();
     return d->m_texture != GL_NONE;
 }
 
@@ -294,17 +442,48 @@ GLTexturePrivate::GLTexturePrivate()
     , m_unnormalizeActive(0)
     , m_normalizeActive(0)
     , m_vbo(nullptr)
+    , m_memoryCategory(GLMemoryTracker::Other)
+    , m_memoryUsage(0)
 {
 }
 
 GLTexturePrivate::~GLTexturePrivate()
 {
+    if (m_memoryUsage) {
+        GLMemoryTracker::self()->release(m_memoryCategory, m_memoryUsage);
+    }
     delete m_vbo;
     if (m_texture != 0 && !m_foreign) {
         glDeleteTextures(1, &m_texture);
     }
 }
 
+QImage::Format GLTexturePrivate::uploadFormat(QImage::Format format, GLenum *glFormat, GLenum *type)
+{
+    if (!GLPlatform::instance()->isGLES()) {
+        if (format < sizeof(formatTable) / sizeof(formatTable[0]) && formatTable[format].internalFormat
+            && !(formatTable[format].type == GL_UNSIGNED_SHORT && !s_supportsTexture16Bit)) {
+            *glFormat = formatTable[format].format;
+            *type = formatTable[format].type;
+            return format;
+        } else {
+            *glFormat = GL_BGRA;
+            *type = GL_UNSIGNED_INT_8_8_8_8_REV;
+            return QImage::Format_ARGB32_Premultiplied;
+        }
+    } else {
+        if (s_supportsARGB32) {
+            *glFormat = GL_BGRA_EXT;
+            *type = GL_UNSIGNED_BYTE;
+            return QImage::Format_ARGB32_Premultiplied;
+        } else {
+            *glFormat = GL_RGBA;
+            *type = GL_UNSIGNED_BYTE;
+            return QImage::Format_RGBA8888_Premultiplied;
+        }
+    }
+}
+
 void GLTexturePrivate::initStatic()
 {
     if (!GLPlatform::instance()->isGLES()) {
@@ -375,31 +554,7 @@ void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &s
 
     GLenum glFormat;
     GLenum type;
-    QImage::Format uploadFormat;
-    if (!GLPlatform::instance()->isGLES()) {
-        const QImage::Format index = image.format();
-
-        if (index < sizeof(formatTable) / sizeof(formatTable[0]) && formatTable[index].internalFormat
-            && !(formatTable[index].type == GL_UNSIGNED_SHORT && !d->s_supportsTexture16Bit)) {
-            glFormat = formatTable[index].format;
-            type = formatTable[index].type;
-            uploadFormat = index;
-        } else {
-            glFormat = GL_BGRA;
-            type = GL_UNSIGNED_INT_8_8_8_8_REV;
-            uploadFormat = QImage::Format_ARGB32_Premultiplied;
-        }
-    } else {
-        if (d->s_supportsARGB32) {
-            glFormat = GL_BGRA_EXT;
-            type = GL_UNSIGNED_BYTE;
-            uploadFormat = QImage::Format_ARGB32_Premultiplied;
-        } else {
-            glFormat = GL_RGBA;
-            type = GL_UNSIGNED_BYTE;
-            uploadFormat = QImage::Format_RGBA8888_Premultiplied;
-        }
-    }
+    const QImage::Format uploadFormat = GLTexturePrivate::uploadFormat(image.format(), &glFormat, &type);
     bool useUnpack = d->s_supportsUnpack && image.format() == uploadFormat && !src.isNull();
 
     QImage im;
@@ -440,6 +595,49 @@ void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &s
     }
 }
 
+bool GLTexture::updateFromPixelBuffer(QImage::Format format, int bytesPerLine, const QPoint &offset, const QRect &src)
+{
+    if (isNull() || !supportsPixelBufferUpload(format)) {
+        return false;
+    }
+
+    Q_D(GLTexture);
+    Q_ASSERT(!d->m_foreign);
+
+    GLenum glFormat;
+    GLenum type;
+    GLTexturePrivate::uploadFormat(format, &glFormat, &type);
+
+    const int bytesPerPixel = QImage::toPixelFormat(format).bitsPerPixel() / 8;
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, bytesPerLine / bytesPerPixel);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, src.x());
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, src.y());
+
+    bind();
+    // The data pointer is an offset into the bound pixel buffer.
+    glTexSubImage2D(d->m_target, 0, offset.x(), offset.y(), src.width(), src.height(), glFormat, type, nullptr);
+    unbind();
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+
+    return true;
+}
+
+bool GLTexture::supportsPixelBufferUpload(QImage::Format format)
+{
+    if (!GLTexturePrivate::s_supportsUnpack) {
+        return false;
+    }
+    if (GLPlatform::instance()->isGLES() && !hasGLVersion(3, 0)) {
+        return false;
+    }
+    GLenum glFormat;
+    GLenum type;
+    return GLTexturePrivate::uploadFormat(format, &glFormat, &type) == format;
+}
+
 void GLTexture::discard()
 {
     d_ptr = new GLTexturePrivate();
@@ -502,6 +700,25 @@ void GLTexture::generateMipmaps()
     }
 }
 
+void GLTexture::setMemoryCategory(GLMemoryTracker::Category category)
+{
+    Q_D(GLTexture);
+    if (d->m_memoryCategory == category) {
+        return;
+    }
+    if (d->m_memoryUsage) {
+        GLMemoryTracker::self()->release(d->m_memoryCategory, d->m_memoryUsage);
+        GLMemoryTracker::self()->allocate(category, d->m_memoryUsage);
+    }
+    d->m_memoryCategory = category;
+}
+
+GLMemoryTracker::Category GLTexture::memoryCategory() const
+{
+    Q_D(const GLTexture);
+    return d->m_memoryCategory;
+}
+
 void GLTexture::unbind()
 {
     Q_D(GLTexture);
@@ -647,6 +864,23 @@ void GLTexture::setDirty()
     d->m_markedDirty = true;
 }
 
+void GLTexturePrivate::updateMemoryUsage()
+{
+    GLMemoryTracker *tracker = GLMemoryTracker::self();
+    if (m_memoryUsage) {
+        tracker->release(m_memoryCategory, m_memoryUsage);
+    }
+    // Foreign textures are accounted by whoever owns their storage
+    if (m_texture && !m_foreign) {
+        m_memoryUsage = GLMemoryTracker::estimateSize(m_internalFormat, m_size, m_mipLevels);
+    } else {
+        m_memoryUsage = 0;
+    }
+    if (m_memoryUsage) {
+        tracker->allocate(m_memoryCategory, m_memoryUsage);
+    }
+}
+
 void GLTexturePrivate::updateMatrix()
 {
     m_matrix[NormalizedCoordinates].setToIdentity();
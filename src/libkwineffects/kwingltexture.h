@@ -13,12 +13,16 @@
 
 #include <kwinglutils_export.h>
 
+#include <QElapsedTimer>
 #include <QExplicitlySharedDataPointer>
 #include <QMatrix4x4>
+#include <QObject>
 #include <QRegion>
 #include <QSharedPointer>
 #include <QSize>
+#include <QVariantMap>
 
+#include <atomic>
 #include <epoxy/gl.h>
 
 class QImage;
@@ -38,6 +42,91 @@ enum TextureCoordinateType {
     UnnormalizedCoordinates,
 };
 
+/**
+ * The GLMemoryTracker keeps track of the GPU memory held by the compositor. Every GLTexture
+ * reports an estimate of its storage under the category it has been tagged with, buffers
+ * that are not backed by a GLTexture can be reported with allocate() and release().
+ *
+ * An optional soft budget can be set with the KWIN_GL_MEMORY_BUDGET environment variable,
+ * in MiB. If the usage exceeds it, evictionRequested() is emitted and caches that hold
+ * textures which can be recreated on demand are expected to release them.
+ *
+ * The usage is available on DBus as org.kde.kwin.GpuMemory at /GpuMemory and in the
+ * debug console.
+ *
+ * @since 5.26
+ */
+class KWINGLUTILS_EXPORT GLMemoryTracker : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.kwin.GpuMemory")
+
+public:
+    enum Category {
+        Other,
+        Surface,
+        Decoration,
+        Shadow,
+        Blur,
+        Thumbnail,
+        Mipmap,
+        OffscreenView,
+        ShadowBuffer,
+        Swapchain,
+    };
+    Q_ENUM(Category)
+    static constexpr int CategoryCount = Swapchain + 1;
+
+    static GLMemoryTracker *self();
+
+    void allocate(Category category, qint64 bytes);
+    void release(Category category, qint64 bytes);
+
+    qint64 usage(Category category) const;
+    int allocationCount(Category category) const;
+    qint64 totalUsage() const;
+
+    /**
+     * Returns the soft budget in bytes, or @c 0 if there is none.
+     */
+    Q_SCRIPTABLE qint64 budget() const;
+    Q_SCRIPTABLE void setBudget(qint64 bytes);
+
+    /**
+     * Returns the number of allocations and the bytes held in every category.
+     */
+    Q_SCRIPTABLE QVariantMap memoryUsage() const;
+    /**
+     * Asks the caches to release everything they can recreate, regardless of the budget.
+     */
+    Q_SCRIPTABLE void evict();
+
+    static QString categoryName(Category category);
+    /**
+     * Returns the estimated size of a texture with the given @p internalFormat, @p size and
+     * number of mipmap @p levels.
+     */
+    static qint64 estimateSize(GLenum internalFormat, const QSize &size, int levels = 1);
+
+Q_SIGNALS:
+    /**
+     * Emitted when the memory usage has exceeded the budget. The signal is always delivered
+     * from the event loop, never while painting.
+     */
+    void evictionRequested();
+
+private:
+    GLMemoryTracker();
+    void checkBudget();
+    void processEviction();
+
+    std::atomic<qint64> m_usage[CategoryCount] = {};
+    std::atomic<int> m_count[CategoryCount] = {};
+    std::atomic<qint64> m_budget;
+    std::atomic<bool> m_evictionScheduled{false};
+    QElapsedTimer m_lastEviction;
+};
+
 class KWINGLUTILS_EXPORT GLTexture
 {
 public:
@@ -100,6 +189,23 @@ public:
     QMatrix4x4 matrix(TextureCoordinateType type) const;
 
     void update(const QImage &image, const QPoint &offset = QPoint(0, 0), const QRect &src = QRect());
+
+    /**
+     * Updates the texture at @a offset with the @a src rect of the image stored in the buffer
+     * that is currently bound to GL_PIXEL_UNPACK_BUFFER. The image must have the given @a format
+     * and @a bytesPerLine. Returns @c false if the pixels can't be uploaded without converting
+     * them, see supportsPixelBufferUpload().
+     *
+     * @since 5.26
+     */
+    bool updateFromPixelBuffer(QImage::Format format, int bytesPerLine, const QPoint &offset, const QRect &src);
+
+    /**
+     * Returns @c true if images with the given @a format can be uploaded from pixel buffers.
+     *
+     * @since 5.26
+     */
+    static bool supportsPixelBufferUpload(QImage::Format format);
     virtual void discard();
     void bind();
     void unbind();
@@ -127,6 +233,15 @@ public:
 
     void generateMipmaps();
 
+    /**
+     * Specifies under which category the memory of this texture is reported to the
+     * GLMemoryTracker. The default category is GLMemoryTracker::Other.
+     *
+     * @since 5.26
+     */
+    void setMemoryCategory(GLMemoryTracker::Category category);
+    GLMemoryTracker::Category memoryCategory() const;
+
     static bool framebufferObjectSupported();
 
     /**
@@ -37,6 +37,7 @@ public:
     virtual void onDamage();
 
     void updateMatrix();
+    void updateMemoryUsage();
 
     GLuint m_texture;
     GLenum m_target;
@@ -59,8 +60,11 @@ public:
     int m_normalizeActive; // 0 - no, otherwise refcount
     GLVertexBuffer *m_vbo;
     QSize m_cachedSize;
+    GLMemoryTracker::Category m_memoryCategory;
+    qint64 m_memoryUsage;
 
     static void initStatic();
+    static QImage::Format uploadFormat(QImage::Format format, GLenum *glFormat, GLenum *type);
 
     static bool s_supportsFramebufferObjects;
     static bool s_supportsARGB32;
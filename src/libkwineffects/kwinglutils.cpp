@@ -15,6 +15,7 @@
 
 #include "kwineffects.h"
 #include "kwinglplatform.h"
+#include "kwinglshadercache_p.h"
 #include "logging_p.h"
 
 #include <QFile>
@@ -153,14 +154,17 @@ void initGL(const std::function<resolveFuncPtr(const char *)> &resolveFunction)
 
     GLTexturePrivate::initStatic();
     GLFramebuffer::initStatic();
+    GLRenderTimeQuery::initStatic();
     GLVertexBuffer::initStatic();
 }
 
 void cleanupGL()
 {
     ShaderManager::cleanup();
+    GLShaderCache::cleanup();
     GLTexturePrivate::cleanup();
     GLFramebuffer::cleanup();
+    GLRenderTimeQuery::cleanup();
     GLVertexBuffer::cleanup();
     GLPlatform::cleanup();
 
@@ -273,6 +277,35 @@ bool GLShader::loadFromFiles(const QString &vertexFile, const QString &fragmentF
 
 bool GLShader::link()
 {
+    mCachedUniforms = 0;
+
+    GLShaderCache *cache = GLShaderCache::instance();
+    QByteArray cacheKey;
+    if (cache) {
+        cacheKey = cache->key(mVertexSource, mFragmentSource, mBindings);
+        if (cache->load(mProgram, cacheKey)) {
+            mVertexSource.clear();
+            mFragmentSource.clear();
+            mValid = true;
+            return true;
+        }
+    }
+
+    if (!mVertexSource.isEmpty() && !compile(mProgram, GL_VERTEX_SHADER, mVertexSource)) {
+        mValid = false;
+        return false;
+    }
+    if (!mFragmentSource.isEmpty() && !compile(mProgram, GL_FRAGMENT_SHADER, mFragmentSource)) {
+        mValid = false;
+        return false;
+    }
+    mVertexSource.clear();
+    mFragmentSource.clear();
+
+    if (cache) {
+        glProgramParameteri(mProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
     // Be optimistic
     mValid = true;
 
@@ -298,6 +331,10 @@ bool GLShader::link()
         qCDebug(LIBKWINGLUTILS) << "Shader link log:" << log;
     }
 
+    if (mValid && cache) {
+        cache->store(mProgram, cacheKey);
+    }
+
     return mValid;
 }
 
@@ -368,23 +405,9 @@ bool GLShader::load(const QByteArray &vertexSource, const QByteArray &fragmentSo
 
     mValid = false;
 
-    // Compile the vertex shader
-    if (!vertexSource.isEmpty()) {
-        bool success = compile(mProgram, GL_VERTEX_SHADER, vertexSource);
-
-        if (!success) {
-            return false;
-        }
-    }
-
-    // Compile the fragment shader
-    if (!fragmentSource.isEmpty()) {
-        bool success = compile(mProgram, GL_FRAGMENT_SHADER, fragmentSource);
-
-        if (!success) {
-            return false;
-        }
-    }
+    // The shaders are compiled in link(), unless a cached binary of the program exists
+    mVertexSource = vertexSource;
+    mFragmentSource = fragmentSource;
 
     if (mExplicitLinking) {
         return true;
@@ -397,12 +420,14 @@ bool GLShader::load(const QByteArray &vertexSource, const QByteArray &fragmentSo
 void GLShader::bindAttributeLocation(const char *name, int index)
 {
     glBindAttribLocation(mProgram, index, name);
+    mBindings += QByteArray("attribute ") + name + ' ' + QByteArray::number(index) + '\n';
 }
 
 void GLShader::bindFragDataLocation(const char *name, int index)
 {
     if (!GLPlatform::instance()->isGLES() && (hasGLVersion(3, 0) || hasGLExtension(QByteArrayLiteral("GL_EXT_gpu_shader4")))) {
         glBindFragDataLocation(mProgram, index, name);
+        mBindings += QByteArray("fragdata ") + name + ' ' + QByteArray::number(index) + '\n';
     }
 }
 
@@ -449,46 +474,112 @@ int GLShader::uniformLocation(const char *name)
     return location;
 }
 
+bool GLShader::isUniformCached(int uniform) const
+{
+    return mCachedUniforms & (1u << uniform);
+}
+
+void GLShader::setUniformCached(int uniform)
+{
+    mCachedUniforms |= (1u << uniform);
+}
+
+void GLShader::invalidateUniformCache(int location)
+{
+    if (!mCachedUniforms || !mLocationsResolved || location < 0) {
+        return;
+    }
+    // A uniform backing one of the enum based setters was set by name or location directly
+    const auto invalidate = [this, location](const int *locations, int count, int first) {
+        for (int i = 0; i < count; ++i) {
+            if (locations[i] == location) {
+                mCachedUniforms &= ~(1u << (first + i));
+            }
+        }
+    };
+    invalidate(mMatrixLocation, MatrixCount, CachedMatrix);
+    invalidate(mVec2Location, Vec2UniformCount, CachedVec2);
+    invalidate(mVec4Location, Vec4UniformCount, CachedVec4);
+    invalidate(mFloatLocation, FloatUniformCount, CachedFloat);
+    invalidate(mIntLocation, IntUniformCount, CachedInt);
+    invalidate(mColorLocation, ColorUniformCount, CachedColor);
+}
+
 bool GLShader::setUniform(GLShader::MatrixUniform uniform, const QMatrix4x4 &matrix)
 {
     resolveLocations();
-    return setUniform(mMatrixLocation[uniform], matrix);
+    if (isUniformCached(CachedMatrix + uniform) && mMatrixValue[uniform] == matrix) {
+        return mMatrixLocation[uniform] >= 0;
+    }
+    const bool ret = setUniform(mMatrixLocation[uniform], matrix);
+    mMatrixValue[uniform] = matrix;
+    setUniformCached(CachedMatrix + uniform);
+    return ret;
 }
 
 bool GLShader::setUniform(GLShader::Vec2Uniform uniform, const QVector2D &value)
 {
     resolveLocations();
-    return setUniform(mVec2Location[uniform], value);
+    if (isUniformCached(CachedVec2 + uniform) && mVec2Value[uniform] == value) {
+        return mVec2Location[uniform] >= 0;
+    }
+    const bool ret = setUniform(mVec2Location[uniform], value);
+    mVec2Value[uniform] = value;
+    setUniformCached(CachedVec2 + uniform);
+    return ret;
 }
 
 bool GLShader::setUniform(GLShader::Vec4Uniform uniform, const QVector4D &value)
 {
     resolveLocations();
-    return setUniform(mVec4Location[uniform], value);
+    if (isUniformCached(CachedVec4 + uniform) && mVec4Value[uniform] == value) {
+        return mVec4Location[uniform] >= 0;
+    }
+    const bool ret = setUniform(mVec4Location[uniform], value);
+    mVec4Value[uniform] = value;
+    setUniformCached(CachedVec4 + uniform);
+    return ret;
 }
 
 bool GLShader::setUniform(GLShader::FloatUniform uniform, float value)
 {
     resolveLocations();
-    return setUniform(mFloatLocation[uniform], value);
+    if (isUniformCached(CachedFloat + uniform) && mFloatValue[uniform] == value) {
+        return mFloatLocation[uniform] >= 0;
+    }
+    const bool ret = setUniform(mFloatLocation[uniform], value);
+    mFloatValue[uniform] = value;
+    setUniformCached(CachedFloat + uniform);
+    return ret;
 }
 
 bool GLShader::setUniform(GLShader::IntUniform uniform, int value)
 {
     resolveLocations();
-    return setUniform(mIntLocation[uniform], value);
+    if (isUniformCached(CachedInt + uniform) && mIntValue[uniform] == value) {
+        return mIntLocation[uniform] >= 0;
+    }
+    const bool ret = setUniform(mIntLocation[uniform], value);
+    mIntValue[uniform] = value;
+    setUniformCached(CachedInt + uniform);
+    return ret;
 }
 
 bool GLShader::setUniform(GLShader::ColorUniform uniform, const QVector4D &value)
 {
     resolveLocations();
-    return setUniform(mColorLocation[uniform], value);
+    if (isUniformCached(CachedColor + uniform) && mColorValue[uniform] == value) {
+        return mColorLocation[uniform] >= 0;
+    }
+    const bool ret = setUniform(mColorLocation[uniform], value);
+    mColorValue[uniform] = value;
+    setUniformCached(CachedColor + uniform);
+    return ret;
 }
 
 bool GLShader::setUniform(GLShader::ColorUniform uniform, const QColor &value)
 {
-    resolveLocations();
-    return setUniform(mColorLocation[uniform], value);
+    return setUniform(uniform, QVector4D(value.redF(), value.greenF(), value.blueF(), value.alphaF()));
 }
 
 bool GLShader::setUniform(const char *name, float value)
@@ -535,6 +626,7 @@ bool GLShader::setUniform(const char *name, const QColor &color)
 
 bool GLShader::setUniform(int location, float value)
 {
+    invalidateUniformCache(location);
     if (location >= 0) {
         glUniform1f(location, value);
     }
@@ -543,6 +635,7 @@ bool GLShader::setUniform(int location, float value)
 
 bool GLShader::setUniform(int location, int value)
 {
+    invalidateUniformCache(location);
     if (location >= 0) {
         glUniform1i(location, value);
     }
@@ -551,6 +644,7 @@ bool GLShader::setUniform(int location, int value)
 
 bool GLShader::setUniform(int location, const QVector2D &value)
 {
+    invalidateUniformCache(location);
     if (location >= 0) {
         glUniform2fv(location, 1, (const GLfloat *)&value);
     }
@@ -559,6 +653,7 @@ bool GLShader::setUniform(int location, const QVector2D &value)
 
 bool GLShader::setUniform(int location, const QVector3D &value)
 {
+    invalidateUniformCache(location);
     if (location >= 0) {
         glUniform3fv(location, 1, (const GLfloat *)&value);
     }
@@ -567,6 +662,7 @@ bool GLShader::setUniform(int location, const QVector3D &value)
 
 bool GLShader::setUniform(int location, const QVector4D &value)
 {
+    invalidateUniformCache(location);
     if (location >= 0) {
         glUniform4fv(location, 1, (const GLfloat *)&value);
     }
@@ -575,6 +671,7 @@ bool GLShader::setUniform(int location, const QVector4D &value)
 
 bool GLShader::setUniform(int location, const QMatrix4x4 &value)
 {
+    invalidateUniformCache(location);
     if (location >= 0) {
         glUniformMatrix4fv(location, 1, GL_FALSE, value.constData());
     }
@@ -583,6 +680,7 @@ bool GLShader::setUniform(int location, const QMatrix4x4 &value)
 
 bool GLShader::setUniform(int location, const QColor &color)
 {
+    invalidateUniformCache(location);
     if (location >= 0) {
         glUniform4f(location, color.redF(), color.greenF(), color.blueF(), color.alphaF());
     }
@@ -1166,6 +1264,98 @@ void GLFramebuffer::blitFromFramebuffer(const QRect &source, const QRect &destin
     GLFramebuffer::popFramebuffer();
 }
 
+/***  GLRenderTimeQuery  ***/
+bool GLRenderTimeQuery::s_supported = false;
+
+void GLRenderTimeQuery::initStatic()
+{
+    if (GLPlatform::instance()->isGLES()) {
+        s_supported = hasGLExtension(QByteArrayLiteral("GL_EXT_disjoint_timer_query"));
+    } else {
+        s_supported = hasGLVersion(3, 3) || hasGLExtension(QByteArrayLiteral("GL_ARB_timer_query"));
+    }
+}
+
+void GLRenderTimeQuery::cleanup()
+{
+    s_supported = false;
+}
+
+bool GLRenderTimeQuery::supported()
+{
+    return s_supported;
+}
+
+GLRenderTimeQuery::GLRenderTimeQuery()
+{
+    if (s_supported) {
+        glGenQueries(2, m_gpuProbes);
+    }
+}
+
+GLRenderTimeQuery::~GLRenderTimeQuery()
+{
+    if (m_gpuProbes[0]) {
+        glDeleteQueries(2, m_gpuProbes);
+    }
+}
+
+void GLRenderTimeQuery::begin()
+{
+    if (m_gpuProbes[0]) {
+        if (GLPlatform::instance()->isGLES()) {
+            // Reset the disjoint flag, any previous measurement is invalid anyway.
+            GLint disjoint;
+            glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        }
+        glQueryCounter(m_gpuProbes[0], GL_TIMESTAMP);
+    }
+    m_cpuStart = std::chrono::steady_clock::now();
+}
+
+void GLRenderTimeQuery::end()
+{
+    m_hasResult = true;
+    if (m_gpuProbes[1]) {
+        glQueryCounter(m_gpuProbes[1], GL_TIMESTAMP);
+    }
+    m_cpuEnd = std::chrono::steady_clock::now();
+}
+
+std::chrono::nanoseconds GLRenderTimeQuery::result()
+{
+    if (!m_hasResult) {
+        return std::chrono::nanoseconds::zero();
+    }
+    m_hasResult = false;
+
+    const std::chrono::nanoseconds cpuTime = m_cpuEnd - m_cpuStart;
+    if (!m_gpuProbes[0]) {
+        return cpuTime;
+    }
+
+    GLint available = 0;
+    glGetQueryObjectiv(m_gpuProbes[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return cpuTime;
+    }
+    if (GLPlatform::instance()->isGLES()) {
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        if (disjoint) {
+            return cpuTime;
+        }
+    }
+
+    GLuint64 gpuStart = 0;
+    GLuint64 gpuEnd = 0;
+    glGetQueryObjectui64v(m_gpuProbes[0], GL_QUERY_RESULT, &gpuStart);
+    glGetQueryObjectui64v(m_gpuProbes[1], GL_QUERY_RESULT, &gpuEnd);
+    const std::chrono::nanoseconds gpuTime(gpuEnd - gpuStart);
+
+    return std::max(cpuTime, gpuTime);
+}
+
 // ------------------------------------------------------------------
 
 static const uint16_t indices[] = {
@@ -19,6 +19,10 @@
 // Qt
 #include <QSize>
 #include <QStack>
+#include <QVector2D>
+#include <QVector4D>
+
+#include <chrono>
 
 /** @addtogroup kwineffects */
 /** @{ */
@@ -157,7 +161,25 @@ protected:
     void resolveLocations();
 
 private:
+    enum CachedUniform {
+        CachedMatrix = 0,
+        CachedVec2 = CachedMatrix + MatrixCount,
+        CachedVec4 = CachedVec2 + Vec2UniformCount,
+        CachedFloat = CachedVec4 + Vec4UniformCount,
+        CachedInt = CachedFloat + FloatUniformCount,
+        CachedColor = CachedInt + IntUniformCount,
+        CachedUniformCount = CachedColor + ColorUniformCount
+    };
+    static_assert(CachedUniformCount <= 32, "mCachedUniforms must hold a bit per uniform");
+    bool isUniformCached(int uniform) const;
+    void setUniformCached(int uniform);
+    void invalidateUniformCache(int location);
+
     unsigned int mProgram;
+    // kept until link() so the program can be restored from the shader cache instead
+    QByteArray mVertexSource;
+    QByteArray mFragmentSource;
+    QByteArray mBindings;
     bool mValid : 1;
     bool mLocationsResolved : 1;
     bool mExplicitLinking : 1;
@@ -167,6 +189,14 @@ private:
     int mFloatLocation[FloatUniformCount];
     int mIntLocation[IntUniformCount];
     int mColorLocation[ColorUniformCount];
+    // Last values uploaded through the enum based setters, to skip redundant glUniform calls
+    quint32 mCachedUniforms = 0;
+    QMatrix4x4 mMatrixValue[MatrixCount];
+    QVector2D mVec2Value[Vec2UniformCount];
+    QVector4D mVec4Value[Vec4UniformCount];
+    float mFloatValue[FloatUniformCount];
+    int mIntValue[IntUniformCount];
+    QVector4D mColorValue[ColorUniformCount];
 
     friend class ShaderManager;
 };
@@ -488,6 +518,58 @@ private:
     bool mForeign = false;
 };
 
+/**
+ * @short OpenGL render time query
+ *
+ * The GLRenderTimeQuery class measures how long it takes to render a frame. The CPU time
+ * is always measured, the GPU time only if GL_ARB_timer_query or GL_EXT_disjoint_timer_query
+ * is available. The result is the longer of the CPU time between begin() and end() and the
+ * GPU time between the timestamps recorded by them.
+ *
+ * The OpenGL context that was used for begin() and end() must be current when calling
+ * result() and when destroying the query.
+ */
+class KWINGLUTILS_EXPORT GLRenderTimeQuery
+{
+public:
+    GLRenderTimeQuery();
+    ~GLRenderTimeQuery();
+
+    /**
+     * Marks the start of rendering a frame.
+     */
+    void begin();
+
+    /**
+     * Marks the end of rendering a frame.
+     */
+    void end();
+
+    /**
+     * Returns how long it took to render the last measured frame, or zero if no frame has
+     * been measured. If the GPU time is not available, e.g. because the GPU has not finished
+     * yet or the timer was disjoint, only the CPU time is returned. Calling this function
+     * consumes the result.
+     */
+    std::chrono::nanoseconds result();
+
+    /**
+     * Returns @c true if GPU timer queries are supported; otherwise returns @c false.
+     */
+    static bool supported();
+    static void initStatic();
+
+private:
+    friend void KWin::cleanupGL();
+    static void cleanup();
+    static bool s_supported;
+
+    GLuint m_gpuProbes[2] = {0, 0};
+    std::chrono::steady_clock::time_point m_cpuStart;
+    std::chrono::steady_clock::time_point m_cpuEnd;
+    bool m_hasResult = false;
+};
+
 enum VertexAttributeType {
     VA_Position = 0,
     VA_TexCoord = 1,
@@ -58,23 +58,66 @@ private:
     QPointer<QWindow> m_renderWindow;
 };
 
+/**
+ * All views make their contexts current on the same offscreen surface, there is no
+ * need for every view to have a surface of its own.
+ */
+static QSharedPointer<QOffscreenSurface> sharedOffscreenSurface(const QSurfaceFormat &format)
+{
+    static QWeakPointer<QOffscreenSurface> s_surface;
+
+    QSharedPointer<QOffscreenSurface> surface = s_surface.toStrongRef();
+    if (!surface || surface->format() != format) {
+        surface.reset(new QOffscreenSurface);
+        surface->setFormat(format);
+        surface->create();
+        s_surface = surface;
+    }
+    return surface;
+}
+
+/**
+ * Reports the memory of the views' framebuffers to the GLMemoryTracker, they have a color
+ * and a combined depth and stencil attachment.
+ */
+static qint64 framebufferMemoryUsage(const QOpenGLFramebufferObject *fbo)
+{
+    return 2 * GLMemoryTracker::estimateSize(GL_RGBA8, fbo->size());
+}
+
+struct TrackedFramebufferDeleter
+{
+    static void cleanup(QOpenGLFramebufferObject *fbo)
+    {
+        if (fbo) {
+            GLMemoryTracker::self()->release(GLMemoryTracker::OffscreenView, framebufferMemoryUsage(fbo));
+            delete fbo;
+        }
+    }
+};
+
 class Q_DECL_HIDDEN OffscreenQuickView::Private
 {
 public:
     QQuickWindow *m_view;
     QQuickRenderControl *m_renderControl;
-    QScopedPointer<QOffscreenSurface> m_offscreenSurface;
+    QSharedPointer<QOffscreenSurface> m_offscreenSurface;
     QScopedPointer<QOpenGLContext> m_glcontext;
-    QScopedPointer<QOpenGLFramebufferObject> m_fbo;
+    QScopedPointer<QOpenGLFramebufferObject, TrackedFramebufferDeleter> m_fbo;
 
     QTimer *m_repaintTimer;
     QImage m_image;
     QScopedPointer<GLTexture> m_textureExport;
+    // whether m_image has changed since it was last uploaded to m_textureExport
+    bool m_imageDirty = false;
     // if we should capture a QImage after rendering into our BO.
     // Used for either software QtQuick rendering and nonGL kwin rendering
     bool m_useBlit = false;
     bool m_visible = true;
+    bool m_opaque = false;
     bool m_automaticRepaint = true;
+    // whether an update was skipped because all outputs are off
+    bool m_updateDeferred = false;
 
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
     QList<QTouchEvent::TouchPoint> touchPoints;
@@ -154,9 +197,7 @@ OffscreenQuickView::OffscreenQuickView(QObject *parent, QWindow *renderWindow, E
         d->m_glcontext->create();
 
         // and the offscreen surface
-        d->m_offscreenSurface.reset(new QOffscreenSurface);
-        d->m_offscreenSurface->setFormat(d->m_glcontext->format());
-        d->m_offscreenSurface->create();
+        d->m_offscreenSurface = sharedOffscreenSurface(d->m_glcontext->format());
 
         d->m_glcontext->makeCurrent(d->m_offscreenSurface.data());
         d->m_renderControl->initialize(d->m_glcontext.data());
@@ -184,6 +225,16 @@ OffscreenQuickView::OffscreenQuickView(QObject *parent, QWindow *renderWindow, E
     connect(d->m_repaintTimer, &QTimer::timeout, this, &OffscreenQuickView::update);
     connect(d->m_renderControl, &QQuickRenderControl::renderRequested, this, &OffscreenQuickView::handleRenderRequested);
     connect(d->m_renderControl, &QQuickRenderControl::sceneChanged, this, &OffscreenQuickView::handleSceneChanged);
+    if (effects) {
+        connect(effects, &EffectsHandler::sleepingChanged, this, [this](bool sleeping) {
+            if (sleeping) {
+                d->m_repaintTimer->stop();
+            } else if (d->m_updateDeferred) {
+                d->m_updateDeferred = false;
+                update();
+            }
+        });
+    }
 
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
     d->touchDevice = new QTouchDevice{};
@@ -247,6 +298,11 @@ void OffscreenQuickView::update()
     if (!d->m_visible) {
         return;
     }
+    if (effects && effects->isSleeping()) {
+        // nobody is going to see it, render the latest state once an output is on again
+        d->m_updateDeferred = true;
+        return;
+    }
     if (d->m_view->size().isEmpty()) {
         return;
     }
@@ -263,6 +319,7 @@ void OffscreenQuickView::update()
         if (d->m_fbo.isNull() || d->m_fbo->size() != nativeSize) {
             d->m_textureExport.reset(nullptr);
             d->m_fbo.reset(new QOpenGLFramebufferObject(nativeSize, QOpenGLFramebufferObject::CombinedDepthStencil));
+            GLMemoryTracker::self()->allocate(GLMemoryTracker::OffscreenView, framebufferMemoryUsage(d->m_fbo.data()));
             if (!d->m_fbo->isValid()) {
                 d->m_fbo.reset();
                 d->m_glcontext->doneCurrent();
@@ -290,6 +347,7 @@ void OffscreenQuickView::update()
 
     if (d->m_useBlit) {
         d->m_image = d->m_renderControl->grab();
+        d->m_imageDirty = true;
     }
 
     if (usingGl) {
@@ -421,6 +479,16 @@ qreal OffscreenQuickView::opacity() const
     return d->m_view->opacity();
 }
 
+void OffscreenQuickView::setOpaque(bool opaque)
+{
+    d->m_opaque = opaque;
+}
+
+bool OffscreenQuickView::isOpaque() const
+{
+    return d->m_opaque;
+}
+
 QQuickItem *OffscreenQuickView::contentItem() const
 {
     return d->m_view->contentItem();
@@ -469,7 +537,16 @@ GLTexture *OffscreenQuickView::bufferAsTexture()
         if (d->m_image.isNull()) {
             return nullptr;
         }
-        d->m_textureExport.reset(new GLTexture(d->m_image));
+        // Only upload the image after it has been re-rendered, not every time the view is painted
+        if (d->m_imageDirty || !d->m_textureExport) {
+            if (d->m_textureExport && d->m_textureExport->size() == d->m_image.size()) {
+                d->m_textureExport->update(d->m_image);
+            } else {
+                d->m_textureExport.reset(new GLTexture(d->m_image));
+                d->m_textureExport->setMemoryCategory(GLMemoryTracker::OffscreenView);
+            }
+            d->m_imageDirty = false;
+        }
     } else {
         if (!d->m_fbo) {
             return nullptr;
@@ -500,9 +577,23 @@ void OffscreenQuickView::setGeometry(const QRect &rect)
 
 void OffscreenQuickView::Private::releaseResources()
 {
+    if (m_visible) {
+        // shown again before the deferred release ran
+        return;
+    }
+
+    // Hidden views don't keep their buffers, they are rendered again once shown. An
+    // uploaded image texture belongs to the compositor's context and is kept for reuse.
+    m_image = QImage();
+    m_imageDirty = false;
     if (m_glcontext) {
         m_glcontext->makeCurrent(m_offscreenSurface.data());
         m_view->releaseResources();
+        if (!m_useBlit) {
+            // only wraps the texture of the fbo
+            m_textureExport.reset();
+        }
+        m_fbo.reset();
         m_glcontext->doneCurrent();
     } else {
         m_view->releaseResources();
@@ -98,6 +98,16 @@ public:
     void setOpacity(qreal opacity);
     qreal opacity() const;
 
+    /**
+     * Marks the view as opaque. An opaque view replaces the contents underneath it
+     * rather than being blended with them, so the scene must cover the whole view.
+     * The default is false.
+     *
+     * @since 5.26
+     */
+    void setOpaque(bool opaque);
+    bool isOpaque() const;
+
     /**
      * Render the current scene graph into the FBO.
      * This is typically done automatically when the scene changes
@@ -59,6 +59,8 @@ QuickSceneView::QuickSceneView(QuickSceneEffect *effect, EffectScreen *screen)
     , m_effect(effect)
     , m_screen(screen)
 {
+    // The effect paints the view instead of the rest of the scene, see QuickSceneEffect::paintScreen()
+    setOpaque(true);
     setGeometry(screen->geometry());
     connect(screen, &EffectScreen::geometryChanged, this, [this, screen]() {
         setGeometry(screen->geometry());
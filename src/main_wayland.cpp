@@ -14,6 +14,7 @@
 #include "effects.h"
 #include "inputmethod.h"
 #include "platform.h"
+#include "startuptracer.h"
 #include "tabletmodemanager.h"
 #include "utils/realtime.h"
 #include "wayland/display.h"
@@ -136,19 +137,29 @@ void ApplicationWayland::performStartup()
     // first load options - done internally by a different thread
     createOptions();
 
-    if (!platform()->initialize()) {
-        std::exit(1);
+    {
+        StartupPhase phase(QByteArrayLiteral("Platform initialization"));
+        if (!platform()->initialize()) {
+            std::exit(1);
+        }
     }
 
     waylandServer()->initPlatform();
     createColorManager();
 
-    createInput();
-    createInputMethod();
-    TabletModeManager::create(this);
-    createPlugins();
+    {
+        StartupPhase phase(QByteArrayLiteral("Input creation"));
+        createInput();
+        createInputMethod();
+        TabletModeManager::create(this);
+    }
+    {
+        StartupPhase phase(QByteArrayLiteral("Plugin loading"));
+        createPlugins();
+    }
 
     createScreens();
+    StartupTracer::self()->begin(QByteArrayLiteral("Scene creation"));
     WaylandCompositor::create();
 
     connect(Compositor::self(), &Compositor::sceneCreated, platform(), &Platform::sceneInitialized);
@@ -158,9 +169,13 @@ void ApplicationWayland::performStartup()
 void ApplicationWayland::continueStartupWithScene()
 {
     disconnect(Compositor::self(), &Compositor::sceneCreated, this, &ApplicationWayland::continueStartupWithScene);
+    StartupTracer::self()->end(QByteArrayLiteral("Scene creation"));
 
     // Note that we start accepting client connections after creating the Workspace.
-    createWorkspace();
+    {
+        StartupPhase phase(QByteArrayLiteral("Workspace creation"));
+        createWorkspace();
+    }
 
     if (!waylandServer()->start()) {
         qFatal("Failed to initialze the Wayland server, exiting now");
@@ -175,8 +190,11 @@ void ApplicationWayland::continueStartupWithScene()
     m_xwayland->xwaylandLauncher()->setListenFDs(m_xwaylandListenFds);
     m_xwayland->xwaylandLauncher()->setDisplayName(m_xwaylandDisplay);
     m_xwayland->xwaylandLauncher()->setXauthority(m_xwaylandXauthority);
+    m_xwayland->xwaylandLauncher()->setStartOnDemand(qEnvironmentVariableIntValue("KWIN_XWAYLAND_ON_DEMAND"));
     connect(m_xwayland, &Xwl::Xwayland::errorOccurred, this, &ApplicationWayland::finalizeStartup);
     connect(m_xwayland, &Xwl::Xwayland::started, this, &ApplicationWayland::finalizeStartup);
+    connect(m_xwayland, &Xwl::Xwayland::listening, this, &ApplicationWayland::finalizeStartup);
+    StartupTracer::self()->begin(QByteArrayLiteral("Xwayland startup"));
     m_xwayland->start();
 }
 
@@ -185,9 +203,15 @@ void ApplicationWayland::finalizeStartup()
     if (m_xwayland) {
         disconnect(m_xwayland, &Xwl::Xwayland::errorOccurred, this, &ApplicationWayland::finalizeStartup);
         disconnect(m_xwayland, &Xwl::Xwayland::started, this, &ApplicationWayland::finalizeStartup);
+        disconnect(m_xwayland, &Xwl::Xwayland::listening, this, &ApplicationWayland::finalizeStartup);
+        StartupTracer::self()->end(QByteArrayLiteral("Xwayland startup"));
+    }
+    {
+        StartupPhase phase(QByteArrayLiteral("Session startup"));
+        startSession();
     }
-    startSession();
     notifyStarted();
+    StartupTracer::self()->markSessionStarted();
 }
 
 void ApplicationWayland::refreshSettings(const KConfigGroup &group, const QByteArrayList &names)
@@ -285,9 +309,10 @@ static QString automaticBackendSelection()
 
 int main(int argc, char *argv[])
 {
+    KWin::StartupTracer::self()->instant(QByteArrayLiteral("main"));
     KWin::Application::setupMalloc();
     KWin::Application::setupLocalizedString();
-    KWin::gainRealTime();
+    KWin::gainRealTime(KWin::RealTimeTier::Compositor);
 
     if (signal(SIGTERM, KWin::sighandler) == SIG_IGN) {
         signal(SIGTERM, SIG_IGN);
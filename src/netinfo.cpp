@@ -11,6 +11,7 @@
 // own
 #include "netinfo.h"
 // kwin
+#include "atoms.h"
 #include "rootinfo_filter.h"
 #include "virtualdesktops.h"
 #include "workspace.h"
@@ -116,6 +117,12 @@ RootInfo *RootInfo::create()
         | NET::ActionClose;
 
     s_self = new RootInfo(supportWindow, "KWin", properties, types, states, properties2, actions, screen_number);
+
+    // NETRootInfo doesn't know about the frame synchronization protocol, clients such as GTK
+    // only use the extended sync request counter if these atoms are listed as supported
+    const xcb_atom_t frameSyncAtoms[] = {atoms->net_wm_frame_drawn, atoms->net_wm_frame_timings};
+    xcb_change_property(kwinApp()->x11Connection(), XCB_PROP_MODE_APPEND, kwinApp()->x11RootWindow(),
+                        atoms->net_supported, XCB_ATOM_ATOM, 32, 2, frameSyncAtoms);
     return s_self;
 }
 
@@ -57,6 +57,9 @@ Options::Options(QObject *parent)
     , m_xwaylandMaxCrashCount(Options::defaultXwaylandMaxCrashCount())
     , m_latencyPolicy(Options::defaultLatencyPolicy())
     , m_renderTimeEstimator(Options::defaultRenderTimeEstimator())
+    , m_renderTimePercentile(Options::defaultRenderTimePercentile())
+    , m_occludedFrameCallbackInterval(Options::defaultOccludedFrameCallbackInterval())
+    , m_idleOutputFrameRate(Options::defaultIdleOutputFrameRate())
     , m_compositingMode(Options::defaultCompositingMode())
     , m_useCompositing(Options::defaultUseCompositing())
     , m_hiddenPreviews(Options::defaultHiddenPreviews())
@@ -66,6 +69,7 @@ Options::Options(QObject *parent)
     , m_glPreferBufferSwap(Options::defaultGlPreferBufferSwap())
     , m_glPlatformInterface(Options::defaultGlPlatformInterface())
     , m_windowsBlockCompositing(true)
+    , m_unredirectFullscreen(false)
     , m_MoveMinimizedWindowsToEndOfTabBoxFocusChain(false)
     , OpTitlebarDblClick(Options::defaultOperationTitlebarDblClick())
     , CmdActiveTitlebar1(Options::defaultCommandActiveTitlebar1())
@@ -589,6 +593,15 @@ void Options::setWindowsBlockCompositing(bool value)
     Q_EMIT windowsBlockCompositingChanged();
 }
 
+void Options::setUnredirectFullscreen(bool value)
+{
+    if (m_unredirectFullscreen == value) {
+        return;
+    }
+    m_unredirectFullscreen = value;
+    Q_EMIT unredirectFullscreenChanged();
+}
+
 void Options::setMoveMinimizedWindowsToEndOfTabBoxFocusChain(bool value)
 {
     if (m_MoveMinimizedWindowsToEndOfTabBoxFocusChain == value) {
@@ -644,6 +657,51 @@ void Options::setRenderTimeEstimator(RenderTimeEstimator estimator)
     Q_EMIT renderTimeEstimatorChanged();
 }
 
+int Options::renderTimePercentile() const
+{
+    return m_renderTimePercentile;
+}
+
+void Options::setRenderTimePercentile(int percentile)
+{
+    percentile = qBound(1, percentile, 100);
+    if (m_renderTimePercentile == percentile) {
+        return;
+    }
+    m_renderTimePercentile = percentile;
+    Q_EMIT renderTimePercentileChanged();
+}
+
+int Options::occludedFrameCallbackInterval() const
+{
+    return m_occludedFrameCallbackInterval;
+}
+
+void Options::setOccludedFrameCallbackInterval(int interval)
+{
+    interval = qMax(0, interval);
+    if (m_occludedFrameCallbackInterval == interval) {
+        return;
+    }
+    m_occludedFrameCallbackInterval = interval;
+    Q_EMIT occludedFrameCallbackIntervalChanged();
+}
+
+int Options::idleOutputFrameRate() const
+{
+    return m_idleOutputFrameRate;
+}
+
+void Options::setIdleOutputFrameRate(int rate)
+{
+    rate = qMax(0, rate);
+    if (m_idleOutputFrameRate == rate) {
+        return;
+    }
+    m_idleOutputFrameRate = rate;
+    Q_EMIT idleOutputFrameRateChanged();
+}
+
 void Options::setGlPlatformInterface(OpenGLPlatformInterface interface)
 {
     // check environment variable
@@ -786,9 +844,13 @@ void Options::syncFromKcfgc()
     setElectricBorderTiling(m_settings->electricBorderTiling());
     setElectricBorderCornerRatio(m_settings->electricBorderCornerRatio());
     setWindowsBlockCompositing(m_settings->windowsBlockCompositing());
+    setUnredirectFullscreen(m_settings->unredirectFullscreen());
     setMoveMinimizedWindowsToEndOfTabBoxFocusChain(m_settings->moveMinimizedWindowsToEndOfTabBoxFocusChain());
     setLatencyPolicy(m_settings->latencyPolicy());
     setRenderTimeEstimator(m_settings->renderTimeEstimator());
+    setRenderTimePercentile(m_settings->renderTimePercentile());
+    setOccludedFrameCallbackInterval(m_settings->occludedFrameCallbackInterval());
+    setIdleOutputFrameRate(m_settings->idleOutputFrameRate());
 }
 
 bool Options::loadCompositingConfig(bool force)
@@ -60,6 +60,7 @@ enum RenderTimeEstimator {
     RenderTimeEstimatorMinimum,
     RenderTimeEstimatorMaximum,
     RenderTimeEstimatorAverage,
+    RenderTimeEstimatorPercentile,
 };
 
 class Settings;
@@ -192,8 +193,12 @@ class KWIN_EXPORT Options : public QObject
     Q_PROPERTY(GlSwapStrategy glPreferBufferSwap READ glPreferBufferSwap WRITE setGlPreferBufferSwap NOTIFY glPreferBufferSwapChanged)
     Q_PROPERTY(KWin::OpenGLPlatformInterface glPlatformInterface READ glPlatformInterface WRITE setGlPlatformInterface NOTIFY glPlatformInterfaceChanged)
     Q_PROPERTY(bool windowsBlockCompositing READ windowsBlockCompositing WRITE setWindowsBlockCompositing NOTIFY windowsBlockCompositingChanged)
+    Q_PROPERTY(bool unredirectFullscreen READ unredirectFullscreen WRITE setUnredirectFullscreen NOTIFY unredirectFullscreenChanged)
     Q_PROPERTY(LatencyPolicy latencyPolicy READ latencyPolicy WRITE setLatencyPolicy NOTIFY latencyPolicyChanged)
     Q_PROPERTY(RenderTimeEstimator renderTimeEstimator READ renderTimeEstimator WRITE setRenderTimeEstimator NOTIFY renderTimeEstimatorChanged)
+    Q_PROPERTY(int renderTimePercentile READ renderTimePercentile WRITE setRenderTimePercentile NOTIFY renderTimePercentileChanged)
+    Q_PROPERTY(int occludedFrameCallbackInterval READ occludedFrameCallbackInterval WRITE setOccludedFrameCallbackInterval NOTIFY occludedFrameCallbackIntervalChanged)
+    Q_PROPERTY(int idleOutputFrameRate READ idleOutputFrameRate WRITE setIdleOutputFrameRate NOTIFY idleOutputFrameRateChanged)
 public:
     explicit Options(QObject *parent = nullptr);
     ~Options() override;
@@ -665,6 +670,15 @@ public:
         return m_windowsBlockCompositing;
     }
 
+    /**
+     * Whether opaque fullscreen windows that nothing overlaps are taken out of compositing
+     * on X11 and presented by the X server directly.
+     */
+    bool unredirectFullscreen() const
+    {
+        return m_unredirectFullscreen;
+    }
+
     bool moveMinimizedWindowsToEndOfTabBoxFocusChain() const
     {
         return m_MoveMinimizedWindowsToEndOfTabBoxFocusChain;
@@ -673,6 +687,24 @@ public:
     QStringList modifierOnlyDBusShortcut(Qt::KeyboardModifier mod) const;
     LatencyPolicy latencyPolicy() const;
     RenderTimeEstimator renderTimeEstimator() const;
+    /**
+     * Returns the percentile of past render times that the percentile render time
+     * estimator aims to fit in, e.g. 95 for p95.
+     */
+    int renderTimePercentile() const;
+    /**
+     * Returns the minimum interval in milliseconds between frame callbacks of windows that
+     * are completely occluded by other windows. Zero means that occluded windows receive
+     * frame callbacks only once they become visible again.
+     */
+    int occludedFrameCallbackInterval() const;
+    /**
+     * Returns the frame rate in Hz at which outputs that show only static or background
+     * content are repainted. The output with focus, the one with the cursor and outputs
+     * showing fullscreen or overlay content are always repainted at their refresh rate.
+     * Zero disables the limit.
+     */
+    int idleOutputFrameRate() const;
 
     // setters
     void setFocusPolicy(FocusPolicy focusPolicy);
@@ -728,9 +760,13 @@ public:
     void setGlPreferBufferSwap(char glPreferBufferSwap);
     void setGlPlatformInterface(OpenGLPlatformInterface interface);
     void setWindowsBlockCompositing(bool set);
+    void setUnredirectFullscreen(bool set);
     void setMoveMinimizedWindowsToEndOfTabBoxFocusChain(bool set);
     void setLatencyPolicy(LatencyPolicy policy);
     void setRenderTimeEstimator(RenderTimeEstimator estimator);
+    void setRenderTimePercentile(int percentile);
+    void setOccludedFrameCallbackInterval(int interval);
+    void setIdleOutputFrameRate(int rate);
 
     // default values
     static WindowOperation defaultOperationTitlebarDblClick()
@@ -861,6 +897,18 @@ public:
     {
         return RenderTimeEstimatorMaximum;
     }
+    static int defaultRenderTimePercentile()
+    {
+        return 95;
+    }
+    static int defaultOccludedFrameCallbackInterval()
+    {
+        return 1000;
+    }
+    static int defaultIdleOutputFrameRate()
+    {
+        return 0;
+    }
     /**
      * Performs loading all settings except compositing related.
      */
@@ -928,10 +976,14 @@ Q_SIGNALS:
     void glPreferBufferSwapChanged();
     void glPlatformInterfaceChanged();
     void windowsBlockCompositingChanged();
+    void unredirectFullscreenChanged();
     void animationSpeedChanged();
     void latencyPolicyChanged();
     void configChanged();
     void renderTimeEstimatorChanged();
+    void renderTimePercentileChanged();
+    void occludedFrameCallbackIntervalChanged();
+    void idleOutputFrameRateChanged();
 
 private:
     void setElectricBorders(int borders);
@@ -962,6 +1014,9 @@ private:
     int m_xwaylandMaxCrashCount;
     LatencyPolicy m_latencyPolicy;
     RenderTimeEstimator m_renderTimeEstimator;
+    int m_renderTimePercentile;
+    int m_occludedFrameCallbackInterval;
+    int m_idleOutputFrameRate;
 
     CompositingType m_compositingMode;
     bool m_useCompositing;
@@ -973,6 +1028,7 @@ private:
     GlSwapStrategy m_glPreferBufferSwap;
     OpenGLPlatformInterface m_glPlatformInterface;
     bool m_windowsBlockCompositing;
+    bool m_unredirectFullscreen;
     bool m_MoveMinimizedWindowsToEndOfTabBoxFocusChain;
 
     WindowOperation OpTitlebarDblClick;
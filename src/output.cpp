@@ -414,7 +414,20 @@ void Output::setRgbRangeInternal(RgbRange range)
 
 void Output::setColorTransformation(const QSharedPointer<ColorTransformation> &transformation)
 {
-    Q_UNUSED(transformation);
+    setCompositedColorTransformation(transformation);
+}
+
+QSharedPointer<ColorTransformation> Output::compositedColorTransformation() const
+{
+    return m_compositedColorTransformation;
+}
+
+void Output::setCompositedColorTransformation(const QSharedPointer<ColorTransformation> &transformation)
+{
+    if (m_compositedColorTransformation != transformation) {
+        m_compositedColorTransformation = transformation;
+        Q_EMIT compositedColorTransformationChanged();
+    }
 }
 
 } // namespace KWin
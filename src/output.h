@@ -240,8 +240,21 @@ public:
 
     bool isPlaceholder() const;
 
+    /**
+     * Sets the color transformation of this output to @a transformation. The default
+     * implementation leaves the transformation to the compositor, outputs that can apply
+     * it in the display hardware should override this function.
+     */
     virtual void setColorTransformation(const QSharedPointer<ColorTransformation> &transformation);
 
+    /**
+     * Returns the color transformation that has to be applied while compositing, because
+     * the display hardware can't do it, or @c null if there is none.
+     *
+     * @since 5.26
+     */
+    QSharedPointer<ColorTransformation> compositedColorTransformation() const;
+
 Q_SIGNALS:
     /**
      * This signal is emitted when the geometry of this output has changed.
@@ -295,6 +308,10 @@ Q_SIGNALS:
     void overscanChanged();
     void vrrPolicyChanged();
     void rgbRangeChanged();
+    /**
+     * This signal is emitted when the composited color transformation has changed.
+     */
+    void compositedColorTransformationChanged();
 
 protected:
     struct Information
@@ -325,6 +342,7 @@ protected:
     void setDpmsModeInternal(DpmsMode dpmsMode);
     void setOverscanInternal(uint32_t overscan);
     void setRgbRangeInternal(RgbRange range);
+    void setCompositedColorTransformation(const QSharedPointer<ColorTransformation> &transformation);
 
     QSize orientateSize(const QSize &size) const;
 
@@ -344,6 +362,7 @@ private:
     bool m_isEnabled = true;
     uint32_t m_overscan = 0;
     RgbRange m_rgbRange = RgbRange::Automatic;
+    QSharedPointer<ColorTransformation> m_compositedColorTransformation;
     friend class EffectScreenImpl; // to access m_effectScreen
 };
 
@@ -16,7 +16,7 @@ OutputLayer::OutputLayer(QObject *parent)
 
 QRegion OutputLayer::repaints() const
 {
-    return m_repaints;
+    return m_repaints.toRegion();
 }
 
 void OutputLayer::addRepaint(const QRegion &region)
@@ -26,7 +26,7 @@ void OutputLayer::addRepaint(const QRegion &region)
 
 void OutputLayer::resetRepaints()
 {
-    m_repaints = QRegion();
+    m_repaints.clear();
 }
 
 void OutputLayer::aboutToStartPainting(const QRegion &damage)
@@ -40,4 +40,15 @@ bool OutputLayer::scanout(SurfaceItem *surfaceItem)
     return false;
 }
 
+QVector<SurfaceItem *> OutputLayer::assignOverlays(const QVector<SurfaceItem *> &surfaceItems)
+{
+    Q_UNUSED(surfaceItems)
+    return {};
+}
+
+std::chrono::nanoseconds OutputLayer::queryRenderTime()
+{
+    return std::chrono::nanoseconds::zero();
+}
+
 } // namespace KWin
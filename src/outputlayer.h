@@ -8,9 +8,13 @@
 
 #include "kwin_export.h"
 #include "rendertarget.h"
+#include "utils/compactregion.h"
 
 #include <QObject>
 #include <QRegion>
+#include <QVector>
+
+#include <chrono>
 
 namespace KWin
 {
@@ -49,8 +53,23 @@ public:
      */
     virtual bool scanout(SurfaceItem *surfaceItem);
 
+    /**
+     * Tries to put the given surfaces, ordered from top to bottom, on hardware overlay planes
+     * above this layer. Surfaces that are not assigned to an overlay plane anymore are removed
+     * from the overlay planes. Returns the surfaces that are shown on overlay planes, they
+     * don't have to be painted into this layer.
+     */
+    virtual QVector<SurfaceItem *> assignOverlays(const QVector<SurfaceItem *> &surfaceItems);
+
+    /**
+     * Returns how long it took to render the last frame on this layer, including the time
+     * the GPU needed to execute the rendering commands, if that's known. Returns zero if
+     * the render time is unknown.
+     */
+    virtual std::chrono::nanoseconds queryRenderTime();
+
 private:
-    QRegion m_repaints;
+    CompactRegion m_repaints;
 };
 
 } // namespace KWin
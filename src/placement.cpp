@@ -175,6 +175,114 @@ static inline bool isIrrelevant(const Window *client, const Window *regarding, i
     return false;
 }
 
+namespace
+{
+
+/**
+ * A uniform grid over the geometries of the windows that matter for smart placement.
+ *
+ * Every window is added to the cells it covers, so looking up the windows around a
+ * candidate position only visits the windows in the nearby cells rather than every
+ * window on the desktop.
+ */
+class PlacementIndex
+{
+public:
+    struct Entry
+    {
+        QRect geometry;
+        bool keepAbove;
+        bool ignored;
+    };
+
+    PlacementIndex(const Window *regarding, int desktop)
+    {
+        const auto &stacking = workspace()->stackingOrder();
+        for (const Window *client : stacking) {
+            if (isIrrelevant(client, regarding, desktop)) {
+                continue;
+            }
+            const QRect geometry(client->x(), client->y(), client->width(), client->height());
+            // KeepBelow windows are ignored for placement (see X11Window::belongsToLayer() for Dock)
+            m_entries.append(Entry{geometry, client->keepAbove(), !client->keepAbove() && client->keepBelow() && !client->isDock()});
+            m_bounds = m_bounds.united(geometry);
+        }
+        if (m_bounds.isEmpty()) {
+            return;
+        }
+
+        m_columns = (m_bounds.width() + s_cellSize - 1) / s_cellSize;
+        m_rows = (m_bounds.height() + s_cellSize - 1) / s_cellSize;
+        m_cells.resize(m_columns * m_rows);
+        m_visited.fill(0, m_entries.count());
+        for (int i = 0; i < m_entries.count(); ++i) {
+            if (m_entries[i].geometry.isEmpty()) {
+                continue;
+            }
+            const QRect cells = cellsFor(m_entries[i].geometry);
+            for (int row = cells.top(); row <= cells.bottom(); ++row) {
+                for (int column = cells.left(); column <= cells.right(); ++column) {
+                    m_cells[row * m_columns + column].append(i);
+                }
+            }
+        }
+    }
+
+    const QVector<Entry> &entries() const
+    {
+        return m_entries;
+    }
+
+    /**
+     * Calls @a callback once for every window that may intersect @a rect.
+     */
+    template<typename Callback>
+    void forEachNear(const QRect &rect, Callback callback)
+    {
+        const QRect clipped = rect & m_bounds;
+        if (clipped.isEmpty()) {
+            return;
+        }
+        ++m_stamp;
+        const QRect cells = cellsFor(clipped);
+        for (int row = cells.top(); row <= cells.bottom(); ++row) {
+            for (int column = cells.left(); column <= cells.right(); ++column) {
+                for (int index : qAsConst(m_cells[row * m_columns + column])) {
+                    if (m_visited[index] != m_stamp) {
+                        m_visited[index] = m_stamp;
+                        callback(m_entries[index]);
+                    }
+                }
+            }
+        }
+    }
+
+    QRect bounds() const
+    {
+        return m_bounds;
+    }
+
+private:
+    QRect cellsFor(const QRect &rect) const
+    {
+        const QRect clipped = rect & m_bounds;
+        return QRect(QPoint((clipped.left() - m_bounds.left()) / s_cellSize, (clipped.top() - m_bounds.top()) / s_cellSize),
+                     QPoint((clipped.right() - m_bounds.left()) / s_cellSize, (clipped.bottom() - m_bounds.top()) / s_cellSize));
+    }
+
+    static const int s_cellSize = 128;
+
+    QVector<Entry> m_entries;
+    QVector<QVector<int>> m_cells;
+    QVector<uint> m_visited;
+    uint m_stamp = 0;
+    QRect m_bounds;
+    int m_columns = 0;
+    int m_rows = 0;
+};
+
+} // namespace
+
 /**
  * Place the client \a c according to a really smart placement algorithm :-)
  */
@@ -202,7 +310,6 @@ void Placement::placeSmart(Window *c, const QRect &area, Policy /*next*/)
     int desktop = c->desktop() == 0 || c->isOnAllDesktops() ? VirtualDesktopManager::self()->current() : c->desktop();
 
     int cxl, cxr, cyt, cyb; // temp coords
-    int xl, xr, yt, yb; // temp coords
     int basket; // temp holder
 
     // get the maximum allowed windows space
@@ -215,6 +322,8 @@ void Placement::placeSmart(Window *c, const QRect &area, Policy /*next*/)
     int ch = c->height() - 1;
     int cw = c->width() - 1;
 
+    PlacementIndex index(c, desktop);
+
     bool first_pass = true; // CT lame flag. Don't like it. What else would do?
 
     // loop over possible positions
@@ -231,15 +340,11 @@ void Placement::placeSmart(Window *c, const QRect &area, Policy /*next*/)
             cxr = x + cw;
             cyt = y;
             cyb = y + ch;
-            for (auto l = workspace()->stackingOrder().constBegin(); l != workspace()->stackingOrder().constEnd(); ++l) {
-                auto client = *l;
-                if (isIrrelevant(client, c, desktop)) {
-                    continue;
-                }
-                xl = client->x();
-                yt = client->y();
-                xr = xl + client->width();
-                yb = yt + client->height();
+            index.forEachNear(QRect(QPoint(cxl, cyt), QPoint(cxr, cyb)), [&](const PlacementIndex::Entry &entry) {
+                int xl = entry.geometry.x();
+                int yt = entry.geometry.y();
+                int xr = xl + entry.geometry.width();
+                int yb = yt + entry.geometry.height();
 
                 // if windows overlap, calc the overall overlapping
                 if ((cxl < xr) && (cxr > xl) && (cyt < yb) && (cyb > yt)) {
@@ -247,15 +352,13 @@ void Placement::placeSmart(Window *c, const QRect &area, Policy /*next*/)
                     xr = qMin(cxr, xr);
                     yt = qMax(cyt, yt);
                     yb = qMin(cyb, yb);
-                    if (client->keepAbove()) {
+                    if (entry.keepAbove) {
                         overlap += 16 * (xr - xl) * (yb - yt);
-                    } else if (client->keepBelow() && !client->isDock()) { // ignore KeepBelow windows
-                        overlap += 0; // for placement (see X11Window::belongsToLayer() for Dock)
-                    } else {
+                    } else if (!entry.ignored) {
                         overlap += (xr - xl) * (yb - yt);
                     }
                 }
-            }
+            });
         }
 
         // CT first time we get no overlap we stop.
@@ -284,17 +387,13 @@ void Placement::placeSmart(Window *c, const QRect &area, Policy /*next*/)
                 possible -= cw;
             }
 
-            // compare to the position of each client on the same desk
-            for (auto l = workspace()->stackingOrder().constBegin(); l != workspace()->stackingOrder().constEnd(); ++l) {
-                auto client = *l;
-                if (isIrrelevant(client, c, desktop)) {
-                    continue;
-                }
-
-                xl = client->x();
-                yt = client->y();
-                xr = xl + client->width();
-                yb = yt + client->height();
+            // compare to the position of each client in the same row
+            const QRect row(index.bounds().left(), y, index.bounds().width(), qMax(ch, 1));
+            index.forEachNear(row, [&](const PlacementIndex::Entry &entry) {
+                const int xl = entry.geometry.x();
+                const int yt = entry.geometry.y();
+                const int xr = xl + entry.geometry.width();
+                const int yb = yt + entry.geometry.height();
 
                 // if not enough room above or under the current tested client
                 // determine the first non-overlapped x position
@@ -309,7 +408,7 @@ void Placement::placeSmart(Window *c, const QRect &area, Policy /*next*/)
                         possible = basket;
                     }
                 }
-            }
+            });
             x = possible;
         }
 
@@ -323,16 +422,9 @@ void Placement::placeSmart(Window *c, const QRect &area, Policy /*next*/)
             }
 
             // test the position of each window on the desk
-            for (auto l = workspace()->stackingOrder().constBegin(); l != workspace()->stackingOrder().constEnd(); ++l) {
-                auto client = *l;
-                if (isIrrelevant(client, c, desktop)) {
-                    continue;
-                }
-
-                xl = client->x();
-                yt = client->y();
-                xr = xl + client->width();
-                yb = yt + client->height();
+            for (const PlacementIndex::Entry &entry : index.entries()) {
+                const int yt = entry.geometry.y();
+                const int yb = yt + entry.geometry.height();
 
                 // if not enough room to the left or right of the current tested client
                 // determine the first non-overlapped y position
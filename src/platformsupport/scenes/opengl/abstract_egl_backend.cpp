@@ -80,6 +80,9 @@ void AbstractEglBackend::teardown()
 
 void AbstractEglBackend::cleanup()
 {
+    if (m_dmaBuf) {
+        m_dmaBuf->releaseTextures();
+    }
     cleanupSurfaces();
     cleanupGL();
     doneCurrent();
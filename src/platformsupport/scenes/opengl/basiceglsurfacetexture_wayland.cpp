@@ -8,11 +8,13 @@
 #include "egl_dmabuf.h"
 #include "kwineglext.h"
 #include "kwingltexture.h"
+#include "pixelbufferupload.h"
 #include "surfaceitem_wayland.h"
 #include "utils/common.h"
 #include "wayland/drmclientbuffer.h"
 #include "wayland/linuxdmabufv1clientbuffer.h"
 #include "wayland/shmclientbuffer.h"
+#include "wayland/surface_interface.h"
 
 namespace KWin
 {
@@ -21,6 +23,12 @@ BasicEGLSurfaceTextureWayland::BasicEGLSurfaceTextureWayland(OpenGLBackend *back
                                                              SurfacePixmapWayland *pixmap)
     : OpenGLSurfaceTextureWayland(backend, pixmap)
 {
+    if (KWaylandServer::SurfaceInterface *surface = pixmap->surface()) {
+        // Start copying shm buffers as soon as they are committed rather than in the paint pass.
+        QObject::connect(surface, &KWaylandServer::SurfaceInterface::committed, pixmap, [this]() {
+            stageShmTexture();
+        });
+    }
 }
 
 BasicEGLSurfaceTextureWayland::~BasicEGLSurfaceTextureWayland()
@@ -53,6 +61,8 @@ void BasicEGLSurfaceTextureWayland::destroy()
         m_image = EGL_NO_IMAGE_KHR;
     }
     m_texture.reset();
+    m_shmUpload.reset();
+    m_shmUploadBuffer.clear();
     m_bufferType = BufferType::None;
 }
 
@@ -75,6 +85,7 @@ bool BasicEGLSurfaceTextureWayland::loadShmTexture(KWaylandServer::ShmClientBuff
     }
 
     m_texture.reset(new GLTexture(image));
+    m_texture->setMemoryCategory(GLMemoryTracker::Surface);
     m_texture->setFilter(GL_LINEAR);
     m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
     m_texture->setYInverted(true);
@@ -96,12 +107,48 @@ void BasicEGLSurfaceTextureWayland::updateShmTexture(KWaylandServer::ShmClientBu
         return;
     }
 
-    const QRegion damage = mapRegion(m_pixmap->item()->surfaceToBufferMatrix(), region);
+    const QRegion damage = mapRegion(m_pixmap->item()->surfaceToBufferMatrix(), region) & image.rect();
+    if (m_shmUpload && m_shmUploadBuffer == buffer && m_shmUpload->upload(m_texture.data(), damage)) {
+        return;
+    }
+
     for (const QRect &rect : damage) {
         m_texture->update(image, rect.topLeft(), rect);
     }
 }
 
+void BasicEGLSurfaceTextureWayland::stageShmTexture()
+{
+    if (m_bufferType != BufferType::Shm || m_pixmap->isDiscarded()) {
+        return;
+    }
+
+    auto buffer = qobject_cast<KWaylandServer::ShmClientBuffer *>(m_pixmap->surface()->buffer());
+    if (!buffer || buffer->size() != m_texture->size()) {
+        return;
+    }
+
+    const QImage &image = buffer->data();
+    if (Q_UNLIKELY(image.isNull()) || !PixelBufferUpload::isSupported(image.format())) {
+        return;
+    }
+
+    // The item damage accumulates until the next paint, so it covers all commits since then.
+    const QRegion damage = mapRegion(m_pixmap->item()->surfaceToBufferMatrix(), m_pixmap->item()->damage());
+    if (damage.isEmpty() || !backend()->makeCurrent()) {
+        return;
+    }
+
+    if (!m_shmUpload) {
+        m_shmUpload.reset(new PixelBufferUpload());
+    }
+    if (m_shmUpload->stage(image, damage)) {
+        m_shmUploadBuffer = buffer;
+    } else {
+        m_shmUploadBuffer.clear();
+    }
+}
+
 bool BasicEGLSurfaceTextureWayland::loadEglTexture(KWaylandServer::DrmClientBuffer *buffer)
 {
     const AbstractEglBackendFunctions *funcs = backend()->functions();
@@ -113,6 +160,7 @@ bool BasicEGLSurfaceTextureWayland::loadEglTexture(KWaylandServer::DrmClientBuff
     }
 
     m_texture.reset(new GLTexture(GL_TEXTURE_2D));
+    m_texture->setMemoryCategory(GLMemoryTracker::Surface);
     m_texture->setSize(buffer->size());
     m_texture->create();
     m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
@@ -155,21 +203,14 @@ void BasicEGLSurfaceTextureWayland::updateEglTexture(KWaylandServer::DrmClientBu
 
 bool BasicEGLSurfaceTextureWayland::loadDmabufTexture(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer)
 {
-    auto dmabuf = static_cast<EglDmabufBuffer *>(buffer);
-    if (Q_UNLIKELY(dmabuf->images().constFirst() == EGL_NO_IMAGE_KHR)) {
+    GLTexture *texture = static_cast<EglDmabufBuffer *>(buffer)->texture();
+    if (Q_UNLIKELY(!texture)) {
         qCritical(KWIN_OPENGL) << "Invalid dmabuf-based wl_buffer";
         return false;
     }
 
-    m_texture.reset(new GLTexture(GL_TEXTURE_2D));
-    m_texture->setSize(dmabuf->size());
-    m_texture->create();
-    m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
-    m_texture->setFilter(GL_NEAREST);
-    m_texture->bind();
-    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(dmabuf->images().constFirst()));
-    m_texture->unbind();
-    m_texture->setYInverted(dmabuf->origin() == KWaylandServer::ClientBuffer::Origin::TopLeft);
+    // The buffer keeps its texture, this only shares it
+    m_texture.reset(new GLTexture(*texture));
     m_bufferType = BufferType::DmaBuf;
 
     return true;
@@ -183,13 +224,16 @@ void BasicEGLSurfaceTextureWayland::updateDmabufTexture(KWaylandServer::LinuxDma
         return;
     }
 
-    auto dmabuf = static_cast<EglDmabufBuffer *>(buffer);
-    m_texture->bind();
-    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(dmabuf->images().constFirst()));
-    m_texture->unbind();
-    // The origin in a dmabuf-buffer is at the upper-left corner, so the meaning
-    // of Y-inverted is the inverse of OpenGL.
-    m_texture->setYInverted(dmabuf->origin() == KWaylandServer::ClientBuffer::Origin::TopLeft);
+    // Clients cycle through a few buffers, switching to the texture of a recycled
+    // buffer doesn't need to rebind its image
+    GLTexture *texture = static_cast<EglDmabufBuffer *>(buffer)->texture();
+    if (Q_UNLIKELY(!texture)) {
+        qCritical(KWIN_OPENGL) << "Invalid dmabuf-based wl_buffer";
+        return;
+    }
+    if (m_texture->texture() != texture->texture()) {
+        m_texture.reset(new GLTexture(*texture));
+    }
 }
 
 EGLImageKHR BasicEGLSurfaceTextureWayland::attach(KWaylandServer::DrmClientBuffer *buffer)
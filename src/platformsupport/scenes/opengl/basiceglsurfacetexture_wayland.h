@@ -8,10 +8,13 @@
 
 #include "openglsurfacetexture_wayland.h"
 
+#include <QPointer>
+
 #include <epoxy/egl.h>
 
 namespace KWaylandServer
 {
+class ClientBuffer;
 class DrmClientBuffer;
 class ShmClientBuffer;
 class LinuxDmaBufV1ClientBuffer;
@@ -21,6 +24,7 @@ namespace KWin
 {
 
 class AbstractEglBackend;
+class PixelBufferUpload;
 
 class KWIN_EXPORT BasicEGLSurfaceTextureWayland : public OpenGLSurfaceTextureWayland
 {
@@ -36,6 +40,7 @@ public:
 private:
     bool loadShmTexture(KWaylandServer::ShmClientBuffer *buffer);
     void updateShmTexture(KWaylandServer::ShmClientBuffer *buffer, const QRegion &region);
+    void stageShmTexture();
     bool loadEglTexture(KWaylandServer::DrmClientBuffer *buffer);
     void updateEglTexture(KWaylandServer::DrmClientBuffer *buffer);
     bool loadDmabufTexture(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer);
@@ -52,6 +57,8 @@ private:
 
     EGLImageKHR m_image = EGL_NO_IMAGE_KHR;
     BufferType m_bufferType = BufferType::None;
+    QScopedPointer<PixelBufferUpload> m_shmUpload;
+    QPointer<KWaylandServer::ClientBuffer> m_shmUploadBuffer;
 };
 
 } // namespace KWin
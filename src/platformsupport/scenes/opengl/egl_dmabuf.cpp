@@ -11,10 +11,13 @@
 #include "drm_fourcc.h"
 #include "kwineglext.h"
 #include "kwineglutils_p.h"
+#include "kwingltexture.h"
 
 #include "utils/common.h"
 #include "wayland_server.h"
 
+#include <QtAlgorithms>
+
 #include <unistd.h>
 
 namespace KWin
@@ -115,6 +118,9 @@ EglDmabufBuffer::EglDmabufBuffer(const QVector<KWaylandServer::LinuxDmaBufV1Plan
 
 EglDmabufBuffer::~EglDmabufBuffer()
 {
+    if (m_texture) {
+        m_interfaceImpl->m_backend->makeCurrent();
+    }
     removeImages();
 }
 
@@ -130,12 +136,42 @@ void EglDmabufBuffer::addImage(EGLImage image)
 
 void EglDmabufBuffer::removeImages()
 {
+    releaseTexture();
     for (auto image : qAsConst(m_images)) {
         eglDestroyImageKHR(m_interfaceImpl->m_backend->eglDisplay(), image);
     }
     m_images.clear();
 }
 
+GLTexture *EglDmabufBuffer::texture()
+{
+    if (m_texture) {
+        return m_texture.data();
+    }
+    if (m_images.isEmpty() || m_images.constFirst() == EGL_NO_IMAGE_KHR) {
+        return nullptr;
+    }
+
+    m_texture.reset(new GLTexture(GL_TEXTURE_2D));
+    m_texture->setMemoryCategory(GLMemoryTracker::Surface);
+    m_texture->setSize(size());
+    m_texture->create();
+    m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    m_texture->setFilter(GL_NEAREST);
+    m_texture->bind();
+    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(m_images.constFirst()));
+    m_texture->unbind();
+    // The origin in a dmabuf-buffer is at the upper-left corner, so the meaning
+    // of Y-inverted is the inverse of OpenGL.
+    m_texture->setYInverted(origin() == KWaylandServer::ClientBuffer::Origin::TopLeft);
+    return m_texture.data();
+}
+
+void EglDmabufBuffer::releaseTexture()
+{
+    m_texture.reset();
+}
+
 EGLImage EglDmabuf::createImage(const QVector<KWaylandServer::LinuxDmaBufV1Plane> &planes,
                                 uint32_t format,
                                 const QSize &size)
@@ -212,6 +248,21 @@ EGLImage EglDmabuf::createImage(const QVector<KWaylandServer::LinuxDmaBufV1Plane
     return image;
 }
 
+uint qHash(const EglDmabuf::ImportLayout &layout, uint seed)
+{
+    seed = qHash(layout.format, seed);
+    seed = qHash(layout.modifier, seed);
+    seed = qHash(layout.planeCount, seed);
+    return qHash(layout.sizeClass, seed);
+}
+
+// A layout is only rejected without trying once it failed this many times in a row, so
+// that a single bad buffer (e.g. with a broken fd) doesn't poison a working layout.
+static const int s_maxImportFailures = 3;
+// How long a rejected layout is refused before it's tried again. The buffers of any client
+// count towards the failures, so a layout must not stay rejected for everyone forever.
+static const std::chrono::seconds s_importFailureTimeout(10);
+
 KWaylandServer::LinuxDmaBufV1ClientBuffer *EglDmabuf::importBuffer(const QVector<KWaylandServer::LinuxDmaBufV1Plane> &planes,
                                                                    quint32 format,
                                                                    const QSize &size,
@@ -219,11 +270,32 @@ KWaylandServer::LinuxDmaBufV1ClientBuffer *EglDmabuf::importBuffer(const QVector
 {
     Q_ASSERT(planes.count() > 0);
 
+    const int extent = qMax(size.width(), size.height());
+    const ImportLayout layout{
+        format,
+        planes[0].modifier,
+        int(planes.count()),
+        extent > 0 ? 32 - qCountLeadingZeroBits(quint32(extent)) : 0,
+    };
+
+    const auto now = std::chrono::steady_clock::now();
+    ImportResult &result = m_importResults[layout];
+    if (result.failures >= s_maxImportFailures && now - result.lastFailure < s_importFailureTimeout) {
+        return nullptr;
+    }
+
     // Try first to import as a single image
     if (auto *img = createImage(planes, format, size)) {
+        result.failures = 0;
         return new EglDmabufBuffer(img, planes, format, size, flags, this);
     }
 
+    result.lastFailure = now;
+    if (++result.failures == s_maxImportFailures) {
+        qCDebug(KWIN_OPENGL, "Rejecting dmabuf imports of format %x, modifier %llx with %d planes for a while",
+                format, static_cast<unsigned long long>(layout.modifier), layout.planeCount);
+    }
+
     // TODO: to enable this we must be able to store multiple textures per window pixmap
     //       and when on window draw do yuv to rgb transformation per shader (see Weston)
     //    // not a single image, try yuv import
@@ -306,6 +378,14 @@ EglDmabuf::EglDmabuf(AbstractEglBackend *backend)
     setSupportedFormatsAndModifiers();
 }
 
+void EglDmabuf::releaseTextures()
+{
+    const auto buffers = waylandServer()->linuxDmabufBuffers();
+    for (auto *buffer : buffers) {
+        static_cast<EglDmabufBuffer *>(buffer)->releaseTexture();
+    }
+}
+
 EglDmabuf::~EglDmabuf()
 {
     auto curBuffers = waylandServer()->linuxDmabufBuffers();
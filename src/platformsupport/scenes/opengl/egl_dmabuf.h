@@ -13,11 +13,15 @@
 
 #include "linux_dmabuf.h"
 
+#include <QHash>
 #include <QVector>
 
+#include <chrono>
+
 namespace KWin
 {
 class EglDmabuf;
+class GLTexture;
 
 class EglDmabufBuffer : public LinuxDmaBufV1ClientBuffer
 {
@@ -51,8 +55,18 @@ public:
         return m_images;
     }
 
+    /**
+     * Returns a texture bound to the first image of the buffer, or @c nullptr if the buffer
+     * couldn't be imported. The texture is created on first use and kept until the buffer is
+     * destroyed, so attaching a recycled buffer needs no EGL calls. The OpenGL context must
+     * be current.
+     */
+    GLTexture *texture();
+    void releaseTexture();
+
 private:
     QVector<EGLImage> m_images;
+    QScopedPointer<GLTexture> m_texture;
     EglDmabuf *m_interfaceImpl;
     ImportType m_importType;
 };
@@ -75,6 +89,12 @@ public:
         return m_tranches;
     }
 
+    /**
+     * Releases the textures cached by the buffers. Must be called while the OpenGL context
+     * is still current.
+     */
+    void releaseTextures();
+
 private:
     EGLImage createImage(const QVector<KWaylandServer::LinuxDmaBufV1Plane> &planes,
                          uint32_t format,
@@ -87,6 +107,38 @@ private:
 
     void setSupportedFormatsAndModifiers();
 
+    /**
+     * Identifies a class of buffers that the driver accepts or rejects alike: the format,
+     * the modifier, the number of planes and the power-of-two bucket of the larger dimension.
+     */
+    struct ImportLayout
+    {
+        quint32 format;
+        quint64 modifier;
+        int planeCount;
+        int sizeClass;
+
+        bool operator==(const ImportLayout &other) const
+        {
+            return format == other.format && modifier == other.modifier
+                && planeCount == other.planeCount && sizeClass == other.sizeClass;
+        }
+    };
+    friend uint qHash(const ImportLayout &layout, uint seed);
+
+    struct ImportResult
+    {
+        // the number of consecutive failures, zero if the last import succeeded
+        int failures = 0;
+        std::chrono::steady_clock::time_point lastFailure;
+    };
+
+    /**
+     * Import results per layout. Failures expire, so a layout that got rejected because
+     * of some bad buffers, e.g. of a single misbehaving client, is eventually tried again.
+     */
+    QHash<ImportLayout, ImportResult> m_importResults;
+
     AbstractEglBackend *m_backend;
     QVector<KWaylandServer::LinuxDmaBufV1Feedback::Tranche> m_tranches;
 
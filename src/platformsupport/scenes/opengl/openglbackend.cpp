@@ -104,9 +104,10 @@ bool OpenGLBackend::checkGraphicsReset()
     QElapsedTimer timer;
     timer.start();
 
-    // Wait until the reset is completed or max 10 seconds
+    // Wait until the reset is completed or max 10 seconds. Recovery takes in the order of
+    // hundreds of milliseconds, polling more often only competes with the driver for the CPU.
     while (timer.elapsed() < 10000 && KWin::glGetGraphicsResetStatus() != GL_NO_ERROR) {
-        usleep(50);
+        usleep(1000);
     }
 
     return true;
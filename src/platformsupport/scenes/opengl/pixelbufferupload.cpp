@@ -0,0 +1,118 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "pixelbufferupload.h"
+
+#include "kwinglplatform.h"
+#include "kwingltexture.h"
+#include "kwinglutils.h"
+
+#include <cstring>
+
+namespace KWin
+{
+
+PixelBufferUpload::PixelBufferUpload()
+{
+    for (Slot &slot : m_slots) {
+        glGenBuffers(1, &slot.buffer);
+    }
+}
+
+PixelBufferUpload::~PixelBufferUpload()
+{
+    for (const Slot &slot : m_slots) {
+        glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+bool PixelBufferUpload::isSupported(QImage::Format format)
+{
+    if (!GLTexture::supportsPixelBufferUpload(format)) {
+        return false;
+    }
+    if (hasGLVersion(3, 0)) {
+        return true;
+    }
+    return !GLPlatform::instance()->isGLES() && (hasGLExtension(QByteArrayLiteral("GL_ARB_pixel_buffer_object")) && hasGLExtension(QByteArrayLiteral("GL_ARB_map_buffer_range")));
+}
+
+bool PixelBufferUpload::stage(const QImage &image, const QRegion &region)
+{
+    const QRegion clipped = region & image.rect();
+    const int sizeInBytes = image.bytesPerLine() * image.height();
+    const int bytesPerPixel = image.depth() / 8;
+
+    // Use a different buffer than last time so the GPU can still read the previous one.
+    const int next = (m_current + 1) % s_slotCount;
+    Slot &slot = m_slots[next];
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    if (slot.size != sizeInBytes) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, sizeInBytes, nullptr, GL_STREAM_DRAW);
+        slot.size = sizeInBytes;
+    }
+
+    uchar *data = static_cast<uchar *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, sizeInBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (!data) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+
+    for (const QRect &rect : clipped) {
+        const int offset = rect.x() * bytesPerPixel;
+        if (rect.width() == image.width()) {
+            const int start = rect.y() * image.bytesPerLine();
+            std::memcpy(data + start, image.constBits() + start, rect.height() * image.bytesPerLine());
+            continue;
+        }
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            std::memcpy(data + y * image.bytesPerLine() + offset, image.constScanLine(y) + offset, rect.width() * bytesPerPixel);
+        }
+    }
+
+    const bool valid = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (!valid) {
+        // The contents of the buffer got corrupted, e.g. because of a mode switch.
+        m_region = QRegion();
+        return false;
+    }
+
+    m_current = next;
+    m_format = image.format();
+    m_bytesPerLine = image.bytesPerLine();
+    m_region = clipped;
+    return true;
+}
+
+QRegion PixelBufferUpload::stagedRegion() const
+{
+    return m_region;
+}
+
+bool PixelBufferUpload::upload(GLTexture *texture, const QRegion &region)
+{
+    if (m_region.isEmpty() || !(region - m_region).isEmpty()) {
+        return false;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_slots[m_current].buffer);
+    bool uploaded = true;
+    for (const QRect &rect : region) {
+        if (!texture->updateFromPixelBuffer(m_format, m_bytesPerLine, rect.topLeft(), rect)) {
+            uploaded = false;
+            break;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    m_region = QRegion();
+    return uploaded;
+}
+
+} // namespace KWin
@@ -0,0 +1,81 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwinglobals.h"
+
+#include <QImage>
+#include <QRegion>
+
+#include <array>
+#include <epoxy/gl.h>
+
+namespace KWin
+{
+
+class GLTexture;
+
+/**
+ * The PixelBufferUpload class uploads image data to textures through pixel buffer objects.
+ *
+ * The damaged parts of an image are copied to a pixel buffer with stage(), which can happen
+ * long before the texture is needed, e.g. when a client commits a new buffer. Later, upload()
+ * only asks the GPU to copy the staged pixels to the texture, which doesn't block the CPU.
+ */
+class KWIN_EXPORT PixelBufferUpload
+{
+public:
+    PixelBufferUpload();
+    ~PixelBufferUpload();
+
+    /**
+     * Returns @c true if images with the given @a format can be uploaded through pixel buffers.
+     */
+    static bool isSupported(QImage::Format format);
+
+    /**
+     * Copies the @a region of the @a image to the next pixel buffer. The pixels that have
+     * been staged previously but not uploaded yet are discarded.
+     */
+    bool stage(const QImage &image, const QRegion &region);
+
+    /**
+     * Returns the region of the image that has been staged but not uploaded yet.
+     */
+    QRegion stagedRegion() const;
+
+    /**
+     * Uploads the @a region of the staged image to the @a texture. Returns @c false if
+     * the @a region has not been staged completely, nothing is uploaded in that case. It
+     * also returns @c false if the texture rejects the pixels, some rects of the @a region
+     * may have been uploaded already then, so the whole @a region must be uploaded again.
+     *
+     * The staged pixels can only be uploaded once. Unless the @a region has not been staged,
+     * stagedRegion() is empty afterwards, even if the upload failed.
+     */
+    bool upload(GLTexture *texture, const QRegion &region);
+
+private:
+    struct Slot
+    {
+        GLuint buffer = 0;
+        int size = 0;
+    };
+
+    static constexpr int s_slotCount = 2;
+
+    std::array<Slot, s_slotCount> m_slots;
+    int m_current = -1;
+    QImage::Format m_format = QImage::Format_Invalid;
+    int m_bytesPerLine = 0;
+    QRegion m_region;
+
+    Q_DISABLE_COPY(PixelBufferUpload)
+};
+
+} // namespace KWin
@@ -14,12 +14,16 @@
 #include "wayland/seat_interface.h"
 #include "wayland_server.h"
 
+#include <algorithm>
+
 namespace KWin
 {
 
 KWinIdleTimePoller::KWinIdleTimePoller(QObject *parent)
     : AbstractSystemPoller(parent)
 {
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &KWinIdleTimePoller::handleTimeout);
 }
 
 KWinIdleTimePoller::~KWinIdleTimePoller() = default;
@@ -33,6 +37,7 @@ bool KWinIdleTimePoller::setUpPoller()
 {
     connect(waylandServer()->idle(), &KWaylandServer::IdleInterface::inhibitedChanged, this, &KWinIdleTimePoller::onInhibitedChanged);
     connect(waylandServer()->seat(), &KWaylandServer::SeatInterface::timestampChanged, this, &KWinIdleTimePoller::onTimestampChanged);
+    m_lastActivity.start();
 
     return true;
 }
@@ -44,7 +49,7 @@ void KWinIdleTimePoller::unloadPoller()
         disconnect(waylandServer()->seat(), &KWaylandServer::SeatInterface::timestampChanged, this, &KWinIdleTimePoller::onTimestampChanged);
     }
 
-    qDeleteAll(m_timeouts);
+    m_timer.stop();
     m_timeouts.clear();
 
     m_idling = false;
@@ -56,33 +61,69 @@ void KWinIdleTimePoller::addTimeout(int newTimeout)
         return;
     }
 
-    auto timer = new QTimer();
-    timer->setInterval(newTimeout);
-    timer->setSingleShot(true);
-    timer->callOnTimeout(this, [newTimeout, this]() {
-        m_idling = true;
-        Q_EMIT timeoutReached(newTimeout);
-    });
-
-    m_timeouts.insert(newTimeout, timer);
-
-    if (!waylandServer()->idle()->isInhibited()) {
-        timer->start();
-    }
+    // The timeout is counted from the last user activity, if the user has already been idle
+    // for longer, the timer fires right away and reports it as reached
+    m_timeouts.insert(newTimeout, false);
+    scheduleTimer();
 }
 
 void KWinIdleTimePoller::processActivity()
 {
+    m_lastActivity.start();
     if (m_idling) {
         Q_EMIT resumingFromIdle();
         m_idling = false;
+
+        for (auto it = m_timeouts.begin(); it != m_timeouts.end(); ++it) {
+            *it = false;
+        }
+        scheduleTimer();
+    } else if (!m_timer.isActive()) {
+        scheduleTimer();
+    }
+    // Otherwise the timer is armed for an earlier deadline, the deadlines that have moved are
+    // checked when it fires, no need to rearm the timer on every input event
+}
+
+void KWinIdleTimePoller::scheduleTimer()
+{
+    if (waylandServer()->idle()->isInhibited()) {
+        return;
     }
 
-    for (QTimer *timer : qAsConst(m_timeouts)) {
-        timer->start();
+    const qint64 elapsed = m_lastActivity.isValid() ? m_lastActivity.elapsed() : 0;
+    qint64 interval = -1;
+    for (auto it = m_timeouts.constBegin(); it != m_timeouts.constEnd(); ++it) {
+        if (!it.value()) {
+            const qint64 remaining = std::max<qint64>(0, it.key() - elapsed);
+            interval = interval == -1 ? remaining : std::min(interval, remaining);
+        }
+    }
+    if (interval == -1) {
+        m_timer.stop();
+    } else if (!m_timer.isActive() || m_timer.remainingTime() > interval) {
+        m_timer.start(interval);
     }
 }
 
+void KWinIdleTimePoller::handleTimeout()
+{
+    const qint64 elapsed = m_lastActivity.elapsed();
+    QList<int> reached;
+    for (auto it = m_timeouts.begin(); it != m_timeouts.end(); ++it) {
+        if (!it.value() && it.key() <= elapsed) {
+            *it = true;
+            reached.append(it.key());
+        }
+    }
+    std::sort(reached.begin(), reached.end());
+    for (int timeout : std::as_const(reached)) {
+        m_idling = true;
+        Q_EMIT timeoutReached(timeout);
+    }
+    scheduleTimer();
+}
+
 void KWinIdleTimePoller::onInhibitedChanged()
 {
     if (waylandServer()->idle()->isInhibited()) {
@@ -106,16 +147,16 @@ void KWinIdleTimePoller::onTimestampChanged()
 
 void KWinIdleTimePoller::catchIdleEvent()
 {
-    for (QTimer *timer : qAsConst(m_timeouts)) {
-        timer->start();
+    m_lastActivity.start();
+    for (auto it = m_timeouts.begin(); it != m_timeouts.end(); ++it) {
+        *it = false;
     }
+    scheduleTimer();
 }
 
 void KWinIdleTimePoller::stopCatchingIdleEvents()
 {
-    for (QTimer *timer : qAsConst(m_timeouts)) {
-        timer->stop();
-    }
+    m_timer.stop();
 }
 
 void KWinIdleTimePoller::simulateUserActivity()
@@ -129,7 +170,10 @@ void KWinIdleTimePoller::simulateUserActivity()
 
 void KWinIdleTimePoller::removeTimeout(int nextTimeout)
 {
-    delete m_timeouts.take(nextTimeout);
+    m_timeouts.remove(nextTimeout);
+    if (m_timeouts.isEmpty()) {
+        m_timer.stop();
+    }
 }
 
 QList<int> KWinIdleTimePoller::timeouts() const
@@ -10,6 +10,7 @@
 #define POLLER_H
 
 #include <KIdleTime/private/abstractsystempoller.h>
+#include <QElapsedTimer>
 #include <QHash>
 #include <QTimer>
 
@@ -45,7 +46,12 @@ private Q_SLOTS:
 
 private:
     void processActivity();
-    QHash<int, QTimer *> m_timeouts;
+    void scheduleTimer();
+    void handleTimeout();
+    // Maps the timeouts to whether they have been reached since the last user activity
+    QHash<int, bool> m_timeouts;
+    QElapsedTimer m_lastActivity;
+    QTimer m_timer;
     bool m_idling = false;
 };
 
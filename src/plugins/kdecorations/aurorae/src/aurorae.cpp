@@ -105,6 +105,9 @@ void Helper::unref()
     }
 }
 
+// How long an inactive decoration that isn't hovered has to stay unchanged before its view is released.
+static const int s_viewReleaseDelay = 2000;
+
 static const QString s_defaultTheme = QStringLiteral("kwin4_decoration_qml_plastik");
 static const QString s_qmlPackageFolder = QStringLiteral(KWIN_NAME "/decorations/");
 /*
@@ -323,6 +326,15 @@ void Decoration::init()
         connect(m_view->contentItem(), &QQuickItem::widthChanged, m_item, updateSize);
         connect(m_view->contentItem(), &QQuickItem::heightChanged, m_item, updateSize);
         connect(m_view, &KWin::OffscreenQuickView::repaintNeeded, this, &Decoration::updateBuffer);
+
+        // Decorations that don't change are painted from the last buffer, their view gives
+        // up its framebuffer and scene graph until something in the decoration changes.
+        m_releaseTimer = new QTimer(this);
+        m_releaseTimer->setSingleShot(true);
+        m_releaseTimer->setInterval(s_viewReleaseDelay);
+        connect(m_releaseTimer, &QTimer::timeout, this, &Decoration::releaseView);
+        connect(m_view, &KWin::OffscreenQuickView::renderRequested, this, &Decoration::wakeView);
+        connect(m_view, &KWin::OffscreenQuickView::sceneChanged, this, &Decoration::wakeView);
     }
 
     m_supportsMask = m_item->property("supportsMask").toBool();
@@ -354,12 +366,14 @@ void Decoration::init()
     connect(decorationClient, &KDecoration2::DecoratedClient::shadedChanged, this, &Decoration::updateBorders);
     updateBorders();
     if (m_view) {
+        connect(decorationClient, &KDecoration2::DecoratedClient::activeChanged, this, &Decoration::wakeView);
         auto resizeWindow = [this] {
             QRect rect(QPoint(0, 0), size());
             if (m_padding && !clientPointer()->isMaximized()) {
                 rect = rect.adjusted(-m_padding->left(), -m_padding->top(), m_padding->right(), m_padding->bottom());
             }
             m_view->setGeometry(rect);
+            wakeView();
             updateBlur();
         };
         connect(this, &Decoration::bordersChanged, this, resizeWindow);
@@ -415,13 +429,12 @@ void Decoration::paint(QPainter *painter, const QRect &repaintRegion)
         return;
     }
 
-    const QImage image = m_view->bufferAsImage();
-    const qreal dpr = image.devicePixelRatioF();
+    const qreal dpr = m_buffer.devicePixelRatioF();
 
     QRect nativeContentRect = QRect(m_contentRect.topLeft() * dpr, m_contentRect.size() * dpr);
 
     painter->fillRect(rect(), Qt::transparent);
-    painter->drawImage(rect(), image, nativeContentRect);
+    painter->drawImage(rect(), m_buffer, nativeContentRect);
 }
 
 void Decoration::updateShadow()
@@ -440,7 +453,6 @@ void Decoration::updateShadow()
                 updateShadow = true;
             }
         }
-        const QImage m_buffer = m_view->bufferAsImage();
         const qreal dpr = m_buffer.devicePixelRatioF();
 
         QImage img(m_buffer.size() / m_buffer.devicePixelRatioF(), QImage::Format_ARGB32_Premultiplied);
@@ -481,7 +493,9 @@ void Decoration::updateShadow()
 
 void Decoration::hoverEnterEvent(QHoverEvent *event)
 {
+    m_hovered = true;
     if (m_view) {
+        wakeView();
         event->setAccepted(false);
         m_view->forwardMouseEvent(event);
     }
@@ -490,6 +504,7 @@ void Decoration::hoverEnterEvent(QHoverEvent *event)
 
 void Decoration::hoverLeaveEvent(QHoverEvent *event)
 {
+    m_hovered = false;
     if (m_view) {
         m_view->forwardMouseEvent(event);
     }
@@ -607,6 +622,10 @@ void Decoration::updateBuffer()
     if (buffer.isNull()) {
         return;
     }
+    m_buffer = buffer;
+    if (isStatic()) {
+        m_releaseTimer->start();
+    }
     m_contentRect = QRect(QPoint(0, 0), m_view->contentItem()->size().toSize());
     if (m_padding && (m_padding->left() > 0 || m_padding->top() > 0 || m_padding->right() > 0 || m_padding->bottom() > 0) && !clientPointer()->isMaximized()) {
         m_contentRect = m_contentRect.adjusted(m_padding->left(), m_padding->top(), -m_padding->right(), -m_padding->bottom());
@@ -616,6 +635,26 @@ void Decoration::updateBuffer()
     update();
 }
 
+bool Decoration::isStatic() const
+{
+    return !m_hovered && !clientPointer()->isActive();
+}
+
+void Decoration::wakeView()
+{
+    m_releaseTimer->stop();
+    if (!m_view->isVisible()) {
+        m_view->show();
+    }
+}
+
+void Decoration::releaseView()
+{
+    if (isStatic()) {
+        m_view->hide();
+    }
+}
+
 KDecoration2::DecoratedClient *Decoration::clientPointer() const
 {
     return client().toStrongRef().data();
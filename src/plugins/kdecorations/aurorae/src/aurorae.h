@@ -12,9 +12,11 @@
 #include <KDecoration2/DecorationThemeProvider>
 #include <KPluginMetaData>
 #include <QElapsedTimer>
+#include <QImage>
 #include <QVariant>
 
 class QQmlComponent;
+class QTimer;
 class QQmlContext;
 class QQmlEngine;
 class QQuickItem;
@@ -66,6 +68,9 @@ private:
     void setupBorders(QQuickItem *item);
     void updateBorders();
     void updateBuffer();
+    bool isStatic() const;
+    void wakeView();
+    void releaseView();
     void updateExtendedBorders();
 
     bool m_supportsMask{false};
@@ -80,6 +85,10 @@ private:
     QString m_themeName;
 
     KWin::OffscreenQuickView *m_view;
+    // The last rendered state of the view, kept while the view is released.
+    QImage m_buffer;
+    QTimer *m_releaseTimer = nullptr;
+    bool m_hovered = false;
 };
 
 class ThemeProvider : public KDecoration2::DecorationThemeProvider
@@ -12,8 +12,6 @@
 
 #include "internalwindow.h"
 
-#include <QPainter>
-
 namespace KWin
 {
 namespace QPA
@@ -42,26 +40,23 @@ void BackingStore::resize(const QSize &size, const QRegion &staticContents)
     const QPlatformWindow *platformWindow = static_cast<QPlatformWindow *>(window()->handle());
     const qreal devicePixelRatio = platformWindow->devicePixelRatio();
 
-    m_backBuffer = QImage(size * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    m_buffer = std::make_shared<QImage>(size * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    uchar *bits = m_buffer->bits();
+    const QSize bufferSize = m_buffer->size();
+    const int bytesPerLine = m_buffer->bytesPerLine();
+
+    m_backBuffer = QImage(bits, bufferSize.width(), bufferSize.height(), bytesPerLine, QImage::Format_ARGB32_Premultiplied);
     m_backBuffer.setDevicePixelRatio(devicePixelRatio);
 
-    m_frontBuffer = QImage(size * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    m_frontBuffer = QImage(
+        bits, bufferSize.width(), bufferSize.height(), bytesPerLine, QImage::Format_ARGB32_Premultiplied,
+        [](void *buffer) {
+            delete static_cast<std::shared_ptr<QImage> *>(buffer);
+        },
+        new std::shared_ptr<QImage>(m_buffer));
     m_frontBuffer.setDevicePixelRatio(devicePixelRatio);
 }
 
-static QRect scaledRect(const QRect &rect, qreal devicePixelRatio)
-{
-    return QRect(rect.topLeft() * devicePixelRatio, rect.size() * devicePixelRatio);
-}
-
-static void blitImage(const QImage &source, QImage &target, const QRegion &region)
-{
-    QPainter painter(&target);
-    for (const QRect &rect : region) {
-        painter.drawImage(rect, source, scaledRect(rect, source.devicePixelRatio()));
-    }
-}
-
 void BackingStore::flush(QWindow *window, const QRegion &region, const QPoint &offset)
 {
     Q_UNUSED(offset)
@@ -72,8 +67,6 @@ void BackingStore::flush(QWindow *window, const QRegion &region, const QPoint &o
         return;
     }
 
-    blitImage(m_backBuffer, m_frontBuffer, region);
-
     internalWindow->present(m_frontBuffer, region);
 }
 
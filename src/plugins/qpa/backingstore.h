@@ -14,6 +14,8 @@
 
 #include <qpa/qplatformbackingstore.h>
 
+#include <memory>
+
 namespace KWin
 {
 namespace QPA
@@ -30,7 +32,12 @@ public:
     void resize(const QSize &size, const QRegion &staticContents) override;
 
 private:
+    // The pixels are shared between the paint device and the image that is presented, so
+    // nothing gets copied on flush. The scene only reads the damaged parts of the buffer.
+    std::shared_ptr<QImage> m_buffer;
+    // wraps m_buffer without referencing it, so painting never detaches it
     QImage m_backBuffer;
+    // wraps m_buffer and keeps it alive for as long as the scene holds a copy of it
     QImage m_frontBuffer;
 };
 
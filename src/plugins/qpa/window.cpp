@@ -14,17 +14,89 @@
 
 #include "internalwindow.h"
 
+#include <kwingltexture.h>
 #include <logging.h>
 
+#include <QOpenGLContext>
 #include <QOpenGLFramebufferObject>
 #include <qpa/qwindowsysteminterface.h>
 
+#include <deque>
+
 namespace KWin
 {
 namespace QPA
 {
 static quint32 s_windowId = 0;
 
+// The scene holds on to the content FBO of an internal window until the next frame is
+// presented. Instead of deleting it then, it's kept for the next FBO of the same size.
+// FBOs can't be shared between contexts, so they are only reused by the context that
+// created them.
+struct PooledFramebuffer
+{
+    QPointer<QOpenGLContext> context;
+    QOpenGLFramebufferObject *fbo;
+};
+static std::deque<PooledFramebuffer> s_framebufferPool;
+static const size_t s_framebufferPoolSize = 4;
+
+// The FBOs have a color and a combined depth and stencil attachment
+static qint64 framebufferMemoryUsage(const QSize &size)
+{
+    return 2 * GLMemoryTracker::estimateSize(GL_RGBA8, size);
+}
+
+static QOpenGLFramebufferObject *createFramebuffer(const QSize &size)
+{
+    GLMemoryTracker::self()->allocate(GLMemoryTracker::Surface, framebufferMemoryUsage(size));
+    return new QOpenGLFramebufferObject(size.width(), size.height(), QOpenGLFramebufferObject::CombinedDepthStencil);
+}
+
+static void destroyFramebuffer(QOpenGLFramebufferObject *fbo)
+{
+    GLMemoryTracker::self()->release(GLMemoryTracker::Surface, framebufferMemoryUsage(fbo->size()));
+    delete fbo;
+}
+
+static void releaseFramebuffer(const QPointer<QOpenGLContext> &context, QOpenGLFramebufferObject *fbo)
+{
+    if (!context) {
+        destroyFramebuffer(fbo);
+        return;
+    }
+    s_framebufferPool.push_front(PooledFramebuffer{context, fbo});
+    if (s_framebufferPool.size() > s_framebufferPoolSize) {
+        destroyFramebuffer(s_framebufferPool.back().fbo);
+        s_framebufferPool.pop_back();
+    }
+}
+
+static QSharedPointer<QOpenGLFramebufferObject> acquireFramebuffer(const QSize &size)
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    QOpenGLFramebufferObject *fbo = nullptr;
+    for (auto it = s_framebufferPool.begin(); it != s_framebufferPool.end();) {
+        if (!it->context) {
+            // the GL resources died with the context
+            destroyFramebuffer(it->fbo);
+            it = s_framebufferPool.erase(it);
+        } else if (it->context == context && it->fbo->size() == size) {
+            fbo = it->fbo;
+            s_framebufferPool.erase(it);
+            break;
+        } else {
+            ++it;
+        }
+    }
+    if (!fbo) {
+        fbo = createFramebuffer(size);
+    }
+    return QSharedPointer<QOpenGLFramebufferObject>(fbo, [context = QPointer<QOpenGLContext>(context)](QOpenGLFramebufferObject *fbo) {
+        releaseFramebuffer(context, fbo);
+    });
+}
+
 Window::Window(QWindow *window)
     : QPlatformWindow(window)
     , m_eglDisplay(kwinApp()->platform()->sceneEglDisplay())
@@ -128,7 +200,7 @@ void Window::createFBO()
         return;
     }
     const QSize nativeSize = r.size() * m_scale;
-    m_contentFBO.reset(new QOpenGLFramebufferObject(nativeSize.width(), nativeSize.height(), QOpenGLFramebufferObject::CombinedDepthStencil));
+    m_contentFBO = acquireFramebuffer(nativeSize);
     if (!m_contentFBO->isValid()) {
         qCWarning(KWIN_QPA) << "Content FBO is not valid";
     }
@@ -44,12 +44,24 @@ void OutputScreenCastSource::render(QImage *image)
 
 void OutputScreenCastSource::render(GLFramebuffer *target)
 {
+    renderDamage(target, QRect(QPoint(), textureSize()));
+}
+
+void OutputScreenCastSource::renderDamage(GLFramebuffer *target, const QRegion &damage)
+{
+    if (damage.isEmpty()) {
+        return;
+    }
+
+    // The texture imports the buffer that the output has been presented with, so only
+    // the damaged parts need to be copied, the rest of the target is already up to date.
     const QSharedPointer<GLTexture> outputTexture = Compositor::self()->scene()->textureForOutput(m_output);
     if (!outputTexture) {
         return;
     }
 
     const QRect geometry(QPoint(), textureSize());
+    const bool fullRepaint = damage == QRegion(geometry);
 
     ShaderBinder shaderBinder(ShaderTrait::MapTexture);
     QMatrix4x4 projectionMatrix;
@@ -58,11 +70,22 @@ void OutputScreenCastSource::render(GLFramebuffer *target)
 
     GLFramebuffer::pushFramebuffer(target);
     outputTexture->bind();
-    outputTexture->render(geometry);
+    if (fullRepaint) {
+        outputTexture->render(geometry);
+    } else {
+        glEnable(GL_SCISSOR_TEST);
+        outputTexture->render(damage, geometry, true);
+        glDisable(GL_SCISSOR_TEST);
+    }
     outputTexture->unbind();
     GLFramebuffer::popFramebuffer();
 }
 
+bool OutputScreenCastSource::hasAccurateDamage() const
+{
+    return true;
+}
+
 std::chrono::nanoseconds OutputScreenCastSource::clock() const
 {
     return m_output->renderLoop()->lastPresentationTimestamp();
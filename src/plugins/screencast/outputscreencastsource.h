@@ -29,6 +29,9 @@ public:
     void render(QImage *image) override;
     std::chrono::nanoseconds clock() const override;
 
+    void renderDamage(GLFramebuffer *target, const QRegion &damage) override;
+    bool hasAccurateDamage() const override;
+
 private:
     QPointer<Output> m_output;
 };
@@ -0,0 +1,130 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "pixelbufferreadback.h"
+
+#include "kwinglplatform.h"
+#include "kwingltexture.h"
+#include "kwinglutils.h"
+
+#include <cstring>
+#include <utility>
+
+namespace KWin
+{
+
+PixelBufferReadback::PixelBufferReadback(const QSize &size, bool hasAlphaChannel)
+    : m_size(size)
+    , m_hasAlphaChannel(hasAlphaChannel)
+    // GL_PACK_ALIGNMENT is 4 by default, which matches the stride of memfd buffers.
+    , m_stride(((size.width() * (hasAlphaChannel ? 4 : 3)) + 3) & ~3)
+    , m_texture(new GLTexture(GL_RGBA8, size))
+    , m_framebuffer(new GLFramebuffer(m_texture.data()))
+{
+    for (Slot &slot : m_slots) {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, sizeInBytes(), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+PixelBufferReadback::~PixelBufferReadback()
+{
+    for (const Slot &slot : m_slots) {
+        glDeleteBuffers(1, &slot.buffer);
+    }
+}
+
+bool PixelBufferReadback::isSupported()
+{
+    if (hasGLVersion(3, 0)) {
+        return true;
+    }
+    return !GLPlatform::instance()->isGLES() && (hasGLExtension(QByteArrayLiteral("GL_ARB_pixel_buffer_object")) && hasGLExtension(QByteArrayLiteral("GL_ARB_map_buffer_range")));
+}
+
+bool PixelBufferReadback::isValid() const
+{
+    return m_framebuffer->valid();
+}
+
+QSize PixelBufferReadback::size() const
+{
+    return m_size;
+}
+
+bool PixelBufferReadback::hasAlphaChannel() const
+{
+    return m_hasAlphaChannel;
+}
+
+int PixelBufferReadback::stride() const
+{
+    return m_stride;
+}
+
+int PixelBufferReadback::sizeInBytes() const
+{
+    return m_stride * m_size.height();
+}
+
+GLFramebuffer *PixelBufferReadback::framebuffer() const
+{
+    return m_framebuffer.data();
+}
+
+void PixelBufferReadback::schedule(const Frame &frame)
+{
+    if (m_count == s_slotCount) {
+        take(nullptr);
+    }
+
+    Slot &slot = m_slots[(m_first + m_count) % s_slotCount];
+    slot.frame = frame;
+    m_count++;
+
+    GLFramebuffer::pushFramebuffer(m_framebuffer.data());
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glReadPixels(0, 0, m_size.width(), m_size.height(), m_hasAlphaChannel ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    GLFramebuffer::popFramebuffer();
+
+    // Make sure the transfer starts now rather than when the buffer is mapped.
+    glFlush();
+}
+
+int PixelBufferReadback::pendingCount() const
+{
+    return m_count;
+}
+
+PixelBufferReadback::Frame PixelBufferReadback::take(void *data)
+{
+    Q_ASSERT(m_count > 0);
+    Slot &slot = m_slots[m_first];
+    m_first = (m_first + 1) % s_slotCount;
+    m_count--;
+
+    Frame frame = std::exchange(slot.frame, Frame());
+    if (!data) {
+        m_droppedDamage += frame.damage;
+        return frame;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeInBytes(), GL_MAP_READ_BIT)) {
+        memcpy(data, pixels, sizeInBytes());
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    frame.damage += std::exchange(m_droppedDamage, QRegion());
+    return frame;
+}
+
+} // namespace KWin
@@ -0,0 +1,99 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QRegion>
+#include <QScopedPointer>
+#include <QSize>
+
+#include <array>
+#include <chrono>
+#include <epoxy/gl.h>
+
+namespace KWin
+{
+
+class GLFramebuffer;
+class GLTexture;
+
+/**
+ * The PixelBufferReadback class copies frames from the GPU to system memory without stalling
+ * the compositor. The frame is rendered into framebuffer(), the transfer is started with
+ * schedule() and the pixels are fetched with take() once the next frame has been scheduled,
+ * by which point the GPU has normally finished the transfer.
+ */
+class PixelBufferReadback
+{
+public:
+    struct Frame
+    {
+        std::chrono::nanoseconds timestamp = std::chrono::nanoseconds::zero();
+        QRegion damage;
+    };
+
+    PixelBufferReadback(const QSize &size, bool hasAlphaChannel);
+    ~PixelBufferReadback();
+
+    /**
+     * Returns @c true if the OpenGL context supports pixel buffer objects.
+     */
+    static bool isSupported();
+
+    bool isValid() const;
+    QSize size() const;
+    bool hasAlphaChannel() const;
+    int stride() const;
+    int sizeInBytes() const;
+
+    /**
+     * Returns the framebuffer that the frames have to be rendered into. Its contents are
+     * preserved between frames.
+     */
+    GLFramebuffer *framebuffer() const;
+
+    /**
+     * Starts transferring the current contents of the framebuffer. If all pixel buffers are
+     * busy, the oldest scheduled frame is dropped.
+     */
+    void schedule(const Frame &frame);
+
+    /**
+     * Returns the number of frames that have been scheduled but not taken yet.
+     */
+    int pendingCount() const;
+
+    /**
+     * Copies the pixels of the oldest scheduled frame to @a data, which must be at least
+     * sizeInBytes() large, and returns the frame. If @a data is @c nullptr, the frame is dropped
+     * and its damage is carried over to the next frame that is taken.
+     */
+    Frame take(void *data);
+
+private:
+    struct Slot
+    {
+        GLuint buffer = 0;
+        Frame frame;
+    };
+
+    static constexpr int s_slotCount = 3;
+
+    QSize m_size;
+    bool m_hasAlphaChannel;
+    int m_stride;
+    QScopedPointer<GLTexture> m_texture;
+    QScopedPointer<GLFramebuffer> m_framebuffer;
+    std::array<Slot, s_slotCount> m_slots;
+    int m_first = 0;
+    int m_count = 0;
+    QRegion m_droppedDamage;
+
+    Q_DISABLE_COPY(PixelBufferReadback)
+};
+
+} // namespace KWin
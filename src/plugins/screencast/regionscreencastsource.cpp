@@ -38,34 +38,54 @@ bool RegionScreenCastSource::hasAlphaChannel() const
     return true;
 }
 
-void RegionScreenCastSource::updateOutput(Output *output)
+QRegion RegionScreenCastSource::mapToTexture(const QRegion &region) const
+{
+    QRegion mapped;
+    for (const QRect &rect : region) {
+        const QRectF local = QRectF(rect.translated(-m_region.topLeft()));
+        mapped += QRectF(local.topLeft() * m_scale, local.size() * m_scale).toAlignedRect();
+    }
+    return mapped;
+}
+
+QRegion RegionScreenCastSource::updateOutput(Output *output, const QRegion &damage)
 {
     m_last = output->renderLoop()->lastPresentationTimestamp();
 
+    // Only the parts of the region that the output has repainted need to be copied, the
+    // rest of the rendered texture still has the contents of the previous frames.
+    const QRegion streamDamage = damage.intersected(m_region).intersected(output->geometry());
+    if (streamDamage.isEmpty()) {
+        return QRegion();
+    }
+    const QRegion textureDamage = mapToTexture(streamDamage);
+
     if (!m_renderedTexture.isNull()) {
         const QSharedPointer<GLTexture> outputTexture = Compositor::self()->scene()->textureForOutput(output);
-        const auto outputGeometry = output->geometry();
-        if (!outputTexture || !m_region.intersects(output->geometry())) {
-            return;
+        if (!outputTexture) {
+            return QRegion();
         }
 
         GLFramebuffer::pushFramebuffer(m_target.data());
-        const QRect geometry({0, 0}, m_target->size());
 
         ShaderBinder shaderBinder(ShaderTrait::MapTexture);
         QMatrix4x4 projectionMatrix;
         projectionMatrix.ortho(m_region);
 
-        const QPoint pos = outputGeometry.topLeft();
-        projectionMatrix.translate(pos.x(), pos.y());
+        const QRect outputGeometry = output->geometry();
+        projectionMatrix.translate(outputGeometry.x(), outputGeometry.y());
 
         shaderBinder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix);
 
+        glEnable(GL_SCISSOR_TEST);
         outputTexture->bind();
-        outputTexture->render(output->geometry());
+        outputTexture->render(textureDamage, outputGeometry, true);
         outputTexture->unbind();
+        glDisable(GL_SCISSOR_TEST);
         GLFramebuffer::popFramebuffer();
     }
+
+    return textureDamage;
 }
 
 std::chrono::nanoseconds RegionScreenCastSource::clock() const
@@ -74,6 +94,11 @@ std::chrono::nanoseconds RegionScreenCastSource::clock() const
 }
 
 void RegionScreenCastSource::render(GLFramebuffer *target)
+{
+    renderDamage(target, QRect(QPoint(), textureSize()));
+}
+
+void RegionScreenCastSource::renderDamage(GLFramebuffer *target, const QRegion &damage)
 {
     if (!m_renderedTexture) {
         m_renderedTexture.reset(new GLTexture(hasAlphaChannel() ? GL_RGBA8 : GL_RGB8, textureSize()));
@@ -81,7 +106,7 @@ void RegionScreenCastSource::render(GLFramebuffer *target)
         const auto allOutputs = kwinApp()->platform()->enabledOutputs();
         for (auto output : allOutputs) {
             if (output->geometry().intersects(m_region)) {
-                updateOutput(output);
+                updateOutput(output, output->geometry());
             }
         }
     }
@@ -94,14 +119,21 @@ void RegionScreenCastSource::render(GLFramebuffer *target)
     projectionMatrix.ortho(r);
     shader->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix);
 
+    glEnable(GL_SCISSOR_TEST);
     m_renderedTexture->bind();
-    m_renderedTexture->render(r);
+    m_renderedTexture->render(damage, r, true);
     m_renderedTexture->unbind();
+    glDisable(GL_SCISSOR_TEST);
 
     ShaderManager::instance()->popShader();
     GLFramebuffer::popFramebuffer();
 }
 
+bool RegionScreenCastSource::hasAccurateDamage() const
+{
+    return true;
+}
+
 void RegionScreenCastSource::render(QImage *image)
 {
     GLTexture offscreenTexture(hasAlphaChannel() ? GL_RGBA8 : GL_RGB8, textureSize());
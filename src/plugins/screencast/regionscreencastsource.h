@@ -30,13 +30,22 @@ public:
     void render(QImage *image) override;
     std::chrono::nanoseconds clock() const override;
 
+    void renderDamage(GLFramebuffer *target, const QRegion &damage) override;
+    bool hasAccurateDamage() const override;
+
     QRect region() const
     {
         return m_region;
     }
-    void updateOutput(Output *output);
+    /**
+     * Copies the parts of the @a output texture that are in @a damage, given in global
+     * coordinates, and returns the region of the stream that has been updated.
+     */
+    QRegion updateOutput(Output *output, const QRegion &damage);
 
 private:
+    QRegion mapToTexture(const QRegion &region) const;
+
     const QRect m_region;
     const qreal m_scale;
     QScopedPointer<GLFramebuffer> m_target;
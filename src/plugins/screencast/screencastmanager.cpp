@@ -44,7 +44,14 @@ class WindowStream : public ScreenCastStream
 {
 public:
     WindowStream(Window *window, QObject *parent)
-        : ScreenCastStream(new WindowScreenCastSource(window), parent)
+        : WindowStream(window, new WindowScreenCastSource(window), parent)
+    {
+    }
+
+private:
+    WindowStream(Window *window, WindowScreenCastSource *source, QObject *parent)
+        : ScreenCastStream(source, parent)
+        , m_windowSource(source)
         , m_window(window)
     {
         setObjectName(window->desktopFileName());
@@ -52,13 +59,12 @@ public:
         connect(this, &ScreenCastStream::stopStreaming, this, &WindowStream::stopFeeding);
     }
 
-private:
     void startFeeding()
     {
         connect(Compositor::self()->scene(), &Scene::frameRendered, this, &WindowStream::bufferToStream);
 
         connect(m_window, &Window::damaged, this, &WindowStream::includeDamage);
-        m_damagedRegion = m_window->visibleGeometry();
+        m_damagedRegion = QRect(QPoint(), m_windowSource->textureSize());
         m_window->output()->renderLoop()->scheduleRepaint();
     }
 
@@ -70,7 +76,7 @@ private:
     void includeDamage(Window *window, const QRegion &damage)
     {
         Q_ASSERT(m_window == window);
-        m_damagedRegion |= damage;
+        m_damagedRegion |= m_windowSource->mapDamage(damage);
     }
 
     void bufferToStream()
@@ -82,6 +88,7 @@ private:
     }
 
     QRegion m_damagedRegion;
+    WindowScreenCastSource *m_windowSource;
     Window *m_window;
 };
 
@@ -117,6 +124,19 @@ void ScreencastManager::streamWaylandOutput(KWaylandServer::ScreencastStreamV1In
     streamOutput(waylandStream, waylandServer()->findOutput(output), mode);
 }
 
+static QRegion scaleRegion(const QRegion &region, qreal scale)
+{
+    if (scale == 1) {
+        return region;
+    }
+
+    QRegion scaled;
+    for (const QRect &rect : region) {
+        scaled += QRectF(rect.x() * scale, rect.y() * scale, rect.width() * scale, rect.height() * scale).toAlignedRect();
+    }
+    return scaled;
+}
+
 void ScreencastManager::streamOutput(KWaylandServer::ScreencastStreamV1Interface *waylandStream,
                                      Output *streamOutput,
                                      KWaylandServer::ScreencastV1Interface::CursorMode mode)
@@ -129,9 +149,10 @@ void ScreencastManager::streamOutput(KWaylandServer::ScreencastStreamV1Interface
     auto stream = new ScreenCastStream(new OutputScreenCastSource(streamOutput), this);
     stream->setObjectName(streamOutput->name());
     stream->setCursorMode(mode, streamOutput->scale(), streamOutput->geometry());
-    auto bufferToStream = [stream](const QRegion &damagedRegion) {
+    auto bufferToStream = [streamOutput, stream](const QRegion &damagedRegion) {
         if (!damagedRegion.isEmpty()) {
-            stream->recordFrame(damagedRegion);
+            // The output damage is in logical coordinates, the stream works with device pixels.
+            stream->recordFrame(scaleRegion(damagedRegion, streamOutput->scale()));
         }
     };
     connect(stream, &ScreenCastStream::startStreaming, waylandStream, [streamOutput, stream, bufferToStream] {
@@ -169,10 +190,11 @@ void ScreencastManager::streamRegion(KWaylandServer::ScreencastStreamV1Interface
                         return;
                     }
 
-                    const QRect streamRegion = source->region();
                     const QRegion region = output->pixelSize() != output->modeSize() ? output->geometry() : damagedRegion;
-                    source->updateOutput(output);
-                    stream->recordFrame(region.translated(-streamRegion.topLeft()).intersected(streamRegion));
+                    const QRegion streamDamage = source->updateOutput(output, region);
+                    if (!streamDamage.isEmpty()) {
+                        stream->recordFrame(streamDamage);
+                    }
                 };
                 connect(output, &Output::outputChange, stream, bufferToStream);
             }
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <QObject>
+#include <QRegion>
 
 namespace KWin
 {
@@ -27,6 +28,18 @@ public:
     virtual void render(QImage *image) = 0;
     virtual std::chrono::nanoseconds clock() const = 0;
 
+    /**
+     * Updates the @a damage part of the previous contents of @a target. The default
+     * implementation renders the whole source.
+     */
+    virtual void renderDamage(GLFramebuffer *target, const QRegion &damage);
+
+    /**
+     * Returns @c true if the damage passed to ScreenCastStream::recordFrame() is exact, i.e.
+     * the parts of the frame outside the damage are guaranteed to be unchanged.
+     */
+    virtual bool hasAccurateDamage() const;
+
 Q_SIGNALS:
     void closed();
 };
@@ -18,8 +18,10 @@
 #include "kwinscreencast_logging.h"
 #include "main.h"
 #include "pipewirecore.h"
+#include "pixelbufferreadback.h"
 #include "platform.h"
 #include "scene.h"
+#include "scenes/opengl/scene_opengl.h"
 #include "screencastsource.h"
 #include "utils/common.h"
 
@@ -154,6 +156,7 @@ void ScreenCastStream::onStreamAddBuffer(void *data, pw_buffer *buffer)
         spa_data->maxsize = dmabufAttribs.pitch[0] * stream->m_resolution.height();
 
         stream->m_dmabufDataForPwBuffer.insert(buffer, dmabuf);
+        stream->m_dmabufDamageForPwBuffer.insert(buffer, QRect(QPoint(), stream->m_resolution));
 #ifdef F_SEAL_SEAL // Disable memfd on systems that don't have it, like BSD < 12
     } else {
         if (!(spa_data[0].type & (1 << SPA_DATA_MemFd))) {
@@ -201,6 +204,7 @@ void ScreenCastStream::onStreamRemoveBuffer(void *data, pw_buffer *buffer)
 {
     ScreenCastStream *stream = static_cast<ScreenCastStream *>(data);
     stream->m_dmabufDataForPwBuffer.remove(buffer);
+    stream->m_dmabufDamageForPwBuffer.remove(buffer);
 
     struct spa_buffer *spa_buffer = buffer->buffer;
     struct spa_data *spa_data = spa_buffer->datas;
@@ -222,11 +226,51 @@ ScreenCastStream::ScreenCastStream(ScreenCastSource *source, QObject *parent)
     pwStreamEvents.remove_buffer = &ScreenCastStream::onStreamRemoveBuffer;
     pwStreamEvents.state_changed = &ScreenCastStream::onStreamStateChanged;
     pwStreamEvents.param_changed = &ScreenCastStream::onStreamParamChanged;
+
+    // Hands over the last read back frame if no other frame is recorded within 40ms, which is
+    // one frame at the 25fps that the stream advertises as its maximum frame rate.
+    m_readbackTimer = new QTimer(this);
+    m_readbackTimer->setSingleShot(true);
+    m_readbackTimer->setInterval(40);
+    connect(m_readbackTimer, &QTimer::timeout, this, &ScreenCastStream::flushReadback);
+
+    m_pacingTimer = new QTimer(this);
+    m_pacingTimer->setSingleShot(true);
+    m_pacingTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_pacingTimer, &QTimer::timeout, this, [this] {
+        if (auto scene = Compositor::self()->scene()) {
+            scene->makeOpenGLContextCurrent();
+        }
+        recordFrame(QRegion());
+    });
+
+    connect(Compositor::self(), &Compositor::sleepingChanged, this, &ScreenCastStream::setPaused);
+    m_paused = Compositor::self()->isSleeping();
+}
+
+void ScreenCastStream::setPaused(bool paused)
+{
+    if (m_paused == paused) {
+        return;
+    }
+    if (paused) {
+        // Hand out the frames that are already in flight, the consumer keeps showing the last one.
+        flushReadback();
+        m_readbackTimer->stop();
+        m_pacingTimer->stop();
+    }
+    m_paused = paused;
 }
 
 ScreenCastStream::~ScreenCastStream()
 {
     m_stopped = true;
+    if (m_readback) {
+        if (auto scene = Compositor::self()->scene()) {
+            scene->makeOpenGLContextCurrent();
+        }
+        m_readback.reset();
+    }
     if (pwStream) {
         pw_stream_destroy(pwStream);
     }
@@ -260,6 +304,14 @@ uint ScreenCastStream::framerate()
     return 0;
 }
 
+std::chrono::nanoseconds ScreenCastStream::frameInterval() const
+{
+    if (!pwStream || videoFormat.max_framerate.num == 0) {
+        return std::chrono::nanoseconds::zero();
+    }
+    return std::chrono::nanoseconds(std::chrono::seconds(videoFormat.max_framerate.denom)) / videoFormat.max_framerate.num;
+}
+
 uint ScreenCastStream::nodeId()
 {
     return pwNodeId;
@@ -337,6 +389,10 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
 {
     Q_ASSERT(!m_stopped);
 
+    if (m_paused) {
+        return;
+    }
+
     if (m_pendingBuffer) {
         qCWarning(KWIN_SCREENCAST) << "Dropping a screencast frame because the compositor is slow";
         return;
@@ -357,6 +413,33 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
         return;
     }
 
+    // The output may repaint a lot more often than the consumer wants frames. Skip frames
+    // before anything is rendered and hand out the damage with the next frame that is sent.
+    const std::chrono::nanoseconds interval = frameInterval();
+    if (interval != std::chrono::nanoseconds::zero()) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now < m_nextFrameTime) {
+            m_skippedDamage += damagedRegion;
+            if (!m_pacingTimer->isActive()) {
+                m_pacingTimer->start(std::chrono::ceil<std::chrono::milliseconds>(m_nextFrameTime - now));
+            }
+            return;
+        }
+        // Keep an even cadence unless the stream has been idle for longer than a frame.
+        m_nextFrameTime += interval;
+        if (m_nextFrameTime <= now) {
+            m_nextFrameTime = now + interval;
+        }
+    }
+    m_pacingTimer->stop();
+    const QRegion damage = damagedRegion | m_skippedDamage;
+    m_skippedDamage = QRegion();
+
+    if (!m_hasModifier && PixelBufferReadback::isSupported()) {
+        scheduleReadback(damage);
+        return;
+    }
+
     struct pw_buffer *buffer = pw_stream_dequeue_buffer(pwStream);
 
     if (!buffer) {
@@ -374,6 +457,12 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
     }
 
     const auto size = m_source->textureSize();
+    const QRect frameRect(QPoint(), size);
+    QRegion frameDamage = m_source->hasAccurateDamage() ? damage.intersected(frameRect) : QRegion(frameRect);
+    for (QRegion &bufferDamage : m_dmabufDamageForPwBuffer) {
+        bufferDamage += frameDamage;
+    }
+
     spa_data->chunk->offset = 0;
     if (data || spa_data[0].type == SPA_DATA_MemFd) {
         const bool hasAlpha = m_source->hasAlphaChannel();
@@ -393,49 +482,148 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
         m_source->render(&dest);
 
         auto cursor = Cursors::self()->currentCursor();
-        if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && m_cursor.viewport.contains(cursor->pos())) {
-            QPainter painter(&dest);
-            const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
-            painter.drawImage(QRect{position, cursor->image().size()}, cursor->image());
+        if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded) {
+            frameDamage += m_cursor.lastRect;
+            m_cursor.lastRect = QRect();
+            if (m_cursor.viewport.contains(cursor->pos())) {
+                QPainter painter(&dest);
+                const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
+                const QRect cursorRect(position, cursor->image().size());
+                painter.drawImage(cursorRect, cursor->image());
+                frameDamage += cursorRect;
+                m_cursor.lastRect = cursorRect;
+            }
         }
     } else {
         auto &buf = m_dmabufDataForPwBuffer[buffer];
+        QRegion &bufferDamage = m_dmabufDamageForPwBuffer[buffer];
 
         spa_data->chunk->stride = buf->attributes().pitch[0];
         spa_data->chunk->size = spa_data->maxsize;
 
-        m_source->render(buf->framebuffer());
+        m_source->renderDamage(buf->framebuffer(), bufferDamage);
+        bufferDamage = QRegion();
 
         auto cursor = Cursors::self()->currentCursor();
-        if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && m_cursor.viewport.contains(cursor->pos())) {
-            GLFramebuffer::pushFramebuffer(buf->framebuffer());
+        if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded) {
+            frameDamage += m_cursor.lastRect;
+            m_cursor.lastRect = QRect();
+            if (m_cursor.viewport.contains(cursor->pos()) && !cursor->image().isNull()) {
+                GLFramebuffer::pushFramebuffer(buf->framebuffer());
+
+                QRect r(QPoint(), size);
+                auto shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
+
+                QMatrix4x4 mvp;
+                mvp.ortho(r);
+                shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+
+                // The texture is shared with the cursor layers of the outputs.
+                auto scene = static_cast<SceneOpenGL *>(Compositor::self()->scene());
+                m_cursor.texture = scene->cursorTextureCache()->texture(cursor->image());
+
+                m_cursor.texture->setYInverted(false);
+                m_cursor.texture->bind();
+                const auto cursorRect = cursorGeometry(cursor);
+                mvp.translate(cursorRect.left(), r.height() - cursorRect.top() - cursor->image().height());
+                shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                m_cursor.texture->render(cursorRect);
+                glDisable(GL_BLEND);
+                m_cursor.texture->unbind();
+                m_cursor.texture->setYInverted(true);
+                m_cursor.lastRect = cursorRect;
+
+                // The cursor has to be painted over with the source the next time this buffer is used.
+                bufferDamage = cursorRect;
+                frameDamage += cursorRect;
+
+                ShaderManager::instance()->popShader();
+                GLFramebuffer::popFramebuffer();
+            }
+        }
+    }
 
-            QRect r(QPoint(), size);
-            auto shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
+    if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Metadata) {
+        sendCursorData(Cursors::self()->currentCursor(),
+                       (spa_meta_cursor *)spa_buffer_find_meta_data(spa_buffer, SPA_META_Cursor, sizeof(spa_meta_cursor)));
+    }
 
-            QMatrix4x4 mvp;
-            mvp.ortho(r);
-            shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+    addDamage(spa_buffer, frameDamage);
+    addHeader(spa_buffer, m_source->clock());
+    tryEnqueue(buffer);
+}
 
-            if (!m_cursor.texture || m_cursor.lastKey != cursor->image().cacheKey()) {
-                m_cursor.texture.reset(new GLTexture(cursor->image()));
-            }
+void ScreenCastStream::scheduleReadback(const QRegion &damagedRegion)
+{
+    const QSize size = m_source->textureSize();
+    const QRect frameRect(QPoint(), size);
+    if (!m_readback || m_readback->size() != size || m_readback->hasAlphaChannel() != m_source->hasAlphaChannel()) {
+        m_readback.reset(new PixelBufferReadback(size, m_source->hasAlphaChannel()));
+        m_readbackDamage = frameRect;
+    }
+    if (!m_readback->isValid()) {
+        qCWarning(KWIN_SCREENCAST) << "Failed to record frame: could not create a readback framebuffer";
+        m_readback.reset();
+        return;
+    }
 
-            m_cursor.texture->setYInverted(false);
-            m_cursor.texture->bind();
-            const auto cursorRect = cursorGeometry(cursor);
-            mvp.translate(cursorRect.left(), r.height() - cursorRect.top() - cursor->image().height());
-            shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
-
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            m_cursor.texture->render(cursorRect);
-            glDisable(GL_BLEND);
-            m_cursor.texture->unbind();
-            m_cursor.lastRect = cursorRect;
+    const QRegion frameDamage = m_source->hasAccurateDamage() ? damagedRegion.intersected(frameRect) : QRegion(frameRect);
+    m_readbackDamage += frameDamage;
+    m_source->renderDamage(m_readback->framebuffer(), m_readbackDamage);
+    m_readbackDamage = QRegion();
+
+    m_readback->schedule({m_source->clock(), frameDamage});
+
+    // The previous frames have most likely reached system memory by now, this frame is
+    // handed over either with the next one or when no more frames come in.
+    while (m_readback->pendingCount() > 1 && enqueueReadback()) {
+    }
+    m_readbackTimer->start();
+}
+
+bool ScreenCastStream::enqueueReadback()
+{
+    struct pw_buffer *buffer = pw_stream_dequeue_buffer(pwStream);
+    if (!buffer) {
+        return false;
+    }
 
-            ShaderManager::instance()->popShader();
-            GLFramebuffer::popFramebuffer();
+    struct spa_buffer *spa_buffer = buffer->buffer;
+    struct spa_data *spa_data = spa_buffer->datas;
+
+    uint8_t *data = (uint8_t *)spa_data->data;
+    if (!data || spa_data->maxsize < uint32_t(m_readback->sizeInBytes())) {
+        qCWarning(KWIN_SCREENCAST) << "Failed to record frame: invalid buffer data";
+        m_readback->take(nullptr);
+        pw_stream_queue_buffer(pwStream, buffer);
+        return true;
+    }
+
+    const PixelBufferReadback::Frame frame = m_readback->take(data);
+    QRegion frameDamage = frame.damage;
+
+    spa_data->chunk->offset = 0;
+    spa_data->chunk->size = m_readback->sizeInBytes();
+    spa_data->chunk->stride = m_readback->stride();
+
+    if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded) {
+        frameDamage += m_cursor.lastRect;
+        m_cursor.lastRect = QRect();
+
+        auto cursor = Cursors::self()->currentCursor();
+        if (m_cursor.viewport.contains(cursor->pos())) {
+            const QSize size = m_readback->size();
+            QImage dest(data, size.width(), size.height(), m_readback->stride(),
+                        m_readback->hasAlphaChannel() ? QImage::Format_RGBA8888_Premultiplied : QImage::Format_RGB888);
+            QPainter painter(&dest);
+            const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
+            const QRect cursorRect(position, cursor->image().size());
+            painter.drawImage(cursorRect, cursor->image());
+            frameDamage += cursorRect;
+            m_cursor.lastRect = cursorRect;
         }
     }
 
@@ -444,12 +632,34 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
                        (spa_meta_cursor *)spa_buffer_find_meta_data(spa_buffer, SPA_META_Cursor, sizeof(spa_meta_cursor)));
     }
 
-    addDamage(spa_buffer, damagedRegion | QRect({0, 0}, size));
-    addHeader(spa_buffer);
-    tryEnqueue(buffer);
+    addDamage(spa_buffer, frameDamage);
+    addHeader(spa_buffer, frame.timestamp);
+
+    // The pixels have already been copied on the CPU, there is nothing to wait for.
+    pw_stream_queue_buffer(pwStream, buffer);
+    return true;
+}
+
+void ScreenCastStream::flushReadback()
+{
+    if (!m_readback || m_readback->pendingCount() == 0) {
+        return;
+    }
+    if (pw_stream_get_state(pwStream, nullptr) != PW_STREAM_STATE_STREAMING) {
+        return;
+    }
+
+    if (auto scene = Compositor::self()->scene()) {
+        scene->makeOpenGLContextCurrent();
+    }
+    while (m_readback->pendingCount() > 0 && enqueueReadback()) {
+    }
+    if (m_readback->pendingCount() > 0) {
+        m_readbackTimer->start();
+    }
 }
 
-void ScreenCastStream::addHeader(spa_buffer *spaBuffer)
+void ScreenCastStream::addHeader(spa_buffer *spaBuffer, std::chrono::nanoseconds timestamp)
 {
     spa_meta_header *spaHeader = (spa_meta_header *)spa_buffer_find_meta_data(spaBuffer, SPA_META_Header, sizeof(spaHeader));
     if (spaHeader) {
@@ -457,7 +667,6 @@ void ScreenCastStream::addHeader(spa_buffer *spaBuffer)
         spaHeader->dts_offset = 0;
         spaHeader->seq = m_sequential++;
 
-        const auto timestamp = m_source->clock();
         if (!m_start) {
             m_start = timestamp;
         }
@@ -496,6 +705,10 @@ void ScreenCastStream::recordCursor()
 {
     Q_ASSERT(!m_stopped);
 
+    if (m_paused) {
+        return;
+    }
+
     if (m_pendingBuffer) {
         qCWarning(KWIN_SCREENCAST) << "Dropping a screencast cursor update because the compositor is slow";
         return;
@@ -524,7 +737,7 @@ void ScreenCastStream::recordCursor()
 
     sendCursorData(Cursors::self()->currentCursor(),
                    (spa_meta_cursor *)spa_buffer_find_meta_data(spa_buffer, SPA_META_Cursor, sizeof(spa_meta_cursor)));
-    addHeader(spa_buffer);
+    addHeader(spa_buffer, m_source->clock());
     addDamage(spa_buffer, {});
     enqueue();
 }
@@ -15,10 +15,13 @@
 
 #include <QHash>
 #include <QObject>
+#include <QRegion>
 #include <QSharedPointer>
 #include <QSize>
 #include <QSocketNotifier>
+#include <QTimer>
 #include <chrono>
+#include <memory>
 #include <optional>
 
 #include <pipewire/pipewire.h>
@@ -34,6 +37,7 @@ class DmaBufTexture;
 class EGLNativeFence;
 class GLTexture;
 class PipeWireCore;
+class PixelBufferReadback;
 class ScreenCastSource;
 
 class KWIN_EXPORT ScreenCastStream : public QObject
@@ -61,6 +65,12 @@ public:
 
     void setCursorMode(KWaylandServer::ScreencastV1Interface::CursorMode mode, qreal scale, const QRect &viewport);
 
+    /**
+     * Stops recording frames while all outputs are off. The stream stays connected, its
+     * consumers simply don't receive new buffers until the stream is resumed.
+     */
+    void setPaused(bool paused);
+
 public Q_SLOTS:
     void recordCursor();
 
@@ -79,11 +89,15 @@ private:
     void updateParams();
     void coreFailed(const QString &errorMessage);
     void sendCursorData(Cursor *cursor, spa_meta_cursor *spa_cursor);
-    void addHeader(spa_buffer *spaBuffer);
+    void addHeader(spa_buffer *spaBuffer, std::chrono::nanoseconds timestamp);
     void addDamage(spa_buffer *spaBuffer, const QRegion &damagedRegion);
     void newStreamParams();
     void tryEnqueue(pw_buffer *buffer);
     void enqueue();
+    void scheduleReadback(const QRegion &damagedRegion);
+    std::chrono::nanoseconds frameInterval() const;
+    bool enqueueReadback();
+    void flushReadback();
     spa_pod *buildFormat(struct spa_pod_builder *b, enum spa_video_format format, struct spa_rectangle *resolution,
                          struct spa_fraction *defaultFramerate, struct spa_fraction *minFramerate, struct spa_fraction *maxFramerate,
                          uint64_t *modifiers, int modifier_count);
@@ -98,6 +112,7 @@ private:
 
     QSize m_resolution;
     bool m_stopped = false;
+    bool m_paused = false;
 
     spa_video_info_raw videoFormat;
     bool m_hasModifier = false;
@@ -111,16 +126,28 @@ private:
         QRect viewport;
         qint64 lastKey = 0;
         QRect lastRect;
-        QScopedPointer<GLTexture> texture;
+        std::shared_ptr<GLTexture> texture;
         bool visible = false;
     } m_cursor;
     QRect cursorGeometry(Cursor *cursor) const;
 
     QHash<struct pw_buffer *, QSharedPointer<DmaBufTexture>> m_dmabufDataForPwBuffer;
+    // The parts of each dmabuf that are out of date, dmabufs keep their contents between frames.
+    QHash<struct pw_buffer *, QRegion> m_dmabufDamageForPwBuffer;
 
     pw_buffer *m_pendingBuffer = nullptr;
     QSocketNotifier *m_pendingNotifier = nullptr;
     EGLNativeFence *m_pendingFence = nullptr;
+    // Memfd buffers are filled asynchronously, when the next frame is recorded or the readback timer fires.
+    QScopedPointer<PixelBufferReadback> m_readback;
+    QRegion m_readbackDamage;
+    QTimer *m_readbackTimer = nullptr;
+
+    // Frames are paced to the maximum frame rate negotiated with the consumer.
+    QTimer *m_pacingTimer = nullptr;
+    std::chrono::steady_clock::time_point m_nextFrameTime;
+    QRegion m_skippedDamage;
+
     std::optional<std::chrono::nanoseconds> m_start;
     quint64 m_sequential = 0;
 };
@@ -16,6 +16,7 @@
 #include "output.h"
 #include "renderloop.h"
 #include "scene.h"
+#include "surfaceitem.h"
 #include "window.h"
 #include "windowitem.h"
 
@@ -27,6 +28,15 @@ WindowScreenCastSource::WindowScreenCastSource(Window *window, QObject *parent)
     , m_window(window)
 {
     connect(m_window, &Window::windowClosed, this, &ScreenCastSource::closed);
+    connect(m_window, &Window::damaged, this, &WindowScreenCastSource::addDamage);
+    m_window->refOffscreenRendering();
+}
+
+WindowScreenCastSource::~WindowScreenCastSource()
+{
+    if (m_window) {
+        m_window->unrefOffscreenRendering();
+    }
 }
 
 bool WindowScreenCastSource::hasAlphaChannel() const
@@ -39,18 +49,60 @@ QSize WindowScreenCastSource::textureSize() const
     return m_window->clientGeometry().size();
 }
 
+QRegion WindowScreenCastSource::mapDamage(const QRegion &damage) const
+{
+    const QRect frameRect(QPoint(), textureSize());
+
+    // The damage is relative to the surface that got damaged. Subsurfaces are not told
+    // apart, so only the damage of a window without them can be mapped exactly.
+    const SurfaceItem *surfaceItem = m_window->windowItem()->surfaceItem();
+    if (!surfaceItem || !surfaceItem->childItems().isEmpty()) {
+        return frameRect;
+    }
+
+    const QPoint offset = m_window->clientGeometry().topLeft();
+    return surfaceItem->mapToGlobal(damage).translated(-offset).intersected(frameRect);
+}
+
+void WindowScreenCastSource::addDamage(Window *window, const QRegion &damage)
+{
+    Q_UNUSED(window)
+    if (m_offscreenTexture) {
+        m_offscreenDamage += mapDamage(damage);
+    }
+}
+
 void WindowScreenCastSource::render(QImage *image)
 {
-    GLTexture offscreenTexture(hasAlphaChannel() ? GL_RGBA8 : GL_RGB8, textureSize());
-    GLFramebuffer offscreenTarget(&offscreenTexture);
+    // The offscreen target is kept across frames so only what the window has damaged since
+    // the previous frame needs to be rendered again.
+    const QSize size = textureSize();
+    if (!m_offscreenTexture || m_offscreenTexture->size() != size) {
+        m_offscreenTexture.reset(new GLTexture(hasAlphaChannel() ? GL_RGBA8 : GL_RGB8, size));
+        m_offscreenTarget.reset(new GLFramebuffer(m_offscreenTexture.data()));
+        m_offscreenDamage = QRect(QPoint(), size);
+    }
 
-    render(&offscreenTarget);
-    grabTexture(&offscreenTexture, image);
+    renderDamage(m_offscreenTarget.data(), m_offscreenDamage);
+    m_offscreenDamage = QRegion();
+
+    grabTexture(m_offscreenTexture.data(), image);
 }
 
 void WindowScreenCastSource::render(GLFramebuffer *target)
 {
+    renderDamage(target, QRect(QPoint(), textureSize()));
+}
+
+void WindowScreenCastSource::renderDamage(GLFramebuffer *target, const QRegion &damage)
+{
+    if (damage.isEmpty()) {
+        return;
+    }
+
     const QRect geometry = m_window->clientGeometry();
+    const bool fullRepaint = damage == QRegion(QRect(QPoint(), geometry.size()));
+
     QMatrix4x4 projectionMatrix;
     projectionMatrix.ortho(geometry.x(), geometry.x() + geometry.width(),
                            geometry.y(), geometry.y() + geometry.height(), -1, 1);
@@ -59,12 +111,27 @@ void WindowScreenCastSource::render(GLFramebuffer *target)
     data.setProjectionMatrix(projectionMatrix);
 
     GLFramebuffer::pushFramebuffer(target);
+    if (!fullRepaint) {
+        // The projection maps the top of the window to the first row of the framebuffer,
+        // so the damage can be used as scissor rect without flipping it.
+        const QRect rect = damage.boundingRect();
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(rect.x(), rect.y(), rect.width(), rect.height());
+    }
     glClearColor(0.0, 0.0, 0.0, 0.0);
     glClear(GL_COLOR_BUFFER_BIT);
     Compositor::self()->scene()->render(m_window->windowItem(), Scene::PAINT_WINDOW_TRANSFORMED, infiniteRegion(), data);
+    if (!fullRepaint) {
+        glDisable(GL_SCISSOR_TEST);
+    }
     GLFramebuffer::popFramebuffer();
 }
 
+bool WindowScreenCastSource::hasAccurateDamage() const
+{
+    return true;
+}
+
 std::chrono::nanoseconds WindowScreenCastSource::clock() const
 {
     return m_window->output()->renderLoop()->lastPresentationTimestamp();
@@ -9,10 +9,12 @@
 #include "screencastsource.h"
 
 #include <QPointer>
+#include <QScopedPointer>
 
 namespace KWin
 {
 
+class GLTexture;
 class Window;
 
 class WindowScreenCastSource : public ScreenCastSource
@@ -21,6 +23,7 @@ class WindowScreenCastSource : public ScreenCastSource
 
 public:
     explicit WindowScreenCastSource(Window *window, QObject *parent = nullptr);
+    ~WindowScreenCastSource() override;
 
     bool hasAlphaChannel() const override;
     QSize textureSize() const override;
@@ -29,8 +32,22 @@ public:
     void render(QImage *image) override;
     std::chrono::nanoseconds clock() const override;
 
+    void renderDamage(GLFramebuffer *target, const QRegion &damage) override;
+    bool hasAccurateDamage() const override;
+
+    /**
+     * Maps the @a damage reported by Window::damaged() to the coordinates of the stream.
+     */
+    QRegion mapDamage(const QRegion &damage) const;
+
 private:
+    void addDamage(Window *window, const QRegion &damage);
+
     QPointer<Window> m_window;
+    QScopedPointer<GLTexture> m_offscreenTexture;
+    QScopedPointer<GLFramebuffer> m_offscreenTarget;
+    // the parts of the offscreen texture that are out of date
+    QRegion m_offscreenDamage;
 };
 
 } // namespace KWin
@@ -41,6 +41,7 @@
 
 #include <QHoverEvent>
 #include <QPainter>
+#include <QTimer>
 #include <QWindow>
 
 #include <linux/input.h>
@@ -123,6 +124,21 @@ void PointerInputRedirection::init()
     setInited(true);
     InputDeviceHandler::init();
 
+    static bool coalesceValid;
+    static const bool coalesce = qEnvironmentVariableIntValue("KWIN_POINTER_COALESCE_MOTION", &coalesceValid) == 1 && coalesceValid;
+    if (coalesce) {
+        m_motionCoalescingTimer = new QTimer(this);
+        m_motionCoalescingTimer->setSingleShot(true);
+        m_motionCoalescingTimer->setTimerType(Qt::PreciseTimer);
+        connect(m_motionCoalescingTimer, &QTimer::timeout, this, [this]() {
+            if (m_motionPending) {
+                flushMotion();
+                // keep accumulating while the pointer is moving
+                coalesceMotion();
+            }
+        });
+    }
+
     if (!input()->hasPointer()) {
         Cursors::self()->hideCursor();
     }
@@ -276,20 +292,56 @@ void PointerInputRedirection::processMotionInternal(const QPointF &pos, const QS
     }
 
     PositionUpdateBlocker blocker(this);
-    updatePosition(pos);
+    const bool coalesce = coalesceMotion();
+    updatePosition(pos, coalesce);
     MouseEvent event(QEvent::MouseMove, m_pos, Qt::NoButton, m_qtButtons,
                      input()->keyboardModifiers(), time,
                      delta, deltaNonAccelerated, timeUsec, device);
     event.setModifiersRelevantForGlobalShortcuts(input()->modifiersRelevantForGlobalShortcuts());
 
-    update();
+    if (coalesce) {
+        m_motionPending = true;
+    } else {
+        update();
+    }
+    // The filters forward every event to the focused client, including the relative motion,
+    // even if the focus update has been coalesced.
     input()->processSpies(std::bind(&InputEventSpy::pointerEvent, std::placeholders::_1, &event));
-    input()->processFilters(std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, 0));
+    input()->processFilters(InputRedirection::PointerEvents, std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, 0));
+}
+
+bool PointerInputRedirection::coalesceMotion()
+{
+    if (!m_motionCoalescingTimer) {
+        return false;
+    }
+    if (m_motionCoalescingTimer->isActive()) {
+        return true;
+    }
+    // The first motion event after a pause is processed right away, the following ones
+    // are accumulated until the output under the cursor can show the next frame.
+    const Output *output = kwinApp()->platform()->outputAt(m_pos.toPoint());
+    const int refreshRate = output && output->refreshRate() > 0 ? output->refreshRate() : 60000;
+    m_motionCoalescingTimer->start(std::max(1, 1000000 / refreshRate));
+    return false;
+}
+
+void PointerInputRedirection::flushMotion()
+{
+    if (!m_motionPending) {
+        return;
+    }
+    m_motionPending = false;
+
+    updateCursorOutputs();
+    Q_EMIT input()->globalPointerChanged(m_pos);
+    update();
 }
 
 void PointerInputRedirection::processButton(uint32_t button, InputRedirection::PointerButtonState state, uint32_t time, InputDevice *device)
 {
     input()->setLastInputHandler(this);
+    flushMotion();
     QEvent::Type type;
     switch (state) {
     case InputRedirection::PointerButtonReleased:
@@ -317,7 +369,7 @@ void PointerInputRedirection::processButton(uint32_t button, InputRedirection::P
         return;
     }
 
-    input()->processFilters(std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, button));
+    input()->processFilters(InputRedirection::PointerEvents, std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, button));
 
     if (state == InputRedirection::PointerButtonReleased) {
         update();
@@ -328,6 +380,7 @@ void PointerInputRedirection::processAxis(InputRedirection::PointerAxis axis, qr
                                           InputRedirection::PointerAxisSource source, uint32_t time, InputDevice *device)
 {
     input()->setLastInputHandler(this);
+    flushMotion();
     update();
 
     Q_EMIT input()->pointerAxisChanged(axis, delta);
@@ -342,7 +395,7 @@ void PointerInputRedirection::processAxis(InputRedirection::PointerAxis axis, qr
     if (!inited()) {
         return;
     }
-    input()->processFilters(std::bind(&InputEventFilter::wheelEvent, std::placeholders::_1, &wheelEvent));
+    input()->processFilters(InputRedirection::WheelEvents, std::bind(&InputEventFilter::wheelEvent, std::placeholders::_1, &wheelEvent));
 }
 
 void PointerInputRedirection::processSwipeGestureBegin(int fingerCount, quint32 time, KWin::InputDevice *device)
@@ -354,7 +407,7 @@ void PointerInputRedirection::processSwipeGestureBegin(int fingerCount, quint32
     }
 
     input()->processSpies(std::bind(&InputEventSpy::swipeGestureBegin, std::placeholders::_1, fingerCount, time));
-    input()->processFilters(std::bind(&InputEventFilter::swipeGestureBegin, std::placeholders::_1, fingerCount, time));
+    input()->processFilters(InputRedirection::GestureEvents, std::bind(&InputEventFilter::swipeGestureBegin, std::placeholders::_1, fingerCount, time));
 }
 
 void PointerInputRedirection::processSwipeGestureUpdate(const QSizeF &delta, quint32 time, KWin::InputDevice *device)
@@ -367,7 +420,7 @@ void PointerInputRedirection::processSwipeGestureUpdate(const QSizeF &delta, qui
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::swipeGestureUpdate, std::placeholders::_1, delta, time));
-    input()->processFilters(std::bind(&InputEventFilter::swipeGestureUpdate, std::placeholders::_1, delta, time));
+    input()->processFilters(InputRedirection::GestureEvents, std::bind(&InputEventFilter::swipeGestureUpdate, std::placeholders::_1, delta, time));
 }
 
 void PointerInputRedirection::processSwipeGestureEnd(quint32 time, KWin::InputDevice *device)
@@ -380,7 +433,7 @@ void PointerInputRedirection::processSwipeGestureEnd(quint32 time, KWin::InputDe
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::swipeGestureEnd, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::swipeGestureEnd, std::placeholders::_1, time));
+    input()->processFilters(InputRedirection::GestureEvents, std::bind(&InputEventFilter::swipeGestureEnd, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processSwipeGestureCancelled(quint32 time, KWin::InputDevice *device)
@@ -393,7 +446,7 @@ void PointerInputRedirection::processSwipeGestureCancelled(quint32 time, KWin::I
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::swipeGestureCancelled, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::swipeGestureCancelled, std::placeholders::_1, time));
+    input()->processFilters(InputRedirection::GestureEvents, std::bind(&InputEventFilter::swipeGestureCancelled, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processPinchGestureBegin(int fingerCount, quint32 time, KWin::InputDevice *device)
@@ -406,7 +459,7 @@ void PointerInputRedirection::processPinchGestureBegin(int fingerCount, quint32
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::pinchGestureBegin, std::placeholders::_1, fingerCount, time));
-    input()->processFilters(std::bind(&InputEventFilter::pinchGestureBegin, std::placeholders::_1, fingerCount, time));
+    input()->processFilters(InputRedirection::GestureEvents, std::bind(&InputEventFilter::pinchGestureBegin, std::placeholders::_1, fingerCount, time));
 }
 
 void PointerInputRedirection::processPinchGestureUpdate(qreal scale, qreal angleDelta, const QSizeF &delta, quint32 time, KWin::InputDevice *device)
@@ -419,7 +472,7 @@ void PointerInputRedirection::processPinchGestureUpdate(qreal scale, qreal angle
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::pinchGestureUpdate, std::placeholders::_1, scale, angleDelta, delta, time));
-    input()->processFilters(std::bind(&InputEventFilter::pinchGestureUpdate, std::placeholders::_1, scale, angleDelta, delta, time));
+    input()->processFilters(InputRedirection::GestureEvents, std::bind(&InputEventFilter::pinchGestureUpdate, std::placeholders::_1, scale, angleDelta, delta, time));
 }
 
 void PointerInputRedirection::processPinchGestureEnd(quint32 time, KWin::InputDevice *device)
@@ -432,7 +485,7 @@ void PointerInputRedirection::processPinchGestureEnd(quint32 time, KWin::InputDe
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::pinchGestureEnd, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::pinchGestureEnd, std::placeholders::_1, time));
+    input()->processFilters(InputRedirection::GestureEvents, std::bind(&InputEventFilter::pinchGestureEnd, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processPinchGestureCancelled(quint32 time, KWin::InputDevice *device)
@@ -445,7 +498,7 @@ void PointerInputRedirection::processPinchGestureCancelled(quint32 time, KWin::I
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::pinchGestureCancelled, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::pinchGestureCancelled, std::placeholders::_1, time));
+    input()->processFilters(InputRedirection::GestureEvents, std::bind(&InputEventFilter::pinchGestureCancelled, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processHoldGestureBegin(int fingerCount, quint32 time, KWin::InputDevice *device)
@@ -457,7 +510,7 @@ void PointerInputRedirection::processHoldGestureBegin(int fingerCount, quint32 t
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::holdGestureBegin, std::placeholders::_1, fingerCount, time));
-    input()->processFilters(std::bind(&InputEventFilter::holdGestureBegin, std::placeholders::_1, fingerCount, time));
+    input()->processFilters(InputRedirection::GestureEvents, std::bind(&InputEventFilter::holdGestureBegin, std::placeholders::_1, fingerCount, time));
 }
 
 void PointerInputRedirection::processHoldGestureEnd(quint32 time, KWin::InputDevice *device)
@@ -469,7 +522,7 @@ void PointerInputRedirection::processHoldGestureEnd(quint32 time, KWin::InputDev
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::holdGestureEnd, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::holdGestureEnd, std::placeholders::_1, time));
+    input()->processFilters(InputRedirection::GestureEvents, std::bind(&InputEventFilter::holdGestureEnd, std::placeholders::_1, time));
 }
 
 void PointerInputRedirection::processHoldGestureCancelled(quint32 time, KWin::InputDevice *device)
@@ -481,7 +534,7 @@ void PointerInputRedirection::processHoldGestureCancelled(quint32 time, KWin::In
     update();
 
     input()->processSpies(std::bind(&InputEventSpy::holdGestureCancelled, std::placeholders::_1, time));
-    input()->processFilters(std::bind(&InputEventFilter::holdGestureCancelled, std::placeholders::_1, time));
+    input()->processFilters(InputRedirection::GestureEvents, std::bind(&InputEventFilter::holdGestureCancelled, std::placeholders::_1, time));
 }
 
 bool PointerInputRedirection::areButtonsPressed() const
@@ -788,7 +841,7 @@ QPointF PointerInputRedirection::applyPointerConfinement(const QPointF &pos) con
     return m_pos;
 }
 
-void PointerInputRedirection::updatePosition(const QPointF &pos)
+void PointerInputRedirection::updatePosition(const QPointF &pos, bool coalesce)
 {
     if (m_locked) {
         // locked pointer should not move
@@ -815,6 +868,9 @@ void PointerInputRedirection::updatePosition(const QPointF &pos)
     }
 
     m_pos = p;
+    if (coalesce) {
+        return;
+    }
 
     updateCursorOutputs();
 
@@ -863,6 +919,7 @@ void PointerInputRedirection::warp(const QPointF &pos)
     if (supportsWarping()) {
         kwinApp()->platform()->warpPointer(pos);
         processMotionAbsolute(pos, waylandServer()->seat()->timestamp());
+        flushMotion();
     }
 }
 
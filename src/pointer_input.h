@@ -20,6 +20,7 @@
 #include <QPointF>
 #include <QPointer>
 
+class QTimer;
 class QWindow;
 
 namespace KWaylandServer
@@ -153,7 +154,9 @@ private:
 
     void updateOnStartMoveResize();
     void updateToReset();
-    void updatePosition(const QPointF &pos);
+    void updatePosition(const QPointF &pos, bool coalesce = false);
+    bool coalesceMotion();
+    void flushMotion();
     void updateButton(uint32_t button, InputRedirection::PointerButtonState state);
     QPointF applyPointerConfinement(const QPointF &pos) const;
     void disconnectConfinedPointerRegionConnection();
@@ -174,6 +177,12 @@ private:
     bool m_confined = false;
     bool m_locked = false;
     bool m_enableConstraints = true;
+    /**
+     * Only set if motion coalescing is enabled with KWIN_POINTER_COALESCE_MOTION=1. While the
+     * timer is running, focus, hover and cursor updates are postponed until it times out.
+     */
+    QTimer *m_motionCoalescingTimer = nullptr;
+    bool m_motionPending = false;
     friend class PositionUpdateBlocker;
 };
 
@@ -19,9 +19,11 @@ namespace KWin
 
 PopupInputFilter::PopupInputFilter()
     : QObject()
+    , InputEventFilter(InputRedirection::PointerEvents | InputRedirection::KeyboardEvents | InputRedirection::TouchEvents)
 {
     connect(workspace(), &Workspace::windowAdded, this, &PopupInputFilter::handleWindowAdded);
     connect(workspace(), &Workspace::internalWindowAdded, this, &PopupInputFilter::handleWindowAdded);
+    setActive(false);
 }
 
 void PopupInputFilter::handleWindowAdded(Window *window)
@@ -34,12 +36,14 @@ void PopupInputFilter::handleWindowAdded(Window *window)
         connect(window, &Window::windowShown, this, &PopupInputFilter::handleWindowAdded, Qt::UniqueConnection);
         connect(window, &Window::windowClosed, this, &PopupInputFilter::handleWindowRemoved, Qt::UniqueConnection);
         m_popupWindows << window;
+        setActive(true);
     }
 }
 
 void PopupInputFilter::handleWindowRemoved(Window *window)
 {
     m_popupWindows.removeOne(window);
+    setActive(!m_popupWindows.isEmpty());
 }
 bool PopupInputFilter::pointerEvent(QMouseEvent *event, quint32 nativeButton)
 {
@@ -120,6 +124,7 @@ void PopupInputFilter::cancelPopups()
         auto c = m_popupWindows.takeLast();
         c->popupDone();
     }
+    setActive(false);
 }
 
 }
@@ -6,25 +6,42 @@
 
 #include "renderjournal.h"
 
+#include <cmath>
+
 namespace KWin
 {
 
 RenderJournal::RenderJournal()
 {
+    m_histogram.fill(0);
 }
 
-void RenderJournal::beginFrame()
-{
-    m_timer.start();
-}
-
-void RenderJournal::endFrame()
+void RenderJournal::add(std::chrono::nanoseconds duration)
 {
-    std::chrono::nanoseconds duration(m_timer.nsecsElapsed());
     if (m_log.count() >= m_size) {
         m_log.dequeue();
     }
     m_log.enqueue(duration);
+
+    // Age the histogram rather than dropping samples so spikes fade out gradually.
+    for (qreal &weight : m_histogram) {
+        weight *= m_decay;
+    }
+    const int bin = std::min<int>(duration / s_binWidth, s_binCount - 1);
+    m_histogram[bin] += 1;
+    m_histogramWeight = m_histogramWeight * m_decay + 1;
+
+    const qreal sample = duration.count();
+    if (m_sampleCount == 0) {
+        m_mean = sample;
+        m_variance = 0;
+    } else {
+        const qreal alpha = 1 - m_decay;
+        const qreal delta = sample - m_mean;
+        m_mean += alpha * delta;
+        m_variance = (1 - alpha) * (m_variance + alpha * delta * delta);
+    }
+    m_sampleCount++;
 }
 
 std::chrono::nanoseconds RenderJournal::minimum() const
@@ -53,4 +70,33 @@ std::chrono::nanoseconds RenderJournal::average() const
     return result / m_log.count();
 }
 
+std::chrono::nanoseconds RenderJournal::percentile(int percentile) const
+{
+    if (m_histogramWeight <= 0) {
+        return std::chrono::nanoseconds::zero();
+    }
+
+    const qreal threshold = m_histogramWeight * qBound(0, percentile, 100) / 100.0;
+    qreal accumulated = 0;
+    for (int i = 0; i < s_binCount; ++i) {
+        accumulated += m_histogram[i];
+        if (accumulated >= threshold && m_histogram[i] > 0) {
+            // Report the upper edge of the bin to err on the side of caution.
+            return s_binWidth * (i + 1);
+        }
+    }
+
+    return maximum();
+}
+
+std::chrono::nanoseconds RenderJournal::standardDeviation() const
+{
+    return std::chrono::nanoseconds(std::llround(std::sqrt(m_variance)));
+}
+
+int RenderJournal::sampleCount() const
+{
+    return m_sampleCount;
+}
+
 } // namespace KWin
@@ -8,15 +8,21 @@
 
 #include "kwinglobals.h"
 
-#include <QElapsedTimer>
 #include <QQueue>
 
+#include <array>
+#include <chrono>
+
 namespace KWin
 {
 
 /**
  * The RenderJournal class measures how long it takes to render frames and estimates how
  * long it will take to render the next frame.
+ *
+ * Besides a short log of the most recent frames, the journal keeps an exponentially
+ * decaying histogram of render times, which is used to answer percentile queries, and
+ * an exponentially weighted estimate of the render time variance.
  */
 class KWIN_EXPORT RenderJournal
 {
@@ -24,14 +30,10 @@ public:
     RenderJournal();
 
     /**
-     * This function must be called before starting rendering a new frame.
-     */
-    void beginFrame();
-
-    /**
-     * This function must be called after finishing rendering a frame.
+     * Records a frame that took @a renderTime to render. The render time should cover
+     * both the CPU and the GPU side of rendering, if the latter is known.
      */
-    void endFrame();
+    void add(std::chrono::nanoseconds renderTime);
 
     /**
      * Returns the maximum estimated amount of time that it takes to render a single frame.
@@ -48,10 +50,37 @@ public:
      */
     std::chrono::nanoseconds average() const;
 
+    /**
+     * Returns the estimated amount of time that @a percentile percent of the frames
+     * fit in, e.g. percentile(95) is the p95 render time. More recent frames have
+     * larger weight than older frames.
+     */
+    std::chrono::nanoseconds percentile(int percentile) const;
+
+    /**
+     * Returns the exponentially weighted standard deviation of the render time.
+     */
+    std::chrono::nanoseconds standardDeviation() const;
+
+    /**
+     * Returns the number of frames that have been recorded so far.
+     */
+    int sampleCount() const;
+
 private:
-    QElapsedTimer m_timer;
+    static constexpr std::chrono::nanoseconds s_binWidth = std::chrono::microseconds(250);
+    static constexpr int s_binCount = 200;
+
     QQueue<std::chrono::nanoseconds> m_log;
     int m_size = 15;
+
+    std::array<qreal, s_binCount> m_histogram;
+    qreal m_histogramWeight = 0;
+    qreal m_decay = 0.97;
+
+    qreal m_mean = 0;
+    qreal m_variance = 0;
+    int m_sampleCount = 0;
 };
 
 } // namespace KWin
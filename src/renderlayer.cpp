@@ -156,12 +156,18 @@ void RenderLayer::addRepaintFull()
 
 void RenderLayer::addRepaint(int x, int y, int width, int height)
 {
-    addRepaint(QRegion(x, y, width, height));
+    addRepaint(QRect(x, y, width, height));
 }
 
 void RenderLayer::addRepaint(const QRect &rect)
 {
-    addRepaint(QRegion(rect));
+    if (!m_effectiveVisible) {
+        return;
+    }
+    if (!rect.isEmpty()) {
+        m_repaints += rect;
+        m_loop->scheduleRepaint();
+    }
 }
 
 void RenderLayer::addRepaint(const QRegion &region)
@@ -177,12 +183,12 @@ void RenderLayer::addRepaint(const QRegion &region)
 
 QRegion RenderLayer::repaints() const
 {
-    return m_repaints;
+    return m_repaints.toRegion();
 }
 
 void RenderLayer::resetRepaints()
 {
-    m_repaints = QRegion();
+    m_repaints.clear();
 }
 
 bool RenderLayer::isVisible() const
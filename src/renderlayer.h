@@ -9,6 +9,7 @@
 #include "kwin_export.h"
 
 #include "outputlayer.h"
+#include "utils/compactregion.h"
 
 #include <QMap>
 #include <QObject>
@@ -84,7 +85,7 @@ private:
 
     RenderLoop *m_loop;
     QScopedPointer<RenderLayerDelegate> m_delegate;
-    QRegion m_repaints;
+    CompactRegion m_repaints;
     QRect m_boundingRect;
     QRect m_geometry;
     QPointer<OutputLayer> m_outputLayer;
@@ -42,4 +42,9 @@ SurfaceItem *RenderLayerDelegate::scanoutCandidate() const
     return nullptr;
 }
 
+QVector<SurfaceItem *> RenderLayerDelegate::overlayCandidates() const
+{
+    return {};
+}
+
 } // namespace KWin
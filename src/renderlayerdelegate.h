@@ -10,6 +10,7 @@
 
 #include <QObject>
 #include <QRegion>
+#include <QVector>
 
 namespace KWin
 {
@@ -54,6 +55,12 @@ public:
      */
     virtual SurfaceItem *scanoutCandidate() const;
 
+    /**
+     * Returns surfaces, ordered from top to bottom, that could be put on hardware overlay
+     * planes above the render layer without changing what is visible on the screen.
+     */
+    virtual QVector<SurfaceItem *> overlayCandidates() const;
+
     /**
      * This function is called when the compositor wants the render layer delegate
      * to repaint its contents.
@@ -6,9 +6,13 @@
 
 #include "renderloop.h"
 #include "renderloop_p.h"
-#include "surfaceitem.h"
+#include "framedropmonitor.h"
+#include "ftrace.h"
+#include "inputlatencymonitor.h"
 #include "utils/common.h"
 
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -30,6 +34,14 @@ RenderLoopPrivate::RenderLoopPrivate(RenderLoop *q)
     QObject::connect(&compositeTimer, &QTimer::timeout, q, [this]() {
         dispatch();
     });
+    compensationTimer.setSingleShot(true);
+    compensationTimer.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&compensationTimer, &QTimer::timeout, q, [this]() {
+        if (!pendingFrameCount && !inhibitCount && presentMode == SyncMode::Adaptive && !compositeTimer.isActive()) {
+            compensationRepaint = true;
+            scheduleRepaint();
+        }
+    });
 }
 
 void RenderLoopPrivate::scheduleRepaint()
@@ -37,11 +49,7 @@ void RenderLoopPrivate::scheduleRepaint()
     if (kwinApp()->isTerminating() || compositeTimer.isActive()) {
         return;
     }
-    if (vrrPolicy == RenderLoop::VrrPolicy::Always || (vrrPolicy == RenderLoop::VrrPolicy::Automatic && fullscreenItem != nullptr)) {
-        presentMode = SyncMode::Adaptive;
-    } else {
-        presentMode = SyncMode::Fixed;
-    }
+    presentMode = fullscreenItem && fullscreenTearing ? SyncMode::Async : synchronizedPresentMode();
     const std::chrono::nanoseconds vblankInterval(1'000'000'000'000ull / refreshRate);
     const std::chrono::nanoseconds currentTime(std::chrono::steady_clock::now().time_since_epoch());
 
@@ -51,9 +59,15 @@ void RenderLoopPrivate::scheduleRepaint()
         nextPresentationTimestamp = lastPresentationTimestamp
             + alignTimestamp(currentTime - lastPresentationTimestamp, vblankInterval);
     }
+    if (maximumFrameRate > 0 && maximumFrameRate < refreshRate) {
+        const std::chrono::nanoseconds minimumFrameInterval(1'000'000'000'000ull / maximumFrameRate);
+        if (nextPresentationTimestamp - lastPresentationTimestamp < minimumFrameInterval) {
+            nextPresentationTimestamp = lastPresentationTimestamp + alignTimestamp(minimumFrameInterval, vblankInterval);
+        }
+    }
 
     // Estimate when it's a good time to perform the next compositing cycle.
-    const std::chrono::nanoseconds safetyMargin = std::chrono::milliseconds(3);
+    const std::chrono::nanoseconds safetyMargin = estimateSafetyMargin(vblankInterval);
 
     std::chrono::nanoseconds renderTime;
     switch (q->latencyPolicy()) {
@@ -84,6 +98,9 @@ void RenderLoopPrivate::scheduleRepaint()
     case RenderTimeEstimatorAverage:
         renderTime = std::max(renderTime, renderJournal.average());
         break;
+    case RenderTimeEstimatorPercentile:
+        renderTime = std::max(renderTime, renderJournal.percentile(q->renderTimePercentile()));
+        break;
     }
 
     std::chrono::nanoseconds nextRenderTimestamp = nextPresentationTimestamp - renderTime - safetyMargin;
@@ -93,10 +110,48 @@ void RenderLoopPrivate::scheduleRepaint()
         nextRenderTimestamp = currentTime;
     }
 
+    scheduledRenderTimestamp = nextRenderTimestamp;
+    scheduledSafetyMargin = safetyMargin;
+
     const std::chrono::nanoseconds waitInterval = nextRenderTimestamp - currentTime;
     compositeTimer.start(std::chrono::duration_cast<std::chrono::milliseconds>(waitInterval));
 }
 
+std::chrono::nanoseconds RenderLoopPrivate::estimateSafetyMargin(std::chrono::nanoseconds vblankInterval) const
+{
+    static const std::chrono::nanoseconds defaultSafetyMargin = std::chrono::milliseconds(3);
+    static const std::chrono::nanoseconds minimumSafetyMargin = std::chrono::microseconds(500);
+
+    // Until there are enough samples, the variance is not trustworthy.
+    if (renderJournal.sampleCount() < 15) {
+        return defaultSafetyMargin;
+    }
+
+    // Leave room for two standard deviations of jitter, but never more than the old fixed
+    // margin or a tenth of the refresh cycle, whichever is smaller.
+    const std::chrono::nanoseconds maximumSafetyMargin = std::min(defaultSafetyMargin, vblankInterval / 10);
+    return std::clamp(2 * renderJournal.standardDeviation(), minimumSafetyMargin, std::max(minimumSafetyMargin, maximumSafetyMargin));
+}
+
+void RenderLoopPrivate::scheduleCompensationFrame()
+{
+    if (presentMode != SyncMode::Adaptive || minimumRefreshRate <= 0 || minimumRefreshRate >= refreshRate) {
+        return;
+    }
+    // Only repeat frames while something is being presented, an idle screen can be left to
+    // the display. Content slower than that doesn't move smoothly anyway.
+    const std::chrono::nanoseconds maximumCompensationDuration = std::chrono::seconds(1);
+    if (std::chrono::steady_clock::now().time_since_epoch() - lastContentTimestamp > maximumCompensationDuration) {
+        return;
+    }
+    // Below the minimum refresh rate the display would refresh on its own, which shows up as
+    // flicker. Present the last frame again early enough that it still reaches the display.
+    const std::chrono::nanoseconds vblankInterval(1'000'000'000'000ull / refreshRate);
+    const std::chrono::nanoseconds maximumFrameInterval(1'000'000'000'000ull / minimumRefreshRate);
+    const std::chrono::nanoseconds waitInterval = std::max(maximumFrameInterval - vblankInterval, std::chrono::nanoseconds::zero());
+    compensationTimer.start(std::chrono::duration_cast<std::chrono::milliseconds>(waitInterval));
+}
+
 void RenderLoopPrivate::delayScheduleRepaint()
 {
     pendingReschedule = true;
@@ -110,20 +165,61 @@ void RenderLoopPrivate::maybeScheduleRepaint()
     }
 }
 
+RenderLoopPrivate::SyncMode RenderLoopPrivate::synchronizedPresentMode() const
+{
+    if (vrrPolicy == RenderLoop::VrrPolicy::Always || (vrrPolicy == RenderLoop::VrrPolicy::Automatic && fullscreenItem != nullptr)) {
+        return SyncMode::Adaptive;
+    }
+    return SyncMode::Fixed;
+}
+
 void RenderLoopPrivate::notifyFrameFailed()
 {
     Q_ASSERT(pendingFrameCount > 0);
     pendingFrameCount--;
+    fTraceCounter("Pending frames", pendingFrameCount);
+
+    // The destructor tells the clients that their content hasn't been shown.
+    presentationFeedbacks.clear();
 
     if (!inhibitCount) {
         maybeScheduleRepaint();
     }
 }
 
-void RenderLoopPrivate::notifyFrameCompleted(std::chrono::nanoseconds timestamp)
+void RenderLoopPrivate::notifyFrameCompleted(std::chrono::nanoseconds timestamp, std::chrono::nanoseconds renderTime,
+                                             quint64 sequence, KWaylandServer::PresentationFeedback::Kinds kinds)
 {
     Q_ASSERT(pendingFrameCount > 0);
     pendingFrameCount--;
+    fTraceCounter("Pending frames", pendingFrameCount);
+
+    // The backend may know when the GPU actually finished rendering, which can be long
+    // after the CPU has finished submitting the rendering commands. Frames that haven't
+    // been rendered would only drag the estimate down.
+    if (frameRendered) {
+        fTraceCounter("Render time (us)", std::chrono::duration_cast<std::chrono::microseconds>(std::max(cpuRenderTime, renderTime)).count());
+        renderJournal.add(std::max(cpuRenderTime, renderTime));
+    }
+    gpuRenderTime = renderTime;
+
+    // Only a fixed refresh cycle has vblanks to miss
+    if (FrameDropMonitor *monitor = FrameDropMonitor::self(); monitor && presentMode == SyncMode::Fixed) {
+        monitor->reportFrame(FrameDropMonitor::Frame{
+            .scheduledRenderTimestamp = scheduledRenderTimestamp,
+            .renderTimestamp = renderTimestamp,
+            .expectedPresentationTimestamp = expectedPresentationTimestamp,
+            .presentationTimestamp = timestamp,
+            .cpuRenderTime = cpuRenderTime,
+            .gpuRenderTime = renderTime,
+            .vblankInterval = std::chrono::nanoseconds(1'000'000'000'000) / refreshRate,
+            .safetyMargin = scheduledSafetyMargin,
+        });
+    }
+
+    if (InputLatencyMonitor *monitor = InputLatencyMonitor::self()) {
+        monitor->framePresented(q, timestamp);
+    }
 
     if (lastPresentationTimestamp <= timestamp) {
         lastPresentationTimestamp = timestamp;
@@ -135,8 +231,22 @@ void RenderLoopPrivate::notifyFrameCompleted(std::chrono::nanoseconds timestamp)
         lastPresentationTimestamp = std::chrono::steady_clock::now().time_since_epoch();
     }
 
+    if (!presentationFeedbacks.empty()) {
+        // There is no fixed refresh cycle with variable refresh rate or tearing page flips.
+        const std::chrono::nanoseconds refreshDuration = presentMode != SyncMode::Fixed
+            ? std::chrono::nanoseconds::zero()
+            : std::chrono::nanoseconds(1'000'000'000'000) / refreshRate;
+        for (const auto &feedback : presentationFeedbacks) {
+            feedback->presented(lastPresentationTimestamp, refreshDuration, sequence, kinds);
+        }
+        presentationFeedbacks.clear();
+    }
+
     if (!inhibitCount) {
         maybeScheduleRepaint();
+        if (!compositeTimer.isActive()) {
+            scheduleCompensationFrame();
+        }
     }
 
     Q_EMIT q->framePresented(q, timestamp);
@@ -160,6 +270,7 @@ void RenderLoopPrivate::invalidate()
     pendingReschedule = false;
     pendingFrameCount = 0;
     compositeTimer.stop();
+    compensationTimer.stop();
 }
 
 RenderLoop::RenderLoop(QObject *parent)
@@ -178,6 +289,7 @@ void RenderLoop::inhibit()
 
     if (d->inhibitCount == 1) {
         d->compositeTimer.stop();
+        d->compensationTimer.stop();
     }
 }
 
@@ -194,13 +306,54 @@ void RenderLoop::uninhibit()
 void RenderLoop::beginFrame()
 {
     d->pendingRepaint = false;
+    d->compensationTimer.stop();
     d->pendingFrameCount++;
-    d->renderJournal.beginFrame();
+    fTraceCounter("Pending frames", d->pendingFrameCount);
+    d->renderTimestamp = std::chrono::steady_clock::now().time_since_epoch();
+    if (!d->compensationRepaint) {
+        d->lastContentTimestamp = d->renderTimestamp;
+    }
+    d->compensationRepaint = false;
+    d->expectedPresentationTimestamp = d->nextPresentationTimestamp;
+    d->renderTimer.start();
+    if (InputLatencyMonitor *monitor = InputLatencyMonitor::self()) {
+        monitor->frameStarted(this);
+    }
 }
 
-void RenderLoop::endFrame()
+void RenderLoop::endFrame(bool rendered)
 {
-    d->renderJournal.endFrame();
+    d->cpuRenderTime = std::chrono::nanoseconds(d->renderTimer.nsecsElapsed());
+    d->frameRendered = rendered;
+}
+
+int RenderLoop::minimumRefreshRate() const
+{
+    return d->minimumRefreshRate;
+}
+
+void RenderLoop::setMinimumRefreshRate(int refreshRate)
+{
+    d->minimumRefreshRate = refreshRate;
+}
+
+int RenderLoop::maximumFrameRate() const
+{
+    return d->maximumFrameRate;
+}
+
+void RenderLoop::setMaximumFrameRate(int frameRate)
+{
+    if (d->maximumFrameRate == frameRate) {
+        return;
+    }
+    d->maximumFrameRate = frameRate;
+
+    // Reschedule a pending frame, otherwise lifting the limit takes effect one frame late.
+    if (d->compositeTimer.isActive()) {
+        d->compositeTimer.stop();
+        d->scheduleRepaint();
+    }
 }
 
 int RenderLoop::refreshRate() const
@@ -244,6 +397,21 @@ void RenderLoop::resetLatencyPolicy()
     d->latencyPolicy.reset();
 }
 
+int RenderLoop::renderTimePercentile() const
+{
+    return d->renderTimePercentile.value_or(options->renderTimePercentile());
+}
+
+void RenderLoop::setRenderTimePercentile(int percentile)
+{
+    d->renderTimePercentile = qBound(1, percentile, 100);
+}
+
+void RenderLoop::resetRenderTimePercentile()
+{
+    d->renderTimePercentile.reset();
+}
+
 std::chrono::nanoseconds RenderLoop::lastPresentationTimestamp() const
 {
     return d->lastPresentationTimestamp;
@@ -254,9 +422,21 @@ std::chrono::nanoseconds RenderLoop::nextPresentationTimestamp() const
     return d->nextPresentationTimestamp;
 }
 
-void RenderLoop::setFullscreenSurface(Item *surfaceItem)
+void RenderLoop::addPresentationFeedback(KWaylandServer::SurfaceInterface *surface, std::unique_ptr<KWaylandServer::PresentationFeedback> &&feedback)
+{
+    feedback->setZeroCopy(surface && surface == d->zeroCopySurface);
+    d->presentationFeedbacks.push_back(std::move(feedback));
+}
+
+void RenderLoop::setZeroCopySurface(KWaylandServer::SurfaceInterface *surface)
+{
+    d->zeroCopySurface = surface;
+}
+
+void RenderLoop::setFullscreenSurface(Item *surfaceItem, bool allowTearing)
 {
     d->fullscreenItem = surfaceItem;
+    d->fullscreenTearing = allowTearing;
 }
 
 RenderLoop::VrrPolicy RenderLoop::vrrPolicy() const
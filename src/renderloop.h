@@ -11,6 +11,14 @@
 
 #include <QObject>
 
+#include <memory>
+
+namespace KWaylandServer
+{
+class PresentationFeedback;
+class SurfaceInterface;
+}
+
 namespace KWin
 {
 
@@ -55,9 +63,11 @@ public:
 
     /**
      * This function must be called after the Compositor has finished rendering the
-     * next frame.
+     * next frame. @a rendered tells whether anything has been rendered, as opposed to
+     * scanning out a client buffer directly or reusing the last frame. Only rendered
+     * frames are taken into account when estimating the render time.
      */
-    void endFrame();
+    void endFrame(bool rendered);
 
     /**
      * Returns the refresh rate at which the output is being updated, in millihertz.
@@ -69,6 +79,40 @@ public:
      */
     void setRefreshRate(int refreshRate);
 
+    /**
+     * Returns the lowest refresh rate the output supports with adaptive sync, in millihertz,
+     * or 0 if it's unknown.
+     *
+     * @since 5.26
+     */
+    int minimumRefreshRate() const;
+
+    /**
+     * Sets the lowest refresh rate the output supports with adaptive sync to @a refreshRate,
+     * in millihertz. If frames come in at a lower rate, the last frame is presented again
+     * before the output would have to refresh, so it doesn't flicker.
+     *
+     * @since 5.26
+     */
+    void setMinimumRefreshRate(int refreshRate);
+
+    /**
+     * Returns the highest rate at which frames are rendered, in millihertz, or 0 if frames
+     * are rendered at the refresh rate.
+     *
+     * @since 5.26
+     */
+    int maximumFrameRate() const;
+
+    /**
+     * Limits the rate at which frames are rendered to @a frameRate, in millihertz. The output
+     * keeps its refresh rate, but repaints are deferred to a later vblank. Pass 0 to render
+     * at the refresh rate again.
+     *
+     * @since 5.26
+     */
+    void setMaximumFrameRate(int frameRate);
+
     /**
      * Schedules a compositing cycle at the next available moment.
      */
@@ -87,11 +131,25 @@ public:
      */
     std::chrono::nanoseconds nextPresentationTimestamp() const;
 
+    /**
+     * Adds the presentation @a feedback of the @a surface for the frame that is being rendered.
+     * The feedback is sent when the frame is presented on the screen and discarded if the frame
+     * fails.
+     */
+    void addPresentationFeedback(KWaylandServer::SurfaceInterface *surface, std::unique_ptr<KWaylandServer::PresentationFeedback> &&feedback);
+
+    /**
+     * Sets the @a surface whose buffer is passed to the output directly in the frame that is
+     * being rendered. Only its presentation feedback reports zero copy presentation.
+     */
+    void setZeroCopySurface(KWaylandServer::SurfaceInterface *surface);
+
     /**
      * Sets the surface that currently gets scanned out,
-     * so that this RenderLoop can adjust its timing behavior to that surface
+     * so that this RenderLoop can adjust its timing behavior to that surface.
+     * If @a allowTearing is @c true, the surface has asked to be presented with tearing.
      */
-    void setFullscreenSurface(Item *surface);
+    void setFullscreenSurface(Item *surface, bool allowTearing = false);
 
     enum class VrrPolicy : uint32_t {
         Never = 0,
@@ -126,6 +184,23 @@ public:
      */
     void resetLatencyPolicy();
 
+    /**
+     * Returns the render time percentile that is used by the percentile render time
+     * estimator on this render loop.
+     */
+    int renderTimePercentile() const;
+
+    /**
+     * Sets the render time percentile of this render loop to @a percentile. By default,
+     * the percentile matches options->renderTimePercentile().
+     */
+    void setRenderTimePercentile(int percentile);
+
+    /**
+     * Resets the render time percentile to the default value.
+     */
+    void resetRenderTimePercentile();
+
 Q_SIGNALS:
     /**
      * This signal is emitted when the refresh rate of this RenderLoop has changed.
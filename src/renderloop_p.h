@@ -8,7 +8,9 @@
 
 #include "renderjournal.h"
 #include "renderloop.h"
+#include "wayland/presentationtime_interface.h"
 
+#include <QElapsedTimer>
 #include <QTimer>
 
 #include <optional>
@@ -28,29 +30,62 @@ public:
     void delayScheduleRepaint();
     void scheduleRepaint();
     void maybeScheduleRepaint();
+    std::chrono::nanoseconds estimateSafetyMargin(std::chrono::nanoseconds vblankInterval) const;
+
+    void scheduleCompensationFrame();
 
     void notifyFrameFailed();
-    void notifyFrameCompleted(std::chrono::nanoseconds timestamp);
+    void notifyFrameCompleted(std::chrono::nanoseconds timestamp, std::chrono::nanoseconds renderTime = std::chrono::nanoseconds::zero(),
+                              quint64 sequence = 0, KWaylandServer::PresentationFeedback::Kinds kinds = {});
 
     RenderLoop *q;
     std::chrono::nanoseconds lastPresentationTimestamp = std::chrono::nanoseconds::zero();
     std::chrono::nanoseconds nextPresentationTimestamp = std::chrono::nanoseconds::zero();
+    // The schedule of the frame that is being rendered, to detect missed vblanks
+    std::chrono::nanoseconds scheduledRenderTimestamp = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds scheduledSafetyMargin = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds renderTimestamp = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds expectedPresentationTimestamp = std::chrono::nanoseconds::zero();
     QTimer compositeTimer;
     RenderJournal renderJournal;
+    QElapsedTimer renderTimer;
+    std::chrono::nanoseconds cpuRenderTime = std::chrono::nanoseconds::zero();
+    // Whether the last frame has been rendered, rather than scanned out directly
+    bool frameRendered = false;
+    // The render time of the last presented frame as reported by the backend, if known
+    std::chrono::nanoseconds gpuRenderTime = std::chrono::nanoseconds::zero();
     int refreshRate = 60000;
+    int minimumRefreshRate = 0;
+    int maximumFrameRate = 0;
+    // repeats the last frame with adaptive sync if no new frame comes in time
+    QTimer compensationTimer;
+    // whether the next frame only repeats the last one
+    bool compensationRepaint = false;
+    std::chrono::nanoseconds lastContentTimestamp = std::chrono::nanoseconds::zero();
     int pendingFrameCount = 0;
     int inhibitCount = 0;
     bool pendingReschedule = false;
     bool pendingRepaint = false;
     RenderLoop::VrrPolicy vrrPolicy = RenderLoop::VrrPolicy::Never;
     std::optional<LatencyPolicy> latencyPolicy;
+    std::optional<int> renderTimePercentile;
     Item *fullscreenItem = nullptr;
+    bool fullscreenTearing = false;
+    std::vector<std::unique_ptr<KWaylandServer::PresentationFeedback>> presentationFeedbacks;
+    // only compared against, it is reset for every frame
+    KWaylandServer::SurfaceInterface *zeroCopySurface = nullptr;
 
     enum class SyncMode {
         Fixed,
         Adaptive,
+        Async,
     };
     SyncMode presentMode = SyncMode::Fixed;
+
+    /**
+     * Returns the mode in which frames should be presented if tearing is not possible.
+     */
+    SyncMode synchronizedPresentMode() const;
 };
 
 } // namespace KWin
@@ -16,6 +16,7 @@
 #include <QFileInfo>
 #include <QRegularExpression>
 #include <QTemporaryFile>
+#include <algorithm>
 #include <kconfig.h>
 
 #ifndef KCMRULES
@@ -126,6 +127,7 @@ void Rules::readFromSettings(const RuleSettings *settings)
     READ_MATCH_STRING(windowrole, .toLower().toLatin1());
     READ_MATCH_STRING(title, );
     READ_MATCH_STRING(clientmachine, .toLower().toLatin1());
+    compileRegularExpressions();
     types = NET::WindowTypeMask(settings->types());
     READ_FORCE_RULE(placement, );
     READ_SET_RULE(position);
@@ -323,6 +325,24 @@ QString Rules::getDecoColor(const QString &themeName)
                                   QLatin1String("color-schemes/") + themeName + QLatin1String(".colors"));
 }
 
+static QRegularExpression compileRegularExpression(Rules::StringMatch match, const QString &pattern)
+{
+    if (match != Rules::RegExpMatch) {
+        return QRegularExpression();
+    }
+    QRegularExpression expression(pattern);
+    expression.optimize();
+    return expression;
+}
+
+void Rules::compileRegularExpressions()
+{
+    wmclassregexp = compileRegularExpression(wmclassmatch, QString::fromUtf8(wmclass));
+    windowroleregexp = compileRegularExpression(windowrolematch, QString::fromUtf8(windowrole));
+    titleregexp = compileRegularExpression(titlematch, title);
+    clientmachineregexp = compileRegularExpression(clientmachinematch, QString::fromUtf8(clientmachine));
+}
+
 bool Rules::matchType(NET::WindowType match_type) const
 {
     if (types != NET::AllTypesMask) {
@@ -339,11 +359,10 @@ bool Rules::matchType(NET::WindowType match_type) const
 bool Rules::matchWMClass(const QByteArray &match_class, const QByteArray &match_name) const
 {
     if (wmclassmatch != UnimportantMatch) {
-        // TODO optimize?
         QByteArray cwmclass = wmclasscomplete
             ? match_name + ' ' + match_class
             : match_class;
-        if (wmclassmatch == RegExpMatch && !QRegularExpression(QString::fromUtf8(wmclass)).match(QString::fromUtf8(cwmclass)).hasMatch()) {
+        if (wmclassmatch == RegExpMatch && !wmclassregexp.match(QString::fromUtf8(cwmclass)).hasMatch()) {
             return false;
         }
         if (wmclassmatch == ExactMatch && wmclass != cwmclass) {
@@ -359,7 +378,7 @@ bool Rules::matchWMClass(const QByteArray &match_class, const QByteArray &match_
 bool Rules::matchRole(const QByteArray &match_role) const
 {
     if (windowrolematch != UnimportantMatch) {
-        if (windowrolematch == RegExpMatch && !QRegularExpression(QString::fromUtf8(windowrole)).match(QString::fromUtf8(match_role)).hasMatch()) {
+        if (windowrolematch == RegExpMatch && !windowroleregexp.match(QString::fromUtf8(match_role)).hasMatch()) {
             return false;
         }
         if (windowrolematch == ExactMatch && windowrole != match_role) {
@@ -375,7 +394,7 @@ bool Rules::matchRole(const QByteArray &match_role) const
 bool Rules::matchTitle(const QString &match_title) const
 {
     if (titlematch != UnimportantMatch) {
-        if (titlematch == RegExpMatch && !QRegularExpression(title).match(match_title).hasMatch()) {
+        if (titlematch == RegExpMatch && !titleregexp.match(match_title).hasMatch()) {
             return false;
         }
         if (titlematch == ExactMatch && title != match_title) {
@@ -397,7 +416,7 @@ bool Rules::matchClientMachine(const QByteArray &match_machine, bool local) cons
             return true;
         }
         if (clientmachinematch == RegExpMatch
-            && !QRegularExpression(QString::fromUtf8(clientmachine)).match(QString::fromUtf8(match_machine)).hasMatch()) {
+            && !clientmachineregexp.match(QString::fromUtf8(match_machine)).hasMatch()) {
             return false;
         }
         if (clientmachinematch == ExactMatch
@@ -414,6 +433,11 @@ bool Rules::matchClientMachine(const QByteArray &match_machine, bool local) cons
 
 #ifndef KCMRULES
 bool Rules::match(const Window *c) const
+{
+    return matchProperties(c) && matchCaption(c);
+}
+
+bool Rules::matchProperties(const Window *c) const
 {
     if (!matchType(c->windowType(true))) {
         return false;
@@ -427,16 +451,18 @@ bool Rules::match(const Window *c) const
     if (!matchClientMachine(c->clientMachine()->hostName(), c->clientMachine()->isLocal())) {
         return false;
     }
+    return true;
+}
+
+bool Rules::matchCaption(const Window *c) const
+{
     if (titlematch != UnimportantMatch) { // track title changes to rematch rules
         QObject::connect(c, &Window::captionChanged, c, &Window::evaluateWindowRules,
                          // QueuedConnection, because title may change before
                          // the client is ready (could segfault!)
                          static_cast<Qt::ConnectionType>(Qt::QueuedConnection | Qt::UniqueConnection));
     }
-    if (!matchTitle(c->captionNormal())) {
-        return false;
-    }
-    return true;
+    return matchTitle(c->captionNormal());
 }
 
 #define NOW_REMEMBER(_T_, _V_) ((selection & _T_) && (_V_##rule == (SetRule)Remember))
@@ -920,29 +946,104 @@ void RuleBook::deleteAll()
 {
     qDeleteAll(m_rules);
     m_rules.clear();
+    rulesChanged();
+}
+
+void RuleBook::rulesChanged()
+{
+    // The cached candidates may point to deleted rules now
+    m_indexDirty = true;
+    ++m_rulesSerial;
+}
+
+void RuleBook::updateIndex()
+{
+    m_exactClassIndex.clear();
+    m_exactCompleteClassIndex.clear();
+    m_unindexedRules.clear();
+    for (int i = 0; i < m_rules.count(); ++i) {
+        const Rules *rule = m_rules[i];
+        if (rule->wmclassmatch != Rules::ExactMatch) {
+            m_unindexedRules.append(i);
+        } else if (rule->wmclasscomplete) {
+            m_exactCompleteClassIndex[rule->wmclass].append(i);
+        } else {
+            m_exactClassIndex[rule->wmclass].append(i);
+        }
+    }
+    m_indexDirty = false;
+}
+
+const QVector<Rules *> &RuleBook::candidateRules(const Window *window)
+{
+    if (m_indexDirty) {
+        updateIndex();
+    }
+
+    auto it = m_matchCache.find(window);
+    if (it == m_matchCache.end()) {
+        connect(window, &QObject::destroyed, this, [this, window]() {
+            m_matchCache.remove(window);
+        });
+        it = m_matchCache.insert(window, MatchCache());
+    }
+
+    // Only the title changes frequently, the other properties are matched again if they change
+    const NET::WindowType type = window->windowType(true);
+    const QByteArray role = window->windowRole().toLower();
+    const QByteArray clientMachine = window->clientMachine()->hostName();
+    const bool localClientMachine = window->clientMachine()->isLocal();
+    if (it->rulesSerial == m_rulesSerial && it->type == type && it->resourceClass == window->resourceClass()
+        && it->resourceName == window->resourceName() && it->role == role
+        && it->clientMachine == clientMachine && it->localClientMachine == localClientMachine) {
+        return it->candidates;
+    }
+
+    it->rulesSerial = m_rulesSerial;
+    it->type = type;
+    it->resourceClass = window->resourceClass();
+    it->resourceName = window->resourceName();
+    it->role = role;
+    it->clientMachine = clientMachine;
+    it->localClientMachine = localClientMachine;
+
+    QVector<int> positions = m_unindexedRules;
+    positions += m_exactClassIndex.value(it->resourceClass);
+    positions += m_exactCompleteClassIndex.value(it->resourceName + ' ' + it->resourceClass);
+    std::sort(positions.begin(), positions.end());
+
+    it->candidates.clear();
+    for (int position : qAsConst(positions)) {
+        Rules *rule = m_rules[position];
+        if (rule->matchProperties(window)) {
+            it->candidates.append(rule);
+        }
+    }
+    return it->candidates;
 }
 
 WindowRules RuleBook::find(const Window *c, bool ignore_temporary)
 {
     QVector<Rules *> ret;
-    for (QList<Rules *>::Iterator it = m_rules.begin();
-         it != m_rules.end();) {
-        if (ignore_temporary && (*it)->isTemporary()) {
-            ++it;
+    QVector<Rules *> usedTemporary;
+    const QVector<Rules *> candidates = candidateRules(c);
+    for (Rules *rule : candidates) {
+        if (ignore_temporary && rule->isTemporary()) {
             continue;
         }
-        if ((*it)->match(c)) {
-            Rules *rule = *it;
+        if (rule->matchCaption(c)) {
             qCDebug(KWIN_CORE) << "Rule found:" << rule << ":" << c;
             if (rule->isTemporary()) {
-                it = m_rules.erase(it);
-            } else {
-                ++it;
+                usedTemporary.append(rule);
             }
             ret.append(rule);
-            continue;
         }
-        ++it;
+    }
+    if (!usedTemporary.isEmpty()) {
+        for (Rules *rule : qAsConst(usedTemporary)) {
+            m_rules.removeOne(rule);
+        }
+        rulesChanged();
     }
     return WindowRules(ret);
 }
@@ -981,6 +1082,7 @@ void RuleBook::load()
     RuleBookSettings book(m_config);
     book.load();
     m_rules = book.rules().toList();
+    rulesChanged();
 }
 
 void RuleBook::save()
@@ -1013,6 +1115,7 @@ void RuleBook::temporaryRulesMessage(const QString &message)
     }
     Rules *rule = new Rules(message, true);
     m_rules.prepend(rule); // highest priority first
+    rulesChanged();
     if (!was_temporary) {
         QTimer::singleShot(60000, this, &RuleBook::cleanupTemporaryRules);
     }
@@ -1025,6 +1128,7 @@ void RuleBook::cleanupTemporaryRules()
          it != m_rules.end();) {
         if ((*it)->discardTemporary(false)) { // deletes (*it)
             it = m_rules.erase(it);
+            rulesChanged();
         } else {
             if ((*it)->isTemporary()) {
                 has_temporary = true;
@@ -1051,6 +1155,7 @@ void RuleBook::discardUsed(Window *c, bool withdrawn)
                 Rules *r = *it;
                 it = m_rules.erase(it);
                 delete r;
+                rulesChanged();
                 continue;
             }
         }
@@ -10,7 +10,9 @@
 #ifndef KWIN_RULES_H
 #define KWIN_RULES_H
 
+#include <QHash>
 #include <QRect>
+#include <QRegularExpression>
 #include <QVector>
 #include <netwm_def.h>
 
@@ -148,6 +150,16 @@ public:
 #ifndef KCMRULES
     bool discardUsed(bool withdrawn);
     bool match(const Window *c) const;
+    /**
+     * Returns @c true if the window type, class, role and client machine of @a c match,
+     * i.e. everything that match() checks except for the title.
+     */
+    bool matchProperties(const Window *c) const;
+    /**
+     * Returns @c true if the title of @a c matches. Rules that match the title are
+     * reevaluated when the caption of @a c changes.
+     */
+    bool matchCaption(const Window *c) const;
     bool update(Window *, int selection);
     bool isTemporary() const;
     bool discardTemporary(bool force); // removes if temporary and forced or too old
@@ -201,6 +213,7 @@ private:
 private:
 #endif
     void readFromSettings(const RuleSettings *settings);
+    void compileRegularExpressions();
     static ForceRule convertForceRule(int v);
     static QString getDecoColor(const QString &themeName);
 #ifndef KCMRULES
@@ -220,6 +233,11 @@ private:
     StringMatch titlematch;
     QByteArray clientmachine;
     StringMatch clientmachinematch;
+    // Compiled once when the rule is read, only used with RegExpMatch
+    QRegularExpression wmclassregexp;
+    QRegularExpression windowroleregexp;
+    QRegularExpression titleregexp;
+    QRegularExpression clientmachineregexp;
     NET::WindowTypes types; // types for matching
     Placement::Policy placement;
     ForceRule placementrule;
@@ -294,6 +312,9 @@ private:
     QString desktopfile;
     SetRule desktopfilerule;
     friend QDebug &operator<<(QDebug &stream, const Rules *);
+#ifndef KCMRULES
+    friend class RuleBook;
+#endif
 };
 
 #ifndef KCMRULES
@@ -321,12 +342,35 @@ private Q_SLOTS:
     void save();
 
 private:
+    struct MatchCache
+    {
+        quint64 rulesSerial = 0;
+        NET::WindowType type = NET::Unknown;
+        QByteArray resourceClass;
+        QByteArray resourceName;
+        QByteArray role;
+        QByteArray clientMachine;
+        bool localClientMachine = false;
+        // The rules that match everything but the title, in priority order
+        QVector<Rules *> candidates;
+    };
+
     void deleteAll();
     void initializeX11();
     void cleanupX11();
+    void rulesChanged();
+    void updateIndex();
+    const QVector<Rules *> &candidateRules(const Window *window);
     QTimer *m_updateTimer;
     bool m_updatesDisabled;
     QList<Rules *> m_rules;
+    // Positions in m_rules of the rules that match an exact window class, and of all other rules
+    QHash<QByteArray, QVector<int>> m_exactClassIndex;
+    QHash<QByteArray, QVector<int>> m_exactCompleteClassIndex;
+    QVector<int> m_unindexedRules;
+    bool m_indexDirty = true;
+    quint64 m_rulesSerial = 1;
+    QHash<const Window *, MatchCache> m_matchCache;
     QScopedPointer<KXMessages> m_temporaryRulesMessages;
     KSharedConfig::Ptr m_config;
 
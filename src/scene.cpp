@@ -54,12 +54,14 @@
 
 #include "scene.h"
 #include "internalwindow.h"
+#include "options.h"
 #include "output.h"
 #include "platform.h"
 #include "renderlayer.h"
 #include "shadowitem.h"
 #include "surfaceitem.h"
 #include "unmanaged.h"
+#include "wayland/presentationtime_interface.h"
 #include "wayland/surface_interface.h"
 #include "waylandwindow.h"
 #include "windowitem.h"
@@ -111,6 +113,11 @@ SurfaceItem *SceneDelegate::scanoutCandidate() const
     return m_scene->scanoutCandidate();
 }
 
+QVector<SurfaceItem *> SceneDelegate::overlayCandidates() const
+{
+    return m_scene->overlayCandidates();
+}
+
 void SceneDelegate::prePaint()
 {
     m_scene->prePaint(m_output);
@@ -161,17 +168,35 @@ void Scene::addRepaintFull()
 
 void Scene::addRepaint(int x, int y, int width, int height)
 {
-    addRepaint(QRegion(x, y, width, height));
+    addRepaint(QRect(x, y, width, height));
+}
+
+void Scene::addRepaint(const QRect &rect)
+{
+    for (const auto &delegate : std::as_const(m_delegates)) {
+        const QRect viewport = delegate->viewport();
+        const QRect dirtyRect = rect & viewport;
+        if (!dirtyRect.isEmpty()) {
+            delegate->layer()->addRepaint(dirtyRect.translated(-viewport.topLeft()));
+        }
+    }
 }
 
 void Scene::addRepaint(const QRegion &region)
 {
+    // Mark the rects one by one rather than intersecting the region with every viewport,
+    // the repaints of a layer are merged into tiles if they get too fragmented
     for (const auto &delegate : std::as_const(m_delegates)) {
         const QRect viewport = delegate->viewport();
-        QRegion dirtyRegion = region & viewport;
-        dirtyRegion.translate(-viewport.topLeft());
-        if (!dirtyRegion.isEmpty()) {
-            delegate->layer()->addRepaint(dirtyRegion);
+        if (!region.boundingRect().intersects(viewport)) {
+            continue;
+        }
+        RenderLayer *layer = delegate->layer();
+        for (const QRect &rect : region) {
+            const QRect dirtyRect = rect & viewport;
+            if (!dirtyRect.isEmpty()) {
+                layer->addRepaint(dirtyRect.translated(-viewport.topLeft()));
+            }
         }
     }
 }
@@ -258,6 +283,39 @@ SurfaceItem *Scene::scanoutCandidate() const
     return candidate;
 }
 
+QVector<SurfaceItem *> Scene::overlayCandidates() const
+{
+    if (!waylandServer() || static_cast<EffectsHandlerImpl *>(effects)->blocksDirectScanout()) {
+        return {};
+    }
+
+    // Overlay planes are stacked above the primary plane, so a surface can only be moved to
+    // an overlay plane if nothing painted above it overlaps it.
+    QVector<SurfaceItem *> candidates;
+    QRegion occupied;
+    for (int i = stacking_order.count() - 1; i >= 0; i--) {
+        WindowItem *windowItem = stacking_order[i];
+        Window *window = windowItem->window();
+        if (!window->isOnOutput(painted_screen) || window->opacity() == 0) {
+            continue;
+        }
+        const QRect windowRect = windowItem->mapToGlobal(windowItem->boundingRect());
+        if (window->isClient() && window->opacity() == 1.0 && windowItem->surfaceItem()) {
+            SurfaceItem *topMost = findTopMostSurface(windowItem->surfaceItem());
+            if (auto pixmap = topMost->pixmap()) {
+                pixmap->update();
+                const QRect surfaceRect = topMost->mapToGlobal(topMost->rect());
+                const bool opaque = !pixmap->hasAlphaChannel() || topMost->opaque().contains(topMost->rect());
+                if (opaque && !occupied.intersects(surfaceRect) && painted_screen->geometry().contains(surfaceRect)) {
+                    candidates.append(topMost);
+                }
+            }
+        }
+        occupied += windowRect;
+    }
+    return candidates;
+}
+
 void Scene::prePaint(Output *output)
 {
     createStackingOrder();
@@ -297,6 +355,8 @@ void Scene::prePaint(Output *output)
     m_paintContext.damage = prePaintData.paint;
     m_paintContext.mask = prePaintData.mask;
     m_paintContext.phase2Data.clear();
+    m_paintContext.occludedItems.clear();
+    m_paintContext.occludedWindows.clear();
 
     if (m_paintContext.mask & (PAINT_SCREEN_TRANSFORMED | PAINT_SCREEN_WITH_TRANSFORMED_WINDOWS)) {
         preparePaintGenericScreen();
@@ -315,10 +375,9 @@ static void resetRepaintsHelper(Item *item, Output *output)
     }
 }
 
-static void accumulateRepaints(Item *item, Output *output, QRegion *repaints)
+static void accumulateRepaints(Item *item, Output *output, CompactRegion *repaints)
 {
-    *repaints += item->repaints(output);
-    item->resetRepaints(output);
+    item->takeRepaints(output, repaints);
 
     const auto childItems = item->childItems();
     for (Item *childItem : childItems) {
@@ -353,7 +412,9 @@ void Scene::preparePaintSimpleScreen()
         Window *window = windowItem->window();
         WindowPrePaintData data;
         data.mask = m_paintContext.mask;
-        accumulateRepaints(windowItem, painted_screen, &data.paint);
+        CompactRegion repaints;
+        accumulateRepaints(windowItem, painted_screen, &repaints);
+        data.paint = repaints.isTiled() ? repaints.toRegion() & renderTargetRect() : repaints.toRegion();
 
         // Clip out the decoration for opaque windows; the decoration is drawn in the second pass.
         if (window->opacity() == 1.0) {
@@ -377,17 +438,66 @@ void Scene::preparePaintSimpleScreen()
         });
     }
 
-    // Perform an occlusion cull pass, remove surface damage occluded by opaque windows.
+    // Perform an occlusion cull pass, remove surface damage occluded by opaque windows
+    // and find the items that are entirely hidden behind opaque items.
     QRegion opaque;
     for (int i = m_paintContext.phase2Data.size() - 1; i >= 0; --i) {
         const auto &paintData = m_paintContext.phase2Data.at(i);
         m_paintContext.damage += paintData.region - opaque;
+        if (!(paintData.mask & PAINT_WINDOW_TRANSFORMED)) {
+            // Only other windows count for frame callback throttling, a window that covers
+            // its main surface with its own opaque subsurfaces, e.g. a video player, is visible
+            if (const SurfaceItem *surfaceItem = paintData.item->surfaceItem()) {
+                const QRect rect = surfaceItem->mapToGlobal(surfaceItem->rect()) & renderTargetRect();
+                if ((QRegion(rect) - opaque).isEmpty()) {
+                    m_paintContext.occludedWindows.insert(paintData.item);
+                }
+            }
+            QRegion windowOpaque = opaque;
+            const bool opaqueItems = !(paintData.mask & PAINT_WINDOW_TRANSLUCENT) && paintData.item->window()->opacity() == 1.0;
+            cullOccludedItems(paintData.item, &windowOpaque, opaqueItems);
+        }
         if (!(paintData.mask & (PAINT_WINDOW_TRANSLUCENT | PAINT_WINDOW_TRANSFORMED))) {
             opaque += paintData.opaque;
         }
     }
 }
 
+void Scene::cullOccludedItems(Item *item, QRegion *opaque, bool opaqueItems)
+{
+    const QList<Item *> sortedChildItems = item->sortedChildItems();
+    opaqueItems = opaqueItems && item->opacity() == 1.0;
+
+    // Walk the item tree front to back, the children above the item come first
+    auto it = sortedChildItems.crbegin();
+    for (; it != sortedChildItems.crend() && (*it)->z() >= 0; ++it) {
+        if ((*it)->explicitVisible()) {
+            cullOccludedItems(*it, opaque, opaqueItems);
+        }
+    }
+
+    const QRect rect = item->mapToGlobal(item->rect()) & renderTargetRect();
+    if ((QRegion(rect) - *opaque).isEmpty()) {
+        m_paintContext.occludedItems.insert(item);
+    } else if (opaqueItems) {
+        *opaque += item->mapToGlobal(item->opaque());
+    }
+
+    for (; it != sortedChildItems.crend(); ++it) {
+        if ((*it)->explicitVisible()) {
+            cullOccludedItems(*it, opaque, opaqueItems);
+        }
+    }
+}
+
+bool Scene::isItemOccluded(const Item *item, int mask) const
+{
+    if (!m_paintContext.skipOccludedItems || (mask & (PAINT_WINDOW_TRANSFORMED | PAINT_SCREEN_TRANSFORMED))) {
+        return false;
+    }
+    return m_paintContext.occludedItems.contains(item);
+}
+
 void Scene::postPaint()
 {
     for (WindowItem *w : std::as_const(stacking_order)) {
@@ -399,14 +509,47 @@ void Scene::postPaint()
     if (waylandServer()) {
         const std::chrono::milliseconds frameTime =
             std::chrono::duration_cast<std::chrono::milliseconds>(painted_screen->renderLoop()->lastPresentationTimestamp());
+        KWaylandServer::OutputInterface *waylandOutput = waylandServer()->findWaylandOutput(painted_screen);
+
+        // Windows whose surface is hidden behind other opaque windows are throttled. If windows can be
+        // transformed, it's not known which ones are visible, so all windows are considered visible.
+        // The hidden items are only known if the screen has been painted in the optimized way.
+        const std::chrono::milliseconds occludedInterval(options->occludedFrameCallbackInterval());
 
-        for (WindowItem *windowItem : std::as_const(stacking_order)) {
+        for (int i = m_paintContext.phase2Data.size() - 1; i >= 0; --i) {
+            const Phase2Data &paintData = m_paintContext.phase2Data.at(i);
+            WindowItem *windowItem = paintData.item;
             Window *window = windowItem->window();
             if (!window->isOnOutput(painted_screen)) {
                 continue;
             }
+
+            // Windows shown in thumbnails or window screencasts are visible elsewhere
+            const bool occluded = m_paintContext.occludedWindows.contains(windowItem) && !window->isOffscreenRendering();
+
             if (auto surface = window->surface()) {
+                if (occluded) {
+                    if (occludedInterval == std::chrono::milliseconds::zero()
+                        || frameTime - windowItem->lastFrameCallbackTimestamp() < occludedInterval) {
+                        continue;
+                    }
+                }
                 surface->frameRendered(frameTime.count());
+                windowItem->setLastFrameCallbackTimestamp(frameTime);
+                if (auto feedback = surface->takePresentationFeedback(waylandOutput)) {
+                    painted_screen->renderLoop()->addPresentationFeedback(surface, std::move(feedback));
+                }
+            }
+        }
+    }
+
+    // Let X11 clients that use the frame synchronization protocol start drawing their next frame,
+    // on X11 all outputs are painted at once
+    const bool paintsAllOutputs = kwinApp()->operationMode() == Application::OperationModeX11;
+    for (WindowItem *windowItem : std::as_const(stacking_order)) {
+        if (auto x11Window = qobject_cast<X11Window *>(windowItem->window())) {
+            if (paintsAllOutputs || x11Window->isOnOutput(painted_screen)) {
+                x11Window->sendFrameDrawn(painted_screen->renderLoop());
             }
         }
     }
@@ -538,9 +681,11 @@ void Scene::paintSimpleScreen(int, const QRegion &region)
 
     paintBackground(visible);
 
+    m_paintContext.skipOccludedItems = true;
     for (const Phase2Data &paintData : std::as_const(m_paintContext.phase2Data)) {
         paintWindow(paintData.item, paintData.mask, paintData.region);
     }
+    m_paintContext.skipOccludedItems = false;
 }
 
 void Scene::createStackingOrder()
@@ -600,6 +745,19 @@ void Scene::finalDrawWindow(EffectWindowImpl *w, int mask, const QRegion &region
     render(w->windowItem(), mask, region, data);
 }
 
+RenderTarget *Scene::beginColorTransformation(Output *output, RenderTarget *renderTarget, QRegion *damage)
+{
+    Q_UNUSED(output)
+    Q_UNUSED(damage)
+    return renderTarget;
+}
+
+void Scene::endColorTransformation(Output *output, const QRegion &damage)
+{
+    Q_UNUSED(output)
+    Q_UNUSED(damage)
+}
+
 bool Scene::makeOpenGLContextCurrent()
 {
     return false;
@@ -19,6 +19,7 @@
 
 #include <QElapsedTimer>
 #include <QMatrix4x4>
+#include <QSet>
 
 namespace KWin
 {
@@ -58,6 +59,7 @@ public:
 
     QRegion repaints() const override;
     SurfaceItem *scanoutCandidate() const override;
+    QVector<SurfaceItem *> overlayCandidates() const override;
     void prePaint() override;
     void postPaint() override;
     void paint(RenderTarget *renderTarget, const QRegion &region) override;
@@ -81,6 +83,7 @@ public:
      * Schedules a repaint for the specified @a region.
      */
     void addRepaint(const QRegion &region);
+    void addRepaint(const QRect &rect);
     void addRepaint(int x, int y, int width, int height);
     void addRepaintFull();
     QRegion damage() const;
@@ -96,10 +99,26 @@ public:
     virtual bool initFailed() const = 0;
 
     SurfaceItem *scanoutCandidate() const;
-    void prePaint(Output *output);
+    QVector<SurfaceItem *> overlayCandidates() const;
+    virtual void prePaint(Output *output);
     void postPaint();
     virtual void paint(RenderTarget *renderTarget, const QRegion &region) = 0;
 
+    /**
+     * Starts painting a frame of the @a output into @a renderTarget. If the output has a
+     * composited color transformation, which the scene can apply, an offscreen render target
+     * is returned, otherwise @a renderTarget. The @a damage, in output local coordinates, is
+     * extended if the whole output has to be painted.
+     *
+     * The default implementation returns @a renderTarget.
+     */
+    virtual RenderTarget *beginColorTransformation(Output *output, RenderTarget *renderTarget, QRegion *damage);
+    /**
+     * Draws the @a damage painted in the offscreen render target into the real render target,
+     * with the color transformation applied.
+     */
+    virtual void endColorTransformation(Output *output, const QRegion &damage);
+
     /**
      * @brief Creates the Scene specific Shadow subclass.
      *
@@ -202,12 +221,19 @@ protected:
     // called after all effects had their paintWindow() called
     void finalPaintWindow(EffectWindowImpl *w, int mask, const QRegion &region, WindowPaintData &data);
     // shared implementation, starts painting the window
-    void paintWindow(WindowItem *w, int mask, const QRegion &region);
+    virtual void paintWindow(WindowItem *w, int mask, const QRegion &region);
     // called after all effects had their drawWindow() called
     void finalDrawWindow(EffectWindowImpl *w, int mask, const QRegion &region, WindowPaintData &data);
 
     virtual void paintOffscreenQuickView(OffscreenQuickView *w) = 0;
 
+    /**
+     * Returns @c true if the given @a item is entirely hidden behind opaque items while the
+     * windows are being painted in the optimized way. Hidden items need neither be
+     * preprocessed nor drawn. Items drawn with a transformation are never considered hidden.
+     */
+    bool isItemOccluded(const Item *item, int mask) const;
+
     // saved data for 2nd pass of optimized screen painting
     struct Phase2Data
     {
@@ -222,6 +248,10 @@ protected:
         QRegion damage;
         int mask = 0;
         QVector<Phase2Data> phase2Data;
+        QSet<const Item *> occludedItems;
+        // Windows whose main surface is hidden behind other windows
+        QSet<const WindowItem *> occludedWindows;
+        bool skipOccludedItems = false;
     };
 
     // The screen that is being currently painted
@@ -231,6 +261,8 @@ protected:
     QVector<WindowItem *> stacking_order;
 
 private:
+    void cullOccludedItems(Item *item, QRegion *opaque, bool opaqueItems);
+
     std::chrono::milliseconds m_expectedPresentTimestamp = std::chrono::milliseconds::zero();
     QList<SceneDelegate *> m_delegates;
     QRect m_geometry;
@@ -0,0 +1,258 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "colortransformationpass.h"
+#include "colors/colorlut3d.h"
+#include "colors/colortransformation.h"
+#include "output.h"
+#include "renderloop.h"
+#include "utils/common.h"
+
+#include <kwinglplatform.h>
+#include <kwinglutils.h>
+
+#include <QMatrix4x4>
+#include <QVector2D>
+#include <QtConcurrent>
+
+namespace KWin
+{
+
+// The number of lattice points per color channel, 33 is what ICC based pipelines commonly use
+static const int s_lutSize = 33;
+
+ColorTransformationPass::ColorTransformationPass(Output *output, QObject *parent)
+    : QObject(parent)
+    , m_output(output)
+{
+    connect(output, &Output::compositedColorTransformationChanged, this, &ColorTransformationPass::scheduleBake);
+    connect(&m_bakeWatcher, &QFutureWatcher<QSharedPointer<ColorLUT3D>>::finished, this, &ColorTransformationPass::handleBakeFinished);
+    scheduleBake();
+}
+
+ColorTransformationPass::~ColorTransformationPass()
+{
+    m_bakeWatcher.waitForFinished();
+    if (m_lutTexture) {
+        glDeleteTextures(1, &m_lutTexture);
+    }
+}
+
+bool ColorTransformationPass::supported()
+{
+    if (!GLFramebuffer::supported()) {
+        return false;
+    }
+    return !GLPlatform::instance()->isGLES() || hasGLVersion(3, 0);
+}
+
+void ColorTransformationPass::scheduleBake()
+{
+    if (m_bakeWatcher.isRunning()) {
+        m_bakePending = true;
+        return;
+    }
+
+    const QSharedPointer<ColorTransformation> transformation = m_output->compositedColorTransformation();
+    if (!transformation) {
+        m_pendingLut.reset();
+        m_lutSize = 0;
+        m_output->renderLoop()->scheduleRepaint();
+        return;
+    }
+
+    m_bakePending = false;
+    m_bakeWatcher.setFuture(QtConcurrent::run([transformation]() {
+        return QSharedPointer<ColorLUT3D>::create(transformation, s_lutSize);
+    }));
+}
+
+void ColorTransformationPass::handleBakeFinished()
+{
+    const QSharedPointer<ColorLUT3D> lut = m_bakeWatcher.result();
+    if (m_bakePending) {
+        scheduleBake();
+        return;
+    }
+    if (lut->transformation() == m_output->compositedColorTransformation()) {
+        m_pendingLut = lut;
+        m_output->renderLoop()->scheduleRepaint();
+    }
+}
+
+bool ColorTransformationPass::uploadLut()
+{
+    const int size = m_pendingLut->size();
+    const uint16_t *data = m_pendingLut->data();
+
+    if (!m_lutTexture) {
+        glGenTextures(1, &m_lutTexture);
+        glBindTexture(GL_TEXTURE_3D, m_lutTexture);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    } else {
+        glBindTexture(GL_TEXTURE_3D, m_lutTexture);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    if (GLPlatform::instance()->isGLES()) {
+        // OpenGL ES has no normalized 16 bit formats without extensions
+        QVector<float> floatData(3 * size * size * size);
+        for (int i = 0; i < floatData.size(); ++i) {
+            floatData[i] = data[i] / 65535.0;
+        }
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, size, size, size, 0, GL_RGB, GL_FLOAT, floatData.constData());
+    } else {
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16, size, size, size, 0, GL_RGB, GL_UNSIGNED_SHORT, data);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    m_lutSize = size;
+    m_pendingLut.reset();
+    return glGetError() == GL_NO_ERROR;
+}
+
+bool ColorTransformationPass::ensureShader()
+{
+    if (m_shader) {
+        return m_shader->isValid();
+    }
+
+    const bool gles = GLPlatform::instance()->isGLES();
+    const bool glsl_140 = !gles && GLPlatform::instance()->glslVersion() >= kVersionNumber(1, 40);
+    const bool core = glsl_140 || gles;
+
+    QByteArray header;
+    if (gles) {
+        header += "#version 300 es\n\nprecision highp float;\nprecision highp sampler3D;\n";
+    } else if (glsl_140) {
+        header += "#version 140\n\n";
+    }
+
+    QByteArray vertexSource = header;
+    vertexSource += "uniform mat4 modelViewProjectionMatrix;\n";
+    vertexSource += core ? "in vec4 vertex;\n" : "attribute vec4 vertex;\n";
+    vertexSource += "void main(void)\n"
+                    "{\n"
+                    "    gl_Position = modelViewProjectionMatrix * vertex;\n"
+                    "}\n";
+
+    QByteArray fragmentSource = header;
+    fragmentSource += "uniform sampler2D sampler;\n"
+                      "uniform sampler3D lut;\n"
+                      "uniform vec2 renderTargetSize;\n"
+                      "uniform float lutSize;\n";
+    if (core) {
+        fragmentSource += "out vec4 fragColor;\n";
+    }
+    fragmentSource += "void main(void)\n"
+                      "{\n";
+    fragmentSource += core ? "    vec4 color = texture(sampler, gl_FragCoord.xy / renderTargetSize);\n"
+                           : "    vec4 color = texture2D(sampler, gl_FragCoord.xy / renderTargetSize);\n";
+    // sample at the centers of the lattice points at the edges of the lookup table
+    fragmentSource += "    vec3 coordinate = color.rgb * ((lutSize - 1.0) / lutSize) + 0.5 / lutSize;\n";
+    fragmentSource += core ? "    fragColor = vec4(texture(lut, coordinate).rgb, color.a);\n"
+                           : "    gl_FragColor = vec4(texture3D(lut, coordinate).rgb, color.a);\n";
+    fragmentSource += "}\n";
+
+    m_shader.reset(ShaderManager::instance()->loadShaderFromCode(vertexSource, fragmentSource));
+    if (!m_shader->isValid()) {
+        qCWarning(KWIN_OPENGL) << "Failed to compile the color transformation shader";
+        return false;
+    }
+
+    ShaderBinder binder(m_shader.get());
+    m_shader->setUniform("sampler", 0);
+    m_shader->setUniform("lut", 1);
+    return true;
+}
+
+GLFramebuffer *ColorTransformationPass::begin(const QSize &size, bool *repaintAll)
+{
+    if (m_pendingLut) {
+        if (!uploadLut()) {
+            qCWarning(KWIN_OPENGL) << "Failed to upload the color lookup table of" << m_output->name();
+        }
+        *repaintAll = true;
+    }
+
+    const bool active = m_lutSize > 0 && m_output->compositedColorTransformation() && ensureShader();
+    if (active != m_active) {
+        // the frames in the swapchain have been painted with the other pipeline
+        m_active = active;
+        *repaintAll = true;
+    }
+    if (!active) {
+        m_framebuffer.reset();
+        m_texture.reset();
+        return nullptr;
+    }
+
+    if (!m_texture || m_texture->size() != size) {
+        m_framebuffer.reset();
+        m_texture = std::make_unique<GLTexture>(GL_RGBA8, size);
+        m_texture->setFilter(GL_NEAREST);
+        m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_framebuffer = std::make_unique<GLFramebuffer>(m_texture.get());
+        *repaintAll = true;
+    }
+    if (!m_framebuffer->valid()) {
+        return nullptr;
+    }
+    return m_framebuffer.get();
+}
+
+void ColorTransformationPass::end(const QRegion &region)
+{
+    if (region.isEmpty()) {
+        return;
+    }
+
+    QVector<float> vertices;
+    vertices.reserve(region.rectCount() * 6 * 2);
+    for (const QRect &r : region) {
+        vertices << r.x() + r.width() << r.y();
+        vertices << r.x() << r.y();
+        vertices << r.x() << r.y() + r.height();
+        vertices << r.x() << r.y() + r.height();
+        vertices << r.x() + r.width() << r.y() + r.height();
+        vertices << r.x() + r.width() << r.y();
+    }
+    if (!m_vbo) {
+        m_vbo = std::make_unique<GLVertexBuffer>(GLVertexBuffer::Stream);
+    }
+    m_vbo->reset();
+    m_vbo->setData(vertices.count() / 2, 2, vertices.constData(), nullptr);
+
+    const QSize size = m_texture->size();
+    QMatrix4x4 projectionMatrix;
+    projectionMatrix.ortho(0, size.width(), size.height(), 0, -1, 1);
+
+    ShaderBinder binder(m_shader.get());
+    m_shader->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix);
+    m_shader->setUniform("renderTargetSize", QVector2D(size.width(), size.height()));
+    m_shader->setUniform("lutSize", float(m_lutSize));
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, m_lutTexture);
+    glActiveTexture(GL_TEXTURE0);
+    m_texture->bind();
+
+    glDisable(GL_BLEND);
+    m_vbo->render(GL_TRIANGLES);
+
+    m_texture->unbind();
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+} // namespace KWin
@@ -0,0 +1,90 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QFutureWatcher>
+#include <QObject>
+#include <QRegion>
+#include <QSharedPointer>
+
+#include <epoxy/gl.h>
+
+#include <memory>
+
+namespace KWin
+{
+
+class ColorLUT3D;
+class GLFramebuffer;
+class GLShader;
+class GLTexture;
+class GLVertexBuffer;
+class Output;
+
+/**
+ * The ColorTransformationPass class applies the composited color transformation of an output,
+ * which the display hardware can't apply, e.g. because it mixes the color channels.
+ *
+ * The output is painted into an offscreen texture, which is then drawn into the real render
+ * target through a 3D lookup table baked from the color transformation. The lookup table is
+ * baked in a worker thread, until it's ready the previous one keeps being used, so night color
+ * transitions don't hold up the compositor.
+ *
+ * The pass must only be used while the OpenGL context of the scene is current.
+ *
+ * @since 5.26
+ */
+class KWIN_EXPORT ColorTransformationPass : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ColorTransformationPass(Output *output, QObject *parent = nullptr);
+    ~ColorTransformationPass() override;
+
+    /**
+     * Returns @c true if the OpenGL implementation supports 3D textures.
+     */
+    static bool supported();
+
+    /**
+     * Returns the offscreen framebuffer in which a frame of the given @a size should be
+     * painted, or @c null if the frame can be painted into the real render target. If the
+     * whole output has to be painted, @a repaintAll will be set to @c true.
+     */
+    GLFramebuffer *begin(const QSize &size, bool *repaintAll);
+
+    /**
+     * Draws the @a region of the offscreen texture, in device pixels, into the current
+     * framebuffer with the color transformation applied.
+     */
+    void end(const QRegion &region);
+
+private:
+    void scheduleBake();
+    void handleBakeFinished();
+    bool uploadLut();
+    bool ensureShader();
+
+    Output *m_output;
+    QFutureWatcher<QSharedPointer<ColorLUT3D>> m_bakeWatcher;
+    bool m_bakePending = false;
+    QSharedPointer<ColorLUT3D> m_pendingLut;
+
+    GLuint m_lutTexture = 0;
+    int m_lutSize = 0;
+    std::unique_ptr<GLShader> m_shader;
+    std::unique_ptr<GLTexture> m_texture;
+    std::unique_ptr<GLFramebuffer> m_framebuffer;
+    std::unique_ptr<GLVertexBuffer> m_vbo;
+    bool m_active = false;
+};
+
+} // namespace KWin
@@ -0,0 +1,76 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "cursortexturecache.h"
+
+#include <kwingltexture.h>
+
+namespace KWin
+{
+
+// The budget of video memory for cursor textures, the cursors of all outputs and screencasts
+// usually fit in a fraction of it
+static const qsizetype s_maximumCost = 4 * 1024 * 1024;
+
+CursorTextureCache::CursorTextureCache()
+{
+}
+
+CursorTextureCache::~CursorTextureCache()
+{
+}
+
+std::shared_ptr<GLTexture> CursorTextureCache::texture(const QImage &image)
+{
+    if (image.isNull()) {
+        return nullptr;
+    }
+
+    const qint64 key = image.cacheKey();
+    for (int i = m_entries.count() - 1; i >= 0; --i) {
+        if (m_entries[i].key == key) {
+            Entry entry = m_entries.takeAt(i);
+            m_entries.append(entry);
+            return entry.texture;
+        }
+    }
+
+    // Reuse the least recently used texture that has the same size and no other users.
+    for (int i = 0; i < m_entries.count(); ++i) {
+        Entry &entry = m_entries[i];
+        if (entry.texture.use_count() == 1 && entry.texture->size() == image.size()) {
+            entry.texture->update(image);
+            entry.key = key;
+            Entry reused = m_entries.takeAt(i);
+            m_entries.append(reused);
+            return reused.texture;
+        }
+    }
+
+    auto texture = std::make_shared<GLTexture>(image);
+    texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    const qsizetype cost = image.sizeInBytes();
+    m_entries.append(Entry{key, texture, cost});
+    m_cost += cost;
+    evict();
+    return texture;
+}
+
+void CursorTextureCache::evict()
+{
+    // Textures that are still in use are kept, the last entry is the one that was just added.
+    for (int i = 0; i < m_entries.count() - 1 && m_cost > s_maximumCost;) {
+        if (m_entries[i].texture.use_count() == 1) {
+            m_cost -= m_entries[i].cost;
+            m_entries.removeAt(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+} // namespace KWin
@@ -0,0 +1,62 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QImage>
+#include <QVector>
+
+#include <memory>
+
+namespace KWin
+{
+
+class GLTexture;
+
+/**
+ * The CursorTextureCache class shares the textures of cursor images between the cursor
+ * layers of all outputs and the screencast streams.
+ *
+ * Textures are looked up by the cache key of the cursor image, which identifies the shape and
+ * the frame of a theme cursor as well as every buffer committed by a client. The least recently
+ * used textures are evicted once the cache exceeds its budget. A texture of the same size that
+ * is not in use anymore is updated in place rather than allocating a new one, so animated client
+ * cursors don't allocate a texture per frame.
+ *
+ * The cache must only be used while the OpenGL context of the scene is current.
+ *
+ * @since 5.26
+ */
+class KWIN_EXPORT CursorTextureCache
+{
+public:
+    CursorTextureCache();
+    ~CursorTextureCache();
+
+    /**
+     * Returns the texture for the given cursor @a image, or @c null if the image is null.
+     */
+    std::shared_ptr<GLTexture> texture(const QImage &image);
+
+private:
+    struct Entry
+    {
+        qint64 key;
+        std::shared_ptr<GLTexture> texture;
+        qsizetype cost;
+    };
+
+    void evict();
+
+    // ordered from the least to the most recently used texture
+    QVector<Entry> m_entries;
+    qsizetype m_cost = 0;
+};
+
+} // namespace KWin
@@ -0,0 +1,157 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "quadclipper.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace KWin
+{
+
+QuadClipper::QuadClipper(const QRegion &region)
+{
+    m_rects.reserve(region.rectCount());
+    for (const QRect &rect : region) {
+        m_rects.append(Rect{{
+            float(rect.x()),
+            float(rect.y()),
+            -float(rect.x() + rect.width()),
+            -float(rect.y() + rect.height()),
+        }});
+    }
+}
+
+int QuadClipper::firstCandidate(float top) const
+{
+    // QRegion stores rectangles in y-x banded order, so the bottom edges are sorted.
+    auto it = std::upper_bound(m_rects.constBegin(), m_rects.constEnd(), top, [](float value, const Rect &rect) {
+        return value < -rect.bounds[3];
+    });
+    return it - m_rects.constBegin();
+}
+
+enum class Overlap {
+    None,
+    Partial,
+    Full,
+};
+
+static inline Overlap overlap(const float *quad, const float *rect)
+{
+#if defined(__SSE2__)
+    const __m128 q = _mm_loadu_ps(quad);
+    const __m128 m = _mm_max_ps(q, _mm_load_ps(rect));
+    // Compare (left, top) against (right, bottom), which are stored negated.
+    const __m128 farEdges = _mm_sub_ps(_mm_setzero_ps(), _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+    if ((_mm_movemask_ps(_mm_cmplt_ps(m, farEdges)) & 0x3) != 0x3) {
+        return Overlap::None;
+    }
+    return _mm_movemask_ps(_mm_cmpeq_ps(m, q)) == 0xf ? Overlap::Full : Overlap::Partial;
+#elif defined(__ARM_NEON)
+    const float32x4_t q = vld1q_f32(quad);
+    const float32x4_t m = vmaxq_f32(q, vld1q_f32(rect));
+    const float32x4_t farEdges = vnegq_f32(vextq_f32(m, m, 2));
+    const uint32x4_t inside = vcltq_f32(m, farEdges);
+    if (!(vgetq_lane_u32(inside, 0) && vgetq_lane_u32(inside, 1))) {
+        return Overlap::None;
+    }
+    const uint32x4_t equal = vceqq_f32(m, q);
+    // vminvq_u32() is AArch64-only, pairwise minimums also work on 32-bit ARM.
+    uint32x2_t all = vpmin_u32(vget_low_u32(equal), vget_high_u32(equal));
+    all = vpmin_u32(all, all);
+    return vget_lane_u32(all, 0) ? Overlap::Full : Overlap::Partial;
+#else
+    float intersection[4];
+    bool full = true;
+    for (int i = 0; i < 4; ++i) {
+        intersection[i] = std::max(quad[i], rect[i]);
+        full &= intersection[i] == quad[i];
+    }
+    if (!(intersection[0] < -intersection[2] && intersection[1] < -intersection[3])) {
+        return Overlap::None;
+    }
+    return full ? Overlap::Full : Overlap::Partial;
+#endif
+}
+
+static inline void appendSubQuad(WindowQuadList &quads, const WindowQuad &quad, double x1, double y1, double x2, double y2)
+{
+    quads.append(quad.makeSubQuad(x1, y1, x2, y2));
+}
+
+static inline void appendSubQuad(RenderGeometry &geometry, const WindowQuad &quad, double x1, double y1, double x2, double y2)
+{
+    geometry.appendSubQuad(quad, x1, y1, x2, y2);
+}
+
+template<typename Output>
+void QuadClipper::clip(const WindowQuadList &quads, const QPoint &offset, Output &ret) const
+{
+    ret.reserve(quads.count());
+
+    for (const WindowQuad &quad : quads) {
+        const double left = quad.left();
+        const double top = quad.top();
+        const double right = quad.right();
+        const double bottom = quad.bottom();
+        const float bounds[4] = {
+            float(left + offset.x()),
+            float(top + offset.y()),
+            -float(right + offset.x()),
+            -float(bottom + offset.y()),
+        };
+
+        for (int i = firstCandidate(bounds[1]); i < m_rects.count(); ++i) {
+            const Rect &rect = m_rects[i];
+            if (rect.bounds[1] >= -bounds[3]) {
+                // This and all following rectangles are below the quad.
+                break;
+            }
+
+            const Overlap result = overlap(bounds, rect.bounds);
+            if (result == Overlap::None) {
+                continue;
+            }
+            if (result == Overlap::Full) {
+                ret.append(quad);
+                break;
+            }
+
+            // The rectangle coordinates are integers, so compute the sub-quad in double
+            // precision in the quad coordinate system to stay within the original quad.
+            const double x1 = std::max(left, double(rect.bounds[0]) - offset.x());
+            const double y1 = std::max(top, double(rect.bounds[1]) - offset.y());
+            const double x2 = std::min(right, -double(rect.bounds[2]) - offset.x());
+            const double y2 = std::min(bottom, -double(rect.bounds[3]) - offset.y());
+            if (x1 < x2 && y1 < y2) {
+                appendSubQuad(ret, quad, x1, y1, x2, y2);
+            }
+        }
+    }
+}
+
+WindowQuadList QuadClipper::clip(const WindowQuadList &quads, const QPoint &offset) const
+{
+    WindowQuadList ret;
+    clip(quads, offset, ret);
+    return ret;
+}
+
+RenderGeometry QuadClipper::clipToGeometry(const WindowQuadList &quads, const QPoint &offset) const
+{
+    RenderGeometry ret;
+    clip(quads, offset, ret);
+    return ret;
+}
+
+} // namespace KWin
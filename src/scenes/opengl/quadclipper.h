@@ -0,0 +1,59 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwineffects.h"
+
+#include <QRegion>
+
+namespace KWin
+{
+
+/**
+ * The QuadClipper class clips window quads against the rectangles of a region.
+ *
+ * The rectangles are converted once to a packed single precision representation, so
+ * a single clipper can be used to clip many quad lists against the same region. The
+ * y-x banded ordering of QRegion rectangles is used to skip rectangles that can't
+ * overlap a quad.
+ */
+class KWIN_EXPORT QuadClipper
+{
+public:
+    /**
+     * Creates a clipper for the given @a region.
+     */
+    explicit QuadClipper(const QRegion &region);
+
+    /**
+     * Returns the parts of the given @a quads that are inside the clip region. The @a offset
+     * specifies the position of the quads' coordinate system in the region coordinate system.
+     */
+    WindowQuadList clip(const WindowQuadList &quads, const QPoint &offset = QPoint()) const;
+
+    /**
+     * Same as clip(), but writes the result directly to a single precision RenderGeometry.
+     */
+    RenderGeometry clipToGeometry(const WindowQuadList &quads, const QPoint &offset = QPoint()) const;
+
+private:
+    template<typename Output>
+    void clip(const WindowQuadList &quads, const QPoint &offset, Output &ret) const;
+
+    struct alignas(16) Rect
+    {
+        // left, top, -right, -bottom, so both intersection bounds can be computed with max()
+        float bounds[4];
+    };
+
+    int firstCandidate(float top) const;
+
+    QVector<Rect> m_rects;
+};
+
+} // namespace KWin
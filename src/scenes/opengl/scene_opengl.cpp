@@ -12,6 +12,7 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 #include "scene_opengl.h"
+#include "eglnativefence.h"
 #include "openglsurfacetexture.h"
 
 #include "platform.h"
@@ -30,17 +31,22 @@
 #include "renderloop.h"
 #include "shadowitem.h"
 #include "surfaceitem.h"
+#include "surfaceitem_wayland.h"
 #include "utils/common.h"
 #include "window.h"
 #include "windowitem.h"
+#include "wayland/clientbuffer.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 
 #include <QGraphicsScale>
+#include <QHash>
 #include <QMatrix4x4>
 #include <QPainter>
 #include <QStringList>
+#include <QTimer>
 #include <QVector2D>
 #include <QVector4D>
 #include <QtMath>
@@ -55,6 +61,8 @@ namespace KWin
 SceneOpenGL::SceneOpenGL(OpenGLBackend *backend, QObject *parent)
     : Scene(parent)
     , m_backend(backend)
+    , m_textureAtlas(std::make_unique<TextureAtlas>())
+    , m_cursorTextureCache(std::make_unique<CursorTextureCache>())
 {
     // We only support the OpenGL 2+ shader API, not GL_ARB_shader_objects
     if (!hasGLVersion(2, 0)) {
@@ -68,6 +76,43 @@ SceneOpenGL::SceneOpenGL(OpenGLBackend *backend, QObject *parent)
         glGenVertexArrays(1, &vao);
         glBindVertexArray(vao);
     }
+
+    // Non power of two mipmaps are not available in OpenGL ES 2.0
+    m_mipmapsSupported = GLFramebuffer::supported() && (!GLPlatform::instance()->isGLES() || hasGLVersion(3, 0));
+
+    // Clipping the batched geometry against the opaque nodes costs CPU time but saves fill rate
+    m_opaquePass = qEnvironmentVariableIntValue("KWIN_GL_OPAQUE_PASS") != 0;
+
+    // Load the common shaders when idle rather than in the middle of the first frames
+    QTimer::singleShot(0, this, &SceneOpenGL::warmUpShaders);
+
+    // Under memory pressure only the mipmapped copies drawn in the last frame are kept
+    connect(GLMemoryTracker::self(), &GLMemoryTracker::evictionRequested, this, [this]() {
+        if (makeOpenGLContextCurrent()) {
+            releaseUnusedMipmappedTextures(1);
+        }
+    });
+}
+
+void SceneOpenGL::warmUpShaders()
+{
+    static const ShaderTraits commonTraits[] = {
+        ShaderTrait::MapTexture,
+        ShaderTrait::MapTexture | ShaderTrait::Modulate,
+        ShaderTrait::MapTexture | ShaderTrait::Modulate | ShaderTrait::AdjustSaturation,
+        ShaderTrait::MapTexture | ShaderTrait::AdjustSaturation,
+        ShaderTrait::UniformColor,
+        ShaderTrait::UniformColor | ShaderTrait::Modulate,
+    };
+
+    if (!makeOpenGLContextCurrent()) {
+        return;
+    }
+    // One shader per event loop iteration, so input and frames are not held up
+    ShaderManager::instance()->shader(commonTraits[m_warmedUpShaders++]);
+    if (m_warmedUpShaders < int(std::size(commonTraits))) {
+        QTimer::singleShot(0, this, &SceneOpenGL::warmUpShaders);
+    }
 }
 
 SceneOpenGL::~SceneOpenGL()
@@ -91,12 +136,38 @@ bool SceneOpenGL::initFailed() const
     return !init_ok;
 }
 
+// Mipmapped copies that haven't been drawn for this many frames are released
+static const quint64 s_mipmappedTextureLifetime = 120;
+
 void SceneOpenGL::paint(RenderTarget *renderTarget, const QRegion &region)
 {
     Q_UNUSED(renderTarget)
     GLVertexBuffer::streamingBuffer()->beginFrame();
     paintScreen(region);
     GLVertexBuffer::streamingBuffer()->endOfFrame();
+    attachReleaseFence();
+
+    ++m_frameCounter;
+    releaseUnusedMipmappedTextures(s_mipmappedTextureLifetime);
+}
+
+void SceneOpenGL::attachReleaseFence()
+{
+    if (m_explicitSyncBuffers.isEmpty()) {
+        return;
+    }
+    // the release points must not signal before the GPU is done sampling the buffers
+    EGLNativeFence fence(kwinApp()->platform()->sceneEglDisplay());
+    if (fence.isValid()) {
+        for (const QPointer<KWaylandServer::ClientBuffer> &buffer : qAsConst(m_explicitSyncBuffers)) {
+            if (buffer) {
+                buffer->setReleaseFence(fence.fileDescriptor());
+            }
+        }
+    } else {
+        glFinish();
+    }
+    m_explicitSyncBuffers.clear();
 }
 
 QMatrix4x4 SceneOpenGL::transformation(int mask, const ScreenPaintData &data) const
@@ -125,6 +196,56 @@ QMatrix4x4 SceneOpenGL::transformation(int mask, const ScreenPaintData &data) co
     return matrix;
 }
 
+RenderTarget *SceneOpenGL::beginColorTransformation(Output *output, RenderTarget *renderTarget, QRegion *damage)
+{
+    if (!output || !ColorTransformationPass::supported()) {
+        return renderTarget;
+    }
+
+    auto it = m_colorTransformationPasses.find(output);
+    if (it == m_colorTransformationPasses.end()) {
+        if (!output->compositedColorTransformation()) {
+            return renderTarget;
+        }
+        it = m_colorTransformationPasses.emplace(output, std::make_unique<ColorTransformationPass>(output)).first;
+        connect(output, &QObject::destroyed, this, [this, output]() {
+            makeOpenGLContextCurrent();
+            m_colorTransformationPasses.erase(output);
+        });
+    }
+
+    bool repaintAll = false;
+    GLFramebuffer *framebuffer = it->second->begin(renderTarget->size(), &repaintAll);
+    if (repaintAll) {
+        *damage = infiniteRegion();
+    }
+    if (!framebuffer) {
+        return renderTarget;
+    }
+
+    GLFramebuffer::pushFramebuffer(framebuffer);
+    m_currentColorTransformationPass = it->second.get();
+    m_colorTransformationTarget = RenderTarget(framebuffer);
+    m_colorTransformationTarget.setDevicePixelRatio(renderTarget->devicePixelRatio());
+    return &m_colorTransformationTarget;
+}
+
+void SceneOpenGL::endColorTransformation(Output *output, const QRegion &damage)
+{
+    if (!m_currentColorTransformationPass) {
+        return;
+    }
+    GLFramebuffer::popFramebuffer();
+
+    const qreal scale = output->scale();
+    QRegion deviceDamage;
+    for (const QRect &rect : damage) {
+        deviceDamage += QRectF(rect.x() * scale, rect.y() * scale, rect.width() * scale, rect.height() * scale).toAlignedRect();
+    }
+    m_currentColorTransformationPass->end(deviceDamage);
+    m_currentColorTransformationPass = nullptr;
+}
+
 void SceneOpenGL::paintBackground(const QRegion &region)
 {
     if (region == infiniteRegion()) {
@@ -170,12 +291,18 @@ void SceneOpenGL::paintOffscreenQuickView(OffscreenQuickView *w)
         shader->setUniform(GLShader::ModulationConstant, QVector4D(a, a, a, a));
     }
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    // An opaque view is written as is, without reading back what's underneath
+    const bool blend = !w->isOpaque() || a != 1.0;
+    if (blend) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    }
     t->bind();
     t->render(w->geometry());
     t->unbind();
-    glDisable(GL_BLEND);
+    if (blend) {
+        glDisable(GL_BLEND);
+    }
 
     ShaderManager::instance()->popShader();
 }
@@ -261,7 +388,29 @@ void SceneOpenGL::paintSimpleScreen(int mask, const QRegion &region)
 {
     m_screenProjectionMatrix = renderTargetProjectionMatrix();
 
+    // The render nodes of the windows no effect gets in between are collected and uploaded
+    // at once instead of doing a map/draw cycle per window.
+    m_batchWindows = effects;
     Scene::paintSimpleScreen(mask, region);
+    flushBatch();
+    m_batchWindows = false;
+}
+
+void SceneOpenGL::paintWindow(WindowItem *w, int mask, const QRegion &region)
+{
+    if (!m_batchWindows) {
+        Scene::paintWindow(w, mask, region);
+        return;
+    }
+
+    // An effect painting this window may read back or redirect what's below it, so the
+    // windows collected so far have to be drawn before the effect chain starts.
+    m_batchCurrentWindow = !static_cast<EffectsHandlerImpl *>(effects)->hasWindowPaintEffects(w->window()->effectWindow());
+    if (!m_batchCurrentWindow) {
+        flushBatch();
+    }
+    Scene::paintWindow(w, mask, region);
+    m_batchCurrentWindow = false;
 }
 
 void SceneOpenGL::paintGenericScreen(int mask, const ScreenPaintData &data)
@@ -305,7 +454,7 @@ void SceneOpenGL::setBlendEnabled(bool enabled)
     m_blendingEnabled = enabled;
 }
 
-static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem)
+static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem, bool *updated)
 {
     SurfacePixmap *surfacePixmap = surfaceItem->pixmap();
     auto platformSurfaceTexture =
@@ -319,6 +468,7 @@ static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem)
         if (!region.isEmpty()) {
             platformSurfaceTexture->update(region);
             surfaceItem->resetDamage();
+            *updated = true;
         }
     } else {
         if (!surfacePixmap->isValid()) {
@@ -329,119 +479,290 @@ static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem)
             return nullptr;
         }
         surfaceItem->resetDamage();
+        *updated = true;
     }
 
     return platformSurfaceTexture->texture();
 }
 
-static WindowQuadList clipQuads(const Item *item, const SceneOpenGL::RenderContext *context)
+// Textures that are drawn at half of their size or smaller are sampled from a mipmapped copy
+static const qreal s_mipmapThreshold = 0.5;
+static const int s_maxMipmapLevels = 6;
+
+GLTexture *SceneOpenGL::mipmappedTexture(SurfaceItem *item, GLTexture *source)
 {
-    const WindowQuadList quads = item->quads();
-    if (context->clip != infiniteRegion() && !context->hardwareClipping) {
-        const QPoint offset = context->transformStack.top().map(QPoint(0, 0));
+    if (!m_mipmapsSupported || source->target() != GL_TEXTURE_2D) {
+        return nullptr;
+    }
 
-        WindowQuadList ret;
-        ret.reserve(quads.count());
+    auto it = m_mipmappedTextures.find(item);
+    if (it == m_mipmappedTextures.end()) {
+        it = m_mipmappedTextures.emplace(item, MipmappedTexture()).first;
+        it->second.destroyedConnection = connect(item, &QObject::destroyed, this, [this, item]() {
+            makeOpenGLContextCurrent();
+            m_mipmappedTextures.erase(item);
+        });
+    }
 
-        // split all quads in bounding rect with the actual rects in the region
-        for (const WindowQuad &quad : qAsConst(quads)) {
-            for (const QRect &r : qAsConst(context->clip)) {
-                const QRectF rf(r.translated(-offset));
-                const QRectF quadRect(QPointF(quad.left(), quad.top()), QPointF(quad.right(), quad.bottom()));
-                const QRectF &intersected = rf.intersected(quadRect);
-                if (intersected.isValid()) {
-                    if (quadRect == intersected) {
-                        // case 1: completely contains, include and do not check other rects
-                        ret << quad;
-                        break;
-                    }
-                    // case 2: intersection
-                    ret << quad.makeSubQuad(intersected.left(), intersected.top(), intersected.right(), intersected.bottom());
-                }
-            }
+    MipmappedTexture &mipmapped = it->second;
+    mipmapped.lastUsedFrame = m_frameCounter;
+
+    // The first level is already downscaled, the full resolution is never sampled
+    const QSize size((source->width() + 1) / 2, (source->height() + 1) / 2);
+    if (!mipmapped.texture || mipmapped.texture->size() != size) {
+        const int levels = std::min(s_maxMipmapLevels, int(std::log2(std::max(size.width(), size.height()))) + 1);
+        mipmapped.texture = std::make_unique<GLTexture>(GL_RGBA8, size, levels);
+        mipmapped.texture->setMemoryCategory(GLMemoryTracker::Mipmap);
+        mipmapped.texture->setYInverted(true);
+        mipmapped.texture->setFilter(GL_LINEAR_MIPMAP_LINEAR);
+        mipmapped.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        mipmapped.framebuffer = std::make_unique<GLFramebuffer>(mipmapped.texture.get());
+        mipmapped.dirty = true;
+    }
+    if (!mipmapped.framebuffer->valid()) {
+        return nullptr;
+    }
+    if (mipmapped.source != source) {
+        mipmapped.source = source;
+        mipmapped.dirty = true;
+    }
+
+    if (mipmapped.dirty) {
+        QMatrix4x4 projectionMatrix;
+        projectionMatrix.ortho(0, size.width(), 0, size.height(), -1, 1);
+
+        // Effects may call in with blending or scissoring enabled, the copy must not be affected
+        const bool blend = glIsEnabled(GL_BLEND);
+        const bool scissor = glIsEnabled(GL_SCISSOR_TEST);
+        glDisable(GL_BLEND);
+        glDisable(GL_SCISSOR_TEST);
+
+        GLFramebuffer::pushFramebuffer(mipmapped.framebuffer.get());
+        ShaderBinder binder(ShaderTrait::MapTexture);
+        binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix);
+        source->setFilter(GL_LINEAR);
+        source->setWrapMode(GL_CLAMP_TO_EDGE);
+        source->bind();
+        source->render(QRect(QPoint(0, 0), size));
+        GLFramebuffer::popFramebuffer();
+
+        if (blend) {
+            glEnable(GL_BLEND);
+        }
+        if (scissor) {
+            glEnable(GL_SCISSOR_TEST);
+        }
+
+        mipmapped.texture->bind();
+        mipmapped.texture->generateMipmaps();
+        mipmapped.texture->unbind();
+        mipmapped.dirty = false;
+    }
+
+    return mipmapped.texture.get();
+}
+
+void SceneOpenGL::invalidateMipmappedTexture(SurfaceItem *item)
+{
+    auto it = m_mipmappedTextures.find(item);
+    if (it != m_mipmappedTextures.end()) {
+        it->second.dirty = true;
+    }
+}
+
+void SceneOpenGL::releaseUnusedMipmappedTextures(quint64 lifetime)
+{
+    for (auto it = m_mipmappedTextures.begin(); it != m_mipmappedTextures.end();) {
+        if (m_frameCounter - it->second.lastUsedFrame > lifetime) {
+            disconnect(it->second.destroyedConnection);
+            it = m_mipmappedTextures.erase(it);
+        } else {
+            ++it;
         }
-        return ret;
     }
-    return quads;
 }
 
-void SceneOpenGL::createRenderNode(Item *item, RenderContext *context)
+static RenderGeometry clipQuads(const Item *item, const QMatrix4x4 &transform, const SceneOpenGL::RenderContext *context)
+{
+    if (context->clipper) {
+        return context->clipper->clipToGeometry(item->quads(), transform.map(QPoint(0, 0)));
+    }
+    return item->geometry();
+}
+
+void SceneOpenGL::retainRenderNodes(Item *item, const QMatrix4x4 &parentTransform, qreal parentOpacity, QVector<RetainedNode> *nodes)
 {
     const QList<Item *> sortedChildItems = item->sortedChildItems();
 
     QMatrix4x4 matrix;
     matrix.translate(item->position().x(), item->position().y());
     matrix *= item->transform();
-    context->transformStack.push(context->transformStack.top() * matrix);
 
-    context->opacityStack.push(context->opacityStack.top() * item->opacity());
+    const QMatrix4x4 transform = parentTransform * matrix;
+    const qreal opacity = parentOpacity * item->opacity();
 
     for (Item *childItem : sortedChildItems) {
         if (childItem->z() >= 0) {
             break;
         }
         if (childItem->explicitVisible()) {
-            createRenderNode(childItem, context);
+            retainRenderNodes(childItem, transform, opacity, nodes);
+        }
+    }
+
+    RetainedNode node{
+        .item = item,
+        .transformMatrix = transform,
+        .opacity = opacity,
+    };
+    if (qobject_cast<ShadowItem *>(item)) {
+        node.type = RetainedNode::Type::Shadow;
+    } else if (qobject_cast<DecorationItem *>(item)) {
+        node.type = RetainedNode::Type::Decoration;
+    } else if (qobject_cast<SurfaceItem *>(item)) {
+        node.type = RetainedNode::Type::Surface;
+    }
+    nodes->append(node);
+
+    for (Item *childItem : sortedChildItems) {
+        if (childItem->z() < 0) {
+            continue;
+        }
+        if (childItem->explicitVisible()) {
+            retainRenderNodes(childItem, transform, opacity, nodes);
         }
     }
+}
 
-    item->preprocess();
-    if (auto shadowItem = qobject_cast<ShadowItem *>(item)) {
-        WindowQuadList quads = clipQuads(item, context);
-        if (!quads.isEmpty()) {
+const QVector<SceneOpenGL::RetainedNode> &SceneOpenGL::retainedRenderNodes(Item *item, int mask)
+{
+    auto it = m_retainedNodes.find(item);
+    if (it == m_retainedNodes.end()) {
+        connect(item, &QObject::destroyed, this, [this, item]() {
+            m_retainedNodes.remove(item);
+        });
+        it = m_retainedNodes.insert(item, RetainedNodeList());
+    }
+
+    // Hidden items are not preprocessed, their textures are updated once they become visible
+    if (it->valid && it->serial == item->renderSerial()) {
+        for (const RetainedNode &node : qAsConst(it->nodes)) {
+            if (!isItemOccluded(node.item, mask)) {
+                node.item->preprocess();
+            }
+        }
+        if (it->serial == item->renderSerial()) {
+            return it->nodes;
+        }
+    }
+
+    it->nodes.clear();
+    retainRenderNodes(item, QMatrix4x4(), 1.0, &it->nodes);
+    for (const RetainedNode &node : qAsConst(it->nodes)) {
+        if (!isItemOccluded(node.item, mask)) {
+            node.item->preprocess();
+        }
+    }
+
+    // Preprocessing may change the quads of an item, e.g. if the surface has been resized.
+    if (it->serial != item->renderSerial()) {
+        it->nodes.clear();
+        retainRenderNodes(item, QMatrix4x4(), 1.0, &it->nodes);
+    }
+    it->serial = item->renderSerial();
+    it->valid = true;
+
+    return it->nodes;
+}
+
+void SceneOpenGL::createRenderNodes(Item *item, qreal opacity, RenderContext *context)
+{
+    const QVector<RetainedNode> &nodes = retainedRenderNodes(item, context->mask);
+    for (const RetainedNode &node : nodes) {
+        if (node.type == RetainedNode::Type::None || isItemOccluded(node.item, context->mask)) {
+            continue;
+        }
+
+        const RenderGeometry geometry = clipQuads(node.item, node.transformMatrix, context);
+        if (geometry.isEmpty()) {
+            continue;
+        }
+
+        switch (node.type) {
+        case RetainedNode::Type::Shadow: {
+            auto shadowItem = static_cast<ShadowItem *>(node.item);
             SceneOpenGLShadow *shadow = static_cast<SceneOpenGLShadow *>(shadowItem->shadow());
             context->renderNodes.append(RenderNode{
                 .texture = shadow->shadowTexture(),
-                .quads = quads,
-                .transformMatrix = context->transformStack.top(),
-                .opacity = context->opacityStack.top(),
+                .geometry = geometry,
+                .transformMatrix = node.transformMatrix,
+                .opacity = opacity * node.opacity,
                 .hasAlpha = true,
                 .coordinateType = UnnormalizedCoordinates,
+                .textureOffset = shadow->shadowTextureOffset(),
             });
+            break;
         }
-    } else if (auto decorationItem = qobject_cast<DecorationItem *>(item)) {
-        WindowQuadList quads = clipQuads(item, context);
-        if (!quads.isEmpty()) {
+        case RetainedNode::Type::Decoration: {
+            auto decorationItem = static_cast<DecorationItem *>(node.item);
             auto renderer = static_cast<const SceneOpenGLDecorationRenderer *>(decorationItem->renderer());
             context->renderNodes.append(RenderNode{
                 .texture = renderer->texture(),
-                .quads = quads,
-                .transformMatrix = context->transformStack.top(),
-                .opacity = context->opacityStack.top(),
+                .geometry = geometry,
+                .transformMatrix = node.transformMatrix,
+                .opacity = opacity * node.opacity,
                 .hasAlpha = true,
                 .coordinateType = UnnormalizedCoordinates,
+                .textureOffset = renderer->textureOffset(),
             });
+            break;
         }
-    } else if (auto surfaceItem = qobject_cast<SurfaceItem *>(item)) {
-        WindowQuadList quads = clipQuads(item, context);
-        if (!quads.isEmpty()) {
+        case RetainedNode::Type::Surface: {
+            auto surfaceItem = static_cast<SurfaceItem *>(node.item);
             SurfacePixmap *pixmap = surfaceItem->pixmap();
             if (pixmap) {
                 // Don't bother with blending if the entire surface is opaque
                 bool hasAlpha = pixmap->hasAlphaChannel() && !surfaceItem->shape().subtracted(surfaceItem->opaque()).isEmpty();
-                context->renderNodes.append(RenderNode{
-                    .texture = bindSurfaceTexture(surfaceItem),
-                    .quads = quads,
-                    .transformMatrix = context->transformStack.top(),
-                    .opacity = context->opacityStack.top(),
+                bool updated = false;
+                RenderNode renderNode{
+                    .texture = bindSurfaceTexture(surfaceItem, &updated),
+                    .geometry = geometry,
+                    .transformMatrix = node.transformMatrix,
+                    .opacity = opacity * node.opacity,
                     .hasAlpha = hasAlpha,
                     .coordinateType = UnnormalizedCoordinates,
-                });
+                };
+                if (updated) {
+                    invalidateMipmappedTexture(surfaceItem);
+                }
+                if (auto waylandPixmap = qobject_cast<SurfacePixmapWayland *>(pixmap)) {
+                    KWaylandServer::ClientBuffer *buffer = waylandPixmap->buffer();
+                    if (buffer && buffer->hasReleasePoints() && !m_explicitSyncBuffers.contains(buffer)) {
+                        m_explicitSyncBuffers.append(buffer);
+                    }
+                }
+                if (renderNode.texture && context->devicePixelsPerUnit > 0 && !surfaceItem->size().isEmpty()) {
+                    // Device pixels per texel, the less minified direction decides
+                    const QSizeF texelsPerUnit(renderNode.texture->width() / surfaceItem->size().width(),
+                                               renderNode.texture->height() / surfaceItem->size().height());
+                    const qreal scale = context->devicePixelsPerUnit / std::min(texelsPerUnit.width(), texelsPerUnit.height());
+                    if (scale <= s_mipmapThreshold) {
+                        if (GLTexture *mipmapped = mipmappedTexture(surfaceItem, renderNode.texture)) {
+                            renderNode.textureScale = QVector2D(float(mipmapped->width()) / renderNode.texture->width(),
+                                                                float(mipmapped->height()) / renderNode.texture->height());
+                            renderNode.texture = mipmapped;
+                            renderNode.filter = GL_LINEAR_MIPMAP_LINEAR;
+                        }
+                    }
+                }
+                context->renderNodes.append(renderNode);
             }
+            break;
         }
-    }
-
-    for (Item *childItem : sortedChildItems) {
-        if (childItem->z() < 0) {
-            continue;
-        }
-        if (childItem->explicitVisible()) {
-            createRenderNode(childItem, context);
+        case RetainedNode::Type::None:
+            break;
         }
     }
-
-    context->transformStack.pop();
-    context->opacityStack.pop();
 }
 
 QMatrix4x4 SceneOpenGL::modelViewProjectionMatrix(int mask, const WindowPaintData &data) const
@@ -495,27 +816,265 @@ static QMatrix4x4 transformForPaintData(int mask, const WindowPaintData &data)
     return matrix;
 }
 
+static QMatrix4x4 textureMatrix(const SceneOpenGL::RenderNode &renderNode)
+{
+    QMatrix4x4 matrix = renderNode.texture->matrix(renderNode.coordinateType);
+    if (!renderNode.textureOffset.isNull()) {
+        Q_ASSERT(renderNode.coordinateType == UnnormalizedCoordinates);
+        matrix.translate(renderNode.textureOffset.x(), renderNode.textureOffset.y());
+    }
+    if (renderNode.textureScale != QVector2D(1, 1)) {
+        matrix.scale(renderNode.textureScale.x(), renderNode.textureScale.y());
+    }
+    return matrix;
+}
+
+static qreal devicePixelsPerUnit(const QMatrix4x4 &modelViewProjection, const QSize &viewport)
+{
+    // Map a unit step in both directions to normalized device coordinates
+    const QPointF origin = modelViewProjection.map(QPointF(0, 0));
+    const QPointF x = modelViewProjection.map(QPointF(1, 0)) - origin;
+    const QPointF y = modelViewProjection.map(QPointF(0, 1)) - origin;
+    const qreal scaleX = std::hypot(x.x() * viewport.width(), x.y() * viewport.height()) / 2;
+    const qreal scaleY = std::hypot(y.x() * viewport.width(), y.y() * viewport.height()) / 2;
+    return std::max(scaleX, scaleY);
+}
+
+bool SceneOpenGL::canBatch(int mask, const WindowPaintData &data) const
+{
+    if (mask & (Scene::PAINT_WINDOW_TRANSFORMED | Scene::PAINT_SCREEN_TRANSFORMED)) {
+        return false;
+    }
+    if (data.shader || !data.projectionMatrix().isIdentity() || !data.modelViewMatrix().isIdentity()) {
+        return false;
+    }
+    return data.brightness() == 1.0 && data.saturation() == 1.0 && data.crossFadeProgress() == 1.0;
+}
+
+static bool isOpaqueNode(const SceneOpenGL::RenderNode &renderNode)
+{
+    return !renderNode.hasAlpha && renderNode.opacity == 1.0;
+}
+
+static QRect geometryBounds(const RenderGeometry &geometry)
+{
+    const QVector2D *positions = geometry.positions();
+    float left = positions[0].x();
+    float top = positions[0].y();
+    float right = left;
+    float bottom = top;
+    for (int i = 1; i < geometry.count() * 4; ++i) {
+        left = std::min(left, positions[i].x());
+        top = std::min(top, positions[i].y());
+        right = std::max(right, positions[i].x());
+        bottom = std::max(bottom, positions[i].y());
+    }
+    return QRect(QPoint(std::floor(left), std::floor(top)), QPoint(std::ceil(right) - 1, std::ceil(bottom) - 1));
+}
+
+static QRegion coveredArea(const RenderGeometry &geometry)
+{
+    // Only the pixels that are entirely covered by a quad count, the quads are axis aligned
+    const QVector2D *positions = geometry.positions();
+    QRegion region;
+    for (int i = 0; i < geometry.count(); ++i) {
+        const QVector2D &topLeft = positions[i * 4];
+        const QVector2D &bottomRight = positions[i * 4 + 2];
+        region += QRect(QPoint(std::ceil(topLeft.x()), std::ceil(topLeft.y())),
+                        QPoint(std::floor(bottomRight.x()) - 1, std::floor(bottomRight.y()) - 1));
+    }
+    return region;
+}
+
+void SceneOpenGL::prepareOpaquePass()
+{
+    // Walk the nodes front to back and clip every node to the area that is not covered by
+    // the opaque nodes above it, so no pixel is drawn twice if it ends up being hidden.
+    // There is no depth buffer to reject the hidden fragments on the GPU.
+    QRegion covered;
+    for (int i = m_batchedRenderNodes.count() - 1; i >= 0; --i) {
+        RenderNode &renderNode = m_batchedRenderNodes[i];
+        if (renderNode.geometry.isEmpty()) {
+            continue;
+        }
+        const QRect bounds = geometryBounds(renderNode.geometry);
+        if (covered.intersects(bounds)) {
+            const QRegion visible = QRegion(bounds) - covered;
+            if (visible.isEmpty()) {
+                renderNode.geometry.clear();
+                continue;
+            }
+            renderNode.geometry = QuadClipper(visible).clipToGeometry(renderNode.geometry.toWindowQuadList());
+        }
+        if (isOpaqueNode(renderNode)) {
+            covered += coveredArea(renderNode.geometry);
+        }
+    }
+
+    m_batchedRenderNodes.erase(std::remove_if(m_batchedRenderNodes.begin(), m_batchedRenderNodes.end(), [](const RenderNode &renderNode) {
+                                   return renderNode.geometry.isEmpty();
+                               }),
+                               m_batchedRenderNodes.end());
+
+    // The opaque nodes don't overlap anymore and nothing below them is left, so they can be
+    // drawn first in one go without blending, then the translucent nodes in stacking order
+    std::stable_partition(m_batchedRenderNodes.begin(), m_batchedRenderNodes.end(), isOpaqueNode);
+}
+
+void SceneOpenGL::flushBatch()
+{
+    if (m_batchedRenderNodes.isEmpty()) {
+        return;
+    }
+
+    // Bake the item transform into the vertices so that all nodes share the same matrix.
+    for (RenderNode &renderNode : m_batchedRenderNodes) {
+        renderNode.geometry.map(renderNode.transformMatrix);
+    }
+
+    if (m_opaquePass) {
+        prepareOpaquePass();
+        if (m_batchedRenderNodes.isEmpty()) {
+            return;
+        }
+    }
+
+    int quadCount = 0;
+    bool translucent = false;
+    for (const RenderNode &node : qAsConst(m_batchedRenderNodes)) {
+        quadCount += node.geometry.count();
+        translucent |= node.opacity != 1.0;
+    }
+
+    const bool indexedQuads = GLVertexBuffer::supportsIndexedQuads();
+    const GLenum primitiveType = indexedQuads ? GL_QUADS : GL_TRIANGLES;
+    const int verticesPerQuad = indexedQuads ? 4 : 6;
+    const size_t size = verticesPerQuad * quadCount * sizeof(GLVertex2D);
+
+    const GLVertexAttrib attribs[] = {
+        {VA_Position, 2, GL_FLOAT, offsetof(GLVertex2D, position)},
+        {VA_TexCoord, 2, GL_FLOAT, offsetof(GLVertex2D, texcoord)},
+    };
+
+    GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
+    vbo->reset();
+    vbo->setAttribLayout(attribs, 2, sizeof(GLVertex2D));
+
+    GLVertex2D *map = (GLVertex2D *)vbo->map(size);
+
+    for (int i = 0, v = 0; i < m_batchedRenderNodes.count(); i++) {
+        RenderNode &renderNode = m_batchedRenderNodes[i];
+        renderNode.firstVertex = v;
+        renderNode.vertexCount = renderNode.geometry.count() * verticesPerQuad;
+
+        renderNode.geometry.makeInterleavedArrays(primitiveType, &map[v], textureMatrix(renderNode));
+        v += renderNode.vertexCount;
+    }
+
+    vbo->unmap();
+    vbo->bindArrays();
+
+    ShaderTraits shaderTraits = ShaderTrait::MapTexture;
+    if (translucent) {
+        shaderTraits |= ShaderTrait::Modulate;
+    }
+    GLShader *shader = ShaderManager::instance()->pushShader(shaderTraits);
+    shader->setUniform(GLShader::ModelViewProjectionMatrix, renderTargetProjectionMatrix());
+
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    // The stacking order must be preserved, so only adjacent nodes that share the same
+    // texture and blending state are merged into a single draw call. Decorations and
+    // shadows live in a shared atlas, so the shadow and the decoration of a window
+    // usually end up in the same call.
+    float opacity = -1.0;
+    for (int i = 0; i < m_batchedRenderNodes.count();) {
+        const RenderNode &renderNode = m_batchedRenderNodes[i];
+        const bool blend = renderNode.hasAlpha || renderNode.opacity < 1.0;
+        int vertexCount = renderNode.vertexCount;
+
+        int next = i + 1;
+        for (; next < m_batchedRenderNodes.count(); ++next) {
+            const RenderNode &candidate = m_batchedRenderNodes[next];
+            if (candidate.texture != renderNode.texture || candidate.opacity != renderNode.opacity
+                || (candidate.hasAlpha || candidate.opacity < 1.0) != blend) {
+                break;
+            }
+            vertexCount += candidate.vertexCount;
+        }
+
+        setBlendEnabled(blend);
+        if (translucent && opacity != renderNode.opacity) {
+            shader->setUniform(GLShader::ModulationConstant, modulate(renderNode.opacity, 1.0));
+            opacity = renderNode.opacity;
+        }
+
+        renderNode.texture->setFilter(renderNode.filter);
+        renderNode.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        renderNode.texture->bind();
+
+        vbo->draw(infiniteRegion(), primitiveType, renderNode.firstVertex, vertexCount, false);
+        i = next;
+    }
+
+    vbo->unbindArrays();
+
+    setBlendEnabled(false);
+    ShaderManager::instance()->popShader();
+
+    m_batchedRenderNodes.clear();
+}
+
 void SceneOpenGL::render(Item *item, int mask, const QRegion &region, const WindowPaintData &data)
 {
     if (region.isEmpty()) {
         return;
     }
 
+    const bool batch = m_batchCurrentWindow && canBatch(mask, data);
+    if (!batch) {
+        // Anything drawn right away must end up on top of the already collected windows.
+        flushBatch();
+    }
+
     RenderContext renderContext{
         .clip = region,
         .hardwareClipping = region != infiniteRegion() && ((mask & Scene::PAINT_WINDOW_TRANSFORMED) || (mask & Scene::PAINT_SCREEN_TRANSFORMED)),
+        .mask = mask,
     };
-
-    renderContext.transformStack.push(QMatrix4x4());
-    renderContext.opacityStack.push(data.opacity());
+    if (renderContext.clip != infiniteRegion() && !renderContext.hardwareClipping) {
+        renderContext.clipper.emplace(renderContext.clip);
+    }
 
     item->setTransform(transformForPaintData(mask, data));
 
-    createRenderNode(item, &renderContext);
+    // Only scaled down windows are candidates for mipmapping, batched windows are never scaled
+    if (!batch && (mask & (Scene::PAINT_WINDOW_TRANSFORMED | Scene::PAINT_SCREEN_TRANSFORMED))) {
+        if (const GLFramebuffer *framebuffer = GLFramebuffer::currentFramebuffer()) {
+            const QMatrix4x4 transform = modelViewProjectionMatrix(mask, data) * item->transform();
+            renderContext.devicePixelsPerUnit = devicePixelsPerUnit(transform, framebuffer->size());
+        }
+    }
+
+    createRenderNodes(item, data.opacity(), &renderContext);
+
+    if (batch) {
+        for (RenderNode &renderNode : renderContext.renderNodes) {
+            if (!renderNode.geometry.isEmpty() && renderNode.texture) {
+                m_batchedRenderNodes.append(std::move(renderNode));
+            }
+        }
+        return;
+    }
+
+    drawRenderNodes(renderContext, modelViewProjectionMatrix(mask, data), data);
+}
 
+void SceneOpenGL::drawRenderNodes(RenderContext &renderContext, const QMatrix4x4 &modelViewProjection, const WindowPaintData &data)
+{
     int quadCount = 0;
     for (const RenderNode &node : qAsConst(renderContext.renderNodes)) {
-        quadCount += node.quads.count();
+        quadCount += node.geometry.count();
     }
     if (!quadCount) {
         return;
@@ -548,7 +1107,7 @@ void SceneOpenGL::render(Item *item, int mask, const QRegion &region, const Wind
 
     for (int i = 0, v = 0; i < renderContext.renderNodes.count(); i++) {
         RenderNode &renderNode = renderContext.renderNodes[i];
-        if (renderNode.quads.isEmpty() || !renderNode.texture) {
+        if (renderNode.geometry.isEmpty() || !renderNode.texture) {
             continue;
         }
 
@@ -557,12 +1116,10 @@ void SceneOpenGL::render(Item *item, int mask, const QRegion &region, const Wind
         }
 
         renderNode.firstVertex = v;
-        renderNode.vertexCount = renderNode.quads.count() * verticesPerQuad;
+        renderNode.vertexCount = renderNode.geometry.count() * verticesPerQuad;
 
-        const QMatrix4x4 matrix = renderNode.texture->matrix(renderNode.coordinateType);
-
-        renderNode.quads.makeInterleavedArrays(primitiveType, &map[v], matrix);
-        v += renderNode.quads.count() * verticesPerQuad;
+        renderNode.geometry.makeInterleavedArrays(primitiveType, &map[v], textureMatrix(renderNode));
+        v += renderNode.geometry.count() * verticesPerQuad;
     }
 
     vbo->unmap();
@@ -572,7 +1129,11 @@ void SceneOpenGL::render(Item *item, int mask, const QRegion &region, const Wind
     if (!shader) {
         shader = ShaderManager::instance()->pushShader(shaderTraits);
     }
-    shader->setUniform(GLShader::Saturation, data.saturation());
+    // The built-in variants only declare the uniforms for their traits, custom shaders get all of them
+    const bool setModulation = data.shader || (shaderTraits & ShaderTrait::Modulate);
+    if (data.shader || (shaderTraits & ShaderTrait::AdjustSaturation)) {
+        shader->setUniform(GLShader::Saturation, data.saturation());
+    }
 
     if (renderContext.hardwareClipping) {
         glEnable(GL_SCISSOR_TEST);
@@ -586,32 +1147,58 @@ void SceneOpenGL::render(Item *item, int mask, const QRegion &region, const Wind
     // The scissor region must be in the render target local coordinate system.
     QRegion scissorRegion = infiniteRegion();
     if (renderContext.hardwareClipping) {
-        scissorRegion = mapToRenderTarget(region);
+        scissorRegion = mapToRenderTarget(renderContext.clip);
     }
 
-    const QMatrix4x4 modelViewProjection = modelViewProjectionMatrix(mask, data);
-    for (int i = 0; i < renderContext.renderNodes.count(); i++) {
+    // Vertices of consecutive non-empty nodes are contiguous, so adjacent nodes that share
+    // the texture, transform and blending state (e.g. the four decoration parts) are drawn
+    // with a single call.
+    GLTexture *boundTexture = nullptr;
+    for (int i = 0; i < renderContext.renderNodes.count();) {
         const RenderNode &renderNode = renderContext.renderNodes[i];
         if (renderNode.vertexCount == 0) {
+            ++i;
             continue;
         }
 
-        setBlendEnabled(renderNode.hasAlpha || renderNode.opacity < 1.0);
+        const bool blend = renderNode.hasAlpha || renderNode.opacity < 1.0;
+        int vertexCount = renderNode.vertexCount;
+
+        int next = i + 1;
+        for (; next < renderContext.renderNodes.count(); ++next) {
+            const RenderNode &candidate = renderContext.renderNodes[next];
+            if (candidate.vertexCount == 0) {
+                continue;
+            }
+            if (candidate.texture != renderNode.texture || candidate.filter != renderNode.filter
+                || candidate.opacity != renderNode.opacity || candidate.transformMatrix != renderNode.transformMatrix
+                || (candidate.hasAlpha || candidate.opacity < 1.0) != blend) {
+                break;
+            }
+            vertexCount += candidate.vertexCount;
+        }
+
+        setBlendEnabled(blend);
 
         shader->setUniform(GLShader::ModelViewProjectionMatrix,
                            modelViewProjection * renderNode.transformMatrix);
-        if (opacity != renderNode.opacity) {
+        if (setModulation && opacity != renderNode.opacity) {
             shader->setUniform(GLShader::ModulationConstant,
                                modulate(renderNode.opacity, data.brightness()));
             opacity = renderNode.opacity;
         }
 
-        renderNode.texture->setFilter(GL_LINEAR);
-        renderNode.texture->setWrapMode(GL_CLAMP_TO_EDGE);
-        renderNode.texture->bind();
+        // Re-binding is only needed when the texture or its sampling state changes
+        if (renderNode.texture != boundTexture || renderNode.texture->filter() != renderNode.filter) {
+            renderNode.texture->setFilter(renderNode.filter);
+            renderNode.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+            renderNode.texture->bind();
+            boundTexture = renderNode.texture;
+        }
 
         vbo->draw(scissorRegion, primitiveType, renderNode.firstVertex,
-                  renderNode.vertexCount, renderContext.hardwareClipping);
+                  vertexCount, renderContext.hardwareClipping);
+        i = next;
     }
 
     vbo->unbindArrays();
@@ -630,6 +1217,56 @@ void SceneOpenGL::render(Item *item, int mask, const QRegion &region, const Wind
 //****************************************
 // SceneOpenGL::Shadow
 //****************************************
+static void clamp_row(int left, int width, int right, const uint32_t *src, uint32_t *dest)
+{
+    std::fill_n(dest, left, *src);
+    std::copy(src, src + width, dest + left);
+    std::fill_n(dest + left + width, right, *(src + width - 1));
+}
+
+static void clamp_sides(int left, int width, int right, const uint32_t *src, uint32_t *dest)
+{
+    std::fill_n(dest, left, *src);
+    std::fill_n(dest + left + width, right, *(src + width - 1));
+}
+
+static void clamp(QImage &image, const QRect &viewport)
+{
+    Q_ASSERT(image.depth() == 32);
+    if (viewport.isEmpty()) {
+        image = {};
+        return;
+    }
+
+    const QRect rect = image.rect();
+
+    const int left = viewport.left() - rect.left();
+    const int top = viewport.top() - rect.top();
+    const int right = rect.right() - viewport.right();
+    const int bottom = rect.bottom() - viewport.bottom();
+
+    const int width = rect.width() - left - right;
+    const int height = rect.height() - top - bottom;
+
+    const uint32_t *firstRow = reinterpret_cast<uint32_t *>(image.scanLine(top));
+    const uint32_t *lastRow = reinterpret_cast<uint32_t *>(image.scanLine(top + height - 1));
+
+    for (int i = 0; i < top; ++i) {
+        uint32_t *dest = reinterpret_cast<uint32_t *>(image.scanLine(i));
+        clamp_row(left, width, right, firstRow + left, dest);
+    }
+
+    for (int i = 0; i < height; ++i) {
+        uint32_t *dest = reinterpret_cast<uint32_t *>(image.scanLine(top + i));
+        clamp_sides(left, width, right, dest + left, dest);
+    }
+
+    for (int i = 0; i < bottom; ++i) {
+        uint32_t *dest = reinterpret_cast<uint32_t *>(image.scanLine(top + height + i));
+        clamp_row(left, width, right, lastRow + left, dest);
+    }
+}
+
 class DecorationShadowTextureCache
 {
 public:
@@ -638,13 +1275,13 @@ public:
     static DecorationShadowTextureCache &instance();
 
     void unregister(SceneOpenGLShadow *shadow);
-    QSharedPointer<GLTexture> getTexture(SceneOpenGLShadow *shadow);
+    QSharedPointer<AtlasTexture> getTexture(SceneOpenGLShadow *shadow);
 
 private:
     DecorationShadowTextureCache() = default;
     struct Data
     {
-        QSharedPointer<GLTexture> texture;
+        QSharedPointer<AtlasTexture> texture;
         QVector<SceneOpenGLShadow *> shadows;
     };
     QHash<KDecoration2::DecorationShadow *, Data> m_cache;
@@ -684,7 +1321,33 @@ void DecorationShadowTextureCache::unregister(SceneOpenGLShadow *shadow)
     }
 }
 
-QSharedPointer<GLTexture> DecorationShadowTextureCache::getTexture(SceneOpenGLShadow *shadow)
+// Shadows are padded with a copy of their outermost pixels in the atlas, so that
+// the neighbouring textures don't bleed into them when sampling the edges
+static const int ShadowTexturePad = 1;
+
+static QSharedPointer<AtlasTexture> createShadowAtlasTexture(const QImage &image)
+{
+    if (image.isNull()) {
+        return nullptr;
+    }
+
+    const QRect viewport(ShadowTexturePad, ShadowTexturePad, image.width(), image.height());
+    QImage padded(image.width() + 2 * ShadowTexturePad, image.height() + 2 * ShadowTexturePad, image.format());
+    QPainter painter(&padded);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(viewport.topLeft(), image);
+    painter.end();
+    clamp(padded, viewport);
+
+    auto scene = static_cast<SceneOpenGL *>(Compositor::self()->scene());
+    QSharedPointer<AtlasTexture> texture(scene->textureAtlas()->allocate(padded.size(), GLMemoryTracker::Shadow).release());
+    if (texture) {
+        texture->update(padded);
+    }
+    return texture;
+}
+
+QSharedPointer<AtlasTexture> DecorationShadowTextureCache::getTexture(SceneOpenGLShadow *shadow)
 {
     Q_ASSERT(shadow->hasDecorationShadow());
     unregister(shadow);
@@ -698,11 +1361,89 @@ QSharedPointer<GLTexture> DecorationShadowTextureCache::getTexture(SceneOpenGLSh
     }
     Data d;
     d.shadows << shadow;
-    d.texture = QSharedPointer<GLTexture>::create(shadow->decorationShadowImage());
+    d.texture = createShadowAtlasTexture(shadow->decorationShadowImage().convertToFormat(QImage::Format_ARGB32_Premultiplied));
     m_cache.insert(decoShadow.data(), d);
     return d.texture;
 }
 
+/**
+ * Client-provided and internal shadows are composed from their pixmaps for every window,
+ * yet most windows use the very same shadow. The cache hands out the texture of an
+ * identical image instead of uploading another copy. Shadows are rendered as nine-patch,
+ * so one texture serves windows of any size.
+ */
+class ShadowTextureCache
+{
+public:
+    ShadowTextureCache(const ShadowTextureCache &) = delete;
+    static ShadowTextureCache &instance();
+
+    bool lookup(const QImage &image, QSharedPointer<GLTexture> *texture, QSharedPointer<AtlasTexture> *atlasTexture);
+    void insert(const QImage &image, const QSharedPointer<GLTexture> &texture, const QSharedPointer<AtlasTexture> &atlasTexture);
+
+private:
+    ShadowTextureCache() = default;
+    static uint imageHash(const QImage &image);
+    void purge();
+
+    struct Entry
+    {
+        QImage image;
+        QWeakPointer<GLTexture> texture;
+        QWeakPointer<AtlasTexture> atlasTexture;
+    };
+    QMultiHash<uint, Entry> m_entries;
+};
+
+ShadowTextureCache &ShadowTextureCache::instance()
+{
+    static ShadowTextureCache s_instance;
+    return s_instance;
+}
+
+uint ShadowTextureCache::imageHash(const QImage &image)
+{
+    uint seed = qHash(image.width()) ^ qHash(image.height()) ^ qHash(int(image.format()));
+    for (int y = 0; y < image.height(); ++y) {
+        seed = qHashBits(image.constScanLine(y), image.width() * image.depth() / 8, seed);
+    }
+    return seed;
+}
+
+void ShadowTextureCache::purge()
+{
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->texture.isNull() && it->atlasTexture.isNull()) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool ShadowTextureCache::lookup(const QImage &image, QSharedPointer<GLTexture> *texture, QSharedPointer<AtlasTexture> *atlasTexture)
+{
+    const uint hash = imageHash(image);
+    for (auto it = m_entries.constFind(hash); it != m_entries.constEnd() && it.key() == hash; ++it) {
+        // a hash collision must not show another shadow
+        if (it->image != image) {
+            continue;
+        }
+        *texture = it->texture.toStrongRef();
+        *atlasTexture = it->atlasTexture.toStrongRef();
+        if (*texture || *atlasTexture) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShadowTextureCache::insert(const QImage &image, const QSharedPointer<GLTexture> &texture, const QSharedPointer<AtlasTexture> &atlasTexture)
+{
+    purge();
+    m_entries.insert(imageHash(image), Entry{image, texture, atlasTexture});
+}
+
 SceneOpenGLShadow::SceneOpenGLShadow(Window *window)
     : Shadow(window)
 {
@@ -715,7 +1456,24 @@ SceneOpenGLShadow::~SceneOpenGLShadow()
         scene->makeOpenGLContextCurrent();
         DecorationShadowTextureCache::instance().unregister(this);
         m_texture.reset();
+        m_atlasTexture.reset();
+    }
+}
+
+GLTexture *SceneOpenGLShadow::shadowTexture() const
+{
+    if (m_atlasTexture) {
+        return m_atlasTexture->texture();
+    }
+    return m_texture.data();
+}
+
+QPoint SceneOpenGLShadow::shadowTextureOffset() const
+{
+    if (m_atlasTexture) {
+        return m_atlasTexture->rect().topLeft() + QPoint(ShadowTexturePad, ShadowTexturePad);
     }
+    return QPoint();
 }
 
 bool SceneOpenGLShadow::prepareBackend()
@@ -724,7 +1482,8 @@ bool SceneOpenGLShadow::prepareBackend()
         // simplifies a lot by going directly to
         Scene *scene = Compositor::self()->scene();
         scene->makeOpenGLContextCurrent();
-        m_texture = DecorationShadowTextureCache::instance().getTexture(this);
+        m_texture.reset();
+        m_atlasTexture = DecorationShadowTextureCache::instance().getTexture(this);
 
         return true;
     }
@@ -791,20 +1550,35 @@ bool SceneOpenGLShadow::prepareBackend()
 
     Scene *scene = Compositor::self()->scene();
     scene->makeOpenGLContextCurrent();
-    m_texture = QSharedPointer<GLTexture>::create(image);
 
-    if (m_texture->internalFormat() == GL_R8) {
-        // Swizzle red to alpha and all other channels to zero
-        m_texture->bind();
-        m_texture->setSwizzle(GL_ZERO, GL_ZERO, GL_ZERO, GL_RED);
+    if (ShadowTextureCache::instance().lookup(image, &m_texture, &m_atlasTexture)) {
+        return true;
     }
 
+    // The atlas only holds RGBA textures, alpha-only shadows are cheaper in a texture of their own
+    if (image.format() == QImage::Format_Alpha8) {
+        m_atlasTexture.reset();
+        m_texture = QSharedPointer<GLTexture>::create(image);
+        m_texture->setMemoryCategory(GLMemoryTracker::Shadow);
+        if (m_texture->internalFormat() == GL_R8) {
+            // Swizzle red to alpha and all other channels to zero
+            m_texture->bind();
+            m_texture->setSwizzle(GL_ZERO, GL_ZERO, GL_ZERO, GL_RED);
+        }
+    } else {
+        m_texture.reset();
+        m_atlasTexture = createShadowAtlasTexture(image);
+    }
+    ShadowTextureCache::instance().insert(image, m_texture, m_atlasTexture);
+
     return true;
 }
 
+// Decoration damage with more rects than this is rendered as its bounding rect
+static const int s_maxDecorationDamageRects = 4;
+
 SceneOpenGLDecorationRenderer::SceneOpenGLDecorationRenderer(Decoration::DecoratedClientImpl *client)
     : DecorationRenderer(client)
-    , m_texture()
 {
 }
 
@@ -813,56 +1587,7 @@ SceneOpenGLDecorationRenderer::~SceneOpenGLDecorationRenderer()
     if (Scene *scene = Compositor::self()->scene()) {
         scene->makeOpenGLContextCurrent();
     }
-}
-
-static void clamp_row(int left, int width, int right, const uint32_t *src, uint32_t *dest)
-{
-    std::fill_n(dest, left, *src);
-    std::copy(src, src + width, dest + left);
-    std::fill_n(dest + left + width, right, *(src + width - 1));
-}
-
-static void clamp_sides(int left, int width, int right, const uint32_t *src, uint32_t *dest)
-{
-    std::fill_n(dest, left, *src);
-    std::fill_n(dest + left + width, right, *(src + width - 1));
-}
-
-static void clamp(QImage &image, const QRect &viewport)
-{
-    Q_ASSERT(image.depth() == 32);
-    if (viewport.isEmpty()) {
-        image = {};
-        return;
-    }
-
-    const QRect rect = image.rect();
-
-    const int left = viewport.left() - rect.left();
-    const int top = viewport.top() - rect.top();
-    const int right = rect.right() - viewport.right();
-    const int bottom = rect.bottom() - viewport.bottom();
-
-    const int width = rect.width() - left - right;
-    const int height = rect.height() - top - bottom;
-
-    const uint32_t *firstRow = reinterpret_cast<uint32_t *>(image.scanLine(top));
-    const uint32_t *lastRow = reinterpret_cast<uint32_t *>(image.scanLine(top + height - 1));
-
-    for (int i = 0; i < top; ++i) {
-        uint32_t *dest = reinterpret_cast<uint32_t *>(image.scanLine(i));
-        clamp_row(left, width, right, firstRow + left, dest);
-    }
-
-    for (int i = 0; i < height; ++i) {
-        uint32_t *dest = reinterpret_cast<uint32_t *>(image.scanLine(top + i));
-        clamp_sides(left, width, right, dest + left, dest);
-    }
-
-    for (int i = 0; i < bottom; ++i) {
-        uint32_t *dest = reinterpret_cast<uint32_t *>(image.scanLine(top + height + i));
-        clamp_row(left, width, right, lastRow + left, dest);
-    }
+    m_texture.reset();
 }
 
 void SceneOpenGLDecorationRenderer::render(const QRegion &region)
@@ -890,12 +1615,26 @@ void SceneOpenGLDecorationRenderer::render(const QRegion &region)
     const QPoint leftPosition(0, bottomPosition.y() + bottomHeight + (2 * TexturePad));
     const QPoint rightPosition(0, leftPosition.y() + leftWidth + (2 * TexturePad));
 
-    const QRect dirtyRect = region.boundingRect();
+    renderDamagedPart(region, top, topPosition, devicePixelRatio);
+    renderDamagedPart(region, bottom, bottomPosition, devicePixelRatio);
+    renderDamagedPart(region, left, leftPosition, devicePixelRatio, true);
+    renderDamagedPart(region, right, rightPosition, devicePixelRatio, true);
+}
 
-    renderPart(top.intersected(dirtyRect), top, topPosition, devicePixelRatio);
-    renderPart(bottom.intersected(dirtyRect), bottom, bottomPosition, devicePixelRatio);
-    renderPart(left.intersected(dirtyRect), left, leftPosition, devicePixelRatio, true);
-    renderPart(right.intersected(dirtyRect), right, rightPosition, devicePixelRatio, true);
+void SceneOpenGLDecorationRenderer::renderDamagedPart(const QRegion &region, const QRect &partRect,
+                                                      const QPoint &textureOffset,
+                                                      qreal devicePixelRatio, bool rotated)
+{
+    // Paint and upload only the damaged rects, e.g. the caption and a button that changed
+    // in the title bar, unless the damage is so fragmented that one bigger upload is cheaper
+    const QRegion damage = region & partRect;
+    if (damage.rectCount() > s_maxDecorationDamageRects) {
+        renderPart(damage.boundingRect(), partRect, textureOffset, devicePixelRatio, rotated);
+    } else {
+        for (const QRect &rect : damage) {
+            renderPart(rect, partRect, textureOffset, devicePixelRatio, rotated);
+        }
+    }
 }
 
 void SceneOpenGLDecorationRenderer::renderPart(const QRect &rect, const QRect &partRect,
@@ -992,17 +1731,18 @@ void SceneOpenGLDecorationRenderer::resizeTexture()
     size.rwidth() += 2 * TexturePad;
     size.rwidth() = align(size.width(), 128);
 
-    if (m_texture && m_texture->size() == size) {
+    // Keep the texture while the window is resized as long as the parts still fit, so it's
+    // not reallocated and cleared on every step. All parts are damaged after a resize anyway.
+    if (m_texture && m_texture->rect().height() == size.height()
+        && m_texture->rect().width() >= size.width() && m_texture->rect().width() <= 2 * size.width()) {
         return;
     }
 
+    m_texture.reset();
     if (!size.isEmpty()) {
-        m_texture.reset(new GLTexture(GL_RGBA8, size.width(), size.height()));
-        m_texture->setYInverted(true);
-        m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        auto scene = static_cast<SceneOpenGL *>(Compositor::self()->scene());
+        m_texture = scene->textureAtlas()->allocate(size);
         m_texture->clear();
-    } else {
-        m_texture.reset();
     }
 }
 
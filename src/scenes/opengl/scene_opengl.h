@@ -12,12 +12,28 @@
 #define KWIN_SCENE_OPENGL_H
 
 #include "openglbackend.h"
+#include "rendertarget.h"
 
 #include "decorationitem.h"
 #include "scene.h"
 #include "shadow.h"
 
+#include "colortransformationpass.h"
+#include "cursortexturecache.h"
 #include "kwinglutils.h"
+#include "quadclipper.h"
+#include "textureatlas.h"
+
+#include <QPointer>
+#include <QVector2D>
+
+#include <optional>
+#include <unordered_map>
+
+namespace KWaylandServer
+{
+class ClientBuffer;
+}
 
 namespace KWin
 {
@@ -28,31 +44,45 @@ class KWIN_EXPORT SceneOpenGL
 {
     Q_OBJECT
 public:
+    /**
+     * A RenderNode is the part of a frame that is drawn with one texture. It only holds the
+     * values that were gathered from the item tree, so drawing the nodes doesn't need to
+     * look at any Item, Window or surface.
+     */
     struct RenderNode
     {
         GLTexture *texture = nullptr;
-        WindowQuadList quads;
+        RenderGeometry geometry;
         QMatrix4x4 transformMatrix;
         int firstVertex = 0;
         int vertexCount = 0;
         qreal opacity = 1;
         bool hasAlpha = false;
         TextureCoordinateType coordinateType = UnnormalizedCoordinates;
+        // Position of the node's texture in an atlas texture, in unnormalized coordinates
+        QPoint textureOffset;
+        // Scale from the texture coordinates to the texture, e.g. for downscaled copies
+        QVector2D textureScale = QVector2D(1, 1);
+        GLenum filter = GL_LINEAR;
     };
 
     struct RenderContext
     {
         QVector<RenderNode> renderNodes;
-        QStack<QMatrix4x4> transformStack;
-        QStack<qreal> opacityStack;
         const QRegion clip;
         const bool hardwareClipping;
+        const int mask = 0;
+        std::optional<QuadClipper> clipper;
+        // How many device pixels a logical unit covers, or 0 if unknown
+        qreal devicePixelsPerUnit = 0;
     };
 
     explicit SceneOpenGL(OpenGLBackend *backend, QObject *parent = nullptr);
     ~SceneOpenGL() override;
     bool initFailed() const override;
     void paint(RenderTarget *renderTarget, const QRegion &region) override;
+    RenderTarget *beginColorTransformation(Output *output, RenderTarget *renderTarget, QRegion *damage) override;
+    void endColorTransformation(Output *output, const QRegion &damage) override;
     Shadow *createShadow(Window *window) override;
     bool makeOpenGLContextCurrent() override;
     void doneOpenGLContextCurrent() override;
@@ -69,6 +99,16 @@ public:
         return m_backend;
     }
 
+    TextureAtlas *textureAtlas() const
+    {
+        return m_textureAtlas.get();
+    }
+
+    CursorTextureCache *cursorTextureCache() const
+    {
+        return m_cursorTextureCache.get();
+    }
+
     QVector<QByteArray> openGLPlatformInterfaceExtensions() const override;
     QSharedPointer<GLTexture> textureForOutput(Output *output) const override;
 
@@ -87,19 +127,93 @@ protected:
 
     void paintSimpleScreen(int mask, const QRegion &region) override;
     void paintGenericScreen(int mask, const ScreenPaintData &data) override;
+    void paintWindow(WindowItem *w, int mask, const QRegion &region) override;
 
 private:
+    /**
+     * A RetainedNode describes an item in the item tree of a window. The list of retained
+     * nodes is kept across frames until the item tree changes, only clipping and texture
+     * updates are done per frame.
+     */
+    struct RetainedNode
+    {
+        enum class Type {
+            None,
+            Shadow,
+            Decoration,
+            Surface,
+        };
+        Item *item = nullptr;
+        QMatrix4x4 transformMatrix;
+        qreal opacity = 1;
+        Type type = Type::None;
+    };
+
+    struct RetainedNodeList
+    {
+        QVector<RetainedNode> nodes;
+        quint64 serial = 0;
+        bool valid = false;
+    };
+
+    /**
+     * A downscaled, mipmapped copy of a surface texture, used while the surface is
+     * drawn at a small scale. The copy is only regenerated after the surface is damaged.
+     */
+    struct MipmappedTexture
+    {
+        std::unique_ptr<GLTexture> texture;
+        std::unique_ptr<GLFramebuffer> framebuffer;
+        GLTexture *source = nullptr;
+        QMetaObject::Connection destroyedConnection;
+        quint64 lastUsedFrame = 0;
+        bool dirty = true;
+    };
+
     void doPaintBackground(const QVector<float> &vertices);
     QMatrix4x4 modelViewProjectionMatrix(int mask, const WindowPaintData &data) const;
     QVector4D modulate(float opacity, float brightness) const;
     void setBlendEnabled(bool enabled);
-    void createRenderNode(Item *item, RenderContext *context);
+    void retainRenderNodes(Item *item, const QMatrix4x4 &parentTransform, qreal parentOpacity, QVector<RetainedNode> *nodes);
+    const QVector<RetainedNode> &retainedRenderNodes(Item *item, int mask);
+    void createRenderNodes(Item *item, qreal opacity, RenderContext *context);
+    void drawRenderNodes(RenderContext &renderContext, const QMatrix4x4 &modelViewProjection, const WindowPaintData &data);
+    bool canBatch(int mask, const WindowPaintData &data) const;
+    void flushBatch();
+    void prepareOpaquePass();
+    void warmUpShaders();
+    GLTexture *mipmappedTexture(SurfaceItem *item, GLTexture *source);
+    void invalidateMipmappedTexture(SurfaceItem *item);
+    /**
+     * Releases the mipmapped copies that haven't been drawn in the last @a lifetime frames.
+     */
+    void releaseUnusedMipmappedTextures(quint64 lifetime);
+    /**
+     * Makes the release points of the explicitly synchronized buffers drawn in the current
+     * frame wait for the GPU to finish rendering it.
+     */
+    void attachReleaseFence();
 
     bool init_ok = true;
     OpenGLBackend *m_backend;
     QMatrix4x4 m_screenProjectionMatrix;
     GLuint vao = 0;
+    int m_warmedUpShaders = 0;
     bool m_blendingEnabled = false;
+    bool m_batchWindows = false;
+    bool m_batchCurrentWindow = false;
+    bool m_opaquePass = false;
+    QVector<RenderNode> m_batchedRenderNodes;
+    QHash<Item *, RetainedNodeList> m_retainedNodes;
+    std::unique_ptr<TextureAtlas> m_textureAtlas;
+    std::unique_ptr<CursorTextureCache> m_cursorTextureCache;
+    std::unordered_map<SurfaceItem *, MipmappedTexture> m_mipmappedTextures;
+    std::unordered_map<Output *, std::unique_ptr<ColorTransformationPass>> m_colorTransformationPasses;
+    ColorTransformationPass *m_currentColorTransformationPass = nullptr;
+    RenderTarget m_colorTransformationTarget;
+    quint64 m_frameCounter = 0;
+    bool m_mipmapsSupported = false;
+    QVector<QPointer<KWaylandServer::ClientBuffer>> m_explicitSyncBuffers;
 };
 
 /**
@@ -115,16 +229,18 @@ public:
     explicit SceneOpenGLShadow(Window *window);
     ~SceneOpenGLShadow() override;
 
-    GLTexture *shadowTexture()
-    {
-        return m_texture.data();
-    }
+    GLTexture *shadowTexture() const;
+    /**
+     * Returns the position of the shadow in shadowTexture().
+     */
+    QPoint shadowTextureOffset() const;
 
 protected:
     bool prepareBackend() override;
 
 private:
     QSharedPointer<GLTexture> m_texture;
+    QSharedPointer<AtlasTexture> m_atlasTexture;
 };
 
 class SceneOpenGLDecorationRenderer : public DecorationRenderer
@@ -143,20 +259,24 @@ public:
 
     void render(const QRegion &region) override;
 
-    GLTexture *texture()
+    GLTexture *texture() const
     {
-        return m_texture.data();
+        return m_texture ? m_texture->texture() : nullptr;
     }
-    GLTexture *texture() const
+    /**
+     * Returns the position of the decoration parts in texture().
+     */
+    QPoint textureOffset() const
     {
-        return m_texture.data();
+        return m_texture ? m_texture->rect().topLeft() : QPoint();
     }
 
 private:
+    void renderDamagedPart(const QRegion &region, const QRect &partRect, const QPoint &textureOffset, qreal devicePixelRatio, bool rotated = false);
     void renderPart(const QRect &rect, const QRect &partRect, const QPoint &textureOffset, qreal devicePixelRatio, bool rotated = false);
     static const QMargins texturePadForPart(const QRect &rect, const QRect &partRect);
     void resizeTexture();
-    QScopedPointer<GLTexture> m_texture;
+    std::unique_ptr<AtlasTexture> m_texture;
 };
 
 } // namespace
@@ -0,0 +1,251 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "textureatlas.h"
+
+#include "kwinglutils.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+// Shelf heights are rounded up to a multiple of this, so similarly sized textures share shelves
+static const int s_shelfGranularity = 8;
+// Textures taller than this fraction of a page get a texture of their own
+static const int s_maxHeightFraction = 4;
+
+class TextureAtlasPage
+{
+public:
+    explicit TextureAtlasPage(const QSize &size)
+        : allocator(size)
+    {
+    }
+
+    std::unique_ptr<GLTexture> texture;
+    ShelfAllocator allocator;
+};
+
+ShelfAllocator::ShelfAllocator(const QSize &size)
+    : m_size(size)
+{
+}
+
+QSize ShelfAllocator::size() const
+{
+    return m_size;
+}
+
+bool ShelfAllocator::isEmpty() const
+{
+    return m_shelves.empty();
+}
+
+std::optional<QRect> ShelfAllocator::allocateInShelf(Shelf &shelf, const QSize &size)
+{
+    for (int i = 0; i < shelf.freeSpans.count(); ++i) {
+        Span &span = shelf.freeSpans[i];
+        if (span.width < size.width()) {
+            continue;
+        }
+        const QRect rect(span.x, shelf.y, size.width(), size.height());
+        span.x += size.width();
+        span.width -= size.width();
+        if (!span.width) {
+            shelf.freeSpans.remove(i);
+        }
+        shelf.allocationCount++;
+        return rect;
+    }
+    return std::nullopt;
+}
+
+int ShelfAllocator::freeShelfPosition(int height) const
+{
+    int y = 0;
+    for (const Shelf &shelf : m_shelves) {
+        if (shelf.y - y >= height) {
+            return y;
+        }
+        y = shelf.y + shelf.height;
+    }
+    if (m_size.height() - y >= height) {
+        return y;
+    }
+    return -1;
+}
+
+std::optional<QRect> ShelfAllocator::allocate(const QSize &size)
+{
+    if (size.isEmpty() || size.width() > m_size.width() || size.height() > m_size.height()) {
+        return std::nullopt;
+    }
+
+    const int shelfHeight = std::min(m_size.height(), (size.height() + s_shelfGranularity - 1) / s_shelfGranularity * s_shelfGranularity);
+
+    // Pick the shelf that wastes the least height; don't put small rects in much taller shelves
+    Shelf *best = nullptr;
+    for (Shelf &shelf : m_shelves) {
+        if (shelf.height < size.height() || shelf.height > shelfHeight * 3 / 2) {
+            continue;
+        }
+        if (best && best->height <= shelf.height) {
+            continue;
+        }
+        const bool fits = std::any_of(shelf.freeSpans.cbegin(), shelf.freeSpans.cend(), [&size](const Span &span) {
+            return span.width >= size.width();
+        });
+        if (fits) {
+            best = &shelf;
+        }
+    }
+    if (best) {
+        return allocateInShelf(*best, size);
+    }
+
+    const int y = freeShelfPosition(shelfHeight);
+    if (y == -1) {
+        return std::nullopt;
+    }
+    auto it = std::find_if(m_shelves.begin(), m_shelves.end(), [y](const Shelf &shelf) {
+        return shelf.y > y;
+    });
+    it = m_shelves.insert(it, Shelf{y, shelfHeight, 0, {Span{0, m_size.width()}}});
+    return allocateInShelf(*it, size);
+}
+
+void ShelfAllocator::deallocate(const QRect &rect)
+{
+    auto shelf = std::find_if(m_shelves.begin(), m_shelves.end(), [&rect](const Shelf &shelf) {
+        return shelf.y == rect.y();
+    });
+    Q_ASSERT(shelf != m_shelves.end());
+    if (shelf == m_shelves.end()) {
+        return;
+    }
+
+    if (--shelf->allocationCount == 0) {
+        m_shelves.erase(shelf);
+        return;
+    }
+
+    QVector<Span> &spans = shelf->freeSpans;
+    auto next = std::find_if(spans.begin(), spans.end(), [&rect](const Span &span) {
+        return span.x > rect.x();
+    });
+    const int index = next - spans.begin();
+    spans.insert(index, Span{rect.x(), rect.width()});
+
+    // Merge with the following and the preceding free span
+    if (index + 1 < spans.count() && spans[index].x + spans[index].width == spans[index + 1].x) {
+        spans[index].width += spans[index + 1].width;
+        spans.remove(index + 1);
+    }
+    if (index > 0 && spans[index - 1].x + spans[index - 1].width == spans[index].x) {
+        spans[index - 1].width += spans[index].width;
+        spans.remove(index);
+    }
+}
+
+AtlasTexture::AtlasTexture(const QSharedPointer<TextureAtlasPage> &page, const QRect &rect)
+    : m_page(page)
+    , m_rect(rect)
+{
+}
+
+AtlasTexture::~AtlasTexture()
+{
+    m_page->allocator.deallocate(m_rect);
+}
+
+GLTexture *AtlasTexture::texture() const
+{
+    return m_page->texture.get();
+}
+
+QRect AtlasTexture::rect() const
+{
+    return m_rect;
+}
+
+void AtlasTexture::update(const QImage &image, const QPoint &offset)
+{
+    m_page->texture->update(image, m_rect.topLeft() + offset);
+}
+
+void AtlasTexture::clear()
+{
+    if (m_rect.size() == m_page->texture->size()) {
+        m_page->texture->clear();
+    } else {
+        QImage image(m_rect.size(), QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        update(image);
+    }
+}
+
+TextureAtlas::TextureAtlas()
+{
+    bool ok = false;
+    const int enabled = qEnvironmentVariableIntValue("KWIN_GL_TEXTURE_ATLAS", &ok);
+    m_enabled = !ok || enabled;
+}
+
+TextureAtlas::~TextureAtlas()
+{
+}
+
+QSharedPointer<TextureAtlasPage> TextureAtlas::createPage(const QSize &size, GLMemoryTracker::Category category) const
+{
+    auto page = QSharedPointer<TextureAtlasPage>::create(size);
+    page->texture = std::make_unique<GLTexture>(GL_RGBA8, size.width(), size.height());
+    page->texture->setMemoryCategory(category);
+    page->texture->setYInverted(true);
+    page->texture->setFilter(GL_LINEAR);
+    page->texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    page->texture->clear();
+    return page;
+}
+
+std::unique_ptr<AtlasTexture> TextureAtlas::allocate(const QSize &size, GLMemoryTracker::Category category)
+{
+    if (size.isEmpty()) {
+        return nullptr;
+    }
+
+    if (m_pageSize.isEmpty()) {
+        GLint maxTextureSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+        const int pageSize = std::min(2048, int(maxTextureSize));
+        m_pageSize = QSize(pageSize, pageSize);
+    }
+
+    if (!m_enabled || size.width() > m_pageSize.width() || size.height() > m_pageSize.height() / s_maxHeightFraction) {
+        auto page = createPage(size, category);
+        return std::make_unique<AtlasTexture>(page, *page->allocator.allocate(size));
+    }
+
+    // Release the pages that became empty, apart from the first one
+    for (int i = m_pages.count() - 1; i > 0; --i) {
+        if (m_pages[i]->allocator.isEmpty()) {
+            m_pages.remove(i);
+        }
+    }
+
+    for (const QSharedPointer<TextureAtlasPage> &page : qAsConst(m_pages)) {
+        if (const auto rect = page->allocator.allocate(size)) {
+            return std::make_unique<AtlasTexture>(page, *rect);
+        }
+    }
+
+    auto page = createPage(m_pageSize, GLMemoryTracker::Decoration);
+    m_pages.append(page);
+    return std::make_unique<AtlasTexture>(page, *page->allocator.allocate(size));
+}
+
+} // namespace KWin
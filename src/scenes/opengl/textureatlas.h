@@ -0,0 +1,133 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+#include <kwingltexture.h>
+
+#include <QImage>
+#include <QRect>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace KWin
+{
+
+class GLTexture;
+class TextureAtlasPage;
+
+/**
+ * The ShelfAllocator class packs rectangles into a fixed size area.
+ *
+ * The area is divided into horizontal shelves, every rectangle is placed in a shelf that
+ * is slightly taller than the rectangle. Freed space is merged with the neighbouring free
+ * space in the shelf, and a shelf is dropped again once it becomes empty.
+ */
+class KWIN_EXPORT ShelfAllocator
+{
+public:
+    explicit ShelfAllocator(const QSize &size);
+
+    QSize size() const;
+    bool isEmpty() const;
+
+    /**
+     * Returns the location of a rectangle of the given @a size, or an empty optional if
+     * there is no room for it.
+     */
+    std::optional<QRect> allocate(const QSize &size);
+    /**
+     * Returns the given @a rect, which must have been returned by allocate(), to the free space.
+     */
+    void deallocate(const QRect &rect);
+
+private:
+    struct Span
+    {
+        int x;
+        int width;
+    };
+
+    struct Shelf
+    {
+        int y;
+        int height;
+        int allocationCount;
+        QVector<Span> freeSpans;
+    };
+
+    std::optional<QRect> allocateInShelf(Shelf &shelf, const QSize &size);
+    int freeShelfPosition(int height) const;
+
+    QSize m_size;
+    std::vector<Shelf> m_shelves;
+};
+
+/**
+ * The AtlasTexture class represents a rectangle in a texture that is potentially shared
+ * with other atlas textures. The rectangle is released when the atlas texture is destroyed,
+ * so the OpenGL context must be current at that point.
+ */
+class KWIN_EXPORT AtlasTexture
+{
+public:
+    AtlasTexture(const QSharedPointer<TextureAtlasPage> &page, const QRect &rect);
+    ~AtlasTexture();
+
+    GLTexture *texture() const;
+    QRect rect() const;
+
+    /**
+     * Uploads the @a image at the given @a offset relative to the top left corner of the rect.
+     */
+    void update(const QImage &image, const QPoint &offset = QPoint());
+    /**
+     * Fills the rect with transparent pixels.
+     */
+    void clear();
+
+private:
+    QSharedPointer<TextureAtlasPage> m_page;
+    QRect m_rect;
+};
+
+/**
+ * The TextureAtlas class allocates small textures such as decoration and shadow textures
+ * from a few large textures. Render nodes that draw from the same atlas texture can be
+ * merged into a single draw call.
+ *
+ * Textures that are too big for the atlas get a texture of their own. Setting the
+ * KWIN_GL_TEXTURE_ATLAS environment variable to 0 disables the sharing.
+ */
+class KWIN_EXPORT TextureAtlas
+{
+public:
+    TextureAtlas();
+    ~TextureAtlas();
+
+    /**
+     * Allocates a texture of the given @a size. The OpenGL context must be current.
+     *
+     * A texture that gets a page of its own reports its memory under @a category, the
+     * memory of shared pages is reported as GLMemoryTracker::Decoration.
+     */
+    std::unique_ptr<AtlasTexture> allocate(const QSize &size, GLMemoryTracker::Category category = GLMemoryTracker::Decoration);
+
+private:
+    QSharedPointer<TextureAtlasPage> createPage(const QSize &size, GLMemoryTracker::Category category) const;
+
+    QVector<QSharedPointer<TextureAtlasPage>> m_pages;
+    QSize m_pageSize;
+    bool m_enabled = true;
+};
+
+} // namespace KWin
@@ -17,6 +17,7 @@
 #include "main.h"
 #include "output.h"
 #include "platform.h"
+#include "renderlayer.h"
 #include "renderloop.h"
 #include "screens.h"
 #include "surfaceitem.h"
@@ -28,8 +29,11 @@
 #include <KDecoration2/Decoration>
 #include <QDebug>
 #include <QPainter>
+#include <QtConcurrentMap>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 namespace KWin
 {
@@ -47,6 +51,9 @@ SceneQPainter::SceneQPainter(QPainterBackend *backend, QObject *parent)
     , m_backend(backend)
     , m_painter(new QPainter())
 {
+    connect(kwinApp()->platform(), &Platform::outputDisabled, this, [this](Output *output) {
+        m_sceneCaches.remove(output);
+    });
 }
 
 SceneQPainter::~SceneQPainter()
@@ -67,15 +74,50 @@ void SceneQPainter::paintGenericScreen(int mask, const ScreenPaintData &data)
     m_painter->restore();
 }
 
+void SceneQPainter::prePaint(Output *output)
+{
+    Scene::prePaint(output);
+
+    // Only what the scene itself damaged has to be rendered, the repaints of the
+    // workspace layer are reset before painting starts.
+    SceneCache &cache = m_sceneCaches[painted_screen];
+    cache.dirty += damage();
+    const auto sceneDelegates = delegates();
+    for (SceneDelegate *delegate : sceneDelegates) {
+        if (delegate->viewport() == renderTargetRect()) {
+            cache.dirty += delegate->layer()->repaints().translated(delegate->viewport().topLeft());
+        }
+    }
+    cache.dirty &= renderTargetRect();
+}
+
 void SceneQPainter::paint(RenderTarget *target, const QRegion &region)
 {
     QImage *buffer = std::get<QImage *>(target->nativeHandle());
-    if (buffer && !buffer->isNull()) {
-        m_painter->begin(buffer);
-        m_painter->setWindow(painted_screen->geometry());
-        paintScreen(region);
+    if (!buffer || buffer->isNull()) {
+        return;
+    }
+
+    SceneCache &cache = m_sceneCaches[painted_screen];
+    if (cache.image.size() != buffer->size() || cache.image.format() != buffer->format()) {
+        cache.image = QImage(buffer->size(), buffer->format());
+        cache.dirty = renderTargetRect();
+    }
+
+    const QRegion sceneRegion = region & cache.dirty;
+    if (!sceneRegion.isEmpty()) {
+        m_painter->begin(&cache.image);
+        m_painter->setWindow(renderTargetRect());
+        paintScreen(sceneRegion);
         m_painter->end();
+        cache.dirty -= sceneRegion;
     }
+
+    QPainter painter(buffer);
+    painter.setWindow(renderTargetRect());
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.setClipRegion(region);
+    painter.drawImage(renderTargetRect(), cache.image);
 }
 
 void SceneQPainter::paintBackground(const QRegion &region)
@@ -94,6 +136,9 @@ void SceneQPainter::paintOffscreenQuickView(OffscreenQuickView *w)
     }
     painter->save();
     painter->setOpacity(w->opacity());
+    if (w->isOpaque() && w->opacity() == 1.0) {
+        painter->setCompositionMode(QPainter::CompositionMode_Source);
+    }
     painter->drawImage(w->geometry(), buffer);
     painter->restore();
 }
@@ -127,12 +172,12 @@ void SceneQPainter::render(Item *item, int mask, const QRegion &_region, const W
         painter->scale(data.xScale(), data.yScale());
     }
 
-    renderItem(painter, item);
+    renderItem(painter, item, mask);
 
     painter->restore();
 }
 
-void SceneQPainter::renderItem(QPainter *painter, Item *item) const
+void SceneQPainter::renderItem(QPainter *painter, Item *item, int mask) const
 {
     const QList<Item *> sortedChildItems = item->sortedChildItems();
 
@@ -145,15 +190,17 @@ void SceneQPainter::renderItem(QPainter *painter, Item *item) const
             break;
         }
         if (childItem->explicitVisible()) {
-            renderItem(painter, childItem);
+            renderItem(painter, childItem, mask);
         }
     }
 
-    item->preprocess();
-    if (auto surfaceItem = qobject_cast<SurfaceItem *>(item)) {
-        renderSurfaceItem(painter, surfaceItem);
-    } else if (auto decorationItem = qobject_cast<DecorationItem *>(item)) {
-        renderDecorationItem(painter, decorationItem);
+    if (!isItemOccluded(item, mask)) {
+        item->preprocess();
+        if (auto surfaceItem = qobject_cast<SurfaceItem *>(item)) {
+            renderSurfaceItem(painter, surfaceItem);
+        } else if (auto decorationItem = qobject_cast<DecorationItem *>(item)) {
+            renderDecorationItem(painter, decorationItem);
+        }
     }
 
     for (Item *childItem : sortedChildItems) {
@@ -161,13 +208,82 @@ void SceneQPainter::renderItem(QPainter *painter, Item *item) const
             continue;
         }
         if (childItem->explicitVisible()) {
-            renderItem(painter, childItem);
+            renderItem(painter, childItem, mask);
         }
     }
 
     painter->restore();
 }
 
+/**
+ * Copies opaque surface contents straight into the render target, bypassing the QPainter
+ * raster pipeline. This is only possible if the source is drawn unscaled at an integer
+ * offset, without opacity and onto a 32-bit image. Returns @c false if any of that is
+ * not the case and the caller has to paint the image.
+ */
+static bool blitOpaque(QPainter *painter, const QImage &source, const QRectF &sourceRect, const QRectF &targetRect)
+{
+    if (source.format() != QImage::Format_RGB32 || painter->opacity() != 1.0
+        || painter->compositionMode() != QPainter::CompositionMode_SourceOver
+        || painter->device()->devType() != QInternal::Image) {
+        return false;
+    }
+    QImage *target = static_cast<QImage *>(painter->device());
+    if (target->format() != QImage::Format_RGB32 && target->format() != QImage::Format_ARGB32
+        && target->format() != QImage::Format_ARGB32_Premultiplied) {
+        return false;
+    }
+
+    const QTransform transform = painter->combinedTransform();
+    if (transform.type() > QTransform::TxTranslate || sourceRect.size() != targetRect.size()) {
+        return false;
+    }
+    const QRectF mappedRect = transform.mapRect(targetRect);
+    const QRect deviceRect = mappedRect.toRect();
+    const QPoint sourceOrigin = sourceRect.topLeft().toPoint();
+    if (QRectF(deviceRect) != mappedRect || QPointF(sourceOrigin) != sourceRect.topLeft()) {
+        return false;
+    }
+
+    QRegion region = QRegion(deviceRect) & target->rect();
+    region &= source.rect().translated(deviceRect.topLeft() - sourceOrigin);
+    if (painter->hasClipping()) {
+        region &= transform.map(painter->clipRegion());
+    }
+
+    // Large copies, typically fullscreen windows, are split into bands of rows that are
+    // copied on the thread pool, the rest isn't worth the synchronization.
+    static const int bandHeight = 64;
+    QVector<QRect> bands;
+    for (const QRect &rect : region) {
+        for (int y = rect.top(); y <= rect.bottom(); y += bandHeight) {
+            bands.append(QRect(rect.left(), y, rect.width(), std::min(bandHeight, rect.bottom() - y + 1)));
+        }
+    }
+
+    // Bits are resolved up front, the workers must not detach either image
+    const uchar *sourceBits = source.constBits();
+    const qsizetype sourceStride = source.bytesPerLine();
+    uchar *targetBits = target->bits();
+    const qsizetype targetStride = target->bytesPerLine();
+    const QPoint offset = sourceOrigin - deviceRect.topLeft();
+    const auto copyBand = [=](const QRect &band) {
+        const size_t bytes = band.width() * 4;
+        for (int y = band.top(); y <= band.bottom(); ++y) {
+            const uchar *sourceLine = sourceBits + (y + offset.y()) * sourceStride + (band.left() + offset.x()) * 4;
+            uchar *targetLine = targetBits + y * targetStride + band.left() * 4;
+            std::memcpy(targetLine, sourceLine, bytes);
+        }
+    };
+
+    if (bands.count() > 4) {
+        QtConcurrent::blockingMap(bands, copyBand);
+    } else {
+        std::for_each(bands.constBegin(), bands.constEnd(), copyBand);
+    }
+    return true;
+}
+
 void SceneQPainter::renderSurfaceItem(QPainter *painter, SurfaceItem *surfaceItem) const
 {
     const SurfacePixmap *surfaceTexture = surfaceItem->pixmap();
@@ -190,8 +306,12 @@ void SceneQPainter::renderSurfaceItem(QPainter *painter, SurfaceItem *surfaceIte
         const QPointF bufferTopLeft = matrix.map(rect.topLeft());
         const QPointF bufferBottomRight = matrix.map(rect.bottomRight());
 
-        painter->drawImage(rect, platformSurfaceTexture->image(),
-                           QRectF(bufferTopLeft, bufferBottomRight));
+        const QRectF sourceRect(bufferTopLeft, bufferBottomRight);
+        // Rotated or flipped buffers always go through QPainter
+        const bool untransformed = matrix(0, 1) == 0 && matrix(1, 0) == 0 && matrix(0, 0) > 0 && matrix(1, 1) > 0;
+        if (!untransformed || !blitOpaque(painter, platformSurfaceTexture->image(), sourceRect, rect)) {
+            painter->drawImage(rect, platformSurfaceTexture->image(), sourceRect);
+        }
     }
 }
 
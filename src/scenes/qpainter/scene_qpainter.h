@@ -15,6 +15,8 @@
 #include "scene.h"
 #include "shadow.h"
 
+#include <QHash>
+
 namespace KWin
 {
 
@@ -24,6 +26,7 @@ class KWIN_EXPORT SceneQPainter : public Scene
 
 public:
     ~SceneQPainter() override;
+    void prePaint(Output *output) override;
     void paint(RenderTarget *renderTarget, const QRegion &region) override;
     void paintGenericScreen(int mask, const ScreenPaintData &data) override;
     bool initFailed() const override;
@@ -56,10 +59,23 @@ private:
 
     void renderSurfaceItem(QPainter *painter, SurfaceItem *surfaceItem) const;
     void renderDecorationItem(QPainter *painter, DecorationItem *decorationItem) const;
-    void renderItem(QPainter *painter, Item *item) const;
+    void renderItem(QPainter *painter, Item *item, int mask) const;
+
+    /**
+     * The last rendered scene of an output, without any layers on top of it. Parts of the
+     * frame that only have to be repainted because of the software cursor, or because
+     * they are outdated in the new back buffer, are copied from here instead of being
+     * rendered again.
+     */
+    struct SceneCache
+    {
+        QImage image;
+        QRegion dirty;
+    };
 
     QPainterBackend *m_backend;
     QScopedPointer<QPainter> m_painter;
+    QHash<Output *, SceneCache> m_sceneCaches;
 };
 
 class SceneQPainterShadow : public Shadow
@@ -1558,6 +1558,8 @@ bool ScreenEdges::handleDndNotify(xcb_window_t window, const QPoint &point)
 void ScreenEdges::ensureOnTop()
 {
     Xcb::restackWindowsWithRaise(windows());
+    // The edges are above the support window now, restore the whole stack next time
+    workspace()->invalidateX11Stack();
 }
 
 QVector<xcb_window_t> ScreenEdges::windows() const
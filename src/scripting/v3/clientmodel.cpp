@@ -21,14 +21,20 @@ ClientModel::ClientModel(QObject *parent)
     connect(workspace(), &Workspace::windowRemoved, this, &ClientModel::handleClientRemoved);
 
     m_clients = workspace()->allClientList();
-    for (Window *client : qAsConst(m_clients)) {
-        setupClientConnections(client);
+    m_rows.reserve(m_clients.count());
+    for (int i = 0; i < m_clients.count(); ++i) {
+        m_rows.insert(m_clients[i], i);
+        setupClientConnections(m_clients[i]);
     }
 }
 
 void ClientModel::markRoleChanged(Window *client, int role)
 {
-    const QModelIndex row = index(m_clients.indexOf(client), 0);
+    const auto it = m_rows.constFind(client);
+    if (it == m_rows.constEnd()) {
+        return;
+    }
+    const QModelIndex row = index(*it, 0);
     Q_EMIT dataChanged(row, row, {role});
 }
 
@@ -43,11 +49,19 @@ void ClientModel::setupClientConnections(Window *client)
     connect(client, &Window::activitiesChanged, this, [this, client]() {
         markRoleChanged(client, ActivityRole);
     });
+    // ClientFilterModel also filters by these, let it re-evaluate just this row
+    connect(client, &Window::minimizedChanged, this, [this, client]() {
+        markRoleChanged(client, Qt::DisplayRole);
+    });
+    connect(client, &Window::captionChanged, this, [this, client]() {
+        markRoleChanged(client, Qt::DisplayRole);
+    });
 }
 
 void ClientModel::handleClientAdded(Window *client)
 {
     beginInsertRows(QModelIndex(), m_clients.count(), m_clients.count());
+    m_rows.insert(client, m_clients.count());
     m_clients.append(client);
     endInsertRows();
 
@@ -56,11 +70,17 @@ void ClientModel::handleClientAdded(Window *client)
 
 void ClientModel::handleClientRemoved(Window *client)
 {
-    const int index = m_clients.indexOf(client);
+    const int index = m_rows.value(client, -1);
     Q_ASSERT(index != -1);
 
+    disconnect(client, nullptr, this, nullptr);
+
     beginRemoveRows(QModelIndex(), index, index);
     m_clients.removeAt(index);
+    m_rows.remove(client);
+    for (int i = index; i < m_clients.count(); ++i) {
+        m_rows[m_clients[i]] = i;
+    }
     endRemoveRows();
 }
 
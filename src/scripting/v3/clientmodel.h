@@ -48,6 +48,8 @@ private:
     void setupClientConnections(Window *client);
 
     QList<Window *> m_clients;
+    // the row of every client, so that a change doesn't have to search m_clients
+    QHash<Window *, int> m_rows;
 };
 
 class ClientFilterModel : public QSortFilterProxyModel
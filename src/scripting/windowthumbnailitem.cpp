@@ -13,6 +13,7 @@
 #include "scene.h"
 #include "screens.h"
 #include "scripting_logging.h"
+#include "surfaceitem.h"
 #include "virtualdesktops.h"
 #include "window.h"
 #include "windowitem.h"
@@ -101,18 +102,255 @@ private:
     QScopedPointer<ThumbnailTextureProvider> m_provider;
 };
 
+/**
+ * The WindowThumbnailSource class holds the offscreen texture of a window at a given size.
+ *
+ * The sources are shared by all thumbnail items that show the same window at the same
+ * texture size, e.g. the thumbnails of a window in Overview on several screens, so the
+ * window is rendered once per damage rather than once per thumbnail.
+ */
+class WindowThumbnailSource : public QEnableSharedFromThis<WindowThumbnailSource>
+{
+public:
+    WindowThumbnailSource(Window *window, const QSize &textureSize);
+    ~WindowThumbnailSource();
+
+    static QSharedPointer<WindowThumbnailSource> acquire(Window *window, const QSize &textureSize);
+
+    Window *window() const;
+    QSize textureSize() const;
+    QSharedPointer<GLTexture> texture() const;
+
+    /**
+     * Re-renders the parts of the window that have been damaged since the last update. The
+     * serial is incremented every time the texture contents change.
+     */
+    void update();
+    bool isDirty() const;
+    quint64 serial() const;
+
+    /**
+     * Waits until the rendering commands to the texture have completed.
+     */
+    void waitForRendering();
+
+private:
+    void addDamage(const QRegion &damage);
+
+    static QMultiHash<Window *, WindowThumbnailSource *> s_sources;
+
+    Window *m_key;
+    QPointer<Window> m_window;
+    QSize m_textureSize;
+    QSharedPointer<GLTexture> m_offscreenTexture;
+    QScopedPointer<GLFramebuffer> m_offscreenTarget;
+    GLsync m_acquireFence = 0;
+    quint64 m_serial = 0;
+    bool m_dirty = true; // the whole texture must be rendered again
+    QRegion m_damage; // relative to the visible geometry
+    QRect m_renderedGeometry;
+    QMetaObject::Connection m_damagedConnection;
+    QMetaObject::Connection m_geometryConnection;
+};
+
+QMultiHash<Window *, WindowThumbnailSource *> WindowThumbnailSource::s_sources;
+
+WindowThumbnailSource::WindowThumbnailSource(Window *window, const QSize &textureSize)
+    : m_key(window)
+    , m_window(window)
+    , m_textureSize(textureSize)
+{
+    m_damagedConnection = QObject::connect(window, &Window::damaged, [this](Window *, const QRegion &damage) {
+        addDamage(damage);
+    });
+    m_geometryConnection = QObject::connect(window, &Window::frameGeometryChanged, [this]() {
+        m_dirty = true;
+    });
+    window->refOffscreenRendering();
+    s_sources.insert(m_key, this);
+}
+
+WindowThumbnailSource::~WindowThumbnailSource()
+{
+    s_sources.remove(m_key, this);
+    if (m_window) {
+        m_window->unrefOffscreenRendering();
+    }
+    QObject::disconnect(m_damagedConnection);
+    QObject::disconnect(m_geometryConnection);
+
+    if (!Compositor::compositing() || Compositor::self()->backend()->compositingType() != OpenGLCompositing) {
+        return;
+    }
+
+    Scene *scene = Compositor::self()->scene();
+    scene->makeOpenGLContextCurrent();
+    m_offscreenTarget.reset();
+    m_offscreenTexture.reset();
+
+    if (m_acquireFence) {
+        glDeleteSync(m_acquireFence);
+        m_acquireFence = 0;
+    }
+    scene->doneOpenGLContextCurrent();
+}
+
+QSharedPointer<WindowThumbnailSource> WindowThumbnailSource::acquire(Window *window, const QSize &textureSize)
+{
+    for (auto it = s_sources.constFind(window); it != s_sources.constEnd() && it.key() == window; ++it) {
+        if ((*it)->textureSize() == textureSize) {
+            return (*it)->sharedFromThis();
+        }
+    }
+    return QSharedPointer<WindowThumbnailSource>::create(window, textureSize);
+}
+
+Window *WindowThumbnailSource::window() const
+{
+    return m_window;
+}
+
+QSize WindowThumbnailSource::textureSize() const
+{
+    return m_textureSize;
+}
+
+QSharedPointer<GLTexture> WindowThumbnailSource::texture() const
+{
+    return m_offscreenTexture;
+}
+
+quint64 WindowThumbnailSource::serial() const
+{
+    return m_serial;
+}
+
+bool WindowThumbnailSource::isDirty() const
+{
+    return m_dirty || !m_damage.isEmpty();
+}
+
+void WindowThumbnailSource::addDamage(const QRegion &damage)
+{
+    if (m_dirty || !m_window) {
+        return;
+    }
+
+    // The damage is relative to the surface that got damaged. Subsurfaces are not told
+    // apart, so only the damage of a window without them can be mapped exactly.
+    const SurfaceItem *surfaceItem = m_window->windowItem()->surfaceItem();
+    if (!surfaceItem || !surfaceItem->childItems().isEmpty()) {
+        m_dirty = true;
+        return;
+    }
+    m_damage += surfaceItem->mapToGlobal(damage).translated(-m_window->visibleGeometry().topLeft());
+}
+
+void WindowThumbnailSource::waitForRendering()
+{
+    // Wait for rendering commands to the offscreen texture complete if there are any.
+    if (m_acquireFence) {
+        glClientWaitSync(m_acquireFence, GL_SYNC_FLUSH_COMMANDS_BIT, 5000);
+        glDeleteSync(m_acquireFence);
+        m_acquireFence = 0;
+    }
+}
+
+void WindowThumbnailSource::update()
+{
+    if (m_acquireFence || !isDirty() || !m_window) {
+        return;
+    }
+
+    if (!m_offscreenTexture) {
+        m_dirty = true;
+        m_offscreenTexture.reset(new GLTexture(GL_RGBA8, m_textureSize));
+        m_offscreenTexture->setMemoryCategory(GLMemoryTracker::Thumbnail);
+        m_offscreenTexture->setFilter(GL_LINEAR);
+        m_offscreenTexture->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_offscreenTarget.reset(new GLFramebuffer(m_offscreenTexture.data()));
+    }
+
+    const QRect geometry = m_window->visibleGeometry();
+    if (geometry != m_renderedGeometry || geometry.isEmpty()) {
+        m_dirty = true;
+    }
+
+    // Only the damaged part of the texture is rendered again, scaled to the texture size.
+    QRect scissor;
+    if (!m_dirty) {
+        const qreal xScale = qreal(m_textureSize.width()) / geometry.width();
+        const qreal yScale = qreal(m_textureSize.height()) / geometry.height();
+        const QRect damage = m_damage.boundingRect();
+        // Grow by a pixel, the texture is sampled with linear filtering.
+        scissor = QRectF(damage.x() * xScale, damage.y() * yScale, damage.width() * xScale, damage.height() * yScale)
+                      .toAlignedRect()
+                      .adjusted(-1, -1, 1, 1)
+                      .intersected(QRect(QPoint(), m_textureSize));
+        if (scissor.isEmpty()) {
+            m_damage = QRegion();
+            return;
+        }
+    }
+
+    GLFramebuffer::pushFramebuffer(m_offscreenTarget.data());
+    if (!m_dirty) {
+        // The projection maps the top of the window to the first row of the framebuffer,
+        // so the scissor rect doesn't need to be flipped.
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(scissor.x(), scissor.y(), scissor.width(), scissor.height());
+    }
+    glClearColor(0.0, 0.0, 0.0, 0.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    QMatrix4x4 projectionMatrix;
+    projectionMatrix.ortho(geometry.x(), geometry.x() + geometry.width(),
+                           geometry.y(), geometry.y() + geometry.height(), -1, 1);
+
+    WindowPaintData data;
+    data.setProjectionMatrix(projectionMatrix);
+
+    // The thumbnail must be rendered using kwin's opengl context as VAOs are not
+    // shared across contexts. Unfortunately, this also introduces a latency of 1
+    // frame, which is not ideal, but it is acceptable for things such as thumbnails.
+    const int mask = Scene::PAINT_WINDOW_TRANSFORMED;
+    Compositor::self()->scene()->render(m_window->windowItem(), mask, infiniteRegion(), data);
+    if (!m_dirty) {
+        glDisable(GL_SCISSOR_TEST);
+    }
+    GLFramebuffer::popFramebuffer();
+
+    // The fence is needed to avoid the case where qtquick renderer starts using
+    // the texture while all rendering commands to it haven't completed yet.
+    m_dirty = false;
+    m_damage = QRegion();
+    m_renderedGeometry = geometry;
+    m_acquireFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ++m_serial;
+}
+
 WindowThumbnailItem::WindowThumbnailItem(QQuickItem *parent)
     : QQuickItem(parent)
 {
     setFlag(ItemHasContents);
     updateFrameRenderingConnection();
 
+    m_throttleTimer.setSingleShot(true);
+    connect(&m_throttleTimer, &QTimer::timeout, this, &WindowThumbnailItem::updateThrottledOffscreenTexture);
+
     connect(Compositor::self(), &Compositor::aboutToToggleCompositing,
             this, &WindowThumbnailItem::destroyOffscreenTexture);
     connect(Compositor::self(), &Compositor::compositingToggled,
             this, &WindowThumbnailItem::updateFrameRenderingConnection);
     connect(this, &QQuickItem::windowChanged,
             this, &WindowThumbnailItem::updateFrameRenderingConnection);
+    connect(GLMemoryTracker::self(), &GLMemoryTracker::evictionRequested, this, [this]() {
+        if (m_source && !isVisible()) {
+            destroyOffscreenTexture();
+            // let the scene graph drop the last frame as well
+            update();
+        }
+    });
 }
 
 WindowThumbnailItem::~WindowThumbnailItem()
@@ -193,39 +431,32 @@ void WindowThumbnailItem::destroyOffscreenTexture()
         return;
     }
 
-    if (m_offscreenTexture) {
-        Scene *scene = Compositor::self()->scene();
-        scene->makeOpenGLContextCurrent();
-        m_offscreenTarget.reset();
-        m_offscreenTexture.reset();
-
-        if (m_acquireFence) {
-            glDeleteSync(m_acquireFence);
-            m_acquireFence = 0;
-        }
-        scene->doneOpenGLContextCurrent();
-    }
+    m_source.reset();
 }
 
 QSGNode *WindowThumbnailItem::updatePaintNode(QSGNode *oldNode, QQuickItem::UpdatePaintNodeData *)
 {
-    if (Compositor::compositing() && !m_offscreenTexture) {
+    const QSharedPointer<GLTexture> offscreenTexture = m_source ? m_source->texture() : nullptr;
+    if (Compositor::compositing() && !offscreenTexture) {
+        if (m_provider && !isVisible()) {
+            // The texture of a hidden thumbnail has been evicted
+            m_provider->setTexture(static_cast<QSGTexture *>(nullptr));
+            delete oldNode;
+            return nullptr;
+        }
         return oldNode;
     }
 
-    // Wait for rendering commands to the offscreen texture complete if there are any.
-    if (m_acquireFence) {
-        glClientWaitSync(m_acquireFence, GL_SYNC_FLUSH_COMMANDS_BIT, 5000);
-        glDeleteSync(m_acquireFence);
-        m_acquireFence = 0;
+    if (m_source) {
+        m_source->waitForRendering();
     }
 
     if (!m_provider) {
         m_provider = new ThumbnailTextureProvider(window());
     }
 
-    if (m_offscreenTexture) {
-        m_provider->setTexture(m_offscreenTexture);
+    if (offscreenTexture) {
+        m_provider->setTexture(offscreenTexture);
     } else {
         const QImage placeholderImage = fallbackImage();
         m_provider->setTexture(window()->createTextureFromImage(placeholderImage));
@@ -239,7 +470,7 @@ QSGNode *WindowThumbnailItem::updatePaintNode(QSGNode *oldNode, QQuickItem::Upda
     }
     node->setTexture(m_provider->texture());
 
-    if (m_offscreenTexture && m_offscreenTexture->isYInverted()) {
+    if (offscreenTexture && offscreenTexture->isYInverted()) {
         node->setTextureCoordinatesTransform(QSGImageNode::MirrorVertically);
     } else {
         node->setTextureCoordinatesTransform(QSGImageNode::NoTransform);
@@ -369,7 +600,7 @@ QRectF WindowThumbnailItem::paintedRect() const
     if (!m_client) {
         return QRectF();
     }
-    if (!m_offscreenTexture) {
+    if (!m_source || !m_source->texture()) {
         const QSizeF iconSize = m_client->icon().actualSize(window(), boundingRect().size().toSize());
         return centeredSize(boundingRect(), iconSize);
     }
@@ -392,19 +623,8 @@ QRectF WindowThumbnailItem::paintedRect() const
     return paintedRect;
 }
 
-void WindowThumbnailItem::invalidateOffscreenTexture()
+QSize WindowThumbnailItem::desiredTextureSize() const
 {
-    m_dirty = true;
-    update();
-}
-
-void WindowThumbnailItem::updateOffscreenTexture()
-{
-    if (m_acquireFence || !m_dirty || !m_client) {
-        return;
-    }
-    Q_ASSERT(window());
-
     const QRect geometry = m_client->visibleGeometry();
     QSize textureSize = geometry.size();
     if (sourceSize().width() > 0) {
@@ -414,41 +634,99 @@ void WindowThumbnailItem::updateOffscreenTexture()
         textureSize.setHeight(sourceSize().height());
     }
 
-    m_devicePixelRatio = window()->devicePixelRatio();
-    textureSize *= m_devicePixelRatio;
+    if (!sourceSize().isValid()) {
+        // Render small thumbnails at a fraction of the window size. The fractions are powers
+        // of two, so the thumbnails of a window that are shown at similar sizes share a texture
+        // and the texture doesn't change with every step of an animation.
+        const QRect frameGeometry = m_client->frameGeometry();
+        if (!frameGeometry.isEmpty() && !boundingRect().isEmpty()) {
+            const qreal scale = std::min(boundingRect().width() / frameGeometry.width(),
+                                         boundingRect().height() / frameGeometry.height());
+            int level = 0;
+            while (level < 4 && scale * (2 << level) <= 1.0) {
+                ++level;
+            }
+            textureSize = QSize(std::max(1, textureSize.width() >> level),
+                                std::max(1, textureSize.height() >> level));
+        }
+    }
 
-    if (!m_offscreenTexture || m_offscreenTexture->size() != textureSize) {
-        m_offscreenTexture.reset(new GLTexture(GL_RGBA8, textureSize));
-        m_offscreenTexture->setFilter(GL_LINEAR);
-        m_offscreenTexture->setWrapMode(GL_CLAMP_TO_EDGE);
-        m_offscreenTarget.reset(new GLFramebuffer(m_offscreenTexture.data()));
+    return textureSize * window()->devicePixelRatio();
+}
+
+void WindowThumbnailItem::invalidateOffscreenTexture()
+{
+    update();
+}
+
+// Thumbnails whose longer side is below this many logical pixels are updated at most
+// every s_smallThumbnailInterval milliseconds.
+static const int s_smallThumbnailSize = 192;
+static const int s_smallThumbnailInterval = 100;
+
+bool WindowThumbnailItem::isSmall() const
+{
+    const QSizeF size = paintedRect().size();
+    return std::max(size.width(), size.height()) < s_smallThumbnailSize;
+}
+
+void WindowThumbnailItem::updateThrottledOffscreenTexture()
+{
+    if (!Compositor::compositing() || Compositor::self()->backend()->compositingType() != OpenGLCompositing) {
+        return;
+    }
+    if (!window()) {
+        return;
     }
 
-    GLFramebuffer::pushFramebuffer(m_offscreenTarget.data());
-    glClearColor(0.0, 0.0, 0.0, 0.0);
-    glClear(GL_COLOR_BUFFER_BIT);
+    // The window may have stopped repainting, so no frame would pick up the pending damage.
+    Scene *scene = Compositor::self()->scene();
+    scene->makeOpenGLContextCurrent();
+    updateOffscreenTexture();
+    scene->doneOpenGLContextCurrent();
+}
 
-    QMatrix4x4 projectionMatrix;
-    projectionMatrix.ortho(geometry.x(), geometry.x() + geometry.width(),
-                           geometry.y(), geometry.y() + geometry.height(), -1, 1);
+void WindowThumbnailItem::updateOffscreenTexture()
+{
+    if (!m_client) {
+        m_source.reset();
+        return;
+    }
+    Q_ASSERT(window());
+    // A hidden thumbnail whose texture has been evicted is rendered again once it's shown
+    if (!m_source && !isVisible()) {
+        return;
+    }
 
-    WindowPaintData data;
-    data.setProjectionMatrix(projectionMatrix);
+    m_devicePixelRatio = window()->devicePixelRatio();
 
-    // The thumbnail must be rendered using kwin's opengl context as VAOs are not
-    // shared across contexts. Unfortunately, this also introduces a latency of 1
-    // frame, which is not ideal, but it is acceptable for things such as thumbnails.
-    const int mask = Scene::PAINT_WINDOW_TRANSFORMED;
-    Compositor::self()->scene()->render(m_client->windowItem(), mask, infiniteRegion(), data);
-    GLFramebuffer::popFramebuffer();
+    const QSize textureSize = desiredTextureSize();
+    if (textureSize.isEmpty()) {
+        return;
+    }
+    if (!m_source || m_source->window() != m_client || m_source->textureSize() != textureSize) {
+        m_source = WindowThumbnailSource::acquire(m_client, textureSize);
+        m_sourceSerial = 0;
+    }
 
-    // The fence is needed to avoid the case where qtquick renderer starts using
-    // the texture while all rendering commands to it haven't completed yet.
-    m_dirty = false;
-    m_acquireFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (m_source->texture() && m_source->isDirty() && isSmall()) {
+        if (m_lastUpdate.isValid() && m_lastUpdate.elapsed() < s_smallThumbnailInterval) {
+            if (!m_throttleTimer.isActive()) {
+                m_throttleTimer.start(s_smallThumbnailInterval - m_lastUpdate.elapsed());
+            }
+            return;
+        }
+    }
+    m_throttleTimer.stop();
+    m_lastUpdate.start();
 
-    // We know that the texture has changed, so schedule an item update.
-    update();
+    m_source->update();
+
+    // If the texture has changed, schedule an item update.
+    if (m_sourceSerial != m_source->serial()) {
+        m_sourceSerial = m_source->serial();
+        update();
+    }
 }
 
 } // namespace KWin
@@ -7,17 +7,18 @@
 
 #pragma once
 
+#include <QElapsedTimer>
 #include <QQuickItem>
+#include <QTimer>
 #include <QUuid>
 
-#include <epoxy/gl.h>
-
 namespace KWin
 {
 class Window;
 class GLFramebuffer;
 class GLTexture;
 class ThumbnailTextureProvider;
+class WindowThumbnailSource;
 
 class WindowThumbnailItem : public QQuickItem
 {
@@ -82,22 +83,26 @@ Q_SIGNALS:
 private:
     QImage fallbackImage() const;
     QRectF paintedRect() const;
+    QSize desiredTextureSize() const;
     void invalidateOffscreenTexture();
     void updateOffscreenTexture();
     void destroyOffscreenTexture();
     void updateImplicitSize();
     void updateFrameRenderingConnection();
+    void updateThrottledOffscreenTexture();
+    bool isSmall() const;
 
     QSize m_sourceSize;
     QUuid m_wId;
     QPointer<Window> m_client;
-    bool m_dirty = false;
 
     mutable ThumbnailTextureProvider *m_provider = nullptr;
-    QSharedPointer<GLTexture> m_offscreenTexture;
-    QScopedPointer<GLFramebuffer> m_offscreenTarget;
-    GLsync m_acquireFence = 0;
+    QSharedPointer<WindowThumbnailSource> m_source;
+    quint64 m_sourceSerial = 0;
     qreal m_devicePixelRatio = 1;
+    // small thumbnails are updated at a lower rate than the window repaints
+    QElapsedTimer m_lastUpdate;
+    QTimer m_throttleTimer;
 
     QMetaObject::Connection m_frameRenderingConnection;
 };
@@ -12,6 +12,7 @@
 #include "outline.h"
 #include "platform.h"
 #include "screens.h"
+#include "scripting_logging.h"
 #include "virtualdesktops.h"
 #include "workspace.h"
 #include "x11window.h"
@@ -21,6 +22,9 @@
 
 #include <QApplication>
 #include <QDesktopWidget>
+#include <QMetaMethod>
+
+#include <utility>
 
 namespace KWin
 {
@@ -30,6 +34,26 @@ WorkspaceWrapper::WorkspaceWrapper(QObject *parent)
 {
     KWin::Workspace *ws = KWin::Workspace::self();
     KWin::VirtualDesktopManager *vds = KWin::VirtualDesktopManager::self();
+
+    m_windowChangesTimer.setSingleShot(true);
+    connect(&m_windowChangesTimer, &QTimer::timeout, this, &WorkspaceWrapper::emitWindowChanges);
+    connect(ws, &Workspace::windowAdded, this, [this](Window *window) {
+        if (tracksWindowChanges()) {
+            m_addedWindows.append(window);
+            scheduleWindowChanges();
+        }
+    });
+    connect(ws, &Workspace::windowRemoved, this, [this](Window *window) {
+        // The window is about to go away, it must not be handed out by the next emission
+        m_addedWindows.removeOne(window);
+        m_geometryChangedWindows.remove(window);
+        m_desktopChangedWindows.remove(window);
+        if (tracksWindowChanges()) {
+            m_removedWindows.append(window->internalId().toString());
+            scheduleWindowChanges();
+        }
+    });
+
     connect(ws, &Workspace::workspaceDestroyed, this, &WorkspaceWrapper::workspaceDestroyed);
     connect(ws, &Workspace::desktopPresenceChanged, this, &WorkspaceWrapper::desktopPresenceChanged);
     connect(ws, &Workspace::currentDesktopChanged, this, &WorkspaceWrapper::currentDesktopChanged);
@@ -351,6 +375,18 @@ QString WorkspaceWrapper::supportInformation() const
 
 void WorkspaceWrapper::setupClientConnections(Window *client)
 {
+    connect(client, &Window::frameGeometryChanged, this, [this, client]() {
+        if (tracksWindowChanges()) {
+            m_geometryChangedWindows.insert(client);
+            scheduleWindowChanges();
+        }
+    });
+    connect(client, &Window::desktopChanged, this, [this, client]() {
+        if (tracksWindowChanges()) {
+            m_desktopChangedWindows.insert(client);
+            scheduleWindowChanges();
+        }
+    });
     connect(client, &Window::clientMinimized, this, &WorkspaceWrapper::clientMinimized);
     connect(client, &Window::clientUnminimized, this, &WorkspaceWrapper::clientUnminimized);
     connect(client, qOverload<Window *, bool, bool>(&Window::clientMaximizedStateChanged),
@@ -380,6 +416,59 @@ void WorkspaceWrapper::hideOutline()
     outline()->hide();
 }
 
+void WorkspaceWrapper::batch(const QJSValue &callback)
+{
+    if (!callback.isCallable()) {
+        qCWarning(KWIN_SCRIPTING) << "workspace.batch() expects a function";
+        return;
+    }
+
+    ++m_batchDepth;
+    {
+        StackingUpdatesBlocker blocker(workspace());
+        const QJSValue result = QJSValue(callback).call();
+        if (result.isError()) {
+            qCWarning(KWIN_SCRIPTING) << "Error in workspace.batch() callback:" << result.toString();
+        }
+    }
+    --m_batchDepth;
+
+    if (!m_batchDepth) {
+        scheduleWindowChanges();
+    }
+}
+
+bool WorkspaceWrapper::tracksWindowChanges() const
+{
+    static const QMetaMethod signal = QMetaMethod::fromSignal(&WorkspaceWrapper::windowsChanged);
+    return isSignalConnected(signal);
+}
+
+void WorkspaceWrapper::scheduleWindowChanges()
+{
+    if (m_batchDepth || m_windowChangesTimer.isActive()) {
+        return;
+    }
+    if (m_addedWindows.isEmpty() && m_removedWindows.isEmpty()
+        && m_geometryChangedWindows.isEmpty() && m_desktopChangedWindows.isEmpty()) {
+        return;
+    }
+    m_windowChangesTimer.start(0);
+}
+
+void WorkspaceWrapper::emitWindowChanges()
+{
+    if (m_batchDepth) {
+        return;
+    }
+
+    const QList<Window *> added = std::exchange(m_addedWindows, {});
+    const QStringList removed = std::exchange(m_removedWindows, {});
+    const QList<Window *> geometryChanged = std::exchange(m_geometryChangedWindows, {}).values();
+    const QList<Window *> desktopChanged = std::exchange(m_desktopChangedWindows, {}).values();
+    Q_EMIT windowsChanged(added, removed, geometryChanged, desktopChanged);
+}
+
 X11Window *WorkspaceWrapper::getClient(qulonglong windowId)
 {
     return Workspace::self()->findClient(Predicate::WindowMatch, windowId);
@@ -11,11 +11,14 @@
 #ifndef KWIN_SCRIPTING_WORKSPACE_WRAPPER_H
 #define KWIN_SCRIPTING_WORKSPACE_WRAPPER_H
 
+#include <QJSValue>
 #include <QObject>
 #include <QQmlListProperty>
 #include <QRect>
+#include <QSet>
 #include <QSize>
 #include <QStringList>
+#include <QTimer>
 #include <kwinglobals.h>
 
 namespace KWin
@@ -167,6 +170,23 @@ Q_SIGNALS:
      */
     void currentVirtualDesktopChanged();
 
+    /**
+     * This signal delivers the window changes accumulated since it was last emitted, at most
+     * once per event loop iteration. It is an alternative to connecting to clientAdded,
+     * clientRemoved and the signals of every window, which lets a script handle a burst of
+     * changes, e.g. a tiling script relayouting, with a single invocation.
+     *
+     * A window is only listed in @p geometryChanged and @p desktopChanged if it still exists.
+     * As the removed windows may already be destroyed, @p removed contains their internalId.
+     *
+     * The changes are only tracked while something is connected to the signal.
+     *
+     * @since 5.26
+     */
+    void windowsChanged(const QList<KWin::Window *> &added, const QStringList &removed,
+                        const QList<KWin::Window *> &geometryChanged,
+                        const QList<KWin::Window *> &desktopChanged);
+
 public:
     //------------------------------------------------------------------
     // enums copy&pasted from kwinglobals.h because qtscript is evil
@@ -420,8 +440,29 @@ public Q_SLOTS:
      */
     void hideOutline();
 
+    /**
+     * Invokes @p callback with stacking order updates blocked, the stacking order is updated
+     * once when the callback returns. The windowsChanged signal is not emitted while the
+     * callback runs, changes made by it are delivered afterwards.
+     *
+     * @since 5.26
+     */
+    void batch(const QJSValue &callback);
+
 private Q_SLOTS:
     void setupClientConnections(Window *client);
+
+private:
+    bool tracksWindowChanges() const;
+    void scheduleWindowChanges();
+    void emitWindowChanges();
+
+    QTimer m_windowChangesTimer;
+    QList<Window *> m_addedWindows;
+    QStringList m_removedWindows;
+    QSet<Window *> m_geometryChangedWindows;
+    QSet<Window *> m_desktopChangedWindows;
+    int m_batchDepth = 0;
 };
 
 class QtScriptWorkspaceWrapper : public WorkspaceWrapper
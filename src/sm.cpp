@@ -20,10 +20,13 @@
 #include "x11window.h"
 #include <QDebug>
 #include <QSessionManager>
+#include <QTimer>
 
 #include "sessionadaptor.h"
 #include <QDBusConnection>
 
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -82,15 +85,49 @@ static NET::WindowType txtToWindowType(const char *txt)
 void SessionManager::storeSession(const QString &sessionName, SMSavePhase phase)
 {
     qCDebug(KWIN_CORE) << "storing session" << sessionName << "in phase" << phase;
-    KConfig *config = sessionConfig(sessionName, QString());
 
-    KConfigGroup cg(config, "Session");
-    int count = 0;
-    int active_client = -1;
+    // ksmserver waits for the reply before moving on, so phases never overlap on
+    // its side; finish whatever might still be running for a direct caller though
+    completeSessionSave();
+
+    m_pendingSave = std::make_unique<PendingSave>();
+    m_pendingSave->sessionName = sessionName;
+    m_pendingSave->phase = phase;
 
     const QList<X11Window *> x11Clients = workspace()->clientList();
-    for (auto it = x11Clients.begin(); it != x11Clients.end(); ++it) {
-        X11Window *c = (*it);
+    m_pendingSave->windows.reserve(x11Clients.count());
+    for (X11Window *c : x11Clients) {
+        m_pendingSave->windows.append(c);
+    }
+
+    if (calledFromDBus()) {
+        setDelayedReply(true);
+        m_pendingSave->reply = message();
+    }
+
+    storeSessionChunk();
+}
+
+void SessionManager::storeSessionChunk()
+{
+    if (!m_pendingSave) {
+        return;
+    }
+
+    // storing a window means a couple dozen config writes, do a bounded amount per
+    // event loop iteration so that logging out doesn't block rendering
+    static const int windowsPerChunk = 16;
+
+    PendingSave *save = m_pendingSave.get();
+    KConfig *config = sessionConfig(save->sessionName, QString());
+    KConfigGroup cg(config, "Session");
+
+    const int last = std::min<int>(save->index + windowsPerChunk, save->windows.count());
+    for (; save->index < last; ++save->index) {
+        X11Window *c = save->windows[save->index];
+        if (!c) {
+            continue; // closed while the session was being saved
+        }
         if (c->windowType() > NET::Splash) {
             // window types outside this are not tooltips/menus/OSDs
             // typically these will be unmanaged and not in this list anyway, but that is not enforced
@@ -105,30 +142,52 @@ void SessionManager::storeSession(const QString &sessionName, SMSavePhase phase)
                 continue;
             }
         }
-        count++;
+        save->count++;
         if (c->isActive()) {
-            active_client = count;
+            save->activeClient = save->count;
         }
-        if (phase == SMSavePhase2 || phase == SMSavePhase2Full) {
-            storeClient(cg, count, c);
+        if (save->phase == SMSavePhase2 || save->phase == SMSavePhase2Full) {
+            storeClient(cg, save->count, c);
         }
     }
-    if (phase == SMSavePhase0) {
+
+    if (save->index < save->windows.count()) {
+        QTimer::singleShot(0, this, &SessionManager::storeSessionChunk);
+        return;
+    }
+
+    if (save->phase == SMSavePhase0) {
         // it would be much simpler to save these values to the config file,
         // but both Qt and KDE treat phase1 and phase2 separately,
         // which results in different sessionkey and different config file :(
-        m_sessionActiveClient = active_client;
+        m_sessionActiveClient = save->activeClient;
         m_sessionDesktop = VirtualDesktopManager::self()->current();
-    } else if (phase == SMSavePhase2) {
-        cg.writeEntry("count", count);
+    } else if (save->phase == SMSavePhase2) {
+        cg.writeEntry("count", save->count);
         cg.writeEntry("active", m_sessionActiveClient);
         cg.writeEntry("desktop", m_sessionDesktop);
     } else { // SMSavePhase2Full
-        cg.writeEntry("count", count);
+        cg.writeEntry("count", save->count);
         cg.writeEntry("active", m_sessionActiveClient);
         cg.writeEntry("desktop", VirtualDesktopManager::self()->current());
     }
     config->sync(); // it previously did some "revert to defaults" stuff for phase1 I think
+
+    if (save->reply.type() == QDBusMessage::MethodCallMessage) {
+        QDBusConnection::sessionBus().send(save->reply.createReply());
+    }
+    m_pendingSave.reset();
+}
+
+/**
+ * Stores all windows of a session save that is still in progress without returning
+ * to the event loop.
+ */
+void SessionManager::completeSessionSave()
+{
+    while (m_pendingSave) {
+        storeSessionChunk();
+    }
 }
 
 void SessionManager::storeClient(KConfigGroup &cg, int num, X11Window *c)
@@ -212,6 +271,8 @@ void SessionManager::storeSubSession(const QString &name, QSet<QByteArray> sessi
  */
 void SessionManager::loadSession(const QString &sessionName)
 {
+    // the session config is shared, don't pull it away from under a running save
+    completeSessionSave();
     session.clear();
     KConfigGroup cg(sessionConfig(sessionName, QString()), "Session");
     Q_EMIT loadSessionRequested(sessionName);
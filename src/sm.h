@@ -11,7 +11,10 @@
 #ifndef KWIN_SM_H
 #define KWIN_SM_H
 
+#include <QDBusContext>
+#include <QDBusMessage>
 #include <QDataStream>
+#include <QPointer>
 #include <QRect>
 #include <QStringList>
 
@@ -20,13 +23,15 @@
 #include <kwinglobals.h>
 #include <netwm_def.h>
 
+#include <memory>
+
 namespace KWin
 {
 
 class X11Window;
 struct SessionInfo;
 
-class SessionManager : public QObject
+class SessionManager : public QObject, protected QDBusContext
 {
     Q_OBJECT
 public:
@@ -64,6 +69,8 @@ private:
     void setState(SessionState state);
 
     void storeSession(const QString &sessionName, SMSavePhase phase);
+    void storeSessionChunk();
+    void completeSessionSave();
     void storeClient(KConfigGroup &cg, int num, X11Window *c);
     void loadSessionInfo(const QString &sessionName);
     void addSessionInfo(KConfigGroup &cg);
@@ -74,6 +81,23 @@ private:
     int m_sessionDesktop;
 
     QList<SessionInfo *> session;
+
+    /**
+     * State of a session save that is spread over several event loop iterations so
+     * that a large number of windows doesn't stall compositing. The D-Bus reply to
+     * ksmserver is only sent once all windows have been stored.
+     */
+    struct PendingSave
+    {
+        QString sessionName;
+        SMSavePhase phase;
+        QList<QPointer<X11Window>> windows;
+        int index = 0;
+        int count = 0;
+        int activeClient = -1;
+        QDBusMessage reply;
+    };
+    std::unique_ptr<PendingSave> m_pendingSave;
 };
 
 struct SessionInfo
@@ -0,0 +1,189 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "startuptracer.h"
+#include "ftrace.h"
+#include "utils/common.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+
+namespace KWin
+{
+
+static bool isFTraceEnabled()
+{
+    // the ftrace logger is only created together with the compositor
+    return FTraceLogger::self() && FTraceLogger::self()->isEnabled();
+}
+
+StartupTracer *StartupTracer::self()
+{
+    static StartupTracer tracer;
+    return &tracer;
+}
+
+StartupTracer::StartupTracer()
+{
+    const QString value = qEnvironmentVariable("KWIN_STARTUP_TRACE");
+    if (value.isEmpty() || value == QLatin1String("0")) {
+        return;
+    }
+    if (value == QLatin1String("1")) {
+        m_fileName = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation) + QLatin1String("/kwin-startup-trace.json");
+    } else {
+        m_fileName = value;
+    }
+    m_recording = true;
+    m_timer.start();
+}
+
+void StartupTracer::record(const QByteArray &name, char phase)
+{
+    m_events.append(Event{name, phase, m_timer.nsecsElapsed() / 1000});
+}
+
+void StartupTracer::begin(const QByteArray &name)
+{
+    if (!m_recording) {
+        return;
+    }
+    record(name, 'B');
+    m_pendingPhases++;
+    if (isFTraceEnabled()) {
+        FTraceLogger::self()->trace("Startup: ", name, " begin");
+    }
+}
+
+void StartupTracer::end(const QByteArray &name)
+{
+    if (!m_recording) {
+        return;
+    }
+    record(name, 'E');
+    m_pendingPhases--;
+    if (isFTraceEnabled()) {
+        FTraceLogger::self()->trace("Startup: ", name, " end");
+    }
+    maybeFinish();
+}
+
+void StartupTracer::instant(const QByteArray &name)
+{
+    if (!m_recording) {
+        return;
+    }
+    record(name, 'i');
+    if (isFTraceEnabled()) {
+        FTraceLogger::self()->trace("Startup: ", name);
+    }
+}
+
+void StartupTracer::markSessionStarted()
+{
+    if (!m_recording || m_sessionStarted) {
+        return;
+    }
+    instant(QByteArrayLiteral("Session started"));
+    m_sessionStarted = true;
+    maybeFinish();
+}
+
+void StartupTracer::markFirstFrame()
+{
+    if (!m_recording || m_firstFrame) {
+        return;
+    }
+    instant(QByteArrayLiteral("First frame"));
+    m_firstFrame = true;
+    maybeFinish();
+}
+
+void StartupTracer::maybeFinish()
+{
+    // phases that are still running, e.g. effects that are loaded asynchronously, belong to the trace
+    if (!m_sessionStarted || !m_firstFrame || m_pendingPhases > 0) {
+        return;
+    }
+    m_recording = false;
+
+    QHash<QByteArray, qint64> beginTimestamps;
+    for (const Event &event : qAsConst(m_events)) {
+        switch (event.phase) {
+        case 'B':
+            beginTimestamps.insert(event.name, event.timestamp);
+            break;
+        case 'E':
+            qCDebug(KWIN_CORE, "Startup phase %s took %.1f ms", event.name.constData(),
+                    (event.timestamp - beginTimestamps.take(event.name)) / 1000.0);
+            break;
+        default:
+            qCDebug(KWIN_CORE, "Startup event %s at %.1f ms", event.name.constData(), event.timestamp / 1000.0);
+            break;
+        }
+    }
+
+    writeTrace();
+    m_events.clear();
+    m_events.squeeze();
+}
+
+void StartupTracer::writeTrace() const
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonArray traceEvents;
+    for (const Event &event : qAsConst(m_events)) {
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), QString::fromUtf8(event.name));
+        object.insert(QStringLiteral("cat"), QStringLiteral("startup"));
+        object.insert(QStringLiteral("ph"), QString(QLatin1Char(event.phase)));
+        object.insert(QStringLiteral("ts"), event.timestamp);
+        object.insert(QStringLiteral("pid"), pid);
+        object.insert(QStringLiteral("tid"), pid);
+        if (event.phase == 'i') {
+            object.insert(QStringLiteral("s"), QStringLiteral("p"));
+        }
+        traceEvents.append(object);
+    }
+
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(KWIN_CORE) << "Failed to write the startup trace to" << m_fileName << file.errorString();
+        return;
+    }
+    file.write(QJsonDocument(QJsonObject{{QStringLiteral("traceEvents"), traceEvents}}).toJson(QJsonDocument::Compact));
+    qCInfo(KWIN_CORE) << "Wrote the startup trace to" << m_fileName;
+}
+
+StartupPhase::StartupPhase(const QByteArray &name)
+    : m_name(name)
+{
+    StartupTracer *tracer = StartupTracer::self();
+    if (!tracer->isRecording()) {
+        return;
+    }
+    tracer->record(m_name, 'B');
+    if (isFTraceEnabled()) {
+        m_duration = std::make_unique<FTraceDuration>("Startup: ", m_name);
+    }
+}
+
+StartupPhase::~StartupPhase()
+{
+    StartupTracer *tracer = StartupTracer::self();
+    if (tracer->isRecording()) {
+        tracer->record(m_name, 'E');
+    }
+}
+
+} // namespace KWin
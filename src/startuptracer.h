@@ -0,0 +1,101 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+namespace KWin
+{
+
+class FTraceDuration;
+
+/**
+ * The StartupTracer records the phases of the compositor startup with timestamps, from main()
+ * until the session has started and the first frame has been painted. Once both have
+ * happened and all phases started with begin() have ended, the phases are logged and written
+ * to a Chrome trace JSON file, which can be opened with chrome://tracing or ui.perfetto.dev.
+ *
+ * The tracer is enabled by setting KWIN_STARTUP_TRACE, either to the path of the trace file
+ * or to 1 to write $XDG_RUNTIME_DIR/kwin-startup-trace.json. If ftrace is enabled, the phases
+ * are also written as ftrace markers.
+ *
+ * The tracer must only be used on the main thread.
+ *
+ * @since 5.26
+ */
+class KWIN_EXPORT StartupTracer
+{
+public:
+    static StartupTracer *self();
+
+    /**
+     * Returns @c true if startup phases are being recorded.
+     */
+    bool isRecording() const
+    {
+        return m_recording;
+    }
+
+    /**
+     * Begins the phase @a name. Phases that run asynchronously, such as effect loading, may
+     * end after the first frame; the trace is only written once every begun phase has ended.
+     */
+    void begin(const QByteArray &name);
+    void end(const QByteArray &name);
+    void instant(const QByteArray &name);
+
+    void markSessionStarted();
+    void markFirstFrame();
+
+private:
+    StartupTracer();
+
+    struct Event
+    {
+        QByteArray name;
+        char phase;
+        qint64 timestamp;
+    };
+
+    void record(const QByteArray &name, char phase);
+    void maybeFinish();
+    void writeTrace() const;
+
+    QElapsedTimer m_timer;
+    QVector<Event> m_events;
+    QString m_fileName;
+    int m_pendingPhases = 0;
+    bool m_recording = false;
+    bool m_sessionStarted = false;
+    bool m_firstFrame = false;
+    friend class StartupPhase;
+};
+
+/**
+ * Records a startup phase that lasts until the end of the enclosing scope. It's also
+ * forwarded to ftrace as a duration if ftrace is enabled.
+ */
+class KWIN_EXPORT StartupPhase
+{
+public:
+    explicit StartupPhase(const QByteArray &name);
+    ~StartupPhase();
+
+private:
+    QByteArray m_name;
+    std::unique_ptr<FTraceDuration> m_duration;
+};
+
+} // namespace KWin
@@ -90,6 +90,28 @@ void SurfaceItem::unreferencePreviousPixmap()
     }
 }
 
+static qint64 estimatePixmapMemoryUsage(const SurfacePixmap *pixmap)
+{
+    if (!pixmap || !pixmap->isValid()) {
+        return 0;
+    }
+    const QSize size = pixmap->size();
+    return qint64(size.width()) * size.height() * 4;
+}
+
+qint64 SurfaceItem::pixmapMemoryUsage() const
+{
+    return estimatePixmapMemoryUsage(m_pixmap.data()) + estimatePixmapMemoryUsage(m_previousPixmap.data());
+}
+
+void SurfaceItem::releasePixmaps()
+{
+    m_pixmap.reset();
+    m_previousPixmap.reset();
+    m_referencePixmapCounter = 0;
+    discardQuads();
+}
+
 void SurfaceItem::updatePixmap()
 {
     if (m_pixmap.isNull()) {
@@ -41,6 +41,16 @@ public:
     void referencePreviousPixmap();
     void unreferencePreviousPixmap();
 
+    /**
+     * Returns an estimate of the number of bytes held by the current and the previous pixmap.
+     */
+    qint64 pixmapMemoryUsage() const;
+    /**
+     * Destroys both the current and the previous pixmap. This is meant for surfaces of closed
+     * windows that are not going to be painted anymore.
+     */
+    void releasePixmaps();
+
 protected:
     explicit SurfaceItem(Window *window, Item *parent = nullptr);
 
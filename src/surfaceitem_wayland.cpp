@@ -111,15 +111,20 @@ void SurfaceItemWayland::handleChildSubSurfacesChanged()
     const QList<KWaylandServer::SubSurfaceInterface *> below = m_surface->below();
     const QList<KWaylandServer::SubSurfaceInterface *> above = m_surface->above();
 
+    // Restack all sub-surfaces in one go, so only the parts whose stacking order has
+    // actually changed get repainted
+    QVector<std::pair<Item *, int>> zValues;
+    zValues.reserve(below.count() + above.count());
+
     for (int i = 0; i < below.count(); ++i) {
-        SurfaceItemWayland *subsurfaceItem = getOrCreateSubSurfaceItem(below[i]);
-        subsurfaceItem->setZ(i - below.count());
+        zValues.append({getOrCreateSubSurfaceItem(below[i]), i - below.count()});
     }
 
     for (int i = 0; i < above.count(); ++i) {
-        SurfaceItemWayland *subsurfaceItem = getOrCreateSubSurfaceItem(above[i]);
-        subsurfaceItem->setZ(i);
+        zValues.append({getOrCreateSubSurfaceItem(above[i]), i});
     }
+
+    restackChildItems(zValues);
 }
 
 void SurfaceItemWayland::handleSubSurfacePositionChanged()
@@ -9,6 +9,8 @@
 #include "scene.h"
 #include "x11syncmanager.h"
 
+#include <limits>
+
 namespace KWin
 {
 
@@ -72,6 +74,71 @@ bool SurfaceItemX11::fetchDamage()
     return true;
 }
 
+static qint64 rectArea(const QRect &rect)
+{
+    return qint64(rect.width()) * rect.height();
+}
+
+/**
+ * Converts the damage region reported by the X server into a QRegion. The region is kept
+ * tight, but the number of rectangles is bounded as clipping against many rectangles costs
+ * more than painting a few extra pixels.
+ */
+static QRegion simplifyDamage(const xcb_rectangle_t *rects, int rectCount, const QRect &extents)
+{
+    static const int maxRectCount = 16;
+
+    if (rectCount <= 1) {
+        return extents;
+    }
+
+    QVector<QRect> qtRects;
+    qtRects.reserve(rectCount);
+    qint64 damagedArea = 0;
+    for (int i = 0; i < rectCount; ++i) {
+        const QRect rect(rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+        damagedArea += rectArea(rect);
+        qtRects << rect;
+    }
+
+    // If the damage covers most of its bounding rect, repaint the bounding rect.
+    if (damagedArea * 4 >= rectArea(extents) * 3) {
+        return extents;
+    }
+
+    QRegion region;
+    if (rectCount <= maxRectCount) {
+        region.setRects(qtRects.constData(), rectCount);
+        return region;
+    }
+
+    // Merge every rectangle into the bucket whose bounding rect grows the least, so that
+    // distant damaged areas, e.g. a terminal and a clock, stay separate.
+    QVector<QRect> buckets;
+    buckets.reserve(maxRectCount);
+    for (const QRect &rect : qAsConst(qtRects)) {
+        if (buckets.count() < maxRectCount) {
+            buckets.append(rect);
+            continue;
+        }
+        int bestBucket = 0;
+        qint64 bestGrowth = std::numeric_limits<qint64>::max();
+        for (int i = 0; i < buckets.count(); ++i) {
+            const qint64 growth = rectArea(buckets[i] | rect) - rectArea(buckets[i]);
+            if (growth < bestGrowth) {
+                bestGrowth = growth;
+                bestBucket = i;
+            }
+        }
+        buckets[bestBucket] |= rect;
+    }
+
+    for (const QRect &bucket : qAsConst(buckets)) {
+        region += bucket;
+    }
+    return region;
+}
+
 void SurfaceItemX11::waitForDamage()
 {
     if (!m_havePendingDamageRegion) {
@@ -86,22 +153,9 @@ void SurfaceItemX11::waitForDamage()
         return;
     }
 
-    const int rectCount = xcb_xfixes_fetch_region_rectangles_length(reply);
-    QRegion region;
-
-    if (rectCount > 1 && rectCount < 16) {
-        xcb_rectangle_t *rects = xcb_xfixes_fetch_region_rectangles(reply);
-
-        QVector<QRect> qtRects;
-        qtRects.reserve(rectCount);
-
-        for (int i = 0; i < rectCount; ++i) {
-            qtRects << QRect(rects[i].x, rects[i].y, rects[i].width, rects[i].height);
-        }
-        region.setRects(qtRects.constData(), rectCount);
-    } else {
-        region = QRect(reply->extents.x, reply->extents.y, reply->extents.width, reply->extents.height);
-    }
+    const QRegion region = simplifyDamage(xcb_xfixes_fetch_region_rectangles(reply),
+                                          xcb_xfixes_fetch_region_rectangles_length(reply),
+                                          QRect(reply->extents.x, reply->extents.y, reply->extents.width, reply->extents.height));
     free(reply);
 
     addDamage(region);
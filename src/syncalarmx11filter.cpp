@@ -24,11 +24,10 @@ bool SyncAlarmX11Filter::event(xcb_generic_event_t *event)
 {
     auto alarmEvent = reinterpret_cast<xcb_sync_alarm_notify_event_t *>(event);
     auto client = workspace()->findClient([alarmEvent](const X11Window *client) {
-        const auto syncRequest = client->syncRequest();
-        return alarmEvent->alarm == syncRequest.alarm && alarmEvent->counter_value.hi == syncRequest.value.hi && alarmEvent->counter_value.lo == syncRequest.value.lo;
+        return alarmEvent->alarm == client->syncRequest().alarm;
     });
     if (client) {
-        client->handleSync();
+        client->handleSyncAlarm(alarmEvent->counter_value);
     }
     return false;
 }
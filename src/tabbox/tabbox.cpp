@@ -807,6 +807,9 @@ void TabBox::reconfigure()
     };
     touchConfig(QStringLiteral("TouchBorderActivate"), m_touchActivate, TabBoxWindowsMode);
     touchConfig(QStringLiteral("TouchBorderAlternativeActivate"), m_touchAlternativeActivate, TabBoxWindowsAlternativeMode);
+
+    // Load the window switcher in the background, so the first Alt+Tab doesn't wait for the QML
+    QTimer::singleShot(0, m_tabBox, &TabBoxHandler::prepare);
 }
 
 void TabBox::loadConfig(const KConfigGroup &config, TabBoxConfig &tabBoxConfig)
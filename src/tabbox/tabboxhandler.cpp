@@ -56,6 +56,7 @@ public:
     void endHighlightWindows(bool abort = false);
 
     void show();
+    QObject *loadSwitcherItem();
     QQuickWindow *window() const;
     SwitcherItem *switcherItem() const;
 
@@ -291,9 +292,12 @@ QObject *TabBoxHandlerPrivate::createSwitcherItem(bool desktopMode)
 }
 #endif
 
-void TabBoxHandlerPrivate::show()
-{
 #ifndef KWIN_UNIT_TEST
+/**
+ * Returns the switcher item for the current config, loading it if it hasn't been used before.
+ */
+QObject *TabBoxHandlerPrivate::loadSwitcherItem()
+{
     if (m_qmlContext.isNull()) {
         qmlRegisterType<SwitcherItem>("org.kde.kwin", 2, 0, "Switcher");
         qmlRegisterType<SwitcherItem>("org.kde.kwin", 3, 0, "TabBoxSwitcher");
@@ -310,13 +314,21 @@ void TabBoxHandlerPrivate::show()
         }
         return nullptr;
     };
-    m_mainItem = nullptr;
-    m_mainItem = desktopMode ? findMainItem(m_desktopTabBoxes) : findMainItem(m_clientTabBoxes);
+    QObject *item = desktopMode ? findMainItem(m_desktopTabBoxes) : findMainItem(m_clientTabBoxes);
+    if (!item) {
+        item = createSwitcherItem(desktopMode);
+    }
+    return item;
+}
+#endif
+
+void TabBoxHandlerPrivate::show()
+{
+#ifndef KWIN_UNIT_TEST
+    const bool desktopMode = (config.tabBoxMode() == TabBoxConfig::DesktopTabBox);
+    m_mainItem = loadSwitcherItem();
     if (!m_mainItem) {
-        m_mainItem = createSwitcherItem(desktopMode);
-        if (!m_mainItem) {
-            return;
-        }
+        return;
     }
     if (SwitcherItem *item = switcherItem()) {
         // In case the model isn't yet set (see below), index will be reset and therefore we
@@ -393,6 +405,16 @@ void TabBoxHandler::show()
     }
 }
 
+void TabBoxHandler::prepare()
+{
+#ifndef KWIN_UNIT_TEST
+    if (d->isShown || !d->config.isShowTabBox() || !Scripting::self()) {
+        return;
+    }
+    d->loadSwitcherItem();
+#endif
+}
+
 void TabBoxHandler::initHighlightWindows()
 {
     if (isKWinCompositing()) {
@@ -226,6 +226,12 @@ public:
      * @see TabBoxConfig::isHighlightWindows
      */
     void show();
+    /**
+     * Loads the TabBoxView for the current configuration without showing it, so
+     * that the first show() doesn't have to wait for the QML to be loaded.
+     * @see show
+     */
+    void prepare();
     /**
      * Hides the TabBoxView if shown.
      * Deactivates highlight windows effect if active.
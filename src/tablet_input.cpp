@@ -81,7 +81,7 @@ void TabletInputRedirection::tabletToolEvent(KWin::InputRedirection::TabletEvent
 
     ev.setTimestamp(time);
     input()->processSpies(std::bind(&InputEventSpy::tabletToolEvent, std::placeholders::_1, &ev));
-    input()->processFilters(
+    input()->processFilters(InputRedirection::TabletEvents,
         std::bind(&InputEventFilter::tabletToolEvent, std::placeholders::_1, &ev));
 
     m_tipDown = tipDown;
@@ -93,7 +93,7 @@ void KWin::TabletInputRedirection::tabletToolButtonEvent(uint button, bool isPre
 {
     input()->processSpies(std::bind(&InputEventSpy::tabletToolButtonEvent,
                                     std::placeholders::_1, button, isPressed, tabletToolId));
-    input()->processFilters(std::bind(&InputEventFilter::tabletToolButtonEvent,
+    input()->processFilters(InputRedirection::TabletEvents, std::bind(&InputEventFilter::tabletToolButtonEvent,
                                       std::placeholders::_1, button, isPressed, tabletToolId));
     input()->setLastInputHandler(this);
 }
@@ -103,7 +103,7 @@ void KWin::TabletInputRedirection::tabletPadButtonEvent(uint button, bool isPres
 {
     input()->processSpies(std::bind(&InputEventSpy::tabletPadButtonEvent,
                                     std::placeholders::_1, button, isPressed, tabletPadId));
-    input()->processFilters(std::bind(&InputEventFilter::tabletPadButtonEvent,
+    input()->processFilters(InputRedirection::TabletEvents, std::bind(&InputEventFilter::tabletPadButtonEvent,
                                       std::placeholders::_1, button, isPressed, tabletPadId));
     input()->setLastInputHandler(this);
 }
@@ -113,7 +113,7 @@ void KWin::TabletInputRedirection::tabletPadStripEvent(int number, int position,
 {
     input()->processSpies(std::bind(&InputEventSpy::tabletPadStripEvent,
                                     std::placeholders::_1, number, position, isFinger, tabletPadId));
-    input()->processFilters(std::bind(&InputEventFilter::tabletPadStripEvent,
+    input()->processFilters(InputRedirection::TabletEvents, std::bind(&InputEventFilter::tabletPadStripEvent,
                                       std::placeholders::_1, number, position, isFinger, tabletPadId));
     input()->setLastInputHandler(this);
 }
@@ -123,7 +123,7 @@ void KWin::TabletInputRedirection::tabletPadRingEvent(int number, int position,
 {
     input()->processSpies(std::bind(&InputEventSpy::tabletPadRingEvent,
                                     std::placeholders::_1, number, position, isFinger, tabletPadId));
-    input()->processFilters(std::bind(&InputEventFilter::tabletPadRingEvent,
+    input()->processFilters(InputRedirection::TabletEvents, std::bind(&InputEventFilter::tabletPadRingEvent,
                                       std::placeholders::_1, number, position, isFinger, tabletPadId));
     input()->setLastInputHandler(this);
 }
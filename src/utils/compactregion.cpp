@@ -0,0 +1,273 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "compactregion.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+static int floorDiv(int value, int divisor)
+{
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+CompactRegion::CompactRegion(const QRect &rect)
+{
+    add(rect);
+}
+
+CompactRegion::CompactRegion(const QRegion &region)
+{
+    add(region);
+}
+
+bool CompactRegion::isEmpty() const
+{
+    return m_boundingRect.isEmpty();
+}
+
+bool CompactRegion::isTiled() const
+{
+    return !m_tileBounds.isEmpty();
+}
+
+QRect CompactRegion::boundingRect() const
+{
+    return m_boundingRect;
+}
+
+void CompactRegion::clear()
+{
+    m_rectCount = 0;
+    m_tileBounds = QRect();
+    m_wordsPerRow = 0;
+    m_tiles.clear();
+    m_boundingRect = QRect();
+}
+
+QRect CompactRegion::tileRectFor(const QRect &rect)
+{
+    const int left = floorDiv(rect.x(), tileSize);
+    const int top = floorDiv(rect.y(), tileSize);
+    const int right = floorDiv(rect.x() + rect.width() - 1, tileSize);
+    const int bottom = floorDiv(rect.y() + rect.height() - 1, tileSize);
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+bool CompactRegion::testTile(int column, int row) const
+{
+    const int x = column - m_tileBounds.x();
+    const int y = row - m_tileBounds.y();
+    return m_tiles[y * m_wordsPerRow + x / 64] & (quint64(1) << (x % 64));
+}
+
+void CompactRegion::growTiles(const QRect &tileRect)
+{
+    if (m_tileBounds.contains(tileRect)) {
+        return;
+    }
+
+    const QRect oldBounds = m_tileBounds;
+    const int oldWordsPerRow = m_wordsPerRow;
+    const QVector<quint64> oldTiles = m_tiles;
+
+    m_tileBounds = oldBounds.isEmpty() ? tileRect : oldBounds.united(tileRect);
+    m_wordsPerRow = (m_tileBounds.width() + 63) / 64;
+    m_tiles = QVector<quint64>(m_wordsPerRow * m_tileBounds.height(), 0);
+
+    if (oldBounds.isEmpty()) {
+        return;
+    }
+    for (int y = 0; y < oldBounds.height(); ++y) {
+        for (int x = 0; x < oldBounds.width(); ++x) {
+            if (oldTiles[y * oldWordsPerRow + x / 64] & (quint64(1) << (x % 64))) {
+                const int column = oldBounds.x() + x - m_tileBounds.x();
+                const int row = oldBounds.y() + y - m_tileBounds.y();
+                m_tiles[row * m_wordsPerRow + column / 64] |= quint64(1) << (column % 64);
+            }
+        }
+    }
+}
+
+void CompactRegion::setTiles(const QRect &tileRect)
+{
+    growTiles(tileRect);
+
+    const int first = tileRect.x() - m_tileBounds.x();
+    const int last = first + tileRect.width() - 1;
+    for (int row = tileRect.y() - m_tileBounds.y(); row <= tileRect.bottom() - m_tileBounds.y(); ++row) {
+        quint64 *words = m_tiles.data() + row * m_wordsPerRow;
+        for (int word = first / 64; word <= last / 64; ++word) {
+            const int from = std::max(first, word * 64) - word * 64;
+            const int to = std::min(last, word * 64 + 63) - word * 64;
+            const quint64 upper = to == 63 ? ~quint64(0) : (quint64(1) << (to + 1)) - 1;
+            const quint64 lower = (quint64(1) << from) - 1;
+            words[word] |= upper & ~lower;
+        }
+    }
+}
+
+void CompactRegion::convertToTiles()
+{
+    for (int i = 0; i < m_rectCount; ++i) {
+        setTiles(tileRectFor(m_rects[i]));
+    }
+    m_rectCount = 0;
+}
+
+void CompactRegion::add(const QRect &rect)
+{
+    if (rect.isEmpty()) {
+        return;
+    }
+    m_boundingRect = m_boundingRect.united(rect);
+
+    if (isTiled()) {
+        setTiles(tileRectFor(rect));
+        return;
+    }
+
+    // Skip the rect if it's already covered, and drop the rects that it covers
+    int count = 0;
+    for (int i = 0; i < m_rectCount; ++i) {
+        if (m_rects[i].contains(rect)) {
+            return;
+        }
+        if (!rect.contains(m_rects[i])) {
+            m_rects[count++] = m_rects[i];
+        }
+    }
+    m_rectCount = count;
+
+    if (m_rectCount < rectCapacity) {
+        m_rects[m_rectCount++] = rect;
+    } else {
+        convertToTiles();
+        setTiles(tileRectFor(rect));
+    }
+}
+
+void CompactRegion::add(const QRegion &region)
+{
+    for (const QRect &rect : region) {
+        add(rect);
+    }
+}
+
+void CompactRegion::add(const CompactRegion &other)
+{
+    if (other.isEmpty()) {
+        return;
+    }
+    if (!other.isTiled()) {
+        for (int i = 0; i < other.m_rectCount; ++i) {
+            add(other.m_rects[i]);
+        }
+        return;
+    }
+
+    if (!isTiled()) {
+        convertToTiles();
+    }
+    m_boundingRect = m_boundingRect.united(other.m_boundingRect);
+    growTiles(other.m_tileBounds);
+
+    // Both grids are aligned to the tile size, so whole words can be merged if the columns line up
+    const int columnOffset = other.m_tileBounds.x() - m_tileBounds.x();
+    for (int y = 0; y < other.m_tileBounds.height(); ++y) {
+        const int row = other.m_tileBounds.y() + y - m_tileBounds.y();
+        if (columnOffset % 64 == 0) {
+            for (int word = 0; word < other.m_wordsPerRow; ++word) {
+                m_tiles[row * m_wordsPerRow + columnOffset / 64 + word] |= other.m_tiles[y * other.m_wordsPerRow + word];
+            }
+        } else {
+            for (int x = 0; x < other.m_tileBounds.width(); ++x) {
+                if (other.m_tiles[y * other.m_wordsPerRow + x / 64] & (quint64(1) << (x % 64))) {
+                    const int column = columnOffset + x;
+                    m_tiles[row * m_wordsPerRow + column / 64] |= quint64(1) << (column % 64);
+                }
+            }
+        }
+    }
+}
+
+CompactRegion &CompactRegion::operator+=(const QRect &rect)
+{
+    add(rect);
+    return *this;
+}
+
+CompactRegion &CompactRegion::operator+=(const QRegion &region)
+{
+    add(region);
+    return *this;
+}
+
+CompactRegion &CompactRegion::operator+=(const CompactRegion &other)
+{
+    add(other);
+    return *this;
+}
+
+QRegion CompactRegion::toRegion() const
+{
+    if (!isTiled()) {
+        if (m_rectCount == 1) {
+            return m_rects[0];
+        }
+        QRegion region;
+        for (int i = 0; i < m_rectCount; ++i) {
+            region += m_rects[i];
+        }
+        return region;
+    }
+
+    // Every tile row is a band of spans; identical neighbouring rows are merged into one band,
+    // which produces the y-x banded rects that QRegion::setRects() expects.
+    QVector<QRect> rects;
+    QVector<QPair<int, int>> previousSpans;
+    QVector<QPair<int, int>> spans;
+    int bandStart = 0;
+
+    const auto flushBand = [&](int bandEnd) {
+        for (const auto &span : qAsConst(previousSpans)) {
+            rects.append(QRect((m_tileBounds.x() + span.first) * tileSize,
+                               (m_tileBounds.y() + bandStart) * tileSize,
+                               (span.second - span.first) * tileSize,
+                               (bandEnd - bandStart) * tileSize));
+        }
+    };
+
+    for (int y = 0; y < m_tileBounds.height(); ++y) {
+        spans.clear();
+        for (int x = 0; x < m_tileBounds.width();) {
+            if (!testTile(m_tileBounds.x() + x, m_tileBounds.y() + y)) {
+                ++x;
+                continue;
+            }
+            const int start = x;
+            while (x < m_tileBounds.width() && testTile(m_tileBounds.x() + x, m_tileBounds.y() + y)) {
+                ++x;
+            }
+            spans.append(qMakePair(start, x));
+        }
+        if (spans != previousSpans) {
+            flushBand(y);
+            previousSpans = spans;
+            bandStart = y;
+        }
+    }
+    flushBand(m_tileBounds.height());
+
+    QRegion region;
+    region.setRects(rects.constData(), rects.count());
+    return region;
+}
+
+} // namespace KWin
@@ -0,0 +1,74 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QRegion>
+#include <QVector>
+
+#include <array>
+
+namespace KWin
+{
+
+/**
+ * The CompactRegion class accumulates damage without the cost of QRegion unions.
+ *
+ * Up to rectCapacity rectangles are kept as they are, a rectangle covered by another one
+ * is dropped. Once the capacity is exceeded, the region switches to a bitmask of
+ * tileSize x tileSize tiles, adding a rectangle then only sets bits. The tile bitmask
+ * rounds the region up to the tile grid, so it can cover more than what has been added,
+ * which is fine for tracking damage. Use toRegion() to get the final QRegion.
+ */
+class KWIN_EXPORT CompactRegion
+{
+public:
+    static constexpr int rectCapacity = 16;
+    static constexpr int tileSize = 64;
+
+    CompactRegion() = default;
+    CompactRegion(const QRect &rect);
+    CompactRegion(const QRegion &region);
+
+    bool isEmpty() const;
+    /**
+     * Returns @c true if the region has been rounded up to the tile grid.
+     */
+    bool isTiled() const;
+    QRect boundingRect() const;
+
+    void clear();
+    void add(const QRect &rect);
+    void add(const QRegion &region);
+    void add(const CompactRegion &other);
+
+    CompactRegion &operator+=(const QRect &rect);
+    CompactRegion &operator+=(const QRegion &region);
+    CompactRegion &operator+=(const CompactRegion &other);
+
+    QRegion toRegion() const;
+
+private:
+    void convertToTiles();
+    void growTiles(const QRect &tileRect);
+    void setTiles(const QRect &tileRect);
+    bool testTile(int column, int row) const;
+    static QRect tileRectFor(const QRect &rect);
+
+    std::array<QRect, rectCapacity> m_rects;
+    int m_rectCount = 0;
+
+    // The covered tiles in tile coordinates, one bit per tile, row by row
+    QRect m_tileBounds;
+    int m_wordsPerRow = 0;
+    QVector<quint64> m_tiles;
+    QRect m_boundingRect;
+};
+
+} // namespace KWin
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "compactregion.h"
 #include "kwin_export.h"
 
 #include <QList>
@@ -16,6 +17,9 @@ namespace KWin
 
 /**
  * The DamageJournal class is a helper that tracks last N damage regions.
+ *
+ * The regions are stored as CompactRegion, accumulating them unites rect arrays
+ * or tile bitmasks instead of doing a QRegion union per journal entry.
  */
 class KWIN_EXPORT DamageJournal
 {
@@ -45,7 +49,7 @@ public:
         while (m_log.size() >= m_capacity) {
             m_log.takeLast();
         }
-        m_log.prepend(region);
+        m_log.prepend(CompactRegion(region));
     }
 
     /**
@@ -65,24 +69,23 @@ public:
      */
     QRegion accumulate(int bufferAge, const QRegion &fallback = QRegion()) const
     {
-        QRegion region;
         if (bufferAge > 0 && bufferAge <= m_log.size()) {
+            CompactRegion region;
             for (int i = 0; i < bufferAge - 1; ++i) {
-                region |= m_log[i];
+                region += m_log[i];
             }
-        } else {
-            region = fallback;
+            return region.toRegion();
         }
-        return region;
+        return fallback;
     }
 
     QRegion lastDamage() const
     {
-        return m_log.first();
+        return m_log.first().toRegion();
     }
 
 private:
-    QList<QRegion> m_log;
+    QList<CompactRegion> m_log;
     int m_capacity = 10;
 };
 
@@ -8,18 +8,118 @@
 
 #include "config-kwin.h"
 
+#include <KConfig>
+#include <KConfigGroup>
+
+#include <algorithm>
+#include <array>
+
+#include <errno.h>
+
 #include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
 
 namespace KWin
 {
 
-void gainRealTime()
+struct RealTimePolicy
+{
+    int priority;
+    QList<int> cpus;
+};
+
+static RealTimePolicy readPolicy(const KConfigGroup &group, const char *prefix, int defaultPriority)
+{
+    const QString key = QLatin1String(prefix);
+    return RealTimePolicy{
+        group.readEntry(key + QLatin1String("Priority"), defaultPriority),
+        group.readEntry(key + QLatin1String("Cpus"), QList<int>()),
+    };
+}
+
+static RealTimePolicy policy(RealTimeTier tier)
+{
+    // Read once, on the main thread before any other thread gains realtime scheduling,
+    // see loadRealTimePolicy(), so the other threads never touch the config.
+    static const std::array<RealTimePolicy, 3> policies = [] {
+        const KConfig config(QStringLiteral("kwinrc"));
+        const KConfigGroup group = config.group("RealTime");
+        return std::array<RealTimePolicy, 3>{
+            readPolicy(group, "Compositor", 0),
+            readPolicy(group, "Commit", 1),
+            readPolicy(group, "Input", 2),
+        };
+    }();
+    return policies[int(tier)];
+}
+
+static void setAffinity(const QList<int> &cpus)
+{
+#if defined(Q_OS_LINUX)
+    if (cpus.isEmpty()) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    // pid 0 is the calling thread
+    sched_setaffinity(0, sizeof(set), &set);
+#else
+    Q_UNUSED(cpus)
+#endif
+}
+
+void loadRealTimePolicy()
+{
+    policy(RealTimeTier::Compositor);
+}
+
+void gainRealTime(RealTimeTier tier)
 {
+    const RealTimePolicy tierPolicy = policy(tier);
+    setAffinity(tierPolicy.cpus);
+
 #if HAVE_SCHED_RESET_ON_FORK
+    if (tierPolicy.priority < 0) {
+        return;
+    }
+
+    // With a finite RLIMIT_RTTIME, e.g. set up for rtkit, a realtime thread that doesn't block
+    // for too long gets killed. Input and commit threads sleep in between events, the main
+    // thread can render for a while and better stays at normal scheduling.
+    rlimit rttime;
+    if (tier == RealTimeTier::Compositor && getrlimit(RLIMIT_RTTIME, &rttime) == 0 && rttime.rlim_max != RLIM_INFINITY) {
+        return;
+    }
+
     const int minPriority = sched_get_priority_min(SCHED_RR);
+    const int priority = std::min(minPriority + tierPolicy.priority, sched_get_priority_max(SCHED_RR));
+
     sched_param sp;
-    sp.sched_priority = minPriority;
-    sched_setscheduler(0, SCHED_RR | SCHED_RESET_ON_FORK, &sp);
+    sp.sched_priority = priority;
+    if (sched_setscheduler(0, SCHED_RR | SCHED_RESET_ON_FORK, &sp) == 0) {
+        return;
+    }
+
+    // Without CAP_SYS_NICE, the priority can't go beyond RLIMIT_RTPRIO.
+    rlimit rtprio;
+    if (errno == EPERM && getrlimit(RLIMIT_RTPRIO, &rtprio) == 0 && rtprio.rlim_cur != RLIM_INFINITY
+        && int(rtprio.rlim_cur) > minPriority && int(rtprio.rlim_cur) < priority) {
+        sp.sched_priority = rtprio.rlim_cur;
+        if (sched_setscheduler(0, SCHED_RR | SCHED_RESET_ON_FORK, &sp) == 0) {
+            return;
+        }
+    }
+
+    if (priority != minPriority) {
+        sp.sched_priority = minPriority;
+        sched_setscheduler(0, SCHED_RR | SCHED_RESET_ON_FORK, &sp);
+    }
 #endif
 }
 
@@ -11,9 +11,30 @@
 namespace KWin
 {
 
+/**
+ * The threads that use realtime scheduling, ordered from the lowest to the highest priority.
+ */
+enum class RealTimeTier {
+    Compositor,
+    Commit,
+    Input,
+};
+
 /**
  * Makes the calling thread to use realtime scheduling.
+ *
+ * The priority and the CPU affinity of every @a tier can be changed in the RealTime group
+ * of kwinrc, with the CompositorPriority, CommitPriority and InputPriority entries, which
+ * are added to the minimum realtime priority, and the CompositorCpus, CommitCpus and
+ * InputCpus entries. A negative priority keeps the thread at normal scheduling. The config
+ * has to be loaded with loadRealTimePolicy() before other threads call this.
+ */
+KWIN_EXPORT void gainRealTime(RealTimeTier tier = RealTimeTier::Compositor);
+
+/**
+ * Reads the realtime scheduling config. This has to be called on the main thread before
+ * a thread that gains realtime scheduling is started.
  */
-KWIN_EXPORT void gainRealTime();
+KWIN_EXPORT void loadRealTimePolicy();
 
 } // namespace KWin
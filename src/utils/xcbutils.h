@@ -23,6 +23,8 @@
 
 #include <xcb/shm.h>
 
+#include <algorithm>
+
 class TestXcbSizeHints;
 
 namespace KWin
@@ -1851,6 +1853,47 @@ static inline void restackWindows(const QVector<xcb_window_t> &windows)
     }
 }
 
+/**
+ * Restacks the @p windows like restackWindows(), assuming that @p previous is the stack that
+ * has been sent to the X server last time. Only the windows between the common top and the
+ * common bottom of both stacks are restacked, the bottom part can only be kept if the windows
+ * above it have merely been reordered.
+ */
+static inline void restackWindows(const QVector<xcb_window_t> &windows, const QVector<xcb_window_t> &previous)
+{
+    const int common = std::min(windows.count(), previous.count());
+    int first = 0;
+    while (first < common && windows.at(first) == previous.at(first)) {
+        ++first;
+    }
+    if (first == windows.count() && first == previous.count()) {
+        return;
+    }
+
+    int last = windows.count();
+    if (windows.count() == previous.count()) {
+        int suffix = 0;
+        while (suffix < common - first && windows.at(last - suffix - 1) == previous.at(last - suffix - 1)) {
+            ++suffix;
+        }
+        QVector<xcb_window_t> reordered = windows.mid(first, last - suffix - first);
+        QVector<xcb_window_t> original = previous.mid(first, last - suffix - first);
+        std::sort(reordered.begin(), reordered.end());
+        std::sort(original.begin(), original.end());
+        if (reordered == original) {
+            last -= suffix;
+        }
+    }
+
+    for (int i = std::max(first, 1); i < last; ++i) {
+        const uint16_t mask = XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE;
+        const uint32_t stackingValues[] = {
+            windows.at(i - 1),
+            XCB_STACK_MODE_BELOW};
+        xcb_configure_window(connection(), windows.at(i), mask, stackingValues);
+    }
+}
+
 static inline void restackWindowsWithRaise(const QVector<xcb_window_t> &windows)
 {
     if (windows.isEmpty()) {
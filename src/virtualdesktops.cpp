@@ -64,9 +64,17 @@ void VirtualDesktopManager::setVirtualDesktopManagement(KWaylandServer::PlasmaVi
         });
     };
 
-    connect(this, &VirtualDesktopManager::desktopCreated, m_virtualDesktopManagement, createPlasmaVirtualDesktop);
+    connect(this, &VirtualDesktopManager::desktopCreated, m_virtualDesktopManagement, [this, createPlasmaVirtualDesktop](VirtualDesktop *desktop) {
+        createPlasmaVirtualDesktop(desktop);
+        m_virtualDesktopManagement->sendDone();
+    });
 
     connect(this, &VirtualDesktopManager::rowsChanged, m_virtualDesktopManagement, [this](uint rows) {
+        // The layout is recalculated whenever a desktop is added or removed, which send their
+        // own done event, only tell clients about it if the number of rows actually changed.
+        if (m_virtualDesktopManagement->rows() == rows) {
+            return;
+        }
         m_virtualDesktopManagement->setRows(rows);
         m_virtualDesktopManagement->sendDone();
     });
@@ -74,6 +82,7 @@ void VirtualDesktopManager::setVirtualDesktopManagement(KWaylandServer::PlasmaVi
     // handle removed: from VirtualDesktopManager to the wayland interface
     connect(this, &VirtualDesktopManager::desktopRemoved, m_virtualDesktopManagement, [this](VirtualDesktop *desktop) {
         m_virtualDesktopManagement->removeDesktop(desktop->id());
+        m_virtualDesktopManagement->sendDone();
     });
 
     // create a new desktop when the client asks to
@@ -144,8 +153,16 @@ VirtualDesktopGrid::~VirtualDesktopGrid() = default;
 
 void VirtualDesktopGrid::update(const QSize &size, Qt::Orientation orientation, const QVector<VirtualDesktop *> &desktops)
 {
+    // The layout is updated every time the desktops change in any way, skip the rebuild if
+    // nothing that affects the grid did.
+    if (m_size == size && m_orientation == orientation && m_desktops == desktops) {
+        return;
+    }
+
     // Set private variables
     m_size = size;
+    m_orientation = orientation;
+    m_desktops = desktops;
     const uint width = size.width();
     const uint height = size.height();
 
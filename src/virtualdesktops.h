@@ -110,6 +110,8 @@ public:
 
 private:
     QSize m_size;
+    Qt::Orientation m_orientation = Qt::Horizontal;
+    QVector<VirtualDesktop *> m_desktops;
     QVector<QVector<VirtualDesktop *>> m_grid;
 };
 
@@ -14,6 +14,7 @@
 #include "wayland/idleinhibit_v1_interface.h"
 #include "wayland/shmclientbuffer.h"
 #include "wayland/surface_interface.h"
+#include "wayland/surface_interface_p.h"
 
 #include "KWayland/Client/compositor.h"
 #include "KWayland/Client/connection_thread.h"
@@ -27,6 +28,9 @@
 
 // Wayland
 #include <wayland-client-protocol.h>
+// system
+#include <fcntl.h>
+#include <unistd.h>
 
 using KWayland::Client::Registry;
 
@@ -47,9 +51,11 @@ private Q_SLOTS:
     void testOpaque();
     void testInput();
     void testScale();
+    void benchmarkMapFromBuffer();
     void testUnmapOfNotMappedSurface();
     void testSurfaceAt();
     void testDestroyAttachedBuffer();
+    void testDestroyDelayedBuffer();
     void testDestroyWithPendingCallback();
     void testOutput();
     void testDisconnect();
@@ -585,9 +591,11 @@ void TestWaylandSurface::testMultipleSurfaces()
     QImage buffer2Data = qobject_cast<ShmClientBuffer *>(buffer2)->data();
     QCOMPARE(buffer2Data, red);
 
-    // while buffer2 is accessed we cannot access buffer1
+    // buffer1 can be accessed while buffer2 is being accessed
     buffer1Data = qobject_cast<ShmClientBuffer *>(buffer1)->data();
-    QVERIFY(buffer1Data.isNull());
+    QCOMPARE(buffer1Data, black);
+    QCOMPARE(buffer2Data, red);
+    buffer1Data = QImage();
 
     // a deep copy can be kept around
     QImage deepCopy = buffer2Data.copy();
@@ -596,7 +604,7 @@ void TestWaylandSurface::testMultipleSurfaces()
     QVERIFY(buffer2Data.isNull());
     QCOMPARE(deepCopy, red);
 
-    // now that buffer2Data is destroyed we can access buffer1 again
+    // buffer1 can still be accessed after buffer2Data is destroyed
     buffer1Data = qobject_cast<ShmClientBuffer *>(buffer1)->data();
     QVERIFY(!buffer1Data.isNull());
     QCOMPARE(buffer1Data, black);
@@ -820,6 +828,40 @@ void TestWaylandSurface::testScale()
     QCOMPARE(serverSurface->size(), QSize(25, 25));
 }
 
+void TestWaylandSurface::benchmarkMapFromBuffer()
+{
+    // this benchmark measures converting buffer damage of a scaled surface to surface-local coordinates
+    using namespace KWayland::Client;
+    using namespace KWaylandServer;
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<Surface> s(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *serverSurface = serverSurfaceCreated.first().first().value<KWaylandServer::SurfaceInterface *>();
+    QVERIFY(serverSurface);
+
+    QSignalSpy sizeChangedSpy(serverSurface, &SurfaceInterface::sizeChanged);
+    QVERIFY(sizeChangedSpy.isValid());
+    QImage image(1920, 1080, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::red);
+    s->setScale(2);
+    s->attachBuffer(m_shm->createBuffer(image));
+    s->damage(image.rect());
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(sizeChangedSpy.wait());
+    QCOMPARE(serverSurface->size(), QSize(960, 540));
+
+    // damage of a terminal with scattered updated lines
+    QRegion region;
+    for (int i = 0; i < 50; ++i) {
+        region += QRect((i * 37) % 1800, i * 20, 120, 16);
+    }
+
+    QBENCHMARK {
+        serverSurface->mapFromBuffer(region);
+    }
+}
+
 void TestWaylandSurface::testUnmapOfNotMappedSurface()
 {
     // this test verifies that a surface which doesn't have a buffer attached doesn't trigger the unmapped signal
@@ -914,6 +956,60 @@ void TestWaylandSurface::testDestroyAttachedBuffer()
     QTRY_VERIFY(serverSurface->buffer()->isDestroyed());
 }
 
+void TestWaylandSurface::testDestroyDelayedBuffer()
+{
+    // this test verifies that a buffer of a delayed commit survives until the commit gets applied
+    using namespace KWayland::Client;
+    using namespace KWaylandServer;
+    QSignalSpy serverSurfaceCreated(m_compositorInterface, &CompositorInterface::surfaceCreated);
+    QVERIFY(serverSurfaceCreated.isValid());
+    QScopedPointer<Surface> s(m_compositor->createSurface());
+    QVERIFY(serverSurfaceCreated.wait());
+    SurfaceInterface *serverSurface = serverSurfaceCreated.first().first().value<KWaylandServer::SurfaceInterface *>();
+
+    QSignalSpy damagedSpy(serverSurface, &SurfaceInterface::damaged);
+    QVERIFY(damagedSpy.isValid());
+    QImage image(QSize(100, 100), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::red);
+    s->attachBuffer(m_shm->createBuffer(image));
+    s->damage(QRect(0, 0, 100, 100));
+    s->commit(Surface::CommitFlag::None);
+    QVERIFY(damagedSpy.wait());
+    ClientBuffer *firstBuffer = serverSurface->buffer();
+    QVERIFY(firstBuffer);
+
+    // hold back the following commits as if the buffer of an earlier commit wasn't ready yet
+    SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(serverSurface);
+    int fence[2];
+    QCOMPARE(pipe2(fence, O_CLOEXEC), 0);
+    auto placeholder = std::make_unique<SurfaceState>();
+    wl_list_init(&placeholder->frameCallbacks);
+    wl_list_init(&placeholder->presentationFeedbacks);
+    surfacePrivate->delayedStates.push_back(std::move(placeholder));
+    surfacePrivate->waitForFence(fence[0]);
+
+    image.fill(Qt::blue);
+    s->attachBuffer(m_shm->createBuffer(image));
+    s->damage(QRect(0, 0, 100, 100));
+    s->commit(Surface::CommitFlag::None);
+    QTRY_COMPARE(surfacePrivate->delayedStates.size(), std::size_t(2));
+    QPointer<ClientBuffer> delayedBuffer = surfacePrivate->delayedStates.back()->buffer;
+    QVERIFY(delayedBuffer);
+    QVERIFY(delayedBuffer->isReferenced());
+
+    // destroy the buffer while the commit waits
+    delete m_shm;
+    m_shm = nullptr;
+    QTRY_VERIFY(delayedBuffer->isDestroyed());
+
+    // the delayed commit mustn't show the destroyed buffer
+    QCOMPARE(write(fence[1], "x", 1), 1);
+    close(fence[1]);
+    QTRY_VERIFY(surfacePrivate->delayedStates.empty());
+    QVERIFY(!delayedBuffer);
+    QCOMPARE(serverSurface->buffer(), firstBuffer);
+}
+
 void TestWaylandSurface::testDestroyWithPendingCallback()
 {
     // this test tries to verify that destroying a surface with a pending callback works correctly
@@ -6,9 +6,12 @@
 
 #include "clientbuffer.h"
 #include "clientbuffer_p.h"
+#include "linuxdrmsyncobj_v1_interface_p.h"
 
 #include "qwayland-server-wayland.h"
 
+#include <fcntl.h>
+
 namespace KWaylandServer
 {
 ClientBuffer::ClientBuffer(ClientBufferPrivate &dd)
@@ -62,6 +65,8 @@ void ClientBuffer::unref()
     Q_ASSERT(d->refCount > 0);
     --d->refCount;
     if (!isReferenced()) {
+        // releases the points of explicitly synchronized commits, after the render fence if set
+        d->releasePoints.clear();
         if (isDestroyed()) {
             delete this;
         } else {
@@ -70,6 +75,30 @@ void ClientBuffer::unref()
     }
 }
 
+void ClientBuffer::addReleasePoint(const std::shared_ptr<SyncReleasePoint> &point)
+{
+    Q_D(ClientBuffer);
+    Q_ASSERT(d->refCount > 0);
+    d->releasePoints.append(point);
+}
+
+bool ClientBuffer::hasReleasePoints() const
+{
+    Q_D(const ClientBuffer);
+    return !d->releasePoints.isEmpty();
+}
+
+void ClientBuffer::setReleaseFence(int syncFileFd)
+{
+    Q_D(ClientBuffer);
+    for (const auto &point : qAsConst(d->releasePoints)) {
+        const int fd = fcntl(syncFileFd, F_DUPFD_CLOEXEC, 0);
+        if (fd != -1) {
+            point->setFence(fd);
+        }
+    }
+}
+
 void ClientBuffer::markAsDestroyed()
 {
     Q_D(ClientBuffer);
@@ -12,11 +12,14 @@
 #include <QObject>
 #include <QSize>
 
+#include <memory>
+
 struct wl_resource;
 
 namespace KWaylandServer
 {
 class ClientBufferPrivate;
+class SyncReleasePoint;
 
 /**
  * The ClientBuffer class represents a client buffer.
@@ -65,6 +68,27 @@ public:
 
     void markAsDestroyed(); ///< @internal
 
+    /**
+     * Keeps the given timeline @a point unsignalled until the buffer is released. The buffer
+     * must be referenced.
+     * @internal
+     */
+    void addReleasePoint(const std::shared_ptr<SyncReleasePoint> &point);
+
+    /**
+     * Returns @c true if the buffer has explicit synchronization release points attached.
+     * @internal
+     */
+    bool hasReleasePoints() const;
+
+    /**
+     * Makes the release points of the buffer wait for the sync file @a syncFileFd, which must
+     * signal once the GPU has finished reading the buffer. The ownership of the file descriptor
+     * is not transferred.
+     * @internal
+     */
+    void setReleaseFence(int syncFileFd);
+
 protected:
     ClientBuffer(ClientBufferPrivate &dd);
     ClientBuffer(wl_resource *resource, ClientBufferPrivate &dd);
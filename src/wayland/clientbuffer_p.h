@@ -8,6 +8,8 @@
 
 #include "clientbuffer.h"
 
+#include <QVector>
+
 namespace KWaylandServer
 {
 class ClientBufferPrivate
@@ -20,6 +22,7 @@ public:
     int refCount = 0;
     wl_resource *resource = nullptr;
     bool isDestroyed = false;
+    QVector<std::shared_ptr<SyncReleasePoint>> releasePoints;
 };
 
 } // namespace KWaylandServer
@@ -8,10 +8,13 @@
 #include "utils/executable_path.h"
 // Qt
 #include <QFileInfo>
+#include <QHash>
 #include <QVector>
 // Wayland
 #include <wayland-server.h>
 
+#include <cstring>
+
 namespace KWaylandServer
 {
 class ClientConnectionPrivate
@@ -27,23 +30,41 @@ public:
     gid_t group = 0;
     QString executablePath;
 
+    // Keyed by the interface name, which is a static string owned by the wl_interface.
+    QHash<const char *, ClientStatistics::Interface> interfaceStatistics;
+    quint64 requestCount = 0;
+    std::chrono::nanoseconds handlerTime = std::chrono::nanoseconds::zero();
+    quint64 commitCount = 0;
+    quint64 damagedArea = 0;
+    std::chrono::steady_clock::time_point commitWindowStart;
+    quint64 commitsInWindow = 0;
+    qreal commitsPerSecond = 0;
+
+    static ClientConnectionPrivate *get(wl_client *client);
+
+    ClientConnection *q;
+
 private:
     static void destroyListenerCallback(wl_listener *listener, void *data);
-    ClientConnection *q;
-    wl_listener listener;
-    static QVector<ClientConnectionPrivate *> s_allClients;
-};
 
-QVector<ClientConnectionPrivate *> ClientConnectionPrivate::s_allClients;
+    // The destroy listener doubles as the link from the wl_client to its connection, which
+    // makes finding the connection of a client independent of the number of clients.
+    struct DestroyListener
+    {
+        wl_listener listener;
+        ClientConnectionPrivate *connection;
+    };
+    DestroyListener destroyListener;
+};
 
 ClientConnectionPrivate::ClientConnectionPrivate(wl_client *c, Display *display, ClientConnection *q)
     : client(c)
     , display(display)
     , q(q)
 {
-    s_allClients << this;
-    listener.notify = destroyListenerCallback;
-    wl_client_add_destroy_listener(c, &listener);
+    destroyListener.listener.notify = destroyListenerCallback;
+    destroyListener.connection = this;
+    wl_client_add_destroy_listener(c, &destroyListener.listener);
     wl_client_get_credentials(client, &pid, &user, &group);
     executablePath = executablePathFromPid(pid);
 }
@@ -51,24 +72,29 @@ ClientConnectionPrivate::ClientConnectionPrivate(wl_client *c, Display *display,
 ClientConnectionPrivate::~ClientConnectionPrivate()
 {
     if (client) {
-        wl_list_remove(&listener.link);
+        wl_list_remove(&destroyListener.listener.link);
     }
-    s_allClients.removeAt(s_allClients.indexOf(this));
+}
+
+ClientConnectionPrivate *ClientConnectionPrivate::get(wl_client *client)
+{
+    wl_listener *listener = wl_client_get_destroy_listener(client, destroyListenerCallback);
+    if (!listener) {
+        return nullptr;
+    }
+    DestroyListener *destroyListener = wl_container_of(listener, destroyListener, listener);
+    return destroyListener->connection;
 }
 
 void ClientConnectionPrivate::destroyListenerCallback(wl_listener *listener, void *data)
 {
-    Q_UNUSED(listener)
-    wl_client *client = reinterpret_cast<wl_client *>(data);
-    auto it = std::find_if(s_allClients.constBegin(), s_allClients.constEnd(), [client](ClientConnectionPrivate *c) {
-        return c->client == client;
-    });
-    Q_ASSERT(it != s_allClients.constEnd());
-    auto p = (*it);
+    Q_UNUSED(data)
+    DestroyListener *destroyListener = wl_container_of(listener, destroyListener, listener);
+    auto p = destroyListener->connection;
     auto q = p->q;
     Q_EMIT q->aboutToBeDestroyed();
     p->client = nullptr;
-    wl_list_remove(&p->listener.link);
+    wl_list_remove(&p->destroyListener.listener.link);
     Q_EMIT q->disconnected(q);
     q->deleteLater();
 }
@@ -81,6 +107,12 @@ ClientConnection::ClientConnection(wl_client *c, Display *parent)
 
 ClientConnection::~ClientConnection() = default;
 
+ClientConnection *ClientConnection::get(wl_client *client)
+{
+    ClientConnectionPrivate *connection = ClientConnectionPrivate::get(client);
+    return connection ? connection->q : nullptr;
+}
+
 void ClientConnection::flush()
 {
     if (!d->client) {
@@ -145,4 +177,59 @@ QString ClientConnection::executablePath() const
     return d->executablePath;
 }
 
+void ClientConnection::recordRequest(const wl_protocol_logger_message *message)
+{
+    const char *interfaceName = wl_resource_get_class(message->resource);
+    d->interfaceStatistics[interfaceName].requestCount++;
+    d->requestCount++;
+
+    if (interfaceName != wl_surface_interface.name) {
+        return;
+    }
+
+    if (std::strcmp(message->message->name, "commit") == 0) {
+        const auto now = std::chrono::steady_clock::now();
+        const auto elapsed = now - d->commitWindowStart;
+        if (elapsed >= std::chrono::seconds(1)) {
+            d->commitsPerSecond = d->commitsInWindow / std::chrono::duration<qreal>(elapsed).count();
+            d->commitWindowStart = now;
+            d->commitsInWindow = 0;
+        }
+        d->commitsInWindow++;
+        d->commitCount++;
+    } else if (std::strcmp(message->message->name, "damage") == 0 || std::strcmp(message->message->name, "damage_buffer") == 0) {
+        // Clients often damage the entire surface with INT32_MAX sized rectangles.
+        const quint64 width = qBound(0, message->arguments[2].i, 1 << 16);
+        const quint64 height = qBound(0, message->arguments[3].i, 1 << 16);
+        d->damagedArea += width * height;
+    }
+}
+
+void ClientConnection::recordHandlerTime(const char *interfaceName, std::chrono::nanoseconds duration)
+{
+    d->interfaceStatistics[interfaceName].handlerTime += duration;
+    d->handlerTime += duration;
+}
+
+ClientStatistics ClientConnection::statistics() const
+{
+    ClientStatistics statistics;
+    for (auto it = d->interfaceStatistics.constBegin(); it != d->interfaceStatistics.constEnd(); ++it) {
+        statistics.interfaces[QByteArray(it.key())] = it.value();
+    }
+    statistics.requestCount = d->requestCount;
+    statistics.handlerTime = d->handlerTime;
+    statistics.commitCount = d->commitCount;
+    statistics.damagedArea = d->damagedArea;
+
+    // The rate is only updated on commit, so take into account that the client may have gone idle.
+    const auto elapsed = std::chrono::steady_clock::now() - d->commitWindowStart;
+    if (elapsed >= std::chrono::seconds(2)) {
+        statistics.commitsPerSecond = d->commitsInWindow / std::chrono::duration<qreal>(elapsed).count();
+    } else {
+        statistics.commitsPerSecond = d->commitsPerSecond;
+    }
+    return statistics;
+}
+
 }
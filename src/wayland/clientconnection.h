@@ -9,15 +9,53 @@
 
 #include <sys/types.h>
 
+#include <QMap>
 #include <QObject>
 
+#include <chrono>
+
 struct wl_client;
+struct wl_protocol_logger_message;
 struct wl_resource;
 
 namespace KWaylandServer
 {
 class ClientConnectionPrivate;
 class Display;
+class DisplayPrivate;
+
+/**
+ * The ClientStatistics struct contains counters for the requests that a client has sent.
+ *
+ * The handler time is the time the compositor has spent processing requests of the client.
+ */
+struct ClientStatistics
+{
+    struct Interface
+    {
+        quint64 requestCount = 0;
+        std::chrono::nanoseconds handlerTime = std::chrono::nanoseconds::zero();
+    };
+
+    /**
+     * The request counters of every interface, keyed by the name of the interface.
+     */
+    QMap<QByteArray, Interface> interfaces;
+    quint64 requestCount = 0;
+    std::chrono::nanoseconds handlerTime = std::chrono::nanoseconds::zero();
+    /**
+     * The number of wl_surface.commit requests.
+     */
+    quint64 commitCount = 0;
+    /**
+     * The number of wl_surface.commit requests per second, measured over the last second.
+     */
+    qreal commitsPerSecond = 0;
+    /**
+     * The total area of the rectangles posted with wl_surface.damage and wl_surface.damage_buffer.
+     */
+    quint64 damagedArea = 0;
+};
 
 /**
  * @brief Convenient Class which represents a wl_client.
@@ -109,6 +147,11 @@ public:
      */
     void destroy();
 
+    /**
+     * Returns the counters for the requests that the client has sent so far.
+     */
+    ClientStatistics statistics() const;
+
 Q_SIGNALS:
     /**
      * This signal is emitted when the client is about to be destroyed.
@@ -121,7 +164,14 @@ Q_SIGNALS:
 
 private:
     friend class Display;
+    friend class DisplayPrivate;
     explicit ClientConnection(wl_client *c, Display *parent);
+    /**
+     * Returns the ClientConnection that has been created for the @a client, or @c null.
+     */
+    static ClientConnection *get(wl_client *client);
+    void recordRequest(const wl_protocol_logger_message *message);
+    void recordHandlerTime(const char *interfaceName, std::chrono::nanoseconds duration);
     QScopedPointer<ClientConnectionPrivate> d;
 };
 
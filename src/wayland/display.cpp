@@ -29,6 +29,35 @@ DisplayPrivate::DisplayPrivate(Display *q)
 {
 }
 
+void DisplayPrivate::logRequest(void *data, wl_protocol_logger_type type, const wl_protocol_logger_message *message)
+{
+    if (type != WL_PROTOCOL_LOGGER_REQUEST) {
+        return;
+    }
+
+    auto displayPrivate = static_cast<DisplayPrivate *>(data);
+
+    // libwayland doesn't notify when a request handler returns, but requests are dispatched
+    // one after another, so the previous request has been handled by the time this one arrives.
+    displayPrivate->finishRequest();
+
+    wl_client *client = wl_resource_get_client(message->resource);
+    if (!displayPrivate->requestClient || displayPrivate->requestClient->client() != client) {
+        displayPrivate->requestClient = displayPrivate->q->getConnection(client);
+    }
+    displayPrivate->requestClient->recordRequest(message);
+    displayPrivate->requestInterface = wl_resource_get_class(message->resource);
+    displayPrivate->requestStart = std::chrono::steady_clock::now();
+}
+
+void DisplayPrivate::finishRequest()
+{
+    if (requestInterface && requestClient) {
+        requestClient->recordHandlerTime(requestInterface, std::chrono::steady_clock::now() - requestStart);
+    }
+    requestInterface = nullptr;
+}
+
 void DisplayPrivate::registerSocketName(const QString &socketName)
 {
     socketNames.append(socketName);
@@ -41,10 +70,12 @@ Display::Display(QObject *parent)
 {
     d->display = wl_display_create();
     d->loop = wl_display_get_event_loop(d->display);
+    d->protocolLogger = wl_display_add_protocol_logger(d->display, DisplayPrivate::logRequest, d.data());
 }
 
 Display::~Display()
 {
+    wl_protocol_logger_destroy(d->protocolLogger);
     wl_display_destroy_clients(d->display);
     wl_display_destroy(d->display);
 }
@@ -114,6 +145,7 @@ void Display::dispatchEvents()
     if (wl_event_loop_dispatch(d->loop, 0) != 0) {
         qCWarning(KWIN_CORE) << "Error on dispatching Wayland event loop";
     }
+    d->finishRequest();
 }
 
 void Display::flush()
@@ -182,20 +214,19 @@ QVector<SeatInterface *> Display::seats() const
 ClientConnection *Display::getConnection(wl_client *client)
 {
     Q_ASSERT(client);
-    auto it = std::find_if(d->clients.constBegin(), d->clients.constEnd(), [client](ClientConnection *c) {
-        return c->client() == client;
-    });
-    if (it != d->clients.constEnd()) {
-        return *it;
+    if (ClientConnection *connection = ClientConnection::get(client)) {
+        return connection;
     }
     // no ConnectionData yet, create it
     auto c = new ClientConnection(client, this);
     d->clients << c;
     connect(c, &ClientConnection::disconnected, this, [this](ClientConnection *c) {
-        const int index = d->clients.indexOf(c);
-        Q_ASSERT(index != -1);
-        d->clients.remove(index);
-        Q_ASSERT(d->clients.indexOf(c) == -1);
+        if (d->requestClient == c) {
+            d->requestClient = nullptr;
+        }
+        const bool removed = d->clients.removeOne(c);
+        Q_ASSERT(removed);
+        Q_UNUSED(removed)
         Q_EMIT clientDisconnected(c);
     });
     Q_EMIT clientConnected(c);
@@ -17,6 +17,8 @@
 
 #include <EGL/egl.h>
 
+#include <chrono>
+
 struct wl_resource;
 
 namespace KWaylandServer
@@ -41,6 +43,9 @@ public:
     void registerClientBuffer(ClientBuffer *clientBuffer);
     void unregisterClientBuffer(ClientBuffer *clientBuffer);
 
+    static void logRequest(void *data, wl_protocol_logger_type type, const wl_protocol_logger_message *message);
+    void finishRequest();
+
     Display *q;
     QSocketNotifier *socketNotifier = nullptr;
     wl_display *display = nullptr;
@@ -55,6 +60,11 @@ public:
     QHash<::wl_resource *, ClientBuffer *> resourceToBuffer;
     QHash<ClientBuffer *, ClientBufferDestroyListener *> bufferToListener;
     QList<ClientBufferIntegration *> bufferIntegrations;
+
+    wl_protocol_logger *protocolLogger = nullptr;
+    ClientConnection *requestClient = nullptr;
+    const char *requestInterface = nullptr;
+    std::chrono::steady_clock::time_point requestStart;
 };
 
 } // namespace KWaylandServer
@@ -0,0 +1,101 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "fractionalscale_v1_interface.h"
+#include "display.h"
+#include "fractionalscale_v1_interface_p.h"
+#include "surface_interface_p.h"
+
+#include <cmath>
+
+static const int s_version = 1;
+
+namespace KWaylandServer
+{
+class FractionalScaleManagerV1InterfacePrivate : public QtWaylandServer::wp_fractional_scale_manager_v1
+{
+public:
+    explicit FractionalScaleManagerV1InterfacePrivate(Display *display);
+
+protected:
+    void wp_fractional_scale_manager_v1_destroy(Resource *resource) override;
+    void wp_fractional_scale_manager_v1_get_fractional_scale(Resource *resource, uint32_t id, struct ::wl_resource *surface) override;
+};
+
+FractionalScaleManagerV1InterfacePrivate::FractionalScaleManagerV1InterfacePrivate(Display *display)
+    : QtWaylandServer::wp_fractional_scale_manager_v1(*display, s_version)
+{
+}
+
+void FractionalScaleManagerV1InterfacePrivate::wp_fractional_scale_manager_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void FractionalScaleManagerV1InterfacePrivate::wp_fractional_scale_manager_v1_get_fractional_scale(Resource *resource, uint32_t id, struct ::wl_resource *surface_resource)
+{
+    SurfaceInterface *surface = SurfaceInterface::get(surface_resource);
+    if (FractionalScaleV1Interface::get(surface)) {
+        wl_resource_post_error(resource->handle, error_fractional_scale_exists, "the specified surface already has a fractional scale object");
+        return;
+    }
+
+    wl_resource *fractionalScaleResource = wl_resource_create(resource->client(), &wp_fractional_scale_v1_interface, resource->version(), id);
+
+    auto fractionalScale = new FractionalScaleV1Interface(surface, fractionalScaleResource);
+    fractionalScale->setPreferredScale(surface->preferredScale());
+}
+
+FractionalScaleManagerV1Interface::FractionalScaleManagerV1Interface(Display *display, QObject *parent)
+    : QObject(parent)
+    , d(new FractionalScaleManagerV1InterfacePrivate(display))
+{
+}
+
+FractionalScaleManagerV1Interface::~FractionalScaleManagerV1Interface()
+{
+}
+
+FractionalScaleV1Interface::FractionalScaleV1Interface(SurfaceInterface *surface, wl_resource *resource)
+    : QtWaylandServer::wp_fractional_scale_v1(resource)
+    , surface(surface)
+{
+    SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+    surfacePrivate->fractionalScaleExtension = this;
+}
+
+FractionalScaleV1Interface::~FractionalScaleV1Interface()
+{
+    if (surface) {
+        SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+        surfacePrivate->fractionalScaleExtension = nullptr;
+    }
+}
+
+FractionalScaleV1Interface *FractionalScaleV1Interface::get(SurfaceInterface *surface)
+{
+    return SurfaceInterfacePrivate::get(surface)->fractionalScaleExtension;
+}
+
+void FractionalScaleV1Interface::setPreferredScale(qreal scale)
+{
+    // The scale is sent as the numerator of a fraction with a denominator of 120.
+    send_preferred_scale(std::round(scale * 120));
+}
+
+void FractionalScaleV1Interface::wp_fractional_scale_v1_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource)
+    delete this;
+}
+
+void FractionalScaleV1Interface::wp_fractional_scale_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+} // namespace KWaylandServer
@@ -0,0 +1,39 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QObject>
+
+namespace KWaylandServer
+{
+class Display;
+class FractionalScaleManagerV1InterfacePrivate;
+
+/**
+ * The FractionalScaleManagerV1Interface is an extension that tells clients the exact scale
+ * factor they should render their surfaces at, including fractional scale factors.
+ *
+ * The preferred scale of a surface can be set with SurfaceInterface::setPreferredScale().
+ *
+ * FractionalScaleManagerV1Interface corresponds to the Wayland interface @c wp_fractional_scale_manager_v1.
+ */
+class KWIN_EXPORT FractionalScaleManagerV1Interface : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FractionalScaleManagerV1Interface(Display *display, QObject *parent = nullptr);
+    ~FractionalScaleManagerV1Interface() override;
+
+private:
+    QScopedPointer<FractionalScaleManagerV1InterfacePrivate> d;
+};
+
+} // namespace KWaylandServer
@@ -7,6 +7,8 @@
 #include "idle_interface_p.h"
 #include "seat_interface.h"
 
+#include <limits>
+
 namespace KWaylandServer
 {
 static const quint32 s_version = 1;
@@ -15,6 +17,67 @@ IdleInterfacePrivate::IdleInterfacePrivate(IdleInterface *_q, Display *display)
     : QtWaylandServer::org_kde_kwin_idle(*display, s_version)
     , q(_q)
 {
+    clock.start();
+    timer.setSingleShot(true);
+    QObject::connect(&timer, &QTimer::timeout, q, [this]() {
+        handleTimeout();
+    });
+}
+
+qint64 IdleInterfacePrivate::now() const
+{
+    return clock.elapsed();
+}
+
+void IdleInterfacePrivate::scheduleTimer()
+{
+    if (inhibitCount > 0) {
+        return;
+    }
+
+    qint64 nextDeadline = std::numeric_limits<qint64>::max();
+    for (const IdleTimeoutInterface *idleTimeout : std::as_const(idleTimeouts)) {
+        if (!idleTimeout->isIdle()) {
+            nextDeadline = std::min(nextDeadline, idleTimeout->deadline());
+        }
+    }
+    if (nextDeadline == std::numeric_limits<qint64>::max()) {
+        timer.stop();
+        return;
+    }
+
+    // The timer may fire early if it's already armed for an earlier deadline, but it must not fire late
+    const qint64 interval = std::max<qint64>(0, nextDeadline - now());
+    if (!timer.isActive() || timer.remainingTime() > interval) {
+        timer.start(interval);
+    }
+}
+
+void IdleInterfacePrivate::handleTimeout()
+{
+    // The deadlines may have moved since the timer has been armed, check them anew
+    const qint64 currentTime = now();
+    const QVector<IdleTimeoutInterface *> candidates = idleTimeouts;
+    for (IdleTimeoutInterface *idleTimeout : candidates) {
+        if (!idleTimeout->isIdle() && idleTimeout->deadline() <= currentTime) {
+            idleTimeout->setIdle(true);
+        }
+    }
+    scheduleTimer();
+}
+
+void IdleInterfacePrivate::suspend()
+{
+    timer.stop();
+    for (IdleTimeoutInterface *idleTimeout : std::as_const(idleTimeouts)) {
+        idleTimeout->setIdle(false);
+    }
+}
+
+void IdleInterfacePrivate::resume()
+{
+    lastActivity = now();
+    scheduleTimer();
 }
 
 void IdleInterfacePrivate::org_kde_kwin_idle_get_idle_timeout(Resource *resource, uint32_t id, wl_resource *seat, uint32_t timeout)
@@ -28,7 +91,7 @@ void IdleInterfacePrivate::org_kde_kwin_idle_get_idle_timeout(Resource *resource
         return;
     }
 
-    IdleTimeoutInterface *idleTimeout = new IdleTimeoutInterface(s, q, idleTimoutResource);
+    IdleTimeoutInterface *idleTimeout = new IdleTimeoutInterface(s, this, idleTimoutResource);
     idleTimeouts << idleTimeout;
 
     QObject::connect(idleTimeout, &IdleTimeoutInterface::destroyed, q, [this, idleTimeout]() {
@@ -49,6 +112,7 @@ void IdleInterface::inhibit()
 {
     d->inhibitCount++;
     if (d->inhibitCount == 1) {
+        d->suspend();
         Q_EMIT inhibitedChanged();
     }
 }
@@ -57,6 +121,7 @@ void IdleInterface::uninhibit()
 {
     d->inhibitCount--;
     if (d->inhibitCount == 0) {
+        d->resume();
         Q_EMIT inhibitedChanged();
     }
 }
@@ -68,31 +133,28 @@ bool IdleInterface::isInhibited() const
 
 void IdleInterface::simulateUserActivity()
 {
+    if (isInhibited()) {
+        // ignored while inhibited
+        return;
+    }
+    d->lastActivity = d->now();
     for (auto i : qAsConst(d->idleTimeouts)) {
-        i->simulateUserActivity();
+        if (i->isIdle()) {
+            i->setIdle(false);
+        }
+    }
+    // Nothing to do while the timer is armed, the deadlines that have moved are checked when it fires
+    if (!d->timer.isActive()) {
+        d->scheduleTimer();
     }
 }
 
-IdleTimeoutInterface::IdleTimeoutInterface(SeatInterface *seat, IdleInterface *manager, wl_resource *resource)
+IdleTimeoutInterface::IdleTimeoutInterface(SeatInterface *seat, IdleInterfacePrivate *manager, wl_resource *resource)
     : QObject()
     , QtWaylandServer::org_kde_kwin_idle_timeout(resource)
     , seat(seat)
     , manager(manager)
 {
-    connect(manager, &IdleInterface::inhibitedChanged, this, [this, manager] {
-        if (!timer) {
-            // not yet configured
-            return;
-        }
-        if (manager->isInhibited()) {
-            if (!timer->isActive()) {
-                send_resumed();
-            }
-            timer->stop();
-        } else {
-            timer->start();
-        }
-    });
 }
 
 IdleTimeoutInterface::~IdleTimeoutInterface() = default;
@@ -113,38 +175,56 @@ void IdleTimeoutInterface::org_kde_kwin_idle_timeout_simulate_user_activity(Reso
     Q_UNUSED(resource)
     simulateUserActivity();
 }
+
 void IdleTimeoutInterface::simulateUserActivity()
 {
-    if (!timer) {
+    if (!configured) {
         // not yet configured
         return;
     }
-    if (manager->isInhibited()) {
+    if (manager->inhibitCount > 0) {
         // ignored while inhibited
         return;
     }
-    if (!timer->isActive()) {
-        send_resumed();
+    lastActivity = manager->now();
+    if (idle) {
+        setIdle(false);
+        manager->scheduleTimer();
     }
-    timer->start();
 }
 
 void IdleTimeoutInterface::setup(quint32 timeout)
 {
-    if (timer) {
+    if (configured) {
         return;
     }
-    timer = new QTimer(this);
-    timer->setSingleShot(true);
+    configured = true;
     // less than 500 msec is not idle by definition
-    timer->setInterval(qMax(timeout, 500u));
-    QObject::connect(timer, &QTimer::timeout, this, [this] {
-        send_idle();
-    });
-    if (manager->isInhibited()) {
-        // don't start if inhibited
+    this->timeout = qMax(timeout, 500u);
+    lastActivity = manager->now();
+    manager->scheduleTimer();
+}
+
+qint64 IdleTimeoutInterface::deadline() const
+{
+    return std::max(lastActivity, manager->lastActivity) + timeout;
+}
+
+bool IdleTimeoutInterface::isIdle() const
+{
+    return idle;
+}
+
+void IdleTimeoutInterface::setIdle(bool set)
+{
+    if (idle == set) {
         return;
     }
-    timer->start();
+    idle = set;
+    if (idle) {
+        send_idle();
+    } else {
+        send_resumed();
+    }
 }
 }
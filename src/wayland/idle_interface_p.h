@@ -9,6 +9,7 @@
 
 #include <qwayland-server-idle.h>
 
+#include <QElapsedTimer>
 #include <QTimer>
 
 namespace KWaylandServer
@@ -23,8 +24,25 @@ class IdleInterfacePrivate : public QtWaylandServer::org_kde_kwin_idle
 public:
     IdleInterfacePrivate(IdleInterface *_q, Display *display);
 
+    /**
+     * Returns the current time of the monotonic clock of the idle timeouts, in milliseconds.
+     */
+    qint64 now() const;
+    /**
+     * Arms the timer for the nearest deadline of all idle timeouts.
+     */
+    void scheduleTimer();
+    void handleTimeout();
+    void suspend();
+    void resume();
+
     int inhibitCount = 0;
     QVector<IdleTimeoutInterface *> idleTimeouts;
+    // All idle timeouts share one timer, user activity only updates the timestamp and
+    // the timer is rearmed for later deadlines when it fires
+    QElapsedTimer clock;
+    qint64 lastActivity = 0;
+    QTimer timer;
     IdleInterface *q;
 
 protected:
@@ -35,15 +53,25 @@ class IdleTimeoutInterface : public QObject, QtWaylandServer::org_kde_kwin_idle_
 {
     Q_OBJECT
 public:
-    explicit IdleTimeoutInterface(SeatInterface *seat, IdleInterface *parent, wl_resource *resource);
+    explicit IdleTimeoutInterface(SeatInterface *seat, IdleInterfacePrivate *manager, wl_resource *resource);
     ~IdleTimeoutInterface() override;
     void setup(quint32 timeout);
     void simulateUserActivity();
 
+    /**
+     * Returns the time at which the client becomes idle unless there's user activity.
+     */
+    qint64 deadline() const;
+    bool isIdle() const;
+    void setIdle(bool idle);
+
 private:
     SeatInterface *seat;
-    IdleInterface *manager;
-    QTimer *timer = nullptr;
+    IdleInterfacePrivate *manager;
+    quint32 timeout = 0;
+    qint64 lastActivity = 0;
+    bool configured = false;
+    bool idle = false;
 
 protected:
     void org_kde_kwin_idle_timeout_destroy_resource(Resource *resource) override;
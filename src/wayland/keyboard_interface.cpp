@@ -13,15 +13,29 @@
 #include <QTemporaryFile>
 #include <QVector>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 namespace KWaylandServer
 {
+// Clients are required to map the keymap with MAP_PRIVATE since version 7
+static const int s_privateKeymapVersion = 7;
+
 KeyboardInterfacePrivate::KeyboardInterfacePrivate(SeatInterface *s)
     : seat(s)
 {
 }
 
+KeyboardInterfacePrivate::~KeyboardInterfacePrivate()
+{
+    if (sharedKeymapFd != -1) {
+        close(sharedKeymapFd);
+    }
+}
+
 void KeyboardInterfacePrivate::keyboard_release(Resource *resource)
 {
     wl_resource_destroy(resource->handle);
@@ -72,8 +86,50 @@ void KeyboardInterfacePrivate::sendEnter(SurfaceInterface *surface, quint32 seri
     }
 }
 
+void KeyboardInterfacePrivate::updateSharedKeymap()
+{
+    if (sharedKeymapFd != -1) {
+        close(sharedKeymapFd);
+        sharedKeymapFd = -1;
+    }
+#ifdef F_SEAL_SEAL // Disable memfd on systems that don't have it, like BSD < 12
+    const int fd = memfd_create("kwin-keymap", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) {
+        qCWarning(KWIN_CORE) << "Failed to create keymap memfd:" << strerror(errno);
+        return;
+    }
+    if (ftruncate(fd, keymap.size()) < 0) {
+        qCWarning(KWIN_CORE) << "Failed to resize keymap memfd:" << strerror(errno);
+        close(fd);
+        return;
+    }
+    void *address = mmap(nullptr, keymap.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        qCWarning(KWIN_CORE) << "Failed to map keymap memfd:" << strerror(errno);
+        close(fd);
+        return;
+    }
+    memcpy(address, keymap.constData(), keymap.size());
+    munmap(address, keymap.size());
+
+    // Clients can't modify the keymap that other clients see, so one file can be shared.
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+        qCWarning(KWIN_CORE) << "Failed to seal keymap memfd:" << strerror(errno);
+        close(fd);
+        return;
+    }
+    sharedKeymapFd = fd;
+#endif
+}
+
 void KeyboardInterfacePrivate::sendKeymap(Resource *resource)
 {
+    if (sharedKeymapFd != -1 && resource->version() >= s_privateKeymapVersion) {
+        send_keymap(resource->handle, keymap_format::keymap_format_xkb_v1, sharedKeymapFd, keymap.size());
+        return;
+    }
+
+    // Older clients may map the keymap writable, so they get their own copy.
     QScopedPointer<QTemporaryFile> tmp(new QTemporaryFile());
     if (!tmp->open()) {
         qCWarning(KWIN_CORE) << "Failed to create keymap file:" << tmp->errorString();
@@ -100,11 +156,12 @@ void KeyboardInterfacePrivate::sendKeymap(Resource *resource)
 
 void KeyboardInterface::setKeymap(const QByteArray &content)
 {
-    if (content.isNull()) {
+    if (content.isNull() || content == d->keymap) {
         return;
     }
 
     d->keymap = content;
+    d->updateSharedKeymap();
 
     const auto keyboardResources = d->resourceMap();
     for (KeyboardInterfacePrivate::Resource *resource : keyboardResources) {
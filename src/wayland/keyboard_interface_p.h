@@ -20,8 +20,10 @@ class KeyboardInterfacePrivate : public QtWaylandServer::wl_keyboard
 {
 public:
     KeyboardInterfacePrivate(SeatInterface *s);
+    ~KeyboardInterfacePrivate() override;
 
     void sendKeymap(Resource *resource);
+    void updateSharedKeymap();
     void sendModifiers();
     void sendModifiers(quint32 depressed, quint32 latched, quint32 locked, quint32 group, quint32 serial);
 
@@ -38,6 +40,8 @@ public:
     SurfaceInterface *focusedSurface = nullptr;
     QMetaObject::Connection destroyConnection;
     QByteArray keymap;
+    // read-only sealed copy of the keymap that is shared by all resources that map it privately
+    int sharedKeymapFd = -1;
 
     struct
     {
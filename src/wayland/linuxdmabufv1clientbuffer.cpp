@@ -18,8 +18,20 @@
 #include <QTemporaryFile>
 #include <errno.h>
 #include <fcntl.h>
+#include <linux/dma-buf.h>
+#include <poll.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 
+#ifndef DMA_BUF_IOCTL_EXPORT_SYNC_FILE
+struct dma_buf_export_sync_file
+{
+    __u32 flags;
+    __s32 fd;
+};
+#define DMA_BUF_IOCTL_EXPORT_SYNC_FILE _IOWR(DMA_BUF_BASE, 2, struct dma_buf_export_sync_file)
+#endif
+
 namespace KWaylandServer
 {
 static const int s_version = 4;
@@ -413,6 +425,32 @@ QVector<LinuxDmaBufV1Plane> LinuxDmaBufV1ClientBuffer::planes() const
     return d->planes;
 }
 
+int LinuxDmaBufV1ClientBuffer::exportWriteFence() const
+{
+    Q_D(const LinuxDmaBufV1ClientBuffer);
+    for (const LinuxDmaBufV1Plane &plane : d->planes) {
+        // a reader has to wait for the writers
+        dma_buf_export_sync_file request = {};
+        request.flags = DMA_BUF_SYNC_READ;
+        request.fd = -1;
+        int ret;
+        do {
+            ret = ioctl(plane.fd, DMA_BUF_IOCTL_EXPORT_SYNC_FILE, &request);
+        } while (ret == -1 && (errno == EINTR || errno == EAGAIN));
+        if (ret != 0) {
+            return -1;
+        }
+        pollfd pfd = {};
+        pfd.fd = request.fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 0) == 0) {
+            return request.fd;
+        }
+        close(request.fd);
+    }
+    return -1;
+}
+
 QSize LinuxDmaBufV1ClientBuffer::size() const
 {
     Q_D(const LinuxDmaBufV1ClientBuffer);
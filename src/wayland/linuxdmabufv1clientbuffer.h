@@ -51,6 +51,13 @@ public:
     quint32 flags() const;
     QVector<LinuxDmaBufV1Plane> planes() const;
 
+    /**
+     * Returns a sync_file that is signalled once the rendering to this buffer that is still in
+     * flight has finished, or @c -1 if there is no such rendering or the kernel can't export the
+     * implicit fence. The caller takes the ownership of the returned file descriptor.
+     */
+    int exportWriteFence() const;
+
     QSize size() const override;
     bool hasAlphaChannel() const override;
     Origin origin() const override;
@@ -0,0 +1,316 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "linuxdrmsyncobj_v1_interface.h"
+#include "display.h"
+#include "linuxdmabufv1clientbuffer.h"
+#include "linuxdrmsyncobj_v1_interface_p.h"
+#include "surface_interface_p.h"
+#include "utils.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <xf86drm.h>
+
+#ifndef DRM_CAP_SYNCOBJ_TIMELINE
+#define DRM_CAP_SYNCOBJ_TIMELINE 0x14
+#endif
+
+#ifndef DRM_IOCTL_SYNCOBJ_EVENTFD
+struct drm_syncobj_eventfd
+{
+    __u32 handle;
+    __u32 flags;
+    __u64 point;
+    __s32 fd;
+    __u32 pad;
+};
+#define DRM_IOCTL_SYNCOBJ_EVENTFD DRM_IOWR(0xCF, struct drm_syncobj_eventfd)
+#endif
+
+static const int s_version = 1;
+
+namespace KWaylandServer
+{
+class LinuxDrmSyncObjV1InterfacePrivate : public QtWaylandServer::wp_linux_drm_syncobj_manager_v1
+{
+public:
+    LinuxDrmSyncObjV1InterfacePrivate(Display *display, int drmFd);
+
+    const int drmFd;
+
+protected:
+    void wp_linux_drm_syncobj_manager_v1_destroy(Resource *resource) override;
+    void wp_linux_drm_syncobj_manager_v1_get_surface(Resource *resource, uint32_t id, struct ::wl_resource *surface) override;
+    void wp_linux_drm_syncobj_manager_v1_import_timeline(Resource *resource, uint32_t id, int32_t fd) override;
+};
+
+LinuxDrmSyncObjV1InterfacePrivate::LinuxDrmSyncObjV1InterfacePrivate(Display *display, int drmFd)
+    : QtWaylandServer::wp_linux_drm_syncobj_manager_v1(*display, s_version)
+    , drmFd(drmFd)
+{
+}
+
+void LinuxDrmSyncObjV1InterfacePrivate::wp_linux_drm_syncobj_manager_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void LinuxDrmSyncObjV1InterfacePrivate::wp_linux_drm_syncobj_manager_v1_get_surface(Resource *resource, uint32_t id, struct ::wl_resource *surface_resource)
+{
+    SurfaceInterface *surface = SurfaceInterface::get(surface_resource);
+    if (LinuxDrmSyncObjSurfaceV1Interface::get(surface)) {
+        wl_resource_post_error(resource->handle, error_surface_exists, "the specified surface already has a synchronization object");
+        return;
+    }
+
+    wl_resource *surfaceResource = wl_resource_create(resource->client(), &wp_linux_drm_syncobj_surface_v1_interface, resource->version(), id);
+
+    new LinuxDrmSyncObjSurfaceV1Interface(surface, surfaceResource);
+}
+
+void LinuxDrmSyncObjV1InterfacePrivate::wp_linux_drm_syncobj_manager_v1_import_timeline(Resource *resource, uint32_t id, int32_t fd)
+{
+    uint32_t handle = 0;
+    const int ret = drmSyncobjFDToHandle(drmFd, fd, &handle);
+    close(fd);
+    if (ret != 0) {
+        wl_resource_post_error(resource->handle, error_invalid_timeline, "failed to import the synchronization object");
+        return;
+    }
+
+    wl_resource *timelineResource = wl_resource_create(resource->client(), &wp_linux_drm_syncobj_timeline_v1_interface, resource->version(), id);
+
+    new LinuxDrmSyncObjTimelineV1Interface(timelineResource, drmFd, handle);
+}
+
+LinuxDrmSyncObjV1Interface::LinuxDrmSyncObjV1Interface(Display *display, int drmFd, QObject *parent)
+    : QObject(parent)
+    , d(new LinuxDrmSyncObjV1InterfacePrivate(display, drmFd))
+{
+}
+
+LinuxDrmSyncObjV1Interface::~LinuxDrmSyncObjV1Interface()
+{
+}
+
+bool LinuxDrmSyncObjV1Interface::isSupported(int drmFd)
+{
+    uint64_t capability = 0;
+    if (drmGetCap(drmFd, DRM_CAP_SYNCOBJ_TIMELINE, &capability) != 0 || capability != 1) {
+        return false;
+    }
+    // waiting with an eventfd is a lot younger than timelines themselves, so test it separately
+    uint32_t handle = 0;
+    if (drmSyncobjCreate(drmFd, 0, &handle) != 0) {
+        return false;
+    }
+    const SyncTimeline timeline(drmFd, handle);
+    const int fd = timeline.eventFd(1);
+    if (fd == -1) {
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+SyncTimeline::SyncTimeline(int drmFd, uint32_t handle)
+    : m_drmFd(drmFd)
+    , m_handle(handle)
+{
+}
+
+SyncTimeline::~SyncTimeline()
+{
+    drmSyncobjDestroy(m_drmFd, m_handle);
+}
+
+bool SyncTimeline::isSignalled(quint64 point) const
+{
+    uint32_t handle = m_handle;
+    uint64_t value = point;
+    // the timeout is absolute, so zero checks the current state without waiting
+    return drmSyncobjTimelineWait(m_drmFd, &handle, &value, 1, 0, 0, nullptr) == 0;
+}
+
+int SyncTimeline::eventFd(quint64 point) const
+{
+    const int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd == -1) {
+        return -1;
+    }
+    drm_syncobj_eventfd args = {};
+    args.handle = m_handle;
+    args.point = point;
+    args.fd = fd;
+    if (drmIoctl(m_drmFd, DRM_IOCTL_SYNCOBJ_EVENTFD, &args) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void SyncTimeline::signal(quint64 point)
+{
+    uint32_t handle = m_handle;
+    uint64_t value = point;
+    drmSyncobjTimelineSignal(m_drmFd, &handle, &value, 1);
+}
+
+bool SyncTimeline::importFence(quint64 point, int syncFileFd)
+{
+    // sync files can only be imported into binary syncobjs, transfer the fence from one
+    uint32_t binary = 0;
+    if (drmSyncobjCreate(m_drmFd, 0, &binary) != 0) {
+        return false;
+    }
+    const bool ok = drmSyncobjImportSyncFile(m_drmFd, binary, syncFileFd) == 0
+        && drmSyncobjTransfer(m_drmFd, m_handle, point, binary, 0, 0) == 0;
+    drmSyncobjDestroy(m_drmFd, binary);
+    return ok;
+}
+
+SyncReleasePoint::SyncReleasePoint(const std::shared_ptr<SyncTimeline> &timeline, quint64 point)
+    : m_timeline(timeline)
+    , m_point(point)
+{
+}
+
+SyncReleasePoint::~SyncReleasePoint()
+{
+    if (m_fence != -1) {
+        const bool imported = m_timeline->importFence(m_point, m_fence);
+        close(m_fence);
+        if (imported) {
+            return;
+        }
+    }
+    m_timeline->signal(m_point);
+}
+
+void SyncReleasePoint::setFence(int syncFileFd)
+{
+    if (m_fence != -1) {
+        close(m_fence);
+    }
+    m_fence = syncFileFd;
+}
+
+LinuxDrmSyncObjTimelineV1Interface::LinuxDrmSyncObjTimelineV1Interface(wl_resource *resource, int drmFd, uint32_t handle)
+    : QtWaylandServer::wp_linux_drm_syncobj_timeline_v1(resource)
+    , timeline(std::make_shared<SyncTimeline>(drmFd, handle))
+{
+}
+
+LinuxDrmSyncObjTimelineV1Interface *LinuxDrmSyncObjTimelineV1Interface::get(wl_resource *resource)
+{
+    return resource_cast<LinuxDrmSyncObjTimelineV1Interface *>(resource);
+}
+
+void LinuxDrmSyncObjTimelineV1Interface::wp_linux_drm_syncobj_timeline_v1_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource)
+    delete this;
+}
+
+void LinuxDrmSyncObjTimelineV1Interface::wp_linux_drm_syncobj_timeline_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+LinuxDrmSyncObjSurfaceV1Interface::LinuxDrmSyncObjSurfaceV1Interface(SurfaceInterface *surface, wl_resource *resource)
+    : QtWaylandServer::wp_linux_drm_syncobj_surface_v1(resource)
+    , surface(surface)
+{
+    SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+    surfacePrivate->syncObjSurface = this;
+}
+
+LinuxDrmSyncObjSurfaceV1Interface::~LinuxDrmSyncObjSurfaceV1Interface()
+{
+    if (surface) {
+        SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+        surfacePrivate->syncObjSurface = nullptr;
+    }
+}
+
+LinuxDrmSyncObjSurfaceV1Interface *LinuxDrmSyncObjSurfaceV1Interface::get(SurfaceInterface *surface)
+{
+    return SurfaceInterfacePrivate::get(surface)->syncObjSurface;
+}
+
+bool LinuxDrmSyncObjSurfaceV1Interface::validate(const SurfaceState &state)
+{
+    const auto &sync = state.explicitSync;
+    if (!state.bufferIsSet || !state.buffer) {
+        if (sync.acquireTimeline || sync.releaseTimeline) {
+            wl_resource_post_error(resource()->handle, error_no_buffer, "synchronization points were set without a buffer");
+            return false;
+        }
+        return true;
+    }
+    if (!qobject_cast<LinuxDmaBufV1ClientBuffer *>(state.buffer)) {
+        wl_resource_post_error(resource()->handle, error_unsupported_buffer, "only linux-dmabuf buffers support explicit synchronization");
+        return false;
+    }
+    if (!sync.acquireTimeline) {
+        wl_resource_post_error(resource()->handle, error_no_acquire_point, "a buffer was attached without an acquire point");
+        return false;
+    }
+    if (!sync.releaseTimeline) {
+        wl_resource_post_error(resource()->handle, error_no_release_point, "a buffer was attached without a release point");
+        return false;
+    }
+    if (sync.acquireTimeline == sync.releaseTimeline && sync.acquirePoint >= sync.releasePoint) {
+        wl_resource_post_error(resource()->handle, error_conflicting_points, "the acquire point must be smaller than the release point");
+        return false;
+    }
+    return true;
+}
+
+void LinuxDrmSyncObjSurfaceV1Interface::wp_linux_drm_syncobj_surface_v1_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource)
+    delete this;
+}
+
+void LinuxDrmSyncObjSurfaceV1Interface::wp_linux_drm_syncobj_surface_v1_destroy(Resource *resource)
+{
+    if (surface) {
+        SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+        surfacePrivate->pending.explicitSync.acquireTimeline.reset();
+        surfacePrivate->pending.explicitSync.releaseTimeline.reset();
+    }
+
+    wl_resource_destroy(resource->handle);
+}
+
+void LinuxDrmSyncObjSurfaceV1Interface::wp_linux_drm_syncobj_surface_v1_set_acquire_point(Resource *resource, struct ::wl_resource *timeline_resource, uint32_t point_hi, uint32_t point_lo)
+{
+    if (!surface) {
+        wl_resource_post_error(resource->handle, error_no_surface, "the surface has been destroyed");
+        return;
+    }
+
+    SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+    surfacePrivate->pending.explicitSync.acquireTimeline = LinuxDrmSyncObjTimelineV1Interface::get(timeline_resource)->timeline;
+    surfacePrivate->pending.explicitSync.acquirePoint = (quint64(point_hi) << 32) | point_lo;
+}
+
+void LinuxDrmSyncObjSurfaceV1Interface::wp_linux_drm_syncobj_surface_v1_set_release_point(Resource *resource, struct ::wl_resource *timeline_resource, uint32_t point_hi, uint32_t point_lo)
+{
+    if (!surface) {
+        wl_resource_post_error(resource->handle, error_no_surface, "the surface has been destroyed");
+        return;
+    }
+
+    SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+    surfacePrivate->pending.explicitSync.releaseTimeline = LinuxDrmSyncObjTimelineV1Interface::get(timeline_resource)->timeline;
+    surfacePrivate->pending.explicitSync.releasePoint = (quint64(point_hi) << 32) | point_lo;
+}
+
+} // namespace KWaylandServer
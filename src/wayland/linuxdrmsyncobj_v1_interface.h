@@ -0,0 +1,52 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QObject>
+
+namespace KWaylandServer
+{
+class Display;
+class LinuxDrmSyncObjV1InterfacePrivate;
+
+/**
+ * The LinuxDrmSyncObjV1Interface is an extension that allows clients to synchronize the
+ * access to their buffers explicitly with DRM timeline synchronization objects.
+ *
+ * A buffer committed with an acquire point is applied to the surface only after the
+ * acquire point has been signalled, until then the surface keeps showing its previous
+ * buffer. The release point is signalled as soon as the compositor doesn't reference
+ * the buffer anymore.
+ *
+ * LinuxDrmSyncObjV1Interface corresponds to the Wayland interface @c wp_linux_drm_syncobj_manager_v1.
+ */
+class KWIN_EXPORT LinuxDrmSyncObjV1Interface : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Creates the extension. The synchronization objects are imported into the DRM device
+     * @a drmFd, which must stay valid as long as this object exists.
+     */
+    explicit LinuxDrmSyncObjV1Interface(Display *display, int drmFd, QObject *parent = nullptr);
+    ~LinuxDrmSyncObjV1Interface() override;
+
+    /**
+     * Returns @c true if the DRM device @a drmFd supports timeline synchronization objects
+     * and waiting for them with an eventfd.
+     */
+    static bool isSupported(int drmFd);
+
+private:
+    QScopedPointer<LinuxDrmSyncObjV1InterfacePrivate> d;
+};
+
+} // namespace KWaylandServer
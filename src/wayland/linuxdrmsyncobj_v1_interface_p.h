@@ -0,0 +1,117 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#pragma once
+
+#include "qwayland-server-linux-drm-syncobj-v1.h"
+
+#include <QPointer>
+
+#include <memory>
+
+namespace KWaylandServer
+{
+class SurfaceInterface;
+struct SurfaceState;
+
+/**
+ * The SyncTimeline class wraps a DRM timeline synchronization object imported from a client.
+ */
+class SyncTimeline
+{
+public:
+    SyncTimeline(int drmFd, uint32_t handle);
+    ~SyncTimeline();
+
+    /**
+     * Returns @c true if the given @a point has been signalled already.
+     */
+    bool isSignalled(quint64 point) const;
+
+    /**
+     * Returns an eventfd that becomes readable when the given @a point is signalled, or
+     * @c -1 on failure. The caller takes the ownership of the file descriptor.
+     */
+    int eventFd(quint64 point) const;
+
+    void signal(quint64 point);
+
+    /**
+     * Makes the given @a point signalled once the sync file @a syncFileFd signals. Returns
+     * @c false on failure. The ownership of the file descriptor is not transferred.
+     */
+    bool importFence(quint64 point, int syncFileFd);
+
+private:
+    const int m_drmFd;
+    const uint32_t m_handle;
+};
+
+/**
+ * The SyncReleasePoint class releases a timeline point when it's destroyed. It's attached to
+ * the client buffer that the point belongs to, and destroyed once the buffer is released.
+ *
+ * If the buffer has been read by the GPU, the fence of the last frame that used it is imported
+ * into the point so that the client doesn't reuse the buffer while rendering is still in flight.
+ * Otherwise the point is signalled directly.
+ */
+class SyncReleasePoint
+{
+public:
+    SyncReleasePoint(const std::shared_ptr<SyncTimeline> &timeline, quint64 point);
+    ~SyncReleasePoint();
+
+    /**
+     * Sets the sync file that has to signal before the point is released. The release point
+     * takes the ownership of @a syncFileFd and closes the previously set one, if any.
+     */
+    void setFence(int syncFileFd);
+
+private:
+    const std::shared_ptr<SyncTimeline> m_timeline;
+    const quint64 m_point;
+    int m_fence = -1;
+};
+
+class LinuxDrmSyncObjTimelineV1Interface : public QtWaylandServer::wp_linux_drm_syncobj_timeline_v1
+{
+public:
+    LinuxDrmSyncObjTimelineV1Interface(wl_resource *resource, int drmFd, uint32_t handle);
+
+    static LinuxDrmSyncObjTimelineV1Interface *get(wl_resource *resource);
+
+    const std::shared_ptr<SyncTimeline> timeline;
+
+protected:
+    void wp_linux_drm_syncobj_timeline_v1_destroy_resource(Resource *resource) override;
+    void wp_linux_drm_syncobj_timeline_v1_destroy(Resource *resource) override;
+};
+
+class LinuxDrmSyncObjSurfaceV1Interface : public QtWaylandServer::wp_linux_drm_syncobj_surface_v1
+{
+public:
+    LinuxDrmSyncObjSurfaceV1Interface(SurfaceInterface *surface, wl_resource *resource);
+    ~LinuxDrmSyncObjSurfaceV1Interface() override;
+
+    static LinuxDrmSyncObjSurfaceV1Interface *get(SurfaceInterface *surface);
+
+    /**
+     * Checks the synchronization points of the given pending @a state. Returns @c false
+     * and posts a protocol error if they don't match the attached buffer.
+     */
+    bool validate(const SurfaceState &state);
+
+    QPointer<SurfaceInterface> surface;
+
+protected:
+    void wp_linux_drm_syncobj_surface_v1_destroy_resource(Resource *resource) override;
+    void wp_linux_drm_syncobj_surface_v1_destroy(Resource *resource) override;
+    void wp_linux_drm_syncobj_surface_v1_set_acquire_point(Resource *resource, struct ::wl_resource *timeline, uint32_t point_hi, uint32_t point_lo) override;
+    void wp_linux_drm_syncobj_surface_v1_set_release_point(Resource *resource, struct ::wl_resource *timeline, uint32_t point_hi, uint32_t point_lo) override;
+};
+
+} // namespace KWaylandServer
@@ -143,6 +143,11 @@ void PlasmaVirtualDesktopManagementInterface::setRows(quint32 rows)
     }
 }
 
+quint32 PlasmaVirtualDesktopManagementInterface::rows() const
+{
+    return d->rows;
+}
+
 PlasmaVirtualDesktopInterface *PlasmaVirtualDesktopManagementInterface::desktop(const QString &id)
 {
     auto i = d->constFindDesktop(id);
@@ -33,6 +33,7 @@ public:
      * Sets how many rows the virtual desktops should be laid into
      */
     void setRows(quint32 rows);
+    quint32 rows() const;
 
     /**
      * @returns A desktop identified uniquely by this id.
@@ -9,11 +9,16 @@
 #include "surface_interface.h"
 #include "utils/common.h"
 
+#include <QDataStream>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFuture>
 #include <QHash>
 #include <QIcon>
 #include <QList>
 #include <QRect>
+#include <QSharedPointer>
+#include <QTimer>
 #include <QUuid>
 #include <QVector>
 #include <QtConcurrentRun>
@@ -24,6 +29,8 @@ namespace KWaylandServer
 {
 static const quint32 s_version = 14;
 static const quint32 s_activationVersion = 1;
+// The minimum interval between two title updates of a window, in milliseconds
+static const int s_titleUpdateInterval = 100;
 
 class PlasmaWindowManagementInterfacePrivate : public QtWaylandServer::org_kde_plasma_window_management
 {
@@ -35,6 +42,8 @@ public:
     void sendStackingOrderChanged(wl_resource *resource);
     void sendStackingOrderUuidsChanged();
     void sendStackingOrderUuidsChanged(wl_resource *resource);
+    void scheduleStackingOrderUpdate(bool uuids);
+    void flushStackingOrder();
 
     PlasmaWindowManagementInterface::ShowingDesktopState state = PlasmaWindowManagementInterface::ShowingDesktopState::Disabled;
     QList<PlasmaWindowInterface *> windows;
@@ -42,6 +51,11 @@ public:
     quint32 windowIdCounter = 0;
     QVector<quint32> stackingOrder;
     QVector<QString> stackingOrderUuids;
+    // The protocol only has whole stacking order events, so several restacks in the
+    // same event loop iteration are sent as one
+    QTimer stackingOrderTimer;
+    bool stackingOrderPending = false;
+    bool stackingOrderUuidsPending = false;
     PlasmaWindowManagementInterface *q;
 
 protected:
@@ -70,6 +84,15 @@ public:
     void setResourceName(const QString &resourceName);
     wl_resource *resourceForParent(PlasmaWindowInterface *parent, Resource *child) const;
 
+    enum PendingChange {
+        TitleChange = 0x1,
+        StateChange = 0x2,
+        GeometryChange = 0x4,
+        IconChange = 0x8,
+    };
+    void scheduleUpdate(PendingChange change);
+    void flushPendingChanges();
+
     quint32 windowId = 0;
     QHash<SurfaceInterface *, QRect> minimizedGeometries;
     PlasmaWindowManagementInterface *wm;
@@ -88,10 +111,18 @@ public:
     QString m_appServiceName;
     QString m_appObjectPath;
     QIcon m_icon;
+    // The serialized m_icon, shared by all get_icon requests until the icon changes
+    QSharedPointer<QFuture<QByteArray>> m_iconData;
     quint32 m_state = 0;
     QString uuid;
     QString m_resourceName;
 
+    // Frequently changing properties are sent at most once per event loop iteration,
+    // the title at most once per s_titleUpdateInterval
+    QTimer updateTimer;
+    uint pendingChanges = 0;
+    QElapsedTimer lastTitleUpdate;
+
 protected:
     void org_kde_plasma_window_bind_resource(Resource *resource) override;
     void org_kde_plasma_window_set_state(Resource *resource, uint32_t flags, uint32_t state) override;
@@ -115,6 +146,10 @@ PlasmaWindowManagementInterfacePrivate::PlasmaWindowManagementInterfacePrivate(P
     : QtWaylandServer::org_kde_plasma_window_management(*display, s_version)
     , q(_q)
 {
+    stackingOrderTimer.setSingleShot(true);
+    QObject::connect(&stackingOrderTimer, &QTimer::timeout, q, [this]() {
+        flushStackingOrder();
+    });
 }
 
 void PlasmaWindowManagementInterfacePrivate::sendShowingDesktopState()
@@ -159,6 +194,30 @@ void PlasmaWindowManagementInterfacePrivate::sendStackingOrderChanged(wl_resourc
     send_stacking_order_changed(r, QByteArray::fromRawData(reinterpret_cast<const char *>(stackingOrder.constData()), sizeof(uint32_t) * stackingOrder.size()));
 }
 
+void PlasmaWindowManagementInterfacePrivate::scheduleStackingOrderUpdate(bool uuids)
+{
+    if (uuids) {
+        stackingOrderUuidsPending = true;
+    } else {
+        stackingOrderPending = true;
+    }
+    if (!stackingOrderTimer.isActive()) {
+        stackingOrderTimer.start(0);
+    }
+}
+
+void PlasmaWindowManagementInterfacePrivate::flushStackingOrder()
+{
+    if (stackingOrderPending) {
+        stackingOrderPending = false;
+        sendStackingOrderChanged();
+    }
+    if (stackingOrderUuidsPending) {
+        stackingOrderUuidsPending = false;
+        sendStackingOrderUuidsChanged();
+    }
+}
+
 void PlasmaWindowManagementInterfacePrivate::sendStackingOrderUuidsChanged()
 {
     const auto clientResources = resourceMap();
@@ -294,7 +353,7 @@ void PlasmaWindowManagementInterface::setStackingOrder(const QVector<quint32> &s
         return;
     }
     d->stackingOrder = stackingOrder;
-    d->sendStackingOrderChanged();
+    d->scheduleStackingOrderUpdate(false);
 }
 
 void PlasmaWindowManagementInterface::setStackingOrderUuids(const QVector<QString> &stackingOrderUuids)
@@ -303,7 +362,7 @@ void PlasmaWindowManagementInterface::setStackingOrderUuids(const QVector<QStrin
         return;
     }
     d->stackingOrderUuids = stackingOrderUuids;
-    d->sendStackingOrderUuidsChanged();
+    d->scheduleStackingOrderUpdate(true);
 }
 
 void PlasmaWindowManagementInterface::setPlasmaVirtualDesktopManagementInterface(PlasmaVirtualDesktopManagementInterface *manager)
@@ -325,6 +384,10 @@ PlasmaWindowInterfacePrivate::PlasmaWindowInterfacePrivate(PlasmaWindowManagemen
     , wm(wm)
     , q(q)
 {
+    updateTimer.setSingleShot(true);
+    QObject::connect(&updateTimer, &QTimer::timeout, q, [this]() {
+        flushPendingChanges();
+    });
 }
 
 PlasmaWindowInterfacePrivate::~PlasmaWindowInterfacePrivate()
@@ -427,14 +490,9 @@ void PlasmaWindowInterfacePrivate::setThemedIconName(const QString &iconName)
 void PlasmaWindowInterfacePrivate::setIcon(const QIcon &icon)
 {
     m_icon = icon;
+    m_iconData.reset();
     setThemedIconName(m_icon.name());
-
-    const auto clientResources = resourceMap();
-    for (auto resource : clientResources) {
-        if (resource->version() >= ORG_KDE_PLASMA_WINDOW_ICON_CHANGED_SINCE_VERSION) {
-            send_icon_changed(resource->handle);
-        }
-    }
+    scheduleUpdate(IconChange);
 }
 
 void PlasmaWindowInterfacePrivate::setResourceName(const QString &resourceName)
@@ -452,18 +510,56 @@ void PlasmaWindowInterfacePrivate::setResourceName(const QString &resourceName)
     }
 }
 
+/**
+ * Returns the serialized @a icon. Serializing renders every pixmap of the icon, so it's done
+ * only once in a worker thread and the result is shared by all windows showing the same icon,
+ * e.g. the windows of one application, as long as any of them still references it.
+ */
+static QSharedPointer<QFuture<QByteArray>> serializedIcon(const QIcon &icon)
+{
+    static QHash<QString, QWeakPointer<QFuture<QByteArray>>> cache;
+
+    // Themed icons are looked up anew for every window, but they have the same pixmaps
+    const QString key = icon.name().isEmpty() ? QString::number(icon.cacheKey()) : icon.name();
+    if (const QSharedPointer<QFuture<QByteArray>> data = cache.value(key).toStrongRef()) {
+        return data;
+    }
+
+    for (auto it = cache.begin(); it != cache.end();) {
+        if (it->isNull()) {
+            it = cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    auto data = QSharedPointer<QFuture<QByteArray>>::create(QtConcurrent::run(
+        [](const QIcon &icon) {
+            QByteArray data;
+            QDataStream ds(&data, QIODevice::WriteOnly);
+            ds << icon;
+            return data;
+        },
+        icon));
+    cache.insert(key, data);
+    return data;
+}
+
 void PlasmaWindowInterfacePrivate::org_kde_plasma_window_get_icon(Resource *resource, int32_t fd)
 {
     Q_UNUSED(resource)
+    if (!m_iconData) {
+        m_iconData = serializedIcon(m_icon);
+    }
+    // The serialization has been queued first, so it's running or done when this runs
     QtConcurrent::run(
-        [fd](const QIcon &icon) {
+        [fd](const QFuture<QByteArray> &data) {
             QFile file;
             file.open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle);
-            QDataStream ds(&file);
-            ds << icon;
+            file.write(data.result());
             file.close();
         },
-        m_icon);
+        *m_iconData);
 }
 
 void PlasmaWindowInterfacePrivate::org_kde_plasma_window_request_enter_virtual_desktop(Resource *resource, const QString &id)
@@ -508,10 +604,50 @@ void PlasmaWindowInterfacePrivate::setTitle(const QString &title)
         return;
     }
     m_title = title;
-    const auto clientResources = resourceMap();
+    scheduleUpdate(TitleChange);
+}
 
+void PlasmaWindowInterfacePrivate::scheduleUpdate(PendingChange change)
+{
+    pendingChanges |= change;
+    // Only the title waits for the rate limit, other changes go out right away
+    if (!updateTimer.isActive() || (change != TitleChange && updateTimer.remainingTime() > 0)) {
+        updateTimer.start(0);
+    }
+}
+
+void PlasmaWindowInterfacePrivate::flushPendingChanges()
+{
+    if (unmapped) {
+        pendingChanges = 0;
+        return;
+    }
+
+    // Hold back the title if the last one has been sent too recently
+    uint changes = pendingChanges;
+    if ((changes & TitleChange) && lastTitleUpdate.isValid() && !lastTitleUpdate.hasExpired(s_titleUpdateInterval)) {
+        changes &= ~TitleChange;
+        updateTimer.start(s_titleUpdateInterval - lastTitleUpdate.elapsed());
+    }
+    pendingChanges &= ~changes;
+    if (changes & TitleChange) {
+        lastTitleUpdate.start();
+    }
+
+    const auto clientResources = resourceMap();
     for (auto resource : clientResources) {
-        send_title_changed(resource->handle, m_title);
+        if (changes & TitleChange) {
+            send_title_changed(resource->handle, m_title);
+        }
+        if (changes & StateChange) {
+            send_state_changed(resource->handle, m_state);
+        }
+        if ((changes & GeometryChange) && geometry.isValid() && resource->version() >= ORG_KDE_PLASMA_WINDOW_GEOMETRY_SINCE_VERSION) {
+            send_geometry(resource->handle, geometry.x(), geometry.y(), geometry.width(), geometry.height());
+        }
+        if ((changes & IconChange) && resource->version() >= ORG_KDE_PLASMA_WINDOW_ICON_CHANGED_SINCE_VERSION) {
+            send_icon_changed(resource->handle);
+        }
     }
 }
 
@@ -521,6 +657,8 @@ void PlasmaWindowInterfacePrivate::unmap()
         return;
     }
     unmapped = true;
+    pendingChanges = 0;
+    updateTimer.stop();
     const auto clientResources = resourceMap();
 
     for (auto resource : clientResources) {
@@ -540,11 +678,7 @@ void PlasmaWindowInterfacePrivate::setState(org_kde_plasma_window_management_sta
         return;
     }
     m_state = newState;
-    const auto clientResources = resourceMap();
-
-    for (auto resource : clientResources) {
-        send_state_changed(resource->handle, m_state);
-    }
+    scheduleUpdate(StateChange);
 }
 
 wl_resource *PlasmaWindowInterfacePrivate::resourceForParent(PlasmaWindowInterface *parent, Resource *child) const
@@ -596,14 +730,7 @@ void PlasmaWindowInterfacePrivate::setGeometry(const QRect &geo)
     if (!geometry.isValid()) {
         return;
     }
-
-    const auto clientResources = resourceMap();
-    for (auto resource : clientResources) {
-        if (resource->version() < ORG_KDE_PLASMA_WINDOW_GEOMETRY_SINCE_VERSION) {
-            continue;
-        }
-        send_geometry(resource->handle, geometry.x(), geometry.y(), geometry.width(), geometry.height());
-    }
+    scheduleUpdate(GeometryChange);
 }
 
 void PlasmaWindowInterfacePrivate::setApplicationMenuPaths(const QString &service, const QString &object)
@@ -0,0 +1,142 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "presentationtime_interface.h"
+#include "clientconnection.h"
+#include "display.h"
+#include "output_interface.h"
+#include "surface_interface_p.h"
+
+#include "qwayland-server-presentation-time.h"
+
+#include <ctime>
+
+static const int s_version = 1;
+
+namespace KWaylandServer
+{
+class PresentationTimeInterfacePrivate : public QtWaylandServer::wp_presentation
+{
+public:
+    explicit PresentationTimeInterfacePrivate(Display *display);
+
+protected:
+    void wp_presentation_bind_resource(Resource *resource) override;
+    void wp_presentation_destroy(Resource *resource) override;
+    void wp_presentation_feedback(Resource *resource, struct ::wl_resource *surface, uint32_t callback) override;
+};
+
+PresentationTimeInterfacePrivate::PresentationTimeInterfacePrivate(Display *display)
+    : QtWaylandServer::wp_presentation(*display, s_version)
+{
+}
+
+void PresentationTimeInterfacePrivate::wp_presentation_bind_resource(Resource *resource)
+{
+    // All presentation timestamps in KWin are sourced from the monotonic clock.
+    send_clock_id(resource->handle, CLOCK_MONOTONIC);
+}
+
+void PresentationTimeInterfacePrivate::wp_presentation_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void PresentationTimeInterfacePrivate::wp_presentation_feedback(Resource *resource, struct ::wl_resource *surface_resource, uint32_t callback)
+{
+    SurfaceInterface *surface = SurfaceInterface::get(surface_resource);
+    SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+
+    wl_resource *feedbackResource = wl_resource_create(resource->client(), &wp_presentation_feedback_interface, resource->version(), callback);
+    if (!feedbackResource) {
+        wl_resource_post_no_memory(resource->handle);
+        return;
+    }
+
+    wl_resource_set_implementation(feedbackResource, nullptr, nullptr, [](wl_resource *resource) {
+        wl_list_remove(wl_resource_get_link(resource));
+    });
+
+    wl_list_insert(surfacePrivate->pending.presentationFeedbacks.prev, wl_resource_get_link(feedbackResource));
+}
+
+PresentationTimeInterface::PresentationTimeInterface(Display *display, QObject *parent)
+    : QObject(parent)
+    , d(new PresentationTimeInterfacePrivate(display))
+{
+}
+
+PresentationTimeInterface::~PresentationTimeInterface()
+{
+}
+
+PresentationFeedback::PresentationFeedback(ClientConnection *client, OutputInterface *output, wl_list *resources)
+    : m_resources(new wl_list)
+    , m_client(client)
+    , m_output(output)
+{
+    wl_list_init(m_resources.data());
+    wl_list_insert_list(m_resources.data(), resources);
+    wl_list_init(resources);
+}
+
+PresentationFeedback::~PresentationFeedback()
+{
+    discarded();
+}
+
+void PresentationFeedback::setZeroCopy(bool zeroCopy)
+{
+    m_zeroCopy = zeroCopy;
+}
+
+void PresentationFeedback::presented(std::chrono::nanoseconds timestamp, std::chrono::nanoseconds refreshDuration, quint64 sequence, Kinds kinds)
+{
+    if (!m_zeroCopy) {
+        kinds.setFlag(Kind::ZeroCopy, false);
+    }
+    const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timestamp);
+    const auto nanoseconds = timestamp - seconds;
+    const quint64 secondsCount = seconds.count();
+
+    QVector<wl_resource *> outputResources;
+    if (m_client && m_output) {
+        outputResources = m_output->clientResources(m_client);
+    }
+
+    wl_resource *resource;
+    wl_resource *tmp;
+    wl_resource_for_each_safe (resource, tmp, m_resources.data()) {
+        for (wl_resource *outputResource : qAsConst(outputResources)) {
+            wp_presentation_feedback_send_sync_output(resource, outputResource);
+        }
+        wp_presentation_feedback_send_presented(resource,
+                                                secondsCount >> 32, secondsCount & 0xffffffff,
+                                                nanoseconds.count(),
+                                                refreshDuration.count(),
+                                                sequence >> 32, sequence & 0xffffffff,
+                                                static_cast<uint32_t>(kinds));
+        wl_resource_destroy(resource);
+    }
+}
+
+void PresentationFeedback::discarded()
+{
+    discard(m_resources.data());
+}
+
+void PresentationFeedback::discard(wl_list *resources)
+{
+    wl_resource *resource;
+    wl_resource *tmp;
+    wl_resource_for_each_safe (resource, tmp, resources) {
+        wp_presentation_feedback_send_discarded(resource);
+        wl_resource_destroy(resource);
+    }
+}
+
+} // namespace KWaylandServer
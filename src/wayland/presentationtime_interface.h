@@ -0,0 +1,104 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QObject>
+#include <QPointer>
+
+#include <chrono>
+
+struct wl_list;
+
+namespace KWaylandServer
+{
+class ClientConnection;
+class Display;
+class OutputInterface;
+class PresentationTimeInterfacePrivate;
+
+/**
+ * The PresentationTimeInterface is an extension that lets clients find out when exactly
+ * their surface updates have been shown on the screen.
+ *
+ * PresentationTimeInterface corresponds to the Wayland interface @c wp_presentation.
+ */
+class KWIN_EXPORT PresentationTimeInterface : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PresentationTimeInterface(Display *display, QObject *parent = nullptr);
+    ~PresentationTimeInterface() override;
+
+private:
+    QScopedPointer<PresentationTimeInterfacePrivate> d;
+};
+
+/**
+ * The PresentationFeedback class holds the presentation feedback requests of a surface tree
+ * for the frame that is being shown on an output.
+ *
+ * The feedback is sent when presented() is called. If the PresentationFeedback is destroyed
+ * before that, the clients are told that their content has been discarded.
+ *
+ * @see SurfaceInterface::takePresentationFeedback
+ */
+class KWIN_EXPORT PresentationFeedback
+{
+public:
+    enum class Kind {
+        Vsync = 0x1,
+        HwClock = 0x2,
+        HwCompletion = 0x4,
+        ZeroCopy = 0x8,
+    };
+    Q_DECLARE_FLAGS(Kinds, Kind)
+
+    /**
+     * Takes over the feedback resources in @a resources, the list is empty afterwards.
+     */
+    PresentationFeedback(ClientConnection *client, OutputInterface *output, wl_list *resources);
+    ~PresentationFeedback();
+
+    /**
+     * Sends the presented event. The @a timestamp is sourced from the monotonic clock, the
+     * @a refreshDuration is zero if the output doesn't refresh at a constant rate and the
+     * @a sequence is zero if the output has no vertical retrace counter.
+     */
+    void presented(std::chrono::nanoseconds timestamp, std::chrono::nanoseconds refreshDuration, quint64 sequence, Kinds kinds);
+
+    /**
+     * Sets whether the buffers of the surfaces were shown without being copied. If not, the
+     * zero_copy flag is never sent, regardless of the kinds that are passed to presented().
+     */
+    void setZeroCopy(bool zeroCopy);
+
+    /**
+     * Sends the discarded event.
+     */
+    void discarded();
+
+    /**
+     * Sends the discarded event to all feedback resources in the specified list.
+     */
+    static void discard(wl_list *resources);
+
+private:
+    QScopedPointer<wl_list> m_resources;
+    QPointer<ClientConnection> m_client;
+    QPointer<OutputInterface> m_output;
+    bool m_zeroCopy = false;
+
+    Q_DISABLE_COPY(PresentationFeedback)
+};
+
+} // namespace KWaylandServer
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(KWaylandServer::PresentationFeedback::Kinds)
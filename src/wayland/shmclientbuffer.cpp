@@ -11,10 +11,80 @@
 #include <wayland-server-core.h>
 #include <wayland-server-protocol.h>
 
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 namespace KWaylandServer
 {
-static const ShmClientBuffer *s_accessedBuffer = nullptr;
-static int s_accessCounter = 0;
+/**
+ * A range of shared memory that is currently being accessed by the compositor.
+ *
+ * wl_shm_buffer_begin_access() can protect only one pool per thread, so the compositor
+ * installs its own SIGBUS handler, which looks up the faulting address in the list of
+ * accessed ranges of the faulting thread.
+ */
+struct ShmAccess
+{
+    const uchar *data = nullptr;
+    size_t size = 0;
+    int count = 0;
+    volatile sig_atomic_t faulted = 0;
+    ShmAccess *next = nullptr;
+};
+
+static thread_local ShmAccess *s_accessList = nullptr;
+static struct sigaction s_oldSigbusAction;
+static uintptr_t s_pageSize = 0;
+
+static void reraiseSigbus()
+{
+    sigaction(SIGBUS, &s_oldSigbusAction, nullptr);
+    raise(SIGBUS);
+}
+
+static void sigbusHandler(int signum, siginfo_t *info, void *context)
+{
+    Q_UNUSED(signum)
+    Q_UNUSED(context)
+
+    const uchar *address = static_cast<const uchar *>(info->si_addr);
+    for (ShmAccess *access = s_accessList; access; access = access->next) {
+        if (address < access->data || address >= access->data + access->size) {
+            continue;
+        }
+
+        // The client has truncated the file, replace the pages with anonymous memory so the
+        // compositor can carry on reading. The client will be disconnected afterwards.
+        const uintptr_t begin = reinterpret_cast<uintptr_t>(access->data) & ~(s_pageSize - 1);
+        const uintptr_t end = (reinterpret_cast<uintptr_t>(access->data) + access->size + s_pageSize - 1) & ~(s_pageSize - 1);
+        if (mmap(reinterpret_cast<void *>(begin), end - begin, PROT_READ | PROT_WRITE, MAP_FIXED | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) == MAP_FAILED) {
+            reraiseSigbus();
+            return;
+        }
+        access->faulted = 1;
+        return;
+    }
+
+    reraiseSigbus();
+}
+
+static void installSigbusHandler()
+{
+    static bool installed = false;
+    if (installed) {
+        return;
+    }
+    installed = true;
+
+    s_pageSize = sysconf(_SC_PAGESIZE);
+
+    struct sigaction action;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    action.sa_sigaction = sigbusHandler;
+    sigaction(SIGBUS, &action, &s_oldSigbusAction);
+}
 
 class ShmClientBufferPrivate : public ClientBufferPrivate
 {
@@ -23,12 +93,16 @@ public:
 
     static void buffer_destroy_callback(wl_listener *listener, void *data);
 
+    void beginAccess(const uchar *data, size_t size);
+    void endAccess();
+
     ShmClientBuffer *q;
     QImage::Format format = QImage::Format_Invalid;
     uint32_t width = 0;
     uint32_t height = 0;
     bool hasAlphaChannel = false;
     QImage savedData;
+    ShmAccess access;
 
     struct DestroyListener
     {
@@ -146,30 +220,55 @@ ClientBuffer::Origin ShmClientBuffer::origin() const
     return Origin::TopLeft;
 }
 
-static void cleanupShmData(void *bufferHandle)
+void ShmClientBufferPrivate::beginAccess(const uchar *data, size_t size)
 {
-    Q_ASSERT_X(s_accessCounter > 0, "cleanup", "access counter must be positive");
-    s_accessCounter--;
-    if (s_accessCounter == 0) {
-        s_accessedBuffer = nullptr;
+    if (access.count++ > 0) {
+        return;
     }
-    wl_shm_buffer_end_access(static_cast<wl_shm_buffer *>(bufferHandle));
+
+    access.data = data;
+    access.size = size;
+    access.faulted = 0;
+    access.next = s_accessList;
+    s_accessList = &access;
 }
 
-QImage ShmClientBuffer::data() const
+void ShmClientBufferPrivate::endAccess()
 {
-    if (s_accessedBuffer && s_accessedBuffer != this) {
-        return QImage();
+    Q_ASSERT_X(access.count > 0, "endAccess", "access counter must be positive");
+    if (--access.count > 0) {
+        return;
+    }
+
+    for (ShmAccess **link = &s_accessList; *link; link = &(*link)->next) {
+        if (*link == &access) {
+            *link = access.next;
+            break;
+        }
     }
+    access.next = nullptr;
 
+    if (access.faulted) {
+        if (wl_resource *resource = q->resource()) {
+            wl_resource_post_error(resource, WL_SHM_ERROR_INVALID_FD, "error accessing SHM buffer");
+        }
+    }
+}
+
+static void cleanupShmData(void *bufferPrivate)
+{
+    static_cast<ShmClientBufferPrivate *>(bufferPrivate)->endAccess();
+}
+
+QImage ShmClientBuffer::data() const
+{
     Q_D(const ShmClientBuffer);
     if (wl_shm_buffer *buffer = wl_shm_buffer_get(resource())) {
-        s_accessedBuffer = this;
-        s_accessCounter++;
-        wl_shm_buffer_begin_access(buffer);
         const uchar *data = static_cast<const uchar *>(wl_shm_buffer_get_data(buffer));
         const uint32_t stride = wl_shm_buffer_get_stride(buffer);
-        return QImage(data, d->width, d->height, stride, d->format, cleanupShmData, buffer);
+        auto bufferPrivate = const_cast<ShmClientBufferPrivate *>(d);
+        bufferPrivate->beginAccess(data, size_t(stride) * d->height);
+        return QImage(data, d->width, d->height, stride, d->format, cleanupShmData, bufferPrivate);
     }
     return d->savedData;
 }
@@ -186,6 +285,7 @@ ShmClientBufferIntegration::ShmClientBufferIntegration(Display *display)
     wl_display_add_shm_format(*display, WL_SHM_FORMAT_XBGR16161616);
 #endif
     wl_display_init_shm(*display);
+    installSigbusHandler();
 }
 
 ClientBuffer *ShmClientBufferIntegration::createBuffer(::wl_resource *resource)
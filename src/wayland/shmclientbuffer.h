@@ -16,8 +16,9 @@ class ShmClientBufferPrivate;
 /**
  * The ShmClientBuffer class represents a wl_shm_buffer client buffer.
  *
- * The buffer's data can be accessed using the data() function. Note that it is not allowed
- * to access data of several shared memory buffers simultaneously.
+ * The buffer's data can be accessed using the data() function. Several shared memory buffers
+ * can be accessed simultaneously, but the returned image must be released on the same thread
+ * where it has been obtained.
  */
 class KWIN_EXPORT ShmClientBuffer : public ClientBuffer
 {
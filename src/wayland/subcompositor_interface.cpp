@@ -178,6 +178,7 @@ void SubSurfaceInterfacePrivate::parentCommit()
     if (hasPendingPosition) {
         hasPendingPosition = false;
         position = pendingPosition;
+        SurfaceInterfacePrivate::get(parent)->invalidateBoundingRect();
         Q_EMIT q->positionChanged(position);
     }
 
@@ -9,9 +9,12 @@
 #include "clientconnection.h"
 #include "compositor_interface.h"
 #include "display.h"
+#include "fractionalscale_v1_interface_p.h"
 #include "idleinhibit_v1_interface_p.h"
 #include "linuxdmabufv1clientbuffer.h"
+#include "linuxdrmsyncobj_v1_interface_p.h"
 #include "pointerconstraints_v1_interface_p.h"
+#include "presentationtime_interface.h"
 #include "region_interface_p.h"
 #include "subcompositor_interface.h"
 #include "subsurface_interface_p.h"
@@ -19,9 +22,13 @@
 #include "surfacerole_p.h"
 #include "utils.h"
 
+#include "ftrace.h"
+
 #include <wayland-server.h>
 // std
 #include <algorithm>
+#include <cmath>
+#include <unistd.h>
 
 namespace KWaylandServer
 {
@@ -31,6 +38,9 @@ SurfaceInterfacePrivate::SurfaceInterfacePrivate(SurfaceInterface *q)
     wl_list_init(&current.frameCallbacks);
     wl_list_init(&pending.frameCallbacks);
     wl_list_init(&cached.frameCallbacks);
+    wl_list_init(&current.presentationFeedbacks);
+    wl_list_init(&pending.presentationFeedbacks);
+    wl_list_init(&cached.presentationFeedbacks);
 }
 
 SurfaceInterfacePrivate::~SurfaceInterfacePrivate()
@@ -47,6 +57,20 @@ SurfaceInterfacePrivate::~SurfaceInterfacePrivate()
     wl_resource_for_each_safe (resource, tmp, &cached.frameCallbacks) {
         wl_resource_destroy(resource);
     }
+    for (const auto &state : delayedStates) {
+        wl_resource_for_each_safe (resource, tmp, &state->frameCallbacks) {
+            wl_resource_destroy(resource);
+        }
+        PresentationFeedback::discard(&state->presentationFeedbacks);
+        if (state->bufferIsSet && state->buffer) {
+            state->buffer->unref();
+        }
+    }
+    stopWaitingForFence();
+
+    PresentationFeedback::discard(&current.presentationFeedbacks);
+    PresentationFeedback::discard(&pending.presentationFeedbacks);
+    PresentationFeedback::discard(&cached.presentationFeedbacks);
 
     if (current.buffer) {
         current.buffer->unref();
@@ -59,7 +83,9 @@ void SurfaceInterfacePrivate::addChild(SubSurfaceInterface *child)
     pending.above.append(child);
     cached.above.append(child);
     current.above.append(child);
+    invalidateBoundingRect();
     child->surface()->setOutputs(outputs);
+    child->surface()->setPreferredScale(preferredScale);
     Q_EMIT q->childSubSurfaceAdded(child);
     Q_EMIT q->childSubSurfacesChanged();
 }
@@ -73,6 +99,7 @@ void SurfaceInterfacePrivate::removeChild(SubSurfaceInterface *child)
     cached.above.removeAll(child);
     current.below.removeAll(child);
     current.above.removeAll(child);
+    invalidateBoundingRect();
     Q_EMIT q->childSubSurfaceRemoved(child);
     Q_EMIT q->childSubSurfacesChanged();
 }
@@ -300,10 +327,24 @@ void SurfaceInterfacePrivate::surface_set_input_region(Resource *resource, struc
 void SurfaceInterfacePrivate::surface_commit(Resource *resource)
 {
     Q_UNUSED(resource)
+    if (syncObjSurface) {
+        if (!syncObjSurface->validate(pending)) {
+            return;
+        }
+        if (pending.explicitSync.releaseTimeline) {
+            pending.explicitSync.release = std::make_shared<SyncReleasePoint>(pending.explicitSync.releaseTimeline, pending.explicitSync.releasePoint);
+            pending.explicitSync.releaseTimeline.reset();
+        }
+    }
+    if (KWin::FTraceLogger::self() && KWin::FTraceLogger::self()->isTracing()) {
+        static quint64 s_traceFlowId = 0;
+        pending.traceFlowId = ++s_traceFlowId;
+        fTraceFlow("Surface commit", pending.traceFlowId, Begin);
+    }
     if (subSurface) {
         commitSubSurface();
     } else {
-        applyState(&pending);
+        applyOrDelayState(&pending);
     }
 }
 
@@ -383,6 +424,11 @@ void SurfaceInterface::frameRendered(quint32 msec)
         wl_resource_destroy(resource);
     }
 
+    if (d->current.traceFlowId) {
+        fTraceFlow("Surface frame done", d->current.traceFlowId, End);
+        d->current.traceFlowId = 0;
+    }
+
     for (SubSurfaceInterface *subsurface : qAsConst(d->current.below)) {
         subsurface->surface()->frameRendered(msec);
     }
@@ -391,11 +437,59 @@ void SurfaceInterface::frameRendered(quint32 msec)
     }
 }
 
+static void takePresentationFeedbacks(SurfaceInterface *surface, wl_list *target)
+{
+    SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+    wl_list_insert_list(target, &surfacePrivate->current.presentationFeedbacks);
+    wl_list_init(&surfacePrivate->current.presentationFeedbacks);
+
+    for (SubSurfaceInterface *subsurface : qAsConst(surfacePrivate->current.below)) {
+        takePresentationFeedbacks(subsurface->surface(), target);
+    }
+    for (SubSurfaceInterface *subsurface : qAsConst(surfacePrivate->current.above)) {
+        takePresentationFeedbacks(subsurface->surface(), target);
+    }
+}
+
+std::unique_ptr<PresentationFeedback> SurfaceInterface::takePresentationFeedback(OutputInterface *output)
+{
+    wl_list feedbacks;
+    wl_list_init(&feedbacks);
+    takePresentationFeedbacks(this, &feedbacks);
+    if (wl_list_empty(&feedbacks)) {
+        return nullptr;
+    }
+    return std::make_unique<PresentationFeedback>(client(), output, &feedbacks);
+}
+
+PresentationHint SurfaceInterface::presentationHint() const
+{
+    return d->current.presentationHint;
+}
+
 bool SurfaceInterface::hasFrameCallbacks() const
 {
     return !wl_list_empty(&d->current.frameCallbacks);
 }
 
+/**
+ * Returns the scale factor of the @a matrix if it only scales both axes by the same integer
+ * amount, otherwise returns 0.
+ */
+static int integerScaleFactor(const QMatrix4x4 &matrix)
+{
+    if (matrix.isIdentity()) {
+        return 1;
+    }
+    const float scale = matrix(0, 0);
+    if (scale < 1 || scale != std::floor(scale) || matrix(1, 1) != scale) {
+        return 0;
+    }
+    QMatrix4x4 scaled;
+    scaled.scale(scale, scale);
+    return matrix == scaled ? int(scale) : 0;
+}
+
 QMatrix4x4 SurfaceInterfacePrivate::buildSurfaceToBufferMatrix()
 {
     // The order of transforms is reversed, i.e. the viewport transform is the first one.
@@ -464,12 +558,18 @@ QMatrix4x4 SurfaceInterfacePrivate::buildSurfaceToBufferMatrix()
 
 void SurfaceState::mergeInto(SurfaceState *target)
 {
+    // The payloads are moved rather than copied, and only the fields that have been set are
+    // reset afterwards, so a commit that attaches a buffer and posts damage doesn't allocate.
     if (bufferIsSet) {
         target->buffer = buffer;
         target->offset = offset;
-        target->damage = damage;
-        target->bufferDamage = bufferDamage;
+        target->damage = std::move(damage);
+        target->bufferDamage = std::move(bufferDamage);
         target->bufferIsSet = bufferIsSet;
+        target->explicitSync.acquireTimeline = std::move(explicitSync.acquireTimeline);
+        target->explicitSync.acquirePoint = explicitSync.acquirePoint;
+        // If the target had a buffer that never got applied, its release point is signalled here.
+        target->explicitSync.release = std::move(explicitSync.release);
     }
     if (viewport.sourceGeometryIsSet) {
         target->viewport.sourceGeometry = viewport.sourceGeometry;
@@ -485,6 +585,11 @@ void SurfaceState::mergeInto(SurfaceState *target)
         target->childrenChanged = true;
     }
     wl_list_insert_list(&target->frameCallbacks, &frameCallbacks);
+    if (bufferIsSet) {
+        // The content that the previous feedback is waiting for will never be shown.
+        PresentationFeedback::discard(&target->presentationFeedbacks);
+    }
+    wl_list_insert_list(&target->presentationFeedbacks, &presentationFeedbacks);
 
     if (shadowIsSet) {
         target->shadow = shadow;
@@ -502,12 +607,19 @@ void SurfaceState::mergeInto(SurfaceState *target)
         target->slide = slide;
         target->slideIsSet = true;
     }
+    if (presentationHintIsSet) {
+        target->presentationHint = presentationHint;
+        target->presentationHintIsSet = true;
+    }
+    if (traceFlowId) {
+        target->traceFlowId = traceFlowId;
+    }
     if (inputIsSet) {
-        target->input = input;
+        target->input = std::move(input);
         target->inputIsSet = true;
     }
     if (opaqueIsSet) {
-        target->opaque = opaque;
+        target->opaque = std::move(opaque);
         target->opaqueIsSet = true;
     }
     if (bufferScaleIsSet) {
@@ -519,14 +631,73 @@ void SurfaceState::mergeInto(SurfaceState *target)
         target->bufferTransformIsSet = true;
     }
 
-    *this = SurfaceState{};
+    reset();
     below = target->below;
     above = target->above;
+}
+
+void SurfaceState::reset()
+{
+    // Equivalent to assigning a default constructed state, except that the regions that
+    // haven't been touched keep their storage and the infinite input region is shared.
+    static const QRegion s_infiniteRegion = infiniteRegion();
+
+    damage = QRegion();
+    bufferDamage = QRegion();
+    if (opaqueIsSet) {
+        opaque = QRegion();
+    }
+    if (inputIsSet) {
+        input = s_infiniteRegion;
+    }
+    inputIsSet = false;
+    opaqueIsSet = false;
+    bufferIsSet = false;
+    shadowIsSet = false;
+    blurIsSet = false;
+    contrastIsSet = false;
+    slideIsSet = false;
+    childrenChanged = false;
+    bufferScaleIsSet = false;
+    bufferTransformIsSet = false;
+    bufferScale = 1;
+    bufferTransform = KWin::Output::Transform::Normal;
     wl_list_init(&frameCallbacks);
+    wl_list_init(&presentationFeedbacks);
+    offset = QPoint();
+    buffer.clear();
+    shadow.clear();
+    blur.clear();
+    contrast.clear();
+    slide.clear();
+    presentationHint = PresentationHint::VSync;
+    presentationHintIsSet = false;
+    traceFlowId = 0;
+    viewport.sourceGeometry = QRectF();
+    viewport.destinationSize = QSize();
+    viewport.sourceGeometryIsSet = false;
+    viewport.destinationSizeIsSet = false;
+    explicitSync.acquireTimeline.reset();
+    explicitSync.acquirePoint = 0;
+    explicitSync.releaseTimeline.reset();
+    explicitSync.releasePoint = 0;
+    explicitSync.release.reset();
+}
+
+void SurfaceInterfacePrivate::invalidateBoundingRect()
+{
+    // The ancestors of an outdated surface are outdated as well
+    for (SurfaceInterfacePrivate *surface = this; surface && !surface->boundingRectDirty;) {
+        surface->boundingRectDirty = true;
+        SurfaceInterface *parent = surface->subSurface ? surface->subSurface->parentSurface() : nullptr;
+        surface = parent ? SurfaceInterfacePrivate::get(parent) : nullptr;
+    }
 }
 
 void SurfaceInterfacePrivate::applyState(SurfaceState *next)
 {
+    invalidateBoundingRect();
+
     const bool bufferChanged = next->bufferIsSet;
     const bool opaqueRegionChanged = next->opaqueIsSet;
     const bool scaleFactorChanged = next->bufferScaleIsSet && (current.bufferScale != next->bufferScale);
@@ -537,14 +708,21 @@ void SurfaceInterfacePrivate::applyState(SurfaceState *next)
     const bool slideChanged = next->slideIsSet;
     const bool childrenChanged = next->childrenChanged;
     const bool visibilityChanged = bufferChanged && bool(current.buffer) != bool(next->buffer);
+    const bool inputRegionChanged = next->inputIsSet;
+    const bool viewportChanged = next->viewport.sourceGeometryIsSet || next->viewport.destinationSizeIsSet;
+    const bool oldHasAlphaChannel = current.buffer && current.buffer->hasAlphaChannel();
 
     const QSize oldSurfaceSize = surfaceSize;
     const QSize oldBufferSize = bufferSize;
-    const QMatrix4x4 oldSurfaceToBufferMatrix = surfaceToBufferMatrix;
-    const QRegion oldInputRegion = inputRegion;
+    const quint64 traceFlowId = next->traceFlowId;
+    bool inputRegionUpdated = false;
 
     next->mergeInto(&current);
 
+    if (traceFlowId) {
+        fTraceFlow("Surface state applied", traceFlowId, Step);
+    }
+
     if (lockedPointer) {
         auto lockedPointerPrivate = LockedPointerV1InterfacePrivate::get(lockedPointer);
         lockedPointerPrivate->commit();
@@ -563,6 +741,13 @@ void SurfaceInterfacePrivate::applyState(SurfaceState *next)
             bufferRef->ref();
         }
     }
+    if (current.explicitSync.release) {
+        if (bufferRef) {
+            bufferRef->addReleasePoint(current.explicitSync.release);
+        }
+        current.explicitSync.release.reset();
+    }
+    current.explicitSync.acquireTimeline.reset();
 
     // TODO: Refactor the state management code because it gets more clumsy.
     if (current.buffer) {
@@ -591,29 +776,52 @@ void SurfaceInterfacePrivate::applyState(SurfaceState *next)
             surfaceSize = implicitSurfaceSize;
         }
 
+        // The clipped regions only need to be recomputed if their inputs have changed
         const QRect surfaceRect(QPoint(0, 0), surfaceSize);
-        inputRegion = current.input & surfaceRect;
+        const bool surfaceRectChanged = visibilityChanged || surfaceSize != oldSurfaceSize;
+        if (surfaceRectChanged || inputRegionChanged) {
+            QRegion clippedInputRegion = current.input & surfaceRect;
+            if (clippedInputRegion != inputRegion) {
+                inputRegion = std::move(clippedInputRegion);
+                inputRegionUpdated = true;
+            }
+        }
 
-        if (!current.buffer->hasAlphaChannel()) {
-            opaqueRegion = surfaceRect;
-        } else {
-            opaqueRegion = current.opaque & surfaceRect;
+        const bool hasAlphaChannel = current.buffer->hasAlphaChannel();
+        if (surfaceRectChanged || opaqueRegionChanged || hasAlphaChannel != oldHasAlphaChannel) {
+            if (!hasAlphaChannel) {
+                opaqueRegion = surfaceRect;
+            } else {
+                opaqueRegion = current.opaque & surfaceRect;
+            }
         }
     } else {
         // not QSize() because that will initialize width and height to -1
         surfaceSize = QSize(0, 0);
         implicitSurfaceSize = QSize(0, 0);
         bufferSize = QSize(0, 0);
-        inputRegion = QRegion();
+        if (!inputRegion.isEmpty()) {
+            inputRegion = QRegion();
+            inputRegionUpdated = true;
+        }
         opaqueRegion = QRegion();
     }
 
-    surfaceToBufferMatrix = buildSurfaceToBufferMatrix();
-    bufferToSurfaceMatrix = surfaceToBufferMatrix.inverted();
+    bool surfaceToBufferMatrixChanged = false;
+    if (visibilityChanged || scaleFactorChanged || transformChanged || viewportChanged
+        || surfaceSize != oldSurfaceSize || bufferSize != oldBufferSize) {
+        const QMatrix4x4 matrix = buildSurfaceToBufferMatrix();
+        if (matrix != surfaceToBufferMatrix) {
+            surfaceToBufferMatrix = matrix;
+            bufferToSurfaceMatrix = surfaceToBufferMatrix.inverted();
+            integerBufferScale = integerScaleFactor(surfaceToBufferMatrix);
+            surfaceToBufferMatrixChanged = true;
+        }
+    }
     if (opaqueRegionChanged) {
         Q_EMIT q->opaqueChanged(opaqueRegion);
     }
-    if (oldInputRegion != inputRegion) {
+    if (inputRegionUpdated) {
         Q_EMIT q->inputChanged(inputRegion);
     }
     if (scaleFactorChanged) {
@@ -627,13 +835,18 @@ void SurfaceInterfacePrivate::applyState(SurfaceState *next)
     }
     if (bufferChanged) {
         if (current.buffer && (!current.damage.isEmpty() || !current.bufferDamage.isEmpty())) {
-            const QRegion windowRegion = QRegion(0, 0, q->size().width(), q->size().height());
-            const QRegion bufferDamage = q->mapFromBuffer(current.bufferDamage);
-            current.damage = windowRegion.intersected(current.damage.united(bufferDamage));
+            if (!current.bufferDamage.isEmpty()) {
+                current.damage += q->mapFromBuffer(current.bufferDamage);
+            }
+            // Most clients post damage within the surface, don't clip it needlessly
+            const QRect surfaceRect(QPoint(0, 0), q->size());
+            if (!surfaceRect.contains(current.damage.boundingRect())) {
+                current.damage &= surfaceRect;
+            }
             Q_EMIT q->damaged(current.damage);
         }
     }
-    if (surfaceToBufferMatrix != oldSurfaceToBufferMatrix) {
+    if (surfaceToBufferMatrixChanged) {
         Q_EMIT q->surfaceToBufferMatrixChanged();
     }
     if (bufferSize != oldBufferSize) {
@@ -666,6 +879,9 @@ void SurfaceInterfacePrivate::applyState(SurfaceState *next)
         auto subsurfacePrivate = SubSurfaceInterfacePrivate::get(subsurface);
         subsurfacePrivate->parentCommit();
     }
+    // Slots connected to the signals above may have cached a bounding rect with the
+    // sub-surfaces at their old positions
+    invalidateBoundingRect();
     if (role) {
         role->commit();
     }
@@ -679,9 +895,10 @@ void SurfaceInterfacePrivate::commitSubSurface()
     } else {
         if (hasCacheState) {
             commitToCache();
-            commitFromCache();
+            hasCacheState = false;
+            applyOrDelayState(&cached);
         } else {
-            applyState(&pending);
+            applyOrDelayState(&pending);
         }
     }
 }
@@ -694,8 +911,131 @@ void SurfaceInterfacePrivate::commitToCache()
 
 void SurfaceInterfacePrivate::commitFromCache()
 {
-    applyState(&cached);
     hasCacheState = false;
+    if (delayedStates.empty()) {
+        applyState(&cached);
+    } else {
+        // The parent has waited for the cached state to become ready, but older states of
+        // this surface still wait for their buffers, so keep the order.
+        applyOrDelayState(&cached);
+    }
+}
+
+void SurfaceInterfacePrivate::applyOrDelayState(SurfaceState *next)
+{
+    if (delayedStates.empty()) {
+        const int fence = createBufferFence(next);
+        if (fence == -1) {
+            applyState(next);
+            return;
+        }
+        waitForFence(fence);
+    }
+
+    auto state = std::make_unique<SurfaceState>();
+    wl_list_init(&state->frameCallbacks);
+    wl_list_init(&state->presentationFeedbacks);
+    state->below = next->below;
+    state->above = next->above;
+    next->mergeInto(state.get());
+    // The client may destroy the buffer while the state waits, keep it alive until then
+    if (state->bufferIsSet && state->buffer) {
+        state->buffer->ref();
+    }
+    delayedStates.push_back(std::move(state));
+}
+
+void SurfaceInterfacePrivate::applyDelayedStates()
+{
+    stopWaitingForFence();
+    while (!delayedStates.empty()) {
+        const int fence = createBufferFence(delayedStates.front().get());
+        if (fence != -1) {
+            waitForFence(fence);
+            return;
+        }
+        const std::unique_ptr<SurfaceState> state = std::move(delayedStates.front());
+        delayedStates.pop_front();
+
+        ClientBuffer *buffer = state->bufferIsSet ? state->buffer : nullptr;
+        if (buffer && buffer->isDestroyed()) {
+            // The contents of a destroyed buffer are gone, keep showing the previous buffer
+            state->bufferIsSet = false;
+            state->buffer = nullptr;
+            state->damage = QRegion();
+            state->bufferDamage = QRegion();
+            state->explicitSync.acquireTimeline.reset();
+            state->explicitSync.release.reset();
+        }
+        applyState(state.get());
+        if (buffer) {
+            buffer->unref();
+        }
+    }
+}
+
+int SurfaceInterfacePrivate::createBufferFence(const SurfaceState *state) const
+{
+    if (state->explicitSync.acquireTimeline) {
+        if (!state->explicitSync.acquireTimeline->isSignalled(state->explicitSync.acquirePoint)) {
+            // If there is no way to get notified, rather show the buffer too early than never.
+            const int fence = state->explicitSync.acquireTimeline->eventFd(state->explicitSync.acquirePoint);
+            if (fence != -1) {
+                return fence;
+            }
+        }
+    } else if (state->bufferIsSet) {
+        // Without explicit synchronization, the fence of the rendering that the client has
+        // submitted before committing is attached to the dmabuf. Waiting for it here keeps
+        // the compositor's rendering from waiting for it later. Exporting and polling the fence
+        // on every commit isn't free and most drivers handle implicit fences well enough on
+        // their own, so it has to be asked for.
+        static bool valid;
+        static const bool fenceWaitEnabled = qEnvironmentVariableIntValue("KWIN_WAYLAND_DMABUF_FENCE_WAIT", &valid) == 1 && valid;
+        if (fenceWaitEnabled) {
+            if (const auto buffer = qobject_cast<LinuxDmaBufV1ClientBuffer *>(state->buffer)) {
+                const int fence = buffer->exportWriteFence();
+                if (fence != -1) {
+                    return fence;
+                }
+            }
+        }
+    }
+
+    // Synchronized sub-surfaces apply their cached state together with this state.
+    const QList<SubSurfaceInterface *> children = state->childrenChanged ? state->below + state->above : current.below + current.above;
+    for (SubSurfaceInterface *child : children) {
+        if (!child->surface() || !child->isSynchronized()) {
+            continue;
+        }
+        const SurfaceInterfacePrivate *childPrivate = SurfaceInterfacePrivate::get(child->surface());
+        if (childPrivate->hasCacheState) {
+            const int fence = childPrivate->createBufferFence(&childPrivate->cached);
+            if (fence != -1) {
+                return fence;
+            }
+        }
+    }
+    return -1;
+}
+
+void SurfaceInterfacePrivate::waitForFence(int fence)
+{
+    stopWaitingForFence();
+    fenceNotifier.reset(new QSocketNotifier(fence, QSocketNotifier::Read));
+    QObject::connect(fenceNotifier.data(), &QSocketNotifier::activated, q, [this]() {
+        applyDelayedStates();
+    });
+}
+
+void SurfaceInterfacePrivate::stopWaitingForFence()
+{
+    if (fenceNotifier) {
+        // This can be called by the notifier itself, so it can't be deleted right away.
+        fenceNotifier->setEnabled(false);
+        close(fenceNotifier->socket());
+        fenceNotifier.take()->deleteLater();
+    }
 }
 
 bool SurfaceInterfacePrivate::computeEffectiveMapped() const
@@ -807,6 +1147,10 @@ QSize SurfaceInterface::size() const
 
 QRect SurfaceInterface::boundingRect() const
 {
+    if (!d->boundingRectDirty) {
+        return d->boundingRect;
+    }
+
     QRect rect(QPoint(0, 0), size());
 
     for (const SubSurfaceInterface *subSurface : qAsConst(d->current.below)) {
@@ -818,6 +1162,8 @@ QRect SurfaceInterface::boundingRect() const
         rect |= childSurface->boundingRect().translated(subSurface->position());
     }
 
+    d->boundingRect = rect;
+    d->boundingRectDirty = false;
     return rect;
 }
 
@@ -902,6 +1248,29 @@ void SurfaceInterface::setOutputs(const QVector<OutputInterface *> &outputs)
     }
 }
 
+qreal SurfaceInterface::preferredScale() const
+{
+    return d->preferredScale;
+}
+
+void SurfaceInterface::setPreferredScale(qreal scale)
+{
+    if (qFuzzyCompare(d->preferredScale, scale)) {
+        return;
+    }
+    d->preferredScale = scale;
+
+    if (d->fractionalScaleExtension) {
+        d->fractionalScaleExtension->setPreferredScale(scale);
+    }
+    for (auto child : qAsConst(d->current.below)) {
+        child->surface()->setPreferredScale(scale);
+    }
+    for (auto child : qAsConst(d->current.above)) {
+        child->surface()->setPreferredScale(scale);
+    }
+}
+
 SurfaceInterface *SurfaceInterface::surfaceAt(const QPointF &position)
 {
     if (!isMapped()) {
@@ -938,6 +1307,10 @@ SurfaceInterface *SurfaceInterface::inputSurfaceAt(const QPointF &position)
     if (!isMapped()) {
         return nullptr;
     }
+    // Reject points far from the surface tree without walking it
+    if (!QRectF(boundingRect()).contains(position)) {
+        return nullptr;
+    }
 
     for (auto it = d->current.above.crbegin(); it != d->current.above.crend(); ++it) {
         const SubSurfaceInterface *current = *it;
@@ -995,6 +1368,9 @@ QPointF SurfaceInterface::mapFromBuffer(const QPointF &point) const
 
 static QRegion map_helper(const QMatrix4x4 &matrix, const QRegion &region)
 {
+    if (matrix.isIdentity()) {
+        return region;
+    }
     QRegion result;
     for (const QRect &rect : region) {
         result += matrix.mapRect(rect);
@@ -1004,12 +1380,49 @@ static QRegion map_helper(const QMatrix4x4 &matrix, const QRegion &region)
 
 QRegion SurfaceInterface::mapToBuffer(const QRegion &region) const
 {
-    return map_helper(d->surfaceToBufferMatrix, region);
+    const int scale = d->integerBufferScale;
+    if (scale == 1) {
+        return region;
+    } else if (scale == 0) {
+        return map_helper(d->surfaceToBufferMatrix, region);
+    }
+
+    // Scaling up by an integer amount keeps the rects banded and non-overlapping
+    QVector<QRect> rects;
+    rects.reserve(region.rectCount());
+    for (const QRect &rect : region) {
+        rects.append(QRect(rect.x() * scale, rect.y() * scale, rect.width() * scale, rect.height() * scale));
+    }
+    QRegion result;
+    result.setRects(rects.constData(), rects.count());
+    return result;
 }
 
 QRegion SurfaceInterface::mapFromBuffer(const QRegion &region) const
 {
-    return map_helper(d->bufferToSurfaceMatrix, region);
+    const int scale = d->integerBufferScale;
+    if (scale == 1) {
+        return region;
+    } else if (scale == 0) {
+        return map_helper(d->bufferToSurfaceMatrix, region);
+    }
+
+    // Round outwards so partially damaged surface pixels are repainted too
+    const auto scaleDown = [scale](const QRect &rect) {
+        const int left = rect.x() / scale;
+        const int top = rect.y() / scale;
+        const int right = (rect.x() + rect.width() + scale - 1) / scale;
+        const int bottom = (rect.y() + rect.height() + scale - 1) / scale;
+        return QRect(left, top, right - left, bottom - top);
+    };
+    if (region.rectCount() == 1) {
+        return scaleDown(region.boundingRect());
+    }
+    QRegion result;
+    for (const QRect &rect : region) {
+        result += scaleDown(rect);
+    }
+    return result;
 }
 
 QMatrix4x4 SurfaceInterface::surfaceToBufferMatrix() const
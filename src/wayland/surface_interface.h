@@ -13,6 +13,8 @@
 #include <QPointer>
 #include <QRegion>
 
+#include <memory>
+
 namespace KWaylandServer
 {
 class BlurInterface;
@@ -21,12 +23,23 @@ class ConfinedPointerV1Interface;
 class ContrastInterface;
 class CompositorInterface;
 class LockedPointerV1Interface;
+class PresentationFeedback;
 class ShadowInterface;
 class SlideInterface;
 class SubSurfaceInterface;
 class SurfaceInterfacePrivate;
 class LinuxDmaBufV1Feedback;
 
+/**
+ * Describes whether the contents of a surface may be presented with tearing.
+ *
+ * @see TearingControlManagerV1Interface
+ */
+enum class PresentationHint {
+    VSync,
+    Async,
+};
+
 /**
  * @brief Resource representing a wl_surface.
  *
@@ -158,6 +171,21 @@ public:
     void frameRendered(quint32 msec);
     bool hasFrameCallbacks() const;
 
+    /**
+     * Takes the presentation feedback requests of this surface and its sub-surfaces for
+     * the current surface state, which is about to be shown on the specified @a output.
+     * Returns @c null if no client has asked for presentation feedback.
+     *
+     * @see PresentationTimeInterface
+     */
+    std::unique_ptr<PresentationFeedback> takePresentationFeedback(OutputInterface *output);
+
+    /**
+     * Returns whether the client allows the contents of this surface to be presented with
+     * tearing. The default is PresentationHint::VSync.
+     */
+    PresentationHint presentationHint() const;
+
     QRegion damage() const;
     QRegion opaque() const;
     QRegion input() const;
@@ -283,6 +311,24 @@ public:
      */
     QVector<OutputInterface *> outputs() const;
 
+    /**
+     * Sets the preferred @a scale factor of the surface. Clients that support the fractional
+     * scale extension will render buffers that match the given scale exactly and use the
+     * viewporter to map them to the surface size. The scale is propagated to sub-surfaces.
+     *
+     * The compositor should update the preferred scale whenever the surface moves to an
+     * output with a different scale factor.
+     *
+     * @see preferredScale
+     */
+    void setPreferredScale(qreal scale);
+
+    /**
+     * Returns the preferred scale factor of the surface.
+     * @see setPreferredScale
+     */
+    qreal preferredScale() const;
+
     /**
      * Pointer confinement installed on this SurfaceInterface.
      * @see pointerConstraintsChanged
@@ -10,19 +10,29 @@
 #include "utils.h"
 // Qt
 #include <QHash>
+#include <QSocketNotifier>
 #include <QVector>
+
+#include <deque>
+#include <memory>
 // Wayland
 #include "qwayland-server-wayland.h"
 
 namespace KWaylandServer
 {
+class FractionalScaleV1Interface;
 class IdleInhibitorV1Interface;
+class LinuxDrmSyncObjSurfaceV1Interface;
 class SurfaceRole;
+class SyncReleasePoint;
+class SyncTimeline;
+class TearingControlV1Interface;
 class ViewportInterface;
 
 struct SurfaceState
 {
     void mergeInto(SurfaceState *target);
+    void reset();
 
     QRegion damage = QRegion();
     QRegion bufferDamage = QRegion();
@@ -41,12 +51,17 @@ struct SurfaceState
     qint32 bufferScale = 1;
     KWin::Output::Transform bufferTransform = KWin::Output::Transform::Normal;
     wl_list frameCallbacks;
+    wl_list presentationFeedbacks;
     QPoint offset = QPoint();
     QPointer<ClientBuffer> buffer;
     QPointer<ShadowInterface> shadow;
     QPointer<BlurInterface> blur;
     QPointer<ContrastInterface> contrast;
     QPointer<SlideInterface> slide;
+    PresentationHint presentationHint = PresentationHint::VSync;
+    bool presentationHintIsSet = false;
+    // Links the trace events of a commit until its frame is done, 0 if not traced
+    quint64 traceFlowId = 0;
 
     // Subsurfaces are stored in two lists. The below list contains subsurfaces that
     // are below their parent surface; the above list contains subsurfaces that are
@@ -61,6 +76,16 @@ struct SurfaceState
         bool sourceGeometryIsSet = false;
         bool destinationSizeIsSet = false;
     } viewport;
+
+    struct
+    {
+        std::shared_ptr<SyncTimeline> acquireTimeline;
+        quint64 acquirePoint = 0;
+        std::shared_ptr<SyncTimeline> releaseTimeline;
+        quint64 releasePoint = 0;
+        // Created when the state is committed, signals the release point once the buffer is released.
+        std::shared_ptr<SyncReleasePoint> release;
+    } explicitSync;
 };
 
 class SurfaceInterfacePrivate : public QtWaylandServer::wl_surface
@@ -92,9 +117,22 @@ public:
     void commitSubSurface();
     QMatrix4x4 buildSurfaceToBufferMatrix();
     void applyState(SurfaceState *next);
+    void applyOrDelayState(SurfaceState *next);
+    void applyDelayedStates();
+    /**
+     * Returns a file descriptor that becomes readable once the buffers of the given @a state,
+     * including the ones of synchronized sub-surfaces, are ready, or @c -1 if they're ready.
+     */
+    int createBufferFence(const SurfaceState *state) const;
+    KWIN_EXPORT void waitForFence(int fence);
+    void stopWaitingForFence();
 
     bool computeEffectiveMapped() const;
     void updateEffectiveMapped();
+    /**
+     * Marks the bounding rect of this surface and of all its ancestors as outdated.
+     */
+    void invalidateBoundingRect();
 
     CompositorInterface *compositor;
     SurfaceInterface *q;
@@ -102,9 +140,15 @@ public:
     SurfaceState current;
     SurfaceState pending;
     SurfaceState cached;
+    // Committed states whose buffers aren't ready yet, the front one waits for the fence notifier.
+    std::deque<std::unique_ptr<SurfaceState>> delayedStates;
+    QScopedPointer<QSocketNotifier> fenceNotifier;
     SubSurfaceInterface *subSurface = nullptr;
     QMatrix4x4 surfaceToBufferMatrix;
     QMatrix4x4 bufferToSurfaceMatrix;
+    // The integer scale factor between the buffer and the surface if that's all the
+    // surface to buffer matrix does, or 0 if regions need to be mapped through the matrix
+    int integerBufferScale = 1;
     QSize bufferSize = QSize(0, 0);
     QSize implicitSurfaceSize = QSize(0, 0);
     QSize surfaceSize = QSize(0, 0);
@@ -112,9 +156,13 @@ public:
     QRegion opaqueRegion;
     ClientBuffer *bufferRef = nullptr;
     bool mapped = false;
+    // The bounding rect of the surface tree, it's only recomputed after the tree has changed
+    QRect boundingRect;
+    bool boundingRectDirty = true;
     bool hasCacheState = false;
 
     QVector<OutputInterface *> outputs;
+    qreal preferredScale = 1.0;
 
     LockedPointerV1Interface *lockedPointer = nullptr;
     ConfinedPointerV1Interface *confinedPointer = nullptr;
@@ -123,6 +171,9 @@ public:
 
     QVector<IdleInhibitorV1Interface *> idleInhibitors;
     ViewportInterface *viewportExtension = nullptr;
+    TearingControlV1Interface *tearingControl = nullptr;
+    FractionalScaleV1Interface *fractionalScaleExtension = nullptr;
+    LinuxDrmSyncObjSurfaceV1Interface *syncObjSurface = nullptr;
     QScopedPointer<LinuxDmaBufV1Feedback> dmabufFeedbackV1;
     ClientConnection *client = nullptr;
 
@@ -0,0 +1,110 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "tearingcontrol_v1_interface.h"
+#include "display.h"
+#include "surface_interface_p.h"
+#include "tearingcontrol_v1_interface_p.h"
+
+static const int s_version = 1;
+
+namespace KWaylandServer
+{
+class TearingControlManagerV1InterfacePrivate : public QtWaylandServer::wp_tearing_control_manager_v1
+{
+public:
+    explicit TearingControlManagerV1InterfacePrivate(Display *display);
+
+protected:
+    void wp_tearing_control_manager_v1_destroy(Resource *resource) override;
+    void wp_tearing_control_manager_v1_get_tearing_control(Resource *resource, uint32_t id, struct ::wl_resource *surface) override;
+};
+
+TearingControlManagerV1InterfacePrivate::TearingControlManagerV1InterfacePrivate(Display *display)
+    : QtWaylandServer::wp_tearing_control_manager_v1(*display, s_version)
+{
+}
+
+void TearingControlManagerV1InterfacePrivate::wp_tearing_control_manager_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void TearingControlManagerV1InterfacePrivate::wp_tearing_control_manager_v1_get_tearing_control(Resource *resource, uint32_t id, struct ::wl_resource *surface_resource)
+{
+    SurfaceInterface *surface = SurfaceInterface::get(surface_resource);
+    if (TearingControlV1Interface::get(surface)) {
+        wl_resource_post_error(resource->handle, error_tearing_control_exists, "the specified surface already has a tearing control object");
+        return;
+    }
+
+    wl_resource *tearingControlResource = wl_resource_create(resource->client(), &wp_tearing_control_v1_interface, resource->version(), id);
+
+    new TearingControlV1Interface(surface, tearingControlResource);
+}
+
+TearingControlManagerV1Interface::TearingControlManagerV1Interface(Display *display, QObject *parent)
+    : QObject(parent)
+    , d(new TearingControlManagerV1InterfacePrivate(display))
+{
+}
+
+TearingControlManagerV1Interface::~TearingControlManagerV1Interface()
+{
+}
+
+TearingControlV1Interface::TearingControlV1Interface(SurfaceInterface *surface, wl_resource *resource)
+    : QtWaylandServer::wp_tearing_control_v1(resource)
+    , surface(surface)
+{
+    SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+    surfacePrivate->tearingControl = this;
+}
+
+TearingControlV1Interface::~TearingControlV1Interface()
+{
+    if (surface) {
+        SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+        surfacePrivate->tearingControl = nullptr;
+    }
+}
+
+TearingControlV1Interface *TearingControlV1Interface::get(SurfaceInterface *surface)
+{
+    return SurfaceInterfacePrivate::get(surface)->tearingControl;
+}
+
+void TearingControlV1Interface::wp_tearing_control_v1_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource)
+    delete this;
+}
+
+void TearingControlV1Interface::wp_tearing_control_v1_destroy(Resource *resource)
+{
+    if (surface) {
+        SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+        surfacePrivate->pending.presentationHint = PresentationHint::VSync;
+        surfacePrivate->pending.presentationHintIsSet = true;
+    }
+
+    wl_resource_destroy(resource->handle);
+}
+
+void TearingControlV1Interface::wp_tearing_control_v1_set_presentation_hint(Resource *resource, uint32_t hint)
+{
+    Q_UNUSED(resource)
+    if (!surface) {
+        return;
+    }
+
+    SurfaceInterfacePrivate *surfacePrivate = SurfaceInterfacePrivate::get(surface);
+    surfacePrivate->pending.presentationHint = hint == presentation_hint_async ? PresentationHint::Async : PresentationHint::VSync;
+    surfacePrivate->pending.presentationHintIsSet = true;
+}
+
+} // namespace KWaylandServer
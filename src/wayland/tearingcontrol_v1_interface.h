@@ -0,0 +1,38 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QObject>
+
+namespace KWaylandServer
+{
+class Display;
+class TearingControlManagerV1InterfacePrivate;
+
+/**
+ * The TearingControlManagerV1Interface is an extension that allows clients to hint that
+ * the contents of their surfaces may be presented with tearing, i.e. without waiting for
+ * the vertical blank.
+ *
+ * TearingControlManagerV1Interface corresponds to the Wayland interface @c wp_tearing_control_manager_v1.
+ */
+class KWIN_EXPORT TearingControlManagerV1Interface : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TearingControlManagerV1Interface(Display *display, QObject *parent = nullptr);
+    ~TearingControlManagerV1Interface() override;
+
+private:
+    QScopedPointer<TearingControlManagerV1InterfacePrivate> d;
+};
+
+} // namespace KWaylandServer
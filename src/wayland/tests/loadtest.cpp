@@ -0,0 +1,445 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "../clientconnection.h"
+#include "../compositor_interface.h"
+#include "../datadevicemanager_interface.h"
+#include "../display.h"
+#include "../output_interface.h"
+#include "../seat_interface.h"
+#include "../subcompositor_interface.h"
+#include "../surface_interface.h"
+
+#include "KWayland/Client/buffer.h"
+#include "KWayland/Client/compositor.h"
+#include "KWayland/Client/connection_thread.h"
+#include "KWayland/Client/datadevice.h"
+#include "KWayland/Client/datadevicemanager.h"
+#include "KWayland/Client/datasource.h"
+#include "KWayland/Client/event_queue.h"
+#include "KWayland/Client/keyboard.h"
+#include "KWayland/Client/pointer.h"
+#include "KWayland/Client/registry.h"
+#include "KWayland/Client/seat.h"
+#include "KWayland/Client/shm_pool.h"
+#include "KWayland/Client/subcompositor.h"
+#include "KWayland/Client/subsurface.h"
+#include "KWayland/Client/surface.h"
+
+#include <QAbstractEventDispatcher>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QMutex>
+#include <QPointer>
+#include <QRandomGenerator>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+/**
+ * A load generator for the Wayland server. It hosts a Display in the main thread and connects
+ * many clients to it from a few worker threads. Every client keeps a tree of surfaces busy with
+ * damage, commits and frame callbacks and sets the selection whenever it gains keyboard focus,
+ * while the server moves the pointer and keyboard focus between the clients.
+ *
+ * Once per second the server side throughput, the time spent handling requests and the time
+ * between a commit and its frame callback are printed. Since the server presents every commit
+ * right away, the frame callback latency is the latency of the Display dispatch.
+ */
+
+struct Options
+{
+    int clients = 50;
+    int threads = 4;
+    int subsurfaces = 4;
+    int focusInterval = 10;
+    int duration = 10;
+    bool dataDevice = true;
+};
+
+/**
+ * Collects the frame callback latencies of all clients.
+ */
+class LatencyRecorder
+{
+public:
+    void record(std::chrono::microseconds latency)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_latencies.append(latency.count());
+    }
+
+    QVector<qint64> take()
+    {
+        QMutexLocker locker(&m_mutex);
+        QVector<qint64> latencies;
+        latencies.swap(m_latencies);
+        return latencies;
+    }
+
+private:
+    QMutex m_mutex;
+    QVector<qint64> m_latencies;
+};
+
+using namespace KWayland::Client;
+
+class LoadClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    LoadClient(const QString &socketName, const Options &options, LatencyRecorder *recorder)
+        : m_socketName(socketName)
+        , m_options(options)
+        , m_recorder(recorder)
+    {
+    }
+
+    ~LoadClient() override
+    {
+        qDeleteAll(m_subSurfaces);
+        qDeleteAll(m_surfaces);
+        // The protocol objects must be destroyed before their event queue and the connection.
+        const QObjectList children = this->children();
+        std::for_each(children.crbegin(), children.crend(), [](QObject *child) {
+            delete child;
+        });
+        delete m_connection;
+    }
+
+    void start()
+    {
+        m_connection = new ConnectionThread;
+        m_connection->setSocketName(m_socketName);
+        connect(m_connection, &ConnectionThread::connected, this, &LoadClient::setupRegistry);
+        m_connection->initConnection();
+    }
+
+private:
+    void setupRegistry()
+    {
+        m_queue = new EventQueue(this);
+        m_queue->setup(m_connection);
+
+        m_registry = new Registry(this);
+        connect(m_registry, &Registry::interfacesAnnounced, this, &LoadClient::setupInterfaces);
+        m_registry->setEventQueue(m_queue);
+        m_registry->create(m_connection);
+        m_registry->setup();
+    }
+
+    void setupInterfaces()
+    {
+        const auto compositor = m_registry->interface(Registry::Interface::Compositor);
+        const auto subCompositor = m_registry->interface(Registry::Interface::SubCompositor);
+        const auto shm = m_registry->interface(Registry::Interface::Shm);
+        const auto seat = m_registry->interface(Registry::Interface::Seat);
+        const auto dataDeviceManager = m_registry->interface(Registry::Interface::DataDeviceManager);
+        m_compositor = m_registry->createCompositor(compositor.name, compositor.version, this);
+        m_subCompositor = m_registry->createSubCompositor(subCompositor.name, subCompositor.version, this);
+        m_shm = m_registry->createShmPool(shm.name, shm.version, this);
+        m_seat = m_registry->createSeat(seat.name, seat.version, this);
+
+        connect(m_seat, &Seat::hasPointerChanged, this, [this](bool hasPointer) {
+            if (hasPointer && !m_pointer) {
+                m_pointer = m_seat->createPointer(this);
+            }
+        });
+        connect(m_seat, &Seat::hasKeyboardChanged, this, [this](bool hasKeyboard) {
+            if (hasKeyboard && !m_keyboard) {
+                m_keyboard = m_seat->createKeyboard(this);
+                connect(m_keyboard, &Keyboard::entered, this, &LoadClient::offerSelection);
+            }
+        });
+        if (m_options.dataDevice) {
+            m_dataDeviceManager = m_registry->createDataDeviceManager(dataDeviceManager.name, dataDeviceManager.version, this);
+            m_dataDevice = m_dataDeviceManager->getDataDevice(m_seat, this);
+        }
+
+        createSurfaces();
+        commit();
+    }
+
+    /**
+     * Creates a root surface with a binary tree of synchronized subsurfaces below it.
+     */
+    void createSurfaces()
+    {
+        QImage image(64, 64, QImage::Format_ARGB32_Premultiplied);
+        image.fill(QColor::fromRgb(QRandomGenerator::global()->generate()));
+        m_buffer = m_shm->createBuffer(image);
+
+        m_surfaces.append(m_compositor->createSurface());
+        for (int i = 1; i <= m_options.subsurfaces; ++i) {
+            Surface *surface = m_compositor->createSurface();
+            SubSurface *subSurface = m_subCompositor->createSubSurface(surface, m_surfaces[(i - 1) / 2]);
+            subSurface->setMode(SubSurface::Mode::Synchronized);
+            subSurface->setPosition(QPoint(8 * i, 8 * i));
+            m_surfaces.append(surface);
+            m_subSurfaces.append(subSurface);
+        }
+
+        connect(m_surfaces.first(), &Surface::frameRendered, this, [this]() {
+            m_recorder->record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_commitTimestamp));
+            commit();
+        });
+    }
+
+    void commit()
+    {
+        // The subsurfaces are synchronized, their state is applied together with the root surface.
+        for (int i = m_surfaces.count() - 1; i >= 0; --i) {
+            Surface *surface = m_surfaces[i];
+            const int x = QRandomGenerator::global()->bounded(56);
+            const int y = QRandomGenerator::global()->bounded(56);
+            surface->attachBuffer(m_buffer);
+            surface->damageBuffer(QRect(x, y, 8, 8));
+            if (i == 0) {
+                m_commitTimestamp = std::chrono::steady_clock::now();
+                surface->commit(Surface::CommitFlag::FrameCallback);
+            } else {
+                surface->commit(Surface::CommitFlag::None);
+            }
+        }
+        m_connection->flush();
+    }
+
+    void offerSelection(quint32 serial)
+    {
+        if (!m_dataDevice) {
+            return;
+        }
+        delete m_dataSource;
+        m_dataSource = m_dataDeviceManager->createDataSource(this);
+        m_dataSource->offer(QStringLiteral("text/plain"));
+        m_dataSource->offer(QStringLiteral("text/html"));
+        m_dataDevice->setSelection(serial, m_dataSource);
+    }
+
+    const QString m_socketName;
+    const Options m_options;
+    LatencyRecorder *const m_recorder;
+
+    ConnectionThread *m_connection = nullptr;
+    EventQueue *m_queue = nullptr;
+    Registry *m_registry = nullptr;
+    Compositor *m_compositor = nullptr;
+    SubCompositor *m_subCompositor = nullptr;
+    ShmPool *m_shm = nullptr;
+    Seat *m_seat = nullptr;
+    Pointer *m_pointer = nullptr;
+    Keyboard *m_keyboard = nullptr;
+    DataDeviceManager *m_dataDeviceManager = nullptr;
+    DataDevice *m_dataDevice = nullptr;
+    DataSource *m_dataSource = nullptr;
+    Buffer::Ptr m_buffer;
+    QVector<Surface *> m_surfaces;
+    QVector<SubSurface *> m_subSurfaces;
+    std::chrono::steady_clock::time_point m_commitTimestamp;
+};
+
+/**
+ * Measures the time the main thread, which runs the Wayland server, spends outside of the
+ * event loop wait.
+ */
+class BusyTimer : public QObject
+{
+public:
+    explicit BusyTimer(QAbstractEventDispatcher *dispatcher)
+    {
+        connect(dispatcher, &QAbstractEventDispatcher::awake, this, [this]() {
+            if (!m_awake.isValid()) {
+                m_awake.start();
+            }
+        });
+        connect(dispatcher, &QAbstractEventDispatcher::aboutToBlock, this, [this]() {
+            if (m_awake.isValid()) {
+                m_busyTime += std::chrono::nanoseconds(m_awake.nsecsElapsed());
+                m_awake.invalidate();
+            }
+        });
+    }
+
+    std::chrono::nanoseconds take()
+    {
+        const std::chrono::nanoseconds busyTime = m_busyTime;
+        m_busyTime = std::chrono::nanoseconds::zero();
+        return busyTime;
+    }
+
+private:
+    QElapsedTimer m_awake;
+    std::chrono::nanoseconds m_busyTime = std::chrono::nanoseconds::zero();
+};
+
+static qint64 percentile(const QVector<qint64> &sorted, int percent)
+{
+    if (sorted.isEmpty()) {
+        return 0;
+    }
+    return sorted[std::min<int>(sorted.count() - 1, sorted.count() * percent / 100)];
+}
+
+int main(int argc, char **argv)
+{
+    using namespace KWaylandServer;
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption clientsOption(QStringLiteral("clients"), QStringLiteral("The number of client connections"), QStringLiteral("count"), QStringLiteral("50"));
+    QCommandLineOption threadsOption(QStringLiteral("threads"), QStringLiteral("The number of threads the clients run in"), QStringLiteral("count"), QStringLiteral("4"));
+    QCommandLineOption subsurfacesOption(QStringLiteral("subsurfaces"), QStringLiteral("The number of subsurfaces of every client"), QStringLiteral("count"), QStringLiteral("4"));
+    QCommandLineOption focusOption(QStringLiteral("focus-interval"), QStringLiteral("The interval of pointer and keyboard focus changes, 0 disables them"), QStringLiteral("ms"), QStringLiteral("10"));
+    QCommandLineOption durationOption(QStringLiteral("duration"), QStringLiteral("How long the load is generated"), QStringLiteral("seconds"), QStringLiteral("10"));
+    QCommandLineOption noDataDeviceOption(QStringLiteral("no-data-device"), QStringLiteral("Don't set the selection on keyboard focus"));
+    parser.addOptions({clientsOption, threadsOption, subsurfacesOption, focusOption, durationOption, noDataDeviceOption});
+    parser.process(app);
+
+    Options options;
+    options.clients = std::max(1, parser.value(clientsOption).toInt());
+    options.threads = std::clamp(parser.value(threadsOption).toInt(), 1, options.clients);
+    options.subsurfaces = std::max(0, parser.value(subsurfacesOption).toInt());
+    options.focusInterval = std::max(0, parser.value(focusOption).toInt());
+    options.duration = std::max(1, parser.value(durationOption).toInt());
+    options.dataDevice = !parser.isSet(noDataDeviceOption);
+
+    Display display;
+    if (!display.addSocketName()) {
+        return 1;
+    }
+    display.start();
+    display.createShm();
+    CompositorInterface *compositor = new CompositorInterface(&display, &display);
+    new SubCompositorInterface(&display, &display);
+    new DataDeviceManagerInterface(&display, &display);
+    OutputInterface *output = new OutputInterface(&display, &display);
+    output->setPhysicalSize(QSize(520, 290));
+    output->setMode(QSize(1920, 1080));
+    SeatInterface *seat = new SeatInterface(&display, &display);
+    seat->setHasKeyboard(true);
+    seat->setHasPointer(true);
+    seat->setName(QStringLiteral("seat0"));
+
+    // The server presents every commit right away.
+    QElapsedTimer clock;
+    clock.start();
+    quint64 commitCount = 0;
+    QVector<QPointer<SurfaceInterface>> surfaces;
+    QObject::connect(compositor, &CompositorInterface::surfaceCreated, [&](SurfaceInterface *surface) {
+        surfaces.append(surface);
+        QObject::connect(surface, &SurfaceInterface::committed, surface, [&, surface]() {
+            ++commitCount;
+            surface->frameRendered(clock.elapsed());
+        });
+    });
+
+    // Move the pointer and keyboard focus between the root surfaces of the clients.
+    QTimer focusTimer;
+    int focusIndex = 0;
+    QObject::connect(&focusTimer, &QTimer::timeout, [&]() {
+        surfaces.removeAll(nullptr);
+        for (int i = 0; i < surfaces.count(); ++i) {
+            SurfaceInterface *surface = surfaces[(focusIndex + i) % surfaces.count()];
+            if (surface->subSurface()) {
+                continue;
+            }
+            focusIndex = (focusIndex + i + 1) % surfaces.count();
+            seat->setTimestamp(clock.elapsed());
+            seat->notifyPointerEnter(surface, QPointF(16, 16));
+            seat->notifyPointerMotion(QPointF(17, 17));
+            seat->notifyPointerFrame();
+            seat->setFocusedKeyboardSurface(surface);
+            break;
+        }
+    });
+    if (options.focusInterval > 0) {
+        focusTimer.start(options.focusInterval);
+    }
+
+    LatencyRecorder recorder;
+    QVector<QThread *> threads;
+    for (int i = 0; i < options.threads; ++i) {
+        QThread *thread = new QThread;
+        thread->start();
+        threads.append(thread);
+    }
+    QVector<LoadClient *> clients;
+    for (int i = 0; i < options.clients; ++i) {
+        LoadClient *client = new LoadClient(display.socketNames().first(), options, &recorder);
+        client->moveToThread(threads[i % threads.count()]);
+        QMetaObject::invokeMethod(client, &LoadClient::start, Qt::QueuedConnection);
+        clients.append(client);
+    }
+
+    std::cout << "clients, requests/s, commits/s, handler time/request (us), server busy (%), frame callback latency p50/p99/max (us)" << std::endl;
+
+    BusyTimer busyTimer(QCoreApplication::eventDispatcher());
+    quint64 reportedRequestCount = 0;
+    std::chrono::nanoseconds reportedHandlerTime = std::chrono::nanoseconds::zero();
+    quint64 reportedCommitCount = 0;
+    int elapsedSeconds = 0;
+    QVector<qint64> totalLatencies;
+
+    QTimer reportTimer;
+    QObject::connect(&reportTimer, &QTimer::timeout, [&]() {
+        quint64 requestCount = 0;
+        std::chrono::nanoseconds handlerTime = std::chrono::nanoseconds::zero();
+        const QVector<ClientConnection *> connections = display.connections();
+        for (ClientConnection *connection : connections) {
+            const ClientStatistics statistics = connection->statistics();
+            requestCount += statistics.requestCount;
+            handlerTime += statistics.handlerTime;
+        }
+
+        const quint64 requests = requestCount - reportedRequestCount;
+        const std::chrono::nanoseconds requestsHandlerTime = handlerTime - reportedHandlerTime;
+        const quint64 commits = commitCount - reportedCommitCount;
+        reportedRequestCount = requestCount;
+        reportedHandlerTime = handlerTime;
+        reportedCommitCount = commitCount;
+
+        QVector<qint64> latencies = recorder.take();
+        std::sort(latencies.begin(), latencies.end());
+        totalLatencies.append(latencies);
+
+        std::cout << connections.count() << ", "
+                  << requests << ", "
+                  << commits << ", "
+                  << (requests ? requestsHandlerTime.count() / 1000.0 / requests : 0) << ", "
+                  << busyTimer.take().count() / 1e7 << ", "
+                  << percentile(latencies, 50) << "/" << percentile(latencies, 99) << "/" << (latencies.isEmpty() ? 0 : latencies.last())
+                  << std::endl;
+
+        if (++elapsedSeconds == options.duration) {
+            std::sort(totalLatencies.begin(), totalLatencies.end());
+            std::cout << "total: " << reportedRequestCount << " requests, " << reportedCommitCount << " commits, "
+                      << "frame callback latency p50/p99/max "
+                      << percentile(totalLatencies, 50) << "/" << percentile(totalLatencies, 99) << "/" << (totalLatencies.isEmpty() ? 0 : totalLatencies.last())
+                      << " us" << std::endl;
+            QCoreApplication::quit();
+        }
+    });
+    reportTimer.start(1000);
+
+    const int ret = app.exec();
+
+    for (QThread *thread : std::as_const(threads)) {
+        thread->quit();
+        thread->wait();
+    }
+    qDeleteAll(clients);
+    qDeleteAll(threads);
+    return ret;
+}
+
+#include "loadtest.moc"
@@ -0,0 +1,135 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include "xwaylandshell_v1_interface.h"
+#include "display.h"
+#include "surface_interface.h"
+#include "surfacerole_p.h"
+
+#include "qwayland-server-xwayland-shell-v1.h"
+
+#include <optional>
+
+static const int s_version = 1;
+
+namespace KWaylandServer
+{
+class XwaylandShellV1InterfacePrivate : public QtWaylandServer::xwayland_shell_v1
+{
+public:
+    XwaylandShellV1InterfacePrivate(XwaylandShellV1Interface *q, Display *display);
+
+    XwaylandShellV1Interface *q;
+
+protected:
+    void xwayland_shell_v1_destroy(Resource *resource) override;
+    void xwayland_shell_v1_get_xwayland_surface(Resource *resource, uint32_t id, struct ::wl_resource *surface) override;
+};
+
+class XwaylandSurfaceV1Interface : public SurfaceRole, public QtWaylandServer::xwayland_surface_v1
+{
+public:
+    XwaylandSurfaceV1Interface(XwaylandShellV1Interface *shell, SurfaceInterface *surface, wl_resource *resource);
+
+    void commit() override;
+
+    QPointer<XwaylandShellV1Interface> shell;
+    std::optional<quint64> pendingSerial;
+    bool associated = false;
+
+protected:
+    void xwayland_surface_v1_destroy_resource(Resource *resource) override;
+    void xwayland_surface_v1_set_serial(Resource *resource, uint32_t serial_lo, uint32_t serial_hi) override;
+    void xwayland_surface_v1_destroy(Resource *resource) override;
+};
+
+XwaylandShellV1InterfacePrivate::XwaylandShellV1InterfacePrivate(XwaylandShellV1Interface *q, Display *display)
+    : QtWaylandServer::xwayland_shell_v1(*display, s_version)
+    , q(q)
+{
+}
+
+void XwaylandShellV1InterfacePrivate::xwayland_shell_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void XwaylandShellV1InterfacePrivate::xwayland_shell_v1_get_xwayland_surface(Resource *resource, uint32_t id, struct ::wl_resource *surface_resource)
+{
+    SurfaceInterface *surface = SurfaceInterface::get(surface_resource);
+
+    SurfaceRole *surfaceRole = SurfaceRole::get(surface);
+    if (surfaceRole) {
+        wl_resource_post_error(resource->handle, error_role, "the wl_surface already has a role assigned %s", surfaceRole->name().constData());
+        return;
+    }
+
+    wl_resource *xwaylandSurfaceResource = wl_resource_create(resource->client(), &xwayland_surface_v1_interface, resource->version(), id);
+    if (!xwaylandSurfaceResource) {
+        wl_resource_post_no_memory(resource->handle);
+        return;
+    }
+
+    new XwaylandSurfaceV1Interface(q, surface, xwaylandSurfaceResource);
+}
+
+XwaylandSurfaceV1Interface::XwaylandSurfaceV1Interface(XwaylandShellV1Interface *shell, SurfaceInterface *surface, wl_resource *resource)
+    : SurfaceRole(surface, QByteArrayLiteral("xwayland_surface_v1"))
+    , QtWaylandServer::xwayland_surface_v1(resource)
+    , shell(shell)
+{
+}
+
+void XwaylandSurfaceV1Interface::commit()
+{
+    if (!pendingSerial.has_value()) {
+        return;
+    }
+    const quint64 serial = *pendingSerial;
+    pendingSerial.reset();
+    associated = true;
+    if (shell && surface()) {
+        Q_EMIT shell->surfaceAssociated(surface(), serial);
+    }
+}
+
+void XwaylandSurfaceV1Interface::xwayland_surface_v1_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource)
+    delete this;
+}
+
+void XwaylandSurfaceV1Interface::xwayland_surface_v1_set_serial(Resource *resource, uint32_t serial_lo, uint32_t serial_hi)
+{
+    const quint64 serial = (quint64(serial_hi) << 32) | serial_lo;
+    if (serial == 0) {
+        wl_resource_post_error(resource->handle, error_invalid_serial, "the serial must not be zero");
+        return;
+    }
+    if (associated) {
+        wl_resource_post_error(resource->handle, error_already_associated, "the wl_surface is already associated with an X11 window");
+        return;
+    }
+    pendingSerial = serial;
+}
+
+void XwaylandSurfaceV1Interface::xwayland_surface_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+XwaylandShellV1Interface::XwaylandShellV1Interface(Display *display, QObject *parent)
+    : QObject(parent)
+    , d(new XwaylandShellV1InterfacePrivate(this, display))
+{
+}
+
+XwaylandShellV1Interface::~XwaylandShellV1Interface()
+{
+}
+
+} // namespace KWaylandServer
@@ -0,0 +1,48 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QObject>
+
+namespace KWaylandServer
+{
+class Display;
+class SurfaceInterface;
+class XwaylandShellV1InterfacePrivate;
+
+/**
+ * The XwaylandShellV1Interface is an extension that lets Xwayland tell which X11 window a
+ * wl_surface belongs to by tagging the surface with a serial that is also sent to the X11
+ * window in a @c WL_SURFACE_SERIAL client message. Unlike the resource ids used by
+ * @c WL_SURFACE_ID, the serials are never reused.
+ *
+ * The global must only be announced to the Xwayland client.
+ *
+ * XwaylandShellV1Interface corresponds to the Wayland interface @c xwayland_shell_v1.
+ */
+class KWIN_EXPORT XwaylandShellV1Interface : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit XwaylandShellV1Interface(Display *display, QObject *parent = nullptr);
+    ~XwaylandShellV1Interface() override;
+
+Q_SIGNALS:
+    /**
+     * This signal is emitted when the @p serial has been committed for the @p surface.
+     */
+    void surfaceAssociated(KWaylandServer::SurfaceInterface *surface, quint64 serial);
+
+private:
+    QScopedPointer<XwaylandShellV1InterfacePrivate> d;
+};
+
+} // namespace KWaylandServer
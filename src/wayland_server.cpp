@@ -32,6 +32,7 @@
 #include "wayland/display.h"
 #include "wayland/dpms_interface.h"
 #include "wayland/filtered_display.h"
+#include "wayland/fractionalscale_v1_interface.h"
 #include "wayland/idle_interface.h"
 #include "wayland/idleinhibit_v1_interface.h"
 #include "wayland/inputmethod_v1_interface.h"
@@ -45,6 +46,7 @@
 #include "wayland/plasmavirtualdesktop_interface.h"
 #include "wayland/plasmawindowmanagement_interface.h"
 #include "wayland/pointerconstraints_v1_interface.h"
+#include "wayland/presentationtime_interface.h"
 #include "wayland/pointergestures_v1_interface.h"
 #include "wayland/primaryoutput_v1_interface.h"
 #include "wayland/primaryselectiondevicemanager_v1_interface.h"
@@ -55,12 +57,14 @@
 #include "wayland/shadow_interface.h"
 #include "wayland/subcompositor_interface.h"
 #include "wayland/tablet_v2_interface.h"
+#include "wayland/tearingcontrol_v1_interface.h"
 #include "wayland/viewporter_interface.h"
 #include "wayland/xdgactivation_v1_interface.h"
 #include "wayland/xdgdecoration_v1_interface.h"
 #include "wayland/xdgforeign_v2_interface.h"
 #include "wayland/xdgoutput_v1_interface.h"
 #include "wayland/xdgshell_interface.h"
+#include "wayland/xwaylandshell_v1_interface.h"
 #include "waylandoutput.h"
 #include "waylandoutputdevicev2.h"
 #include "workspace.h"
@@ -154,6 +158,10 @@ public:
             return false;
         }
 
+        if (interfaceName == QByteArrayLiteral("xwayland_shell_v1")) {
+            return client == waylandServer()->xWaylandConnection();
+        }
+
         if (!interfacesBlackList.contains(interfaceName)) {
             return true;
         }
@@ -337,6 +345,12 @@ Output *WaylandServer::findOutput(KWaylandServer::OutputInterface *outputIface)
     return nullptr;
 }
 
+KWaylandServer::OutputInterface *WaylandServer::findWaylandOutput(Output *output) const
+{
+    WaylandOutput *waylandOutput = m_waylandOutputs.value(output);
+    return waylandOutput ? waylandOutput->waylandOutput() : nullptr;
+}
+
 bool WaylandServer::start()
 {
     return m_display->start();
@@ -350,40 +364,95 @@ bool WaylandServer::init(const QString &socketName, InitializationFlags flags)
     return init(flags);
 }
 
-bool WaylandServer::init(InitializationFlags flags)
+void WaylandServer::handleXwaylandSurfaceCreated(SurfaceInterface *surface)
 {
-    m_initFlags = flags;
-    m_compositor = new CompositorInterface(m_display, m_display);
-    connect(m_compositor, &CompositorInterface::surfaceCreated, this, [this](SurfaceInterface *surface) {
-        // check whether we have a Window with the Surface's id
-        Workspace *ws = Workspace::self();
-        if (!ws) {
-            // it's possible that a Surface gets created before Workspace is created
-            return;
-        }
-        if (surface->client() != xWaylandConnection()) {
-            // setting surface is only relevant for Xwayland clients
-            return;
-        }
+    if (surface->client() != xWaylandConnection()) {
+        // setting surface is only relevant for Xwayland clients
+        return;
+    }
 
-        X11Window *window = ws->findClient([surface](const X11Window *window) {
-            return window->pendingSurfaceId() == surface->id();
-        });
-        if (window) {
-            window->setSurface(surface);
-            return;
+    // The surface is bound later if the WL_SURFACE_ID message hasn't been received yet.
+    if (Window *window = m_xwaylandWindowsBySurfaceId.take(surface->id())) {
+        window->setSurface(surface);
+    }
+}
+
+void WaylandServer::handleXwaylandSurfaceAssociated(SurfaceInterface *surface, quint64 serial)
+{
+    if (Window *window = m_xwaylandWindowsBySerial.take(serial)) {
+        window->setSurface(surface);
+        return;
+    }
+
+    // The surface is bound once the WL_SURFACE_SERIAL message is received.
+    m_xwaylandSurfacesBySerial.insert(serial, surface);
+    connect(surface, &SurfaceInterface::aboutToBeDestroyed, this, [this, surface, serial]() {
+        if (m_xwaylandSurfacesBySerial.value(serial) == surface) {
+            m_xwaylandSurfacesBySerial.remove(serial);
         }
+    });
+}
 
-        Unmanaged *unmanaged = ws->findUnmanaged([surface](const Unmanaged *unmanaged) {
-            return unmanaged->pendingSurfaceId() == surface->id();
+void WaylandServer::associateXwaylandSurfaceId(Window *window, quint32 surfaceId)
+{
+    forgetPendingXwaylandWindow(window);
+    if (SurfaceInterface *surface = SurfaceInterface::get(surfaceId, xWaylandConnection())) {
+        window->setSurface(surface);
+        return;
+    }
+    trackPendingXwaylandWindow(window);
+    m_xwaylandWindowsBySurfaceId.insert(surfaceId, window);
+}
+
+void WaylandServer::associateXwaylandSurfaceSerial(Window *window, quint64 serial)
+{
+    forgetPendingXwaylandWindow(window);
+    if (SurfaceInterface *surface = m_xwaylandSurfacesBySerial.take(serial)) {
+        window->setSurface(surface);
+        return;
+    }
+    trackPendingXwaylandWindow(window);
+    m_xwaylandWindowsBySerial.insert(serial, window);
+}
+
+void WaylandServer::trackPendingXwaylandWindow(Window *window)
+{
+    // Entries of windows that go away before they get a surface must not be left behind.
+    if (!m_trackedXwaylandWindows.contains(window)) {
+        m_trackedXwaylandWindows.insert(window);
+        connect(window, &QObject::destroyed, this, [this, window]() {
+            forgetPendingXwaylandWindow(window);
+            m_trackedXwaylandWindows.remove(window);
         });
-        if (unmanaged) {
-            unmanaged->setSurface(surface);
-            return;
+    }
+}
+
+void WaylandServer::forgetPendingXwaylandWindow(Window *window)
+{
+    // A window that is mapped again announces a new surface, the old one won't arrive anymore.
+    for (auto it = m_xwaylandWindowsBySurfaceId.begin(); it != m_xwaylandWindowsBySurfaceId.end();) {
+        if (it.value() == window) {
+            it = m_xwaylandWindowsBySurfaceId.erase(it);
+        } else {
+            ++it;
         }
+    }
+    for (auto it = m_xwaylandWindowsBySerial.begin(); it != m_xwaylandWindowsBySerial.end();) {
+        if (it.value() == window) {
+            it = m_xwaylandWindowsBySerial.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
 
-        // The surface will be bound later when a WL_SURFACE_ID message is received.
-    });
+bool WaylandServer::init(InitializationFlags flags)
+{
+    m_initFlags = flags;
+    m_compositor = new CompositorInterface(m_display, m_display);
+    connect(m_compositor, &CompositorInterface::surfaceCreated, this, &WaylandServer::handleXwaylandSurfaceCreated);
+    m_xwaylandShell = new XwaylandShellV1Interface(m_display, m_display);
+    connect(m_xwaylandShell, &XwaylandShellV1Interface::surfaceAssociated, this, &WaylandServer::handleXwaylandSurfaceAssociated);
 
     m_tabletManagerV2 = new TabletManagerV2Interface(m_display, m_display);
     m_keyboardShortcutsInhibitManager = new KeyboardShortcutsInhibitManagerV1Interface(m_display, m_display);
@@ -408,6 +477,9 @@ bool WaylandServer::init(InitializationFlags flags)
     });
 
     new ViewporterInterface(m_display, m_display);
+    new PresentationTimeInterface(m_display, m_display);
+    new TearingControlManagerV1Interface(m_display, m_display);
+    new FractionalScaleManagerV1Interface(m_display, m_display);
     m_display->createShm();
     m_seat = new SeatInterface(m_display, m_display);
     new PointerGesturesV1Interface(m_display, m_display);
@@ -11,6 +11,7 @@
 
 #include <kwinglobals.h>
 
+#include <QHash>
 #include <QObject>
 #include <QPointer>
 #include <QSet>
@@ -47,6 +48,7 @@ class LinuxDmaBufV1ClientBuffer;
 class TabletManagerV2Interface;
 class KeyboardShortcutsInhibitManagerV1Interface;
 class XdgDecorationManagerV1Interface;
+class XwaylandShellV1Interface;
 }
 
 namespace KWin
@@ -224,6 +226,7 @@ public:
     }
 
     Output *findOutput(KWaylandServer::OutputInterface *output) const;
+    KWaylandServer::OutputInterface *findWaylandOutput(Output *output) const;
 
     /**
      * Returns the first socket name that can be used to connect to this server.
@@ -236,6 +239,19 @@ public:
         return m_xdgActivationIntegration;
     }
 
+    /**
+     * Associates the Xwayland @p window with the surface that has the resource id @p surfaceId,
+     * as announced by a @c WL_SURFACE_ID client message. If the surface doesn't exist yet, the
+     * window gets the surface as soon as it is created.
+     */
+    void associateXwaylandSurfaceId(Window *window, quint32 surfaceId);
+    /**
+     * Associates the Xwayland @p window with the surface that has been tagged with @p serial
+     * through xwayland_shell_v1, as announced by a @c WL_SURFACE_SERIAL client message. The
+     * serial may be committed for the surface before or after the message arrives.
+     */
+    void associateXwaylandSurfaceSerial(Window *window, quint64 serial);
+
 Q_SIGNALS:
     void windowAdded(KWin::Window *);
     void windowRemoved(KWin::Window *);
@@ -255,6 +271,10 @@ private:
     void handleOutputRemoved(Output *output);
     void handleOutputEnabled(Output *output);
     void handleOutputDisabled(Output *output);
+    void handleXwaylandSurfaceCreated(KWaylandServer::SurfaceInterface *surface);
+    void handleXwaylandSurfaceAssociated(KWaylandServer::SurfaceInterface *surface, quint64 serial);
+    void trackPendingXwaylandWindow(Window *window);
+    void forgetPendingXwaylandWindow(Window *window);
 
     class LockScreenPresentationWatcher : public QObject
     {
@@ -291,6 +311,12 @@ private:
     KWaylandServer::XdgForeignV2Interface *m_XdgForeign = nullptr;
     KWaylandServer::PrimaryOutputV1Interface *m_primary = nullptr;
     XdgActivationV1Integration *m_xdgActivationIntegration = nullptr;
+    KWaylandServer::XwaylandShellV1Interface *m_xwaylandShell = nullptr;
+    // Xwayland windows and surfaces that are waiting for their counterpart
+    QHash<quint32, Window *> m_xwaylandWindowsBySurfaceId;
+    QHash<quint64, Window *> m_xwaylandWindowsBySerial;
+    QHash<quint64, KWaylandServer::SurfaceInterface *> m_xwaylandSurfacesBySerial;
+    QSet<Window *> m_trackedXwaylandWindows;
     QList<Window *> m_windows;
     InitializationFlags m_initFlags;
     QHash<Output *, WaylandOutput *> m_waylandOutputs;
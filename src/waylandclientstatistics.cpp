@@ -0,0 +1,75 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "waylandclientstatistics.h"
+#include "wayland/clientconnection.h"
+#include "wayland/display.h"
+#include "wayland_server.h"
+
+#include <QDBusConnection>
+
+#include <algorithm>
+
+namespace KWin
+{
+
+WaylandClientStatisticsDBusInterface::WaylandClientStatisticsDBusInterface(QObject *parent)
+    : QObject(parent)
+{
+    QDBusConnection::sessionBus().registerObject(QStringLiteral("/WaylandClientStatistics"), this,
+                                                 QDBusConnection::ExportScriptableSlots);
+}
+
+WaylandClientStatisticsDBusInterface::~WaylandClientStatisticsDBusInterface()
+{
+    QDBusConnection::sessionBus().unregisterObject(QStringLiteral("/WaylandClientStatistics"));
+}
+
+static double toMilliseconds(std::chrono::nanoseconds duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+QString WaylandClientStatisticsDBusInterface::statistics() const
+{
+    struct Entry
+    {
+        KWaylandServer::ClientConnection *connection;
+        KWaylandServer::ClientStatistics statistics;
+    };
+
+    QVector<Entry> entries;
+    const auto connections = waylandServer()->display()->connections();
+    for (KWaylandServer::ClientConnection *connection : connections) {
+        entries.append(Entry{connection, connection->statistics()});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.statistics.handlerTime > b.statistics.handlerTime;
+    });
+
+    QString report;
+    for (const Entry &entry : qAsConst(entries)) {
+        const KWaylandServer::ClientStatistics &statistics = entry.statistics;
+        report += QStringLiteral("%1 (pid %2): %3 requests, %4 ms in handlers, %5 commits (%6/s), %7 damaged pixels\n")
+                      .arg(entry.connection->executablePath())
+                      .arg(entry.connection->processId())
+                      .arg(statistics.requestCount)
+                      .arg(toMilliseconds(statistics.handlerTime), 0, 'f', 2)
+                      .arg(statistics.commitCount)
+                      .arg(statistics.commitsPerSecond, 0, 'f', 1)
+                      .arg(statistics.damagedArea);
+        for (auto it = statistics.interfaces.constBegin(); it != statistics.interfaces.constEnd(); ++it) {
+            report += QStringLiteral("    %1: %2 requests, %3 ms in handlers\n")
+                          .arg(QString::fromLatin1(it.key()))
+                          .arg(it.value().requestCount)
+                          .arg(toMilliseconds(it.value().handlerTime), 0, 'f', 2);
+        }
+    }
+    return report;
+}
+
+} // namespace KWin
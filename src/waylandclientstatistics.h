@@ -0,0 +1,39 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwinglobals.h"
+
+#include <QObject>
+
+namespace KWin
+{
+
+/**
+ * The WaylandClientStatisticsDBusInterface class exports the request counters of the
+ * connected Wayland clients on the D-Bus as object /WaylandClientStatistics. It helps
+ * finding clients that flood the compositor with requests.
+ */
+class KWIN_EXPORT WaylandClientStatisticsDBusInterface : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.KWin.WaylandClientStatistics")
+
+public:
+    explicit WaylandClientStatisticsDBusInterface(QObject *parent = nullptr);
+    ~WaylandClientStatisticsDBusInterface() override;
+
+public Q_SLOTS:
+    /**
+     * Returns a human readable report of the request counters of all connected clients,
+     * sorted by the time the compositor has spent handling their requests.
+     */
+    Q_SCRIPTABLE QString statistics() const;
+};
+
+} // namespace KWin
@@ -7,6 +7,7 @@
 */
 
 #include "waylandwindow.h"
+#include "output.h"
 #include "platform.h"
 #include "screens.h"
 #include "wayland/clientbuffer.h"
@@ -45,6 +46,8 @@ WaylandWindow::WaylandWindow(SurfaceInterface *surface)
             this, &WaylandWindow::updateShadow);
     connect(this, &WaylandWindow::frameGeometryChanged,
             this, &WaylandWindow::updateClientOutputs);
+    connect(this, &WaylandWindow::screenChanged,
+            this, &WaylandWindow::updateClientOutputs);
     connect(this, &WaylandWindow::desktopFileNameChanged,
             this, &WaylandWindow::updateIcon);
     connect(screens(), &Screens::changed, this, &WaylandWindow::updateClientOutputs);
@@ -162,6 +165,9 @@ bool WaylandWindow::belongsToDesktop() const
 void WaylandWindow::updateClientOutputs()
 {
     surface()->setOutputs(waylandServer()->display()->outputsIntersecting(frameGeometry()));
+    if (output()) {
+        surface()->setPreferredScale(output()->scale());
+    }
 }
 
 void WaylandWindow::updateIcon()
@@ -87,6 +87,29 @@ Window::Window()
     connect(this, &Window::frameGeometryChanged, this, &Window::geometryChanged);
     connect(this, &Window::geometryShapeChanged, this, &Window::discardShapeRegion);
 
+    // Fold the individual geometry change signals into one geometryUpdated() per iteration.
+    connect(this, &Window::frameGeometryChanged, this, [this](Window *, const QRect &old) {
+        if (!m_pendingGeometryUpdate.frameRecorded) {
+            m_pendingGeometryUpdate.frameGeometry = old;
+            m_pendingGeometryUpdate.frameRecorded = true;
+        }
+        recordGeometryUpdate();
+    });
+    connect(this, &Window::bufferGeometryChanged, this, [this](Window *, const QRect &old) {
+        if (!m_pendingGeometryUpdate.bufferRecorded) {
+            m_pendingGeometryUpdate.bufferGeometry = old;
+            m_pendingGeometryUpdate.bufferRecorded = true;
+        }
+        recordGeometryUpdate();
+    });
+    connect(this, &Window::clientGeometryChanged, this, [this](Window *, const QRect &old) {
+        if (!m_pendingGeometryUpdate.clientRecorded) {
+            m_pendingGeometryUpdate.clientGeometry = old;
+            m_pendingGeometryUpdate.clientRecorded = true;
+        }
+        recordGeometryUpdate();
+    });
+
     connect(this, &Window::clientStartUserMovedResized, this, &Window::moveResizedChanged);
     connect(this, &Window::clientFinishUserMovedResized, this, &Window::moveResizedChanged);
 
@@ -120,6 +143,29 @@ Window::Window()
     });
 }
 
+void Window::recordGeometryUpdate()
+{
+    if (m_pendingGeometryUpdate.scheduled) {
+        return;
+    }
+    m_pendingGeometryUpdate.scheduled = true;
+    QMetaObject::invokeMethod(this, &Window::flushGeometryUpdate, Qt::QueuedConnection);
+}
+
+void Window::flushGeometryUpdate()
+{
+    const QRect oldFrameGeometry = m_pendingGeometryUpdate.frameRecorded ? m_pendingGeometryUpdate.frameGeometry : m_frameGeometry;
+    const QRect oldBufferGeometry = m_pendingGeometryUpdate.bufferRecorded ? m_pendingGeometryUpdate.bufferGeometry : m_bufferGeometry;
+    const QRect oldClientGeometry = m_pendingGeometryUpdate.clientRecorded ? m_pendingGeometryUpdate.clientGeometry : m_clientGeometry;
+    m_pendingGeometryUpdate = {};
+
+    // The geometry may have changed back and forth within one iteration.
+    if (oldFrameGeometry == m_frameGeometry && oldBufferGeometry == m_bufferGeometry && oldClientGeometry == m_clientGeometry) {
+        return;
+    }
+    Q_EMIT geometryUpdated(this, oldFrameGeometry, oldBufferGeometry, oldClientGeometry);
+}
+
 Window::~Window()
 {
     Q_ASSERT(m_blockGeometryUpdates == 0);
@@ -394,6 +440,17 @@ void Window::setReadyForPainting()
     }
 }
 
+void Window::refOffscreenRendering()
+{
+    m_offscreenRenderCount++;
+}
+
+void Window::unrefOffscreenRendering()
+{
+    Q_ASSERT(m_offscreenRenderCount > 0);
+    m_offscreenRenderCount--;
+}
+
 void Window::deleteShadow()
 {
     delete m_shadow;
@@ -1103,6 +1160,7 @@ void Window::setDesktops(QVector<VirtualDesktop *> desktops)
     const bool wasOnCurrentDesktop = isOnCurrentDesktop() && was_desk >= 0;
 
     m_desktops = desktops;
+    workspace()->invalidateDesktopStackingOrders();
 
     if (windowManagementInterface()) {
         if (m_desktops.isEmpty()) {
@@ -2239,7 +2297,7 @@ void Window::setupWindowManagementInterface()
     connect(this, &Window::transientChanged, w, [w, this]() {
         w->setParentWindow(transientFor() ? transientFor()->windowManagementInterface() : nullptr);
     });
-    connect(this, &Window::frameGeometryChanged, w, [w, this]() {
+    connect(this, &Window::geometryUpdated, w, [w, this]() {
         w->setGeometry(frameGeometry());
     });
     connect(this, &Window::applicationMenuChanged, w, [w, this]() {
@@ -711,6 +711,13 @@ public:
     static bool resourceMatch(const Window *c1, const Window *c2);
 
     bool readyForPainting() const; // true if the window has been already painted its contents
+    /**
+     * Marks the window as shown outside of the outputs it's on, e.g. in a thumbnail or a
+     * window screencast, so it must keep getting frame callbacks even when it's occluded.
+     */
+    void refOffscreenRendering();
+    void unrefOffscreenRendering();
+    bool isOffscreenRendering() const;
     xcb_visualid_t visual() const;
     bool shape() const;
     QRegion inputShape() const;
@@ -1471,6 +1478,13 @@ Q_SIGNALS:
      * This signal is emitted when the Window's client geometry has changed.
      */
     void clientGeometryChanged(KWin::Window *window, const QRect &oldGeometry);
+    /**
+     * This signal is emitted once per event loop iteration after any of the frame, buffer,
+     * or client geometry has changed. The old geometries are the ones from before the first
+     * change in the batch, so consumers that don't need to track every intermediate step
+     * can connect to this signal instead of the individual ones and run only once.
+     */
+    void geometryUpdated(KWin::Window *window, const QRect &oldFrameGeometry, const QRect &oldBufferGeometry, const QRect &oldClientGeometry);
 
     /**
      * This signal is emitted when the visible geometry has changed.
@@ -1894,9 +1908,23 @@ private:
     // when adding new data members, check also copyToDeleted()
     qreal m_opacity = 1.0;
     int m_stackingOrder = 0;
+    int m_offscreenRenderCount = 0;
 
 private:
     void handlePaletteChange();
+    void recordGeometryUpdate();
+    void flushGeometryUpdate();
+
+    struct
+    {
+        QRect frameGeometry;
+        QRect bufferGeometry;
+        QRect clientGeometry;
+        bool frameRecorded = false;
+        bool bufferRecorded = false;
+        bool clientRecorded = false;
+        bool scheduled = false;
+    } m_pendingGeometryUpdate;
     QSharedPointer<TabBox::TabBoxClientImpl> m_tabBoxClient;
     bool m_firstInTabBox = false;
     bool m_skipTaskbar = false;
@@ -2076,6 +2104,11 @@ inline bool Window::readyForPainting() const
     return ready_for_painting;
 }
 
+inline bool Window::isOffscreenRendering() const
+{
+    return m_offscreenRenderCount > 0;
+}
+
 inline xcb_visualid_t Window::visual() const
 {
     return m_visual;
@@ -21,6 +21,13 @@ WindowPropertyNotifyX11Filter::WindowPropertyNotifyX11Filter(EffectsHandlerImpl
 {
 }
 
+static void invalidate(EffectWindowImpl *window, xcb_atom_t atom)
+{
+    if (window) {
+        window->invalidateProperty(atom);
+    }
+}
+
 bool WindowPropertyNotifyX11Filter::event(xcb_generic_event_t *event)
 {
     const auto *pe = reinterpret_cast<xcb_property_notify_event_t *>(event);
@@ -28,10 +35,13 @@ bool WindowPropertyNotifyX11Filter::event(xcb_generic_event_t *event)
         return false;
     }
     if (pe->window == kwinApp()->x11RootWindow()) {
+        m_effects->invalidateRootProperty(pe->atom);
         Q_EMIT m_effects->propertyNotify(nullptr, pe->atom);
     } else if (const auto c = workspace()->findClient(Predicate::WindowMatch, pe->window)) {
+        invalidate(c->effectWindow(), pe->atom);
         Q_EMIT m_effects->propertyNotify(c->effectWindow(), pe->atom);
     } else if (const auto c = workspace()->findUnmanaged(pe->window)) {
+        invalidate(c->effectWindow(), pe->atom);
         Q_EMIT m_effects->propertyNotify(c->effectWindow(), pe->atom);
     }
     return false;
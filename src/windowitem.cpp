@@ -73,6 +73,16 @@ Window *WindowItem::window() const
     return m_window;
 }
 
+std::chrono::milliseconds WindowItem::lastFrameCallbackTimestamp() const
+{
+    return m_lastFrameCallbackTimestamp;
+}
+
+void WindowItem::setLastFrameCallbackTimestamp(std::chrono::milliseconds timestamp)
+{
+    m_lastFrameCallbackTimestamp = timestamp;
+}
+
 void WindowItem::refVisible(int reason)
 {
     if (reason & PAINT_DISABLED_BY_HIDDEN) {
@@ -118,6 +128,58 @@ void WindowItem::unrefVisible(int reason)
     updateVisibility();
 }
 
+static qint64 surfaceMemoryUsage(const Item *item)
+{
+    qint64 usage = 0;
+    if (const SurfaceItem *surfaceItem = qobject_cast<const SurfaceItem *>(item)) {
+        usage += surfaceItem->pixmapMemoryUsage();
+    }
+    const auto childItems = item->childItems();
+    for (const Item *childItem : childItems) {
+        usage += surfaceMemoryUsage(childItem);
+    }
+    return usage;
+}
+
+static void releaseSurfacePixmaps(Item *item)
+{
+    if (SurfaceItem *surfaceItem = qobject_cast<SurfaceItem *>(item)) {
+        surfaceItem->releasePixmaps();
+    }
+    const auto childItems = item->childItems();
+    for (Item *childItem : childItems) {
+        releaseSurfacePixmaps(childItem);
+    }
+}
+
+qint64 WindowItem::textureMemoryUsage() const
+{
+    if (m_snapshotDropped || !m_surfaceItem) {
+        return 0;
+    }
+    return surfaceMemoryUsage(m_surfaceItem.data());
+}
+
+void WindowItem::dropSnapshot()
+{
+    if (m_snapshotDropped) {
+        return;
+    }
+    m_snapshotDropped = true;
+    updateVisibility();
+
+    if (m_surfaceItem) {
+        releaseSurfacePixmaps(m_surfaceItem.data());
+    }
+    m_decorationItem.reset();
+    m_shadowItem.reset();
+}
+
+bool WindowItem::isSnapshotDropped() const
+{
+    return m_snapshotDropped;
+}
+
 void WindowItem::handleWindowClosed(Window *original, Deleted *deleted)
 {
     Q_UNUSED(original)
@@ -130,7 +192,7 @@ bool WindowItem::computeVisibility() const
         return m_window->isLockScreen() || m_window->isInputMethod();
     }
     if (m_window->isDeleted()) {
-        if (m_forceVisibleByDeleteCount == 0) {
+        if (m_forceVisibleByDeleteCount == 0 || m_snapshotDropped) {
             return false;
         }
     }
@@ -8,6 +8,8 @@
 
 #include "item.h"
 
+#include <chrono>
+
 namespace KDecoration2
 {
 class Decoration;
@@ -52,6 +54,25 @@ public:
     void refVisible(int reason);
     void unrefVisible(int reason);
 
+    /**
+     * Returns an estimate of the number of bytes of texture memory held by the surfaces of
+     * the window.
+     */
+    qint64 textureMemoryUsage() const;
+    /**
+     * Hides the item of a closed window and releases its surface textures, decoration and
+     * shadow, even if effects still keep the window around.
+     */
+    void dropSnapshot();
+    bool isSnapshotDropped() const;
+
+    /**
+     * Returns the timestamp of the last frame callback that has been sent to the surfaces
+     * of the window. It is used to throttle frame callbacks of occluded windows.
+     */
+    std::chrono::milliseconds lastFrameCallbackTimestamp() const;
+    void setLastFrameCallbackTimestamp(std::chrono::milliseconds timestamp);
+
 protected:
     explicit WindowItem(Window *window, Item *parent = nullptr);
     void updateSurfaceItem(SurfaceItem *surfaceItem);
@@ -78,6 +99,8 @@ private:
     int m_forceVisibleByDesktopCount = 0;
     int m_forceVisibleByMinimizeCount = 0;
     int m_forceVisibleByActivityCount = 0;
+    bool m_snapshotDropped = false;
+    std::chrono::milliseconds m_lastFrameCallbackTimestamp = std::chrono::milliseconds::zero();
 };
 
 /**
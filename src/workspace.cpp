@@ -52,6 +52,8 @@
 #include "virtualdesktops.h"
 #include "was_user_interaction_x11_filter.h"
 #include "wayland_server.h"
+#include "waylandclientstatistics.h"
+#include "windowitem.h"
 #include "xwaylandwindow.h"
 // KDE
 #include <KConfig>
@@ -182,6 +184,9 @@ Workspace::Workspace()
     connect(this, &Workspace::configChanged, decorationBridge, &Decoration::DecorationBridge::reconfigure);
 
     new DBusInterface(this);
+    if (waylandServer()) {
+        new WaylandClientStatisticsDBusInterface(this);
+    }
     Outline::create(this);
 
     initShortcuts();
@@ -449,6 +454,8 @@ void Workspace::cleanupX11()
     }
 
     manual_overlays.clear();
+    m_x11Stack.clear();
+    m_clientListStacking.clear();
 
     VirtualDesktopManager *desktopManager = VirtualDesktopManager::self();
     desktopManager->setRootInfo(nullptr);
@@ -586,6 +593,7 @@ void Workspace::addToStack(Window *window)
     }
     if (!stacking_order.contains(window)) {
         stacking_order.append(window);
+        invalidateDesktopStackingOrders();
     }
 }
 
@@ -606,6 +614,7 @@ void Workspace::replaceInStack(Window *original, Deleted *deleted)
         // This can be the case only if an override-redirect window is unmapped.
         stacking_order.append(deleted);
     }
+    invalidateDesktopStackingOrders();
 
     for (Constraint *constraint : qAsConst(m_constraints)) {
         if (constraint->below == original) {
@@ -620,6 +629,7 @@ void Workspace::removeFromStack(Window *window)
 {
     unconstrained_stacking_order.removeAll(window);
     stacking_order.removeAll(window);
+    invalidateDesktopStackingOrders();
 
     for (int i = m_constraints.count() - 1; i >= 0; --i) {
         Constraint *constraint = m_constraints[i];
@@ -696,6 +706,7 @@ void Workspace::addX11Window(X11Window *window)
     }
     m_x11Clients.append(window);
     m_allClients.append(window);
+    addToIndex(window);
     addToStack(window);
     updateClientArea(); // This cannot be in manage(), because the window got added only now
     window->updateLayer();
@@ -718,9 +729,66 @@ void Workspace::addX11Window(X11Window *window)
 void Workspace::addUnmanaged(Unmanaged *window)
 {
     m_unmanaged.append(window);
+    m_unmanagedIndex.insert(window->window(), window);
     addToStack(window);
 }
 
+static xcb_window_t windowIdFor(const X11Window *window, Predicate predicate)
+{
+    switch (predicate) {
+    case Predicate::WindowMatch:
+        return window->window();
+    case Predicate::WrapperIdMatch:
+        return window->wrapperId();
+    case Predicate::FrameIdMatch:
+        return window->frameId();
+    case Predicate::InputIdMatch:
+        return window->inputId();
+    }
+    return XCB_WINDOW_NONE;
+}
+
+static const Predicate s_indexedPredicates[] = {
+    Predicate::WindowMatch,
+    Predicate::WrapperIdMatch,
+    Predicate::FrameIdMatch,
+    Predicate::InputIdMatch,
+};
+
+void Workspace::addToIndex(X11Window *window)
+{
+    for (Predicate predicate : s_indexedPredicates) {
+        const xcb_window_t id = windowIdFor(window, predicate);
+        if (id != XCB_WINDOW_NONE) {
+            m_x11ClientIndex[int(predicate)].insert(id, window);
+        }
+    }
+}
+
+void Workspace::removeFromIndex(X11Window *window)
+{
+    for (Predicate predicate : s_indexedPredicates) {
+        auto &index = m_x11ClientIndex[int(predicate)];
+        const auto it = index.find(windowIdFor(window, predicate));
+        if (it != index.end() && *it == window) {
+            index.erase(it);
+        }
+    }
+}
+
+void Workspace::updateX11WindowInputId(X11Window *window, xcb_window_t oldInputId)
+{
+    auto &index = m_x11ClientIndex[int(Predicate::InputIdMatch)];
+    if (oldInputId != XCB_WINDOW_NONE && index.value(oldInputId) == window) {
+        index.remove(oldInputId);
+    }
+    // The input window may also be created while the window is still being managed
+    const bool indexed = m_x11ClientIndex[int(Predicate::WindowMatch)].value(window->window()) == window;
+    if (indexed && window->inputId() != XCB_WINDOW_NONE) {
+        index.insert(window->inputId(), window);
+    }
+}
+
 /**
  * Destroys the window \a window
  */
@@ -729,6 +797,7 @@ void Workspace::removeX11Window(X11Window *window)
     Q_ASSERT(m_x11Clients.contains(window));
     // TODO: if marked window is removed, notify the marked list
     m_x11Clients.removeAll(window);
+    removeFromIndex(window);
     Group *group = findGroup(window->window());
     if (group != nullptr) {
         group->lostLeader();
@@ -740,6 +809,9 @@ void Workspace::removeUnmanaged(Unmanaged *window)
 {
     Q_ASSERT(m_unmanaged.contains(window));
     m_unmanaged.removeAll(window);
+    if (m_unmanagedIndex.value(window->window()) == window) {
+        m_unmanagedIndex.remove(window->window());
+    }
     removeFromStack(window);
     Q_EMIT unmanagedRemoved(window);
 }
@@ -749,6 +821,47 @@ void Workspace::addDeleted(Deleted *c, Window *orig)
     Q_ASSERT(!deleted.contains(c));
     deleted.append(c);
     replaceInStack(orig, c);
+    enforceDeletedTextureBudget();
+}
+
+static qint64 deletedTextureBudget()
+{
+    static const qint64 budget = [] {
+        bool ok = false;
+        const int megabytes = qEnvironmentVariableIntValue("KWIN_DELETED_TEXTURE_BUDGET", &ok);
+        return qint64(ok ? megabytes : 256) * 1024 * 1024;
+    }();
+    return budget;
+}
+
+void Workspace::enforceDeletedTextureBudget()
+{
+    const qint64 budget = deletedTextureBudget();
+    if (budget <= 0) {
+        return;
+    }
+
+    qint64 usage = 0;
+    for (const Deleted *window : qAsConst(deleted)) {
+        if (const WindowItem *item = window->windowItem()) {
+            usage += item->textureMemoryUsage();
+        }
+    }
+
+    // The most recently closed window is never dropped so its closing animation can be played.
+    for (int i = 0; i < deleted.count() - 1 && usage > budget; ++i) {
+        WindowItem *item = deleted[i]->windowItem();
+        if (!item || item->isSnapshotDropped()) {
+            continue;
+        }
+        const qint64 itemUsage = item->textureMemoryUsage();
+        if (itemUsage == 0) {
+            continue;
+        }
+        qCDebug(KWIN_CORE) << "Dropping snapshot of closed window" << deleted[i] << "to free" << itemUsage << "bytes";
+        item->dropSnapshot();
+        usage -= itemUsage;
+    }
 }
 
 void Workspace::removeDeleted(Deleted *c)
@@ -990,7 +1103,8 @@ void Workspace::slotCurrentDesktopChanged(uint oldDesktop, uint newDesktop)
     closeActivePopup();
     ++block_focus;
     StackingUpdatesBlocker blocker(this);
-    updateWindowVisibilityOnDesktopChange(VirtualDesktopManager::self()->desktopForX11Id(newDesktop));
+    updateWindowVisibilityOnDesktopChange(VirtualDesktopManager::self()->desktopForX11Id(oldDesktop),
+                                          VirtualDesktopManager::self()->desktopForX11Id(newDesktop));
     // Restore the focus on this desktop
     --block_focus;
 
@@ -1009,10 +1123,12 @@ void Workspace::slotCurrentDesktopChangingCancelled()
     Q_EMIT currentDesktopChangingCancelled();
 }
 
-void Workspace::updateWindowVisibilityOnDesktopChange(VirtualDesktop *newDesktop)
+void Workspace::updateWindowVisibilityOnDesktopChange(VirtualDesktop *oldDesktop, VirtualDesktop *newDesktop)
 {
-    for (auto it = stacking_order.constBegin(); it != stacking_order.constEnd(); ++it) {
-        X11Window *c = qobject_cast<X11Window *>(*it);
+    // Only the windows on exactly one of the two desktops change their visibility
+    const QList<Window *> oldStack = oldDesktop ? desktopStackingOrder(oldDesktop) : stacking_order;
+    for (Window *window : oldStack) {
+        X11Window *c = qobject_cast<X11Window *>(window);
         if (!c) {
             continue;
         }
@@ -1029,12 +1145,16 @@ void Workspace::updateWindowVisibilityOnDesktopChange(VirtualDesktop *newDesktop
         m_moveResizeWindow->setDesktops({newDesktop});
     }
 
-    for (int i = stacking_order.size() - 1; i >= 0; --i) {
-        X11Window *c = qobject_cast<X11Window *>(stacking_order.at(i));
+    const QList<Window *> newStack = desktopStackingOrder(newDesktop);
+    for (int i = newStack.size() - 1; i >= 0; --i) {
+        X11Window *c = qobject_cast<X11Window *>(newStack.at(i));
         if (!c) {
             continue;
         }
-        if (c->isOnDesktop(newDesktop) && c->isOnCurrentActivity()) {
+        if (oldDesktop && c->isOnDesktop(oldDesktop)) {
+            continue;
+        }
+        if (c->isOnCurrentActivity()) {
             c->updateVisibility();
         }
     }
@@ -1079,14 +1199,15 @@ Window *Workspace::findWindowToActivateOnDesktop(VirtualDesktop *desktop)
     }
     // from actiavtion.cpp
     if (options->isNextFocusPrefersMouse()) {
-        auto it = stackingOrder().constEnd();
-        while (it != stackingOrder().constBegin()) {
+        const QList<Window *> stack = desktopStackingOrder(desktop);
+        auto it = stack.constEnd();
+        while (it != stack.constBegin()) {
             auto window = *(--it);
             if (!window->isClient()) {
                 continue;
             }
 
-            if (!(!window->isShade() && window->isShown() && window->isOnDesktop(desktop) && window->isOnCurrentActivity() && window->isOnActiveOutput())) {
+            if (!(!window->isShade() && window->isShown() && window->isOnCurrentActivity() && window->isOnActiveOutput())) {
                 continue;
             }
 
@@ -1101,6 +1222,30 @@ Window *Workspace::findWindowToActivateOnDesktop(VirtualDesktop *desktop)
     return FocusChain::self()->getForActivation(desktop);
 }
 
+/**
+ * Returns the windows of the stacking order that are on the given @p desktop, with the
+ * topmost window at the last position.
+ */
+QList<Window *> Workspace::desktopStackingOrder(VirtualDesktop *desktop)
+{
+    auto it = m_desktopStackingOrders.find(desktop);
+    if (it == m_desktopStackingOrders.end()) {
+        QList<Window *> windows;
+        for (Window *window : qAsConst(stacking_order)) {
+            if (window->isOnDesktop(desktop)) {
+                windows.append(window);
+            }
+        }
+        it = m_desktopStackingOrders.insert(desktop, windows);
+    }
+    return *it;
+}
+
+void Workspace::invalidateDesktopStackingOrders()
+{
+    m_desktopStackingOrders.clear();
+}
+
 /**
  * Updates the current activity when it changes
  * do *not* call this directly; it does not set the activity.
@@ -1242,6 +1387,7 @@ void Workspace::slotDesktopRemoved(VirtualDesktop *desktop)
         }
     }
 
+    invalidateDesktopStackingOrders();
     updateClientArea();
     Placement::self()->reinitCascading(0);
     FocusChain::self()->removeDesktop(desktop);
@@ -1776,32 +1922,22 @@ Unmanaged *Workspace::findUnmanaged(std::function<bool(const Unmanaged *)> func)
 
 Unmanaged *Workspace::findUnmanaged(xcb_window_t w) const
 {
-    return findUnmanaged([w](const Unmanaged *u) {
-        return u->window() == w;
-    });
+    if (w == XCB_WINDOW_NONE) {
+        return nullptr;
+    }
+    Unmanaged *window = m_unmanagedIndex.value(w);
+    Q_ASSERT(!window || window->window() == w);
+    return window;
 }
 
 X11Window *Workspace::findClient(Predicate predicate, xcb_window_t w) const
 {
-    switch (predicate) {
-    case Predicate::WindowMatch:
-        return findClient([w](const X11Window *c) {
-            return c->window() == w;
-        });
-    case Predicate::WrapperIdMatch:
-        return findClient([w](const X11Window *c) {
-            return c->wrapperId() == w;
-        });
-    case Predicate::FrameIdMatch:
-        return findClient([w](const X11Window *c) {
-            return c->frameId() == w;
-        });
-    case Predicate::InputIdMatch:
-        return findClient([w](const X11Window *c) {
-            return c->inputId() == w;
-        });
+    if (w == XCB_WINDOW_NONE) {
+        return nullptr;
     }
-    return nullptr;
+    X11Window *window = m_x11ClientIndex[int(predicate)].value(w);
+    Q_ASSERT(!window || windowIdFor(window, predicate) == w);
+    return window;
 }
 
 Window *Workspace::findToplevel(std::function<bool(const Window *)> func) const
@@ -2213,6 +2349,31 @@ void Workspace::updateClientArea()
     }
 
     if (m_workAreas != workAreas || m_restrictedAreas != restrictedAreas || m_screenAreas != screenAreas) {
+        // Find the desktop and output cells that have changed, only the windows in those
+        // cells need to be moved back into their client area
+        QSet<const VirtualDesktop *> changedWorkAreas;
+        QHash<const VirtualDesktop *, QVector<const Output *>> changedScreenAreas;
+        for (const VirtualDesktop *desktop : desktops) {
+            if (m_workAreas.value(desktop) != workAreas.value(desktop)
+                || m_restrictedAreas.value(desktop) != restrictedAreas.value(desktop)) {
+                changedWorkAreas.insert(desktop);
+                continue;
+            }
+            const QHash<const Output *, QRect> oldScreenAreas = m_screenAreas.value(desktop);
+            const QHash<const Output *, QRect> &newScreenAreas = screenAreas[desktop];
+            if (oldScreenAreas.count() != newScreenAreas.count()) {
+                changedWorkAreas.insert(desktop);
+                continue;
+            }
+            for (auto it = newScreenAreas.constBegin(); it != newScreenAreas.constEnd(); ++it) {
+                if (oldScreenAreas.value(it.key()) != it.value()) {
+                    changedScreenAreas[desktop].append(it.key());
+                }
+            }
+        }
+        // Desktops that have been removed are not relevant anymore
+        const bool desktopsChanged = m_workAreas.count() != workAreas.count();
+
         m_workAreas = workAreas;
         m_screenAreas = screenAreas;
 
@@ -2223,6 +2384,9 @@ void Workspace::updateClientArea()
         if (rootInfo()) {
             NETRect r;
             for (VirtualDesktop *desktop : desktops) {
+                if (!desktopsChanged && !changedWorkAreas.contains(desktop)) {
+                    continue;
+                }
                 const QRect &workArea = m_workAreas[desktop];
                 r.pos.x = workArea.x();
                 r.pos.y = workArea.y();
@@ -2232,8 +2396,28 @@ void Workspace::updateClientArea()
             }
         }
 
+        // Added desktops show up as changed cells, and windows on removed desktops have been
+        // moved to another desktop already, so the remaining windows don't need to be checked.
+        const auto isAffected = [&](const Window *window) {
+            const QVector<VirtualDesktop *> windowDesktops = window->isOnAllDesktops() ? desktops : window->desktops();
+            for (const VirtualDesktop *desktop : windowDesktops) {
+                if (changedWorkAreas.contains(desktop)) {
+                    return true;
+                }
+                const QVector<const Output *> outputs = changedScreenAreas.value(desktop);
+                for (const Output *output : outputs) {
+                    if (window->output() == output || window->frameGeometry().intersects(output->geometry())) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+
         for (auto it = m_allClients.constBegin(); it != m_allClients.constEnd(); ++it) {
-            (*it)->checkWorkspacePosition();
+            if (isAffected(*it)) {
+                (*it)->checkWorkspacePosition();
+            }
         }
 
         m_oldRestrictedAreas.clear(); // reset, no longer valid or needed
@@ -18,10 +18,12 @@
 #include "sm.h"
 #include "utils/common.h"
 // Qt
+#include <QHash>
 #include <QStringList>
 #include <QTimer>
 #include <QVector>
 // std
+#include <array>
 #include <functional>
 #include <memory>
 
@@ -206,6 +208,11 @@ public:
     void resetUpdateToolWindowsTimer();
     void restoreSessionStackingOrder(X11Window *window);
     void updateStackingOrder(bool propagate_new_windows = false);
+    /**
+     * Drops the cached per-desktop views of the stacking order, needs to be called
+     * when the stacking order or the desktops of a window change.
+     */
+    void invalidateDesktopStackingOrders();
     void forceRestacking();
 
     void constrain(Window *below, Window *above);
@@ -252,6 +259,7 @@ public:
     }
 
     void stackScreenEdgesUnderOverrideRedirect();
+    void invalidateX11Stack();
 
     SessionManager *sessionManager() const;
 
@@ -344,8 +352,18 @@ public:
     int unconstainedStackingOrderIndex(const X11Window *c) const;
 
     void removeUnmanaged(Unmanaged *); // Only called from Unmanaged::release()
+    /**
+     * Updates the lookup by input window id after the decoration input window of the
+     * given @p window has been replaced, @p oldInputId is the previous input window id.
+     */
+    void updateX11WindowInputId(X11Window *window, xcb_window_t oldInputId);
     void removeDeleted(Deleted *);
     void addDeleted(Deleted *, Window *);
+    /**
+     * Drops the snapshots of the oldest closed windows until the textures held by the
+     * remaining ones fit in the budget set by KWIN_DELETED_TEXTURE_BUDGET (in MiB).
+     */
+    void enforceDeletedTextureBudget();
 
     bool checkStartupNotification(xcb_window_t w, KStartupInfoId &id, KStartupInfoData &data);
 
@@ -576,6 +594,8 @@ private:
     void setupWindowConnections(Window *window);
     Unmanaged *createUnmanaged(xcb_window_t windowId);
     void addUnmanaged(Unmanaged *c);
+    void addToIndex(X11Window *window);
+    void removeFromIndex(X11Window *window);
 
     void addWaylandWindow(Window *window);
     void removeWaylandWindow(Window *window);
@@ -583,9 +603,10 @@ private:
     //---------------------------------------------------------------------
 
     void closeActivePopup();
-    void updateWindowVisibilityOnDesktopChange(VirtualDesktop *newDesktop);
+    void updateWindowVisibilityOnDesktopChange(VirtualDesktop *oldDesktop, VirtualDesktop *newDesktop);
     void activateWindowOnNewDesktop(VirtualDesktop *desktop);
     Window *findWindowToActivateOnDesktop(VirtualDesktop *desktop);
+    QList<Window *> desktopStackingOrder(VirtualDesktop *desktop);
     void removeWindow(Window *window);
 
     struct Constraint
@@ -621,12 +642,19 @@ private:
     QList<X11Window *> m_x11Clients;
     QList<Window *> m_allClients;
     QList<Unmanaged *> m_unmanaged;
+    // Lookup of the managed X11 windows by each of the window ids in Predicate
+    std::array<QHash<xcb_window_t, X11Window *>, 4> m_x11ClientIndex;
+    QHash<xcb_window_t, Unmanaged *> m_unmanagedIndex;
     QList<Deleted *> deleted;
     QList<InternalWindow *> m_internalWindows;
 
     QList<Window *> unconstrained_stacking_order; // Topmost last
     QList<Window *> stacking_order; // Topmost last
+    // The windows of stacking_order that are on a desktop, built when needed
+    QHash<const VirtualDesktop *, QList<Window *>> m_desktopStackingOrders;
     QVector<xcb_window_t> manual_overlays; // Topmost last
+    QVector<xcb_window_t> m_x11Stack; // The stack sent to the X server last time, topmost first
+    QVector<xcb_window_t> m_clientListStacking; // Topmost last
     bool force_restacking;
     QList<Window *> should_get_focus; // Last is most recent
     QList<Window *> attention_chain;
@@ -26,6 +26,7 @@
 #include "group.h"
 #include "netinfo.h"
 #include "platform.h"
+#include "renderloop.h"
 #include "screenedge.h"
 #include "shadow.h"
 #include "surfaceitem_x11.h"
@@ -52,6 +53,7 @@
 #include <unistd.h>
 // c++
 #include <csignal>
+#include <limits>
 
 // Put all externs before the namespace statement to allow the linker
 // to resolve them properly
@@ -206,6 +208,9 @@ X11Window::X11Window()
     m_syncRequest.lastTimestamp = xTime();
     m_syncRequest.isPending = false;
     m_syncRequest.interactiveResize = false;
+    m_syncRequest.extended = false;
+    m_syncRequest.frameValue.hi = m_syncRequest.frameValue.lo = 0;
+    m_syncRequest.frameDrawnPending = false;
 
     // Set the initial mapping state
     mapping_state = Withdrawn;
@@ -416,6 +421,7 @@ bool X11Window::manage(xcb_window_t w, bool isMapped)
     auto activitiesCookie = fetchActivities();
     auto applicationMenuServiceNameCookie = fetchApplicationMenuServiceName();
     auto applicationMenuObjectPathCookie = fetchApplicationMenuObjectPath();
+    auto syncCounterCookie = fetchSyncCounter();
 
     m_geometryHints.init(window());
     m_motif.init(window());
@@ -434,7 +440,7 @@ bool X11Window::manage(xcb_window_t w, bool isMapped)
     getResourceClass();
     readWmClientLeader(wmClientLeaderCookie);
     getWmClientMachine();
-    getSyncCounter();
+    readSyncCounter(syncCounterCookie);
     // First only read the caption text, so that setupWindowRules() can use it for matching,
     // and only then really set the caption using setCaption(), which checks for duplicates etc.
     // and also relies on rules already existing
@@ -464,7 +470,9 @@ bool X11Window::manage(xcb_window_t w, bool isMapped)
         desktopFileName = info->gtkApplicationId();
     }
     setDesktopFileName(rules()->checkDesktopFile(desktopFileName, true).toUtf8());
-    getIcons();
+    // Decoding the icons can take a while, don't hold back mapping the window for it. The
+    // decoration and the task switcher pick up the icons with iconChanged()
+    QMetaObject::invokeMethod(this, &X11Window::getIcons, Qt::QueuedConnection);
     connect(this, &X11Window::desktopFileNameChanged, this, &X11Window::getIcons);
 
     m_geometryHints.read();
@@ -1085,7 +1093,11 @@ void X11Window::updateInputWindow()
     }
 
     if (region.isEmpty()) {
-        m_decoInputExtent.reset();
+        if (m_decoInputExtent.isValid()) {
+            const xcb_window_t oldInputId = m_decoInputExtent;
+            m_decoInputExtent.reset();
+            workspace()->updateX11WindowInputId(this, oldInputId);
+        }
         return;
     }
 
@@ -1103,6 +1115,7 @@ void X11Window::updateInputWindow()
         const uint32_t values[] = {true,
                                    XCB_EVENT_MASK_ENTER_WINDOW | XCB_EVENT_MASK_LEAVE_WINDOW | XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE | XCB_EVENT_MASK_POINTER_MOTION};
         m_decoInputExtent.create(bounds, XCB_WINDOW_CLASS_INPUT_ONLY, mask, values);
+        workspace()->updateX11WindowInputId(this, XCB_WINDOW_NONE);
         if (mapping_state == Mapped) {
             m_decoInputExtent.map();
         }
@@ -1171,7 +1184,11 @@ void X11Window::destroyDecoration()
             Q_EMIT geometryShapeChanged(this, oldgeom);
         }
     }
-    m_decoInputExtent.reset();
+    if (m_decoInputExtent.isValid()) {
+        const xcb_window_t oldInputId = m_decoInputExtent;
+        m_decoInputExtent.reset();
+        workspace()->updateX11WindowInputId(this, oldInputId);
+    }
 }
 
 void X11Window::maybeCreateX11DecorationRenderer()
@@ -2266,23 +2283,54 @@ bool X11Window::wantsSyncCounter() const
     return true;
 }
 
-void X11Window::getSyncCounter()
+Xcb::Property X11Window::fetchSyncCounter() const
 {
-    if (!Xcb::Extensions::self()->isSyncAvailable()) {
-        return;
+    if (!Xcb::Extensions::self()->isSyncAvailable() || !wantsSyncCounter()) {
+        return Xcb::Property();
     }
-    if (!wantsSyncCounter()) {
+    return Xcb::Property(false, window(), atoms->net_wm_sync_request_counter, XCB_ATOM_CARDINAL, 0, 2);
+}
+
+void X11Window::getSyncCounter()
+{
+    Xcb::Property property = fetchSyncCounter();
+    readSyncCounter(property);
+}
+
+void X11Window::readSyncCounter(Xcb::Property &property)
+{
+    // If the client lists a second counter, it's the extended counter of the frame synchronization
+    // protocol, which is used instead of the basic one
+    const xcb_sync_counter_t *counters = property.value<const xcb_sync_counter_t *>();
+    if (!counters) {
         return;
     }
-
-    Xcb::Property syncProp(false, window(), atoms->net_wm_sync_request_counter, XCB_ATOM_CARDINAL, 0, 1);
-    const xcb_sync_counter_t counter = syncProp.value<xcb_sync_counter_t>(XCB_NONE);
+    const bool extended = xcb_get_property_value_length(property.data()) >= int(2 * sizeof(xcb_sync_counter_t))
+        && counters[1] != XCB_NONE;
+    const xcb_sync_counter_t counter = extended ? counters[1] : counters[0];
     if (counter != XCB_NONE) {
-        m_syncRequest.counter = counter;
-        m_syncRequest.value.hi = 0;
-        m_syncRequest.value.lo = 0;
         auto *c = kwinApp()->x11Connection();
-        xcb_sync_set_counter(c, m_syncRequest.counter, m_syncRequest.value);
+        if (m_syncRequest.alarm != XCB_NONE && m_syncRequest.counter != counter) {
+            xcb_sync_destroy_alarm(c, m_syncRequest.alarm);
+            m_syncRequest.alarm = XCB_NONE;
+        }
+        m_syncRequest.counter = counter;
+        m_syncRequest.extended = extended;
+        m_syncRequest.frameDrawnPending = false;
+        if (extended) {
+            // The value of the extended counter is owned by the client
+            ScopedCPointer<xcb_sync_query_counter_reply_t> reply(xcb_sync_query_counter_reply(c, xcb_sync_query_counter_unchecked(c, counter), nullptr));
+            if (!reply.isNull()) {
+                m_syncRequest.frameValue = reply->counter_value;
+            } else {
+                m_syncRequest.frameValue.hi = m_syncRequest.frameValue.lo = 0;
+            }
+            m_syncRequest.value = m_syncRequest.frameValue;
+        } else {
+            m_syncRequest.value.hi = 0;
+            m_syncRequest.value.lo = 0;
+            xcb_sync_set_counter(c, m_syncRequest.counter, m_syncRequest.value);
+        }
         if (m_syncRequest.alarm == XCB_NONE) {
             const uint32_t mask = XCB_SYNC_CA_COUNTER | XCB_SYNC_CA_VALUE_TYPE | XCB_SYNC_CA_TEST_TYPE | XCB_SYNC_CA_EVENTS;
             const uint32_t values[] = {
@@ -2308,6 +2356,38 @@ void X11Window::getSyncCounter()
     }
 }
 
+static int64_t syncValueToInt64(const xcb_sync_int64_t &value)
+{
+    return (int64_t(value.hi) << 32) | value.lo;
+}
+
+static xcb_sync_int64_t syncValueFromInt64(int64_t value)
+{
+    xcb_sync_int64_t syncValue;
+    syncValue.hi = int32_t(value >> 32);
+    syncValue.lo = uint32_t(value);
+    return syncValue;
+}
+
+static void sendFrameSyncMessage(xcb_window_t window, xcb_atom_t type, int64_t counterValue,
+                                 uint32_t data2, uint32_t data3, uint32_t data4)
+{
+    xcb_client_message_event_t ev;
+    static_assert(sizeof(ev) == 32, "Would leak stack data otherwise");
+    memset(&ev, 0, sizeof(ev));
+    ev.response_type = XCB_CLIENT_MESSAGE;
+    ev.window = window;
+    ev.type = type;
+    ev.format = 32;
+    ev.data.data32[0] = uint32_t(counterValue);
+    ev.data.data32[1] = uint32_t(counterValue >> 32);
+    ev.data.data32[2] = data2;
+    ev.data.data32[3] = data3;
+    ev.data.data32[4] = data4;
+    xcb_send_event(kwinApp()->x11Connection(), false, window, 0, reinterpret_cast<const char *>(&ev));
+    xcb_flush(kwinApp()->x11Connection());
+}
+
 /**
  * Send the client a _NET_SYNC_REQUEST
  */
@@ -2332,6 +2412,8 @@ void X11Window::sendSyncRequest()
             m_syncRequest.interactiveResize = false;
             m_syncRequest.counter = XCB_NONE;
             m_syncRequest.alarm = XCB_NONE;
+            m_syncRequest.extended = false;
+            m_syncRequest.frameDrawnPending = false;
             delete m_syncRequest.timeout;
             delete m_syncRequest.failsafeTimeout;
             m_syncRequest.timeout = nullptr;
@@ -2344,13 +2426,22 @@ void X11Window::sendSyncRequest()
     // see events.cpp X11Window::syncEvent()
     m_syncRequest.failsafeTimeout->start(ready_for_painting ? 10000 : 1000);
 
-    // We increment before the notify so that after the notify
-    // syncCounterSerial will equal the value we are expecting
-    // in the acknowledgement
-    const uint32_t oldLo = m_syncRequest.value.lo;
-    m_syncRequest.value.lo++;
-    if (oldLo > m_syncRequest.value.lo) {
-        m_syncRequest.value.hi++;
+    if (m_syncRequest.extended) {
+        // The client advances the extended counter on its own with every frame, so ask for an
+        // even value far enough ahead that the frames already in flight can't reach it. The
+        // increment is suggested by the spec, one second of frames at 60Hz.
+        int64_t value = syncValueToInt64(m_syncRequest.frameValue) + 240;
+        value += value % 2;
+        m_syncRequest.value = syncValueFromInt64(value);
+    } else {
+        // We increment before the notify so that after the notify
+        // syncCounterSerial will equal the value we are expecting
+        // in the acknowledgement
+        const uint32_t oldLo = m_syncRequest.value.lo;
+        m_syncRequest.value.lo++;
+        if (oldLo > m_syncRequest.value.lo) {
+            m_syncRequest.value.hi++;
+        }
     }
     if (m_syncRequest.lastTimestamp >= xTime()) {
         updateXTime();
@@ -2828,6 +2919,87 @@ void X11Window::handleSync()
     }
 }
 
+void X11Window::handleSyncAlarm(const xcb_sync_int64_t &counterValue)
+{
+    if (!m_syncRequest.extended) {
+        if (counterValue.hi == m_syncRequest.value.hi && counterValue.lo == m_syncRequest.value.lo) {
+            handleSync();
+        }
+        return;
+    }
+
+    m_syncRequest.frameValue = counterValue;
+    const int64_t value = syncValueToInt64(counterValue);
+    if (value % 2) {
+        return; // the client has started drawing a frame
+    }
+    if (m_syncRequest.isPending && value >= syncValueToInt64(m_syncRequest.value)) {
+        handleSync();
+    }
+    queueFrameDrawn();
+}
+
+void X11Window::queueFrameDrawn()
+{
+    m_syncRequest.frameDrawnPending = true;
+
+    // The client won't draw another frame until it gets _NET_WM_FRAME_DRAWN, don't hold it
+    // up if the compositor isn't going to paint the window
+    const X11Compositor *compositor = X11Compositor::self();
+    if (!Compositor::compositing() || !isShown() || !isOnCurrentDesktop() || !isOnCurrentActivity()
+        || (compositor && compositor->unredirectedWindow() == this)) {
+        sendFrameDrawn(nullptr);
+        return;
+    }
+    Compositor::self()->scheduleRepaint();
+}
+
+void X11Window::sendFrameDrawn(RenderLoop *renderLoop)
+{
+    if (!m_syncRequest.frameDrawnPending) {
+        return;
+    }
+    m_syncRequest.frameDrawnPending = false;
+
+    // The timestamps of the protocol are in microseconds of the monotonic clock, which is
+    // also what the render loop uses
+    const std::chrono::microseconds drawnTime =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch());
+    const int64_t counterValue = syncValueToInt64(m_syncRequest.frameValue);
+    sendFrameSyncMessage(window(), atoms->net_wm_frame_drawn, counterValue,
+                         uint32_t(drawnTime.count()), uint32_t(drawnTime.count() >> 32), 0);
+
+    if (renderLoop) {
+        m_framesAwaitingTimings.append(DrawnFrame{counterValue, drawnTime});
+        if (!m_frameTimingsConnection) {
+            m_frameTimingsConnection = connect(renderLoop, &RenderLoop::framePresented, this, &X11Window::sendFrameTimings);
+        }
+    }
+}
+
+void X11Window::sendFrameTimings(RenderLoop *renderLoop, std::chrono::nanoseconds timestamp)
+{
+    disconnect(m_frameTimingsConnection);
+    m_frameTimingsConnection = QMetaObject::Connection();
+
+    const std::chrono::microseconds presentationTime = std::chrono::duration_cast<std::chrono::microseconds>(timestamp);
+    const int refreshRate = renderLoop->refreshRate();
+    const uint32_t refreshInterval = refreshRate > 0 ? 1000000000 / refreshRate : 0;
+
+    for (const DrawnFrame &frame : std::as_const(m_framesAwaitingTimings)) {
+        // An offset of zero means that the presentation time is unknown
+        int64_t offset = (presentationTime - frame.drawnTime).count();
+        if (offset == 0) {
+            offset = 1;
+        } else if (offset < std::numeric_limits<int32_t>::min() || offset > std::numeric_limits<int32_t>::max()) {
+            offset = 0;
+        }
+        sendFrameSyncMessage(window(), atoms->net_wm_frame_timings, frame.counterValue,
+                             uint32_t(int32_t(offset)), refreshInterval, 0);
+    }
+    m_framesAwaitingTimings.clear();
+}
+
 void X11Window::performInteractiveResize()
 {
     resize(moveResizeGeometry().size());
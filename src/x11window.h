@@ -23,6 +23,8 @@
 // X
 #include <xcb/sync.h>
 
+#include <chrono>
+
 // TODO: Cleanup the order of things in this .h file
 
 class QTimer;
@@ -32,6 +34,8 @@ class KStartupInfoId;
 namespace KWin
 {
 
+class RenderLoop;
+
 /**
  * @brief Defines Predicates on how to search for a Client.
  *
@@ -296,6 +300,9 @@ public:
         QTimer *timeout, *failsafeTimeout;
         bool isPending;
         bool interactiveResize;
+        bool extended; // counter is the extended counter of the frame synchronization protocol
+        xcb_sync_int64_t frameValue; // the last value of the extended counter
+        bool frameDrawnPending;
     };
     const SyncRequest &syncRequest() const
     {
@@ -303,7 +310,13 @@ public:
     }
     virtual bool wantsSyncCounter() const;
     void handleSync();
+    void handleSyncAlarm(const xcb_sync_int64_t &counterValue);
     void handleSyncTimeout();
+    /**
+     * Sends _NET_WM_FRAME_DRAWN if the client has finished a frame since the last one, the
+     * frame timings are sent once @a renderLoop has presented the composited frame.
+     */
+    void sendFrameDrawn(RenderLoop *renderLoop);
 
     bool allowWindowActivation(xcb_timestamp_t time = -1U, bool focus_in = false,
                                bool ignore_desktop = false);
@@ -404,7 +417,11 @@ private:
     NETExtendedStrut strut() const;
     int checkShadeGeometry(int w, int h);
     void getSyncCounter();
+    Xcb::Property fetchSyncCounter() const;
+    void readSyncCounter(Xcb::Property &property);
     void sendSyncRequest();
+    void queueFrameDrawn();
+    void sendFrameTimings(RenderLoop *renderLoop, std::chrono::nanoseconds timestamp);
     void leaveInteractiveMoveResize() override;
     void performInteractiveResize();
     void establishCommandWindowGrab(uint8_t button);
@@ -510,6 +527,13 @@ private:
     NET::Actions allowed_actions;
     bool shade_geometry_change;
     SyncRequest m_syncRequest;
+    struct DrawnFrame
+    {
+        int64_t counterValue;
+        std::chrono::microseconds drawnTime;
+    };
+    QVector<DrawnFrame> m_framesAwaitingTimings;
+    QMetaObject::Connection m_frameTimingsConnection;
     static bool check_active_modal; ///< \see X11Window::checkActiveModal()
     int sm_stacking_order;
     friend struct ResetupRulesProcedure;
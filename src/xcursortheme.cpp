@@ -10,6 +10,7 @@
 #include <KConfig>
 #include <KConfigGroup>
 
+#include <QCache>
 #include <QDir>
 #include <QFile>
 #include <QSharedData>
@@ -29,10 +30,14 @@ public:
 class KXcursorThemePrivate : public QSharedData
 {
 public:
-    void load(const QString &themeName, int size, qreal devicePixelRatio);
-    void loadCursors(const QString &packagePath, int size, qreal devicePixelRatio);
-
-    QHash<QByteArray, QVector<KXcursorSprite>> registry;
+    void load(const QString &themeName);
+    void loadCursors(const QString &packagePath);
+
+    // The cursor files that provide a shape, in the order of preference. The sprites are
+    // only decoded when the shape is requested for the first time.
+    QHash<QByteArray, QStringList> registry;
+    int size = 0;
+    qreal devicePixelRatio = 1;
 };
 
 KXcursorSprite::KXcursorSprite()
@@ -104,33 +109,52 @@ static QVector<KXcursorSprite> loadCursor(const QString &filePath, int desiredSi
     return sprites;
 }
 
-void KXcursorThemePrivate::loadCursors(const QString &packagePath, int size, qreal devicePixelRatio)
+struct KXcursorCacheKey
+{
+    QString filePath;
+    int size;
+    qreal devicePixelRatio;
+
+    bool operator==(const KXcursorCacheKey &other) const
+    {
+        return filePath == other.filePath && size == other.size && devicePixelRatio == other.devicePixelRatio;
+    }
+};
+
+static uint qHash(const KXcursorCacheKey &key, uint seed = 0)
+{
+    return qHash(key.filePath, seed) ^ qHash(key.size, seed) ^ qHash(key.devicePixelRatio, seed);
+}
+
+// The decoded cursors of all themes, sizes and scale factors, with the size in bytes as cost.
+// The least recently used cursors are evicted first.
+static QCache<KXcursorCacheKey, QVector<KXcursorSprite>> s_cursorCache(8 * 1024 * 1024);
+
+static QVector<KXcursorSprite> loadCachedCursor(const QString &filePath, int size, qreal devicePixelRatio)
+{
+    const KXcursorCacheKey key{filePath, size, devicePixelRatio};
+    if (const QVector<KXcursorSprite> *sprites = s_cursorCache.object(key)) {
+        return *sprites;
+    }
+
+    const QVector<KXcursorSprite> sprites = loadCursor(filePath, size, devicePixelRatio);
+    qsizetype cost = 0;
+    for (const KXcursorSprite &sprite : sprites) {
+        cost += sprite.data().sizeInBytes();
+    }
+    s_cursorCache.insert(key, new QVector<KXcursorSprite>(sprites), std::max<qsizetype>(cost, 1));
+    return sprites;
+}
+
+void KXcursorThemePrivate::loadCursors(const QString &packagePath)
 {
     const QDir dir(packagePath);
-    QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
-    std::partition(entries.begin(), entries.end(), [](const QFileInfo &fileInfo) {
-        return !fileInfo.isSymLink();
-    });
+    const QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
 
-    for (const QFileInfo &entry : std::as_const(entries)) {
+    for (const QFileInfo &entry : entries) {
         const QByteArray shape = QFile::encodeName(entry.fileName());
-        if (registry.contains(shape)) {
-            continue;
-        }
-        if (entry.isSymLink()) {
-            const QFileInfo symLinkInfo(entry.symLinkTarget());
-            if (symLinkInfo.absolutePath() == entry.absolutePath()) {
-                const auto sprites = registry.value(QFile::encodeName(symLinkInfo.fileName()));
-                if (!sprites.isEmpty()) {
-                    registry.insert(shape, sprites);
-                    continue;
-                }
-            }
-        }
-        const QVector<KXcursorSprite> sprites = loadCursor(entry.absoluteFilePath(), size, devicePixelRatio);
-        if (!sprites.isEmpty()) {
-            registry.insert(shape, sprites);
-        }
+        // Aliases are usually symlinks, they share the decoded sprites of the target.
+        registry[shape].append(entry.isSymLink() ? entry.symLinkTarget() : entry.absoluteFilePath());
     }
 }
 
@@ -154,7 +178,7 @@ static QStringList searchPaths()
     return paths;
 }
 
-void KXcursorThemePrivate::load(const QString &themeName, int size, qreal devicePixelRatio)
+void KXcursorThemePrivate::load(const QString &themeName)
 {
     const QStringList paths = searchPaths();
     QStringList inherits;
@@ -164,7 +188,7 @@ void KXcursorThemePrivate::load(const QString &themeName, int size, qreal device
         if (!dir.exists()) {
             continue;
         }
-        loadCursors(dir.filePath(QStringLiteral("cursors")), size, devicePixelRatio);
+        loadCursors(dir.filePath(QStringLiteral("cursors")));
         if (inherits.isEmpty()) {
             const KConfig config(dir.filePath(QStringLiteral("index.theme")), KConfig::NoGlobals);
             inherits << KConfigGroup(&config, "Icon Theme").readEntry("Inherits", QStringList());
@@ -172,7 +196,7 @@ void KXcursorThemePrivate::load(const QString &themeName, int size, qreal device
     }
 
     for (const QString &inherit : inherits) {
-        load(inherit, size, devicePixelRatio);
+        load(inherit);
     }
 }
 
@@ -184,7 +208,9 @@ KXcursorTheme::KXcursorTheme()
 KXcursorTheme::KXcursorTheme(const QString &themeName, int size, qreal devicePixelRatio)
     : d(new KXcursorThemePrivate)
 {
-    d->load(themeName, size, devicePixelRatio);
+    d->size = size;
+    d->devicePixelRatio = devicePixelRatio;
+    d->load(themeName);
 }
 
 KXcursorTheme::KXcursorTheme(const KXcursorTheme &other)
@@ -209,7 +235,14 @@ bool KXcursorTheme::isEmpty() const
 
 QVector<KXcursorSprite> KXcursorTheme::shape(const QByteArray &name) const
 {
-    return d->registry.value(name);
+    const QStringList filePaths = d->registry.value(name);
+    for (const QString &filePath : filePaths) {
+        const QVector<KXcursorSprite> sprites = loadCachedCursor(filePath, d->size, d->devicePixelRatio);
+        if (!sprites.isEmpty()) {
+            return sprites;
+        }
+    }
+    return {};
 }
 
 } // namespace KWin
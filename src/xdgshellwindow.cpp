@@ -15,7 +15,9 @@
 #endif
 #include "decorations/decorationbridge.h"
 #include "deleted.h"
+#include "ftrace.h"
 #include "platform.h"
+#include "renderloop.h"
 #include "screenedge.h"
 #include "touch_input.h"
 #include "utils/subsurfacemonitor.h"
@@ -39,6 +41,100 @@ using namespace KWaylandServer;
 namespace KWin
 {
 
+// How long the participants of a configure transaction can take to render their new geometry
+static const int s_configureTransactionTimeout = 100;
+
+XdgConfigureTransaction *XdgConfigureTransaction::s_current = nullptr;
+
+XdgConfigureTransaction::XdgConfigureTransaction()
+{
+    m_timeoutTimer.setSingleShot(true);
+    connect(&m_timeoutTimer, &QTimer::timeout, this, &XdgConfigureTransaction::finish);
+
+    // Configure events are sent when the event loop is about to become idle, so every configure
+    // event caused by the same action has been sent by the next event loop cycle.
+    QTimer::singleShot(0, this, &XdgConfigureTransaction::close);
+}
+
+XdgConfigureTransaction *XdgConfigureTransaction::join(XdgSurfaceWindow *window, const QRect &bounds)
+{
+    if (!s_current) {
+        s_current = new XdgConfigureTransaction();
+    }
+    s_current->add(window, bounds);
+    return s_current;
+}
+
+void XdgConfigureTransaction::add(XdgSurfaceWindow *window, const QRect &bounds)
+{
+    if (!m_participants.contains(window)) {
+        m_participants.append(window);
+    }
+    m_area += window->frameGeometry();
+    m_area += bounds;
+
+    // A single window is resized as soon as it commits, there's nothing to synchronize
+    if (m_participants.count() > 1) {
+        inhibitOutputs();
+        if (!m_timeoutTimer.isActive()) {
+            m_timeoutTimer.start(s_configureTransactionTimeout);
+        }
+    }
+}
+
+void XdgConfigureTransaction::inhibitOutputs()
+{
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+    for (Output *output : outputs) {
+        if (!m_area.intersects(output->geometry()) || m_inhibitedOutputs.contains(output)) {
+            continue;
+        }
+        output->renderLoop()->inhibit();
+        m_inhibitedOutputs.append(output);
+    }
+}
+
+void XdgConfigureTransaction::leave(XdgSurfaceWindow *window)
+{
+    m_participants.removeAll(window);
+    if (!m_open && m_participants.isEmpty()) {
+        finish();
+    }
+}
+
+void XdgConfigureTransaction::close()
+{
+    m_open = false;
+    if (s_current == this) {
+        s_current = nullptr;
+    }
+    if (m_participants.count() < 2) {
+        finish();
+    }
+}
+
+void XdgConfigureTransaction::finish()
+{
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+    m_open = false;
+    if (s_current == this) {
+        s_current = nullptr;
+    }
+
+    m_timeoutTimer.stop();
+    for (const QPointer<Output> &output : std::as_const(m_inhibitedOutputs)) {
+        if (output) {
+            output->renderLoop()->uninhibit();
+        }
+    }
+    m_inhibitedOutputs.clear();
+    m_participants.clear();
+    deleteLater();
+}
+
 XdgSurfaceWindow::XdgSurfaceWindow(XdgSurfaceInterface *shellSurface)
     : WaylandWindow(shellSurface->surface())
     , m_shellSurface(shellSurface)
@@ -93,6 +189,7 @@ XdgSurfaceWindow::XdgSurfaceWindow(XdgSurfaceInterface *shellSurface)
 
 XdgSurfaceWindow::~XdgSurfaceWindow()
 {
+    leaveConfigureTransactions();
     qDeleteAll(m_configureEvents);
 }
 
@@ -120,6 +217,16 @@ XdgSurfaceConfigure *XdgSurfaceWindow::lastAcknowledgedConfigure() const
     return m_lastAcknowledgedConfigure.data();
 }
 
+bool XdgSurfaceWindow::isResizePending() const
+{
+    for (const XdgSurfaceConfigure *configureEvent : m_configureEvents) {
+        if (configureEvent->bounds.size() != size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void XdgSurfaceWindow::scheduleConfigure()
 {
     if (!isZombie()) {
@@ -141,12 +248,19 @@ void XdgSurfaceWindow::sendConfigure()
     configureEvent->flags |= m_configureFlags;
     m_configureFlags = {};
 
+    // Interactive resizes are paced separately, holding the screen for them would only add lag.
+    if (readyForPainting() && isShown() && !isInteractiveMoveResize() && configureEvent->bounds.size() != size()) {
+        configureEvent->transaction = XdgConfigureTransaction::join(this, configureEvent->bounds);
+    }
+
     m_configureEvents.append(configureEvent);
+    fTraceFlow("Configure", configureEvent->serial, Begin);
 }
 
 void XdgSurfaceWindow::handleConfigureAcknowledged(quint32 serial)
 {
     m_lastAcknowledgedConfigureSerial = serial;
+    fTraceFlow("Configure", serial, End);
 }
 
 void XdgSurfaceWindow::handleCommit()
@@ -162,6 +276,9 @@ void XdgSurfaceWindow::handleCommit()
                 break;
             }
             m_lastAcknowledgedConfigure.reset(m_configureEvents.takeFirst());
+            if (m_lastAcknowledgedConfigure->transaction) {
+                m_lastAcknowledgedConfigure->transaction->leave(this);
+            }
         }
     }
 
@@ -321,8 +438,18 @@ QRect XdgSurfaceWindow::frameRectToBufferRect(const QRect &rect) const
     return QRect(QPoint(left, top), surface()->size());
 }
 
+void XdgSurfaceWindow::leaveConfigureTransactions()
+{
+    for (const XdgSurfaceConfigure *configureEvent : std::as_const(m_configureEvents)) {
+        if (configureEvent->transaction) {
+            configureEvent->transaction->leave(this);
+        }
+    }
+}
+
 void XdgSurfaceWindow::destroyWindow()
 {
+    leaveConfigureTransactions();
     markAsZombie();
     if (isInteractiveMoveResize()) {
         leaveInteractiveMoveResize();
@@ -893,6 +1020,9 @@ void XdgToplevelWindow::handleRoleCommit()
     if (configureEvent) {
         handleStatesAcknowledged(configureEvent->states);
     }
+    if (m_interactiveResizePending && !isResizePending()) {
+        flushInteractiveResize();
+    }
 }
 
 void XdgToplevelWindow::doMinimize()
@@ -907,6 +1037,19 @@ void XdgToplevelWindow::doMinimize()
 
 void XdgToplevelWindow::doInteractiveResizeSync()
 {
+    // Don't queue configure events faster than the client can render them, otherwise a slow
+    // client falls further and further behind. Only the latest size is requested once the
+    // client has caught up with the previous one.
+    if (isResizePending()) {
+        m_interactiveResizePending = true;
+        return;
+    }
+    flushInteractiveResize();
+}
+
+void XdgToplevelWindow::flushInteractiveResize()
+{
+    m_interactiveResizePending = false;
     moveResizeInternal(moveResizeGeometry(), MoveResizeMode::Resize);
 }
 
@@ -1019,6 +1162,9 @@ bool XdgToplevelWindow::doStartInteractiveMoveResize()
 
 void XdgToplevelWindow::doFinishInteractiveMoveResize()
 {
+    if (m_interactiveResizePending) {
+        flushInteractiveResize();
+    }
     if (m_nextStates & XdgToplevelInterface::State::Resizing) {
         m_nextStates &= ~XdgToplevelInterface::State::Resizing;
         scheduleConfigure();
@@ -14,7 +14,9 @@
 #include "wayland/xdgshell_interface.h"
 #include "waylandwindow.h"
 
+#include <QPointer>
 #include <QQueue>
+#include <QRegion>
 #include <QTimer>
 
 #include <optional>
@@ -31,6 +33,8 @@ class XdgToplevelDecorationV1Interface;
 namespace KWin
 {
 class Output;
+class XdgConfigureTransaction;
+class XdgSurfaceWindow;
 
 class XdgSurfaceConfigure
 {
@@ -48,6 +52,50 @@ public:
     Gravity gravity;
     qreal serial;
     ConfigureFlags flags;
+    QPointer<XdgConfigureTransaction> transaction;
+};
+
+/**
+ * The XdgConfigureTransaction class groups the configure events that resize several windows
+ * in response to a single action, e.g. quick tiling or a script that arranges windows.
+ *
+ * The outputs showing the participating windows are not repainted until every participant
+ * has committed a buffer for its configure event or the transaction has timed out, so the new
+ * layout appears in one frame rather than one window at a time.
+ */
+class XdgConfigureTransaction : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Adds the @a window that is about to be resized to @a bounds to the transaction of the
+     * current event loop cycle.
+     */
+    static XdgConfigureTransaction *join(XdgSurfaceWindow *window, const QRect &bounds);
+
+    /**
+     * Removes the @a window from the transaction, either because it has committed its new
+     * geometry or because it's gone.
+     */
+    void leave(XdgSurfaceWindow *window);
+
+private:
+    XdgConfigureTransaction();
+
+    void add(XdgSurfaceWindow *window, const QRect &bounds);
+    void inhibitOutputs();
+    void close();
+    void finish();
+
+    QVector<XdgSurfaceWindow *> m_participants;
+    QRegion m_area;
+    QVector<QPointer<Output>> m_inhibitedOutputs;
+    QTimer m_timeoutTimer;
+    bool m_open = true;
+    bool m_finished = false;
+
+    static XdgConfigureTransaction *s_current;
 };
 
 class XdgSurfaceWindow : public WaylandWindow
@@ -74,6 +122,7 @@ protected:
     virtual void handleRolePrecommit();
 
     XdgSurfaceConfigure *lastAcknowledgedConfigure() const;
+    bool isResizePending() const;
     void scheduleConfigure();
     void sendConfigure();
 
@@ -93,6 +142,7 @@ private:
     void setHaveNextWindowGeometry();
     void resetHaveNextWindowGeometry();
     void maybeUpdateMoveResizeGeometry(const QRect &rect);
+    void leaveConfigureTransactions();
 
     KWaylandServer::XdgSurfaceInterface *m_shellSurface;
     QTimer *m_configureTimer;
@@ -215,6 +265,7 @@ private:
     void configureXdgDecoration(DecorationMode decorationMode);
     void configureServerDecoration(DecorationMode decorationMode);
     void clearDecoration();
+    void flushInteractiveResize();
 
     QPointer<KWaylandServer::AppMenuInterface> m_appMenuInterface;
     QPointer<KWaylandServer::ServerSideDecorationPaletteInterface> m_paletteInterface;
@@ -232,6 +283,7 @@ private:
     bool m_isInitialized = false;
     bool m_userNoBorder = false;
     bool m_isTransient = false;
+    bool m_interactiveResizePending = false;
     QPointer<Output> m_fullScreenRequestedOutput;
     QSharedPointer<KDecoration2::Decoration> m_nextDecoration;
 };
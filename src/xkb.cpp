@@ -353,7 +353,7 @@ void Xkb::updateKey(uint32_t key, InputRedirection::KeyboardKeyState state)
     if (!m_keymap || !m_state) {
         return;
     }
-    xkb_state_update_key(m_state, key + 8, static_cast<xkb_key_direction>(state));
+    const xkb_state_component changes = xkb_state_update_key(m_state, key + 8, static_cast<xkb_key_direction>(state));
     if (state == InputRedirection::KeyboardKeyPressed) {
         const auto sym = toKeysym(key);
         if (m_compose.state && xkb_compose_state_feed(m_compose.state, sym) == XKB_COMPOSE_FEED_ACCEPTED) {
@@ -372,14 +372,19 @@ void Xkb::updateKey(uint32_t key, InputRedirection::KeyboardKeyState state)
             m_keysym = sym;
         }
     }
-    updateModifiers();
+    if (changes) {
+        updateModifiers();
+    } else {
+        // most keys don't change the state, only the keypad modifier depends on the key itself
+        updateKeypadModifier();
+    }
     updateConsumedModifiers(key);
 }
 
 void Xkb::updateModifiers()
 {
     Qt::KeyboardModifiers mods = Qt::NoModifier;
-    if (xkb_state_mod_index_is_active(m_state, m_shiftModifier, XKB_STATE_MODS_EFFECTIVE) == 1 || xkb_state_mod_index_is_active(m_state, m_capsModifier, XKB_STATE_MODS_EFFECTIVE) == 1) {
+    if (xkb_state_mod_index_is_active(m_state, m_shiftModifier, XKB_STATE_MODS_EFFECTIVE) == 1) {
         mods |= Qt::ShiftModifier;
     }
     if (xkb_state_mod_index_is_active(m_state, m_altModifier, XKB_STATE_MODS_EFFECTIVE) == 1) {
@@ -391,10 +396,12 @@ void Xkb::updateModifiers()
     if (xkb_state_mod_index_is_active(m_state, m_metaModifier, XKB_STATE_MODS_EFFECTIVE) == 1) {
         mods |= Qt::MetaModifier;
     }
-    if (m_keysym >= XKB_KEY_KP_Space && m_keysym <= XKB_KEY_KP_9) {
-        mods |= Qt::KeypadModifier;
+    m_shortcutModifiers = mods;
+    if (xkb_state_mod_index_is_active(m_state, m_capsModifier, XKB_STATE_MODS_EFFECTIVE) == 1) {
+        mods |= Qt::ShiftModifier;
     }
-    m_modifiers = mods;
+    m_stateModifiers = mods;
+    updateKeypadModifier();
 
     // update LEDs
     LEDs leds;
@@ -427,6 +434,15 @@ void Xkb::updateModifiers()
     }
 }
 
+void Xkb::updateKeypadModifier()
+{
+    if (m_keysym >= XKB_KEY_KP_Space && m_keysym <= XKB_KEY_KP_9) {
+        m_modifiers = m_stateModifiers | Qt::KeypadModifier;
+    } else {
+        m_modifiers = m_stateModifiers;
+    }
+}
+
 void Xkb::forwardModifiers()
 {
     if (!m_seat || !m_seat->keyboard()) {
@@ -479,19 +495,7 @@ Qt::KeyboardModifiers Xkb::modifiersRelevantForGlobalShortcuts(uint32_t scanCode
     if (!m_state) {
         return Qt::NoModifier;
     }
-    Qt::KeyboardModifiers mods = Qt::NoModifier;
-    if (xkb_state_mod_index_is_active(m_state, m_shiftModifier, XKB_STATE_MODS_EFFECTIVE) == 1) {
-        mods |= Qt::ShiftModifier;
-    }
-    if (xkb_state_mod_index_is_active(m_state, m_altModifier, XKB_STATE_MODS_EFFECTIVE) == 1) {
-        mods |= Qt::AltModifier;
-    }
-    if (xkb_state_mod_index_is_active(m_state, m_controlModifier, XKB_STATE_MODS_EFFECTIVE) == 1) {
-        mods |= Qt::ControlModifier;
-    }
-    if (xkb_state_mod_index_is_active(m_state, m_metaModifier, XKB_STATE_MODS_EFFECTIVE) == 1) {
-        mods |= Qt::MetaModifier;
-    }
+    const Qt::KeyboardModifiers mods = m_shortcutModifiers;
 
     Qt::KeyboardModifiers consumedMods = m_consumedModifiers;
     if ((mods & Qt::ShiftModifier) && (consumedMods == Qt::ShiftModifier)) {
@@ -115,6 +115,7 @@ private:
     void updateKeymap(xkb_keymap *keymap);
     void createKeymapFile();
     void updateModifiers();
+    void updateKeypadModifier();
     void updateConsumedModifiers(uint32_t key);
     xkb_context *m_context;
     xkb_keymap *m_keymap;
@@ -130,6 +131,9 @@ private:
     xkb_led_index_t m_capsLock;
     xkb_led_index_t m_scrollLock;
     Qt::KeyboardModifiers m_modifiers;
+    // The modifiers derived from m_state, they're only recomputed when the state changes
+    Qt::KeyboardModifiers m_stateModifiers = Qt::NoModifier;
+    Qt::KeyboardModifiers m_shortcutModifiers = Qt::NoModifier;
     Qt::KeyboardModifiers m_consumedModifiers;
     xkb_keysym_t m_keysym;
     quint32 m_currentLayout = 0;
@@ -23,6 +23,8 @@
 #include <xcb/xfixes.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <xwayland_logging.h>
@@ -32,8 +34,21 @@ namespace KWin
 namespace Xwl
 {
 
-// in Bytes: equals 64KB
+// in Bytes: equals 64KB, this is also the size of the first chunk of a transfer
 static const uint32_t s_incrChunkSize = 63 * 1024;
+// in Bytes: upper bound for the chunks of long incremental transfers
+static const uint32_t s_maxIncrChunkSize = 4 * 1024 * 1024;
+
+/**
+ * Returns the largest chunk that fits into a single ChangeProperty request.
+ */
+static uint32_t maxIncrChunkSize()
+{
+    // The maximum request length is in units of four bytes, leave room for the request header
+    const uint32_t maxRequestLength = xcb_get_maximum_request_length(kwinApp()->x11Connection()) * 4;
+    const uint32_t space = maxRequestLength > 1024 ? maxRequestLength - 1024 : 0;
+    return std::clamp(space, s_incrChunkSize, s_maxIncrChunkSize);
+}
 
 Transfer::Transfer(xcb_atom_t selection, qint32 fd, xcb_timestamp_t timestamp, QObject *parent)
     : QObject(parent)
@@ -41,6 +56,12 @@ Transfer::Transfer(xcb_atom_t selection, qint32 fd, xcb_timestamp_t timestamp, Q
     , m_fd(fd)
     , m_timestamp(timestamp)
 {
+    // The other end of the fd is a client, a slow reader or writer must not block the compositor
+    const int flags = fcntl(m_fd, F_GETFL);
+    if (flags != -1 && !(flags & O_NONBLOCK)) {
+        fcntl(m_fd, F_SETFL, flags | O_NONBLOCK);
+    }
+    m_elapsed.start();
 }
 
 void Transfer::createSocketNotifier(QSocketNotifier::Type type)
@@ -65,6 +86,10 @@ void Transfer::timeout()
 
 void Transfer::endTransfer()
 {
+    if (m_fd >= 0) {
+        qCDebug(KWIN_XWL) << "Transferred" << m_transferredBytes << "bytes in" << m_elapsed.elapsed() << "ms"
+                          << (m_incr ? "incrementally" : "at once");
+    }
     clearSocketNotifier();
     closeFd();
     Q_EMIT finished();
@@ -83,6 +108,7 @@ TransferWltoX::TransferWltoX(xcb_atom_t selection, xcb_selection_request_event_t
                              qint32 fd, QObject *parent)
     : Transfer(selection, fd, 0, parent)
     , m_request(request)
+    , m_chunkSize(s_incrChunkSize)
 {
 }
 
@@ -120,6 +146,7 @@ int TransferWltoX::flushSourceData()
     resetTimeout();
 
     const auto rm = m_chunks.takeFirst();
+    addTransferredBytes(rm.first.size());
     return rm.first.size();
 }
 
@@ -154,19 +181,26 @@ void TransferWltoX::startIncr()
 
 void TransferWltoX::readWlSource()
 {
-    if (m_chunks.size() == 0 || m_chunks.last().second == s_incrChunkSize) {
+    if (m_chunks.size() == 0 || m_chunks.last().second == m_chunks.last().first.size()) {
         // append new chunk
         auto next = QPair<QByteArray, int>();
-        next.first.resize(s_incrChunkSize);
+        next.first.resize(m_chunkSize);
         next.second = 0;
         m_chunks.append(next);
+        // The longer the transfer goes on, the larger the chunks get, so large transfers
+        // need fewer round trips with the requestor
+        m_chunkSize = std::min<int>(m_chunkSize * 2, maxIncrChunkSize());
     }
 
     const auto oldLen = m_chunks.last().second;
-    const auto avail = s_incrChunkSize - m_chunks.last().second;
+    const auto avail = m_chunks.last().first.size() - m_chunks.last().second;
     Q_ASSERT(avail > 0);
 
     ssize_t readLen = read(fd(), m_chunks.last().first.data() + oldLen, avail);
+    if (readLen == -1 && (errno == EAGAIN || errno == EINTR)) {
+        // nothing to read after all, wait for the next notification
+        return;
+    }
     if (readLen == -1) {
         qCWarning(KWIN_XWL) << "Error reading in Wl data.";
 
@@ -195,7 +229,7 @@ void TransferWltoX::readWlSource()
             Q_EMIT selectionNotify(m_request, true);
             endTransfer();
         }
-    } else if (m_chunks.last().second == s_incrChunkSize) {
+    } else if (m_chunks.last().second == m_chunks.last().first.size()) {
         // first chunk full, but not yet at fd end -> go incremental
         if (incr()) {
             m_flushPropertyOnDelete = true;
@@ -533,13 +567,17 @@ void TransferXtoWl::dataSourceWrite()
     QByteArray property = m_receiver->data();
 
     ssize_t len = write(fd(), property.constData(), property.size());
-    if (len == -1) {
+    if (len == -1 && (errno == EAGAIN || errno == EINTR)) {
+        // the pipe is full, continue once the client has read from it
+        len = 0;
+    } else if (len == -1) {
         qCWarning(KWIN_XWL) << "X11 to Wayland write error on fd:" << fd();
         endTransfer();
         return;
     }
 
     m_receiver->partRead(len);
+    addTransferredBytes(len);
     if (len == property.size()) {
         // property completely transferred
         if (incr()) {
@@ -9,6 +9,7 @@
 #ifndef KWIN_XWL_TRANSFER
 #define KWIN_XWL_TRANSFER
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QSocketNotifier>
 #include <QVector>
@@ -85,6 +86,10 @@ protected:
     {
         m_timeout = false;
     }
+    void addTransferredBytes(qint64 bytes)
+    {
+        m_transferredBytes += bytes;
+    }
     void createSocketNotifier(QSocketNotifier::Type type);
     void clearSocketNotifier();
     QSocketNotifier *socketNotifier() const
@@ -103,6 +108,9 @@ private:
     bool m_incr = false;
     bool m_timeout = false;
 
+    QElapsedTimer m_elapsed;
+    qint64 m_transferredBytes = 0;
+
     Q_DISABLE_COPY(Transfer)
 };
 
@@ -138,6 +146,8 @@ private:
      * TODO: explain second QPair component
      */
     QVector<QPair<QByteArray, int>> m_chunks;
+    // size of the next chunk to be read from the source
+    int m_chunkSize;
 
     bool m_propertyIsSet = false;
     bool m_flushPropertyOnDelete = false;
@@ -41,6 +41,8 @@
 
 #include <cerrno>
 #include <cstring>
+#include <map>
+#include <tuple>
 #include <sys/socket.h>
 #include <unistd.h>
 
@@ -91,6 +93,22 @@ Xwayland::~Xwayland()
 void Xwayland::start()
 {
     m_launcher->start();
+
+    // X11 clients can connect to the display before Xwayland is running, so tell them about it
+    if (m_launcher->isWaitingForConnection()) {
+        publishEnvironment();
+        Q_EMIT listening();
+    }
+}
+
+void Xwayland::publishEnvironment()
+{
+    auto env = m_app->processStartupEnvironment();
+    env.insert(QStringLiteral("DISPLAY"), m_launcher->displayName());
+    env.insert(QStringLiteral("XAUTHORITY"), m_launcher->xauthority());
+    qputenv("DISPLAY", m_launcher->displayName().toLatin1());
+    qputenv("XAUTHORITY", m_launcher->xauthority().toLatin1());
+    m_app->setProcessStartupEnvironment(env);
 }
 
 XwaylandLauncher *Xwayland::xwaylandLauncher() const
@@ -98,6 +116,57 @@ XwaylandLauncher *Xwayland::xwaylandLauncher() const
     return m_launcher;
 }
 
+/**
+ * Drops events that are superseded by a later event in the same batch, e.g. when a client
+ * sets the same property over and over again while it creates lots of windows.
+ *
+ * Only events that describe the latest state of something are coalesced: pointer motion, window
+ * geometry changes and property changes, whose handlers read the current property value
+ * anyway. Any other event acts as a barrier, so the order of events that matter is preserved.
+ */
+static void coalesceEvents(QVector<xcb_generic_event_t *> &events)
+{
+    // the event type, then the window and the atom respectively the window it's relative to
+    using Key = std::tuple<uint8_t, uint32_t, uint32_t>;
+    std::map<Key, int> latest;
+
+    for (int i = 0; i < events.count(); ++i) {
+        xcb_generic_event_t *event = events[i];
+        const uint8_t eventType = event->response_type & ~0x80;
+
+        Key key;
+        switch (eventType) {
+        case XCB_MOTION_NOTIFY: {
+            const auto motion = reinterpret_cast<xcb_motion_notify_event_t *>(event);
+            key = Key(eventType, motion->event, motion->state);
+            break;
+        }
+        case XCB_CONFIGURE_NOTIFY: {
+            const auto configure = reinterpret_cast<xcb_configure_notify_event_t *>(event);
+            key = Key(eventType, configure->window, configure->event);
+            break;
+        }
+        case XCB_PROPERTY_NOTIFY: {
+            const auto property = reinterpret_cast<xcb_property_notify_event_t *>(event);
+            key = Key(eventType, property->window, property->atom);
+            break;
+        }
+        default:
+            latest.clear();
+            continue;
+        }
+
+        auto it = latest.find(key);
+        if (it != latest.end()) {
+            free(events[it->second]);
+            events[it->second] = nullptr;
+            it->second = i;
+        } else {
+            latest.emplace(key, i);
+        }
+    }
+}
+
 void Xwayland::dispatchEvents()
 {
     xcb_connection_t *connection = kwinApp()->x11Connection();
@@ -113,13 +182,23 @@ void Xwayland::dispatchEvents()
         return;
     }
 
+    // Drain the connection first, so that a burst of events can be handled as a whole.
+    QVector<xcb_generic_event_t *> events;
     while (xcb_generic_event_t *event = xcb_poll_for_event(connection)) {
+        events.append(event);
+    }
+    coalesceEvents(events);
+
+    QAbstractEventDispatcher *dispatcher = QCoreApplication::eventDispatcher();
+    for (xcb_generic_event_t *event : qAsConst(events)) {
+        if (!event) {
+            continue;
+        }
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
         long result = 0;
 #else
         qintptr result = 0;
 #endif
-        QAbstractEventDispatcher *dispatcher = QCoreApplication::eventDispatcher();
         dispatcher->filterNativeEvent(QByteArrayLiteral("xcb_generic_event_t"), event, &result);
         free(event);
     }
@@ -192,12 +271,7 @@ void Xwayland::handleXwaylandReady()
 
     DataBridge::create(this);
 
-    auto env = m_app->processStartupEnvironment();
-    env.insert(QStringLiteral("DISPLAY"), m_launcher->displayName());
-    env.insert(QStringLiteral("XAUTHORITY"), m_launcher->xauthority());
-    qputenv("DISPLAY", m_launcher->displayName().toLatin1());
-    qputenv("XAUTHORITY", m_launcher->xauthority().toLatin1());
-    m_app->setProcessStartupEnvironment(env);
+    publishEnvironment();
 
     connect(kwinApp()->platform(), &Platform::primaryOutputChanged, this, &Xwayland::updatePrimary);
     updatePrimary(kwinApp()->platform()->primaryOutput());
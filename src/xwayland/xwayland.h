@@ -44,6 +44,14 @@ Q_SIGNALS:
      */
     void started();
 
+    /**
+     * This signal is emitted when the X11 sockets are listening, but the Xwayland server
+     * will only be spawned when the first X11 client connects. started() is emitted later.
+     *
+     * @since 5.26
+     */
+    void listening();
+
     /**
      * This signal is emitted when an error occurs with the Xwayland server.
      */
@@ -64,6 +72,7 @@ private:
     void installSocketNotifier();
     void uninstallSocketNotifier();
     void updatePrimary(Output *primaryOutput);
+    void publishEnvironment();
 
     bool createX11Connection();
     void destroyX11Connection();
@@ -52,6 +52,7 @@ XwaylandLauncher::XwaylandLauncher(QObject *parent)
 
 XwaylandLauncher::~XwaylandLauncher()
 {
+    uninstallListenNotifiers();
 }
 
 void XwaylandLauncher::setListenFDs(const QVector<int> &listenFds)
@@ -69,9 +70,14 @@ void XwaylandLauncher::setXauthority(const QString &xauthority)
     m_xAuthority = xauthority;
 }
 
+void XwaylandLauncher::setStartOnDemand(bool onDemand)
+{
+    m_startOnDemand = onDemand;
+}
+
 void XwaylandLauncher::start()
 {
-    if (m_xwaylandProcess) {
+    if (m_xwaylandProcess || isWaitingForConnection()) {
         return;
     }
 
@@ -86,6 +92,45 @@ void XwaylandLauncher::start()
         m_listenFds = m_socket->fileDescriptors();
     }
 
+    if (m_startOnDemand) {
+        qCDebug(KWIN_XWL) << "Waiting for the first X11 client on display" << m_displayName;
+        installListenNotifiers();
+        return;
+    }
+
+    startInternal();
+}
+
+bool XwaylandLauncher::isWaitingForConnection() const
+{
+    return !m_listenNotifiers.isEmpty();
+}
+
+void XwaylandLauncher::installListenNotifiers()
+{
+    for (int fd : qAsConst(m_listenFds)) {
+        auto notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &XwaylandLauncher::handleFirstConnection);
+        m_listenNotifiers.append(notifier);
+    }
+}
+
+void XwaylandLauncher::uninstallListenNotifiers()
+{
+    // One of the notifiers may be emitting activated() right now, so they can't be deleted directly
+    for (QSocketNotifier *notifier : qAsConst(m_listenNotifiers)) {
+        notifier->setEnabled(false);
+        notifier->deleteLater();
+    }
+    m_listenNotifiers.clear();
+}
+
+void XwaylandLauncher::handleFirstConnection()
+{
+    // The pending connection is not accepted here, it stays in the backlog of the listening
+    // socket until the Xwayland process inherits the socket and accepts it.
+    qCDebug(KWIN_XWL) << "An X11 client connected to display" << m_displayName << "- spawning Xwayland";
+    uninstallListenNotifiers();
     startInternal();
 }
 
@@ -190,6 +235,7 @@ bool XwaylandLauncher::startInternal()
 
 void XwaylandLauncher::stop()
 {
+    uninstallListenNotifiers();
     if (!m_xwaylandProcess) {
         return;
     }
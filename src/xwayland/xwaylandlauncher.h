@@ -56,6 +56,14 @@ public:
      */
     void setXauthority(const QString &xauthority);
 
+    /**
+     * Sets whether the Xwayland process should only be spawned when the first X11 client
+     * connects to one of the listening sockets. The default is to spawn it in start().
+     *
+     * @since 5.26
+     */
+    void setStartOnDemand(bool onDemand);
+
     void start();
     void stop();
 
@@ -63,6 +71,14 @@ public:
     QString xauthority() const;
     int xcbConnectionFd() const;
 
+    /**
+     * Returns @c true if the X11 sockets are listening but no Xwayland process has been
+     * spawned yet because no X11 client has connected so far.
+     *
+     * @since 5.26
+     */
+    bool isWaitingForConnection() const;
+
     /**
      * @internal
      */
@@ -90,12 +106,16 @@ private Q_SLOTS:
 
 private:
     void maybeDestroyReadyNotifier();
+    void installListenNotifiers();
+    void uninstallListenNotifiers();
+    void handleFirstConnection();
     bool startInternal();
     void stopInternal();
     void restartInternal();
 
     QProcess *m_xwaylandProcess = nullptr;
     QSocketNotifier *m_readyNotifier = nullptr;
+    QVector<QSocketNotifier *> m_listenNotifiers;
     QTimer *m_resetCrashCountTimer = nullptr;
     // this is only used when kwin is run without kwin_wayland_wrapper
     QScopedPointer<XwaylandSocket> m_socket;
@@ -104,6 +124,7 @@ private:
     QString m_xAuthority;
 
     int m_crashCount = 0;
+    bool m_startOnDemand = false;
     int m_xcbConnectionFd = -1;
 };
 